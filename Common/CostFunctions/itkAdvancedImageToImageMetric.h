@@ -31,12 +31,20 @@
 #include "vnl/vnl_sparse_matrix.h"
 
 #include "itkImageMaskSpatialObject.h"
+#include "itkImageMaskLookup.h"
 
 // Needed for checking for B-spline for faster implementation
 #include "itkAdvancedBSplineDeformableTransform.h"
 #include "itkAdvancedCombinationTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkRecursiveBSplineSampleEvaluator.h"
 
 #include "itkPlatformMultiThreader.h"
+#include "itkHotPathProfiler.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace itk
 {
@@ -66,6 +74,23 @@ namespace itk
  *   unless you have a good reason for it...
  * \li Some convenience functions are provided, such as the IsInsideMovingMask
  *   and CheckNumberOfSamples.
+ * \li Specialized sample evaluation: for a RecursiveBSplineTransform of order 3,
+ *   possibly composed with a linear initial transform, in combination with a
+ *   B-spline or linear interpolator, the transform and interpolator of each sample
+ *   are evaluated without virtual function calls. The combination is selected
+ *   once per resolution, in Initialize(). Metrics that write their loop over the
+ *   samples as a template in the evaluator type can use this via CallWithSampleEvaluator().
+ * \li Re-entrant evaluation: GetValue() and GetValueAndDerivative() set the
+ *   parameters on the shared transform, so they cannot be called simultaneously.
+ *   GetValueInContext() and GetValueAndDerivativeInContext() instead take an
+ *   EvaluationContextType, which holds a private copy of the transform and
+ *   scratch buffers. Several parameter vectors can then be evaluated
+ *   concurrently on one metric instance, using one context per thread.
+ *   A context may itself split the samples over several work units. The
+ *   context evaluation uses the same sample loop and sample evaluators as
+ *   GetValue() and GetValueAndDerivative(). The AdvancedMeanSquares and the
+ *   CombinationImageToImageMetric of such metrics implement it; the other
+ *   metrics fall back to serialized calls of GetValue() and GetValueAndDerivative().
  *
  * The parameters used in this class are:
  * \parameter MovingImageDerivativeScales: scale the moving image derivatives. Use\n
@@ -133,6 +158,7 @@ public:
 
   typedef ImageMaskSpatialObject< itkGetStaticConstMacro( FixedImageDimension ) > FixedImageMaskSpatialObject2Type;
   typedef ImageMaskSpatialObject< itkGetStaticConstMacro( MovingImageDimension ) > MovingImageMaskSpatialObject2Type;
+  typedef ImageMaskLookup< itkGetStaticConstMacro( MovingImageDimension ) >        MovingImageMaskLookupType;
 
   /** Some useful extra typedefs. */
   typedef typename FixedImageType::PixelType               FixedImagePixelType;
@@ -167,6 +193,8 @@ public:
   typedef typename BSplineOrder1TransformType::Pointer                             BSplineOrder1TransformPointer;
   typedef typename BSplineOrder2TransformType::Pointer                             BSplineOrder2TransformPointer;
   typedef typename BSplineOrder3TransformType::Pointer                             BSplineOrder3TransformPointer;
+  typedef RecursiveBSplineTransform< ScalarType, FixedImageDimension, 3 >          RecursiveBSplineOrder3TransformType;
+  typedef typename RecursiveBSplineOrder3TransformType::Pointer                    RecursiveBSplineOrder3TransformPointer;
 
   /** Hessian type; for SelfHessian (experimental feature) */
   typedef typename DerivativeType::ValueType    HessianValueType;
@@ -254,6 +282,20 @@ public:
   itkSetMacro( MovingImageDerivativeScales, MovingImageDerivativeScalesType );
   itkGetConstReferenceMacro( MovingImageDerivativeScales, MovingImageDerivativeScalesType );
 
+  /** Set/Get whether the specialized sample evaluators may be used, when the
+   * transform and interpolator allow it. Default: true.
+   */
+  itkSetMacro( UseSpecializedSampleEvaluator, bool );
+  itkGetConstMacro( UseSpecializedSampleEvaluator, bool );
+
+  /** Set/Get whether the central difference gradient of the moving image is
+   * precomputed, for interpolators that do not provide a derivative. If false,
+   * the gradient is computed in each sample from the neighbouring voxels, which
+   * gives the same result without storing a gradient image. Default: true.
+   */
+  itkSetMacro( PrecomputeMovingImageGradient, bool );
+  itkGetConstMacro( PrecomputeMovingImageGradient, bool );
+
   /** Initialize the Metric by making sure that all the components
    *  are present and plugged together correctly.
    * \li Call the superclass' implementation
@@ -261,6 +303,7 @@ public:
    * \li Initialize the image sampler, if used.
    * \li Check if a B-spline interpolator has been set
    * \li Check if an AdvancedTransform has been set
+   * \li Select the specialized sample evaluator, if possible
    */
   void Initialize( void ) override;
 
@@ -291,6 +334,64 @@ public:
   virtual void BeforeThreadedGetValueAndDerivative(
     const TransformParametersType & parameters ) const;
 
+  /** Thread-private state for the re-entrant evaluation of the metric.
+   * It holds a private copy of the transform, on which the parameters are set,
+   * and the buffers and partial results of its work units, which are reused
+   * between evaluations. Each thread that evaluates the metric needs its own
+   * context. A CombinationImageToImageMetric keeps a context per sub metric.
+   */
+  struct EvaluationContextWorkUnitType
+  {
+    typename AdvancedTransformType::NonZeroJacobianIndicesType st_NonZeroJacobianIndices;
+    DerivativeType                                             st_ImageJacobian;
+    MeasureType                                                st_Value;
+    DerivativeType                                             st_Derivative;
+    SizeValueType                                              st_NumberOfPixelsCounted;
+  };
+
+  struct EvaluationContextType
+  {
+    typename AdvancedTransformType::Pointer                 st_Transform;
+    TransformParametersType                                 st_Parameters;
+    RecursiveBSplineOrder3TransformPointer                  st_RecursiveBSplineTransform;
+    SizeValueType                                           st_NumberOfPixelsCounted;
+    std::vector< EvaluationContextWorkUnitType >            st_WorkUnits;
+    typename ThreaderType::Pointer                          st_Threader;
+    std::vector< std::shared_ptr< EvaluationContextType > > st_MetricContexts;
+  };
+
+  /** Returns true when the metric implements GetValueInContext() and
+   * GetValueAndDerivativeInContext() re-entrantly. Otherwise these functions
+   * are still safe to call from multiple threads, but the evaluations are
+   * serialized and modify the shared transform.
+   */
+  virtual bool GetSupportsReentrantEvaluation( void ) const { return false; }
+
+  /** Initialize a context for GetValueInContext() and
+   * GetValueAndDerivativeInContext(). Call this after Initialize(). The
+   * transform is cloned, so the context has to be initialized again
+   * when the transform is replaced, e.g. at a new resolution. The samples
+   * are divided over numberOfWorkUnits threads of the context's own threader.
+   */
+  virtual void InitializeEvaluationContext( EvaluationContextType & context,
+    ThreadIdType numberOfWorkUnits = 1 ) const;
+
+  /** Re-entrant versions of GetValue() and GetValueAndDerivative(): they do
+   * not change the state of the metric, only the state of the context.
+   * The image sampler is updated under a lock, like GetValue() does. New
+   * samples must therefore only be selected while no context is evaluated,
+   * e.g. by the optimizer in between iterations.
+   * The default implementation serializes GetValue() and GetValueAndDerivative().
+   */
+  virtual MeasureType GetValueInContext(
+    const TransformParametersType & parameters,
+    EvaluationContextType & context ) const;
+
+  virtual void GetValueAndDerivativeInContext(
+    const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative,
+    EvaluationContextType & context ) const;
+
 protected:
 
   /** Constructor. */
@@ -358,6 +459,31 @@ protected:
   typename AdvancedTransformType::Pointer m_AdvancedTransform;
   mutable bool m_TransformIsBSpline;
 
+  /** The specialized sample evaluators. */
+  typedef RecursiveBSplineSampleEvaluator<
+    RecursiveBSplineOrder3TransformType, BSplineInterpolatorType > RecursiveBSplineBSplineInterpolatorSampleEvaluatorType;
+  typedef RecursiveBSplineSampleEvaluator<
+    RecursiveBSplineOrder3TransformType, LinearInterpolatorType >  RecursiveBSplineLinearInterpolatorSampleEvaluatorType;
+  typedef typename RecursiveBSplineBSplineInterpolatorSampleEvaluatorType::MatrixType InitialTransformMatrixType;
+  typedef typename RecursiveBSplineBSplineInterpolatorSampleEvaluatorType::OffsetType InitialTransformOffsetType;
+
+  /** The available sample evaluators. */
+  enum SampleEvaluatorEnum {
+    DefaultSampleEvaluatorId,
+    RecursiveBSplineBSplineInterpolatorSampleEvaluatorId,
+    RecursiveBSplineLinearInterpolatorSampleEvaluatorId
+  };
+
+  /** Variables for the specialized sample evaluation. */
+  SampleEvaluatorEnum                    m_SampleEvaluator;
+  RecursiveBSplineOrder3TransformPointer m_RecursiveBSplineTransform;
+  bool                                   m_UseInitialTransformMatrix;
+  InitialTransformMatrixType             m_InitialTransformMatrix;
+  InitialTransformOffsetType             m_InitialTransformOffset;
+
+  /** The fast lookup of the moving image mask, built in Initialize(). */
+  typename MovingImageMaskLookupType::Pointer m_MovingImageMaskLookup;
+
   /** Variables for the Limiters. */
   FixedImageLimiterPointer     m_FixedImageLimiter;
   MovingImageLimiterPointer    m_MovingImageLimiter;
@@ -458,6 +584,10 @@ protected:
   /** Initialize some multi-threading related parameters. */
   virtual void InitializeThreadingParameters( void ) const;
 
+  /** Serializes the evaluations in the default implementation of
+   * GetValueInContext() and GetValueAndDerivativeInContext(). */
+  mutable std::mutex m_EvaluationContextMutex;
+
   /** Protected methods ************** */
 
   /** Methods for image sampler support **********/
@@ -474,6 +604,21 @@ protected:
   virtual void CheckNumberOfSamples(
     unsigned long wanted, unsigned long found ) const;
 
+  /** Same as CheckNumberOfSamples(), but for the samples counted in the
+   * context; the number of pixels counted by this metric is not touched. */
+  virtual void CheckNumberOfSamplesInContext(
+    unsigned long wanted, const EvaluationContextType & context ) const;
+
+  /** Set the parameters on the private transform of the context. */
+  virtual void SetTransformParametersInContext(
+    const TransformParametersType & parameters,
+    EvaluationContextType & context ) const;
+
+  /** Update the image sampler, for a context evaluation. Several contexts may
+   * call this simultaneously; the update is done by the first of them.
+   */
+  virtual void UpdateImageSamplerInContext( void ) const;
+
   /** Methods for image derivative evaluation support **********/
 
   /** Initialize variables for image derivative computation; this
@@ -486,13 +631,22 @@ protected:
    * If a BSplineInterpolationFunction or AdvacnedLinearInterpolationFunction
    * is used, this class obtains image derivatives from the B-spline or linear
    * interpolator. Otherwise, image derivatives are computed using nearest
-   * neighbor interpolation of a precomputed (central difference) gradient image.
+   * neighbor interpolation of a precomputed (central difference) gradient image,
+   * or by computing the central difference in the nearest voxel directly.
    */
   virtual bool EvaluateMovingImageValueAndDerivative(
     const MovingImagePointType & mappedPoint,
     RealType & movingImageValue,
     MovingImageDerivativeType * gradient ) const;
 
+  /** Compute the central difference gradient of the moving image in a voxel,
+   * in the same way as the GradientImageFilter: with a zero flux Neumann
+   * boundary condition, and taking the spacing and direction into account.
+   */
+  void EvaluateMovingImageCentralDifferenceGradient(
+    const MovingImageIndexType & index,
+    MovingImageDerivativeType & gradient ) const;
+
   /** Computes the inner product of transform Jacobian with moving image gradient.
    * The results are stored in imageJacobian, which is supposed
    * to have the right size (same length as Jacobian's number of columns).
@@ -513,6 +667,137 @@ protected:
   /** Check if the transform is a B-spline. Called by Initialize. */
   virtual void CheckForBSplineTransform( void ) const;
 
+  /** Methods for the specialized sample evaluation **********/
+
+  /** \class DefaultSampleEvaluator
+   * Evaluates the transform and the moving image for a sample, using the
+   * virtual functions TransformPoint() and EvaluateMovingImageValueAndDerivative()
+   * of the metric, and the virtual EvaluateJacobianWithImageGradientProduct()
+   * of the transform. It works for all transforms and interpolators.
+   */
+  class DefaultSampleEvaluator
+  {
+public:
+
+    DefaultSampleEvaluator( const Self * metric ) : m_Metric( metric ) {}
+
+    inline bool TransformPoint( const FixedImagePointType & fixedImagePoint,
+      MovingImagePointType & mappedPoint ) const
+    {
+      return this->m_Metric->TransformPoint( fixedImagePoint, mappedPoint );
+    }
+
+
+    inline bool EvaluateMovingImageValueAndDerivative( const MovingImagePointType & mappedPoint,
+      RealType & movingImageValue, MovingImageDerivativeType * gradient ) const
+    {
+      return this->m_Metric->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, gradient );
+    }
+
+
+    inline void EvaluateJacobianWithImageGradientProduct( const FixedImagePointType & fixedImagePoint,
+      const MovingImageDerivativeType & movingImageDerivative, DerivativeType & imageJacobian,
+      NonZeroJacobianIndicesType & nzji ) const
+    {
+      this->m_Metric->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+        fixedImagePoint, movingImageDerivative, imageJacobian, nzji );
+    }
+
+
+private:
+
+    const Self * m_Metric;
+  };
+
+  /** \class ContextSampleEvaluator
+   * The DefaultSampleEvaluator of an evaluation context: it maps the points
+   * with the private transform of the context, instead of the transform of
+   * the metric. The moving image is evaluated by the metric, as it is shared.
+   */
+  class ContextSampleEvaluator
+  {
+public:
+
+    ContextSampleEvaluator( const Self * metric, const AdvancedTransformType * transform ) :
+      m_Metric( metric ), m_Transform( transform ) {}
+
+    inline bool TransformPoint( const FixedImagePointType & fixedImagePoint,
+      MovingImagePointType & mappedPoint ) const
+    {
+      itkHotPathFineScopedTimerMacro( "Transform::TransformPoint" );
+      mappedPoint = this->m_Transform->TransformPoint( fixedImagePoint );
+      return true;
+    }
+
+
+    inline bool EvaluateMovingImageValueAndDerivative( const MovingImagePointType & mappedPoint,
+      RealType & movingImageValue, MovingImageDerivativeType * gradient ) const
+    {
+      return this->m_Metric->EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, gradient );
+    }
+
+
+    inline void EvaluateJacobianWithImageGradientProduct( const FixedImagePointType & fixedImagePoint,
+      const MovingImageDerivativeType & movingImageDerivative, DerivativeType & imageJacobian,
+      NonZeroJacobianIndicesType & nzji ) const
+    {
+      this->m_Transform->EvaluateJacobianWithImageGradientProduct(
+        fixedImagePoint, movingImageDerivative, imageJacobian, nzji );
+    }
+
+
+private:
+
+    const Self *                  m_Metric;
+    const AdvancedTransformType * m_Transform;
+  };
+
+  /** Select the sample evaluator for the current transform and interpolator.
+   * Called by Initialize, after CheckForBSplineInterpolator() and
+   * CheckForAdvancedTransform().
+   */
+  virtual void CheckForSpecializedSampleEvaluator( void );
+
+  /** Returns whether TransformPoint() or EvaluateMovingImageValueAndDerivative()
+   * is overridden. The specialized sample evaluators do not call these
+   * functions, so they are only used when this returns false. Subclasses that
+   * override one of these functions should override this function as well.
+   */
+  virtual bool GetSampleEvaluationIsOverridden( void ) const
+  {
+    return false;
+  }
+
+
+  /** Call functor( evaluator ) with the sample evaluator that was selected for
+   * this resolution. The functor should have a templated operator(), that
+   * contains the loop over the samples. The default evaluator is used when the
+   * moving image gradient is modified afterwards, by the derivative scales or
+   * the precomputed gradient image.
+   */
+  template< class TFunctor >
+  void CallWithSampleEvaluator( const TFunctor & functor ) const
+  {
+    this->CallWithSelectedSampleEvaluator( functor,
+      this->m_RecursiveBSplineTransform.GetPointer(), DefaultSampleEvaluator( this ) );
+  }
+
+
+  /** The same as CallWithSampleEvaluator(), but the evaluators use the
+   * private transform of the context.
+   */
+  template< class TFunctor >
+  void CallWithSampleEvaluatorInContext( const TFunctor & functor,
+    const EvaluationContextType & context ) const
+  {
+    this->CallWithSelectedSampleEvaluator( functor,
+      context.st_RecursiveBSplineTransform.GetPointer(),
+      ContextSampleEvaluator( this, context.st_Transform.GetPointer() ) );
+  }
+
+
   /** Transform a point from FixedImage domain to MovingImage domain.
    * This function also checks if mapped point is within support region of
    * the transform. It returns true if so, and false otherwise.
@@ -549,6 +834,46 @@ protected:
 
 private:
 
+  /** Implementation of CallWithSampleEvaluator() and
+   * CallWithSampleEvaluatorInContext(), for a given B-spline transform and
+   * default evaluator. The default evaluator is also used when there is no
+   * B-spline transform.
+   */
+  template< class TFunctor, class TDefaultSampleEvaluator >
+  void CallWithSelectedSampleEvaluator( const TFunctor & functor,
+    const RecursiveBSplineOrder3TransformType * bsplineTransform,
+    const TDefaultSampleEvaluator & defaultEvaluator ) const
+  {
+    const SampleEvaluatorEnum id
+      = ( this->GetComputeGradient() || this->m_UseMovingImageDerivativeScales || !bsplineTransform )
+      ? DefaultSampleEvaluatorId : this->m_SampleEvaluator;
+    switch( id )
+    {
+      case RecursiveBSplineBSplineInterpolatorSampleEvaluatorId:
+      {
+        const RecursiveBSplineBSplineInterpolatorSampleEvaluatorType evaluator(
+          bsplineTransform, this->m_BSplineInterpolator,
+          this->m_UseInitialTransformMatrix, this->m_InitialTransformMatrix, this->m_InitialTransformOffset );
+        functor( evaluator );
+        break;
+      }
+      case RecursiveBSplineLinearInterpolatorSampleEvaluatorId:
+      {
+        const RecursiveBSplineLinearInterpolatorSampleEvaluatorType evaluator(
+          bsplineTransform, this->m_LinearInterpolator,
+          this->m_UseInitialTransformMatrix, this->m_InitialTransformMatrix, this->m_InitialTransformOffset );
+        functor( evaluator );
+        break;
+      }
+      default:
+      {
+        functor( defaultEvaluator );
+        break;
+      }
+    }
+  }
+
+
   AdvancedImageToImageMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );             // purposely not implemented
 
@@ -559,6 +884,8 @@ private:
   double m_RequiredRatioOfValidSamples;
   bool   m_UseMovingImageDerivativeScales;
   bool   m_ScaleGradientWithRespectToMovingImageOrientation;
+  bool   m_UseSpecializedSampleEvaluator;
+  bool   m_PrecomputeMovingImageGradient;
 
   MovingImageDerivativeScalesType m_MovingImageDerivativeScales;
 
@@ -28,6 +28,7 @@
 #endif
 
 #include "itkTimeProbe.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -65,10 +66,18 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   this->m_AdvancedTransform                                = nullptr;
   this->m_TransformIsAdvanced                              = false;
   this->m_TransformIsBSpline                               = false;
+  this->m_SampleEvaluator                                  = DefaultSampleEvaluatorId;
+  this->m_RecursiveBSplineTransform                        = nullptr;
+  this->m_UseInitialTransformMatrix                        = false;
+  this->m_InitialTransformMatrix.SetIdentity();
+  this->m_InitialTransformOffset.Fill( 0.0 );
+  this->m_UseSpecializedSampleEvaluator                    = true;
+  this->m_PrecomputeMovingImageGradient                    = true;
   this->m_UseMovingImageDerivativeScales                   = false;
   this->m_ScaleGradientWithRespectToMovingImageOrientation = false;
   this->m_MovingImageDerivativeScales.Fill( 1.0 );
 
+  this->m_MovingImageMaskLookup = MovingImageMaskLookupType::New();
   this->m_FixedImageLimiter     = nullptr;
   this->m_MovingImageLimiter    = nullptr;
   this->m_UseFixedImageLimiter  = false;
@@ -161,6 +170,10 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   /** Connect the image sampler */
   this->InitializeImageSampler();
 
+  /** Build the fast lookup of the moving image mask. */
+  this->m_MovingImageMaskLookup->SetMask( this->m_MovingImageMask );
+  this->m_MovingImageMaskLookup->Update();
+
   /** Check if the interpolator is a B-spline interpolator. */
   this->CheckForBSplineInterpolator();
 
@@ -170,6 +183,9 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   /** Check if the transform is a B-spline transform. */
   this->CheckForBSplineTransform();
 
+  /** Select the evaluator for the samples. */
+  this->CheckForSpecializedSampleEvaluator();
+
   /** Initialize some threading related parameters. */
   if( this->m_UseMultiThread )
   {
@@ -479,7 +495,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
     if( !this->m_InterpolatorIsBSpline && !this->m_InterpolatorIsBSplineFloat
       && !this->m_InterpolatorIsReducedBSpline
       && !this->m_InterpolatorIsLinear
-      && !interpolatorIsRayCast )
+      && !interpolatorIsRayCast
+      && this->m_PrecomputeMovingImageGradient )
     {
       this->m_CentralDifferenceGradientFilter = CentralDifferenceGradientFilterType::New();
       this->m_CentralDifferenceGradientFilter->SetUseImageSpacing( true );
@@ -574,6 +591,93 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end CheckForBSplineTransform()
 
 
+/**
+ * ****************** CheckForSpecializedSampleEvaluator **********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::CheckForSpecializedSampleEvaluator( void )
+{
+  this->m_SampleEvaluator           = DefaultSampleEvaluatorId;
+  this->m_RecursiveBSplineTransform = nullptr;
+  this->m_UseInitialTransformMatrix = false;
+  this->m_InitialTransformMatrix.SetIdentity();
+  this->m_InitialTransformOffset.Fill( 0.0 );
+
+  if( !this->m_UseSpecializedSampleEvaluator || this->GetSampleEvaluationIsOverridden()
+    || FixedImageDimension != MovingImageDimension
+    || ( !this->m_InterpolatorIsBSpline && !this->m_InterpolatorIsLinear ) )
+  {
+    return;
+  }
+
+  /** Check if the transform is a recursive B-spline transform of order 3,
+   * possibly as the current transform of a combination transform, that is
+   * composed with a linear initial transform.
+   */
+  const AdvancedTransformType * initialTransform = nullptr;
+  RecursiveBSplineOrder3TransformType * bsplineTransform
+    = dynamic_cast< RecursiveBSplineOrder3TransformType * >( this->m_AdvancedTransform.GetPointer() );
+  CombinationTransformType * combinationTransform
+    = dynamic_cast< CombinationTransformType * >( this->m_AdvancedTransform.GetPointer() );
+  if( !bsplineTransform && combinationTransform )
+  {
+    bsplineTransform = dynamic_cast< RecursiveBSplineOrder3TransformType * >(
+      combinationTransform->GetModifiableCurrentTransform() );
+    initialTransform = combinationTransform->GetModifiableInitialTransform();
+    if( initialTransform && !combinationTransform->GetUseComposition() )
+    {
+      bsplineTransform = nullptr;
+    }
+  }
+  if( !bsplineTransform || ( initialTransform && !initialTransform->IsLinear() ) )
+  {
+    itkDebugMacro( "No specialized sample evaluator for this transform" );
+    return;
+  }
+
+  /** A linear transform is described by its matrix and offset:
+   * T0(x) = A x + b, with b = T0(0) and the columns of A: A e_j = T0(e_j) - b.
+   */
+  if( initialTransform )
+  {
+    FixedImagePointType point;
+    point.Fill( 0.0 );
+    const MovingImagePointType origin = initialTransform->TransformPoint( point );
+    for( unsigned int j = 0; j < FixedImageDimension; ++j )
+    {
+      point.Fill( 0.0 );
+      point[ j ] = 1.0;
+      const MovingImagePointType mappedPoint = initialTransform->TransformPoint( point );
+      for( unsigned int i = 0; i < FixedImageDimension; ++i )
+      {
+        this->m_InitialTransformMatrix( i, j ) = mappedPoint[ i ] - origin[ i ];
+      }
+    }
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      this->m_InitialTransformOffset[ i ] = origin[ i ];
+    }
+    this->m_UseInitialTransformMatrix = true;
+  }
+
+  this->m_RecursiveBSplineTransform = bsplineTransform;
+  if( this->m_InterpolatorIsBSpline )
+  {
+    this->m_SampleEvaluator = RecursiveBSplineBSplineInterpolatorSampleEvaluatorId;
+    itkDebugMacro( "Using the recursive B-spline / B-spline interpolator sample evaluator" );
+  }
+  else
+  {
+    this->m_SampleEvaluator = RecursiveBSplineLinearInterpolatorSampleEvaluatorId;
+    itkDebugMacro( "Using the recursive B-spline / linear interpolator sample evaluator" );
+  }
+
+} // end CheckForSpecializedSampleEvaluator()
+
+
 /**
  * ******************* EvaluateMovingImageValueAndDerivative ******************
  */
@@ -586,6 +690,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   RealType & movingImageValue,
   MovingImageDerivativeType * gradient ) const
 {
+  itkHotPathFineScopedTimerMacro( "Interpolator::EvaluateValueAndDerivative" );
+
   /** Check if mapped point inside image buffer. */
   MovingImageContinuousIndexType cindex;
   this->m_Interpolator->ConvertPointToContinuousIndex( mappedPoint, cindex );
@@ -623,8 +729,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
       }
       else
       {
-        /** Get the gradient by NearestNeighboorInterpolation of the gradient image.
-         * It is assumed that the gradient image is computed.
+        /** Get the gradient by NearestNeighboorInterpolation of the gradient image,
+         * if it is computed. Otherwise the central difference is computed here.
          */
         movingImageValue = this->m_Interpolator->EvaluateAtContinuousIndex( cindex );
         MovingImageIndexType index;
@@ -632,7 +738,14 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
         {
           index[ j ] = static_cast< long >( Math::Round< double >( cindex[ j ] ) );
         }
-        ( *gradient ) = this->m_GradientImage->GetPixel( index );
+        if( this->m_GradientImage.IsNotNull() )
+        {
+          ( *gradient ) = this->m_GradientImage->GetPixel( index );
+        }
+        else
+        {
+          this->EvaluateMovingImageCentralDifferenceGradient( index, *gradient );
+        }
       }
 
       /** The moving image gradient is multiplied with its scales, when requested. */
@@ -686,6 +799,48 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end EvaluateMovingImageValueAndDerivative()
 
 
+/**
+ * *************** EvaluateMovingImageCentralDifferenceGradient ****************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateMovingImageCentralDifferenceGradient(
+  const MovingImageIndexType & index,
+  MovingImageDerivativeType & gradient ) const
+{
+  typedef typename MovingImageIndexType::IndexValueType IndexValueType;
+
+  const MovingImageType *                     movingImage = this->m_MovingImage;
+  const typename MovingImageType::RegionType  region      = movingImage->GetBufferedRegion();
+  const typename MovingImageType::SpacingType spacing     = movingImage->GetSpacing();
+
+  /** Compute the central difference along each image axis. At the border of
+   * the buffer the neighbour outside is replaced by the voxel itself, which is
+   * the zero flux Neumann boundary condition of the GradientImageFilter.
+   */
+  MovingImageDerivativeType localGradient;
+  for( unsigned int j = 0; j < MovingImageDimension; ++j )
+  {
+    const IndexValueType first = region.GetIndex()[ j ];
+    const IndexValueType last  = first + static_cast< IndexValueType >( region.GetSize()[ j ] ) - 1;
+
+    MovingImageIndexType lower = index;
+    MovingImageIndexType upper = index;
+    lower[ j ] = std::max( first, std::min( last, index[ j ] - 1 ) );
+    upper[ j ] = std::max( first, std::min( last, index[ j ] + 1 ) );
+
+    localGradient[ j ] = ( static_cast< RealType >( movingImage->GetPixel( upper ) )
+      - static_cast< RealType >( movingImage->GetPixel( lower ) ) ) / ( 2.0 * spacing[ j ] );
+  }
+
+  /** Take the image direction into account, like the GradientImageFilter. */
+  movingImage->TransformLocalVectorToPhysicalVector( localGradient, gradient );
+
+} // end EvaluateMovingImageCentralDifferenceGradient()
+
+
 /**
  * *************** EvaluateTransformJacobianInnerProduct ****************
  */
@@ -760,6 +915,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   const FixedImagePointType & fixedImagePoint,
   MovingImagePointType & mappedPoint ) const
 {
+  itkHotPathFineScopedTimerMacro( "Transform::TransformPoint" );
+
   mappedPoint = this->m_Transform->TransformPoint( fixedImagePoint );
 
   /** For future use: return whether the sample is valid */
@@ -781,6 +938,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   TransformJacobianType & jacobian,
   NonZeroJacobianIndicesType & nzji ) const
 {
+  itkHotPathFineScopedTimerMacro( "Transform::GetJacobian" );
+
   /** Advanced transform: generic sparse Jacobian support */
   this->m_AdvancedTransform->GetJacobian(
     fixedImagePoint, jacobian, nzji );
@@ -801,9 +960,15 @@ bool
 AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::IsInsideMovingMask( const MovingImagePointType & point ) const
 {
-  /** If a mask has been set: */
+  /** If a mask has been set, use its fast lookup, unless the mask
+   * was replaced after Initialize().
+   */
   if( this->m_MovingImageMask.IsNotNull() )
   {
+    if( this->m_MovingImageMaskLookup->GetMask() == this->m_MovingImageMask.GetPointer() )
+    {
+      return this->m_MovingImageMaskLookup->IsInside( point );
+    }
     return this->m_MovingImageMask->IsInsideInWorldSpace( point );
   }
 
@@ -861,6 +1026,167 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end BeforeThreadedGetValueAndDerivative()
 
 
+/**
+ * *********************** InitializeEvaluationContext ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeEvaluationContext( EvaluationContextType & context,
+  ThreadIdType numberOfWorkUnits ) const
+{
+  if( this->m_AdvancedTransform.IsNull() )
+  {
+    itkExceptionMacro( << "No AdvancedTransform has been set. Call Initialize() first." );
+  }
+
+  /** Only the re-entrant implementations need a private transform. */
+  context.st_Transform                 = nullptr;
+  context.st_RecursiveBSplineTransform = nullptr;
+  context.st_Threader                  = nullptr;
+  context.st_MetricContexts.clear();
+  if( this->GetSupportsReentrantEvaluation() )
+  {
+    typename AdvancedTransformType::TransformTypePointer clone
+      = this->m_AdvancedTransform->Clone();
+    context.st_Transform = dynamic_cast< AdvancedTransformType * >( clone.GetPointer() );
+    if( context.st_Transform.IsNull() )
+    {
+      itkExceptionMacro( << "The transform ("
+                         << this->m_AdvancedTransform->GetNameOfClass()
+                         << ") could not be cloned." );
+    }
+
+    /** Let the clone use the parameters owned by the context. */
+    this->SetTransformParametersInContext( this->m_AdvancedTransform->GetParameters(), context );
+
+    /** The specialized sample evaluator needs the B-spline of the clone,
+     * found in the same way as by CheckForSpecializedSampleEvaluator(). */
+    if( this->m_SampleEvaluator != DefaultSampleEvaluatorId )
+    {
+      context.st_RecursiveBSplineTransform
+        = dynamic_cast< RecursiveBSplineOrder3TransformType * >( context.st_Transform.GetPointer() );
+      CombinationTransformType * combinationTransform
+        = dynamic_cast< CombinationTransformType * >( context.st_Transform.GetPointer() );
+      if( context.st_RecursiveBSplineTransform.IsNull() && combinationTransform )
+      {
+        context.st_RecursiveBSplineTransform = dynamic_cast< RecursiveBSplineOrder3TransformType * >(
+          combinationTransform->GetModifiableCurrentTransform() );
+      }
+    }
+  }
+
+  /** Each context has its own threader, since a threader cannot be used
+   * by several threads simultaneously. The threader may limit the number
+   * of work units. */
+  if( numberOfWorkUnits > 1 && this->GetSupportsReentrantEvaluation() )
+  {
+    context.st_Threader = ThreaderType::New();
+    context.st_Threader->SetNumberOfWorkUnits( numberOfWorkUnits );
+    numberOfWorkUnits = context.st_Threader->GetNumberOfWorkUnits();
+  }
+  numberOfWorkUnits = std::max( numberOfWorkUnits, static_cast< ThreadIdType >( 1 ) );
+
+  /** Allocate the scratch buffers and partial results of the work units. */
+  const NumberOfParametersType nnzji
+    = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  context.st_WorkUnits.resize( numberOfWorkUnits );
+  for( ThreadIdType i = 0; i < numberOfWorkUnits; ++i )
+  {
+    EvaluationContextWorkUnitType & workUnit = context.st_WorkUnits[ i ];
+    workUnit.st_NonZeroJacobianIndices.resize( nnzji );
+    workUnit.st_ImageJacobian.SetSize( nnzji );
+    workUnit.st_Derivative.SetSize( this->GetNumberOfParameters() );
+    workUnit.st_Value                 = NumericTraits< MeasureType >::Zero;
+    workUnit.st_NumberOfPixelsCounted = 0;
+  }
+  context.st_NumberOfPixelsCounted = 0;
+
+} // end InitializeEvaluationContext()
+
+
+/**
+ * *********************** SetTransformParametersInContext ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::SetTransformParametersInContext(
+  const TransformParametersType & parameters,
+  EvaluationContextType & context ) const
+{
+  /** Some transforms, such as the B-spline, store a pointer to the parameters,
+   * so first copy them to the context. */
+  context.st_Parameters = parameters;
+  context.st_Transform->SetParameters( context.st_Parameters );
+
+} // end SetTransformParametersInContext()
+
+
+/**
+ * *********************** UpdateImageSamplerInContext ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateImageSamplerInContext( void ) const
+{
+  /** The sampler only does something when its input or settings were
+   * modified since its last update, which is not re-entrant. */
+  if( this->m_UseImageSampler )
+  {
+    std::lock_guard< std::mutex > lock( this->m_EvaluationContextMutex );
+    this->GetImageSampler()->Update();
+  }
+
+} // end UpdateImageSamplerInContext()
+
+
+/**
+ * *********************** GetValueInContext ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename AdvancedImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueInContext(
+  const TransformParametersType & parameters,
+  EvaluationContextType & context ) const
+{
+  /** This metric has no re-entrant implementation: serialize. */
+  std::lock_guard< std::mutex > lock( this->m_EvaluationContextMutex );
+
+  const MeasureType value = this->GetValue( parameters );
+  context.st_NumberOfPixelsCounted = this->m_NumberOfPixelsCounted;
+  return value;
+
+} // end GetValueInContext()
+
+
+/**
+ * *********************** GetValueAndDerivativeInContext ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivativeInContext(
+  const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative,
+  EvaluationContextType & context ) const
+{
+  /** This metric has no re-entrant implementation: serialize. */
+  std::lock_guard< std::mutex > lock( this->m_EvaluationContextMutex );
+
+  this->GetValueAndDerivative( parameters, value, derivative );
+  context.st_NumberOfPixelsCounted = this->m_NumberOfPixelsCounted;
+
+} // end GetValueAndDerivativeInContext()
+
+
 /**
  * **************** GetValueThreaderCallback *******
  */
@@ -876,6 +1202,7 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   MultiThreaderParameterType * temp
     = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
 
+  itkHotPathScopedTimerMacro( "Metric::ThreadedGetValue" );
   temp->st_Metric->ThreadedGetValue( threadID );
 
   return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
@@ -917,6 +1244,7 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   MultiThreaderParameterType * temp
     = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
 
+  itkHotPathScopedTimerMacro( "Metric::ThreadedGetValueAndDerivative" );
   temp->st_Metric->ThreadedGetValueAndDerivative( threadID );
 
   return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
@@ -959,6 +1287,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   MultiThreaderParameterType * temp
     = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
 
+  itkHotPathScopedTimerMacro( "Metric::AccumulateDerivatives" );
+
   const unsigned int numPar  = temp->st_Metric->GetNumberOfParameters();
   const unsigned int subSize = static_cast< unsigned int >(
     std::ceil( static_cast< double >( numPar )
@@ -1000,6 +1330,9 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 ::CheckNumberOfSamples(
   unsigned long wanted, unsigned long found ) const
 {
+  itkHotPathCounterMacro( "Metric::NumberOfSamples", wanted );
+  itkHotPathCounterMacro( "Metric::NumberOfValidSamples", found );
+
   this->m_NumberOfPixelsCounted = found;
   if( found < wanted * this->GetRequiredRatioOfValidSamples() )
   {
@@ -1010,6 +1343,26 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
 } // end CheckNumberOfSamples()
 
 
+/**
+ * *********************** CheckNumberOfSamplesInContext ***********************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedImageToImageMetric< TFixedImage, TMovingImage >
+::CheckNumberOfSamplesInContext(
+  unsigned long wanted, const EvaluationContextType & context ) const
+{
+  const SizeValueType found = context.st_NumberOfPixelsCounted;
+  if( found < wanted * this->GetRequiredRatioOfValidSamples() )
+  {
+    itkExceptionMacro( "Too many samples map outside moving image buffer: "
+        << found << " / " << wanted << std::endl );
+  }
+
+} // end CheckNumberOfSamplesInContext()
+
+
 /**
  * ********************* PrintSelf ****************************
  */
@@ -1069,6 +1422,8 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
      << this->m_InterpolatorIsBSplineFloat << std::endl;
   os << indent.GetNextIndent() << "BSplineInterpolatorFloat: "
      << this->m_BSplineInterpolatorFloat.GetPointer() << std::endl;
+  os << indent.GetNextIndent() << "PrecomputeMovingImageGradient: "
+     << this->m_PrecomputeMovingImageGradient << std::endl;
   os << indent.GetNextIndent() << "CentralDifferenceGradientFilter: "
      << this->m_CentralDifferenceGradientFilter.GetPointer() << std::endl;
 
@@ -1079,6 +1434,17 @@ AdvancedImageToImageMetric< TFixedImage, TMovingImage >
   os << indent.GetNextIndent() << "AdvancedTransform: "
      << this->m_AdvancedTransform.GetPointer() << std::endl;
 
+  /** Variables for the specialized sample evaluation. */
+  os << indent << "Variables for the specialized sample evaluation: " << std::endl;
+  os << indent.GetNextIndent() << "UseSpecializedSampleEvaluator: "
+     << this->m_UseSpecializedSampleEvaluator << std::endl;
+  os << indent.GetNextIndent() << "SampleEvaluator: "
+     << this->m_SampleEvaluator << std::endl;
+  os << indent.GetNextIndent() << "RecursiveBSplineTransform: "
+     << this->m_RecursiveBSplineTransform.GetPointer() << std::endl;
+  os << indent.GetNextIndent() << "UseInitialTransformMatrix: "
+     << this->m_UseInitialTransformMatrix << std::endl;
+
   /** Other variables. */
   os << indent << "Other variables of the AdvancedImageToImageMetric: " << std::endl;
   os << indent.GetNextIndent() << "RequiredRatioOfValidSamples: "
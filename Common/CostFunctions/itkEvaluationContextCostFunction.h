@@ -0,0 +1,122 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkEvaluationContextCostFunction_h
+#define __itkEvaluationContextCostFunction_h
+
+#include "itkSingleValuedCostFunction.h"
+
+namespace itk
+{
+
+/** \class EvaluationContextCostFunction
+ * \brief A cost function that evaluates an AdvancedImageToImageMetric
+ * re-entrantly, using its own evaluation context.
+ *
+ * Several of these cost functions may share a single metric instance, and
+ * may be evaluated simultaneously, each by its own thread. This is useful
+ * for optimizers that evaluate several parameter vectors at once, such as
+ * the CMAEvolutionStrategyOptimizer. The metric must have been initialized
+ * before SetMetric() is called.
+ *
+ * \sa AdvancedImageToImageMetric::GetValueInContext()
+ * \ingroup RegistrationMetrics
+ */
+
+template< class TMetric >
+class EvaluationContextCostFunction :
+  public SingleValuedCostFunction
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef EvaluationContextCostFunction Self;
+  typedef SingleValuedCostFunction      Superclass;
+  typedef SmartPointer< Self >          Pointer;
+  typedef SmartPointer< const Self >    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( EvaluationContextCostFunction, SingleValuedCostFunction );
+
+  /** Typedefs inherited from the superclass. */
+  typedef Superclass::MeasureType    MeasureType;
+  typedef Superclass::DerivativeType DerivativeType;
+  typedef Superclass::ParametersType ParametersType;
+
+  /** Typedefs for the metric. */
+  typedef TMetric                                      MetricType;
+  typedef typename MetricType::ConstPointer            MetricConstPointer;
+  typedef typename MetricType::EvaluationContextType   EvaluationContextType;
+
+  /** Set the metric, and initialize the evaluation context. */
+  virtual void SetMetric( const MetricType * metric );
+
+  /** Set/Get the number of work units over which the context divides the
+   * samples. Set it before SetMetric(). Default: 1, for cost functions that
+   * are themselves evaluated by several threads simultaneously.
+   */
+  itkSetMacro( NumberOfWorkUnits, ThreadIdType );
+  itkGetConstMacro( NumberOfWorkUnits, ThreadIdType );
+
+  /** Get the metric. */
+  itkGetConstObjectMacro( Metric, MetricType );
+
+  /** Return the measure, using the evaluation context. */
+  MeasureType GetValue( const ParametersType & parameters ) const override;
+
+  /** Return the derivative, using the evaluation context. */
+  void GetDerivative( const ParametersType & parameters,
+    DerivativeType & derivative ) const override;
+
+  /** Return the measure and derivative, using the evaluation context. */
+  void GetValueAndDerivative( const ParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative ) const override;
+
+  /** Return the number of parameters of the metric. */
+  unsigned int GetNumberOfParameters( void ) const override;
+
+protected:
+
+  EvaluationContextCostFunction();
+  ~EvaluationContextCostFunction() override {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  EvaluationContextCostFunction( const Self & ); // purposely not implemented
+  void operator=( const Self & );                // purposely not implemented
+
+  MetricConstPointer m_Metric;
+  ThreadIdType       m_NumberOfWorkUnits;
+
+  /** The context is modified by the const Get functions. */
+  mutable EvaluationContextType m_EvaluationContext;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkEvaluationContextCostFunction.hxx"
+#endif
+
+#endif // end #ifndef __itkEvaluationContextCostFunction_h
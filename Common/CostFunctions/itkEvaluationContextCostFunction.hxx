@@ -0,0 +1,155 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkEvaluationContextCostFunction_hxx
+#define __itkEvaluationContextCostFunction_hxx
+
+#include "itkEvaluationContextCostFunction.h"
+
+namespace itk
+{
+
+/**
+ * ********************* Constructor ****************************
+ */
+
+template< class TMetric >
+EvaluationContextCostFunction< TMetric >
+::EvaluationContextCostFunction()
+{
+  this->m_Metric            = nullptr;
+  this->m_NumberOfWorkUnits = 1;
+
+} // end Constructor
+
+
+/**
+ * ********************* SetMetric ****************************
+ */
+
+template< class TMetric >
+void
+EvaluationContextCostFunction< TMetric >
+::SetMetric( const MetricType * metric )
+{
+  this->m_Metric = metric;
+  if( metric != nullptr )
+  {
+    metric->InitializeEvaluationContext( this->m_EvaluationContext, this->m_NumberOfWorkUnits );
+  }
+  this->Modified();
+
+} // end SetMetric()
+
+
+/**
+ * ********************* GetValue ****************************
+ */
+
+template< class TMetric >
+typename EvaluationContextCostFunction< TMetric >::MeasureType
+EvaluationContextCostFunction< TMetric >
+::GetValue( const ParametersType & parameters ) const
+{
+  if( this->m_Metric.IsNull() )
+  {
+    itkExceptionMacro( << "No metric has been set." );
+  }
+
+  return this->m_Metric->GetValueInContext( parameters, this->m_EvaluationContext );
+
+} // end GetValue()
+
+
+/**
+ * ********************* GetDerivative ****************************
+ */
+
+template< class TMetric >
+void
+EvaluationContextCostFunction< TMetric >
+::GetDerivative(
+  const ParametersType & parameters,
+  DerivativeType & derivative ) const
+{
+  MeasureType dummyvalue = NumericTraits< MeasureType >::Zero;
+  this->GetValueAndDerivative( parameters, dummyvalue, derivative );
+
+} // end GetDerivative()
+
+
+/**
+ * ********************* GetValueAndDerivative ****************************
+ */
+
+template< class TMetric >
+void
+EvaluationContextCostFunction< TMetric >
+::GetValueAndDerivative(
+  const ParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative ) const
+{
+  if( this->m_Metric.IsNull() )
+  {
+    itkExceptionMacro( << "No metric has been set." );
+  }
+
+  this->m_Metric->GetValueAndDerivativeInContext(
+    parameters, value, derivative, this->m_EvaluationContext );
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ********************* GetNumberOfParameters ****************************
+ */
+
+template< class TMetric >
+unsigned int
+EvaluationContextCostFunction< TMetric >
+::GetNumberOfParameters( void ) const
+{
+  if( this->m_Metric.IsNull() )
+  {
+    itkExceptionMacro( << "No metric has been set." );
+  }
+
+  return this->m_Metric->GetNumberOfParameters();
+
+} // end GetNumberOfParameters()
+
+
+/**
+ * ********************* PrintSelf ****************************
+ */
+
+template< class TMetric >
+void
+EvaluationContextCostFunction< TMetric >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Metric: " << this->m_Metric.GetPointer() << std::endl;
+  os << indent << "NumberOfWorkUnits: " << this->m_NumberOfWorkUnits << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkEvaluationContextCostFunction_hxx
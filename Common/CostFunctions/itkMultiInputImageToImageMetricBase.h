@@ -352,6 +352,15 @@ protected:
     RealType & movingImageValue,
     MovingImageDerivativeType * gradient ) const override;
 
+  /** EvaluateMovingImageValueAndDerivative() is overridden, so the specialized
+   * sample evaluators are not used.
+   */
+  bool GetSampleEvaluationIsOverridden( void ) const override
+  {
+    return true;
+  }
+
+
   /** IsInsideMovingMask: Returns the AND of all moving image masks. */
   bool IsInsideMovingMask(
     const MovingImagePointType & mappedPoint ) const override;
@@ -258,6 +258,19 @@ protected:
   typedef JointPDFDerivativesType::RegionType          JointPDFDerivativesRegionType;
   typedef JointPDFDerivativesType::SizeType            JointPDFDerivativesSizeType;
   typedef IncrementalMarginalPDFType::IndexType        IncrementalMarginalPDFIndexType;
+
+  /** Typedefs for the per-thread joint PDFs. When elastix is built with
+   * ELASTIX_USE_SINGLE_PRECISION_ACCUMULATORS, the threads fill a float
+   * histogram, halving the memory traffic of the Parzen window updates.
+   * The reduction over the threads is always done in PDFValueType.
+   */
+#ifdef ELASTIX_USE_SINGLE_PRECISION_ACCUMULATORS
+  typedef float PerThreadPDFValueType;
+#else
+  typedef PDFValueType PerThreadPDFValueType;
+#endif
+  typedef Image< PerThreadPDFValueType, 2 >       PerThreadJointPDFType;
+  typedef typename PerThreadJointPDFType::Pointer PerThreadJointPDFPointer;
   typedef IncrementalMarginalPDFType::RegionType       IncrementalMarginalPDFRegionType;
   typedef IncrementalMarginalPDFType::SizeType         IncrementalMarginalPDFSizeType;
   typedef Array< PDFValueType >                        ParzenValueContainerType;
@@ -311,8 +324,8 @@ protected:
 
   struct ParzenWindowHistogramGetValueAndDerivativePerThreadStruct
   {
-    SizeValueType   st_NumberOfPixelsCounted;
-    JointPDFPointer st_JointPDF;
+    SizeValueType            st_NumberOfPixelsCounted;
+    PerThreadJointPDFPointer st_JointPDF;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, ParzenWindowHistogramGetValueAndDerivativePerThreadStruct,
     PaddedParzenWindowHistogramGetValueAndDerivativePerThreadStruct );
@@ -327,6 +340,11 @@ protected:
   /** Multi-threaded versions of the ComputePDF function. */
   inline void ThreadedComputePDFs( ThreadIdType threadId );
 
+  /** Multi-threaded versions of the ComputePDF function, using the given sample evaluator. */
+  template< class TSampleEvaluator >
+  inline void ThreadedComputePDFsWithEvaluator(
+    ThreadIdType threadId, const TSampleEvaluator & evaluator );
+
   /** Single-threadedly accumulate results. */
   inline void AfterThreadedComputePDFs( void ) const;
 
@@ -357,6 +375,16 @@ protected:
     const NonZeroJacobianIndicesType * nzji,
     JointPDFType * jointPDF ) const;
 
+  /** Update the joint PDF with a pixel pair, without pdf derivatives.
+   * Templated over the joint PDF type, so that it can also be used to fill
+   * the (possibly single precision) per-thread joint PDFs.
+   */
+  template< class TJointPDF >
+  void UpdateJointPDF(
+    const RealType & fixedImageValue,
+    const RealType & movingImageValue,
+    TJointPDF * jointPDF ) const;
+
   /** Update the joint PDF and the incremental pdfs.
    * The input is a pixel pair (fixed, moving, moving mask) and
    * a set of moving image/mask values when using mu+delta*e_k, for
@@ -488,6 +516,19 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                          // purposely not implemented
 
+  /** Calls ThreadedComputePDFsWithEvaluator(), for CallWithSampleEvaluator(). */
+  struct ThreadedComputePDFsFunctor
+  {
+    Self *       m_Metric;
+    ThreadIdType m_ThreadId;
+
+    template< class TSampleEvaluator >
+    void operator()( const TSampleEvaluator & evaluator ) const
+    {
+      this->m_Metric->ThreadedComputePDFsWithEvaluator( this->m_ThreadId, evaluator );
+    }
+  };
+
   /** Variables that can/should be accessed by their Set/Get functions. */
   unsigned long m_NumberOfFixedHistogramBins;
   unsigned long m_NumberOfMovingHistogramBins;
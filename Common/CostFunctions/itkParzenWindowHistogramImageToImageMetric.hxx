@@ -488,8 +488,8 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
 
     // Initialize the joint pdf
-    JointPDFPointer & jointPDF = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF;
-    if( jointPDF.IsNull() ) { jointPDF = JointPDFType::New(); }
+    PerThreadJointPDFPointer & jointPDF = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF;
+    if( jointPDF.IsNull() ) { jointPDF = PerThreadJointPDFType::New(); }
     if( jointPDF->GetLargestPossibleRegion() != jointPDFRegion )
     {
       jointPDF->SetRegions( jointPDFRegion );
@@ -554,6 +554,69 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 } // end EvaluateParzenValues()
 
 
+/**
+ * ********************** UpdateJointPDF ***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TJointPDF >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateJointPDF(
+  const RealType & fixedImageValue,
+  const RealType & movingImageValue,
+  TJointPDF * jointPDF ) const
+{
+  typedef typename TJointPDF::PixelType      JointPDFValueType;
+  typedef ImageScanlineIterator< TJointPDF > PDFIteratorType;
+
+  /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
+  const double fixedImageParzenWindowTerm
+    = fixedImageValue / this->m_FixedImageBinSize - this->m_FixedImageNormalizedMin;
+  const double movingImageParzenWindowTerm
+    = movingImageValue / this->m_MovingImageBinSize - this->m_MovingImageNormalizedMin;
+
+  /** The lowest bin numbers affected by this pixel: */
+  const OffsetValueType fixedImageParzenWindowIndex
+    = static_cast< OffsetValueType >( std::floor(
+    fixedImageParzenWindowTerm + this->m_FixedParzenTermToIndexOffset ) );
+  const OffsetValueType movingImageParzenWindowIndex
+    = static_cast< OffsetValueType >( std::floor(
+    movingImageParzenWindowTerm + this->m_MovingParzenTermToIndexOffset ) );
+
+  /** The Parzen values. */
+  ParzenValueContainerType fixedParzenValues( this->m_JointPDFWindow.GetSize()[ 1 ] );
+  ParzenValueContainerType movingParzenValues( this->m_JointPDFWindow.GetSize()[ 0 ] );
+  this->EvaluateParzenValues(
+    fixedImageParzenWindowTerm, fixedImageParzenWindowIndex,
+    this->m_FixedKernel, fixedParzenValues );
+  this->EvaluateParzenValues(
+    movingImageParzenWindowTerm, movingImageParzenWindowIndex,
+    this->m_MovingKernel, movingParzenValues );
+
+  /** Position the JointPDFWindow, using a local copy for thread-safety. */
+  JointPDFIndexType pdfWindowIndex;
+  pdfWindowIndex[ 0 ] = movingImageParzenWindowIndex;
+  pdfWindowIndex[ 1 ] = fixedImageParzenWindowIndex;
+  JointPDFRegionType jointPDFWindow = this->m_JointPDFWindow;
+  jointPDFWindow.SetIndex( pdfWindowIndex );
+  PDFIteratorType it( jointPDF, jointPDFWindow );
+
+  /** Loop over the Parzen window region and increment the values. */
+  for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
+  {
+    const double fv = fixedParzenValues[ f ];
+    for( unsigned int m = 0; m < movingParzenValues.GetSize(); ++m )
+    {
+      it.Value() += static_cast< JointPDFValueType >( fv * movingParzenValues[ m ] );
+      ++it;
+    }
+    it.NextLine();
+  }
+
+} // end UpdateJointPDF()
+
+
 /**
  * ********************** UpdateJointPDFAndDerivatives ***************
  */
@@ -568,6 +631,12 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   const NonZeroJacobianIndicesType * nzji,
   JointPDFType * jointPDF ) const
 {
+  if( !imageJacobian )
+  {
+    this->UpdateJointPDF( fixedImageValue, movingImageValue, jointPDF );
+    return;
+  }
+
   typedef ImageScanlineIterator< JointPDFType > PDFIteratorType;
 
   /** Determine Parzen window arguments (see eq. 6 of Mattes paper [2]). */
@@ -606,48 +675,31 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   jointPDFWindow.SetIndex( pdfWindowIndex );
   PDFIteratorType it( jointPDF, jointPDFWindow );
 
-  if( !imageJacobian )
-  {
-    /** Loop over the Parzen window region and increment the values. */
-    for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
-    {
-      const double fv = fixedParzenValues[ f ];
-      for( unsigned int m = 0; m < movingParzenValues.GetSize(); ++m )
-      {
-        it.Value() += static_cast< PDFValueType >( fv * movingParzenValues[ m ] );
-        ++it;
-      }
-      it.NextLine();
-    }
-  }
-  else
-  {
-    /** Compute the derivatives of the moving Parzen window. */
-    ParzenValueContainerType derivativeMovingParzenValues(
-    this->m_JointPDFWindow.GetSize()[ 0 ] );
-    this->EvaluateParzenValues(
-      movingImageParzenWindowTerm, movingImageParzenWindowIndex,
-      this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
+  /** Compute the derivatives of the moving Parzen window. */
+  ParzenValueContainerType derivativeMovingParzenValues(
+  this->m_JointPDFWindow.GetSize()[ 0 ] );
+  this->EvaluateParzenValues(
+    movingImageParzenWindowTerm, movingImageParzenWindowIndex,
+    this->m_DerivativeMovingKernel, derivativeMovingParzenValues );
 
-    const double et = static_cast< double >( this->m_MovingImageBinSize );
+  const double et = static_cast< double >( this->m_MovingImageBinSize );
 
-    /** Loop over the Parzen window region and increment the values
-     * Also update the pdf derivatives.
-     */
-    for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
+  /** Loop over the Parzen window region and increment the values
+   * Also update the pdf derivatives.
+   */
+  for( unsigned int f = 0; f < fixedParzenValues.GetSize(); ++f )
+  {
+    const double fv    = fixedParzenValues[ f ];
+    const double fv_et = fv / et;
+    for( unsigned int m = 0; m < movingParzenValues.GetSize(); ++m )
     {
-      const double fv    = fixedParzenValues[ f ];
-      const double fv_et = fv / et;
-      for( unsigned int m = 0; m < movingParzenValues.GetSize(); ++m )
-      {
-        it.Value() += static_cast< PDFValueType >( fv * movingParzenValues[ m ] );
-        this->UpdateJointPDFDerivatives(
-          it.GetIndex(), fv_et * derivativeMovingParzenValues[ m ],
-          *imageJacobian, *nzji );
-        ++it;
-      }
-      it.NextLine();
+      it.Value() += static_cast< PDFValueType >( fv * movingParzenValues[ m ] );
+      this->UpdateJointPDFDerivatives(
+        it.GetIndex(), fv_et * derivativeMovingParzenValues[ m ],
+        *imageJacobian, *nzji );
+      ++it;
     }
+    it.NextLine();
   }
 
 } // end UpdateJointPDFAndDerivatives()
@@ -1155,13 +1207,30 @@ template< class TFixedImage, class TMovingImage >
 void
 ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedComputePDFs( ThreadIdType threadId )
+{
+  /** Run the loop over the samples with the evaluator selected for this resolution. */
+  const ThreadedComputePDFsFunctor functor = { this, threadId };
+  this->CallWithSampleEvaluator( functor );
+
+} // end ThreadedComputePDFs()
+
+
+/**
+ * ******************* ThreadedComputePDFsWithEvaluator *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TSampleEvaluator >
+void
+ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputePDFsWithEvaluator( ThreadIdType threadId, const TSampleEvaluator & evaluator )
 {
   /** Get a handle to the pre-allocated joint PDF for the current thread.
    * The initialization is performed here, so that it is done multi-threadedly
    * instead of sequentially in InitializeThreadingParameters().
    */
-  JointPDFPointer & jointPDF = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_JointPDF;
-  jointPDF->FillBuffer( NumericTraits< PDFValueType >::ZeroValue() );
+  PerThreadJointPDFPointer & jointPDF = this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_JointPDF;
+  jointPDF->FillBuffer( NumericTraits< PerThreadPDFValueType >::ZeroValue() );
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
@@ -1196,7 +1265,7 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
     MovingImagePointType        mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = evaluator.TransformPoint( fixedPoint, mappedPoint );
 
     /** Check if point is inside mask. */
     if( sampleOk )
@@ -1209,7 +1278,7 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
      */
     if( sampleOk )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+      sampleOk = evaluator.EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, nullptr );
     }
 
@@ -1225,16 +1294,14 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
       movingImageValue = this->GetMovingImageLimiter()->Evaluate( movingImageValue );
 
       /** Compute this sample's contribution to the joint distributions. */
-      this->UpdateJointPDFAndDerivatives(
-        fixedImageValue, movingImageValue, nullptr, nullptr,
-        jointPDF.GetPointer() );
+      this->UpdateJointPDF( fixedImageValue, movingImageValue, jointPDF.GetPointer() );
     }
   } // end iterating over fixed image spatial sample container for loop
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
 
-} // end ThreadedComputePDFs()
+} // end ThreadedComputePDFsWithEvaluator()
 
 
 /**
@@ -1268,14 +1335,17 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
   /** Compute alpha. */
   this->m_Alpha = 1.0 / static_cast< double >( this->m_NumberOfPixelsCounted );
 
-  /** Accumulate joint histogram. */
+  /** Accumulate joint histogram. The sum is taken in PDFValueType,
+   * also when the per-thread joint PDFs are single precision.
+   */
   // could be multi-threaded too, by each thread updating only a part of the JointPDF.
-  typedef ImageScanlineIterator< JointPDFType > JointPDFIteratorType;
-  JointPDFIteratorType                it( this->m_JointPDF, this->m_JointPDF->GetBufferedRegion() );
-  std::vector< JointPDFIteratorType > itT( numberOfThreads );
+  typedef ImageScanlineIterator< JointPDFType >          JointPDFIteratorType;
+  typedef ImageScanlineIterator< PerThreadJointPDFType > PerThreadJointPDFIteratorType;
+  JointPDFIteratorType                         it( this->m_JointPDF, this->m_JointPDF->GetBufferedRegion() );
+  std::vector< PerThreadJointPDFIteratorType > itT( numberOfThreads );
   for( ThreadIdType i = 0; i < numberOfThreads; ++i )
   {
-    itT[ i ] = JointPDFIteratorType(
+    itT[ i ] = PerThreadJointPDFIteratorType(
       this->m_ParzenWindowHistogramGetValueAndDerivativePerThreadVariables[ i ].st_JointPDF,
       this->m_JointPDF->GetBufferedRegion() );
   }
@@ -1288,7 +1358,7 @@ ParzenWindowHistogramImageToImageMetric< TFixedImage, TMovingImage >
       sum = NumericTraits< PDFValueType >::Zero;
       for( ThreadIdType i = 0; i < numberOfThreads; ++i )
       {
-        sum += itT[ i ].Value();
+        sum += static_cast< PDFValueType >( itT[ i ].Value() );
         ++itT[ i ];
       }
       it.Set( sum );
@@ -0,0 +1,173 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRecursiveBSplineSampleEvaluator_h
+#define __itkRecursiveBSplineSampleEvaluator_h
+
+#include "itkHotPathProfiler.h"
+#include "itkMatrix.h"
+#include "itkVector.h"
+
+namespace itk
+{
+
+/** \class RecursiveBSplineSampleEvaluator
+ * \brief Evaluates the transform and the moving image for a metric sample,
+ * without virtual function calls.
+ *
+ * This class is used by the AdvancedImageToImageMetric for the most common
+ * combination in a non-rigid registration: a RecursiveBSplineTransform,
+ * optionally composed with a linear initial transform, and a B-spline or
+ * linear interpolator. The transform and interpolator types are template
+ * parameters, and their member functions are called with a qualified name,
+ * so that the compiler can inline them in the loop over the samples.
+ *
+ * The initial transform is given by its matrix and offset:
+ *   T(x) = T_bspline( A x + b ).
+ *
+ * The interface is the same as AdvancedImageToImageMetric::DefaultSampleEvaluator,
+ * so that the metrics can implement their loop over the samples once, as a
+ * template in the evaluator type. The calls are profiled under the same names
+ * as those of the default evaluator.
+ *
+ * \sa AdvancedImageToImageMetric::CallWithSampleEvaluator()
+ * \ingroup RegistrationMetrics
+ */
+
+template< class TBSplineTransform, class TInterpolator >
+class RecursiveBSplineSampleEvaluator
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef RecursiveBSplineSampleEvaluator Self;
+
+  /** Typedefs for the transform. */
+  typedef TBSplineTransform                                 BSplineTransformType;
+  typedef typename BSplineTransformType::ScalarType         ScalarType;
+  typedef typename BSplineTransformType::InputPointType     InputPointType;
+  typedef typename BSplineTransformType::OutputPointType    OutputPointType;
+  typedef typename BSplineTransformType::DerivativeType     DerivativeType;
+  typedef typename BSplineTransformType::NonZeroJacobianIndicesType NonZeroJacobianIndicesType;
+
+  itkStaticConstMacro( SpaceDimension, unsigned int, BSplineTransformType::SpaceDimension );
+
+  /** Typedefs for the initial transform. */
+  typedef Matrix< ScalarType, SpaceDimension, SpaceDimension > MatrixType;
+  typedef Vector< ScalarType, SpaceDimension >                 OffsetType;
+
+  /** Typedefs for the interpolator. */
+  typedef TInterpolator                                  InterpolatorType;
+  typedef typename InterpolatorType::ContinuousIndexType ContinuousIndexType;
+  typedef typename InterpolatorType::OutputType          ValueType;
+  typedef typename InterpolatorType::CovariantVectorType GradientType;
+
+  /** Constructor. When useInitialTransform is false, the matrix and offset are ignored. */
+  RecursiveBSplineSampleEvaluator( const BSplineTransformType * transform,
+    const InterpolatorType * interpolator, const bool useInitialTransform,
+    const MatrixType & matrix, const OffsetType & offset ) :
+    m_BSplineTransform( transform ),
+    m_Interpolator( interpolator ),
+    m_UseInitialTransform( useInitialTransform ),
+    m_Matrix( matrix ),
+    m_Offset( offset )
+  {}
+
+  /** Transform a fixed image point to the moving image domain. */
+  inline bool TransformPoint( const InputPointType & fixedImagePoint,
+    OutputPointType & mappedPoint ) const
+  {
+    itkHotPathFineScopedTimerMacro( "Transform::TransformPoint" );
+    mappedPoint = this->m_BSplineTransform->BSplineTransformType::TransformPoint(
+      this->TransformPointByInitialTransform( fixedImagePoint ) );
+    return true;
+  }
+
+
+  /** Compute the moving image value and, if gradient is not null, its derivative.
+   * Returns false when the point is outside the moving image buffer.
+   */
+  inline bool EvaluateMovingImageValueAndDerivative( const OutputPointType & mappedPoint,
+    ValueType & movingImageValue, GradientType * gradient ) const
+  {
+    itkHotPathFineScopedTimerMacro( "Interpolator::EvaluateValueAndDerivative" );
+    ContinuousIndexType cindex;
+    this->m_Interpolator->ConvertPointToContinuousIndex( mappedPoint, cindex );
+    if( !this->m_Interpolator->InterpolatorType::IsInsideBuffer( cindex ) )
+    {
+      return false;
+    }
+
+    if( gradient )
+    {
+      this->m_Interpolator->InterpolatorType::EvaluateValueAndDerivativeAtContinuousIndex(
+        cindex, movingImageValue, *gradient );
+    }
+    else
+    {
+      movingImageValue = this->m_Interpolator->InterpolatorType::EvaluateAtContinuousIndex( cindex );
+    }
+    return true;
+  }
+
+
+  /** Compute the inner product of the transform Jacobian and the moving image gradient. */
+  inline void EvaluateJacobianWithImageGradientProduct( const InputPointType & fixedImagePoint,
+    const GradientType & movingImageGradient, DerivativeType & imageJacobian,
+    NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
+  {
+    this->m_BSplineTransform->BSplineTransformType::EvaluateJacobianWithImageGradientProduct(
+      this->TransformPointByInitialTransform( fixedImagePoint ),
+      movingImageGradient, imageJacobian, nonZeroJacobianIndices );
+  }
+
+
+private:
+
+  /** Apply the initial transform: A x + b. */
+  inline InputPointType TransformPointByInitialTransform( const InputPointType & point ) const
+  {
+    if( !this->m_UseInitialTransform )
+    {
+      return point;
+    }
+
+    InputPointType result;
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      ScalarType sum = 0.0;
+      for( unsigned int j = 0; j < SpaceDimension; ++j )
+      {
+        sum += this->m_Matrix( i, j ) * point[ j ];
+      }
+      result[ i ] = sum + this->m_Offset[ i ];
+    }
+    return result;
+  }
+
+
+  const BSplineTransformType * m_BSplineTransform;
+  const InterpolatorType *     m_Interpolator;
+  bool                         m_UseInitialTransform;
+  MatrixType                   m_Matrix;
+  OffsetType                   m_Offset;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkRecursiveBSplineSampleEvaluator_h
@@ -21,6 +21,7 @@
 #include "itkImageFullSampler.h"
 
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkHotPathProfiler.h"
 
 namespace itk
 {
@@ -34,6 +35,8 @@ void
 ImageFullSampler< TInputImage >
 ::GenerateData( void )
 {
+  itkHotPathScopedTimerMacro( "ImageFullSampler::GenerateData" );
+
   /** If desired we exercise a multi-threaded version. */
   if( this->m_UseMultiThread )
   {
@@ -99,10 +102,8 @@ ImageFullSampler< TInputImage >
   } // end if no mask
   else
   {
-    if( mask->GetSource() )
-    {
-      mask->GetSource()->Update();
-    }
+    /** Update the mask and its fast lookup. */
+    this->UpdateAllMasks();
 
     /** Loop over the image and check if the points falls within the mask. */
     ImageSampleType tempSample;
@@ -115,7 +116,7 @@ ImageFullSampler< TInputImage >
       inputImage->TransformIndexToPhysicalPoint( index,
         tempSample.m_ImageCoordinates );
 
-      if( mask->IsInsideInWorldSpace( tempSample.m_ImageCoordinates ) )
+      if( this->IsInsideMask( tempSample.m_ImageCoordinates ) )
       {
         /** Get sampled image value. */
         tempSample.m_ImageValue = iter.Get();
@@ -197,10 +198,7 @@ ImageFullSampler< TInputImage >
   } // end if no mask
   else
   {
-    if( mask->GetSource() )
-    {
-      mask->GetSource()->Update();
-    }
+    /** The mask and its fast lookup are updated in BeforeThreadedGenerateData(). */
 
     /** Loop over the image and check if the points falls within the mask. */
     ImageSampleType tempSample;
@@ -213,7 +211,7 @@ ImageFullSampler< TInputImage >
       inputImage->TransformIndexToPhysicalPoint( index,
         tempSample.m_ImageCoordinates );
 
-      if( mask->IsInsideInWorldSpace( tempSample.m_ImageCoordinates ) )
+      if( this->IsInsideMask( tempSample.m_ImageCoordinates ) )
       {
         /** Get sampled image value. */
         tempSample.m_ImageValue = iter.Get();
@@ -21,6 +21,7 @@
 #include "itkImageGridSampler.h"
 
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkHotPathProfiler.h"
 
 namespace itk
 {
@@ -66,6 +67,8 @@ void
 ImageGridSampler< TInputImage >
 ::GenerateData( void )
 {
+  itkHotPathScopedTimerMacro( "ImageGridSampler::GenerateData" );
+
   /** Get handles to the input image, output sample container, and the mask. */
   InputImageConstPointer inputImage = this->GetInput();
   typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
@@ -165,10 +168,8 @@ ImageGridSampler< TInputImage >
   } // end if no mask
   else
   {
-    if( mask->GetSource() )
-    {
-      mask->GetSource()->Update();
-    }
+    /** Update the mask and its fast lookup. */
+    this->UpdateAllMasks();
     /* Ugly loop over the grid; checks also if a sample falls within the mask. */
     for( unsigned int t = 0; t < dim_t; t++ )
     {
@@ -184,7 +185,7 @@ ImageGridSampler< TInputImage >
             inputImage->TransformIndexToPhysicalPoint(
               index, tempsample.m_ImageCoordinates );
 
-            if( mask->IsInsideInWorldSpace( tempsample.m_ImageCoordinates ) )
+            if( this->IsInsideMask( tempsample.m_ImageCoordinates ) )
             {
               // Get sampled fixed image value.
               tempsample.m_ImageValue = inputImage->GetPixel( index );
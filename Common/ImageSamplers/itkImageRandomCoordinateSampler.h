@@ -20,7 +20,7 @@
 
 #include "itkImageRandomSamplerBase.h"
 #include "itkInterpolateImageFunction.h"
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
 namespace itk
@@ -84,7 +84,7 @@ public:
   typedef InterpolateImageFunction<
     InputImageType, CoordRepType >                            InterpolatorType;
   typedef typename InterpolatorType::Pointer InterpolatorPointer;
-  typedef BSplineInterpolateImageFunction<
+  typedef CachedBSplineInterpolateImageFunction<
     InputImageType, CoordRepType, double >                    DefaultInterpolatorType;
 
   /** The random number generator used to generate random coordinates. */
@@ -127,6 +127,11 @@ protected:
     const InputImageRegionType & inputRegionForThread,
     ThreadIdType threadId ) override;
 
+  /** Set the input image of the interpolator. The B-spline coefficients of
+   * the default interpolator are computed with the work units of the sampler.
+   */
+  virtual void SetInterpolatorInputImage( void );
+
   /** Generate a point randomly in a bounding box. */
   virtual void GenerateRandomCoordinate(
     const InputImageContinuousIndexType & smallestContIndex,
@@ -20,6 +20,7 @@
 
 #include "itkImageRandomCoordinateSampler.h"
 #include "vnl/vnl_math.h"
+#include "itkHotPathProfiler.h"
 
 namespace itk
 {
@@ -56,6 +57,8 @@ void
 ImageRandomCoordinateSampler< TInputImage >
 ::GenerateData( void )
 {
+  itkHotPathScopedTimerMacro( "ImageRandomCoordinateSampler::GenerateData" );
+
   /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version. */
   typename MaskType::ConstPointer mask = this->GetMask();
   if( mask.IsNull() && this->m_UseMultiThread )
@@ -70,7 +73,7 @@ ImageRandomCoordinateSampler< TInputImage >
   typename InterpolatorType::Pointer interpolator            = this->GetModifiableInterpolator();
 
   /** Set up the interpolator. */
-  interpolator->SetInputImage( inputImage ); // only once?
+  this->SetInterpolatorInputImage(); // only once?
 
   /** Convert inputImageRegion to bounding box in physical space. */
   InputImageSizeType unitSize;
@@ -118,11 +121,8 @@ ImageRandomCoordinateSampler< TInputImage >
   } // end if no mask
   else
   {
-    /** Update the mask. */
-    if( mask->GetSource() )
-    {
-      mask->GetSource()->Update();
-    }
+    /** Update the mask and its fast lookup. */
+    this->UpdateAllMasks();
     /** Set up some variable that are used to make sure we are not forever
      * walking around on this image, trying to look for valid samples. */
     unsigned long numberOfSamplesTried        = 0;
@@ -157,7 +157,7 @@ ImageRandomCoordinateSampler< TInputImage >
 
       }
       while( !interpolator->IsInsideBuffer( sampleContIndex )
-        || !mask->IsInsideInWorldSpace( samplePoint ) );
+        || !this->IsInsideMask( samplePoint ) );
 
       /** Compute the value at the point. */
       sampleValue = static_cast< ImageSampleValueType >(
@@ -179,8 +179,7 @@ ImageRandomCoordinateSampler< TInputImage >
 ::BeforeThreadedGenerateData( void )
 {
   /** Set up the interpolator. */
-  typename InterpolatorType::Pointer interpolator = this->GetModifiableInterpolator();
-  interpolator->SetInputImage( this->GetInput() ); // only once per resolution?
+  this->SetInterpolatorInputImage(); // only once per resolution?
 
   /** Clear the random number list. */
   this->m_RandomNumberList.resize( 0 );
@@ -283,6 +282,26 @@ ImageRandomCoordinateSampler< TInputImage >
 } // end ThreadedGenerateData()
 
 
+/**
+ * ******************* SetInterpolatorInputImage *******************
+ */
+
+template< class TInputImage >
+void
+ImageRandomCoordinateSampler< TInputImage >
+::SetInterpolatorInputImage( void )
+{
+  DefaultInterpolatorType * defaultInterpolator
+    = dynamic_cast< DefaultInterpolatorType * >( this->m_Interpolator.GetPointer() );
+  if( defaultInterpolator != nullptr )
+  {
+    defaultInterpolator->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  }
+  this->m_Interpolator->SetInputImage( this->GetInput() );
+
+} // end SetInterpolatorInputImage()
+
+
 /**
  * ******************* GenerateRandomCoordinate *******************
  */
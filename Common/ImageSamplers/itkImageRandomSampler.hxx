@@ -22,6 +22,7 @@
 
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkImageRandomConstIteratorWithIndex.h"
+#include "itkHotPathProfiler.h"
 
 namespace itk
 {
@@ -35,6 +36,8 @@ void
 ImageRandomSampler< TInputImage >
 ::GenerateData( void )
 {
+  itkHotPathScopedTimerMacro( "ImageRandomSampler::GenerateData" );
+
   /** Get a handle to the mask. If there was no mask supplied we exercise a multi-threaded version. */
   typename MaskType::ConstPointer mask = this->GetMask();
   if( mask.IsNull() && this->m_UseMultiThread )
@@ -80,11 +83,8 @@ ImageRandomSampler< TInputImage >
   } // end if no mask
   else
   {
-    /** Update the mask. */
-    if( mask->GetSource() )
-    {
-      mask->GetSource()->Update();
-    }
+    /** Update the mask and its fast lookup. */
+    this->UpdateAllMasks();
 
     /** Make sure we are not eternally trying to find samples: */
     randIter.SetNumberOfSamples( 10 * this->GetNumberOfSamples() );
@@ -114,7 +114,7 @@ ImageRandomSampler< TInputImage >
         InputImageIndexType index = randIter.GetIndex();
         inputImage->TransformIndexToPhysicalPoint( index, inputPoint );
         /** Check if it's inside the mask. */
-        insideMask = mask->IsInsideInWorldSpace( inputPoint );
+        insideMask = this->IsInsideMask( inputPoint );
       }
       while( !insideMask );
 
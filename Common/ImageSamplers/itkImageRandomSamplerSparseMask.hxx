@@ -19,6 +19,7 @@
 #define __ImageRandomSamplerSparseMask_hxx
 
 #include "itkImageRandomSamplerSparseMask.h"
+#include "itkHotPathProfiler.h"
 
 namespace itk
 {
@@ -48,6 +49,8 @@ void
 ImageRandomSamplerSparseMask< TInputImage >
 ::GenerateData( void )
 {
+  itkHotPathScopedTimerMacro( "ImageRandomSamplerSparseMask::GenerateData" );
+
   /** Get a handle to the mask. */
   typename MaskType::ConstPointer mask = this->GetMask();
 
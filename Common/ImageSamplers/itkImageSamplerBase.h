@@ -22,6 +22,7 @@
 #include "itkImageSample.h"
 #include "itkVectorDataContainer.h"
 #include "itkSpatialObject.h"
+#include "itkImageMaskLookup.h"
 
 namespace itk
 {
@@ -86,6 +87,7 @@ public:
   typedef typename MaskType::Pointer                            MaskPointer;
   typedef typename MaskType::ConstPointer                       MaskConstPointer;
   typedef std::vector< MaskConstPointer >                       MaskVectorType;
+  typedef ImageMaskLookup< Self::InputImageDimension >          MaskLookupType;
   typedef std::vector< InputImageRegionType >                   InputImageRegionVectorType;
 
   /** ******************** Masks ******************** */
@@ -118,6 +120,9 @@ public:
   /** Get the number of masks. */
   itkGetConstMacro( NumberOfMasks, unsigned int );
 
+  /** Get the fast lookup of the first mask. It is updated by UpdateAllMasks(). */
+  itkGetConstObjectMacro( MaskLookup, MaskLookupType );
+
   /** ******************** Regions ******************** */
 
   /** Set the region over which the samples will be taken. */
@@ -188,9 +193,23 @@ protected:
   /** IsInsideAllMasks. */
   virtual bool IsInsideAllMasks( const InputImagePointType & point ) const;
 
-  /** UpdateAllMasks. */
+  /** UpdateAllMasks. Also updates the fast lookup of the first mask. */
   virtual void UpdateAllMasks( void );
 
+  /** Check whether a point is inside the first mask, using the fast lookup.
+   * UpdateAllMasks() should be called first, otherwise IsInsideInWorldSpace()
+   * of the mask is used.
+   */
+  bool IsInsideMask( const InputImagePointType & point ) const
+  {
+    if( this->m_MaskLookup->GetMask() != this->m_Mask.GetPointer() )
+    {
+      return this->m_Mask->IsInsideInWorldSpace( point );
+    }
+    return this->m_MaskLookup->IsInside( point );
+  }
+
+
   /** Checks if the InputImageRegions are a subregion of the
   * LargestPossibleRegions.
   */
@@ -221,6 +240,7 @@ private:
   /** Member variables. */
   MaskConstPointer           m_Mask;
   MaskVectorType             m_MaskVector;
+  typename MaskLookupType::Pointer m_MaskLookup;
   unsigned int               m_NumberOfMasks;
   InputImageRegionType       m_InputImageRegion;
   InputImageRegionVectorType m_InputImageRegionVector;
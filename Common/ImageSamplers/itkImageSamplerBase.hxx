@@ -32,6 +32,7 @@ ImageSamplerBase< TInputImage >
 ::ImageSamplerBase()
 {
   this->m_Mask                      = nullptr;
+  this->m_MaskLookup                = MaskLookupType::New();
   this->m_NumberOfMasks             = 0;
   this->m_NumberOfInputImageRegions = 0;
   this->m_NumberOfSamples           = 0;
@@ -263,8 +264,8 @@ bool
 ImageSamplerBase< TInputImage >
 ::IsInsideAllMasks( const InputImagePointType & point ) const
 {
-  bool ret = true;
-  for( unsigned int i = 0; i < this->m_NumberOfMasks; ++i )
+  bool ret = this->m_NumberOfMasks == 0 || this->IsInsideMask( point );
+  for( unsigned int i = 1; i < this->m_NumberOfMasks; ++i )
   {
     ret &= this->GetMask( i )->IsInsideInWorldSpace( point );
   }
@@ -292,6 +293,10 @@ ImageSamplerBase< TInputImage >
     }
   }
 
+  /** Build the fast lookup of the first mask, if it changed. */
+  this->m_MaskLookup->SetMask( this->m_Mask );
+  this->m_MaskLookup->Update();
+
 } // end UpdateAllMasks()
 
 
@@ -423,6 +428,12 @@ ImageSamplerBase< TInputImage >
     this->m_ThreaderSampleContainer[ i ] = ImageSampleContainerType::New();
   }
 
+  /** Update the masks once, before the threads use them. */
+  if( this->m_Mask.IsNotNull() )
+  {
+    this->UpdateAllMasks();
+  }
+
 } // end BeforeThreadedGenerateData()
 
 
@@ -471,6 +482,7 @@ ImageSamplerBase< TInputImage >
 
   os << indent << "NumberOfMasks" << this->m_NumberOfMasks << std::endl;
   os << indent << "Mask: " << this->m_Mask.GetPointer() << std::endl;
+  os << indent << "MaskLookup: " << this->m_MaskLookup.GetPointer() << std::endl;
   os << indent << "MaskVector:" << std::endl;
   for( unsigned int i = 0; i < this->m_NumberOfMasks; ++i )
   {
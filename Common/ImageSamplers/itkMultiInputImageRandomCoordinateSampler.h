@@ -20,7 +20,7 @@
 
 #include "itkImageRandomSamplerBase.h"
 #include "itkInterpolateImageFunction.h"
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
 namespace itk
@@ -83,7 +83,7 @@ public:
   typedef double                                                                  CoordRepType;
   typedef InterpolateImageFunction< InputImageType, CoordRepType >                InterpolatorType;
   typedef typename InterpolatorType::Pointer                                      InterpolatorPointer;
-  typedef BSplineInterpolateImageFunction< InputImageType, CoordRepType, double > DefaultInterpolatorType;
+  typedef CachedBSplineInterpolateImageFunction< InputImageType, CoordRepType, double > DefaultInterpolatorType;
 
   /** The random number generator used to generate random coordinates. */
   typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
@@ -120,6 +120,11 @@ protected:
   /** Function that does the work. */
   void GenerateData( void ) override;
 
+  /** Set the input image of the interpolator. The B-spline coefficients of
+   * the default interpolator are computed with the work units of the sampler.
+   */
+  virtual void SetInterpolatorInputImage( void );
+
   /** Generate a point randomly in a bounding box.
    * This method can be overwritten in subclasses if a different distribution is desired. */
   virtual void GenerateRandomCoordinate(
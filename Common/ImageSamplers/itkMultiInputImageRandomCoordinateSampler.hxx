@@ -68,10 +68,9 @@ MultiInputImageRandomCoordinateSampler< TInputImage >
   InputImageConstPointer inputImage = this->GetInput();
   typename ImageSampleContainerType::Pointer sampleContainer = this->GetOutput();
   typename MaskType::ConstPointer mask                       = this->GetMask();
-  typename InterpolatorType::Pointer interpolator            = this->GetModifiableInterpolator();
 
   /** Set up the interpolator. */
-  interpolator->SetInputImage( inputImage );
+  this->SetInterpolatorInputImage();
 
   /** Get the intersection of all sample regions. */
   InputImageContinuousIndexType smallestContIndex;
@@ -263,6 +262,26 @@ MultiInputImageRandomCoordinateSampler< TInputImage >::GenerateSampleRegion(
 } // end GenerateSampleRegion()
 
 
+/**
+ * ******************* SetInterpolatorInputImage *******************
+ */
+
+template< class TInputImage >
+void
+MultiInputImageRandomCoordinateSampler< TInputImage >
+::SetInterpolatorInputImage( void )
+{
+  DefaultInterpolatorType * defaultInterpolator
+    = dynamic_cast< DefaultInterpolatorType * >( this->m_Interpolator.GetPointer() );
+  if( defaultInterpolator != nullptr )
+  {
+    defaultInterpolator->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  }
+  this->m_Interpolator->SetInputImage( this->GetInput() );
+
+} // end SetInterpolatorInputImage()
+
+
 /**
  * ******************* GenerateRandomCoordinate *******************
  */
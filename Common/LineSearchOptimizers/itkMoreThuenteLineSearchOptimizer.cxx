@@ -20,7 +20,9 @@
 #define __itkMoreThuenteLineSearchOptimizer_cxx
 
 #include "itkMoreThuenteLineSearchOptimizer.h"
+#include "itkScaledSingleValuedCostFunction.h"
 #include <cmath> // For abs.
+#include <algorithm>
 #include <limits>
 
 namespace itk
@@ -44,6 +46,9 @@ MoreThuenteLineSearchOptimizer
   this->SetMinimumStepLength( 1e-20 );
   this->SetMaximumStepLength( 1e20 );
 
+  this->m_UseSpeculativeEvaluation = false;
+  this->m_SpeculativeBatchBegin    = 0;
+
   this->InitializeLineSearch();
 
 } // end Constructor
@@ -143,6 +148,10 @@ MoreThuenteLineSearchOptimizer
 {
   this->CheckSettings();
 
+  /** Forget the speculative evaluations of the previous line search. */
+  this->m_SpeculativeEvaluations.clear();
+  this->InitializeSpeculativeCostFunctions();
+
   this->SetCurrentPosition( this->GetInitialPosition() );
   this->GetInitialValueAndDerivative();
   this->m_dg = this->DirectionalDerivative( this->m_g );
@@ -418,6 +427,13 @@ void
 MoreThuenteLineSearchOptimizer
 ::ComputeCurrentValueAndDerivative( void )
 {
+  if( this->m_UseSpeculativeEvaluation
+    && this->m_SpeculativeCostFunctionsToUse.size() > 1 )
+  {
+    this->ComputeCurrentValueAndDerivativeSpeculatively();
+    return;
+  }
+
   try
   {
     this->GetCostFunction()->GetValueAndDerivative(
@@ -433,6 +449,259 @@ MoreThuenteLineSearchOptimizer
 } // end ComputeCurrentValueAndDerivative()
 
 
+/**
+ * ************ ComputeCurrentValueAndDerivativeSpeculatively ****************
+ */
+
+void
+MoreThuenteLineSearchOptimizer
+::ComputeCurrentValueAndDerivativeSpeculatively( void )
+{
+  /** Maybe the current step has been evaluated already. */
+  std::size_t current = this->FindSpeculativeEvaluation( this->m_step );
+  if( current == this->m_SpeculativeEvaluations.size() )
+  {
+    /** Setup a batch of steps, starting with the current step. */
+    std::vector< double > steps;
+    this->ComputeSpeculativeSteps( steps );
+
+    /** Nothing to speculate about, once the minimizer is bracketed. */
+    if( steps.size() < 2 )
+    {
+      try
+      {
+        this->GetCostFunction()->GetValueAndDerivative(
+          this->GetCurrentPosition(), this->m_f, this->m_g );
+      }
+      catch( ExceptionObject & err )
+      {
+        this->m_StopCondition = MetricError;
+        this->StopOptimization();
+        throw err;
+      }
+      return;
+    }
+
+    /** The positions are computed as in SetCurrentStepLength(). */
+    const ParametersType & direction = this->GetLineSearchDirection();
+    this->m_SpeculativeBatchBegin = this->m_SpeculativeEvaluations.size();
+    for( std::size_t i = 0; i < steps.size(); ++i )
+    {
+      SpeculativeEvaluationType evaluation;
+      evaluation.st_Step     = steps[ i ];
+      evaluation.st_Position = this->GetInitialPosition();
+      for( unsigned int j = 0; j < evaluation.st_Position.GetSize(); ++j )
+      {
+        evaluation.st_Position[ j ] += ( steps[ i ] * direction[ j ] );
+      }
+      evaluation.st_Value    = NumericTraits< MeasureType >::Zero;
+      evaluation.st_Failed   = false;
+      this->m_SpeculativeEvaluations.push_back( evaluation );
+    }
+
+    /** Evaluate the batch concurrently, one step per worker. */
+    ThreaderType::Pointer threader = ThreaderType::New();
+    threader->SetNumberOfWorkUnits( static_cast< ThreadIdType >( steps.size() ) );
+    threader->SetSingleMethod( EvaluateSpeculativeStepsThreaderCallback, static_cast< void * >( this ) );
+    threader->SingleMethodExecute();
+
+    current = this->m_SpeculativeBatchBegin;
+  }
+
+  /** Report an error, like ComputeCurrentValueAndDerivative() does. */
+  const SpeculativeEvaluationType & evaluation = this->m_SpeculativeEvaluations[ current ];
+  if( evaluation.st_Failed )
+  {
+    this->m_StopCondition = MetricError;
+    this->StopOptimization();
+    throw evaluation.st_Exception;
+  }
+
+  this->m_f = evaluation.st_Value;
+  this->m_g = evaluation.st_Derivative;
+
+} // end ComputeCurrentValueAndDerivativeSpeculatively()
+
+
+/**
+ * ******************* ComputeSpeculativeSteps ************************
+ */
+
+void
+MoreThuenteLineSearchOptimizer
+::ComputeSpeculativeSteps( std::vector< double > & steps ) const
+{
+  const std::size_t numberOfSteps = this->m_SpeculativeCostFunctionsToUse.size();
+  const double      xtrapf        = 4.0;
+
+  steps.clear();
+  steps.push_back( this->m_step );
+
+  /** While the interval of uncertainty is not bracketed, and the function
+   * decreases faster than expected, the next step is the maximum step, see
+   * UpdateIntervalMinimumAndMaximum(). Once bracketed, the next step
+   * depends on the value at the current step, so it cannot be predicted. */
+  if( this->m_brackt )
+  {
+    return;
+  }
+
+  double previous     = this->m_stepx;
+  double extrapolated = this->m_step;
+  while( steps.size() < numberOfSteps && extrapolated < this->GetMaximumStepLength() )
+  {
+    /** Same expression as in UpdateIntervalMinimumAndMaximum(). */
+    double step = extrapolated + xtrapf * ( extrapolated - previous );
+    this->BoundStep( step );
+    if( !( step > extrapolated ) )
+    {
+      break;
+    }
+    previous     = extrapolated;
+    extrapolated = step;
+
+    /** Skip steps that have been evaluated already. */
+    if( this->FindSpeculativeEvaluation( step ) == this->m_SpeculativeEvaluations.size() )
+    {
+      steps.push_back( step );
+    }
+  }
+
+} // end ComputeSpeculativeSteps()
+
+
+/**
+ * ******************* FindSpeculativeEvaluation ************************
+ */
+
+std::size_t
+MoreThuenteLineSearchOptimizer
+::FindSpeculativeEvaluation( double step ) const
+{
+  for( std::size_t i = 0; i < this->m_SpeculativeEvaluations.size(); ++i )
+  {
+    if( this->m_SpeculativeEvaluations[ i ].st_Step == step )
+    {
+      return i;
+    }
+  }
+  return this->m_SpeculativeEvaluations.size();
+
+} // end FindSpeculativeEvaluation()
+
+
+/**
+ * ************ EvaluateSpeculativeStepsThreaderCallback ****************
+ */
+
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+MoreThuenteLineSearchOptimizer
+::EvaluateSpeculativeStepsThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+  Self *           optimizer  = static_cast< Self * >( infoStruct->UserData );
+
+  /** Call the real implementation. */
+  optimizer->ThreadedEvaluateSpeculativeSteps( threadID );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end EvaluateSpeculativeStepsThreaderCallback()
+
+
+/**
+ * ************ ThreadedEvaluateSpeculativeSteps ****************
+ */
+
+void
+MoreThuenteLineSearchOptimizer
+::ThreadedEvaluateSpeculativeSteps( ThreadIdType threadId )
+{
+  /** Each worker exclusively uses its own cost function. */
+  SpeculativeEvaluationType & evaluation
+    = this->m_SpeculativeEvaluations[ this->m_SpeculativeBatchBegin + threadId ];
+  const CostFunctionType * costFunction
+    = this->m_SpeculativeCostFunctionsToUse[ threadId ].GetPointer();
+
+  try
+  {
+    costFunction->GetValueAndDerivative(
+      evaluation.st_Position, evaluation.st_Value, evaluation.st_Derivative );
+  }
+  catch( ExceptionObject & err )
+  {
+    evaluation.st_Failed    = true;
+    evaluation.st_Exception = err;
+  }
+
+} // end ThreadedEvaluateSpeculativeSteps()
+
+
+/**
+ * ******************* SetSpeculativeCostFunctions ************************
+ */
+
+void
+MoreThuenteLineSearchOptimizer
+::SetSpeculativeCostFunctions( const CostFunctionContainerType & costFunctions )
+{
+  this->m_SpeculativeCostFunctions = costFunctions;
+  this->m_SpeculativeCostFunctionsToUse.clear();
+  this->Modified();
+
+} // end SetSpeculativeCostFunctions()
+
+
+/**
+ * ******************* InitializeSpeculativeCostFunctions ************************
+ */
+
+void
+MoreThuenteLineSearchOptimizer
+::InitializeSpeculativeCostFunctions( void )
+{
+  this->m_SpeculativeCostFunctionsToUse.clear();
+  if( !this->m_UseSpeculativeEvaluation )
+  {
+    return;
+  }
+
+  /** When the main optimizer uses scales, so should the speculative cost functions. */
+  typedef ScaledSingleValuedCostFunction ScaledCostFunctionType;
+  const ScaledCostFunctionType * scaledCostFunction
+    = dynamic_cast< const ScaledCostFunctionType * >( this->GetCostFunction() );
+
+  for( std::size_t i = 0; i < this->m_SpeculativeCostFunctions.size(); ++i )
+  {
+    CostFunctionType * costFunction = this->m_SpeculativeCostFunctions[ i ];
+    if( costFunction == nullptr )
+    {
+      itkExceptionMacro( << "Speculative cost function " << i << " is not set." );
+    }
+
+    if( scaledCostFunction != nullptr )
+    {
+      ScaledCostFunctionType::Pointer workerCostFunction = ScaledCostFunctionType::New();
+      workerCostFunction->SetUnscaledCostFunction( costFunction );
+      workerCostFunction->SetSquaredScales( scaledCostFunction->GetSquaredScales() );
+      workerCostFunction->SetUseScales( scaledCostFunction->GetUseScales() );
+      workerCostFunction->SetNegateCostFunction( scaledCostFunction->GetNegateCostFunction() );
+      costFunction = workerCostFunction;
+    }
+
+    if( costFunction->GetNumberOfParameters() != this->GetCostFunction()->GetNumberOfParameters() )
+    {
+      itkExceptionMacro( << "Speculative cost function " << i
+                         << " has a different number of parameters than the cost function." );
+    }
+    this->m_SpeculativeCostFunctionsToUse.push_back( costFunction );
+  }
+
+} // end InitializeSpeculativeCostFunctions()
+
+
 /**
  * ************************** TestConvergence ****************************
  *
@@ -951,6 +1220,10 @@ MoreThuenteLineSearchOptimizer
 
   os << indent << "m_CurrentIteration: "
      << this->m_CurrentIteration << std::endl;
+  os << indent << "m_UseSpeculativeEvaluation: "
+     << ( this->m_UseSpeculativeEvaluation ? "true" : "false" ) << std::endl;
+  os << indent << "m_SpeculativeCostFunctions: "
+     << this->m_SpeculativeCostFunctions.size() << " workers" << std::endl;
   os << indent << "m_InitialDerivativeProvided: "
      << ( this->m_InitialDerivativeProvided ? "true" : "false" ) << std::endl;
   os << indent << "m_InitialValueProvided: "
@@ -20,6 +20,8 @@
 #define __itkMoreThuenteLineSearchOptimizer_h
 
 #include "itkLineSearchOptimizer.h"
+#include "itkPlatformMultiThreader.h"
+#include <vector>
 
 namespace itk
 {
@@ -64,6 +66,15 @@ namespace itk
  * when rounding errors prevent further progress. In this case stp only
  * satisfies the sufficient decrease condition.
  *
+ * Optionally, the trial steps are evaluated speculatively: while the
+ * minimizer is not bracketed, the step that the algorithm asks for is
+ * evaluated concurrently with the extrapolation steps it would take next
+ * if the function keeps decreasing faster than expected. Steps that the
+ * algorithm later asks for are taken from these earlier evaluations, so
+ * the line search takes exactly the same steps as without speculation,
+ * only the expansion phase (e.g. after a much too short initial step)
+ * takes less time. This requires a cost function per worker that can be
+ * evaluated simultaneously with the others, see SetSpeculativeCostFunctions().
  *
  * \ingroup Numerics Optimizers
  */
@@ -85,6 +96,9 @@ public:
   typedef Superclass::DerivativeType   DerivativeType;
   typedef Superclass::CostFunctionType CostFunctionType;
 
+  typedef CostFunctionType::Pointer          CostFunctionPointer;
+  typedef std::vector< CostFunctionPointer > CostFunctionContainerType;
+
   typedef enum {
     StrongWolfeConditionsSatisfied,
     MetricError,
@@ -166,6 +180,22 @@ public:
   itkSetClampMacro( IntervalTolerance, double, 0.0, NumericTraits< double >::max() );
   itkGetConstMacro( IntervalTolerance, double );
 
+  /** Setting: the cost functions used to evaluate trial steps speculatively,
+   * one per worker thread. Each must compute the same function as the cost
+   * function set by SetCostFunction(), and they must be safe to evaluate
+   * simultaneously. When the cost function is a ScaledSingleValuedCostFunction,
+   * they are wrapped with the same scales. The number of cost functions is the
+   * number of steps evaluated at once. Default: empty. */
+  virtual void SetSpeculativeCostFunctions( const CostFunctionContainerType & costFunctions );
+  const CostFunctionContainerType & GetSpeculativeCostFunctions( void ) const
+  { return this->m_SpeculativeCostFunctions; }
+
+  /** Setting: evaluate trial steps speculatively, using the speculative cost
+   * functions. Ignored when less than two are set. Default: false. */
+  itkSetMacro( UseSpeculativeEvaluation, bool );
+  itkGetConstMacro( UseSpeculativeEvaluation, bool );
+  itkBooleanMacro( UseSpeculativeEvaluation );
+
 protected:
 
   MoreThuenteLineSearchOptimizer();
@@ -204,6 +234,20 @@ protected:
   /** Ask the cost function to compute m_f and m_g at the current position. */
   virtual void ComputeCurrentValueAndDerivative( void );
 
+  /** Same as ComputeCurrentValueAndDerivative(), but the current step is
+   * either taken from an earlier speculative evaluation, or evaluated
+   * concurrently with the steps returned by ComputeSpeculativeSteps(). */
+  virtual void ComputeCurrentValueAndDerivativeSpeculatively( void );
+
+  /** Fill the list of steps to evaluate concurrently. The first is m_step,
+   * then, when the minimizer is not bracketed yet, the steps taken when the
+   * function keeps decreasing faster than expected. These are exactly the
+   * steps that SafeGuardedStep() returns in that case. */
+  virtual void ComputeSpeculativeSteps( std::vector< double > & steps ) const;
+
+  /** Wrap the speculative cost functions in scaled cost functions, when needed. */
+  virtual void InitializeSpeculativeCostFunctions( void );
+
   /** Check for convergence */
   virtual void TestConvergence( bool & stop );
 
@@ -258,6 +302,38 @@ private:
   double        m_GradientTolerance;
   double        m_IntervalTolerance;
 
+  /** Variables for the speculative evaluation of trial steps. */
+  typedef itk::PlatformMultiThreader ThreaderType;
+  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
+
+  struct SpeculativeEvaluationType
+  {
+    double          st_Step;
+    ParametersType  st_Position;
+    MeasureType     st_Value;
+    DerivativeType  st_Derivative;
+    bool            st_Failed;
+    ExceptionObject st_Exception;
+  };
+  typedef std::vector< SpeculativeEvaluationType > SpeculativeEvaluationContainerType;
+
+  bool                               m_UseSpeculativeEvaluation;
+  CostFunctionContainerType          m_SpeculativeCostFunctions;
+  CostFunctionContainerType          m_SpeculativeCostFunctionsToUse;
+  SpeculativeEvaluationContainerType m_SpeculativeEvaluations;
+  std::size_t                        m_SpeculativeBatchBegin;
+
+  /** Returns the index of the evaluation of the given step in this line
+   * search, or m_SpeculativeEvaluations.size() if there is none. */
+  std::size_t FindSpeculativeEvaluation( double step ) const;
+
+  /** The callback function. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION EvaluateSpeculativeStepsThreaderCallback( void * arg );
+
+  /** The threaded implementation: worker threadId evaluates the step
+   * m_SpeculativeBatchBegin + threadId. */
+  inline void ThreadedEvaluateSpeculativeSteps( ThreadIdType threadId );
+
 };
 
 } // end namespace itk
@@ -19,8 +19,13 @@
 #define __itkAdvancedCombinationTransform_h
 
 #include "itkAdvancedTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImage.h"
 #include "itkMacro.h"
 
+#include <typeinfo>
+#include <vector>
+
 namespace itk
 {
 
@@ -49,6 +54,14 @@ namespace itk
  * Note: It is mandatory to set a current transform. An initial transform
  * is not mandatory.
  *
+ * With composition, the initial transform is often itself a combination
+ * transform, with its own initial transform, etc. To avoid walking this
+ * chain for every point, it can be flattened into a list of stages, see
+ * UpdateFlattenedInitialTransform(). Consecutive linear stages are merged
+ * into a single matrix and offset. Alternatively, a non-linear initial
+ * transform can be replaced by a precomputed displacement field, see
+ * SetInitialTransformDisplacementField().
+ *
  * \ingroup Transforms
  */
 
@@ -130,6 +143,25 @@ public:
 
   itkGetModifiableObjectMacro( InitialTransform, InitialTransformType );
 
+  /** Typedefs for the displacement field that can replace the InitialTransform. */
+  typedef Vector< float, NDimensions >                            InitialTransformDisplacementType;
+  typedef Image< InitialTransformDisplacementType, NDimensions >  InitialTransformDisplacementFieldType;
+  typedef typename InitialTransformDisplacementFieldType::Pointer InitialTransformDisplacementFieldPointer;
+  typedef AdvancedLinearInterpolateImageFunction<
+    InitialTransformDisplacementFieldType, ScalarType >           InitialTransformDisplacementFieldInterpolatorType;
+  typedef typename InitialTransformDisplacementFieldInterpolatorType::Pointer
+    InitialTransformDisplacementFieldInterpolatorPointer;
+
+  /** Set/Get a displacement field that replaces the InitialTransform:
+   * \f$T_0(x) = x + d(x)\f$, with d linearly interpolated. This is a cache of
+   * the InitialTransform, so it should be computed from it. Outside the field
+   * the InitialTransform itself is used. Only used with composition.
+   * Setting the InitialTransform or the combination method removes the field.
+   */
+  virtual void SetInitialTransformDisplacementField( InitialTransformDisplacementFieldType * _arg );
+
+  itkGetModifiableObjectMacro( InitialTransformDisplacementField, InitialTransformDisplacementFieldType );
+
   /** Set/Get a pointer to the CurrentTransform.
    * Make sure to set the CurrentTransform before calling functions like
    * TransformPoint(), GetJacobian(), SetParameters() etc.
@@ -157,9 +189,39 @@ public:
 
   itkGetConstMacro( UseAddition, bool );
 
+  /** Flatten the chain of initial transforms into a list of stages, that are
+   * applied one after the other. Nested combination transforms that use
+   * composition are replaced by their initial and current transform, and
+   * consecutive linear transforms are merged into one matrix and offset.
+   * Only exact AdvancedCombinationTransform instances are replaced: a
+   * subclass may override TransformPoint(), as the DeformationFieldRegulizer
+   * does, so it is kept as one stage.
+   * The flattened initial transform is removed when the initial transform
+   * or the combination method is changed. Call this function again after
+   * that, or after changing one of the initial transforms.
+   */
+  virtual void UpdateFlattenedInitialTransform( void );
+
+  /** Return the number of stages of the flattened initial transform.
+   * Zero if the initial transform is not flattened.
+   */
+  virtual SizeValueType GetNumberOfFlattenedInitialTransformStages( void ) const
+  {
+    return static_cast< SizeValueType >( this->m_FlattenedInitialTransform.size() );
+  }
+
+
   /**  Method to transform a point. */
   OutputPointType TransformPoint( const InputPointType  & point ) const override;
 
+  /** Method to transform a batch of points. Each stage of the flattened
+   * initial transform is applied to all points, before the next stage.
+   * Subclasses, which may override TransformPoint(), call TransformPoint()
+   * for each point.
+   */
+  virtual void TransformPoints( const std::vector< InputPointType > & inputPoints,
+    std::vector< OutputPointType > & outputPoints ) const;
+
   /** ITK4 change:
    * The following pure virtual functions must be overloaded.
    * For now just throw an exception, since these are not used in elastix.
@@ -335,6 +397,13 @@ protected:
   /** Destructor. */
   ~AdvancedCombinationTransform() override{}
 
+  /** Create a copy of this transform, used by Clone(). The copy shares the
+   * InitialTransform, which is not modified during a registration, but owns
+   * a clone of the CurrentTransform, so that its parameters can be set
+   * independently of the parameters of this transform. The copy is always
+   * of type AdvancedCombinationTransform, also for derived classes. */
+  typename LightObject::Pointer InternalClone( void ) const override;
+
   /** Declaration of members. */
   InitialTransformPointer m_InitialTransform;
   CurrentTransformPointer m_CurrentTransform;
@@ -347,6 +416,41 @@ protected:
   /** Throw an exception. */
   virtual void NoCurrentTransformSet( void ) const;
 
+  /** Typedefs for the flattened initial transform. */
+  typedef Matrix< ScalarType, NDimensions, NDimensions > FlattenedMatrixType;
+  typedef Vector< ScalarType, NDimensions >              FlattenedOffsetType;
+
+  /** A stage of the flattened initial transform: a linear transform, given by
+   * its matrix and offset, when m_Transform is null, or else m_Transform.
+   */
+  struct FlattenedTransformStage
+  {
+    const InitialTransformType * m_Transform;
+    FlattenedMatrixType          m_Matrix;
+    FlattenedOffsetType          m_Offset;
+  };
+
+  typedef std::vector< FlattenedTransformStage > FlattenedTransformType;
+
+  /** Add the stages of a transform to the flattened initial transform. */
+  virtual void AppendFlattenedInitialTransformStages( const InitialTransformType * transform );
+
+  /** Apply one stage of the flattened initial transform to a point. */
+  static inline void TransformPointByStage(
+    const FlattenedTransformStage & stage, OutputPointType & point );
+
+  /** Apply the initial transform, using the displacement field or the
+   * flattened initial transform if available.
+   */
+  inline OutputPointType TransformPointByInitialTransform( const InputPointType & point ) const;
+
+  /** The flattened initial transform. */
+  FlattenedTransformType m_FlattenedInitialTransform;
+
+  /** The displacement field that replaces the initial transform, and its interpolator. */
+  InitialTransformDisplacementFieldPointer             m_InitialTransformDisplacementField;
+  InitialTransformDisplacementFieldInterpolatorPointer m_InitialTransformDisplacementFieldInterpolator;
+
   /**  A pointer to one of the following functions:
    * - TransformPointUseAddition,
    * - TransformPointUseComposition,
@@ -34,6 +34,8 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Initialize. */
   this->m_InitialTransform = nullptr;
   this->m_CurrentTransform = nullptr;
+  this->m_InitialTransformDisplacementField             = nullptr;
+  this->m_InitialTransformDisplacementFieldInterpolator = nullptr;
 
   /** Set composition by default. */
   this->m_UseAddition    = false;
@@ -547,6 +549,8 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   if( this->m_InitialTransform != _arg )
   {
     this->m_InitialTransform = _arg;
+    this->m_FlattenedInitialTransform.clear();
+    this->SetInitialTransformDisplacementField( nullptr );
     this->Modified();
     this->UpdateCombinationMethod();
   }
@@ -554,6 +558,31 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end SetInitialTransform()
 
 
+/**
+ * ******************* SetInitialTransformDisplacementField **********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::SetInitialTransformDisplacementField( InitialTransformDisplacementFieldType * _arg )
+{
+  if( this->m_InitialTransformDisplacementField != _arg )
+  {
+    this->m_InitialTransformDisplacementField             = _arg;
+    this->m_InitialTransformDisplacementFieldInterpolator = nullptr;
+    if( _arg )
+    {
+      this->m_InitialTransformDisplacementFieldInterpolator
+        = InitialTransformDisplacementFieldInterpolatorType::New();
+      this->m_InitialTransformDisplacementFieldInterpolator->SetInputImage( _arg );
+    }
+    this->Modified();
+  }
+
+} // end SetInitialTransformDisplacementField()
+
+
 /**
  * ******************* SetCurrentTransform **********************
  */
@@ -588,6 +617,8 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   {
     this->m_UseAddition    = _arg;
     this->m_UseComposition = !_arg;
+    this->m_FlattenedInitialTransform.clear();
+    this->SetInitialTransformDisplacementField( nullptr );
     this->Modified();
     this->UpdateCombinationMethod();
   }
@@ -609,6 +640,8 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   {
     this->m_UseComposition = _arg;
     this->m_UseAddition    = !_arg;
+    this->m_FlattenedInitialTransform.clear();
+    this->SetInitialTransformDisplacementField( nullptr );
     this->Modified();
     this->UpdateCombinationMethod();
   }
@@ -616,6 +649,49 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end SetUseComposition()
 
 
+/**
+ * ********************** InternalClone *******************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+typename LightObject::Pointer
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::InternalClone( void ) const
+{
+  /** Explicitly create an AdvancedCombinationTransform, since derived classes,
+   * such as the elastix transform components, cannot be used stand-alone. */
+  Pointer clone = Self::New();
+  clone->SetUseComposition( this->m_UseComposition );
+
+  /** The initial transform is shared. */
+  clone->SetInitialTransform( this->m_InitialTransform );
+
+  /** The current transform is cloned. */
+  if( this->m_CurrentTransform.IsNotNull() )
+  {
+    typename TransformType::Pointer currentClone = this->m_CurrentTransform->Clone();
+    CurrentTransformType * currentTransform
+      = dynamic_cast< CurrentTransformType * >( currentClone.GetPointer() );
+    if( currentTransform == nullptr )
+    {
+      itkExceptionMacro( << "The CurrentTransform ("
+                         << this->m_CurrentTransform->GetNameOfClass()
+                         << ") could not be cloned." );
+    }
+    clone->SetCurrentTransform( currentTransform );
+  }
+
+  /** The flattened initial transform and the displacement field refer to
+   * the shared initial transform. */
+  clone->m_FlattenedInitialTransform = this->m_FlattenedInitialTransform;
+  clone->SetInitialTransformDisplacementField( this->m_InitialTransformDisplacementField );
+
+  typename LightObject::Pointer loPtr = clone.GetPointer();
+  return loPtr;
+
+} // end InternalClone()
+
+
 /**
  * ****************** UpdateCombinationMethod ********************
  */
@@ -724,6 +800,180 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end UpdateCombinationMethod()
 
 
+/**
+ * ****************** UpdateFlattenedInitialTransform ********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::UpdateFlattenedInitialTransform( void )
+{
+  this->m_FlattenedInitialTransform.clear();
+
+  /** The flattened initial transform is only used with composition. */
+  if( !this->m_UseComposition || this->m_InitialTransform.IsNull() )
+  {
+    return;
+  }
+
+  this->AppendFlattenedInitialTransformStages( this->m_InitialTransform );
+
+} // end UpdateFlattenedInitialTransform()
+
+
+/**
+ * ****************** AppendFlattenedInitialTransformStages ********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::AppendFlattenedInitialTransformStages( const InitialTransformType * transform )
+{
+  /** A combination transform that uses composition is replaced by its stages:
+   * first those of its initial transform, then those of its current transform.
+   * A subclass may add to the result of TransformPoint(), so only exact
+   * instances of this class are replaced.
+   */
+  const Self * combinationTransform = dynamic_cast< const Self * >( transform );
+  const bool   canBeFlattened       = combinationTransform && typeid( *transform ) == typeid( Self );
+  if( canBeFlattened && combinationTransform->m_CurrentTransform.IsNotNull() )
+  {
+    if( combinationTransform->m_InitialTransform.IsNull() )
+    {
+      this->AppendFlattenedInitialTransformStages( combinationTransform->m_CurrentTransform );
+      return;
+    }
+    if( combinationTransform->m_UseComposition )
+    {
+      this->AppendFlattenedInitialTransformStages( combinationTransform->m_InitialTransform );
+      this->AppendFlattenedInitialTransformStages( combinationTransform->m_CurrentTransform );
+      return;
+    }
+  }
+
+  /** Other transforms are called as they are, except for the linear ones. */
+  FlattenedTransformStage stage;
+  stage.m_Transform = transform;
+  if( combinationTransform || !transform->IsLinear() )
+  {
+    this->m_FlattenedInitialTransform.push_back( stage );
+    return;
+  }
+
+  /** A linear transform is described by its matrix and offset:
+   * T(x) = A x + b, with b = T(0) and the columns of A: A e_j = T(e_j) - b.
+   */
+  InputPointType point;
+  point.Fill( 0.0 );
+  const OutputPointType origin = transform->TransformPoint( point );
+  for( unsigned int j = 0; j < SpaceDimension; ++j )
+  {
+    point.Fill( 0.0 );
+    point[ j ] = 1.0;
+    const OutputPointType mappedPoint = transform->TransformPoint( point );
+    for( unsigned int i = 0; i < SpaceDimension; ++i )
+    {
+      stage.m_Matrix( i, j ) = mappedPoint[ i ] - origin[ i ];
+    }
+  }
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    stage.m_Offset[ i ] = origin[ i ];
+  }
+  stage.m_Transform = nullptr;
+
+  /** Merge with the previous stage if that is linear too:
+   * A2 ( A1 x + b1 ) + b2 = ( A2 A1 ) x + ( A2 b1 + b2 ).
+   */
+  if( !this->m_FlattenedInitialTransform.empty()
+    && this->m_FlattenedInitialTransform.back().m_Transform == nullptr )
+  {
+    FlattenedTransformStage & previous = this->m_FlattenedInitialTransform.back();
+    previous.m_Offset = stage.m_Matrix * previous.m_Offset + stage.m_Offset;
+    previous.m_Matrix = stage.m_Matrix * previous.m_Matrix;
+    return;
+  }
+
+  this->m_FlattenedInitialTransform.push_back( stage );
+
+} // end AppendFlattenedInitialTransformStages()
+
+
+/**
+ * ****************** TransformPointByStage ********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::TransformPointByStage( const FlattenedTransformStage & stage, OutputPointType & point )
+{
+  if( stage.m_Transform )
+  {
+    point = stage.m_Transform->TransformPoint( point );
+    return;
+  }
+
+  OutputPointType result;
+  for( unsigned int i = 0; i < SpaceDimension; ++i )
+  {
+    ScalarType sum = stage.m_Offset[ i ];
+    for( unsigned int j = 0; j < SpaceDimension; ++j )
+    {
+      sum += stage.m_Matrix( i, j ) * point[ j ];
+    }
+    result[ i ] = sum;
+  }
+  point = result;
+
+} // end TransformPointByStage()
+
+
+/**
+ * ****************** TransformPointByInitialTransform ********************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+typename AdvancedCombinationTransform< TScalarType, NDimensions >::OutputPointType
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::TransformPointByInitialTransform( const InputPointType & point ) const
+{
+  /** Use the displacement field inside its domain. */
+  if( this->m_InitialTransformDisplacementField.IsNotNull() )
+  {
+    typename InitialTransformDisplacementFieldInterpolatorType::ContinuousIndexType cindex;
+    this->m_InitialTransformDisplacementFieldInterpolator->ConvertPointToContinuousIndex( point, cindex );
+    if( this->m_InitialTransformDisplacementFieldInterpolator->IsInsideBuffer( cindex ) )
+    {
+      const typename InitialTransformDisplacementFieldInterpolatorType::OutputType displacement
+        = this->m_InitialTransformDisplacementFieldInterpolator->EvaluateAtContinuousIndex( cindex );
+      OutputPointType result;
+      for( unsigned int i = 0; i < SpaceDimension; ++i )
+      {
+        result[ i ] = point[ i ] + displacement[ i ];
+      }
+      return result;
+    }
+  }
+
+  if( this->m_FlattenedInitialTransform.empty() )
+  {
+    return this->m_InitialTransform->TransformPoint( point );
+  }
+
+  OutputPointType result = point;
+  typename FlattenedTransformType::const_iterator it;
+  for( it = this->m_FlattenedInitialTransform.begin(); it != this->m_FlattenedInitialTransform.end(); ++it )
+  {
+    TransformPointByStage( *it, result );
+  }
+  return result;
+
+} // end TransformPointByInitialTransform()
+
+
 /**
  * ************* NoCurrentTransformSet **********************
  */
@@ -797,7 +1047,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 ::TransformPointUseComposition( const InputPointType & point ) const
 {
   return this->m_CurrentTransform->TransformPoint(
-    this->m_InitialTransform->TransformPoint( point ) );
+    this->TransformPointByInitialTransform( point ) );
 
 } // end TransformPointUseComposition()
 
@@ -864,7 +1114,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
   this->m_CurrentTransform->GetJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->TransformPointByInitialTransform( ipp ),
     j, nonZeroJacobianIndices );
 
 } // end GetJacobianUseComposition()
@@ -938,7 +1188,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
   this->m_CurrentTransform->EvaluateJacobianWithImageGradientProduct(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->TransformPointByInitialTransform( ipp ),
     movingImageGradient, imageJacobian, nonZeroJacobianIndices );
 
 } // end EvaluateJacobianWithImageGradientProductUseComposition()
@@ -1016,7 +1266,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   SpatialJacobianType sj0, sj1;
   this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetSpatialJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ), sj1 );
+    this->TransformPointByInitialTransform( ipp ), sj1 );
 
   sj = sj1 * sj0;
 
@@ -1097,7 +1347,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Transform the input point. */
   // \todo this has already been computed and it is expensive.
   InputPointType transformedPoint
-    = this->m_InitialTransform->TransformPoint( ipp );
+    = this->TransformPointByInitialTransform( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
    * internal transforms.
@@ -1210,7 +1460,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   JacobianOfSpatialJacobianType jsj1;
   this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->TransformPointByInitialTransform( ipp ),
     jsj1, nonZeroJacobianIndices );
 
   jsj.resize( nonZeroJacobianIndices.size() );
@@ -1239,7 +1489,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   JacobianOfSpatialJacobianType jsj1;
   this->m_InitialTransform->GetSpatialJacobian( ipp, sj0 );
   this->m_CurrentTransform->GetJacobianOfSpatialJacobian(
-    this->m_InitialTransform->TransformPoint( ipp ),
+    this->TransformPointByInitialTransform( ipp ),
     sj1, jsj1, nonZeroJacobianIndices );
 
   sj = sj1 * sj0;
@@ -1384,7 +1634,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Transform the input point. */
   // \todo: this has already been computed and it is expensive.
   InputPointType transformedPoint
-    = this->m_InitialTransform->TransformPoint( ipp );
+    = this->TransformPointByInitialTransform( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
    * internal transforms. */
@@ -1451,7 +1701,7 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
   /** Transform the input point. */
   // \todo this has already been computed and it is expensive.
   InputPointType transformedPoint
-    = this->m_InitialTransform->TransformPoint( ipp );
+    = this->TransformPointByInitialTransform( ipp );
 
   /** Compute the (Jacobian of the) spatial Jacobian / Hessian of the
    * internal transforms.
@@ -1612,6 +1862,57 @@ AdvancedCombinationTransform< TScalarType, NDimensions >
 } // end TransformPoint()
 
 
+/**
+ * ****************** TransformPoints ****************************
+ */
+
+template< typename TScalarType, unsigned int NDimensions >
+void
+AdvancedCombinationTransform< TScalarType, NDimensions >
+::TransformPoints( const std::vector< InputPointType > & inputPoints,
+  std::vector< OutputPointType > & outputPoints ) const
+{
+  const std::size_t numberOfPoints = inputPoints.size();
+  outputPoints.resize( numberOfPoints );
+
+  /** Without a flattened initial transform, with a displacement field, or
+   * for a subclass, which may override TransformPoint(), transform the
+   * points one by one.
+   */
+  if( this->m_FlattenedInitialTransform.empty() || this->m_InitialTransformDisplacementField.IsNotNull()
+    || typeid( *this ) != typeid( Self ) )
+  {
+    for( std::size_t k = 0; k < numberOfPoints; ++k )
+    {
+      outputPoints[ k ] = this->TransformPoint( inputPoints[ k ] );
+    }
+    return;
+  }
+
+  /** Apply the stages of the initial transform one by one to all points. */
+  for( std::size_t k = 0; k < numberOfPoints; ++k )
+  {
+    outputPoints[ k ] = inputPoints[ k ];
+  }
+  typename FlattenedTransformType::const_iterator it;
+  for( it = this->m_FlattenedInitialTransform.begin(); it != this->m_FlattenedInitialTransform.end(); ++it )
+  {
+    for( std::size_t k = 0; k < numberOfPoints; ++k )
+    {
+      TransformPointByStage( *it, outputPoints[ k ] );
+    }
+  }
+
+  /** Finally apply the current transform. */
+  const CurrentTransformType * currentTransform = this->m_CurrentTransform.GetPointer();
+  for( std::size_t k = 0; k < numberOfPoints; ++k )
+  {
+    outputPoints[ k ] = currentTransform->TransformPoint( outputPoints[ k ] );
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ****************** GetJacobian ****************************
  */
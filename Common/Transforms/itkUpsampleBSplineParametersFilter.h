@@ -20,6 +20,7 @@
 
 #include "itkObject.h"
 #include "itkArray.h"
+#include "itkPlatformMultiThreader.h"
 
 namespace itk
 {
@@ -33,6 +34,17 @@ namespace itk
  * on a denser grid. Therefore, the user needs to supply the old B-spline grid
  * (region, spacing, origin, direction), and the required B-spline grid.
  *
+ * When the required grid is a dyadic refinement of the current grid, i.e.
+ * when the grid spacing is halved and every other required grid node
+ * coincides with a current grid node, the new coefficients are computed
+ * directly with the B-spline two-scale relation. For first and third order
+ * B-splines this is a small separable stencil, e.g. (1 6 1)/8 and (4 4)/8
+ * for the even and odd nodes of a cubic B-spline, which represents the
+ * current deformation exactly. The stencil is applied multi-threaded, to
+ * all dimensions of the parameters at once. In all other cases the
+ * deformation is resampled on the required grid and decomposed into
+ * B-spline coefficients, with multi-threaded filters.
+ *
  */
 
 template< class TArray, class TImage >
@@ -63,6 +75,7 @@ public:
   typedef typename ImageType::PointType     OriginType;
   typedef typename ImageType::DirectionType DirectionType;
   typedef typename ImageType::RegionType    RegionType;
+  typedef typename ImageType::OffsetType    OffsetType;
 
   /** Dimension of the fixed image. */
   itkStaticConstMacro( Dimension, unsigned int, ImageType::ImageDimension );
@@ -94,6 +107,20 @@ public:
   /** Set the B-spline order. */
   itkSetMacro( BSplineOrder, unsigned int );
 
+  /** Set/Get whether a dyadic refinement of the grid is computed with the
+   * refinement stencil, instead of by resampling. Default: true.
+   */
+  itkSetMacro( UseDyadicRefinement, bool );
+  itkGetConstMacro( UseDyadicRefinement, bool );
+  itkBooleanMacro( UseDyadicRefinement );
+
+  /** Set the number of threads. */
+  void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfWorkUnits( numberOfThreads );
+  }
+
+
   /** Compute the output parameter array. */
   virtual void UpsampleParameters( const ArrayType & param_in,
     ArrayType & param_out );
@@ -112,6 +139,46 @@ protected:
   /** Function that checks if upsampling is required. */
   virtual bool DoUpsampling( void );
 
+  /** Function that checks if the required grid is a dyadic refinement of
+   * the current grid that can be computed with the refinement stencil. If
+   * so, firstNode is set to the position of the first required grid node,
+   * in half current grid spacings from the first current grid node.
+   */
+  virtual bool IsDyadicRefinement( OffsetType & firstNode ) const;
+
+  /** Compute the output parameters with the refinement stencil. */
+  virtual void RefineParameters( const ArrayType & param_in,
+    ArrayType & param_out, const OffsetType & firstNode );
+
+  /** Typedefs for multi-threading. */
+  typedef itk::PlatformMultiThreader ThreaderType;
+  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
+
+  ThreaderType::Pointer m_Threader;
+
+  /** To give the threads access to the in- and output of one refinement
+   * pass. A pass refines the lines along one dimension; the parameters of
+   * all dimensions are treated as separate images of the same size.
+   */
+  struct MultiThreaderParameterType
+  {
+    const Self *      st_Self;
+    const PixelType * st_Input;
+    PixelType *       st_Output;
+    SizeValueType     st_InputLength;
+    SizeValueType     st_OutputLength;
+    SizeValueType     st_Stride;
+    SizeValueType     st_NumberOfLines;
+    OffsetValueType   st_FirstNode;
+  };
+
+  /** Refine the lines of a refinement pass that belong to a thread. */
+  void ThreadedRefineLines( const MultiThreaderParameterType & parameters,
+    const ThreadIdType threadId, const ThreadIdType numberOfThreads ) const;
+
+  /** The callback function. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION RefineLinesThreaderCallback( void * arg );
+
 private:
 
   UpsampleBSplineParametersFilter( const Self & ); // purposely not implemented
@@ -127,6 +194,7 @@ private:
   DirectionType m_RequiredGridDirection;
   RegionType    m_RequiredGridRegion;
   unsigned int  m_BSplineOrder;
+  bool          m_UseDyadicRefinement;
 
 };
 
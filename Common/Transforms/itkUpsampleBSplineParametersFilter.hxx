@@ -21,9 +21,13 @@
 #include "itkUpsampleBSplineParametersFilter.h"
 
 #include "itkBSplineResampleImageFunction.h"
-#include "itkBSplineDecompositionImageFilter.h"
+#include "itkParallelBSplineDecompositionImageFilter.h"
 #include "itkResampleImageFilter.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 namespace itk
 {
 
@@ -35,7 +39,9 @@ template< class TArray, class TImage >
 UpsampleBSplineParametersFilter< TArray, TImage >
 ::UpsampleBSplineParametersFilter()
 {
-  this->m_BSplineOrder = 3;
+  this->m_BSplineOrder        = 3;
+  this->m_UseDyadicRefinement = true;
+  this->m_Threader            = ThreaderType::New();
 
   // Initialize grid settings.
   this->m_CurrentGridOrigin.Fill( 0.0 );
@@ -64,12 +70,20 @@ UpsampleBSplineParametersFilter< TArray, TImage >
     return;
   }
 
+  /** Refine the grid directly, if possible. */
+  OffsetType firstNode;
+  if( this->m_UseDyadicRefinement && this->IsDyadicRefinement( firstNode ) )
+  {
+    this->RefineParameters( parameters_in, parameters_out, firstNode );
+    return;
+  }
+
   /** Typedefs. */
   typedef itk::ResampleImageFilter<
     ImageType, ImageType >                        UpsampleFilterType;
   typedef itk::BSplineResampleImageFunction<
     ImageType, ValueType >                        CoefficientUpsampleFunctionType;
-  typedef itk::BSplineDecompositionImageFilter<
+  typedef itk::ParallelBSplineDecompositionImageFilter<
     ImageType, ImageType >                        DecompositionFilterType;
 
   /** Get the number of parameters. */
@@ -127,18 +141,17 @@ UpsampleBSplineParametersFilter< TArray, TImage >
     upsampler->SetOutputOrigin( this->m_RequiredGridOrigin );
     upsampler->SetOutputDirection( this->m_RequiredGridDirection );
     upsampler->SetInput( coeffs_in );
+    upsampler->SetNumberOfWorkUnits( this->m_Threader->GetNumberOfWorkUnits() );
 
     /** Setup the decomposition filter. */
     decompositionFilter->SetSplineOrder( this->m_BSplineOrder );
     decompositionFilter->SetInput( upsampler->GetOutput() );
+    decompositionFilter->SetNumberOfWorkUnits( this->m_Threader->GetNumberOfWorkUnits() );
 
     /** Do the upsampling. */
     try
     {
       decompositionFilter->UpdateLargestPossibleRegion();
-      // \todo: the decomposition filter could be multi-threaded
-      // by deriving it from the RecursiveSeparableImageFilter,
-      // similar to the SmoothingRecursiveGaussianImageFilter.
     }
     catch( itk::ExceptionObject & excp )
     {
@@ -183,6 +196,218 @@ UpsampleBSplineParametersFilter< TArray, TImage >
 } // end DoUpsampling()
 
 
+/**
+ * ******************* IsDyadicRefinement *******************
+ */
+
+template< class TArray, class TImage >
+bool
+UpsampleBSplineParametersFilter< TArray, TImage >
+::IsDyadicRefinement( OffsetType & firstNode ) const
+{
+  /** The required grid nodes of even B-spline orders lie between the
+   * refined basis functions, so only odd orders can be refined exactly.
+   * The stencil is implemented for the first and third order.
+   */
+  if( this->m_BSplineOrder != 1 && this->m_BSplineOrder != 3 )
+  {
+    return false;
+  }
+
+  /** The grids should have the same direction, and half the spacing. */
+  const double tolerance = 1e-6;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      if( std::abs( this->m_CurrentGridDirection[ i ][ j ]
+        - this->m_RequiredGridDirection[ i ][ j ] ) > tolerance )
+      {
+        return false;
+      }
+    }
+
+    if( std::abs( this->m_CurrentGridSpacing[ i ] - 2.0 * this->m_RequiredGridSpacing[ i ] )
+      > tolerance * this->m_CurrentGridSpacing[ i ] )
+    {
+      return false;
+    }
+  }
+
+  /** The first required grid node should lie on a current grid node, or
+   * halfway between two of them.
+   */
+  ImagePointer currentGrid = ImageType::New();
+  currentGrid->SetOrigin(  this->m_CurrentGridOrigin );
+  currentGrid->SetSpacing( this->m_CurrentGridSpacing );
+  currentGrid->SetDirection( this->m_CurrentGridDirection );
+  ImagePointer requiredGrid = ImageType::New();
+  requiredGrid->SetOrigin(  this->m_RequiredGridOrigin );
+  requiredGrid->SetSpacing( this->m_RequiredGridSpacing );
+  requiredGrid->SetDirection( this->m_RequiredGridDirection );
+
+  OriginType firstRequiredNode;
+  requiredGrid->TransformIndexToPhysicalPoint(
+    this->m_RequiredGridRegion.GetIndex(), firstRequiredNode );
+  ContinuousIndex< double, Dimension > cindex;
+  currentGrid->TransformPhysicalPointToContinuousIndex( firstRequiredNode, cindex );
+
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    const double position = 2.0 * ( cindex[ i ] - this->m_CurrentGridRegion.GetIndex()[ i ] );
+    const double rounded  = std::floor( position + 0.5 );
+    if( std::abs( position - rounded ) > 1e-3 )
+    {
+      return false;
+    }
+    firstNode[ i ] = static_cast< OffsetValueType >( rounded );
+  }
+
+  return true;
+
+} // end IsDyadicRefinement()
+
+
+/**
+ * ******************* RefineParameters *******************
+ */
+
+template< class TArray, class TImage >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::RefineParameters( const ArrayType & parameters_in,
+  ArrayType & parameters_out, const OffsetType & firstNode )
+{
+  /** Get the grid sizes. */
+  typedef typename RegionType::SizeType SizeType;
+  const SizeType currentSize  = this->m_CurrentGridRegion.GetSize();
+  const SizeType requiredSize = this->m_RequiredGridRegion.GetSize();
+
+  /** Create the new vector of output parameters, with the correct size. */
+  parameters_out.SetSize( this->m_RequiredGridRegion.GetNumberOfPixels() * Dimension );
+
+  /** The stencil is separable: the lines along each dimension are refined
+   * in a separate pass. The last pass writes to the output parameters,
+   * the others to one of two intermediate buffers.
+   */
+  std::vector< PixelType > buffers[ 2 ];
+  MultiThreaderParameterType temp;
+  temp.st_Self   = this;
+  temp.st_Input  = parameters_in.data_block();
+  temp.st_Stride = 1;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    /** The number of lines: the dimensions before d are refined already. */
+    SizeValueType numberOfLines = Dimension;
+    for( unsigned int e = 0; e < Dimension; ++e )
+    {
+      if( e < d ) { numberOfLines *= requiredSize[ e ]; }
+      else if( e > d ) { numberOfLines *= currentSize[ e ]; }
+    }
+
+    PixelType * output = parameters_out.data_block();
+    if( d < Dimension - 1 )
+    {
+      buffers[ d % 2 ].resize( numberOfLines * requiredSize[ d ] );
+      output = buffers[ d % 2 ].data();
+    }
+
+    temp.st_Output        = output;
+    temp.st_InputLength   = currentSize[ d ];
+    temp.st_OutputLength  = requiredSize[ d ];
+    temp.st_NumberOfLines = numberOfLines;
+    temp.st_FirstNode     = firstNode[ d ];
+
+    this->m_Threader->SetSingleMethod( RefineLinesThreaderCallback, &temp );
+    this->m_Threader->SingleMethodExecute();
+
+    temp.st_Input   = output;
+    temp.st_Stride *= requiredSize[ d ];
+  }
+
+} // end RefineParameters()
+
+
+/**
+ * ******************* RefineLinesThreaderCallback *******************
+ */
+
+template< class TArray, class TImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+UpsampleBSplineParametersFilter< TArray, TImage >
+::RefineLinesThreaderCallback( void * arg )
+{
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Self->ThreadedRefineLines( *temp,
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end RefineLinesThreaderCallback()
+
+
+/**
+ * ******************* ThreadedRefineLines *******************
+ */
+
+template< class TArray, class TImage >
+void
+UpsampleBSplineParametersFilter< TArray, TImage >
+::ThreadedRefineLines( const MultiThreaderParameterType & parameters,
+  const ThreadIdType threadId, const ThreadIdType numberOfThreads ) const
+{
+  /** Get the range of lines of this thread. */
+  const SizeValueType numberOfLines = parameters.st_NumberOfLines;
+  const SizeValueType chunkSize     = ( numberOfLines + numberOfThreads - 1 ) / numberOfThreads;
+  const SizeValueType begin         = std::min( chunkSize * threadId, numberOfLines );
+  const SizeValueType end           = std::min( begin + chunkSize, numberOfLines );
+
+  const SizeValueType   stride       = parameters.st_Stride;
+  const SizeValueType   outputLength = parameters.st_OutputLength;
+  const OffsetValueType inputLength  = static_cast< OffsetValueType >( parameters.st_InputLength );
+  const bool            cubic        = this->m_BSplineOrder == 3;
+
+  for( SizeValueType line = begin; line < end; ++line )
+  {
+    /** Lines along the current dimension are stride values apart. */
+    const SizeValueType inner = line % stride;
+    const SizeValueType outer = line / stride;
+    const PixelType *   in    = parameters.st_Input + outer * stride * parameters.st_InputLength + inner;
+    PixelType *         out   = parameters.st_Output + outer * stride * outputLength + inner;
+
+    for( SizeValueType j = 0; j < outputLength; ++j, out += stride )
+    {
+      /** Required node q lies at current node q / 2. Current coefficients
+       * outside the grid are zero.
+       */
+      const OffsetValueType q  = parameters.st_FirstNode + static_cast< OffsetValueType >( j );
+      const OffsetValueType k  = ( q >= 0 ) ? q / 2 : -( ( 1 - q ) / 2 );
+      const PixelType       c0 = ( k >= 0 && k < inputLength ) ? in[ k * stride ] : 0.0;
+      const PixelType       c1 = ( k + 1 >= 0 && k + 1 < inputLength ) ? in[ ( k + 1 ) * stride ] : 0.0;
+
+      if( q != 2 * k )
+      {
+        /** A required node halfway between two current nodes. */
+        *out = 0.5 * ( c0 + c1 );
+      }
+      else if( cubic )
+      {
+        const PixelType cm = ( k - 1 >= 0 && k - 1 < inputLength ) ? in[ ( k - 1 ) * stride ] : 0.0;
+        *out = ( cm + 6.0 * c0 + c1 ) / 8.0;
+      }
+      else
+      {
+        *out = c0;
+      }
+    }
+  }
+
+} // end ThreadedRefineLines()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -205,6 +430,7 @@ UpsampleBSplineParametersFilter< TArray, TImage >
   os << indent << "RequiredGridRegion: "  << this->m_RequiredGridRegion << std::endl;
 
   os << indent << "BSplineOrder: " << this->m_BSplineOrder << std::endl;
+  os << indent << "UseDyadicRefinement: " << this->m_UseDyadicRefinement << std::endl;
 
 } // end PrintSelf()
 
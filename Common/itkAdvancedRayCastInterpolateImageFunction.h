@@ -144,6 +144,20 @@ public:
   OutputType EvaluateAtContinuousIndex(
     const ContinuousIndexType & index ) const override;
 
+  /** The number of rays that EvaluateRays() traverses in lock step. */
+  itkStaticConstMacro( RayPacketSize, unsigned int, 8 );
+
+  /** Interpolate the image at a number of point positions.
+   *
+   * The result is the same as calling Evaluate() for each point, but the
+   * transformed focal point and the geometry of the volume are computed
+   * once, and packets of RayPacketSize rays are traversed in lock step.
+   * This is most efficient for neighbouring points, such as the pixels of
+   * one row of the projection image.
+   */
+  virtual void EvaluateRays( const PointType * points, OutputType * values,
+    const unsigned int numberOfRays ) const;
+
   /** Connect the Transform. */
   itkSetObjectMacro( Transform, TransformType );
   /** Get a pointer to the Transform.  */
@@ -0,0 +1,162 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineCoefficientImageCache_h
+#define __itkBSplineCoefficientImageCache_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkParallelBSplineDecompositionImageFilter.h"
+
+#include <future>
+#include <list>
+#include <mutex>
+
+namespace itk
+{
+
+/** \class BSplineCoefficientImageCache
+ * \brief Shares the B-spline coefficients of an image between interpolators.
+ *
+ * Several components interpolate the same image with B-splines, e.g. the
+ * interpolator of the metric and the one of a random coordinate sampler.
+ * Each of them would compute the same coefficient image in
+ * SetInputImage(). This cache computes the coefficients once, with the
+ * ParallelBSplineDecompositionImageFilter, and hands the result to all
+ * consumers that ask for the same image and spline order.
+ *
+ * An entry is identified by the address, the modification time and the
+ * buffered region of the image, and by the spline order. A new pyramid
+ * level is a different image (or the same image with a newer modification
+ * time), so it gets its own entry. The cache does not keep the input
+ * images alive.
+ *
+ * The cache only shares coefficients that are in use: an entry is removed
+ * as soon as no consumer holds its coefficients any more, see
+ * RemoveUnusedEntries(). The coefficients of a pyramid level are therefore
+ * released when the interpolators move to the next level, and all of them
+ * when the interpolators of a registration are destroyed. Of the entries
+ * in use, at most MaximumNumberOfEntries are kept.
+ *
+ * There is one global instance per combination of template arguments,
+ * which is obtained by GetInstance(). The cache can be used from multiple
+ * threads. The coefficients are computed outside the lock; consumers that
+ * ask for the same coefficients in the meantime wait for the result.
+ *
+ * \sa CachedBSplineInterpolateImageFunction
+ */
+
+template< class TInputImage, class TCoefficientImage >
+class BSplineCoefficientImageCache : public Object
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef BSplineCoefficientImageCache Self;
+  typedef Object                       Superclass;
+  typedef SmartPointer< Self >         Pointer;
+  typedef SmartPointer< const Self >   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( BSplineCoefficientImageCache, Object );
+
+  /** Typedefs. */
+  typedef TInputImage                                   InputImageType;
+  typedef TCoefficientImage                             CoefficientImageType;
+  typedef typename CoefficientImageType::ConstPointer   CoefficientImageConstPointer;
+  typedef typename InputImageType::RegionType           RegionType;
+  typedef ParallelBSplineDecompositionImageFilter<
+    InputImageType, CoefficientImageType >              DecompositionFilterType;
+
+  /** Get the global instance of the cache. */
+  static Pointer GetInstance( void );
+
+  /** Get the B-spline coefficients of the image. The coefficients are
+   * computed with the given number of work units if they are not in the cache.
+   */
+  CoefficientImageConstPointer GetCoefficients( const InputImageType * image,
+    const unsigned int splineOrder, const ThreadIdType numberOfWorkUnits );
+
+  /** Remove the entries of which the coefficients are not used by any
+   * consumer. Consumers call this after releasing their coefficients.
+   */
+  void RemoveUnusedEntries( void );
+
+  /** Remove all entries from the cache. */
+  void Clear( void );
+
+  /** Get the number of entries, including the pending ones. */
+  unsigned int GetNumberOfEntries( void ) const;
+
+  /** Set/Get the maximum number of coefficient images that are kept.
+   * Default: 4.
+   */
+  void SetMaximumNumberOfEntries( const unsigned int arg );
+
+  itkGetConstMacro( MaximumNumberOfEntries, unsigned int );
+
+protected:
+
+  /** The constructor. */
+  BSplineCoefficientImageCache();
+
+  /** The destructor. */
+  ~BSplineCoefficientImageCache() override {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  BSplineCoefficientImageCache( const Self & ); // purposely not implemented
+  void operator=( const Self & );               // purposely not implemented
+
+  /** The coefficients of an entry, which are pending while being computed. */
+  typedef std::shared_future< CoefficientImageConstPointer > CoefficientsFutureType;
+
+  /** One cached coefficient image. */
+  struct CacheEntryType
+  {
+    const void *           st_Image;
+    ModifiedTimeType       st_ModifiedTime;
+    RegionType             st_BufferedRegion;
+    unsigned int           st_SplineOrder;
+    CoefficientsFutureType st_Coefficients;
+  };
+
+  /** Remove the unused entries, and the least recently used ones above the
+   * maximum. Pending entries are kept. The mutex should be locked.
+   */
+  void RemoveEntries( void );
+
+  /** The entries, the most recently used first. */
+  std::list< CacheEntryType > m_Entries;
+  unsigned int                m_MaximumNumberOfEntries;
+  mutable std::mutex          m_Mutex;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBSplineCoefficientImageCache.hxx"
+#endif
+
+#endif // end #ifndef __itkBSplineCoefficientImageCache_h
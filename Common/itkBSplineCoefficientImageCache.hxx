@@ -0,0 +1,271 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBSplineCoefficientImageCache_hxx
+#define __itkBSplineCoefficientImageCache_hxx
+
+#include "itkBSplineCoefficientImageCache.h"
+
+#include <chrono>
+#include <exception>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TInputImage, class TCoefficientImage >
+BSplineCoefficientImageCache< TInputImage, TCoefficientImage >
+::BSplineCoefficientImageCache()
+{
+  this->m_MaximumNumberOfEntries = 4;
+
+} // end Constructor()
+
+
+/**
+ * ******************* GetInstance *******************
+ */
+
+template< class TInputImage, class TCoefficientImage >
+typename BSplineCoefficientImageCache< TInputImage, TCoefficientImage >::Pointer
+BSplineCoefficientImageCache< TInputImage, TCoefficientImage >
+::GetInstance( void )
+{
+  static Pointer instance = Self::New();
+  return instance;
+
+} // end GetInstance()
+
+
+/**
+ * ******************* GetCoefficients *******************
+ */
+
+template< class TInputImage, class TCoefficientImage >
+typename BSplineCoefficientImageCache< TInputImage, TCoefficientImage >::CoefficientImageConstPointer
+BSplineCoefficientImageCache< TInputImage, TCoefficientImage >
+::GetCoefficients( const InputImageType * image,
+  const unsigned int splineOrder, const ThreadIdType numberOfWorkUnits )
+{
+  if( image == nullptr ) { return nullptr; }
+
+  const ModifiedTimeType modifiedTime   = image->GetMTime();
+  const RegionType       bufferedRegion = image->GetBufferedRegion();
+
+  /** Look for the image in the cache; move a hit to the front. On a miss,
+   * add a pending entry, so that consumers asking for the same coefficients
+   * wait for this computation instead of repeating it.
+   */
+  CoefficientsFutureType                       coefficients;
+  std::promise< CoefficientImageConstPointer > promise;
+  {
+    const std::lock_guard< std::mutex > lock( this->m_Mutex );
+    for( typename std::list< CacheEntryType >::iterator it = this->m_Entries.begin();
+      it != this->m_Entries.end(); ++it )
+    {
+      if( it->st_Image == image && it->st_ModifiedTime == modifiedTime
+        && it->st_SplineOrder == splineOrder
+        && it->st_BufferedRegion == bufferedRegion )
+      {
+        this->m_Entries.splice( this->m_Entries.begin(), this->m_Entries, it );
+        coefficients = this->m_Entries.front().st_Coefficients;
+        break;
+      }
+    }
+
+    if( !coefficients.valid() )
+    {
+      CacheEntryType entry;
+      entry.st_Image          = image;
+      entry.st_ModifiedTime   = modifiedTime;
+      entry.st_BufferedRegion = bufferedRegion;
+      entry.st_SplineOrder    = splineOrder;
+      entry.st_Coefficients   = promise.get_future().share();
+      this->m_Entries.push_front( entry );
+      this->RemoveEntries();
+    }
+  }
+
+  /** A hit; this waits if the coefficients are still being computed, and
+   * rethrows if their computation failed.
+   */
+  if( coefficients.valid() )
+  {
+    return coefficients.get();
+  }
+
+  /** A miss; compute the coefficients, without holding the lock. */
+  CoefficientImageConstPointer result;
+  try
+  {
+    typename DecompositionFilterType::Pointer decompositionFilter = DecompositionFilterType::New();
+    decompositionFilter->SetSplineOrder( splineOrder );
+    decompositionFilter->SetNumberOfWorkUnits( numberOfWorkUnits );
+    decompositionFilter->SetInput( image );
+    decompositionFilter->Update();
+
+    /** Detach the coefficients, so that the filter and its input are released. */
+    typename CoefficientImageType::Pointer output = decompositionFilter->GetOutput();
+    output->DisconnectPipeline();
+    result = output;
+  }
+  catch( ... )
+  {
+    /** Forget the pending entry, and pass the error to the waiting consumers. */
+    {
+      const std::lock_guard< std::mutex > lock( this->m_Mutex );
+      for( typename std::list< CacheEntryType >::iterator it = this->m_Entries.begin();
+        it != this->m_Entries.end(); ++it )
+      {
+        if( it->st_Image == image && it->st_ModifiedTime == modifiedTime
+          && it->st_SplineOrder == splineOrder
+          && it->st_BufferedRegion == bufferedRegion )
+        {
+          this->m_Entries.erase( it );
+          break;
+        }
+      }
+    }
+    promise.set_exception( std::current_exception() );
+    throw;
+  }
+
+  promise.set_value( result );
+  return result;
+
+} // end GetCoefficients()
+
+
+/**
+ * ******************* RemoveUnusedEntries *******************
+ */
+
+template< class TInputImage, class TCoefficientImage >
+void
+BSplineCoefficientImageCache< TInputImage, TCoefficientImage >
+::RemoveUnusedEntries( void )
+{
+  const std::lock_guard< std::mutex > lock( this->m_Mutex );
+  this->RemoveEntries();
+
+} // end RemoveUnusedEntries()
+
+
+/**
+ * ******************* RemoveEntries *******************
+ */
+
+template< class TInputImage, class TCoefficientImage >
+void
+BSplineCoefficientImageCache< TInputImage, TCoefficientImage >
+::RemoveEntries( void )
+{
+  /** Coefficients that only the cache refers to are not used any more. */
+  typename std::list< CacheEntryType >::iterator it = this->m_Entries.begin();
+  while( it != this->m_Entries.end() )
+  {
+    const bool pending = it->st_Coefficients.wait_for( std::chrono::seconds( 0 ) )
+      != std::future_status::ready;
+    if( !pending && it->st_Coefficients.get()->GetReferenceCount() == 1 )
+    {
+      it = this->m_Entries.erase( it );
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  /** Forget the least recently used entries. */
+  while( this->m_Entries.size() > this->m_MaximumNumberOfEntries )
+  {
+    this->m_Entries.pop_back();
+  }
+
+} // end RemoveEntries()
+
+
+/**
+ * ******************* Clear *******************
+ */
+
+template< class TInputImage, class TCoefficientImage >
+void
+BSplineCoefficientImageCache< TInputImage, TCoefficientImage >
+::Clear( void )
+{
+  const std::lock_guard< std::mutex > lock( this->m_Mutex );
+  this->m_Entries.clear();
+
+} // end Clear()
+
+
+/**
+ * ******************* GetNumberOfEntries *******************
+ */
+
+template< class TInputImage, class TCoefficientImage >
+unsigned int
+BSplineCoefficientImageCache< TInputImage, TCoefficientImage >
+::GetNumberOfEntries( void ) const
+{
+  const std::lock_guard< std::mutex > lock( this->m_Mutex );
+  return static_cast< unsigned int >( this->m_Entries.size() );
+
+} // end GetNumberOfEntries()
+
+
+/**
+ * ******************* SetMaximumNumberOfEntries *******************
+ */
+
+template< class TInputImage, class TCoefficientImage >
+void
+BSplineCoefficientImageCache< TInputImage, TCoefficientImage >
+::SetMaximumNumberOfEntries( const unsigned int arg )
+{
+  const std::lock_guard< std::mutex > lock( this->m_Mutex );
+  this->m_MaximumNumberOfEntries = arg;
+  this->RemoveEntries();
+
+} // end SetMaximumNumberOfEntries()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TInputImage, class TCoefficientImage >
+void
+BSplineCoefficientImageCache< TInputImage, TCoefficientImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  const std::lock_guard< std::mutex > lock( this->m_Mutex );
+  os << indent << "MaximumNumberOfEntries: " << this->m_MaximumNumberOfEntries << std::endl;
+  os << indent << "NumberOfEntries: " << this->m_Entries.size() << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBSplineCoefficientImageCache_hxx
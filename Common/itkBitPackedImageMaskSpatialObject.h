@@ -0,0 +1,111 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBitPackedImageMaskSpatialObject_h
+#define __itkBitPackedImageMaskSpatialObject_h
+
+#include "itkImageMaskSpatialObject.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace itk
+{
+
+/** \class BitPackedImageMaskSpatialObject
+ * \brief An ImageMaskSpatialObject that also keeps its mask bit-packed.
+ *
+ * The bit mask has one bit per voxel of the buffered region of the image,
+ * and every line along the first dimension starts at a new word: voxel x of
+ * line l is bit x % 64 of word l * GetNumberOfWordsPerLine() + x / 64. This
+ * is the layout of ErodeMaskImageFilter::GetBitMask().
+ *
+ * The spatial object itself behaves as an ImageMaskSpatialObject. The
+ * ImageMaskLookup of the samplers and the metrics reads the bit mask instead
+ * of the pixels of the image, when it matches the buffered region.
+ *
+ * \sa ErodeMaskImageFilter, ImageMaskLookup
+ */
+
+template< unsigned int VDimension >
+class BitPackedImageMaskSpatialObject :
+  public ImageMaskSpatialObject< VDimension >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef BitPackedImageMaskSpatialObject      Self;
+  typedef ImageMaskSpatialObject< VDimension > Superclass;
+  typedef SmartPointer< Self >                 Pointer;
+  typedef SmartPointer< const Self >           ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( BitPackedImageMaskSpatialObject, ImageMaskSpatialObject );
+
+  /** Typedefs for the bit-packed mask. */
+  typedef std::uint64_t              BitWordType;
+  typedef std::vector< BitWordType > BitMaskType;
+
+  /** Set the bit-packed mask of the image, and the number of words per line.
+   * The bits after the end of a line must be zero.
+   */
+  virtual void SetBitMask( const BitMaskType & bitMask, const SizeValueType numberOfWordsPerLine );
+
+  /** Get the bit-packed mask. */
+  const BitMaskType & GetBitMask( void ) const
+  {
+    return this->m_BitMask;
+  }
+
+
+  /** Get the number of words per line of the bit-packed mask. */
+  itkGetConstMacro( NumberOfWordsPerLine, SizeValueType );
+
+  /** Check whether the bit mask has the size of the buffered region of the image. */
+  virtual bool HasValidBitMask( void ) const;
+
+protected:
+
+  /** The constructor. */
+  BitPackedImageMaskSpatialObject();
+
+  /** The destructor. */
+  ~BitPackedImageMaskSpatialObject() override {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  BitPackedImageMaskSpatialObject( const Self & ); // purposely not implemented
+  void operator=( const Self & );                  // purposely not implemented
+
+  BitMaskType   m_BitMask;
+  SizeValueType m_NumberOfWordsPerLine;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkBitPackedImageMaskSpatialObject.hxx"
+#endif
+
+#endif // end #ifndef __itkBitPackedImageMaskSpatialObject_h
@@ -0,0 +1,101 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBitPackedImageMaskSpatialObject_hxx
+#define __itkBitPackedImageMaskSpatialObject_hxx
+
+#include "itkBitPackedImageMaskSpatialObject.h"
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< unsigned int VDimension >
+BitPackedImageMaskSpatialObject< VDimension >
+::BitPackedImageMaskSpatialObject()
+{
+  this->m_NumberOfWordsPerLine = 0;
+
+} // end Constructor()
+
+
+/**
+ * ******************* SetBitMask *******************
+ */
+
+template< unsigned int VDimension >
+void
+BitPackedImageMaskSpatialObject< VDimension >
+::SetBitMask( const BitMaskType & bitMask, const SizeValueType numberOfWordsPerLine )
+{
+  this->m_BitMask              = bitMask;
+  this->m_NumberOfWordsPerLine = numberOfWordsPerLine;
+  this->Modified();
+
+} // end SetBitMask()
+
+
+/**
+ * ******************* HasValidBitMask *******************
+ */
+
+template< unsigned int VDimension >
+bool
+BitPackedImageMaskSpatialObject< VDimension >
+::HasValidBitMask( void ) const
+{
+  const typename Superclass::ImageType * image = this->GetImage();
+  if( image == nullptr || this->m_BitMask.empty() )
+  {
+    return false;
+  }
+
+  const typename Superclass::ImageType::RegionType region = image->GetBufferedRegion();
+  const SizeValueType                              length = region.GetSize( 0 );
+  if( length == 0 )
+  {
+    return false;
+  }
+  return this->m_NumberOfWordsPerLine == ( length + 63 ) / 64
+         && this->m_BitMask.size() == this->m_NumberOfWordsPerLine * ( region.GetNumberOfPixels() / length );
+
+} // end HasValidBitMask()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< unsigned int VDimension >
+void
+BitPackedImageMaskSpatialObject< VDimension >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "BitMask: " << this->m_BitMask.size() << " words" << std::endl;
+  os << indent << "NumberOfWordsPerLine: " << this->m_NumberOfWordsPerLine << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBitPackedImageMaskSpatialObject_hxx
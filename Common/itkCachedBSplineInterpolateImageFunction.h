@@ -0,0 +1,117 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCachedBSplineInterpolateImageFunction_h
+#define __itkCachedBSplineInterpolateImageFunction_h
+
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkBSplineCoefficientImageCache.h"
+
+namespace itk
+{
+
+/** \class CachedBSplineInterpolateImageFunction
+ * \brief A BSplineInterpolateImageFunction that shares its coefficients.
+ *
+ * The itk::BSplineInterpolateImageFunction computes the B-spline
+ * coefficients of the input image in SetInputImage(), single-threadedly.
+ * This class obtains them from the global BSplineCoefficientImageCache
+ * instead: they are computed multi-threadedly, and only once for all
+ * interpolators of the same image and spline order. The interpolation
+ * itself is done by the superclass.
+ *
+ * The coefficients are computed with SetNumberOfWorkUnits() work units,
+ * which the caller should set to its own number of threads. When the
+ * interpolator releases its coefficients, the cache forgets them if no
+ * other interpolator uses them.
+ *
+ * The cache can be switched off with SetUseCoefficientCache( false ),
+ * which gives the behaviour of the superclass.
+ *
+ * \sa BSplineCoefficientImageCache, ParallelBSplineDecompositionImageFilter
+ * \ingroup ImageFunctions
+ */
+
+template< class TImageType, class TCoordRep = double, class TCoefficientType = double >
+class CachedBSplineInterpolateImageFunction :
+  public BSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef CachedBSplineInterpolateImageFunction Self;
+  typedef BSplineInterpolateImageFunction<
+    TImageType, TCoordRep, TCoefficientType >   Superclass;
+  typedef SmartPointer< Self >                  Pointer;
+  typedef SmartPointer< const Self >            ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( CachedBSplineInterpolateImageFunction, BSplineInterpolateImageFunction );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::InputImageType       InputImageType;
+  typedef typename Superclass::CoefficientImageType CoefficientImageType;
+
+  /** The type of the coefficient cache. */
+  typedef BSplineCoefficientImageCache<
+    InputImageType, CoefficientImageType >          CoefficientImageCacheType;
+
+  /** Set the input image and get its coefficients from the cache. */
+  void SetInputImage( const TImageType * inputData ) override;
+
+  /** Set/Get whether the coefficients are taken from the cache. Default: true. */
+  itkSetMacro( UseCoefficientCache, bool );
+  itkGetConstMacro( UseCoefficientCache, bool );
+  itkBooleanMacro( UseCoefficientCache );
+
+  /** Set/Get the number of work units with which the coefficients are
+   * computed. Default: the global default number of threads.
+   */
+  itkSetClampMacro( NumberOfWorkUnits, ThreadIdType, 1, ITK_MAX_THREADS );
+  itkGetConstMacro( NumberOfWorkUnits, ThreadIdType );
+
+protected:
+
+  /** The constructor. */
+  CachedBSplineInterpolateImageFunction();
+
+  /** The destructor releases the coefficients in the cache. */
+  ~CachedBSplineInterpolateImageFunction() override;
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  CachedBSplineInterpolateImageFunction( const Self & ); // purposely not implemented
+  void operator=( const Self & );                        // purposely not implemented
+
+  bool         m_UseCoefficientCache;
+  ThreadIdType m_NumberOfWorkUnits;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkCachedBSplineInterpolateImageFunction.hxx"
+#endif
+
+#endif // end #ifndef __itkCachedBSplineInterpolateImageFunction_h
@@ -0,0 +1,111 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkCachedBSplineInterpolateImageFunction_hxx
+#define __itkCachedBSplineInterpolateImageFunction_hxx
+
+#include "itkCachedBSplineInterpolateImageFunction.h"
+#include "itkMultiThreaderBase.h"
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TImageType, class TCoordRep, class TCoefficientType >
+CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+::CachedBSplineInterpolateImageFunction()
+{
+  this->m_UseCoefficientCache = true;
+  this->m_NumberOfWorkUnits   = MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+
+} // end Constructor()
+
+
+/**
+ * ******************* Destructor *******************
+ */
+
+template< class TImageType, class TCoordRep, class TCoefficientType >
+CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+::~CachedBSplineInterpolateImageFunction()
+{
+  if( this->m_UseCoefficientCache && this->m_Coefficients.IsNotNull() )
+  {
+    this->m_Coefficients = nullptr;
+    CoefficientImageCacheType::GetInstance()->RemoveUnusedEntries();
+  }
+
+} // end Destructor()
+
+
+/**
+ * ******************* SetInputImage *******************
+ */
+
+template< class TImageType, class TCoordRep, class TCoefficientType >
+void
+CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+::SetInputImage( const TImageType * inputData )
+{
+  if( !this->m_UseCoefficientCache || inputData == nullptr )
+  {
+    this->Superclass::SetInputImage( inputData );
+    return;
+  }
+
+  /** Get the coefficients from the cache, computing them if needed. The
+   * coefficients of the previous input are then released, so the cache
+   * can forget them if no other interpolator uses them.
+   */
+  typename CoefficientImageCacheType::Pointer cache = CoefficientImageCacheType::GetInstance();
+  this->m_Coefficients = cache->GetCoefficients(
+    inputData, this->GetSplineOrder(), this->m_NumberOfWorkUnits );
+  cache->RemoveUnusedEntries();
+
+  /** Do what the superclass does after computing the coefficients.
+   * The implementation of the InterpolateImageFunction is called directly,
+   * to skip the single-threaded decomposition of the superclass.
+   */
+  this->Superclass::Superclass::SetInputImage( inputData );
+  this->m_DataLength = inputData->GetBufferedRegion().GetSize();
+
+} // end SetInputImage()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TImageType, class TCoordRep, class TCoefficientType >
+void
+CachedBSplineInterpolateImageFunction< TImageType, TCoordRep, TCoefficientType >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "UseCoefficientCache: " << this->m_UseCoefficientCache << std::endl;
+  os << indent << "NumberOfWorkUnits: " << this->m_NumberOfWorkUnits << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkCachedBSplineInterpolateImageFunction_hxx
@@ -25,6 +25,8 @@
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkImageFullSampler.h"
 #include "itkPlatformMultiThreader.h"
+#include <string>
+#include <vector>
 
 namespace itk
 {
@@ -108,7 +110,17 @@ public:
   /** Get the region over which the metric will be computed. */
   itkGetConstReferenceMacro( FixedImageRegion, FixedImageRegionType );
 
-  /** The main function that performs the multi-threaded computation. */
+  /** The main function that performs the multi-threaded computation.
+   * The displacement of each sample is stored at its index in the sample
+   * container, and the statistics are computed afterwards in sample order.
+   * The result is therefore identical to ComputeSingleThreaded(), and does
+   * not depend on the number of threads.
+   *
+   * Note that for the "2sigma" method this route now uses the unbiased
+   * estimate of sigma, dividing by n - 1, like ComputeSingleThreaded()
+   * always did. Before, it used the biased estimate, dividing by n, so sigma
+   * is now a factor sqrt( n / ( n - 1 ) ) larger than in earlier versions.
+   */
   virtual void Compute( const ParametersType & mu,
     double & jacg, double & maxJJ, std::string method );
 
@@ -116,9 +128,16 @@ public:
   virtual void ComputeSingleThreaded( const ParametersType & mu,
     double & jacg, double & maxJJ, std::string method );
 
+  /** Compute the distribution of the displacements J_j * mu, with mu the
+   * search direction. maxJJ is not computed and set to zero.
+   */
   virtual void ComputeUsingSearchDirection( const ParametersType & mu,
     double & jacg, double & maxJJ, std::string methods );
 
+  /** Set/Get whether the computations are multi-threaded. */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+
   /** Set the number of threads. */
   void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
   {
@@ -128,7 +147,8 @@ public:
 
   virtual void BeforeThreadedCompute( const ParametersType & mu );
 
-  virtual void AfterThreadedCompute( double & jacg, double & maxJJ );
+  virtual void AfterThreadedCompute( double & jacg, double & maxJJ,
+    const std::string & methods );
 
 protected:
 
@@ -175,6 +195,17 @@ protected:
   typedef typename TransformType::ScalarType             CoordinateRepresentationType;
   typedef typename TransformType::NumberOfParametersType NumberOfParametersType;
 
+  /** Compute the jacg term from the displacement magnitudes of all samples,
+   * using either the "95percentile" or the "2sigma" method.
+   */
+  static double ComputeDisplacementStatistics(
+    std::vector< double > & displacementMagnitudes, const std::string & methods );
+
+  /** Compute the [begin, end) range of samples for a thread. */
+  void GetSampleRangeForThread( const SizeValueType numberOfSamples,
+    const ThreadIdType threadId, const ThreadIdType numberOfThreads,
+    SizeValueType & pos_begin, SizeValueType & pos_end ) const;
+
   /** Sample the fixed image to compute the Jacobian terms. */
   // \todo: note that this is an exact copy of itk::ComputeJacobianTerms
   // in the future it would be better to refactoring this part of the code
@@ -204,8 +235,6 @@ protected:
   {
     /**  Used for accumulating variables. */
     double        st_MaxJJ;
-    double        st_Displacement;
-    double        st_DisplacementSquared;
     SizeValueType st_NumberOfPixelsCounted;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, ComputePerThreadStruct,
@@ -217,8 +246,12 @@ protected:
 
   SizeValueType               m_NumberOfPixelsCounted;
   bool                        m_UseMultiThread;
+  bool                        m_ComputeMaxJJ;
   ImageSampleContainerPointer m_SampleContainer;
 
+  /** The magnitude of the displacement J_j * g of each sample. */
+  std::vector< double > m_DisplacementMagnitudes;
+
 private:
 
   ComputeDisplacementDistribution( const Self & ); // purposely not implemented
@@ -21,6 +21,7 @@
 #include "itkComputeDisplacementDistribution.h"
 
 #include <string>
+#include <algorithm>
 #include "vnl/vnl_math.h"
 #include "vnl/vnl_fastops.h"
 #include "vnl/vnl_diag_matrix.h"
@@ -52,6 +53,7 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
 
   /** Threading related variables. */
   this->m_UseMultiThread = true;
+  this->m_ComputeMaxJJ   = true;
   this->m_Threader       = ThreaderType::New();
 
   /** Initialize the m_ThreaderParameters. */
@@ -108,14 +110,82 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   for( ThreadIdType i = 0; i < numberOfThreads; ++i )
   {
     this->m_ComputePerThreadVariables[ i ].st_MaxJJ                 = NumericTraits< double >::Zero;
-    this->m_ComputePerThreadVariables[ i ].st_Displacement          = NumericTraits< double >::Zero;
-    this->m_ComputePerThreadVariables[ i ].st_DisplacementSquared   = NumericTraits< double >::Zero;
     this->m_ComputePerThreadVariables[ i ].st_NumberOfPixelsCounted = NumericTraits< SizeValueType >::Zero;
   }
 
 } // end InitializeThreadingParameters()
 
 
+/**
+ * ************************* GetSampleRangeForThread ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeDisplacementDistribution< TFixedImage, TTransform >
+::GetSampleRangeForThread( const SizeValueType numberOfSamples,
+  const ThreadIdType threadId, const ThreadIdType numberOfThreads,
+  SizeValueType & pos_begin, SizeValueType & pos_end ) const
+{
+  const SizeValueType nrOfSamplesPerThreads
+    = static_cast< SizeValueType >( std::ceil( static_cast< double >( numberOfSamples )
+    / static_cast< double >( numberOfThreads ) ) );
+
+  pos_begin = nrOfSamplesPerThreads * threadId;
+  pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > numberOfSamples ) ? numberOfSamples : pos_begin;
+  pos_end   = ( pos_end > numberOfSamples ) ? numberOfSamples : pos_end;
+
+} // end GetSampleRangeForThread()
+
+
+/**
+ * ************************* ComputeDisplacementStatistics ************************
+ */
+
+template< class TFixedImage, class TTransform >
+double
+ComputeDisplacementDistribution< TFixedImage, TTransform >
+::ComputeDisplacementStatistics(
+  std::vector< double > & displacementMagnitudes, const std::string & methods )
+{
+  const SizeValueType nrofsamples = displacementMagnitudes.size();
+  double              jacg        = 0.0;
+
+  if( methods == "95percentile" )
+  {
+    /** Compute the 95% percentile of the distribution of JGG_k */
+    unsigned int d = static_cast< unsigned int >( nrofsamples * 0.95 );
+    std::sort( displacementMagnitudes.begin(), displacementMagnitudes.end() );
+    jacg = ( displacementMagnitudes[ d - 1 ] + displacementMagnitudes[ d ]
+      + displacementMagnitudes[ d + 1 ] ) / 3.0;
+  }
+  else if( methods == "2sigma" )
+  {
+    /** Compute the sigma of the distribution of JGG_k.
+     * The magnitudes are summed in sample order, for reproducibility.
+     * Both the single- and multi-threaded route use the unbiased estimate.
+     */
+    double globalDeformation = 0.0;
+    for( SizeValueType i = 0; i < nrofsamples; ++i )
+    {
+      globalDeformation += displacementMagnitudes[ i ];
+    }
+    double sigma    = 0.0;
+    double mean_JGG = globalDeformation / nrofsamples;
+    for( SizeValueType i = 0; i < nrofsamples; ++i )
+    {
+      sigma += vnl_math::sqr( displacementMagnitudes[ i ] - mean_JGG );
+    }
+    sigma /= ( nrofsamples - 1 ); // unbiased estimation
+    jacg   = mean_JGG + 2.0 * std::sqrt( sigma );
+  }
+
+  return jacg;
+
+} // end ComputeDisplacementStatistics()
+
+
 /**
  * ************************* ComputeSingleThreaded ************************
  */
@@ -177,7 +247,7 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   DerivativeType Jgg( outdim );
   Jgg.Fill( 0.0 );
   std::vector< double > JGG_k;
-  double                globalDeformation = 0.0;
+  JGG_k.reserve( nrofsamples );
   const double          sqrt2             = std::sqrt( static_cast< double >( 2.0 ) );
   JacobianType          jacjjacj( outdim, outdim );
 
@@ -220,31 +290,12 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
       Jgg( i ) = temp;
     }
 
-    globalDeformation += Jgg.magnitude();
     JGG_k.push_back( Jgg.magnitude() );
     ++samplenr;
 
   } // end loop over sample container
 
-  if( methods == "95percentile" )
-  {
-    /** Compute the 95% percentile of the distribution of JGG_k */
-    unsigned int d = static_cast< unsigned int >( nrofsamples * 0.95 );
-    std::sort( JGG_k.begin(), JGG_k.end() );
-    jacg = ( JGG_k[ d - 1 ] + JGG_k[ d ] + JGG_k[ d + 1 ] ) / 3.0;
-  }
-  else if( methods == "2sigma" )
-  {
-    /** Compute the sigma of the distribution of JGG_k. */
-    double sigma    = 0.0;
-    double mean_JGG = globalDeformation / samplenr;
-    for( unsigned int i = 0; i < nrofsamples; ++i )
-    {
-      sigma += vnl_math::sqr( JGG_k[ i ] - mean_JGG );
-    }
-    sigma /= ( nrofsamples - 1 ); // unbiased estimation
-    jacg   = mean_JGG + 2.0 * std::sqrt( sigma );
-  }
+  jacg = Self::ComputeDisplacementStatistics( JGG_k, methods );
 
 } // end ComputeSingleThreaded()
 
@@ -264,7 +315,6 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   {
     return this->ComputeSingleThreaded( mu, jacg, maxJJ, methods );
   }
-  // The multi-threaded route only supports methods == 2sigma for now
 
   /** Initialize multi-threading. */
   this->InitializeThreadingParameters();
@@ -273,10 +323,11 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   this->BeforeThreadedCompute( mu );
 
   /** Launch multi-threaded computation. */
+  this->m_ComputeMaxJJ = true;
   this->LaunchComputeThreaderCallback();
 
   /** Gather the jacg, maxJJ values from all threads. */
-  this->AfterThreadedCompute( jacg, maxJJ );
+  this->AfterThreadedCompute( jacg, maxJJ, methods );
 
 } // end Compute()
 
@@ -306,6 +357,9 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   /** Get samples. */
   this->SampleFixedImageForJacobianTerms( this->m_SampleContainer );
 
+  /** Allocate the per-sample displacements, which are filled by the threads. */
+  this->m_DisplacementMagnitudes.assign( this->m_SampleContainer->Size(), 0.0 );
+
 } // end BeforeThreadedCompute()
 
 
@@ -369,14 +423,10 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   const ScalesType & scales = this->GetScales();
 
   /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( numberOfThreads ) ) );
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
+  SizeValueType pos_begin = 0;
+  SizeValueType pos_end   = 0;
+  this->GetSampleRangeForThread( sampleContainerSize, threadId, numberOfThreads,
+    pos_begin, pos_end );
 
   /** Variables for nonzerojacobian indices and the Jacobian. */
   const SizeValueType sizejacind
@@ -388,15 +438,12 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
 
   /** Temporaries. */
-  //std::vector< double > JGG_k; not here so only mean + 2 sigma is supported
   DerivativeType Jgg( outdim ); Jgg.Fill( 0.0 );
   const double   sqrt2 = std::sqrt( static_cast< double >( 2.0 ) );
   JacobianType   jacjjacj( outdim, outdim );
   double         maxJJ                 = 0.0;
-  double         jggMagnitude          = 0.0;
-  double         displacement          = 0.0;
-  double         displacementSquared   = 0.0;
-  unsigned long  numberOfPixelsCounted = 0;
+  SizeValueType  numberOfPixelsCounted = 0;
+  SizeValueType  samplenr              = pos_begin;
 
   /** Create iterator over the sample container. */
   typename ImageSampleContainerType::ConstIterator threader_fiter;
@@ -423,15 +470,18 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
       }
     }
 
-    /** Compute 1st part of JJ: ||J_j||_F^2. */
-    double JJ_j = vnl_math::sqr( jacj.frobenius_norm() );
+    if( this->m_ComputeMaxJJ )
+    {
+      /** Compute 1st part of JJ: ||J_j||_F^2. */
+      double JJ_j = vnl_math::sqr( jacj.frobenius_norm() );
 
-    /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
-    vnl_fastops::ABt( jacjjacj, jacj, jacj ); // is this thread-safe?
-    JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
+      /** Compute 2nd part of JJ: 2\sqrt{2} || J_j J_j^T ||_F. */
+      vnl_fastops::ABt( jacjjacj, jacj, jacj );
+      JJ_j += 2.0 * sqrt2 * jacjjacj.frobenius_norm();
 
-    /** Max_j [JJ_j]. */
-    maxJJ = std::max( maxJJ, JJ_j );
+      /** Max_j [JJ_j]. */
+      maxJJ = std::max( maxJJ, JJ_j );
+    }
 
     /** Compute the displacement  jac * gradient. */
     for( unsigned int i = 0; i < outdim; ++i )
@@ -445,17 +495,14 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
       Jgg( i ) = temp;
     }
 
-    /** Sum the Jgg displacement for later use. */
-    jggMagnitude         = Jgg.magnitude();
-    displacement        += jggMagnitude;
-    displacementSquared += vnl_math::sqr( jggMagnitude );
+    /** Store the Jgg displacement of this sample for later use. */
+    this->m_DisplacementMagnitudes[ samplenr ] = Jgg.magnitude();
+    ++samplenr;
     numberOfPixelsCounted++;
   }
 
   /** Update the thread struct once. */
   this->m_ComputePerThreadVariables[ threadId ].st_MaxJJ                 = maxJJ;
-  this->m_ComputePerThreadVariables[ threadId ].st_Displacement          = displacement;
-  this->m_ComputePerThreadVariables[ threadId ].st_DisplacementSquared   = displacementSquared;
   this->m_ComputePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
 
 } // end ThreadedCompute()
@@ -468,36 +515,33 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
 template< class TFixedImage, class TTransform >
 void
 ComputeDisplacementDistribution< TFixedImage, TTransform >
-::AfterThreadedCompute( double & jacg, double & maxJJ )
+::AfterThreadedCompute( double & jacg, double & maxJJ,
+  const std::string & methods )
 {
   const ThreadIdType numberOfThreads = this->m_Threader->GetNumberOfWorkUnits();
 
   /** Reset all variables. */
   maxJJ = 0.0;
-  double displacement        = 0.0;
-  double displacementSquared = 0.0;
-  this->m_NumberOfPixelsCounted = 0.0;
+  this->m_NumberOfPixelsCounted = 0;
 
-  /** Accumulate thread results. */
+  /** Accumulate thread results. The maximum does not depend on the order. */
   for( ThreadIdType i = 0; i < numberOfThreads; ++i )
   {
     maxJJ                          = std::max( maxJJ, this->m_ComputePerThreadVariables[ i ].st_MaxJJ );
-    displacement                  += this->m_ComputePerThreadVariables[ i ].st_Displacement;
-    displacementSquared           += this->m_ComputePerThreadVariables[ i ].st_DisplacementSquared;
     this->m_NumberOfPixelsCounted += this->m_ComputePerThreadVariables[ i ].st_NumberOfPixelsCounted;
 
     /** Reset all variables for the next resolution. */
     this->m_ComputePerThreadVariables[ i ].st_MaxJJ                 = 0;
-    this->m_ComputePerThreadVariables[ i ].st_Displacement          = 0;
-    this->m_ComputePerThreadVariables[ i ].st_DisplacementSquared   = 0;
     this->m_ComputePerThreadVariables[ i ].st_NumberOfPixelsCounted = 0;
   }
 
-  /** Compute the sigma of the distribution of the displacements. */
-  const double meanDisplacement = displacement / this->m_NumberOfPixelsCounted;
-  const double sigma            = displacementSquared / this->m_NumberOfPixelsCounted - vnl_math::sqr( meanDisplacement );
+  /** Compute the statistics of the distribution of the displacements,
+   * in sample order, so that the result equals the single-threaded one.
+   */
+  jacg = Self::ComputeDisplacementStatistics( this->m_DisplacementMagnitudes, methods );
 
-  jacg = meanDisplacement + 2.0 * std::sqrt( sigma );
+  /** Release the memory. */
+  std::vector< double >().swap( this->m_DisplacementMagnitudes );
 
 } // end AfterThreadedCompute()
 
@@ -521,6 +565,25 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   /** Initialize. */
   maxJJ = jacg = 0.0;
 
+  /** Multi-threaded computation, with the search direction mu in place
+   * of the exact gradient, and without maxJJ.
+   */
+  if( this->m_UseMultiThread )
+  {
+    this->InitializeThreadingParameters();
+    this->m_NumberOfParameters = static_cast< unsigned int >(
+      this->m_Transform->GetNumberOfParameters() );
+    this->m_ScaledCostFunction->SetScales( this->GetScales() );
+    this->m_ExactGradient = mu;
+    this->SampleFixedImageForJacobianTerms( this->m_SampleContainer );
+    this->m_DisplacementMagnitudes.assign( this->m_SampleContainer->Size(), 0.0 );
+
+    this->m_ComputeMaxJJ = false;
+    this->LaunchComputeThreaderCallback();
+    this->AfterThreadedCompute( jacg, maxJJ, methods );
+    return;
+  }
+
   /** Get samples. */
   ImageSampleContainerPointer sampleContainer; // default-constructed (null)
   this->SampleFixedImageForJacobianTerms( sampleContainer );
@@ -563,8 +626,7 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
   DerivativeType Jgg( outdim );
   Jgg.Fill( 0.0 );
   std::vector< double > JGG_k;
-  double                globalDeformation = 0.0;
-  JacobianType          jacjjacj( outdim, outdim );
+  JGG_k.reserve( nrofsamples );
 
   samplenr = 0;
   for( iter = begin; iter != end; ++iter )
@@ -595,31 +657,12 @@ ComputeDisplacementDistribution< TFixedImage, TTransform >
       Jgg( i ) = temp;
     }
 
-    globalDeformation += Jgg.magnitude();
     JGG_k.push_back( Jgg.magnitude() );
     ++samplenr;
 
   } // end loop over sample container
 
-  if( methods == "95percentile" )
-  {
-    /** Compute the 95% percentile of the distribution of JGG_k */
-    unsigned int d = static_cast< unsigned int >( nrofsamples * 0.95 );
-    std::sort( JGG_k.begin(), JGG_k.end() );
-    jacg = ( JGG_k[ d - 1 ] + JGG_k[ d ] + JGG_k[ d + 1 ] ) / 3.0;
-  }
-  else if( methods == "2sigma" )
-  {
-    /** Compute the sigma of the distribution of JGG_k. */
-    double sigma    = 0.0;
-    double mean_JGG = globalDeformation / samplenr;
-    for( unsigned int i = 0; i < nrofsamples; ++i )
-    {
-      sigma += vnl_math::sqr( JGG_k[ i ] - mean_JGG );
-    }
-    sigma /= ( nrofsamples - 1 ); // unbiased estimation
-    jacg   = mean_JGG + 2.0 * std::sqrt( sigma );
-  }
+  jacg = Self::ComputeDisplacementStatistics( JGG_k, methods );
 } // end ComputeUsingSearchDirection()
 
 
@@ -22,6 +22,11 @@
 #include "itkImageRandomSamplerBase.h"
 #include "itkImageRandomCoordinateSampler.h"
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkPlatformMultiThreader.h"
+#include "itkArray2D.h"
+#include "vnl/vnl_sparse_matrix.h"
+#include "vnl/vnl_diag_matrix.h"
+#include <vector>
 
 namespace itk
 {
@@ -31,6 +36,12 @@ namespace itk
  * More specifically this class computes the Jacobian terms related to the automatic
  * parameter estimation for the adaptive stochastic gradient descent optimizer.
  * Details can be found in the paper.
+ *
+ * The loops over the samples are multi-threaded. For the covariance matrix
+ * the samples are divided in blocks of a fixed size, and the threads collect
+ * the elements of each block as (row, column, value) triplets. These are
+ * merged afterwards in block order, with the rows divided over the threads.
+ * The result is therefore identical for any number of threads.
  */
 
 template< class TFixedImage, class TTransform >
@@ -107,6 +118,17 @@ public:
   virtual void Compute( double & TrC, double & TrCC,
     double & maxJJ, double & maxJCJ );
 
+  /** Set the number of threads. */
+  void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfWorkUnits( numberOfThreads );
+  }
+
+
+  /** Set/Get whether the computations are multi-threaded. */
+  itkSetMacro( UseMultiThread, bool );
+  itkGetConstMacro( UseMultiThread, bool );
+
 protected:
 
   ComputeJacobianTerms();
@@ -123,6 +145,13 @@ protected:
   unsigned int  m_NumberOfBandStructureSamples;
   SizeValueType m_NumberOfJacobianMeasurements;
 
+  /** Typedefs for multi-threading. */
+  typedef itk::PlatformMultiThreader ThreaderType;
+  typedef ThreaderType::WorkUnitInfo ThreadInfoType;
+
+  ThreaderType::Pointer m_Threader;
+  bool                  m_UseMultiThread;
+
   typedef typename  FixedImageType::IndexType   FixedImageIndexType;
   typedef typename  FixedImageType::PointType   FixedImagePointType;
   typedef typename  TransformType::JacobianType JacobianType;
@@ -145,12 +174,105 @@ protected:
   typedef typename TransformType::ScalarType             CoordinateRepresentationType;
   typedef typename TransformType::NumberOfParametersType NumberOfParametersType;
 
+  /** Typedefs for the covariance matrix. */
+  typedef double                                   CovarianceValueType;
+  typedef Array2D< CovarianceValueType >           CovarianceMatrixType;
+  typedef vnl_sparse_matrix< CovarianceValueType > SparseCovarianceMatrixType;
+  typedef SparseCovarianceMatrixType::row          SparseRowType;
+  typedef Array< SizeValueType >                   NonZeroJacobianIndicesExpandedType;
+  typedef vnl_diag_matrix< CovarianceValueType >   DiagCovarianceMatrixType;
+
   /** Sample the fixed image to compute the Jacobian terms. */
   // \todo: note that this is an exact copy of itk::ComputeDisplacementDistribution
   // in the future it would be better to refactoring this part of the code.
   virtual void SampleFixedImageForJacobianTerms(
     ImageSampleContainerPointer & sampleContainer );
 
+  /** An element C(p,q), with q >= p, of the covariance matrix, in
+   * coordinate (COO) format.
+   */
+  struct CovarianceTripletType
+  {
+    unsigned int        st_Row;
+    unsigned int        st_Column;
+    CovarianceValueType st_Value;
+  };
+  typedef std::vector< CovarianceTripletType > CovarianceTripletContainerType;
+
+  /** The samples are processed in blocks of NumberOfSamplesPerBlock samples.
+   * Each block collects its part of the covariance matrix as triplets, which
+   * are merged in block order afterwards. The result therefore does not
+   * depend on the number of threads.
+   */
+  itkStaticConstMacro( NumberOfSamplesPerBlock, SizeValueType, 1024 );
+
+  /** The triplets of a block are sorted and the duplicates summed when
+   * their number exceeds MaximumNumberOfTripletsPerBlock.
+   */
+  itkStaticConstMacro( MaximumNumberOfTripletsPerBlock, SizeValueType, 1048576 );
+
+  /** The per-thread results of the maxima. */
+  struct ComputePerThreadStruct
+  {
+    double st_MaxJJ;
+    double st_MaxJCJ;
+  };
+
+  /** To give the threads access to all in- and outputs. */
+  struct MultiThreaderParameterType
+  {
+    Self *                                       st_Self;
+    ImageSampleContainerType *                   st_SampleContainer;
+    const std::vector< unsigned int > *          st_BandCovMap;
+    unsigned int                                 st_BandCovSize;
+    CovarianceMatrixType *                       st_BandCovariance;
+    SparseCovarianceMatrixType *                 st_Covariance;
+    const DiagCovarianceMatrixType *             st_DiagCovariance;
+    std::vector< CovarianceTripletContainerType > st_BlockCovariances;
+    std::vector< ComputePerThreadStruct >        st_PerThreadVariables;
+  };
+
+  /** Compute the [begin, end) range of blocks or parameters for a thread. */
+  static void GetRangeForThread( const SizeValueType size,
+    const ThreadIdType threadId, const ThreadIdType numberOfThreads,
+    SizeValueType & begin, SizeValueType & end );
+
+  /** Add J_j^T J_j / n of a series of samples with equal nonzero
+   * Jacobian indices to the triplets of a block.
+   */
+  static void AddToBlockCovariance( CovarianceTripletContainerType & triplets,
+    const CovarianceMatrixType & jactjac, const NonZeroJacobianIndicesType & jacind,
+    const double n );
+
+  /** Sort the triplets on row and column, and sum the duplicates, in the
+   * order in which they were added.
+   */
+  static void CompactTriplets( CovarianceTripletContainerType & triplets );
+
+  /** Comparison functions for sorting and searching the triplets. */
+  static bool TripletLess( const CovarianceTripletType & a, const CovarianceTripletType & b );
+
+  static bool TripletRowLess( const CovarianceTripletType & a, const unsigned int row );
+
+  /** TERM 1: collect C = 1/n \sum_i J_i^T J_i over the blocks of a thread. */
+  void ThreadedComputeCovariance( MultiThreaderParameterType & parameters,
+    const ThreadIdType threadId, const ThreadIdType numberOfThreads );
+
+  /** Merge the triplets of all blocks, for a range of rows. */
+  void ThreadedMergeCovariance( MultiThreaderParameterType & parameters,
+    const ThreadIdType threadId, const ThreadIdType numberOfThreads );
+
+  /** TERM 3 and 4: compute maxJJ and maxJCJ over the samples of a thread. */
+  void ThreadedComputeMaxima( MultiThreaderParameterType & parameters,
+    const ThreadIdType threadId, const ThreadIdType numberOfThreads );
+
+  /** The callback functions. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ComputeCovarianceThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION MergeCovarianceThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ComputeMaximaThreaderCallback( void * arg );
+
 private:
 
   ComputeJacobianTerms( const Self & ); // purposely not implemented
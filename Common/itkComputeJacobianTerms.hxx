@@ -24,6 +24,7 @@
 #include "vnl/vnl_fastops.h"
 #include "vnl/vnl_diag_matrix.h"
 #include "vnl/vnl_sparse_matrix.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -45,6 +46,10 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   this->m_NumberOfBandStructureSamples = 0;
   this->m_NumberOfJacobianMeasurements = 0;
 
+  /** Threading related variables. */
+  this->m_UseMultiThread = true;
+  this->m_Threader       = ThreaderType::New();
+
 } // end Constructor
 
 
@@ -73,13 +78,6 @@ ComputeJacobianTerms< TFixedImage, TTransform >
    * Term 4: maxJCJ, see (54)
    */
 
-  typedef double                                   CovarianceValueType;
-  typedef itk::Array2D< CovarianceValueType >      CovarianceMatrixType;
-  typedef vnl_sparse_matrix< CovarianceValueType > SparseCovarianceMatrixType;
-  typedef SparseCovarianceMatrixType::row          SparseRowType;
-  typedef itk::Array< SizeValueType >              NonZeroJacobianIndicesExpandedType;
-  typedef vnl_diag_matrix< CovarianceValueType >   DiagCovarianceMatrixType;
-
   /** Initialize. */
   TrC = TrCC = maxJJ = maxJCJ = 0.0;
 
@@ -87,26 +85,17 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   ImageSampleContainerPointer sampleContainer; // default-constructed (null)
   SampleFixedImageForJacobianTerms( sampleContainer );
   const SizeValueType nrofsamples = sampleContainer->Size();
-  const double        n           = static_cast< double >( nrofsamples );
 
   /** Get the number of parameters. */
   const unsigned int P = static_cast< unsigned int >(
     this->m_Transform->GetNumberOfParameters() );
 
   /** Get transform and set current position. */
-  typename TransformType::Pointer transform
-    = this->m_Transform;
   const unsigned int outdim = this->m_Transform->GetOutputSpaceDimension();
 
   /** Get scales vector */
   const ScalesType & scales = this->m_Scales;
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator iter;
-  typename ImageSampleContainerType::ConstIterator begin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator end   = sampleContainer->End();
-  unsigned int samplenr = 0;
-
   /** Variables for nonzerojacobian indices and the Jacobian. */
   NumberOfParametersType sizejacind
     = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
@@ -115,17 +104,12 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   NonZeroJacobianIndicesType jacind( sizejacind );
   jacind[ 0 ] = 0;
   if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
-  NonZeroJacobianIndicesType prevjacind = jacind;
 
   /** Initialize covariance matrix. Sparse, diagonal, and band form. */
   SparseCovarianceMatrixType cov( P, P );
   DiagCovarianceMatrixType   diagcov( P, 0.0 );
   CovarianceMatrixType       bandcov;
 
-  /** For temporary storage of J'J. */
-  CovarianceMatrixType jactjac( sizejacind, sizejacind );
-  jactjac.Fill( 0.0 );
-
   typedef std::vector< unsigned int >             DifHistType;
   typedef std::pair< unsigned int, unsigned int > FreqPairType;
   typedef std::vector< FreqPairType >             DifHist2Type;
@@ -220,104 +204,39 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   bandcov = CovarianceMatrixType( P, bandcovsize );
   bandcov.Fill( 0.0 );
 
+  /** Setup the threader and the struct that gives the threads access
+   * to the in- and outputs.
+   */
+  ThreaderType::Pointer local_threader = ThreaderType::New();
+  local_threader->SetNumberOfWorkUnits(
+    this->m_UseMultiThread ? this->m_Threader->GetNumberOfWorkUnits() : 1 );
+
+  MultiThreaderParameterType temp;
+  temp.st_Self            = this;
+  temp.st_SampleContainer = sampleContainer.GetPointer();
+  temp.st_BandCovMap      = &bandcovMap;
+  temp.st_BandCovSize     = bandcovsize;
+  temp.st_BandCovariance  = &bandcov;
+  temp.st_Covariance      = &cov;
+  temp.st_DiagCovariance  = &diagcov;
+  temp.st_BlockCovariances.resize(
+    ( nrofsamples + NumberOfSamplesPerBlock - 1 ) / NumberOfSamplesPerBlock );
+  temp.st_PerThreadVariables.resize( local_threader->GetNumberOfWorkUnits() );
+
   /**
    *    TERM 1
    *
    * Loop over image and compute Jacobian.
    * Compute C = 1/n \sum_i J_i^T J_i
    * Possibly apply scaling afterwards.
+   * Each block of samples collects its own triplets of C, which are
+   * merged afterwards.
    */
-  jacind[ 0 ] = 0;
-  if( sizejacind > 1 ) { jacind[ 1 ] = 0; }
-  for( iter = begin; iter != end; ++iter )
-  {
-    /** Print progress 0-50%.
-     *progressObserver->UpdateAndPrintProgress( samplenr );*/
-    ++samplenr;
-
-    /** Read fixed coordinates and get Jacobian J_j. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind  );
-
-    /** Skip invalid Jacobians in the beginning, if any. */
-    if( sizejacind > 1 )
-    {
-      if( jacind[ 0 ] == jacind[ 1 ] ) { continue; }
-    }
-
-    if( jacind == prevjacind )
-    {
-      /** Update sum of J_j^T J_j. */
-      vnl_fastops::inc_X_by_AtA( jactjac, jacj );
-    }
-    else
-    {
-      /** The following should only be done after the first sample. */
-      if( iter != begin )
-      {
-        /** Update covariance matrix. */
-        for( unsigned int pi = 0; pi < sizejacind; ++pi )
-        {
-          const unsigned int p = prevjacind[ pi ];
-          for( unsigned int qi = 0; qi < sizejacind; ++qi )
-          {
-            const unsigned int q = prevjacind[ qi ];
-            if( q >= p )
-            {
-              const double tempval = jactjac( pi, qi ) / n;
-              if( std::abs( tempval ) > 1e-14 )
-              {
-                const unsigned int bandindex = bandcovMap[ q - p ];
-                if( bandindex < bandcovsize )
-                {
-                  bandcov( p, bandindex ) += tempval;
-                }
-                else
-                {
-                  cov( p, q ) += tempval;
-                }
-              }
-            }
-          } // qi
-        }   // pi
-      }     // end if
-
-      /** Initialize jactjac by J_j^T J_j. */
-      vnl_fastops::AtA( jactjac, jacj );
-
-      /** Remember nonzerojacobian indices. */
-      prevjacind = jacind;
-    } // end else
-
-  } // end iter loop: end computation of covariance matrix
-
-  /** Update covariance matrix once again to include last jactjac updates
-   * \todo: a bit ugly that this loop is copied from above.
-   */
-  for( unsigned int pi = 0; pi < sizejacind; ++pi )
-  {
-    const unsigned int p = prevjacind[ pi ];
-    for( unsigned int qi = 0; qi < sizejacind; ++qi )
-    {
-      const unsigned int q = prevjacind[ qi ];
-      if( q >= p )
-      {
-        const double tempval = jactjac( pi, qi ) / n;
-        if( std::abs( tempval ) > 1e-14 )
-        {
-          const unsigned int bandindex = bandcovMap[ q - p ];
-          if( bandindex < bandcovsize )
-          {
-            bandcov( p, bandindex ) += tempval;
-          }
-          else
-          {
-            cov( p, q ) += tempval;
-          }
-        }
-      }
-    } // qi
-  }   // pi
+  local_threader->SetSingleMethod( ComputeCovarianceThreaderCallback, &temp );
+  local_threader->SingleMethodExecute();
+  local_threader->SetSingleMethod( MergeCovarianceThreaderCallback, &temp );
+  local_threader->SingleMethodExecute();
+  std::vector< CovarianceTripletContainerType >().swap( temp.st_BlockCovariances );
 
   /** Copy the bandmatrix into the sparse matrix and empty the bandcov matrix.
    * \todo: perhaps work further with this bandmatrix instead.
@@ -390,10 +309,311 @@ ComputeJacobianTerms< TFixedImage, TTransform >
    * \li maxJJ = max_j [ ||J_j||_F^2 + 2\sqrt{2} || J_j J_j^T ||_F ]
    * \li maxJCJ = max_j [ Tr( J_j C J_j^T ) + 2\sqrt{2} || J_j C J_j^T ||_F ]
    */
-  maxJJ  = 0.0;
-  maxJCJ = 0.0;
-  const double sqrt2 = std::sqrt( static_cast< double >( 2.0 ) );
+  local_threader->SetSingleMethod( ComputeMaximaThreaderCallback, &temp );
+  local_threader->SingleMethodExecute();
+
+  /** The maxima do not depend on the order of the threads. */
+  for( std::size_t t = 0; t < temp.st_PerThreadVariables.size(); ++t )
+  {
+    maxJJ  = std::max( maxJJ, temp.st_PerThreadVariables[ t ].st_MaxJJ );
+    maxJCJ = std::max( maxJCJ, temp.st_PerThreadVariables[ t ].st_MaxJCJ );
+  }
+
+} // end Compute()
+
+
+/**
+ * ************************* GetRangeForThread ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::GetRangeForThread( const SizeValueType size,
+  const ThreadIdType threadId, const ThreadIdType numberOfThreads,
+  SizeValueType & begin, SizeValueType & end )
+{
+  begin = size * threadId / numberOfThreads;
+  end   = size * ( threadId + 1 ) / numberOfThreads;
+
+} // end GetRangeForThread()
+
+
+/**
+ * ************************* AddToBlockCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::AddToBlockCovariance( CovarianceTripletContainerType & triplets,
+  const CovarianceMatrixType & jactjac, const NonZeroJacobianIndicesType & jacind,
+  const double n )
+{
+  const unsigned int sizejacind = jacind.size();
+
+  for( unsigned int pi = 0; pi < sizejacind; ++pi )
+  {
+    const unsigned int p = jacind[ pi ];
+    for( unsigned int qi = 0; qi < sizejacind; ++qi )
+    {
+      const unsigned int q = jacind[ qi ];
+      if( q >= p )
+      {
+        const double tempval = jactjac( pi, qi ) / n;
+        if( std::abs( tempval ) > 1e-14 )
+        {
+          const CovarianceTripletType triplet = { p, q, tempval };
+          triplets.push_back( triplet );
+        }
+      }
+    } // qi
+  }   // pi
+
+  /** Limit the memory use of a block. */
+  if( triplets.size() > MaximumNumberOfTripletsPerBlock )
+  {
+    Self::CompactTriplets( triplets );
+  }
+
+} // end AddToBlockCovariance()
+
+
+/**
+ * ************************* CompactTriplets ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::CompactTriplets( CovarianceTripletContainerType & triplets )
+{
+  /** A stable sort keeps the duplicates in the order in which they were added. */
+  std::stable_sort( triplets.begin(), triplets.end(), &Self::TripletLess );
+
+  std::size_t last = 0;
+  for( std::size_t i = 1; i < triplets.size(); ++i )
+  {
+    if( triplets[ i ].st_Row == triplets[ last ].st_Row
+      && triplets[ i ].st_Column == triplets[ last ].st_Column )
+    {
+      triplets[ last ].st_Value += triplets[ i ].st_Value;
+    }
+    else
+    {
+      triplets[ ++last ] = triplets[ i ];
+    }
+  }
+  if( !triplets.empty() )
+  {
+    triplets.resize( last + 1 );
+  }
+
+} // end CompactTriplets()
+
+
+/**
+ * ************************* TripletLess ************************
+ */
+
+template< class TFixedImage, class TTransform >
+bool
+ComputeJacobianTerms< TFixedImage, TTransform >
+::TripletLess( const CovarianceTripletType & a, const CovarianceTripletType & b )
+{
+  return a.st_Row < b.st_Row || ( a.st_Row == b.st_Row && a.st_Column < b.st_Column );
+
+} // end TripletLess()
+
+
+/**
+ * ************************* TripletRowLess ************************
+ */
+
+template< class TFixedImage, class TTransform >
+bool
+ComputeJacobianTerms< TFixedImage, TTransform >
+::TripletRowLess( const CovarianceTripletType & a, const unsigned int row )
+{
+  return a.st_Row < row;
+
+} // end TripletRowLess()
+
+
+/**
+ * ************************* ThreadedComputeCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ThreadedComputeCovariance( MultiThreaderParameterType & parameters,
+  const ThreadIdType threadId, const ThreadIdType numberOfThreads )
+{
+  ImageSampleContainerType &   sampleContainer = *parameters.st_SampleContainer;
+  const SizeValueType          nrofsamples     = sampleContainer.Size();
+  const double                 n               = static_cast< double >( nrofsamples );
+  const unsigned int           outdim          = this->m_Transform->GetOutputSpaceDimension();
+  const NumberOfParametersType sizejacind      = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+
+  /** Get the blocks for this thread. */
+  SizeValueType block_begin = 0;
+  SizeValueType block_end   = 0;
+  Self::GetRangeForThread( parameters.st_BlockCovariances.size(), threadId, numberOfThreads,
+    block_begin, block_end );
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+  NonZeroJacobianIndicesType prevjacind( sizejacind );
+
+  /** For temporary storage of J'J. */
+  CovarianceMatrixType jactjac( sizejacind, sizejacind );
+  jactjac.Fill( 0.0 );
+
+  for( SizeValueType block = block_begin; block < block_end; ++block )
+  {
+    CovarianceTripletContainerType & triplets = parameters.st_BlockCovariances[ block ];
+    triplets.clear();
+
+    const SizeValueType pos_begin = block * NumberOfSamplesPerBlock;
+    const SizeValueType pos_end   = std::min( pos_begin + NumberOfSamplesPerBlock, nrofsamples );
+
+    /** Consecutive samples with the same nonzero Jacobian indices are summed
+     * in jactjac, which is added to the triplets of the block once.
+     */
+    bool jactjacIsValid = false;
+    for( SizeValueType s = pos_begin; s < pos_end; ++s )
+    {
+      /** Read fixed coordinates and get Jacobian J_j. */
+      const FixedImagePointType & point = sampleContainer.ElementAt( s ).m_ImageCoordinates;
+      this->m_Transform->GetJacobian( point, jacj, jacind );
+
+      /** Skip invalid Jacobians in the beginning, if any. */
+      if( sizejacind > 1 )
+      {
+        if( jacind[ 0 ] == jacind[ 1 ] ) { continue; }
+      }
+
+      if( jactjacIsValid && jacind == prevjacind )
+      {
+        /** Update sum of J_j^T J_j. */
+        vnl_fastops::inc_X_by_AtA( jactjac, jacj );
+      }
+      else
+      {
+        /** Update covariance matrix. */
+        if( jactjacIsValid )
+        {
+          Self::AddToBlockCovariance( triplets, jactjac, prevjacind, n );
+        }
+
+        /** Initialize jactjac by J_j^T J_j. */
+        vnl_fastops::AtA( jactjac, jacj );
+
+        /** Remember nonzerojacobian indices. */
+        prevjacind     = jacind;
+        jactjacIsValid = true;
+      }
+
+    } // end loop over samples
+
+    /** Update covariance matrix once again to include last jactjac updates. */
+    if( jactjacIsValid )
+    {
+      Self::AddToBlockCovariance( triplets, jactjac, prevjacind, n );
+    }
+
+    /** Sort the triplets, for the merge. */
+    Self::CompactTriplets( triplets );
+
+  } // end loop over blocks
+
+} // end ThreadedComputeCovariance()
+
+
+/**
+ * ************************* ThreadedMergeCovariance ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ThreadedMergeCovariance( MultiThreaderParameterType & parameters,
+  const ThreadIdType threadId, const ThreadIdType numberOfThreads )
+{
+  /** Each thread merges a range of rows, so that no two threads write
+   * the same row of the band or sparse matrix. The blocks are added in
+   * block order.
+   */
+  const std::vector< unsigned int > & bandcovMap  = *parameters.st_BandCovMap;
+  const unsigned int                  bandcovsize = parameters.st_BandCovSize;
+  CovarianceMatrixType &              bandcov     = *parameters.st_BandCovariance;
+  SparseCovarianceMatrixType &        cov         = *parameters.st_Covariance;
+
+  SizeValueType pmin = 0;
+  SizeValueType pmax = 0;
+  Self::GetRangeForThread( cov.rows(), threadId, numberOfThreads, pmin, pmax );
 
+  for( std::size_t block = 0; block < parameters.st_BlockCovariances.size(); ++block )
+  {
+    /** The triplets are sorted on row, so find the first one of this thread. */
+    const CovarianceTripletContainerType & triplets = parameters.st_BlockCovariances[ block ];
+    typename CovarianceTripletContainerType::const_iterator it = std::lower_bound(
+      triplets.begin(), triplets.end(), static_cast< unsigned int >( pmin ), &Self::TripletRowLess );
+
+    for( ; it != triplets.end() && it->st_Row < pmax; ++it )
+    {
+      const unsigned int p         = it->st_Row;
+      const unsigned int q         = it->st_Column;
+      const unsigned int bandindex = bandcovMap[ q - p ];
+      if( bandindex < bandcovsize )
+      {
+        bandcov( p, bandindex ) += it->st_Value;
+      }
+      else
+      {
+        cov( p, q ) += it->st_Value;
+      }
+    }
+  }
+
+} // end ThreadedMergeCovariance()
+
+
+/**
+ * ************************* ThreadedComputeMaxima ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ThreadedComputeMaxima( MultiThreaderParameterType & parameters,
+  const ThreadIdType threadId, const ThreadIdType numberOfThreads )
+{
+  ImageSampleContainerType &       sampleContainer = *parameters.st_SampleContainer;
+  SparseCovarianceMatrixType &     cov             = *parameters.st_Covariance;
+  const DiagCovarianceMatrixType & diagcov         = *parameters.st_DiagCovariance;
+  const ScalesType &               scales          = this->m_Scales;
+
+  const unsigned int P = static_cast< unsigned int >(
+    this->m_Transform->GetNumberOfParameters() );
+  const unsigned int           outdim     = this->m_Transform->GetOutputSpaceDimension();
+  const NumberOfParametersType sizejacind = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+
+  /** Get the samples for this thread. */
+  SizeValueType pos_begin = 0;
+  SizeValueType pos_end   = 0;
+  Self::GetRangeForThread( sampleContainer.Size(), threadId, numberOfThreads, pos_begin, pos_end );
+
+  double       maxJJ  = 0.0;
+  double       maxJCJ = 0.0;
+  const double sqrt2  = std::sqrt( static_cast< double >( 2.0 ) );
+
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType         jacind( sizejacind );
   JacobianType                       jacjjacj( outdim, outdim );
   JacobianType                       jacjcov( outdim, sizejacind );
   DiagCovarianceMatrixType           diagcovsparse( sizejacind );
@@ -402,11 +622,10 @@ ComputeJacobianTerms< TFixedImage, TTransform >
   JacobianType                       jacjcovjacj( outdim, outdim );
   NonZeroJacobianIndicesExpandedType jacindExpanded( P );
 
-  samplenr = 0;
-  for( iter = begin; iter != end; ++iter )
+  for( SizeValueType s = pos_begin; s < pos_end; ++s )
   {
     /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
+    const FixedImagePointType & point = sampleContainer.ElementAt( s ).m_ImageCoordinates;
     this->m_Transform->GetJacobian( point, jacj, jacind  );
 
     /** Apply scales, if necessary. */
@@ -456,8 +675,8 @@ ComputeJacobianTerms< TFixedImage, TTransform >
       const unsigned int p = jacind[ pi ];
       if( !cov.empty_row( p ) )
       {
-        SparseRowType & covrowp = cov.get_row( p );
-        typename SparseRowType::iterator covrowpit;
+        const SparseRowType & covrowp = cov.get_row( p );
+        typename SparseRowType::const_iterator covrowpit;
 
         /** Loop over row p of the sparse cov matrix. */
         for( covrowpit = covrowp.begin(); covrowpit != covrowp.end(); ++covrowpit )
@@ -502,16 +721,75 @@ ComputeJacobianTerms< TFixedImage, TTransform >
     /** Max_j [JCJ_j]. */
     maxJCJ = std::max( maxJCJ, JCJ_j );
 
-    /** Show progress 50-100%. */
-    //progressObserver->UpdateAndPrintProgress( samplenr + nrofsamples );
-    ++samplenr;
+  } // end loop over samples
 
-  } // end loop over sample container
+  parameters.st_PerThreadVariables[ threadId ].st_MaxJJ  = maxJJ;
+  parameters.st_PerThreadVariables[ threadId ].st_MaxJCJ = maxJCJ;
 
-  /** Finalize progress information. */
-  //progressObserver->PrintProgress( 1.0 );
+} // end ThreadedComputeMaxima()
 
-} // end Compute()
+
+/**
+ * ************ ComputeCovarianceThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ComputeCovarianceThreaderCallback( void * arg )
+{
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Self->ThreadedComputeCovariance( *temp,
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeCovarianceThreaderCallback()
+
+
+/**
+ * ************ MergeCovarianceThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ComputeJacobianTerms< TFixedImage, TTransform >
+::MergeCovarianceThreaderCallback( void * arg )
+{
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Self->ThreadedMergeCovariance( *temp,
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end MergeCovarianceThreaderCallback()
+
+
+/**
+ * ************ ComputeMaximaThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ComputeJacobianTerms< TFixedImage, TTransform >
+::ComputeMaximaThreaderCallback( void * arg )
+{
+  ThreadInfoType *             infoStruct = static_cast< ThreadInfoType * >( arg );
+  MultiThreaderParameterType * temp
+    = static_cast< MultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Self->ThreadedComputeMaxima( *temp,
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeMaximaThreaderCallback()
 
 
 /**
@@ -100,6 +100,8 @@ public:
 
   /** The main function that performs the computation.
    * B-spline specific thing we tried. Can be removed later.
+   * The loop over the samples is multi-threaded, with per-thread
+   * accumulators that are merged in thread order.
    */
   virtual void ComputeForBSplineOnly( const ParametersType & mu,
     const double & delta, double & maxJJ, ParametersType & preconditioner );
@@ -139,10 +141,46 @@ protected:
   typedef typename Superclass::CoordinateRepresentationType  CoordinateRepresentationType;
   typedef typename Superclass::NumberOfParametersType        NumberOfParametersType;
 
+  typedef typename Superclass::ThreaderType                  ThreaderType;
+  typedef typename Superclass::ThreadInfoType                ThreadInfoType;
+
   double m_MaximumStepLength;
   double m_RegularizationKappa;
   double m_ConditionNumber;
 
+  /** Per-thread accumulators of ComputeForBSplineOnly(). */
+  struct BSplineOnlyPerThreadStruct
+  {
+    std::vector< double > st_LocalStepSize;
+    std::vector< double > st_LocalStepSizeSquared;
+    std::vector< double > st_BinCount;
+  };
+
+  /** To give the threads access to the in- and outputs of ComputeForBSplineOnly(). */
+  struct BSplineOnlyThreaderParameterType
+  {
+    Self *                                    st_Self;
+    const DerivativeType *                    st_ExactGradient;
+    ImageSampleContainerType *                st_SampleContainer;
+    std::vector< BSplineOnlyPerThreadStruct > st_PerThreadVariables;
+    ParametersType *                          st_LocalStepSize;
+    std::vector< double > *                   st_LocalStepSizeSquared;
+    ParametersType *                          st_BinCount;
+  };
+
+  /** Accumulate the local step sizes over the samples of a thread. */
+  void ThreadedComputeForBSplineOnly( BSplineOnlyThreaderParameterType & parameters,
+    const ThreadIdType threadId, const ThreadIdType numberOfThreads );
+
+  /** Merge the per-thread accumulators, for a range of parameters. */
+  void ThreadedMergeForBSplineOnly( BSplineOnlyThreaderParameterType & parameters,
+    const ThreadIdType threadId, const ThreadIdType numberOfThreads );
+
+  /** The callback functions. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ComputeForBSplineOnlyThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION MergeForBSplineOnlyThreaderCallback( void * arg );
+
 private:
 
   ComputePreconditionerUsingDisplacementDistribution( const Self & ); // purposely not implemented
@@ -200,85 +200,108 @@ ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
   binCount.Fill( 0.0 );
   unsigned int samplenr = 0; // needed for global value only
 
-  for( iter = begin; iter != end; ++iter )
+#if METHOD_BSPLINE == 3
+  if( this->m_UseMultiThread )
   {
-    /** Read fixed coordinates and get Jacobian. */
-    const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
-    this->m_Transform->GetJacobian( point, jacj, jacind );
-
-    /** Compute the product jac_j * gradient. */
-    for( unsigned int i = 0; i < outdim; ++i )
+    /** Fill the threader parameter struct with information. */
+    BSplineOnlyThreaderParameterType temp;
+    temp.st_Self                 = this;
+    temp.st_ExactGradient        = &exactgradient;
+    temp.st_SampleContainer      = sampleContainer.GetPointer();
+    temp.st_LocalStepSize        = &preconditioner;
+    temp.st_LocalStepSizeSquared = &localStepSizeSquared;
+    temp.st_BinCount             = &binCount;
+    temp.st_PerThreadVariables.resize( this->m_Threader->GetNumberOfWorkUnits() );
+
+    /** Accumulate over the samples, and merge the per-thread results. */
+    this->m_Threader->SetSingleMethod( ComputeForBSplineOnlyThreaderCallback, &temp );
+    this->m_Threader->SingleMethodExecute();
+    this->m_Threader->SetSingleMethod( MergeForBSplineOnlyThreaderCallback, &temp );
+    this->m_Threader->SingleMethodExecute();
+  }
+  else
+#endif
+  {
+    for( iter = begin; iter != end; ++iter )
     {
-      double temp = 0.0;
-      for( unsigned int j = 0; j < sizejacind; ++j )
+      /** Read fixed coordinates and get Jacobian. */
+      const FixedImagePointType & point = ( *iter ).Value().m_ImageCoordinates;
+      this->m_Transform->GetJacobian( point, jacj, jacind );
+
+      /** Compute the product jac_j * gradient. */
+      for( unsigned int i = 0; i < outdim; ++i )
       {
-        int pj = jacind[ j ];
-        temp += jacj( i, j ) * exactgradient( pj );
+        double temp = 0.0;
+        for( unsigned int j = 0; j < sizejacind; ++j )
+        {
+          int pj = jacind[ j ];
+          temp += jacj( i, j ) * exactgradient( pj );
+        }
+
+        // Use the absolute value
+        jacj_g( i ) = std::abs( temp );
       }
 
-      // Use the absolute value
-      jacj_g( i ) = std::abs( temp );
-    }
+      /** A support region is where this voxel has the affect on the B-Spline
+       * grid mesh, which means each voxel has an influence on multiple grid
+       * control point, or means each control point is determined by multiple
+       * voxels.
+       */
+      for( unsigned int j = 0; j < sizejacind; ++j )
+      {
+        /** Select the only nonzero entry of the displacement jacj_g (B-spline specific). */
+        //const unsigned int nonzerodim = j / ( sizejacind / outdim );
+        //double displacement = jacj_g[ nonzerodim ];
+        // For the affine transform the nonzero dim would be different
+        // For a generic transform we would need the norm over all dimensions
 
-    /** A support region is where this voxel has the affect on the B-Spline
-     * grid mesh, which means each voxel has an influence on multiple grid
-     * control point, or means each control point is determined by multiple
-     * voxels.
-     */
-    for( unsigned int j = 0; j < sizejacind; ++j )
-    {
-      /** Select the only nonzero entry of the displacement jacj_g (B-spline specific). */
-      //const unsigned int nonzerodim = j / ( sizejacind / outdim );
-      //double displacement = jacj_g[ nonzerodim ];
-      // For the affine transform the nonzero dim would be different
-      // For a generic transform we would need the norm over all dimensions
+        unsigned int nonzerodim = j / outdim;                         // Affine, first 9 parameters
+        if( j >= outdim * outdim ) nonzerodim = j - outdim * outdim;  // Affine, last 3
+        if( P > 13 ) nonzerodim = j / ( sizejacind / outdim );        // B-spline
 
-      unsigned int nonzerodim = j / outdim;                         // Affine, first 9 parameters
-      if( j >= outdim * outdim ) nonzerodim = j - outdim * outdim;  // Affine, last 3
-      if( P > 13 ) nonzerodim = j / ( sizejacind / outdim );        // B-spline
-
-      double displacement = jacj_g[nonzerodim];
+        double displacement = jacj_g[nonzerodim];
 
 #if METHOD_BSPLINE == 1
-      /** Add the deformations on the compact support region. */
-      /** Count the numbers of the contributed voxels. */
-      if( compactSupportVector[ j % supportRegionSize ] > 0 )
-      {
+        /** Add the deformations on the compact support region. */
+        /** Count the numbers of the contributed voxels. */
+        if( compactSupportVector[ j % supportRegionSize ] > 0 )
+        {
+          int pj = jacind[ j ];
+          preconditioner[ pj ] += displacement;
+          localStepSizeSquared[ pj ] += displacement * displacement;
+          binCount[ pj ] += 1;
+        }
+        // MS: as far as I understand the above code compactSupportVector[.] will
+        // be 1 in the middle and 0 in the outer rim.
+#elif METHOD_BSPLINE == 2
+        // MS: the following will be all 1 in the complete support region
         int pj = jacind[ j ];
         preconditioner[ pj ] += displacement;
         localStepSizeSquared[ pj ] += displacement * displacement;
         binCount[ pj ] += 1;
-      }
-      // MS: as far as I understand the above code compactSupportVector[.] will
-      // be 1 in the middle and 0 in the outer rim.
-#elif METHOD_BSPLINE == 2
-      // MS: the following will be all 1 in the complete support region
-      int pj = jacind[ j ];
-      preconditioner[ pj ] += displacement;
-      localStepSizeSquared[ pj ] += displacement * displacement;
-      binCount[ pj ] += 1;
 #elif METHOD_BSPLINE == 3
-      // MS: the following will use the Jacobian as weights
-      const unsigned int pj = jacind[ j ];
-      const double weight = std::abs( jacj( nonzerodim, j ) );
-      // YQ: the weight is positive.
-
-      /** localStepSize keeps track of the mean displacement.
-       * localStepSizeSquared keeps track of the standard deviation.
-       */
-      preconditioner[ pj ] += weight * displacement;
-      localStepSizeSquared[ pj ] += weight * displacement * displacement;
-      binCount[ pj ] += weight;
+        // MS: the following will use the Jacobian as weights
+        const unsigned int pj = jacind[ j ];
+        const double weight = std::abs( jacj( nonzerodim, j ) );
+        // YQ: the weight is positive.
+
+        /** localStepSize keeps track of the mean displacement.
+         * localStepSizeSquared keeps track of the standard deviation.
+         */
+        preconditioner[ pj ] += weight * displacement;
+        localStepSizeSquared[ pj ] += weight * displacement * displacement;
+        binCount[ pj ] += weight;
 #endif
-    }
+      }
 
-    /** Add them for global step size. */
-    double voxelDeformationTmp = jacj_g.magnitude();
-    globalDeformation += voxelDeformationTmp;
-    globalDeformationSquare += voxelDeformationTmp * voxelDeformationTmp;
+      /** Add them for global step size. */
+      double voxelDeformationTmp = jacj_g.magnitude();
+      globalDeformation += voxelDeformationTmp;
+      globalDeformationSquare += voxelDeformationTmp * voxelDeformationTmp;
 
-    ++samplenr;
-  } // end loop over sample container
+      ++samplenr;
+    } // end loop over sample container
+  } // end single-threaded
 
   /** Compute the sigma of the distribution of JGG_k.
   double meanGlobalDeformation = globalDeformation / samplenr;
@@ -330,6 +353,163 @@ ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
 } // end ComputeForBSplineOnly()
 
 
+/**
+ * ************ ComputeForBSplineOnlyThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
+::ComputeForBSplineOnlyThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *                   infoStruct = static_cast< ThreadInfoType * >( arg );
+  BSplineOnlyThreaderParameterType * temp
+    = static_cast< BSplineOnlyThreaderParameterType * >( infoStruct->UserData );
+
+  /** Call the real implementation. */
+  temp->st_Self->ThreadedComputeForBSplineOnly( *temp,
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeForBSplineOnlyThreaderCallback()
+
+
+/**
+ * ************ MergeForBSplineOnlyThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TTransform >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
+::MergeForBSplineOnlyThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType *                   infoStruct = static_cast< ThreadInfoType * >( arg );
+  BSplineOnlyThreaderParameterType * temp
+    = static_cast< BSplineOnlyThreaderParameterType * >( infoStruct->UserData );
+
+  /** Call the real implementation. */
+  temp->st_Self->ThreadedMergeForBSplineOnly( *temp,
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end MergeForBSplineOnlyThreaderCallback()
+
+
+/**
+ * ************************* ThreadedComputeForBSplineOnly ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
+::ThreadedComputeForBSplineOnly( BSplineOnlyThreaderParameterType & parameters,
+  const ThreadIdType threadId, const ThreadIdType numberOfThreads )
+{
+  const unsigned int P = static_cast< unsigned int >(
+    this->m_Transform->GetNumberOfParameters() );
+  const unsigned int    outdim        = this->m_Transform->GetOutputSpaceDimension();
+  const SizeValueType   sizejacind    = this->m_Transform->GetNumberOfNonZeroJacobianIndices();
+  const DerivativeType & exactgradient = *parameters.st_ExactGradient;
+
+  /** Get the samples for this thread. */
+  SizeValueType pos_begin = 0;
+  SizeValueType pos_end   = 0;
+  this->GetSampleRangeForThread( parameters.st_SampleContainer->Size(),
+    threadId, numberOfThreads, pos_begin, pos_end );
+
+  /** Allocate the accumulators of this thread. */
+  BSplineOnlyPerThreadStruct & local = parameters.st_PerThreadVariables[ threadId ];
+  local.st_LocalStepSize.assign( P, 0.0 );
+  local.st_LocalStepSizeSquared.assign( P, 0.0 );
+  local.st_BinCount.assign( P, 0.0 );
+
+  /** Variables for nonzerojacobian indices and the Jacobian. */
+  JacobianType jacj( outdim, sizejacind );
+  jacj.Fill( 0.0 );
+  NonZeroJacobianIndicesType jacind( sizejacind );
+  DerivativeType             jacj_g( outdim );
+
+  for( SizeValueType s = pos_begin; s < pos_end; ++s )
+  {
+    /** Read fixed coordinates and get Jacobian. */
+    const FixedImagePointType & point
+      = parameters.st_SampleContainer->ElementAt( s ).m_ImageCoordinates;
+    this->m_Transform->GetJacobian( point, jacj, jacind );
+
+    /** Compute the absolute value of the product jac_j * gradient. */
+    for( unsigned int i = 0; i < outdim; ++i )
+    {
+      double temp = 0.0;
+      for( unsigned int j = 0; j < sizejacind; ++j )
+      {
+        temp += jacj( i, j ) * exactgradient( jacind[ j ] );
+      }
+      jacj_g( i ) = std::abs( temp );
+    }
+
+    /** Accumulate the Jacobian weighted displacements, see ComputeForBSplineOnly(). */
+    for( unsigned int j = 0; j < sizejacind; ++j )
+    {
+      unsigned int nonzerodim = j / outdim;                         // Affine, first 9 parameters
+      if( j >= outdim * outdim ) nonzerodim = j - outdim * outdim;  // Affine, last 3
+      if( P > 13 ) nonzerodim = j / ( sizejacind / outdim );        // B-spline
+
+      const double       displacement = jacj_g[ nonzerodim ];
+      const unsigned int pj           = jacind[ j ];
+      const double       weight       = std::abs( jacj( nonzerodim, j ) );
+
+      local.st_LocalStepSize[ pj ]        += weight * displacement;
+      local.st_LocalStepSizeSquared[ pj ] += weight * displacement * displacement;
+      local.st_BinCount[ pj ]             += weight;
+    }
+  } // end loop over samples
+
+} // end ThreadedComputeForBSplineOnly()
+
+
+/**
+ * ************************* ThreadedMergeForBSplineOnly ************************
+ */
+
+template< class TFixedImage, class TTransform >
+void
+ComputePreconditionerUsingDisplacementDistribution< TFixedImage, TTransform >
+::ThreadedMergeForBSplineOnly( BSplineOnlyThreaderParameterType & parameters,
+  const ThreadIdType threadId, const ThreadIdType numberOfThreads )
+{
+  /** Each thread merges a range of parameters. The per-thread results are
+   * added in thread order, so that the result is reproducible.
+   */
+  const SizeValueType P    = parameters.st_LocalStepSize->GetSize();
+  const SizeValueType pmin = P * threadId / numberOfThreads;
+  const SizeValueType pmax = P * ( threadId + 1 ) / numberOfThreads;
+
+  const std::vector< BSplineOnlyPerThreadStruct > & perThread = parameters.st_PerThreadVariables;
+  ParametersType &        localStepSize        = *parameters.st_LocalStepSize;
+  std::vector< double > & localStepSizeSquared = *parameters.st_LocalStepSizeSquared;
+  ParametersType &        binCount             = *parameters.st_BinCount;
+
+  for( SizeValueType p = pmin; p < pmax; ++p )
+  {
+    double sum = 0.0, sumSquared = 0.0, count = 0.0;
+    for( std::size_t t = 0; t < perThread.size(); ++t )
+    {
+      sum        += perThread[ t ].st_LocalStepSize[ p ];
+      sumSquared += perThread[ t ].st_LocalStepSizeSquared[ p ];
+      count      += perThread[ t ].st_BinCount[ p ];
+    }
+    localStepSize[ p ]        += sum;
+    localStepSizeSquared[ p ] += sumSquared;
+    binCount[ p ]             += count;
+  }
+
+} // end ThreadedMergeForBSplineOnly()
+
+
 /**
  * ************************* Compute ************************
  */
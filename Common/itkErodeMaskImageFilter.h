@@ -21,6 +21,9 @@
 #include "itkImageToImageFilter.h"
 #include "itkMultiResolutionPyramidImageFilter.h"
 
+#include <cstdint>
+#include <vector>
+
 namespace itk
 {
 /**
@@ -48,6 +51,20 @@ namespace itk
  *   the derivative of the metric.\n
  *   --> <tt>radius = static_cast<unsigned long>( 2 * schedule + 1 );</tt>
  *
+ * The erosion equals that of the ParabolicErodeImageFilter with scale
+ * radius^2 / 2 + 1, which, for a mask, is an erosion with a box of
+ * 2 * radius + 1 voxels, with the voxels outside the image counting as
+ * inside the mask. Box erosions compose: eroding with radius a and then
+ * with radius b gives the erosion with radius a + b. The filter therefore
+ * computes the eroded masks of all resolution levels at once, each from
+ * the level with the largest smaller radius, and keeps them bit-packed:
+ * one bit per voxel, every line along the first dimension starting at a
+ * new word. Along the other dimensions 64 voxels are eroded with a single
+ * operation. When only the ResolutionLevel changes, the output is
+ * unpacked from the stored bits, without eroding again.
+ *
+ * The output has the value of the input inside the eroded mask, and zero
+ * elsewhere.
  *
  * \sa ParabolicErodeImageFilter
  *
@@ -92,6 +109,12 @@ public:
     InputImageType, OutputImageType >                    ImagePyramidFilterType;
   typedef typename ImagePyramidFilterType::ScheduleType ScheduleType;
 
+  /** Typedefs for the bit-packed masks. */
+  typedef std::uint64_t                                  BitWordType;
+  typedef std::vector< BitWordType >                     BitMaskType;
+  typedef FixedArray< SizeValueType,
+    itkGetStaticConstMacro( ImageDimension ) >           RadiusType;
+
   /** Set/Get the pyramid schedule used to downsample the image whose
    * mask is the input of the ErodeMaskImageFilter
    * Default: filled with ones, one resolution.
@@ -117,6 +140,19 @@ public:
   itkSetMacro( ResolutionLevel, unsigned int );
   itkGetConstMacro( ResolutionLevel, unsigned int );
 
+  /** Get the bit-packed eroded mask of a resolution level, valid after an
+   * update. Voxel x of line l (along the first dimension) is bit x % 64 of
+   * word l * GetNumberOfWordsPerLine() + x / 64.
+   */
+  const BitMaskType & GetBitMask( unsigned int level ) const
+  {
+    return this->m_BitMasks[ level ];
+  }
+
+
+  /** Get the number of words per line of the bit-packed masks. */
+  itkGetConstMacro( NumberOfWordsPerLine, SizeValueType );
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   /** Begin concept checking */
   itkConceptMacro( SameDimensionCheck,
@@ -133,20 +169,85 @@ protected:
   ~ErodeMaskImageFilter() override{}
 
   /** Standard pipeline method. While this class does not implement a
-   * ThreadedGenerateData(), its GenerateData() delegates all
-   * calculations to the ParabolicErodeImageFilter, which is multi-threaded.
+   * ThreadedGenerateData(), its GenerateData() distributes the
+   * packing, erosion and unpacking of the masks over the threads.
    */
   void GenerateData( void ) override;
 
+  /** This filter requires all of the input image. */
+  void GenerateInputRequestedRegion( void ) override;
+
+  /** This filter must produce all of its output at once. */
+  void EnlargeOutputRequestedRegion( DataObject * output ) override;
+
+  /** Compute the bit-packed eroded masks of all levels, if the input,
+   * the schedule or IsMovingMask changed since they were last computed.
+   */
+  virtual void UpdateBitMasks( void );
+
 private:
 
   ErodeMaskImageFilter( const Self & );    // purposely not implemented
   void operator=( const Self & );          // purposely not implemented
 
+  /** The operations that are distributed over the threads. */
+  enum ThreadedOperationType { PackOperation, ErodeOperation, UnpackOperation };
+
+  /** Run one operation multi-threaded; dst is eroded from src with the given
+   * radius along the given direction.
+   */
+  void ExecuteThreadedOperation( const ThreadedOperationType operation,
+    const BitWordType * src, BitWordType * dst,
+    const unsigned int direction, const SizeValueType radius );
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ThreaderCallback( void * arg );
+
+  /** Pack the input mask, for the lines of a thread. */
+  void ThreadedPack( ThreadIdType threadId, ThreadIdType numberOfThreads );
+
+  /** Erode along the first dimension, for the lines of a thread. */
+  void ThreadedErodeLines( ThreadIdType threadId, ThreadIdType numberOfThreads );
+
+  /** Erode along another dimension, for the columns of words of a thread. */
+  void ThreadedErodeColumns( ThreadIdType threadId, ThreadIdType numberOfThreads );
+
+  /** Unpack the mask of the current level to the output, for the lines of a thread. */
+  void ThreadedUnpack( ThreadIdType threadId, ThreadIdType numberOfThreads );
+
+  /** Compute the [begin, end) range of lines or columns for a thread. */
+  static void GetRangeForThread( const SizeValueType size,
+    const ThreadIdType threadId, const ThreadIdType numberOfThreads,
+    SizeValueType & begin, SizeValueType & end );
+
+  /** Find the first bit with the given value at or after position x of a
+   * line of the given length. Returns the length if there is none.
+   */
+  static SizeValueType FindNextBit( const BitWordType * line,
+    const SizeValueType x, const SizeValueType length, const bool value );
+
+  /** Set the bits [begin, end) of a line. */
+  static void SetBits( BitWordType * line, const SizeValueType begin, const SizeValueType end );
+
   bool         m_IsMovingMask;
   unsigned int m_ResolutionLevel;
   ScheduleType m_Schedule;
 
+  /** The bit-packed eroded masks of all levels, and what they were computed from. */
+  std::vector< BitMaskType > m_BitMasks;
+  SizeValueType              m_NumberOfWordsPerLine;
+  const InputImageType *     m_BitMasksInput;
+  ModifiedTimeType           m_BitMasksInputTime;
+  ScheduleType               m_BitMasksSchedule;
+  bool                       m_BitMasksIsMovingMask;
+
+  /** The current threaded operation. */
+  ThreadedOperationType m_Operation;
+  const BitWordType *   m_OperationSource;
+  BitWordType *         m_OperationDestination;
+  unsigned int          m_OperationDirection;
+  SizeValueType         m_OperationRadius;
+
 };
 
 } // end namespace itk
@@ -19,8 +19,9 @@
 #define _itkErodeMaskImageFilter_hxx
 
 #include "itkErodeMaskImageFilter.h"
-#include "itkParabolicErodeImageFilter.h"
-//#include "itkThresholdImageFilter.h"
+
+#include <algorithm>
+#include <utility>
 
 namespace itk
 {
@@ -40,9 +41,58 @@ ErodeMaskImageFilter< TImage >
   defaultSchedule.Fill( NumericTraits< unsigned int >::OneValue() );
   this->m_Schedule = defaultSchedule;
 
+  this->m_NumberOfWordsPerLine = 0;
+  this->m_BitMasksInput        = nullptr;
+  this->m_BitMasksInputTime    = 0;
+  this->m_BitMasksIsMovingMask = false;
+
+  this->m_Operation            = PackOperation;
+  this->m_OperationSource      = nullptr;
+  this->m_OperationDestination = nullptr;
+  this->m_OperationDirection   = 0;
+  this->m_OperationRadius      = 0;
+
 } // end Constructor
 
 
+/**
+ * ************* GenerateInputRequestedRegion *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::GenerateInputRequestedRegion( void )
+{
+  /** This filter requires all of the input image to be in the buffer. */
+  InputImageType * inputPtr = const_cast< InputImageType * >( this->GetInput() );
+  if( inputPtr )
+  {
+    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end GenerateInputRequestedRegion()
+
+
+/**
+ * ************* EnlargeOutputRequestedRegion *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  /** This filter produces all of the output image at once. */
+  OutputImageType * imgData = dynamic_cast< OutputImageType * >( output );
+  if( imgData )
+  {
+    imgData->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end EnlargeOutputRequestedRegion()
+
+
 /**
  * ************* GenerateData *******************
  */
@@ -52,56 +102,494 @@ void
 ErodeMaskImageFilter< TImage >
 ::GenerateData( void )
 {
-  /** Typedefs. */
-  //typedef itk::ThresholdImageFilter<InputImageType> ThresholdFilterType;
-  typedef itk::ParabolicErodeImageFilter<
-    InputImageType, OutputImageType >               ErodeFilterType;
-  typedef typename ErodeFilterType::RadiusType     RadiusType;
-  typedef typename ErodeFilterType::ScalarRealType ScalarRealType;
-
-  /** Get the correct radius. */
-  RadiusType     radiusarray;
-  ScalarRealType radius   = 0.0;
-  ScalarRealType schedule = 0.0;
-  for( unsigned int i = 0; i < InputImageDimension; ++i )
-  {
-    schedule = static_cast< ScalarRealType >(
-      this->GetSchedule()[ this->GetResolutionLevel() ][ i ] );
-    if( !this->GetIsMovingMask() )
+  /** Erode the masks of all levels, if not done already. */
+  this->UpdateBitMasks();
+
+  if( this->m_ResolutionLevel >= this->m_BitMasks.size() )
+  {
+    itkExceptionMacro( << "The ResolutionLevel (" << this->m_ResolutionLevel
+                       << ") is not smaller than the number of levels of the schedule ("
+                       << this->m_BitMasks.size() << ")." );
+  }
+
+  /** Allocate the output and unpack the mask of the current level. */
+  OutputImagePointer outputPtr = this->GetOutput();
+  outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
+  outputPtr->Allocate();
+
+  this->ExecuteThreadedOperation( UnpackOperation,
+    this->m_BitMasks[ this->m_ResolutionLevel ].data(), nullptr, 0, 0 );
+
+} // end GenerateData()
+
+
+/**
+ * ************* UpdateBitMasks *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::UpdateBitMasks( void )
+{
+  const InputImageType * inputPtr       = this->GetInput();
+  const unsigned int     numberOfLevels = this->m_Schedule.rows();
+
+  /** Nothing to do if the masks were computed for the same input and settings. */
+  if( inputPtr == this->m_BitMasksInput
+    && inputPtr->GetMTime() == this->m_BitMasksInputTime
+    && this->m_Schedule == this->m_BitMasksSchedule
+    && this->m_IsMovingMask == this->m_BitMasksIsMovingMask
+    && this->m_BitMasks.size() == numberOfLevels )
+  {
+    return;
+  }
+
+  /** Get the radius of each level. */
+  std::vector< RadiusType > radii( numberOfLevels );
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
+  {
+    for( unsigned int i = 0; i < InputImageDimension; ++i )
+    {
+      const SizeValueType schedule = this->m_Schedule[ level ][ i ];
+      radii[ level ][ i ] = this->m_IsMovingMask ? 2 * schedule + 1 : schedule + 1;
+    }
+  }
+
+  /** Pack the input mask. */
+  const typename InputImageType::SizeType size = inputPtr->GetBufferedRegion().GetSize();
+  this->m_NumberOfWordsPerLine = ( size[ 0 ] + 63 ) / 64;
+  const SizeValueType numberOfWords = this->m_NumberOfWordsPerLine
+    * ( inputPtr->GetBufferedRegion().GetNumberOfPixels() / size[ 0 ] );
+
+  BitMaskType inputBits( numberOfWords );
+  this->ExecuteThreadedOperation( PackOperation, nullptr, inputBits.data(), 0, 0 );
+
+  /** Compute the levels in the order of increasing total radius. */
+  std::vector< SizeValueType >                              totalRadii( numberOfLevels, 0 );
+  std::vector< std::pair< SizeValueType, unsigned int > > order( numberOfLevels );
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
+  {
+    for( unsigned int i = 0; i < InputImageDimension; ++i )
     {
-      radius = schedule + 1.0;
+      totalRadii[ level ] += radii[ level ][ i ];
     }
-    else
+    order[ level ] = std::make_pair( totalRadii[ level ], level );
+  }
+  std::sort( order.begin(), order.end() );
+
+  this->m_BitMasks.assign( numberOfLevels, BitMaskType() );
+  std::vector< bool > computed( numberOfLevels, false );
+  BitMaskType         scratch( numberOfWords );
+  for( unsigned int k = 0; k < numberOfLevels; ++k )
+  {
+    const unsigned int level = order[ k ].second;
+
+    /** Start from the computed level with the largest radius that is
+     * nowhere larger than the radius of this level, or from the input.
+     */
+    const BitMaskType * source = &inputBits;
+    RadiusType          sourceRadius;
+    sourceRadius.Fill( 0 );
+    SizeValueType sourceTotalRadius = 0;
+    for( unsigned int other = 0; other < numberOfLevels; ++other )
     {
-      radius = 2.0 * schedule + 1.0;
+      if( !computed[ other ] || totalRadii[ other ] < sourceTotalRadius ) { continue; }
+      bool smaller = true;
+      for( unsigned int i = 0; i < InputImageDimension; ++i )
+      {
+        smaller &= radii[ other ][ i ] <= radii[ level ][ i ];
+      }
+      if( smaller )
+      {
+        source            = &this->m_BitMasks[ other ];
+        sourceRadius      = radii[ other ];
+        sourceTotalRadius = totalRadii[ other ];
+      }
     }
-    // Very specific computation for the parabolic erosion filter:
-    radius = radius * radius / 2.0 + 1.0;
 
-    radiusarray.SetElement( i, radius );
+    /** Erode with the remaining radius, one dimension at a time. */
+    this->m_BitMasks[ level ] = *source;
+    for( unsigned int i = 0; i < InputImageDimension; ++i )
+    {
+      const SizeValueType radius = radii[ level ][ i ] - sourceRadius[ i ];
+      if( radius == 0 ) { continue; }
+
+      this->ExecuteThreadedOperation( ErodeOperation,
+        this->m_BitMasks[ level ].data(), scratch.data(), i, radius );
+      this->m_BitMasks[ level ].swap( scratch );
+    }
+    computed[ level ] = true;
   }
 
-  /** Threshold the data first. Every voxel with intensity >= 1 is used.
-  // Not needed since IsInside of a mask checks for != 0.
-  typename ThresholdFilterType::Pointer threshold = ThresholdFilterType::New();
-  threshold->ThresholdAbove(  itk::NumericTraits<InputPixelType>::OneValue() );
-  threshold->SetOutsideValue( itk::NumericTraits<InputPixelType>::OneValue() );
-  threshold->SetInput( this->GetInput() ); */
+  /** Remember what the masks were computed from. */
+  this->m_BitMasksInput        = inputPtr;
+  this->m_BitMasksInputTime    = inputPtr->GetMTime();
+  this->m_BitMasksSchedule     = this->m_Schedule;
+  this->m_BitMasksIsMovingMask = this->m_IsMovingMask;
+
+} // end UpdateBitMasks()
+
 
-  /** Create and run the erosion filter. */
-  typename ErodeFilterType::Pointer erosion = ErodeFilterType::New();
-  erosion->SetUseImageSpacing( false );
-  erosion->SetScale( radiusarray );
-  //erosion->SetInput( threshold->GetOutput() );
-  erosion->SetInput( this->GetInput() );
-  erosion->Update();
+/**
+ * ************* ExecuteThreadedOperation *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::ExecuteThreadedOperation( const ThreadedOperationType operation,
+  const BitWordType * src, BitWordType * dst,
+  const unsigned int direction, const SizeValueType radius )
+{
+  this->m_Operation            = operation;
+  this->m_OperationSource      = src;
+  this->m_OperationDestination = dst;
+  this->m_OperationDirection   = direction;
+  this->m_OperationRadius      = radius;
+
+  this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+  this->GetMultiThreader()->SetSingleMethod( ThreaderCallback, this );
+  this->GetMultiThreader()->SingleMethodExecute();
+
+} // end ExecuteThreadedOperation()
+
+
+/**
+ * ************* ThreaderCallback *******************
+ */
 
-  /** Graft the output of the mini-pipeline back onto the filter's output.
-   * this copies back the region ivars and meta-data.
+template< class TImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ErodeMaskImageFilter< TImage >
+::ThreaderCallback( void * arg )
+{
+  typedef typename MultiThreaderBase::WorkUnitInfo ThreadInfoType;
+  ThreadInfoType *   infoStruct      = static_cast< ThreadInfoType * >( arg );
+  Self *             filter          = static_cast< Self * >( infoStruct->UserData );
+  const ThreadIdType threadId        = infoStruct->WorkUnitID;
+  const ThreadIdType numberOfThreads = infoStruct->NumberOfWorkUnits;
+
+  switch( filter->m_Operation )
+  {
+    case PackOperation:
+      filter->ThreadedPack( threadId, numberOfThreads );
+      break;
+    case ErodeOperation:
+      if( filter->m_OperationDirection == 0 )
+      {
+        filter->ThreadedErodeLines( threadId, numberOfThreads );
+      }
+      else
+      {
+        filter->ThreadedErodeColumns( threadId, numberOfThreads );
+      }
+      break;
+    case UnpackOperation:
+      filter->ThreadedUnpack( threadId, numberOfThreads );
+      break;
+  }
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ThreaderCallback()
+
+
+/**
+ * ************* GetRangeForThread *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::GetRangeForThread( const SizeValueType size,
+  const ThreadIdType threadId, const ThreadIdType numberOfThreads,
+  SizeValueType & begin, SizeValueType & end )
+{
+  begin = size * threadId / numberOfThreads;
+  end   = size * ( threadId + 1 ) / numberOfThreads;
+
+} // end GetRangeForThread()
+
+
+/**
+ * ************* ThreadedPack *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::ThreadedPack( ThreadIdType threadId, ThreadIdType numberOfThreads )
+{
+  const InputImageType * inputPtr      = this->GetInput();
+  const InputPixelType * input         = inputPtr->GetBufferPointer();
+  const SizeValueType    length        = inputPtr->GetBufferedRegion().GetSize( 0 );
+  const SizeValueType    numberOfLines = inputPtr->GetBufferedRegion().GetNumberOfPixels() / length;
+  const SizeValueType    wordsPerLine  = this->m_NumberOfWordsPerLine;
+
+  SizeValueType begin, end;
+  GetRangeForThread( numberOfLines, threadId, numberOfThreads, begin, end );
+
+  /** A voxel is inside the mask if it is nonzero. */
+  for( SizeValueType line = begin; line < end; ++line )
+  {
+    const InputPixelType * in  = input + line * length;
+    BitWordType *          out = this->m_OperationDestination + line * wordsPerLine;
+    std::fill( out, out + wordsPerLine, BitWordType( 0 ) );
+    for( SizeValueType x = 0; x < length; ++x )
+    {
+      if( in[ x ] != NumericTraits< InputPixelType >::ZeroValue() )
+      {
+        out[ x >> 6 ] |= BitWordType( 1 ) << ( x & 63 );
+      }
+    }
+  }
+
+} // end ThreadedPack()
+
+
+/**
+ * ************* ThreadedUnpack *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::ThreadedUnpack( ThreadIdType threadId, ThreadIdType numberOfThreads )
+{
+  const InputImageType * inputPtr      = this->GetInput();
+  const InputPixelType * input         = inputPtr->GetBufferPointer();
+  OutputPixelType *      output        = this->GetOutput()->GetBufferPointer();
+  const SizeValueType    length        = inputPtr->GetBufferedRegion().GetSize( 0 );
+  const SizeValueType    numberOfLines = inputPtr->GetBufferedRegion().GetNumberOfPixels() / length;
+  const SizeValueType    wordsPerLine  = this->m_NumberOfWordsPerLine;
+
+  SizeValueType begin, end;
+  GetRangeForThread( numberOfLines, threadId, numberOfThreads, begin, end );
+
+  /** Keep the input value inside the eroded mask. */
+  for( SizeValueType line = begin; line < end; ++line )
+  {
+    const InputPixelType * in   = input + line * length;
+    const BitWordType *    bits = this->m_OperationSource + line * wordsPerLine;
+    OutputPixelType *      out  = output + line * length;
+    for( SizeValueType x = 0; x < length; ++x )
+    {
+      out[ x ] = ( ( bits[ x >> 6 ] >> ( x & 63 ) ) & 1 )
+        ? static_cast< OutputPixelType >( in[ x ] )
+        : NumericTraits< OutputPixelType >::ZeroValue();
+    }
+  }
+
+} // end ThreadedUnpack()
+
+
+/**
+ * ************* ThreadedErodeLines *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::ThreadedErodeLines( ThreadIdType threadId, ThreadIdType numberOfThreads )
+{
+  const InputImageType * inputPtr      = this->GetInput();
+  const SizeValueType    length        = inputPtr->GetBufferedRegion().GetSize( 0 );
+  const SizeValueType    numberOfLines = inputPtr->GetBufferedRegion().GetNumberOfPixels() / length;
+  const SizeValueType    wordsPerLine  = this->m_NumberOfWordsPerLine;
+  const SizeValueType    radius        = this->m_OperationRadius;
+
+  SizeValueType begin, end;
+  GetRangeForThread( numberOfLines, threadId, numberOfThreads, begin, end );
+
+  /** Every run of voxels inside the mask shrinks by the radius at both
+   * ends, except at the ends of the line.
    */
-  this->GraftOutput( erosion->GetOutput() );
+  for( SizeValueType line = begin; line < end; ++line )
+  {
+    const BitWordType * in  = this->m_OperationSource + line * wordsPerLine;
+    BitWordType *       out = this->m_OperationDestination + line * wordsPerLine;
+    std::fill( out, out + wordsPerLine, BitWordType( 0 ) );
 
-} // end GenerateData()
+    SizeValueType x = 0;
+    while( x < length )
+    {
+      const SizeValueType runBegin = FindNextBit( in, x, length, true );
+      if( runBegin == length ) { break; }
+      const SizeValueType runEnd = FindNextBit( in, runBegin, length, false );
+
+      const SizeValueType first = ( runBegin == 0 ) ? 0 : runBegin + radius;
+      const SizeValueType last  = ( runEnd == length ) ? length
+        : ( runEnd > radius ? runEnd - radius : 0 );
+      if( first < last )
+      {
+        SetBits( out, first, last );
+      }
+      x = runEnd;
+    }
+  }
+
+} // end ThreadedErodeLines()
+
+
+/**
+ * ************* ThreadedErodeColumns *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::ThreadedErodeColumns( ThreadIdType threadId, ThreadIdType numberOfThreads )
+{
+  /** The words of a column, along the current direction, are stride words
+   * apart. Neighbouring columns are adjacent in memory; they are processed
+   * in tiles, to read and write consecutive words.
+   */
+  const InputImageType *                  inputPtr  = this->GetInput();
+  const typename InputImageType::SizeType size      = inputPtr->GetBufferedRegion().GetSize();
+  const unsigned int                      direction = this->m_OperationDirection;
+  const SizeValueType                     length    = size[ direction ];
+  const SizeValueType                     radius    = this->m_OperationRadius;
+
+  SizeValueType stride = this->m_NumberOfWordsPerLine;
+  for( unsigned int i = 1; i < direction; ++i )
+  {
+    stride *= size[ i ];
+  }
+  const SizeValueType numberOfWords = this->m_NumberOfWordsPerLine
+    * ( inputPtr->GetBufferedRegion().GetNumberOfPixels() / size[ 0 ] );
+  const SizeValueType numberOfBlocks = numberOfWords / ( stride * length );
+  const SizeValueType tileSize       = std::min( stride, static_cast< SizeValueType >( 64 ) );
+  const SizeValueType tilesPerBlock  = ( stride + tileSize - 1 ) / tileSize;
+
+  SizeValueType begin, end;
+  GetRangeForThread( numberOfBlocks * tilesPerBlock, threadId, numberOfThreads, begin, end );
+  if( begin == end ) { return; }
+
+  /** The erosion is a running AND over a window of 2 * radius + 1 words,
+   * computed with the van Herk / Gil-Werman algorithm: the column is padded
+   * with radius words of ones at both ends, and divided into segments of
+   * the window size. The AND of a window is the AND of a suffix of one
+   * segment and a prefix of the next.
+   */
+  const SizeValueType window       = 2 * radius + 1;
+  const SizeValueType paddedLength = length + 2 * radius;
+  BitMaskType         prefix( paddedLength * tileSize );
+  BitMaskType         suffix( paddedLength * tileSize );
+
+  for( SizeValueType tile = begin; tile < end; ++tile )
+  {
+    const SizeValueType block = tile / tilesPerBlock;
+    const SizeValueType first = ( tile % tilesPerBlock ) * tileSize;
+    const SizeValueType width = std::min( tileSize, stride - first );
+    const BitWordType * in    = this->m_OperationSource + block * stride * length + first;
+    BitWordType *       out   = this->m_OperationDestination + block * stride * length + first;
+
+    /** Prefix ANDs; the padded column itself is stored in suffix. */
+    for( SizeValueType j = 0; j < paddedLength; ++j )
+    {
+      BitWordType *       p      = &prefix[ j * width ];
+      BitWordType *       q      = &suffix[ j * width ];
+      const BitWordType * pPrev  = ( j % window == 0 ) ? nullptr : p - width;
+      const bool          inside = j >= radius && j < length + radius;
+      const BitWordType * column = inside ? in + ( j - radius ) * stride : nullptr;
+      for( SizeValueType b = 0; b < width; ++b )
+      {
+        q[ b ] = inside ? column[ b ] : ~BitWordType( 0 );
+        p[ b ] = pPrev ? ( q[ b ] & pPrev[ b ] ) : q[ b ];
+      }
+    }
+
+    /** Suffix ANDs, in place. */
+    for( SizeValueType j = paddedLength - 1; j-- > 0; )
+    {
+      if( j % window == window - 1 ) { continue; }
+      BitWordType *       q    = &suffix[ j * width ];
+      const BitWordType * next = q + width;
+      for( SizeValueType b = 0; b < width; ++b )
+      {
+        q[ b ] &= next[ b ];
+      }
+    }
+
+    /** The window of voxel i is [i, i + 2 * radius] in the padded column. */
+    for( SizeValueType i = 0; i < length; ++i )
+    {
+      const BitWordType * q = &suffix[ i * width ];
+      const BitWordType * p = &prefix[ ( i + 2 * radius ) * width ];
+      BitWordType *       o = out + i * stride;
+      for( SizeValueType b = 0; b < width; ++b )
+      {
+        o[ b ] = q[ b ] & p[ b ];
+      }
+    }
+  }
+
+} // end ThreadedErodeColumns()
+
+
+/**
+ * ************* FindNextBit *******************
+ */
+
+template< class TImage >
+SizeValueType
+ErodeMaskImageFilter< TImage >
+::FindNextBit( const BitWordType * line, const SizeValueType x,
+  const SizeValueType length, const bool value )
+{
+  /** Position of the lowest set bit of a word, by a de Bruijn sequence. */
+  static const unsigned char lowestBit[ 64 ] = {
+    0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+    62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+    63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+    46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6 };
+
+  SizeValueType w    = x >> 6;
+  BitWordType   word = ( value ? line[ w ] : ~line[ w ] ) & ( ~BitWordType( 0 ) << ( x & 63 ) );
+  while( word == 0 )
+  {
+    ++w;
+    if( ( w << 6 ) >= length ) { return length; }
+    word = value ? line[ w ] : ~line[ w ];
+  }
+
+  const BitWordType   lowest   = word & ( ~word + 1 );
+  const SizeValueType position = ( w << 6 )
+    + lowestBit[ static_cast< unsigned int >( ( lowest * 0x03f79d71b4cb0a89ULL ) >> 58 ) ];
+  return std::min( position, length );
+
+} // end FindNextBit()
+
+
+/**
+ * ************* SetBits *******************
+ */
+
+template< class TImage >
+void
+ErodeMaskImageFilter< TImage >
+::SetBits( BitWordType * line, const SizeValueType begin, const SizeValueType end )
+{
+  const SizeValueType firstWord = begin >> 6;
+  const SizeValueType lastWord  = ( end - 1 ) >> 6;
+  const BitWordType   firstMask = ~BitWordType( 0 ) << ( begin & 63 );
+  const BitWordType   lastMask  = ~BitWordType( 0 ) >> ( 63 - ( ( end - 1 ) & 63 ) );
+
+  if( firstWord == lastWord )
+  {
+    line[ firstWord ] |= firstMask & lastMask;
+    return;
+  }
+
+  line[ firstWord ] |= firstMask;
+  for( SizeValueType w = firstWord + 1; w < lastWord; ++w )
+  {
+    line[ w ] = ~BitWordType( 0 );
+  }
+  line[ lastWord ] |= lastMask;
+
+} // end SetBits()
 
 
 } // end namespace itk
@@ -23,6 +23,7 @@
 #include "itkResampleImageFilter.h"
 #include "itkShrinkImageFilter.h"
 #include "itkImageAlgorithm.h"
+#include "itkHotPathProfiler.h"
 
 namespace // anonymous namespace
 {
@@ -266,6 +267,8 @@ void
 GenericMultiResolutionPyramidImageFilter< TInputImage, TOutputImage, TPrecisionType >
 ::GenerateData( void )
 {
+  itkHotPathScopedTimerMacro( "MultiResolutionPyramid::GenerateData" );
+
   // Depending on user setting of the SetUseMultiResolutionRescaleSchedule() and
   // SetUseMultiResolutionSmoothingSchedule()
   // in combination with SetUseShrinkImageFilter() different pipelines will be
@@ -0,0 +1,680 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkHotPathProfiler_h
+#define __itkHotPathProfiler_h
+
+#include "itkIntTypes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class HotPathProfiler
+ * \brief Low-overhead timers and counters for the registration hot paths.
+ *
+ * The profiler collects, per named section, the number of calls and the
+ * time spent, and optionally a trace of the individual calls, which can be
+ * written in the Chrome trace event format (chrome://tracing, Perfetto).
+ * Sections are instrumented with the macros:
+ *
+ *   itkHotPathScopedTimerMacro( "Metric::ThreadedGetValueAndDerivative" );
+ *   itkHotPathFineScopedTimerMacro( "Transform::TransformPoint" );
+ *   itkHotPathCounterMacro( "Metric::NumberOfSamples", n );
+ *
+ * A named timer can be stopped before the end of its scope:
+ *
+ *   itkHotPathNamedScopedTimerMacro( timer, "Optimizer::AdvanceOneStep" );
+ *   ...
+ *   itkHotPathStopTimerMacro( timer );
+ *
+ * The fine timers are meant for functions that are called per sample; they
+ * are counted and timed, but not traced. Defining ELASTIX_NO_HOTPATH_PROFILING
+ * removes the instrumentation completely.
+ *
+ * A profiler is owned by its user, for example the ElastixTemplate of a
+ * registration, which enables it with SetEnabled( true ) for the duration
+ * of the registration. The instrumented code reports to the enabled
+ * profiler; one profiler can be enabled at a time. When no profiler is
+ * enabled, which is the default, a timer costs a single load of a global
+ * pointer. The names of the sections are registered once per call site, in
+ * a registry that is shared by all profilers.
+ *
+ * Each thread writes in its own buffer, so no locking is needed in the hot
+ * paths. The buffers are returned to the pool of their profiler when a
+ * thread ends, since the ITK threaders create new threads for every
+ * parallel section. PrintReport(), Reset() and WriteChromeTrace() should be
+ * called when no parallel section is running, for example at the end of a
+ * resolution.
+ *
+ * \ingroup Common
+ */
+
+class HotPathProfiler
+{
+public:
+
+  /** Typedefs. */
+  typedef HotPathProfiler           Self;
+  typedef std::chrono::steady_clock ClockType;
+  typedef ClockType::time_point     TimePointType;
+
+  /** Constructor and destructor. A profiler that is destructed while
+   * enabled is disabled first.
+   */
+  HotPathProfiler() :
+    m_Id( Self::GetNextId() ),
+    m_TraceEnabled( false ),
+    m_NumberOfTraceEvents( 0 ),
+    m_MaximumNumberOfTraceEvents( 2000000 ),
+    m_Origin( ClockType::now() )
+  {
+    std::lock_guard< std::mutex > lock( Self::GetProfilersMutex() );
+    Self::GetProfilers().push_back( this );
+  }
+
+
+  ~HotPathProfiler()
+  {
+    this->SetEnabled( false );
+    std::lock_guard< std::mutex > lock( Self::GetProfilersMutex() );
+    std::vector< Self * > & profilers = Self::GetProfilers();
+    profilers.erase( std::remove( profilers.begin(), profilers.end(), this ), profilers.end() );
+  }
+
+
+  /** Returns the enabled profiler, or null. This is the only call in the
+   * hot paths when profiling is disabled.
+   */
+  static Self * GetEnabledProfiler( void )
+  {
+    return Self::GetEnabledProfilerPointer().load( std::memory_order_acquire );
+  }
+
+
+  /** Enable or disable the collection of timings and counts by this
+   * profiler. Enabling it disables any other profiler.
+   */
+  void SetEnabled( const bool enabled )
+  {
+    if( enabled )
+    {
+      Self::GetEnabledProfilerPointer().store( this, std::memory_order_release );
+    }
+    else
+    {
+      Self * self = this;
+      Self::GetEnabledProfilerPointer().compare_exchange_strong( self, nullptr );
+    }
+  }
+
+
+  bool GetEnabled( void ) const
+  {
+    return Self::GetEnabledProfiler() == this;
+  }
+
+
+  /** Enable or disable the collection of the trace. */
+  void SetTraceEnabled( const bool enabled )
+  {
+    this->m_TraceEnabled.store( enabled, std::memory_order_relaxed );
+  }
+
+
+  bool GetTraceEnabled( void ) const
+  {
+    return this->m_TraceEnabled.load( std::memory_order_relaxed );
+  }
+
+
+  /** The maximum number of trace events that is stored, to bound the memory. */
+  void SetMaximumNumberOfTraceEvents( const SizeValueType maximum )
+  {
+    this->m_MaximumNumberOfTraceEvents = maximum;
+  }
+
+
+  /** The section kinds. */
+  enum SectionKind { Timer, FineTimer, Counter };
+
+  /** Register a section and return its id. Called once per call site. */
+  static unsigned int RegisterSection( const char * name, const SectionKind kind )
+  {
+    std::lock_guard< std::mutex > lock( Self::GetSectionsMutex() );
+    std::vector< SectionType > & sections = Self::GetSections();
+    for( std::size_t i = 0; i < sections.size(); ++i )
+    {
+      if( sections[ i ].m_Name == name && sections[ i ].m_Kind == kind )
+      {
+        return static_cast< unsigned int >( i );
+      }
+    }
+    SectionType section = { name, kind };
+    sections.push_back( section );
+    return static_cast< unsigned int >( sections.size() - 1 );
+  }
+
+
+  /** Add a timing of a section to the buffer of the calling thread. */
+  void AddTime( const unsigned int id, const bool traced, const TimePointType & begin, const TimePointType & end )
+  {
+    ThreadBufferType * buffer   = this->GetThreadBuffer();
+    const double       duration = std::chrono::duration< double, std::nano >( end - begin ).count();
+    StatisticsType &   stats    = buffer->GetStatistics( id );
+    ++stats.m_Count;
+    stats.m_TotalTime += duration;
+    stats.m_MaximumTime = std::max( stats.m_MaximumTime, duration );
+
+    if( traced && this->GetTraceEnabled() )
+    {
+      if( this->m_NumberOfTraceEvents.fetch_add( 1, std::memory_order_relaxed ) < this->m_MaximumNumberOfTraceEvents )
+      {
+        TraceEventType event = { id, begin, end };
+        buffer->m_TraceEvents.push_back( event );
+      }
+    }
+  }
+
+
+  /** Add to a counter, in the buffer of the calling thread. */
+  void AddCount( const unsigned int id, const SizeValueType count )
+  {
+    this->GetThreadBuffer()->GetStatistics( id ).m_Count += count;
+  }
+
+
+  /** Add a named span to the trace, for example a resolution. */
+  void AddTraceMarker( const std::string & name, const TimePointType & begin, const TimePointType & end )
+  {
+    if( !this->GetTraceEnabled() )
+    {
+      return;
+    }
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    MarkerType marker = { name, begin, end };
+    this->m_Markers.push_back( marker );
+  }
+
+
+  /** Clear the timings and counts, but not the trace. */
+  void Reset( void )
+  {
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    for( std::size_t b = 0; b < this->m_Buffers.size(); ++b )
+    {
+      this->m_Buffers[ b ]->m_Statistics.clear();
+    }
+  }
+
+
+  /** Clear the trace. */
+  void ResetTrace( void )
+  {
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    for( std::size_t b = 0; b < this->m_Buffers.size(); ++b )
+    {
+      this->m_Buffers[ b ]->m_TraceEvents.clear();
+    }
+    this->m_Markers.clear();
+    this->m_NumberOfTraceEvents.store( 0, std::memory_order_relaxed );
+  }
+
+
+  /** Print a table with the calls, total, mean and maximum time per section.
+   * The times of sections that run in several threads are summed over the
+   * threads, so they can exceed the wall clock time, which is given for
+   * reference.
+   */
+  void PrintReport( std::ostream & os, const double wallClockTime ) const
+  {
+    const std::vector< SectionType > sections = Self::GetSectionsCopy();
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    std::vector< StatisticsType > total( sections.size() );
+    for( std::size_t b = 0; b < this->m_Buffers.size(); ++b )
+    {
+      const std::vector< StatisticsType > & stats = this->m_Buffers[ b ]->m_Statistics;
+      for( std::size_t i = 0; i < stats.size() && i < total.size(); ++i )
+      {
+        total[ i ].m_Count       += stats[ i ].m_Count;
+        total[ i ].m_TotalTime   += stats[ i ].m_TotalTime;
+        total[ i ].m_MaximumTime  = std::max( total[ i ].m_MaximumTime, stats[ i ].m_MaximumTime );
+      }
+    }
+
+    /** Sort the timers on their total time. */
+    std::vector< std::size_t > order;
+    for( std::size_t i = 0; i < total.size(); ++i )
+    {
+      if( total[ i ].m_Count > 0 )
+      {
+        order.push_back( i );
+      }
+    }
+    std::stable_sort( order.begin(), order.end(), [ &total ]( std::size_t a, std::size_t b )
+    {
+      return total[ a ].m_TotalTime > total[ b ].m_TotalTime;
+    } );
+
+    const std::ios::fmtflags flags     = os.flags();
+    const std::streamsize    precision = os.precision();
+    os << std::fixed << std::setprecision( 3 );
+    os << "Hot path profile (wall clock time " << wallClockTime * 1000.0 << " ms):\n";
+    os << "  " << std::left << std::setw( 56 ) << "Section" << std::right
+       << std::setw( 14 ) << "Calls" << std::setw( 14 ) << "Total[ms]"
+       << std::setw( 14 ) << "Mean[us]" << std::setw( 14 ) << "Max[us]" << "\n";
+    for( std::size_t k = 0; k < order.size(); ++k )
+    {
+      const std::size_t      i     = order[ k ];
+      const StatisticsType & stats = total[ i ];
+      os << "  " << std::left << std::setw( 56 ) << sections[ i ].m_Name << std::right
+         << std::setw( 14 ) << stats.m_Count;
+      if( sections[ i ].m_Kind != Counter )
+      {
+        os << std::setw( 14 ) << stats.m_TotalTime * 1e-6
+           << std::setw( 14 ) << stats.m_TotalTime * 1e-3 / static_cast< double >( stats.m_Count )
+           << std::setw( 14 ) << stats.m_MaximumTime * 1e-3;
+      }
+      os << "\n";
+    }
+    os.flags( flags );
+    os.precision( precision );
+  }
+
+
+  /** Write the trace in the Chrome trace event format. */
+  bool WriteChromeTrace( const std::string & fileName ) const
+  {
+    std::ofstream output( fileName.c_str() );
+    if( !output.is_open() )
+    {
+      return false;
+    }
+    this->WriteChromeTrace( output );
+    return !output.fail();
+  }
+
+
+  void WriteChromeTrace( std::ostream & output ) const
+  {
+    const std::vector< SectionType > sections = Self::GetSectionsCopy();
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    const std::ios::fmtflags flags     = output.flags();
+    const std::streamsize    precision = output.precision();
+    output << std::fixed << std::setprecision( 3 );
+    output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    for( std::size_t m = 0; m < this->m_Markers.size(); ++m )
+    {
+      const MarkerType & marker = this->m_Markers[ m ];
+      this->WriteTraceEvent( output, first, marker.m_Name, "elastix", 0, marker.m_Begin, marker.m_End );
+    }
+    for( std::size_t b = 0; b < this->m_Buffers.size(); ++b )
+    {
+      const std::vector< TraceEventType > & events = this->m_Buffers[ b ]->m_TraceEvents;
+      for( std::size_t e = 0; e < events.size(); ++e )
+      {
+        this->WriteTraceEvent( output, first, sections[ events[ e ].m_Section ].m_Name,
+          "hotpath", b + 1, events[ e ].m_Begin, events[ e ].m_End );
+      }
+    }
+    output << "\n]}\n";
+    output.flags( flags );
+    output.precision( precision );
+  }
+
+
+  /** Escape a string for use in a JSON string: quotes, backslashes and
+   * control characters.
+   */
+  static std::string EscapeJSONString( const std::string & input )
+  {
+    std::string output;
+    output.reserve( input.size() );
+    for( std::size_t i = 0; i < input.size(); ++i )
+    {
+      const unsigned char c = static_cast< unsigned char >( input[ i ] );
+      switch( c )
+      {
+        case '"': output += "\\\""; break;
+        case '\\': output += "\\\\"; break;
+        case '\b': output += "\\b"; break;
+        case '\f': output += "\\f"; break;
+        case '\n': output += "\\n"; break;
+        case '\r': output += "\\r"; break;
+        case '\t': output += "\\t"; break;
+        default:
+          if( c < 0x20 )
+          {
+            const char * hex = "0123456789abcdef";
+            output += "\\u00";
+            output += hex[ c >> 4 ];
+            output += hex[ c & 0xf ];
+          }
+          else
+          {
+            output += static_cast< char >( c );
+          }
+      }
+    }
+    return output;
+  }
+
+
+private:
+
+  HotPathProfiler( const Self & );  // purposely not implemented
+  void operator=( const Self & );   // purposely not implemented
+
+  struct SectionType
+  {
+    std::string m_Name;
+    SectionKind m_Kind;
+  };
+
+  struct StatisticsType
+  {
+    StatisticsType() : m_Count( 0 ), m_TotalTime( 0.0 ), m_MaximumTime( 0.0 ) {}
+    SizeValueType m_Count;
+    double        m_TotalTime;   // in ns
+    double        m_MaximumTime; // in ns
+  };
+
+  struct TraceEventType
+  {
+    unsigned int  m_Section;
+    TimePointType m_Begin;
+    TimePointType m_End;
+  };
+
+  struct MarkerType
+  {
+    std::string   m_Name;
+    TimePointType m_Begin;
+    TimePointType m_End;
+  };
+
+  struct ThreadBufferType
+  {
+    StatisticsType & GetStatistics( const unsigned int id )
+    {
+      if( id >= this->m_Statistics.size() )
+      {
+        this->m_Statistics.resize( id + 1 );
+      }
+      return this->m_Statistics[ id ];
+    }
+
+
+    std::vector< StatisticsType > m_Statistics;
+    std::vector< TraceEventType > m_TraceEvents;
+  };
+
+  /** The buffer of a thread, and the id of the profiler it belongs to.
+   * The buffer is returned to that profiler, if it still exists, when the
+   * thread ends or starts writing to another profiler.
+   */
+  struct ThreadBufferHandle
+  {
+    ThreadBufferHandle() : m_ProfilerId( 0 ), m_Buffer( nullptr ) {}
+    ~ThreadBufferHandle()
+    {
+      this->Release();
+    }
+
+
+    void Release( void )
+    {
+      if( this->m_Buffer )
+      {
+        std::lock_guard< std::mutex > lock( Self::GetProfilersMutex() );
+        const std::vector< Self * > & profilers = Self::GetProfilers();
+        for( std::size_t i = 0; i < profilers.size(); ++i )
+        {
+          if( profilers[ i ]->m_Id == this->m_ProfilerId )
+          {
+            profilers[ i ]->ReleaseThreadBuffer( this->m_Buffer );
+            break;
+          }
+        }
+      }
+      this->m_ProfilerId = 0;
+      this->m_Buffer     = nullptr;
+    }
+
+
+    unsigned long long m_ProfilerId;
+    ThreadBufferType * m_Buffer;
+  };
+
+  static std::atomic< Self * > & GetEnabledProfilerPointer( void )
+  {
+    static std::atomic< Self * > enabledProfiler( nullptr );
+    return enabledProfiler;
+  }
+
+
+  static unsigned long long GetNextId( void )
+  {
+    static std::atomic< unsigned long long > nextId( 1 );
+    return nextId.fetch_add( 1 );
+  }
+
+
+  /** The existing profilers, to which the threads return their buffers. */
+  static std::mutex & GetProfilersMutex( void )
+  {
+    static std::mutex profilersMutex;
+    return profilersMutex;
+  }
+
+
+  static std::vector< Self * > & GetProfilers( void )
+  {
+    static std::vector< Self * > profilers;
+    return profilers;
+  }
+
+
+  /** The registry of the sections, shared by all profilers. */
+  static std::mutex & GetSectionsMutex( void )
+  {
+    static std::mutex sectionsMutex;
+    return sectionsMutex;
+  }
+
+
+  static std::vector< SectionType > & GetSections( void )
+  {
+    static std::vector< SectionType > sections;
+    return sections;
+  }
+
+
+  static std::vector< SectionType > GetSectionsCopy( void )
+  {
+    std::lock_guard< std::mutex > lock( Self::GetSectionsMutex() );
+    return Self::GetSections();
+  }
+
+
+  ThreadBufferType * GetThreadBuffer( void )
+  {
+    static thread_local ThreadBufferHandle handle;
+    if( handle.m_ProfilerId != this->m_Id )
+    {
+      handle.Release();
+      handle.m_Buffer     = this->AcquireThreadBuffer();
+      handle.m_ProfilerId = this->m_Id;
+    }
+    return handle.m_Buffer;
+  }
+
+
+  ThreadBufferType * AcquireThreadBuffer( void )
+  {
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    if( !this->m_FreeBuffers.empty() )
+    {
+      ThreadBufferType * buffer = this->m_FreeBuffers.back();
+      this->m_FreeBuffers.pop_back();
+      return buffer;
+    }
+    this->m_Buffers.push_back( std::unique_ptr< ThreadBufferType >( new ThreadBufferType ) );
+    return this->m_Buffers.back().get();
+  }
+
+
+  void ReleaseThreadBuffer( ThreadBufferType * buffer )
+  {
+    std::lock_guard< std::mutex > lock( this->m_Mutex );
+    this->m_FreeBuffers.push_back( buffer );
+  }
+
+
+  void WriteTraceEvent( std::ostream & output, bool & first, const std::string & name,
+    const char * category, const std::size_t lane, const TimePointType & begin, const TimePointType & end ) const
+  {
+    typedef std::chrono::duration< double, std::micro > MicroSecondsType;
+    output << ( first ? "" : ",\n" );
+    first = false;
+    output << "{\"name\":\"" << Self::EscapeJSONString( name )
+           << "\",\"cat\":\"" << category << "\",\"ph\":\"X\""
+           << ",\"ts\":" << MicroSecondsType( begin - this->m_Origin ).count()
+           << ",\"dur\":" << MicroSecondsType( end - begin ).count()
+           << ",\"pid\":1,\"tid\":" << lane << "}";
+  }
+
+
+  const unsigned long long                         m_Id;
+  mutable std::mutex                               m_Mutex;
+  std::vector< std::unique_ptr< ThreadBufferType > > m_Buffers;
+  std::vector< ThreadBufferType * >                m_FreeBuffers;
+  std::vector< MarkerType >                        m_Markers;
+  std::atomic< bool >                              m_TraceEnabled;
+  std::atomic< SizeValueType >                     m_NumberOfTraceEvents;
+  SizeValueType                                    m_MaximumNumberOfTraceEvents;
+  TimePointType                                    m_Origin;
+
+};
+
+/** \class HotPathScopedTimer
+ * \brief Times the enclosing scope, when a HotPathProfiler is enabled.
+ */
+
+class HotPathScopedTimer
+{
+public:
+
+  HotPathScopedTimer( const unsigned int id, const bool traced ) :
+    m_Id( id ), m_Traced( traced ), m_Profiler( HotPathProfiler::GetEnabledProfiler() )
+  {
+    if( this->m_Profiler )
+    {
+      this->m_Begin = HotPathProfiler::ClockType::now();
+    }
+  }
+
+
+  ~HotPathScopedTimer()
+  {
+    this->Stop();
+  }
+
+
+  /** Stop the timer before the end of the scope. */
+  void Stop( void )
+  {
+    if( this->m_Profiler )
+    {
+      this->m_Profiler->AddTime( this->m_Id, this->m_Traced, this->m_Begin, HotPathProfiler::ClockType::now() );
+      this->m_Profiler = nullptr;
+    }
+  }
+
+
+private:
+
+  HotPathScopedTimer( const HotPathScopedTimer & );  // purposely not implemented
+  void operator=( const HotPathScopedTimer & );      // purposely not implemented
+
+  unsigned int                    m_Id;
+  bool                            m_Traced;
+  HotPathProfiler *               m_Profiler;
+  HotPathProfiler::TimePointType  m_Begin;
+};
+
+} // end namespace itk
+
+/** Macros to instrument the hot paths. The section is registered once per
+ * call site, on first use.
+ */
+#ifndef ELASTIX_NO_HOTPATH_PROFILING
+
+#define itkHotPathConcatenateMacro2( a, b ) a##b
+#define itkHotPathConcatenateMacro( a, b ) itkHotPathConcatenateMacro2( a, b )
+
+#define itkHotPathTimerMacroImplementation( variable, name, kind ) \
+  static const unsigned int itkHotPathConcatenateMacro( hotPathSectionId, __LINE__ ) \
+    = ::itk::HotPathProfiler::RegisterSection( name, kind ); \
+  ::itk::HotPathScopedTimer variable( \
+    itkHotPathConcatenateMacro( hotPathSectionId, __LINE__ ), kind == ::itk::HotPathProfiler::Timer )
+
+#define itkHotPathScopedTimerMacro( name ) \
+  itkHotPathTimerMacroImplementation( \
+    itkHotPathConcatenateMacro( hotPathScopedTimer, __LINE__ ), name, ::itk::HotPathProfiler::Timer )
+
+#define itkHotPathFineScopedTimerMacro( name ) \
+  itkHotPathTimerMacroImplementation( \
+    itkHotPathConcatenateMacro( hotPathScopedTimer, __LINE__ ), name, ::itk::HotPathProfiler::FineTimer )
+
+/** A named timer, that can be stopped before the end of the scope. */
+#define itkHotPathNamedScopedTimerMacro( variable, name ) \
+  itkHotPathTimerMacroImplementation( variable, name, ::itk::HotPathProfiler::Timer )
+
+#define itkHotPathStopTimerMacro( variable ) \
+  variable.Stop()
+
+#define itkHotPathCounterMacro( name, count ) \
+  if( ::itk::HotPathProfiler * hotPathProfiler = ::itk::HotPathProfiler::GetEnabledProfiler() ) \
+  { \
+    static const unsigned int hotPathCounterId \
+      = ::itk::HotPathProfiler::RegisterSection( name, ::itk::HotPathProfiler::Counter ); \
+    hotPathProfiler->AddCount( hotPathCounterId, count ); \
+  }
+
+#else
+
+#define itkHotPathScopedTimerMacro( name )
+#define itkHotPathFineScopedTimerMacro( name )
+#define itkHotPathNamedScopedTimerMacro( variable, name )
+#define itkHotPathStopTimerMacro( variable )
+#define itkHotPathCounterMacro( name, count )
+
+#endif
+
+#endif // end #ifndef __itkHotPathProfiler_h
@@ -0,0 +1,226 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageMaskLookup_h
+#define __itkImageMaskLookup_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkBitPackedImageMaskSpatialObject.h"
+#include "itkMatrix.h"
+#include "itkMath.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace itk
+{
+
+/** \class ImageMaskLookup
+ * \brief Fast point-in-mask test for an ImageMaskSpatialObject.
+ *
+ * The function IsInsideInWorldSpace() of a spatial object converts the point
+ * to the object space and then to an index, and does several bounds checks,
+ * each time it is called. This class does that work once, in Update(), and
+ * stores:
+ * \li the bounding box of the nonzero voxels of the mask, in index space;
+ * \li a single matrix and offset that map a world point directly to a
+ *   (continuous) index in that bounding box, including the object to world
+ *   transform of the spatial object and the direction of the mask image;
+ * \li a bit-packed occupancy grid of the bounding box;
+ * \li optionally, the state (empty, full or mixed) of coarse blocks of voxels,
+ *   so that the bit grid only needs to be read in mixed blocks.
+ *
+ * IsInside() then gives the same answer as IsInsideInWorldSpace(), with a few
+ * multiplications and one or two memory reads.
+ *
+ * If the mask is a BitPackedImageMaskSpatialObject with a valid bit mask,
+ * the bounding box and the bit grid are computed from that bit mask, which
+ * is read a word at a time, instead of from the pixels of the image.
+ *
+ * If the mask is not an ImageMaskSpatialObject, IsInside() just calls
+ * IsInsideInWorldSpace(). Without a mask, IsInside() returns true.
+ *
+ * The lookup must be updated when the mask changes. Update() only rebuilds
+ * it when the mask, its image, or its object to world transform was modified
+ * since the last update. IsInside() is thread safe.
+ *
+ * \ingroup ImageSamplers
+ */
+
+template< unsigned int VDimension >
+class ImageMaskLookup : public Object
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef ImageMaskLookup            Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ImageMaskLookup, Object );
+
+  /** The dimension of the mask. */
+  itkStaticConstMacro( Dimension, unsigned int, VDimension );
+
+  /** Typedefs for the mask. */
+  typedef SpatialObject< VDimension >                    MaskType;
+  typedef typename MaskType::ConstPointer                MaskConstPointer;
+  typedef typename MaskType::PointType                   PointType;
+  typedef ImageMaskSpatialObject< VDimension >           ImageMaskSpatialObjectType;
+  typedef typename ImageMaskSpatialObjectType::ImageType MaskImageType;
+  typedef typename MaskImageType::IndexType              IndexType;
+  typedef typename IndexType::IndexValueType             IndexValueType;
+  typedef typename MaskImageType::SizeType               SizeType;
+  typedef typename MaskImageType::RegionType             RegionType;
+  typedef typename MaskImageType::OffsetValueType        OffsetValueType;
+  typedef BitPackedImageMaskSpatialObject< VDimension >  BitPackedImageMaskSpatialObjectType;
+  typedef typename BitPackedImageMaskSpatialObjectType::BitWordType BitWordType;
+
+  /** Typedefs for the point to index mapping. */
+  typedef Matrix< double, VDimension, VDimension > MatrixType;
+  typedef Vector< double, VDimension >             VectorType;
+
+  /** Set/Get the mask. */
+  virtual void SetMask( const MaskType * _arg );
+  itkGetConstObjectMacro( Mask, MaskType );
+
+  /** Set/Get the edge length, in voxels, of the coarse blocks.
+   * A block size of 0 or 1 disables the blocks. Default: 8.
+   */
+  itkSetMacro( BlockSize, unsigned int );
+  itkGetConstMacro( BlockSize, unsigned int );
+
+  /** Whether the fast lookup is used, or IsInsideInWorldSpace() of the mask.
+   * Valid after Update().
+   */
+  itkGetConstMacro( UseFastLookup, bool );
+
+  /** The bounding box of the nonzero voxels of the mask, in index space.
+   * Valid after Update(), if the fast lookup is used.
+   */
+  itkGetConstReferenceMacro( BoundingBoxRegion, RegionType );
+
+  /** (Re)build the lookup structures, if the mask was modified. */
+  virtual void Update( void );
+
+  /** Check whether a world point is inside the mask. */
+  inline bool IsInside( const PointType & point ) const
+  {
+    if( !this->m_UseFastLookup )
+    {
+      return this->m_Mask.IsNull() || this->m_Mask->IsInsideInWorldSpace( point );
+    }
+
+    /** Map the point to an index relative to the bounding box, and check the
+     * bounding box. The rounding is the same as in
+     * Image::TransformPhysicalPointToIndex().
+     */
+    OffsetValueType voxel = 0;
+    OffsetValueType block = 0;
+    for( unsigned int i = 0; i < VDimension; ++i )
+    {
+      double cindex = this->m_PointToIndexOffset[ i ];
+      for( unsigned int j = 0; j < VDimension; ++j )
+      {
+        cindex += this->m_PointToIndexMatrix( i, j ) * point[ j ];
+      }
+      const IndexValueType index = Math::RoundHalfIntegerUp< IndexValueType >( cindex );
+      if( index < 0 || index >= static_cast< IndexValueType >( this->m_BoundingBoxRegion.GetSize()[ i ] ) )
+      {
+        return false;
+      }
+      voxel += index * this->m_VoxelOffsetTable[ i ];
+      block += ( index >> this->m_BlockShift ) * this->m_BlockOffsetTable[ i ];
+    }
+
+    /** Empty and full blocks are answered without reading the bit grid. */
+    if( this->m_UseBlocks )
+    {
+      const unsigned char state = this->m_BlockStates[ block ];
+      if( state != MixedBlock )
+      {
+        return state == FullBlock;
+      }
+    }
+
+    return ( ( this->m_Bits[ voxel >> 6 ] >> ( voxel & 63 ) ) & 1 ) != 0;
+  }
+
+
+protected:
+
+  /** The constructor. */
+  ImageMaskLookup();
+
+  /** The destructor. */
+  ~ImageMaskLookup() override {}
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+  /** Compute the mapping from a world point to an index relative to the bounding box. */
+  virtual void ComputePointToIndexMapping( const ImageMaskSpatialObjectType * mask );
+
+  /** Compute the bounding box of the nonzero voxels from a bit mask. */
+  virtual RegionType ComputeBoundingBoxFromBitMask( const BitPackedImageMaskSpatialObjectType * mask ) const;
+
+  /** Fill the bit grid and the block states, from the bit mask of the mask
+   * if it is given, and from the pixels of the image otherwise.
+   */
+  virtual void ComputeOccupancy( const MaskImageType * image,
+    const BitPackedImageMaskSpatialObjectType * bitPackedMask );
+
+private:
+
+  ImageMaskLookup( const Self & );  // purposely not implemented
+  void operator=( const Self & );   // purposely not implemented
+
+  /** The states of the coarse blocks. */
+  enum BlockStateType { EmptyBlock = 0, FullBlock = 1, MixedBlock = 2 };
+
+  MaskConstPointer m_Mask;
+  unsigned int     m_BlockSize;
+  bool             m_UseFastLookup;
+  bool             m_UseBlocks;
+  TimeStamp        m_UpdateTime;
+
+  MatrixType m_PointToIndexMatrix;
+  VectorType m_PointToIndexOffset;
+  RegionType m_BoundingBoxRegion;
+
+  OffsetValueType              m_VoxelOffsetTable[ VDimension ];
+  std::vector< std::uint64_t > m_Bits;
+
+  unsigned int                 m_BlockShift;
+  OffsetValueType              m_BlockOffsetTable[ VDimension ];
+  std::vector< unsigned char > m_BlockStates;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageMaskLookup.hxx"
+#endif
+
+#endif // end #ifndef __itkImageMaskLookup_h
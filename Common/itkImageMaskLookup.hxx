@@ -0,0 +1,434 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkImageMaskLookup_hxx
+#define __itkImageMaskLookup_hxx
+
+#include "itkImageMaskLookup.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< unsigned int VDimension >
+ImageMaskLookup< VDimension >
+::ImageMaskLookup()
+{
+  this->m_Mask          = nullptr;
+  this->m_BlockSize     = 8;
+  this->m_UseFastLookup = false;
+  this->m_UseBlocks     = false;
+  this->m_BlockShift    = 0;
+
+  this->m_PointToIndexMatrix.SetIdentity();
+  this->m_PointToIndexOffset.Fill( 0.0 );
+  for( unsigned int i = 0; i < VDimension; ++i )
+  {
+    this->m_VoxelOffsetTable[ i ] = 0;
+    this->m_BlockOffsetTable[ i ] = 0;
+  }
+
+} // end Constructor()
+
+
+/**
+ * ******************* SetMask *******************
+ */
+
+template< unsigned int VDimension >
+void
+ImageMaskLookup< VDimension >
+::SetMask( const MaskType * _arg )
+{
+  if( this->m_Mask != _arg )
+  {
+    this->m_Mask = _arg;
+
+    /** The lookup of the previous mask is invalid. */
+    this->m_UseFastLookup = false;
+    this->m_Bits.clear();
+    this->m_BlockStates.clear();
+    this->Modified();
+  }
+
+} // end SetMask()
+
+
+/**
+ * ******************* Update *******************
+ */
+
+template< unsigned int VDimension >
+void
+ImageMaskLookup< VDimension >
+::Update( void )
+{
+  const ImageMaskSpatialObjectType * mask
+    = dynamic_cast< const ImageMaskSpatialObjectType * >( this->m_Mask.GetPointer() );
+  if( mask == nullptr || mask->GetImage() == nullptr )
+  {
+    this->m_UseFastLookup = false;
+    this->m_Bits.clear();
+    this->m_BlockStates.clear();
+    return;
+  }
+
+  /** Only rebuild when something changed since the last update. */
+  const MaskImageType * image = mask->GetImage();
+  const ModifiedTimeType maskTime = std::max( std::max( mask->GetMTime(), image->GetMTime() ),
+    std::max( mask->GetObjectToWorldTransform()->GetMTime(), this->GetMTime() ) );
+  if( this->m_UseFastLookup && this->m_UpdateTime.GetMTime() > maskTime )
+  {
+    return;
+  }
+
+  /** Use the bit mask of the mask, if it has one that fits its image. */
+  const BitPackedImageMaskSpatialObjectType * bitPackedMask
+    = dynamic_cast< const BitPackedImageMaskSpatialObjectType * >( mask );
+  if( bitPackedMask != nullptr && !bitPackedMask->HasValidBitMask() )
+  {
+    bitPackedMask = nullptr;
+  }
+
+  /** The bounding box of the nonzero voxels is the early out. */
+  this->m_BoundingBoxRegion = bitPackedMask != nullptr
+    ? this->ComputeBoundingBoxFromBitMask( bitPackedMask )
+    : mask->ComputeMyBoundingBoxInIndexSpace();
+
+  this->ComputePointToIndexMapping( mask );
+  this->ComputeOccupancy( image, bitPackedMask );
+
+  this->m_UseFastLookup = true;
+  this->m_UpdateTime.Modified();
+
+} // end Update()
+
+
+/**
+ * ******************* ComputePointToIndexMapping *******************
+ */
+
+template< unsigned int VDimension >
+void
+ImageMaskLookup< VDimension >
+::ComputePointToIndexMapping( const ImageMaskSpatialObjectType * mask )
+{
+  /** A world point x maps to the object space by the inverse of the object
+   * to world transform: o = A^{-1} ( x - b ). The image then maps o to the
+   * continuous index P ( o - origin ), with P the inverse of the direction
+   * times the spacing. Both are combined in one matrix and offset, and the
+   * offset also subtracts the start index of the bounding box.
+   */
+  const typename ImageMaskSpatialObjectType::TransformType * objectToWorld
+    = mask->GetObjectToWorldTransform();
+  const MatrixType inverseA( objectToWorld->GetMatrix().GetInverse() );
+  const VectorType b = objectToWorld->GetOffset();
+
+  const MaskImageType * image  = mask->GetImage();
+  const MatrixType      P      = image->GetPhysicalPointToIndexMatrix();
+  const VectorType      origin = image->GetOrigin().GetVectorFromOrigin();
+
+  this->m_PointToIndexMatrix = P * inverseA;
+  this->m_PointToIndexOffset = P * ( -( inverseA * b ) - origin );
+  for( unsigned int i = 0; i < VDimension; ++i )
+  {
+    this->m_PointToIndexOffset[ i ] -= this->m_BoundingBoxRegion.GetIndex()[ i ];
+  }
+
+} // end ComputePointToIndexMapping()
+
+
+/**
+ * ******************* ComputeBoundingBoxFromBitMask *******************
+ */
+
+template< unsigned int VDimension >
+typename ImageMaskLookup< VDimension >::RegionType
+ImageMaskLookup< VDimension >
+::ComputeBoundingBoxFromBitMask( const BitPackedImageMaskSpatialObjectType * mask ) const
+{
+  const RegionType      region        = mask->GetImage()->GetBufferedRegion();
+  const SizeType        regionSize    = region.GetSize();
+  const SizeValueType   wordsPerLine  = mask->GetNumberOfWordsPerLine();
+  const SizeValueType   numberOfLines = region.GetNumberOfPixels() / regionSize[ 0 ];
+  const BitWordType *   bits          = mask->GetBitMask().data();
+
+  /** Find the first and the last set bit of every line, skipping empty words. */
+  IndexType first, last;
+  first.Fill( NumericTraits< IndexValueType >::max() );
+  last.Fill( NumericTraits< IndexValueType >::NonpositiveMin() );
+  for( SizeValueType line = 0; line < numberOfLines; ++line )
+  {
+    const BitWordType * words = bits + line * wordsPerLine;
+    SizeValueType       begin = 0;
+    while( begin < wordsPerLine && words[ begin ] == 0 )
+    {
+      ++begin;
+    }
+    if( begin == wordsPerLine )
+    {
+      continue;
+    }
+    SizeValueType end = wordsPerLine;
+    while( words[ end - 1 ] == 0 )
+    {
+      --end;
+    }
+
+    SizeValueType x0 = begin << 6;
+    while( ( ( words[ begin ] >> ( x0 & 63 ) ) & 1 ) == 0 )
+    {
+      ++x0;
+    }
+    SizeValueType x1 = ( end << 6 ) - 1;
+    while( ( ( words[ end - 1 ] >> ( x1 & 63 ) ) & 1 ) == 0 )
+    {
+      --x1;
+    }
+
+    IndexType     lineIndex;
+    SizeValueType rest = line;
+    lineIndex[ 0 ] = 0;
+    for( unsigned int i = 1; i < VDimension; ++i )
+    {
+      lineIndex[ i ] = static_cast< IndexValueType >( rest % regionSize[ i ] );
+      rest          /= regionSize[ i ];
+    }
+    first[ 0 ] = std::min( first[ 0 ], static_cast< IndexValueType >( x0 ) );
+    last[ 0 ]  = std::max( last[ 0 ], static_cast< IndexValueType >( x1 ) );
+    for( unsigned int i = 1; i < VDimension; ++i )
+    {
+      first[ i ] = std::min( first[ i ], lineIndex[ i ] );
+      last[ i ]  = std::max( last[ i ], lineIndex[ i ] );
+    }
+  }
+
+  /** An empty mask has an empty bounding box. */
+  RegionType boundingBox;
+  if( first[ 0 ] > last[ 0 ] )
+  {
+    boundingBox.SetIndex( region.GetIndex() );
+    return boundingBox;
+  }
+
+  IndexType start;
+  SizeType  size;
+  for( unsigned int i = 0; i < VDimension; ++i )
+  {
+    start[ i ] = region.GetIndex()[ i ] + first[ i ];
+    size[ i ]  = static_cast< SizeValueType >( last[ i ] - first[ i ] + 1 );
+  }
+  boundingBox.SetIndex( start );
+  boundingBox.SetSize( size );
+  return boundingBox;
+
+} // end ComputeBoundingBoxFromBitMask()
+
+
+/**
+ * ******************* ComputeOccupancy *******************
+ */
+
+template< unsigned int VDimension >
+void
+ImageMaskLookup< VDimension >
+::ComputeOccupancy( const MaskImageType * image,
+  const BitPackedImageMaskSpatialObjectType * bitPackedMask )
+{
+  const SizeType  size  = this->m_BoundingBoxRegion.GetSize();
+  const IndexType start = this->m_BoundingBoxRegion.GetIndex();
+
+  /** The blocks have a power of two edge length, so that the block of
+   * a voxel is found with a shift.
+   */
+  this->m_BlockShift = 0;
+  while( ( 2u << this->m_BlockShift ) <= this->m_BlockSize )
+  {
+    ++this->m_BlockShift;
+  }
+  this->m_UseBlocks = this->m_BlockShift > 0;
+
+  /** Compute the offset tables. */
+  SizeType        numberOfBlocks;
+  OffsetValueType numberOfVoxels      = 1;
+  OffsetValueType totalNumberOfBlocks = 1;
+  for( unsigned int i = 0; i < VDimension; ++i )
+  {
+    numberOfBlocks[ i ] = ( size[ i ] + ( SizeValueType( 1 ) << this->m_BlockShift ) - 1 ) >> this->m_BlockShift;
+    this->m_VoxelOffsetTable[ i ] = numberOfVoxels;
+    this->m_BlockOffsetTable[ i ] = this->m_UseBlocks ? totalNumberOfBlocks : 0;
+    numberOfVoxels      *= size[ i ];
+    totalNumberOfBlocks *= numberOfBlocks[ i ];
+  }
+
+  this->m_Bits.assign( ( numberOfVoxels + 63 ) / 64, 0 );
+  this->m_BlockStates.clear();
+  if( numberOfVoxels == 0 )
+  {
+    return;
+  }
+
+  /** Fill the bit grid, and count the nonzero voxels per block. */
+  std::vector< SizeValueType > blockCount;
+  if( this->m_UseBlocks )
+  {
+    blockCount.assign( totalNumberOfBlocks, 0 );
+  }
+
+  if( bitPackedMask != nullptr )
+  {
+    /** Copy the bits of the bounding box, line by line, skipping empty words. */
+    const RegionType    region        = image->GetBufferedRegion();
+    const SizeValueType wordsPerLine  = bitPackedMask->GetNumberOfWordsPerLine();
+    const SizeValueType numberOfLines = numberOfVoxels / size[ 0 ];
+    const SizeValueType xBegin        = start[ 0 ] - region.GetIndex()[ 0 ];
+    const SizeValueType xEnd          = xBegin + size[ 0 ];
+    const BitWordType * bits          = bitPackedMask->GetBitMask().data();
+    for( SizeValueType line = 0; line < numberOfLines; ++line )
+    {
+      /** The line in the bit mask, and its first voxel and block in the bounding box. */
+      SizeValueType   rest       = line;
+      SizeValueType   sourceLine = 0;
+      SizeValueType   lineStride = 1;
+      OffsetValueType voxelBase  = 0;
+      OffsetValueType blockBase  = 0;
+      for( unsigned int i = 1; i < VDimension; ++i )
+      {
+        const OffsetValueType relative = static_cast< OffsetValueType >( rest % size[ i ] );
+        rest       /= size[ i ];
+        sourceLine += ( relative + start[ i ] - region.GetIndex()[ i ] ) * lineStride;
+        lineStride *= region.GetSize( i );
+        voxelBase  += relative * this->m_VoxelOffsetTable[ i ];
+        blockBase  += ( relative >> this->m_BlockShift ) * this->m_BlockOffsetTable[ i ];
+      }
+
+      const BitWordType * words = bits + sourceLine * wordsPerLine;
+      for( SizeValueType x = xBegin; x < xEnd; ++x )
+      {
+        if( words[ x >> 6 ] == 0 )
+        {
+          x |= 63;
+          continue;
+        }
+        if( ( ( words[ x >> 6 ] >> ( x & 63 ) ) & 1 ) != 0 )
+        {
+          const OffsetValueType relative = static_cast< OffsetValueType >( x - xBegin );
+          const OffsetValueType voxel    = voxelBase + relative;
+          this->m_Bits[ voxel >> 6 ] |= std::uint64_t( 1 ) << ( voxel & 63 );
+          if( this->m_UseBlocks )
+          {
+            ++blockCount[ blockBase + ( relative >> this->m_BlockShift ) ];
+          }
+        }
+      }
+    }
+  }
+  else
+  {
+    typedef typename MaskImageType::PixelType PixelType;
+    ImageRegionConstIteratorWithIndex< MaskImageType > it( image, this->m_BoundingBoxRegion );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+      if( Math::NotExactlyEquals( it.Get(), NumericTraits< PixelType >::ZeroValue() ) )
+      {
+        const IndexType index = it.GetIndex();
+        OffsetValueType voxel = 0;
+        OffsetValueType block = 0;
+        for( unsigned int i = 0; i < VDimension; ++i )
+        {
+          const OffsetValueType relative = index[ i ] - start[ i ];
+          voxel += relative * this->m_VoxelOffsetTable[ i ];
+          block += ( relative >> this->m_BlockShift ) * this->m_BlockOffsetTable[ i ];
+        }
+        this->m_Bits[ voxel >> 6 ] |= std::uint64_t( 1 ) << ( voxel & 63 );
+        if( this->m_UseBlocks )
+        {
+          ++blockCount[ block ];
+        }
+      }
+    }
+  }
+
+  if( !this->m_UseBlocks )
+  {
+    return;
+  }
+
+  /** Classify the blocks. The blocks at the end of the bounding box may be
+   * smaller than the block size.
+   */
+  this->m_BlockStates.assign( totalNumberOfBlocks, MixedBlock );
+  for( OffsetValueType block = 0; block < totalNumberOfBlocks; ++block )
+  {
+    SizeValueType   blockVoxels = 1;
+    OffsetValueType rest        = block;
+    for( unsigned int i = 0; i < VDimension; ++i )
+    {
+      const SizeValueType blockIndex = rest % numberOfBlocks[ i ];
+      rest /= numberOfBlocks[ i ];
+      const SizeValueType first = blockIndex << this->m_BlockShift;
+      const SizeValueType last  = std::min< SizeValueType >(
+        first + ( SizeValueType( 1 ) << this->m_BlockShift ), size[ i ] );
+      blockVoxels *= last - first;
+    }
+
+    if( blockCount[ block ] == 0 )
+    {
+      this->m_BlockStates[ block ] = EmptyBlock;
+    }
+    else if( blockCount[ block ] == blockVoxels )
+    {
+      this->m_BlockStates[ block ] = FullBlock;
+    }
+  }
+
+} // end ComputeOccupancy()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< unsigned int VDimension >
+void
+ImageMaskLookup< VDimension >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "Mask: " << this->m_Mask.GetPointer() << std::endl;
+  os << indent << "BlockSize: " << this->m_BlockSize << std::endl;
+  os << indent << "UseFastLookup: " << this->m_UseFastLookup << std::endl;
+  os << indent << "UseBlocks: " << this->m_UseBlocks << std::endl;
+  os << indent << "BoundingBoxRegion: " << this->m_BoundingBoxRegion << std::endl;
+  os << indent << "PointToIndexMatrix: " << this->m_PointToIndexMatrix << std::endl;
+  os << indent << "PointToIndexOffset: " << this->m_PointToIndexOffset << std::endl;
+  os << indent << "Bits: " << this->m_Bits.size() << " words" << std::endl;
+  os << indent << "BlockStates: " << this->m_BlockStates.size() << " blocks" << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkImageMaskLookup_hxx
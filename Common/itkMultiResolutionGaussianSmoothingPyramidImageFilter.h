@@ -106,8 +106,10 @@ namespace itk
  * The N'th output correspond to the N'th level of the pyramid.
  *
  * To generate each output image, Gaussian smoothing is first performed
- * using a series of RecursiveGaussianImageFilter with standard deviation
- * (shrink factor / 2)*imagespacing.
+ * using a ParallelRecursiveGaussianImageFilter with standard deviation
+ * (shrink factor / 2)*imagespacing. This gives the same result as a series
+ * of RecursiveGaussianImageFilter's, but is cache-blocked and multi-threaded.
+ * All levels are smoothed from the input image.
  * The smoothed images are NOT downsampled, in contrast to the superclass's
  * behaviour.
  *
@@ -38,9 +38,9 @@
 #define _itkMultiResolutionGaussianSmoothingPyramidImageFilter_hxx
 
 #include "itkMultiResolutionGaussianSmoothingPyramidImageFilter.h"
-#include "itkCastImageFilter.h"
-#include "itkRecursiveGaussianImageFilter.h"
+#include "itkParallelRecursiveGaussianImageFilter.h"
 #include "itkMacro.h"
+#include "itkHotPathProfiler.h"
 
 #include "vnl/vnl_math.h"
 
@@ -95,48 +95,27 @@ void
 MultiResolutionGaussianSmoothingPyramidImageFilter< TInputImage, TOutputImage >
 ::GenerateData()
 {
+  itkHotPathScopedTimerMacro( "MultiResolutionPyramid::GenerateData" );
+
   // Get the input and output pointers
   InputImageConstPointer inputPtr = this->GetInput();
 
-  // Create caster and smoother  filters
-  typedef CastImageFilter< InputImageType, OutputImageType >               CasterType;
-  typedef RecursiveGaussianImageFilter< OutputImageType, OutputImageType > SmootherType;
-  typedef typename SmootherType::Pointer                                   SmootherPointer;
-  typedef typename ImageSource< OutputImageType >::Pointer                 BaseFilterPointer;
-  typedef FixedArray< SmootherPointer, ImageDimension >                    SmootherArrayType;
-  typedef FixedArray< BaseFilterPointer, ImageDimension >                  SmootherPointerArrayType;
-  typedef typename InputImageType::SpacingType                             SpacingType;
-
-  /** Create smoother pointer array, this array contains pointers
-   * to the filters for the different dimensions.
-   */
-  typename CasterType::Pointer caster = CasterType::New();
-  SmootherArrayType smootherArray;
-  for( unsigned int i = 0; i < ImageDimension; ++i )
-  {
-    smootherArray[ i ] = SmootherType::New();
-    smootherArray[ i ]->SetDirection( i );
-    smootherArray[ i ]->SetZeroOrder();
-    smootherArray[ i ]->SetNormalizeAcrossScale( false );
-    smootherArray[ i ]->ReleaseDataFlagOn();
-  }
-
-  /** Create smoother pointer array which maintains pointers
-   * to the previous filter to use. By using this separate pointer
-   * array we can skip dimensions for which the pyramid value is
-   * zero.
+  /** Create the smoother. It casts the input to the output, and smooths all
+   * dimensions in place. All levels are computed from the input, which is
+   * shared between the levels, so it is not copied once per level.
    */
-  SmootherPointerArrayType smootherPointerArray;
+  typedef ParallelRecursiveGaussianImageFilter< InputImageType, OutputImageType > SmootherType;
+  typedef typename SmootherType::SigmaArrayType                                   SigmaArrayType;
+  typedef typename InputImageType::SpacingType                                    SpacingType;
 
-  // First set the input of the first filter pointer to the input image.
-  caster->SetInput( inputPtr );
-  smootherArray[ 0 ]->SetInput( caster->GetOutput() );
+  typename SmootherType::Pointer smoother = SmootherType::New();
+  smoother->SetInput( inputPtr );
+  smoother->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
 
   /** Set the standard deviation and do the smoothing */
-  unsigned int ilevel, idim;
-  unsigned int factors[ ImageDimension ];
-  double       stdev[ ImageDimension ];
-  SpacingType  spacing = inputPtr->GetSpacing();
+  unsigned int   ilevel, idim;
+  SigmaArrayType stdev;
+  SpacingType    spacing = inputPtr->GetSpacing();
 
   for( ilevel = 0; ilevel < this->m_NumberOfLevels; ilevel++ )
   {
@@ -149,59 +128,27 @@ MultiResolutionGaussianSmoothingPyramidImageFilter< TInputImage, TOutputImage >
     outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
     outputPtr->Allocate();
 
-    // Force caster to regenerate data
-    // This is necessary because the caster may have to regenerate
-    // data for each output. (because this filter has n outputs, but
-    // for generating each output the caster filter is used.
-    caster->Modified();
-
-    // compute shrink factors and variances
+    // compute the standard deviations
     for( idim = 0; idim < ImageDimension; idim++ )
     {
-      factors[ idim ] = this->m_Schedule[ ilevel ][ idim ];
       /** Compute the standard deviation: 0.5 * factor * spacing
        * This is exactly like in the superclass
        * In the superclass, the DiscreteGaussianImageFilter is used, which
        * requires the variance, and has the option to ignore the image spacing.
-       * That's why the formula looks maybe different at first sight.   */
-      stdev[ idim ] = 0.5 * static_cast< float >( factors[ idim ] ) * spacing[ idim ];
-      smootherArray[ idim ]->SetSigma( stdev[ idim ] );
-      // force to always update in case shrink factors are the same
-      // (SK: this is necessary because we reuse this filter for every resolution?)
-      smootherArray[ idim ]->Modified();
-
-      // Update smoother pointer array for this dimension
-      if( factors[ idim ] == 0.0 )
-      {
-        // Bypass the filter for this dimension
-        if( idim > 0 )
-        {
-          smootherPointerArray[ idim ] = smootherPointerArray[ idim - 1 ];
-        }
-        else
-        {
-          smootherPointerArray[ idim ] = caster;
-        }
-      }
-      else
-      {
-        // Use the filter for this dimension
-        smootherPointerArray[ idim ] = smootherArray[ idim ];
-      }
-
-      /** Set the input of the smoother filters to the previous pointers
-       * maintained in the pointer array.
-       */
-      if( idim > 0 )
-      {
-        smootherArray[ idim ]->SetInput( smootherPointerArray[ idim - 1 ]->GetOutput() );
-      }
+       * That's why the formula looks maybe different at first sight.
+       * A factor of zero gives a standard deviation of zero, for which the
+       * smoother skips this dimension.   */
+      const unsigned int factor = this->m_Schedule[ ilevel ][ idim ];
+      stdev[ idim ] = 0.5 * static_cast< float >( factor ) * spacing[ idim ];
     }
+    smoother->SetSigmaArray( stdev );
 
-    smootherPointerArray[ ImageDimension - 1 ]->GraftOutput( outputPtr );
-    smootherPointerArray[ ImageDimension - 1 ]->Update();
+    // force to always update in case shrink factors are the same
+    smoother->Modified();
+    smoother->GraftOutput( outputPtr );
+    smoother->Update();
 
-    this->GraftNthOutput( ilevel, smootherPointerArray[ ImageDimension - 1 ]->GetOutput() );
+    this->GraftNthOutput( ilevel, smoother->GetOutput() );
 
   } // for ilevel...
 
@@ -21,6 +21,7 @@
 #include "itkMultiResolutionShrinkPyramidImageFilter.h"
 
 #include "itkShrinkImageFilter.h"
+#include "itkHotPathProfiler.h"
 #include "vnl/vnl_math.h"
 
 namespace itk
@@ -34,6 +35,8 @@ void
 MultiResolutionShrinkPyramidImageFilter< TInputImage, TOutputImage >
 ::GenerateData( void )
 {
+  itkHotPathScopedTimerMacro( "MultiResolutionPyramid::GenerateData" );
+
   /** Create the shrinking filter. */
   typedef ShrinkImageFilter< TInputImage, TOutputImage > ShrinkerType;
   typename ShrinkerType::Pointer shrinker = ShrinkerType::New();
@@ -0,0 +1,353 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkOptimizerVectorKernels_h
+#define __itkOptimizerVectorKernels_h
+
+#include "itkArray.h"
+#include "itkPlatformMultiThreader.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace itk
+{
+
+/** \class OptimizerVectorKernels
+ * \brief Multi-threaded vector kernels for the optimizers.
+ *
+ * This class collects the vector operations that the optimizers perform on
+ * the parameters and derivatives: the update of the position, axpy, scaling,
+ * element-wise products, inner products and norms.
+ *
+ * The vectors are processed in blocks of BlockSize elements. The inner loops
+ * are simple loops over contiguous memory, and the reductions use several
+ * independent accumulators, so that the compiler can vectorize them. For
+ * large vectors the blocks are distributed over the work units of the
+ * threader of the calling optimizer, so that no threader is created per call.
+ * The partial results of the reductions are stored per block and summed in
+ * block order, so the result does not depend on the number of threads.
+ *
+ * Each function takes the threader and the number of threads to use as its
+ * last arguments. With a null threader, or a single thread, the vectors are
+ * processed by the calling thread.
+ *
+ * \ingroup Numerics Optimizers
+ */
+
+class OptimizerVectorKernels
+{
+public:
+
+  /** Typedefs. */
+  typedef OptimizerVectorKernels      Self;
+  typedef Array< double >             VectorType;
+  typedef itk::PlatformMultiThreader  ThreaderType;
+  typedef ThreaderType::WorkUnitInfo  ThreadInfoType;
+
+  /** The number of elements per block. */
+  itkStaticConstMacro( BlockSize, SizeValueType, 8192 );
+
+  /** Vectors with less elements are processed single-threaded. */
+  itkStaticConstMacro( MinimumSizeForMultiThreading, SizeValueType, 65536 );
+
+  /** out = x + alpha * y. The output may be equal to x or y. */
+  static void ScaledAdd( const double * x, const double alpha, const double * y,
+    double * out, const SizeValueType n,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    ScaledAddKernel kernel = { x, alpha, y, out };
+    Self::Run( kernel, n, threader, numberOfThreads );
+  }
+
+
+  /** y = y + alpha * x. */
+  static void Axpy( const double alpha, const double * x, double * y, const SizeValueType n,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    Self::ScaledAdd( y, alpha, x, y, n, threader, numberOfThreads );
+  }
+
+
+  /** x = alpha * x. */
+  static void Scale( const double alpha, double * x, const SizeValueType n,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    ScaleKernel kernel = { alpha, x };
+    Self::Run( kernel, n, threader, numberOfThreads );
+  }
+
+
+  /** y = x .* y, the element-wise product. */
+  static void Multiply( const double * x, double * y, const SizeValueType n,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    MultiplyKernel kernel = { x, y };
+    Self::Run( kernel, n, threader, numberOfThreads );
+  }
+
+
+  /** Returns the inner product of x and y. */
+  static double Dot( const double * x, const double * y, const SizeValueType n,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    std::vector< double > partialSums( Self::GetNumberOfBlocks( n ) );
+    DotKernel             kernel = { x, y, partialSums.empty() ? nullptr : &partialSums[ 0 ] };
+    Self::Run( kernel, n, threader, numberOfThreads );
+    return Self::Sum( partialSums );
+  }
+
+
+  /** Returns the squared Euclidean norm of x. */
+  static double SquaredNorm( const double * x, const SizeValueType n,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    return Self::Dot( x, x, n, threader, numberOfThreads );
+  }
+
+
+  /** Returns the Euclidean norm of x. */
+  static double Norm( const double * x, const SizeValueType n,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    return std::sqrt( Self::SquaredNorm( x, n, threader, numberOfThreads ) );
+  }
+
+
+  /** Convenience functions for itk::Array, and thereby for the
+   * parameters and derivatives of the optimizers.
+   */
+  static void ScaledAdd( const VectorType & x, const double alpha, const VectorType & y, VectorType & out,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    Self::ScaledAdd( x.data_block(), alpha, y.data_block(), out.data_block(), x.GetSize(),
+      threader, numberOfThreads );
+  }
+
+
+  static void Axpy( const double alpha, const VectorType & x, VectorType & y,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    Self::Axpy( alpha, x.data_block(), y.data_block(), x.GetSize(), threader, numberOfThreads );
+  }
+
+
+  static void Scale( const double alpha, VectorType & x,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    Self::Scale( alpha, x.data_block(), x.GetSize(), threader, numberOfThreads );
+  }
+
+
+  static void Multiply( const VectorType & x, VectorType & y,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    Self::Multiply( x.data_block(), y.data_block(), x.GetSize(), threader, numberOfThreads );
+  }
+
+
+  static double Dot( const VectorType & x, const VectorType & y,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    return Self::Dot( x.data_block(), y.data_block(), x.GetSize(), threader, numberOfThreads );
+  }
+
+
+  static double SquaredNorm( const VectorType & x,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    return Self::SquaredNorm( x.data_block(), x.GetSize(), threader, numberOfThreads );
+  }
+
+
+  static double Norm( const VectorType & x,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    return Self::Norm( x.data_block(), x.GetSize(), threader, numberOfThreads );
+  }
+
+
+  /** Run a kernel over all blocks, multi-threaded for large vectors.
+   * The kernel is called as kernel( begin, end, block ) and should process
+   * the elements [begin, end). This allows optimizers to fuse several
+   * element-wise operations in a single pass over the memory.
+   * The blocks are distributed over numberOfThreads work units of the
+   * given threader. The threader should not be executing already.
+   */
+  template< class TKernel >
+  static void Run( const TKernel & kernel, const SizeValueType n,
+    ThreaderType * threader, const ThreadIdType numberOfThreads )
+  {
+    const SizeValueType numberOfBlocks = Self::GetNumberOfBlocks( n );
+    const ThreadIdType  numberOfWorkUnits = static_cast< ThreadIdType >( std::min(
+      static_cast< SizeValueType >( numberOfThreads ), numberOfBlocks ) );
+
+    if( threader == nullptr || n < MinimumSizeForMultiThreading || numberOfWorkUnits < 2 )
+    {
+      Self::RunBlocks( kernel, n, 0, numberOfBlocks );
+      return;
+    }
+
+    /** Restore the number of work units afterwards, since the threader
+     * belongs to the caller.
+     */
+    ThreaderParameterType< TKernel > temp = { &kernel, n };
+    const ThreadIdType previousNumberOfWorkUnits = threader->GetNumberOfWorkUnits();
+    threader->SetNumberOfWorkUnits( numberOfWorkUnits );
+    threader->SetSingleMethod( RunThreaderCallback< TKernel >, static_cast< void * >( &temp ) );
+    threader->SingleMethodExecute();
+    threader->SetNumberOfWorkUnits( previousNumberOfWorkUnits );
+  }
+
+
+private:
+
+  OptimizerVectorKernels();                  // purposely not implemented
+  OptimizerVectorKernels( const Self & );    // purposely not implemented
+  void operator=( const Self & );            // purposely not implemented
+
+  /** The kernels. Each processes the elements [begin, end) of block b. */
+  struct ScaledAddKernel
+  {
+    const double * x;
+    double         alpha;
+    const double * y;
+    double *       out;
+
+    void operator()( const SizeValueType begin, const SizeValueType end, const SizeValueType ) const
+    {
+      for( SizeValueType j = begin; j < end; ++j )
+      {
+        out[ j ] = x[ j ] + alpha * y[ j ];
+      }
+    }
+  };
+
+  struct ScaleKernel
+  {
+    double   alpha;
+    double * x;
+
+    void operator()( const SizeValueType begin, const SizeValueType end, const SizeValueType ) const
+    {
+      for( SizeValueType j = begin; j < end; ++j )
+      {
+        x[ j ] *= alpha;
+      }
+    }
+  };
+
+  struct MultiplyKernel
+  {
+    const double * x;
+    double *       y;
+
+    void operator()( const SizeValueType begin, const SizeValueType end, const SizeValueType ) const
+    {
+      for( SizeValueType j = begin; j < end; ++j )
+      {
+        y[ j ] *= x[ j ];
+      }
+    }
+  };
+
+  struct DotKernel
+  {
+    const double * x;
+    const double * y;
+    double *       partialSums;
+
+    void operator()( const SizeValueType begin, const SizeValueType end, const SizeValueType block ) const
+    {
+      /** Four independent accumulators allow vectorization. */
+      double        sum[ 4 ] = { 0.0, 0.0, 0.0, 0.0 };
+      SizeValueType j        = begin;
+      for(; j + 4 <= end; j += 4 )
+      {
+        sum[ 0 ] += x[ j ] * y[ j ];
+        sum[ 1 ] += x[ j + 1 ] * y[ j + 1 ];
+        sum[ 2 ] += x[ j + 2 ] * y[ j + 2 ];
+        sum[ 3 ] += x[ j + 3 ] * y[ j + 3 ];
+      }
+      for(; j < end; ++j )
+      {
+        sum[ 0 ] += x[ j ] * y[ j ];
+      }
+      partialSums[ block ] = ( sum[ 0 ] + sum[ 1 ] ) + ( sum[ 2 ] + sum[ 3 ] );
+    }
+  };
+
+  /** Struct to pass data to the threads. */
+  template< class TKernel >
+  struct ThreaderParameterType
+  {
+    const TKernel * st_Kernel;
+    SizeValueType   st_Size;
+  };
+
+  static SizeValueType GetNumberOfBlocks( const SizeValueType n )
+  {
+    return ( n + BlockSize - 1 ) / BlockSize;
+  }
+
+
+  static double Sum( const std::vector< double > & partialSums )
+  {
+    double sum = 0.0;
+    for( std::size_t b = 0; b < partialSums.size(); ++b )
+    {
+      sum += partialSums[ b ];
+    }
+    return sum;
+  }
+
+
+  /** Process the blocks [blockBegin, blockEnd). */
+  template< class TKernel >
+  static void RunBlocks( const TKernel & kernel, const SizeValueType n,
+    const SizeValueType blockBegin, const SizeValueType blockEnd )
+  {
+    for( SizeValueType b = blockBegin; b < blockEnd; ++b )
+    {
+      kernel( b * BlockSize, std::min( ( b + 1 ) * BlockSize, n ), b );
+    }
+  }
+
+
+  /** The callback function. */
+  template< class TKernel >
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION RunThreaderCallback( void * arg )
+  {
+    ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+    const ThreaderParameterType< TKernel > * temp
+      = static_cast< const ThreaderParameterType< TKernel > * >( infoStruct->UserData );
+
+    const SizeValueType numberOfBlocks = Self::GetNumberOfBlocks( temp->st_Size );
+    const SizeValueType blockBegin
+      = numberOfBlocks * infoStruct->WorkUnitID / infoStruct->NumberOfWorkUnits;
+    const SizeValueType blockEnd
+      = numberOfBlocks * ( infoStruct->WorkUnitID + 1 ) / infoStruct->NumberOfWorkUnits;
+    Self::RunBlocks( *temp->st_Kernel, temp->st_Size, blockBegin, blockEnd );
+
+    return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+  }
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkOptimizerVectorKernels_h
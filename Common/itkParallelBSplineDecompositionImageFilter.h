@@ -0,0 +1,153 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkParallelBSplineDecompositionImageFilter_h
+#define __itkParallelBSplineDecompositionImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkImageLinearIteratorWithIndex.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class ParallelBSplineDecompositionImageFilter
+ * \brief Multi-threaded computation of the B-spline coefficients of an image.
+ *
+ * This filter computes the same coefficients as the
+ * itk::BSplineDecompositionImageFilter: the recursive filter of
+ * Unser [1] with mirror boundary conditions is applied along each
+ * dimension in turn. Within one dimension the scan lines are independent,
+ * so they are distributed over the threads. Every thread uses its own
+ * scratch buffer; the order of the dimensions is kept, so that the
+ * output does not depend on the number of threads.
+ *
+ *    [1] M. Unser,
+ *       "Splines: A Perfect Fit for Signal and Image Processing,"
+ *        IEEE Signal Processing Magazine, vol. 16, no. 6, pp. 22-38,
+ *        November 1999.
+ *
+ * Limitations:  Spline order must be between 0 and 5.
+ *               Can only process the LargestPossibleRegion.
+ *
+ * \sa BSplineDecompositionImageFilter
+ * \ingroup ImageFilters
+ * \ingroup CannotBeStreamed
+ */
+
+template< class TInputImage, class TOutputImage >
+class ParallelBSplineDecompositionImageFilter :
+  public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef ParallelBSplineDecompositionImageFilter         Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self >                            Pointer;
+  typedef SmartPointer< const Self >                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ParallelBSplineDecompositionImageFilter, ImageToImageFilter );
+
+  /** Dimension of the images. */
+  itkStaticConstMacro( ImageDimension, unsigned int, TInputImage::ImageDimension );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename Superclass::OutputImageRegionType  OutputImageRegionType;
+  typedef typename OutputImageType::PixelType         OutputPixelType;
+
+  /** The type used for the recursive filtering. */
+  typedef typename NumericTraits< OutputPixelType >::RealType CoeffType;
+  typedef std::vector< CoeffType >                            ScratchType;
+
+  /** Iterator typedef. */
+  typedef ImageLinearIteratorWithIndex< OutputImageType > OutputLinearIterator;
+
+  /** Set/Get the spline order, supports 0th - 5th order splines.
+   * The default is a 3rd order spline.
+   */
+  void SetSplineOrder( unsigned int order );
+
+  itkGetConstMacro( SplineOrder, unsigned int );
+
+protected:
+
+  /** The constructor. */
+  ParallelBSplineDecompositionImageFilter();
+
+  /** The destructor. */
+  ~ParallelBSplineDecompositionImageFilter() override {}
+
+  /** Copy the input to the output and filter the lines, one dimension at a time. */
+  void GenerateData( void ) override;
+
+  /** This filter requires all of the input image. */
+  void GenerateInputRequestedRegion( void ) override;
+
+  /** This filter must produce all of its output at once. */
+  void EnlargeOutputRequestedRegion( DataObject * output ) override;
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  ParallelBSplineDecompositionImageFilter( const Self & ); // purposely not implemented
+  void operator=( const Self & );                          // purposely not implemented
+
+  /** Filter the lines along m_CurrentDirection that lie in the part
+   * of the output assigned to this thread.
+   */
+  void ThreadedDataToCoefficients( ThreadIdType threadId, ThreadIdType numberOfThreads );
+
+  /** Converts a line of data to B-spline coefficients, in place. */
+  void DataToCoefficients1D( ScratchType & scratch, const SizeValueType length ) const;
+
+  /** Determines the first coefficient for the causal filtering of a line. */
+  void SetInitialCausalCoefficient( ScratchType & scratch, const SizeValueType length, const double z ) const;
+
+  /** Determines the first coefficient for the anti-causal filtering of a line. */
+  void SetInitialAntiCausalCoefficient( ScratchType & scratch, const SizeValueType length, const double z ) const;
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION DataToCoefficientsThreaderCallback( void * arg );
+
+  /** Member variables. */
+  unsigned int m_SplineOrder;
+  double       m_SplinePoles[ 2 ];
+  int          m_NumberOfPoles;
+  double       m_Tolerance;
+  unsigned int m_CurrentDirection;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkParallelBSplineDecompositionImageFilter.hxx"
+#endif
+
+#endif // end #ifndef __itkParallelBSplineDecompositionImageFilter_h
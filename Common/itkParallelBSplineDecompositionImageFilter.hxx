@@ -0,0 +1,406 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkParallelBSplineDecompositionImageFilter_hxx
+#define __itkParallelBSplineDecompositionImageFilter_hxx
+
+#include "itkParallelBSplineDecompositionImageFilter.h"
+#include "itkImageAlgorithm.h"
+
+#include <algorithm>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::ParallelBSplineDecompositionImageFilter()
+{
+  this->m_SplineOrder      = 0;
+  this->m_NumberOfPoles    = 0;
+  this->m_SplinePoles[ 0 ] = 0.0;
+  this->m_SplinePoles[ 1 ] = 0.0;
+  this->m_Tolerance        = 1e-10;
+  this->m_CurrentDirection = 0;
+
+  this->SetSplineOrder( 3 );
+
+} // end Constructor()
+
+
+/**
+ * ******************* SetSplineOrder *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::SetSplineOrder( unsigned int order )
+{
+  if( order == this->m_SplineOrder )
+  {
+    return;
+  }
+
+  /** See Unser, 1997. Part II, Table I for the pole values. */
+  switch( order )
+  {
+    case 0:
+    case 1:
+      this->m_NumberOfPoles = 0;
+      break;
+    case 2:
+      this->m_NumberOfPoles    = 1;
+      this->m_SplinePoles[ 0 ] = std::sqrt( 8.0 ) - 3.0;
+      break;
+    case 3:
+      this->m_NumberOfPoles    = 1;
+      this->m_SplinePoles[ 0 ] = std::sqrt( 3.0 ) - 2.0;
+      break;
+    case 4:
+      this->m_NumberOfPoles    = 2;
+      this->m_SplinePoles[ 0 ] = std::sqrt( 664.0 - std::sqrt( 438976.0 ) ) + std::sqrt( 304.0 ) - 19.0;
+      this->m_SplinePoles[ 1 ] = std::sqrt( 664.0 + std::sqrt( 438976.0 ) ) - std::sqrt( 304.0 ) - 19.0;
+      break;
+    case 5:
+      this->m_NumberOfPoles    = 2;
+      this->m_SplinePoles[ 0 ] = std::sqrt( 135.0 / 2.0 - std::sqrt( 17745.0 / 4.0 ) ) + std::sqrt( 105.0 / 4.0 )
+        - 13.0 / 2.0;
+      this->m_SplinePoles[ 1 ] = std::sqrt( 135.0 / 2.0 + std::sqrt( 17745.0 / 4.0 ) ) - std::sqrt( 105.0 / 4.0 )
+        - 13.0 / 2.0;
+      break;
+    default:
+      itkExceptionMacro( << "SplineOrder must be between 0 and 5. Requested spline order has not been implemented yet." );
+  }
+
+  this->m_SplineOrder = order;
+  this->Modified();
+
+} // end SetSplineOrder()
+
+
+/**
+ * ******************* GenerateInputRequestedRegion *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::GenerateInputRequestedRegion( void )
+{
+  /** This filter requires all of the input image to be in the buffer. */
+  InputImageType * inputPtr = const_cast< InputImageType * >( this->GetInput() );
+  if( inputPtr )
+  {
+    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end GenerateInputRequestedRegion()
+
+
+/**
+ * ******************* EnlargeOutputRequestedRegion *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  /** This filter produces all of the output image at once. */
+  OutputImageType * imgData = dynamic_cast< OutputImageType * >( output );
+  if( imgData )
+  {
+    imgData->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end EnlargeOutputRequestedRegion()
+
+
+/**
+ * ******************* GenerateData *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::GenerateData( void )
+{
+  /** Allocate the output image. */
+  InputImageConstPointer inputPtr  = this->GetInput();
+  OutputImagePointer     outputPtr = this->GetOutput();
+  outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
+  outputPtr->Allocate();
+
+  /** The coefficients are initialized to the input data. */
+  ImageAlgorithm::Copy( inputPtr.GetPointer(), outputPtr.GetPointer(),
+    inputPtr->GetBufferedRegion(), outputPtr->GetBufferedRegion() );
+
+  /** Spline orders 0 and 1 do not need any filtering. */
+  if( this->m_NumberOfPoles == 0 )
+  {
+    return;
+  }
+
+  /** Filter the lines of one dimension at a time. The lines of a dimension
+   * are distributed over the threads, which requires the previous dimension
+   * to be finished.
+   */
+  const typename OutputImageType::SizeType size = outputPtr->GetBufferedRegion().GetSize();
+  for( unsigned int n = 0; n < ImageDimension; ++n )
+  {
+    /** A line of length 1 is left unchanged (mirror boundaries). */
+    if( size[ n ] == 1 ) { continue; }
+
+    this->m_CurrentDirection = n;
+    this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+    this->GetMultiThreader()->SetSingleMethod( DataToCoefficientsThreaderCallback, this );
+    this->GetMultiThreader()->SingleMethodExecute();
+  }
+
+} // end GenerateData()
+
+
+/**
+ * ******************* DataToCoefficientsThreaderCallback *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::DataToCoefficientsThreaderCallback( void * arg )
+{
+  typedef typename MultiThreaderBase::WorkUnitInfo ThreadInfoType;
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  Self *           filter     = static_cast< Self * >( infoStruct->UserData );
+
+  filter->ThreadedDataToCoefficients( infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end DataToCoefficientsThreaderCallback()
+
+
+/**
+ * ******************* ThreadedDataToCoefficients *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::ThreadedDataToCoefficients( ThreadIdType threadId, ThreadIdType numberOfThreads )
+{
+  OutputImageType *     outputPtr = this->GetOutput();
+  OutputImageRegionType region    = outputPtr->GetBufferedRegion();
+  const unsigned int    direction = this->m_CurrentDirection;
+  const SizeValueType   length    = region.GetSize( direction );
+
+  /** Split the region along a dimension other than the filtering direction,
+   * so that every thread gets complete lines.
+   */
+  if( ImageDimension > 1 )
+  {
+    const unsigned int splitDimension = ( direction == ImageDimension - 1 )
+      ? ImageDimension - 2 : ImageDimension - 1;
+    const SizeValueType splitSize = region.GetSize( splitDimension );
+    const SizeValueType chunkSize = ( splitSize + numberOfThreads - 1 ) / numberOfThreads;
+    const SizeValueType begin     = std::min( chunkSize * threadId, splitSize );
+    const SizeValueType end       = std::min( begin + chunkSize, splitSize );
+    if( begin == end ) { return; }
+
+    region.SetIndex( splitDimension, region.GetIndex( splitDimension ) + static_cast< IndexValueType >( begin ) );
+    region.SetSize( splitDimension, end - begin );
+  }
+  else if( threadId != 0 )
+  {
+    return;
+  }
+
+  /** Each thread has its own scratch buffer. */
+  ScratchType scratch( length );
+
+  OutputLinearIterator it( outputPtr, region );
+  it.SetDirection( direction );
+  it.GoToBegin();
+  while( !it.IsAtEnd() )
+  {
+    /** Copy the line to the scratch buffer. */
+    SizeValueType j = 0;
+    while( !it.IsAtEndOfLine() )
+    {
+      scratch[ j ] = static_cast< CoeffType >( it.Get() );
+      ++it; ++j;
+    }
+
+    /** Perform the 1D B-spline calculations. */
+    this->DataToCoefficients1D( scratch, length );
+
+    /** Copy the scratch buffer back to the line. */
+    it.GoToBeginOfLine();
+    j = 0;
+    while( !it.IsAtEndOfLine() )
+    {
+      it.Set( static_cast< OutputPixelType >( scratch[ j ] ) );
+      ++it; ++j;
+    }
+    it.NextLine();
+  }
+
+} // end ThreadedDataToCoefficients()
+
+
+/**
+ * ******************* DataToCoefficients1D *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::DataToCoefficients1D( ScratchType & scratch, const SizeValueType length ) const
+{
+  /** See Unser, 1993, Part II, Equation 2.5,
+   * or Unser, 1999, Box 2. for an explanation.
+   */
+
+  /** Compute and apply the overall gain. For cubic splines it equals 6. */
+  double c0 = 1.0;
+  for( int k = 0; k < this->m_NumberOfPoles; ++k )
+  {
+    c0 *= ( 1.0 - this->m_SplinePoles[ k ] ) * ( 1.0 - 1.0 / this->m_SplinePoles[ k ] );
+  }
+  for( SizeValueType n = 0; n < length; ++n )
+  {
+    scratch[ n ] *= c0;
+  }
+
+  /** Loop over all poles. */
+  for( int k = 0; k < this->m_NumberOfPoles; ++k )
+  {
+    const double z = this->m_SplinePoles[ k ];
+
+    /** Causal initialization and recursion. */
+    this->SetInitialCausalCoefficient( scratch, length, z );
+    for( SizeValueType n = 1; n < length; ++n )
+    {
+      scratch[ n ] += z * scratch[ n - 1 ];
+    }
+
+    /** Anti-causal initialization and recursion. */
+    this->SetInitialAntiCausalCoefficient( scratch, length, z );
+    for( OffsetValueType n = static_cast< OffsetValueType >( length ) - 2; 0 <= n; --n )
+    {
+      scratch[ n ] = z * ( scratch[ n + 1 ] - scratch[ n ] );
+    }
+  }
+
+} // end DataToCoefficients1D()
+
+
+/**
+ * ******************* SetInitialCausalCoefficient *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::SetInitialCausalCoefficient( ScratchType & scratch, const SizeValueType length, const double z ) const
+{
+  /** This initialization corresponds to mirror boundaries.
+   * See Unser, 1999, Box 2 for an explanation.
+   */
+  SizeValueType horizon = length;
+  if( this->m_Tolerance > 0.0 )
+  {
+    horizon = static_cast< SizeValueType >(
+      std::ceil( std::log( this->m_Tolerance ) / std::log( std::fabs( z ) ) ) );
+  }
+
+  double zn = z;
+  if( horizon < length )
+  {
+    /** Accelerated loop. */
+    CoeffType sum = scratch[ 0 ];
+    for( SizeValueType n = 1; n < horizon; ++n )
+    {
+      sum += zn * scratch[ n ];
+      zn  *= z;
+    }
+    scratch[ 0 ] = sum;
+  }
+  else
+  {
+    /** Full loop. */
+    const double iz  = 1.0 / z;
+    double       z2n = std::pow( z, static_cast< double >( length - 1 ) );
+    CoeffType    sum = scratch[ 0 ] + z2n * scratch[ length - 1 ];
+    z2n *= z2n * iz;
+    for( SizeValueType n = 1; n + 1 < length; ++n )
+    {
+      sum += ( zn + z2n ) * scratch[ n ];
+      zn  *= z;
+      z2n *= iz;
+    }
+    scratch[ 0 ] = sum / ( 1.0 - zn * zn );
+  }
+
+} // end SetInitialCausalCoefficient()
+
+
+/**
+ * ******************* SetInitialAntiCausalCoefficient *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::SetInitialAntiCausalCoefficient( ScratchType & scratch, const SizeValueType length, const double z ) const
+{
+  /** This initialization corresponds to mirror boundaries.
+   * See Unser, 1999, Box 2 and the erratum at
+   * http://bigwww.epfl.ch/publications/unser9902.html
+   */
+  scratch[ length - 1 ] = ( z / ( z * z - 1.0 ) )
+    * ( z * scratch[ length - 2 ] + scratch[ length - 1 ] );
+
+} // end SetInitialAntiCausalCoefficient()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelBSplineDecompositionImageFilter< TInputImage, TOutputImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "SplineOrder: " << this->m_SplineOrder << std::endl;
+  os << indent << "NumberOfPoles: " << this->m_NumberOfPoles << std::endl;
+  os << indent << "Tolerance: " << this->m_Tolerance << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkParallelBSplineDecompositionImageFilter_hxx
@@ -0,0 +1,181 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkParallelRecursiveGaussianImageFilter_h
+#define __itkParallelRecursiveGaussianImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkFixedArray.h"
+
+#include <vector>
+
+namespace itk
+{
+
+/** \class ParallelRecursiveGaussianImageFilter
+ * \brief Multi-threaded, cache-blocked recursive Gaussian smoothing.
+ *
+ * This filter smooths an image with a Gaussian along every dimension. The
+ * result equals that of a series of itk::RecursiveGaussianImageFilter's, one
+ * per dimension, with zero order and without normalization across scale:
+ * the same recursive approximation of Deriche [1] and the same boundary
+ * conditions are used.
+ *
+ * The RecursiveGaussianImageFilter processes one line at a time. Along the
+ * slow dimensions of an image the pixels of a line are far apart in memory,
+ * which gives a cache miss for almost every pixel of a large 3D image. This
+ * filter processes tiles of neighbouring lines instead: the tile is copied
+ * to a buffer in which the pixels of the lines are interleaved, the
+ * recursion is applied to all lines of the tile at once, and the result is
+ * copied back. Every access to the image then reads or writes
+ * TileSize consecutive pixels. The tiles are distributed over the threads.
+ * The order of the dimensions is kept, so that the output does not depend
+ * on the number of threads.
+ *
+ * The standard deviation is given in physical units, per dimension.
+ * Dimensions with a standard deviation of zero are not smoothed.
+ *
+ *    [1] R. Deriche,
+ *       "Recursively Implementing The Gaussian and Its Derivatives",
+ *        INRIA, Research Report 1893, 1993.
+ *
+ * Limitations:  Only scalar images are supported.
+ *               Can only process the LargestPossibleRegion.
+ *               Smoothed dimensions need at least four pixels.
+ *
+ * \sa RecursiveGaussianImageFilter, MultiResolutionGaussianSmoothingPyramidImageFilter
+ * \ingroup ImageFilters
+ * \ingroup CannotBeStreamed
+ */
+
+template< class TInputImage, class TOutputImage >
+class ParallelRecursiveGaussianImageFilter :
+  public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef ParallelRecursiveGaussianImageFilter            Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self >                            Pointer;
+  typedef SmartPointer< const Self >                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( ParallelRecursiveGaussianImageFilter, ImageToImageFilter );
+
+  /** Dimension of the images. */
+  itkStaticConstMacro( ImageDimension, unsigned int, TInputImage::ImageDimension );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::InputImageType         InputImageType;
+  typedef typename Superclass::InputImageConstPointer InputImageConstPointer;
+  typedef typename Superclass::OutputImageType        OutputImageType;
+  typedef typename Superclass::OutputImagePointer     OutputImagePointer;
+  typedef typename OutputImageType::PixelType         OutputPixelType;
+
+  /** The type used for the recursive filtering. */
+  typedef typename NumericTraits< OutputPixelType >::RealType RealType;
+  typedef std::vector< RealType >                             ScratchType;
+
+  /** The standard deviations, per dimension. */
+  typedef FixedArray< double, itkGetStaticConstMacro( ImageDimension ) > SigmaArrayType;
+
+  /** Set/Get the standard deviations in physical units. Default: 1.0. */
+  itkSetMacro( SigmaArray, SigmaArrayType );
+  itkGetConstReferenceMacro( SigmaArray, SigmaArrayType );
+
+  /** Set the same standard deviation for all dimensions. */
+  void SetSigma( const double sigma );
+
+  /** Set/Get the maximum number of lines that are filtered together
+   * along the slow dimensions. Default: 16.
+   */
+  itkSetClampMacro( TileSize, unsigned int, 1, NumericTraits< unsigned int >::max() );
+  itkGetConstMacro( TileSize, unsigned int );
+
+protected:
+
+  /** The constructor. */
+  ParallelRecursiveGaussianImageFilter();
+
+  /** The destructor. */
+  ~ParallelRecursiveGaussianImageFilter() override {}
+
+  /** Copy the input to the output and filter the lines, one dimension at a time. */
+  void GenerateData( void ) override;
+
+  /** This filter requires all of the input image. */
+  void GenerateInputRequestedRegion( void ) override;
+
+  /** This filter must produce all of its output at once. */
+  void EnlargeOutputRequestedRegion( DataObject * output ) override;
+
+  /** PrintSelf. */
+  void PrintSelf( std::ostream & os, Indent indent ) const override;
+
+private:
+
+  ParallelRecursiveGaussianImageFilter( const Self & ); // purposely not implemented
+  void operator=( const Self & );                       // purposely not implemented
+
+  /** The coefficients of the recursive filter along one dimension;
+   * see itk::RecursiveSeparableImageFilter for their meaning.
+   */
+  struct CoefficientsType
+  {
+    double st_N0, st_N1, st_N2, st_N3;
+    double st_M1, st_M2, st_M3, st_M4;
+    double st_D1, st_D2, st_D3, st_D4;
+    double st_BN1, st_BN2, st_BN3, st_BN4;
+    double st_BM1, st_BM2, st_BM3, st_BM4;
+  };
+
+  /** Compute the zero order coefficients for a standard deviation in pixels. */
+  static void ComputeCoefficients( const double sigma, CoefficientsType & c );
+
+  /** Filter the tiles of lines along m_CurrentDirection that are assigned to
+   * this thread.
+   */
+  void ThreadedFilterTiles( ThreadIdType threadId, ThreadIdType numberOfThreads );
+
+  /** Filter a tile of interleaved lines: pixel i of line b is at
+   * index i * width + b. The causal and anti-causal results are added.
+   */
+  void FilterTile( const RealType * data, RealType * causal, RealType * antiCausal,
+    const SizeValueType length, const SizeValueType width ) const;
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION FilterTilesThreaderCallback( void * arg );
+
+  /** Member variables. */
+  SigmaArrayType   m_SigmaArray;
+  unsigned int     m_TileSize;
+  unsigned int     m_CurrentDirection;
+  CoefficientsType m_Coefficients;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkParallelRecursiveGaussianImageFilter.hxx"
+#endif
+
+#endif // end #ifndef __itkParallelRecursiveGaussianImageFilter_h
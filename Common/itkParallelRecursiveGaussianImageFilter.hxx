@@ -0,0 +1,433 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkParallelRecursiveGaussianImageFilter_hxx
+#define __itkParallelRecursiveGaussianImageFilter_hxx
+
+#include "itkParallelRecursiveGaussianImageFilter.h"
+#include "itkImageAlgorithm.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace itk
+{
+
+/**
+ * ******************* Constructor *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::ParallelRecursiveGaussianImageFilter()
+{
+  this->m_SigmaArray.Fill( 1.0 );
+  this->m_TileSize         = 16;
+  this->m_CurrentDirection = 0;
+  ComputeCoefficients( 1.0, this->m_Coefficients );
+
+} // end Constructor()
+
+
+/**
+ * ******************* SetSigma *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::SetSigma( const double sigma )
+{
+  SigmaArrayType sigmaArray;
+  sigmaArray.Fill( sigma );
+  this->SetSigmaArray( sigmaArray );
+
+} // end SetSigma()
+
+
+/**
+ * ******************* ComputeCoefficients *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::ComputeCoefficients( const double sigma, CoefficientsType & c )
+{
+  /** Parameters of the exponential series of the zero order Gaussian,
+   * as in the RecursiveGaussianImageFilter.
+   */
+  const double A1 = 1.3530;
+  const double B1 = 1.8151;
+  const double W1 = 0.6681;
+  const double L1 = -1.3932;
+  const double A2 = -0.3531;
+  const double B2 = 0.0902;
+  const double W2 = 2.0787;
+  const double L2 = -1.3732;
+
+  const double Sin1 = std::sin( W1 / sigma );
+  const double Sin2 = std::sin( W2 / sigma );
+  const double Cos1 = std::cos( W1 / sigma );
+  const double Cos2 = std::cos( W2 / sigma );
+  const double Exp1 = std::exp( L1 / sigma );
+  const double Exp2 = std::exp( L2 / sigma );
+
+  /** The denominator coefficients. */
+  c.st_D4  = Exp1 * Exp1 * Exp2 * Exp2;
+  c.st_D3  = -2 * Cos1 * Exp1 * Exp2 * Exp2;
+  c.st_D3 += -2 * Cos2 * Exp2 * Exp1 * Exp1;
+  c.st_D2  = 4 * Cos2 * Cos1 * Exp1 * Exp2;
+  c.st_D2 += Exp1 * Exp1 + Exp2 * Exp2;
+  c.st_D1  = -2 * ( Exp2 * Cos2 + Exp1 * Cos1 );
+  const double SD = 1.0 + c.st_D1 + c.st_D2 + c.st_D3 + c.st_D4;
+
+  /** The numerator coefficients of the causal part. */
+  c.st_N0  = A1 + A2;
+  c.st_N1  = Exp2 * ( B2 * Sin2 - ( A2 + 2 * A1 ) * Cos2 );
+  c.st_N1 += Exp1 * ( B1 * Sin1 - ( A1 + 2 * A2 ) * Cos1 );
+  c.st_N2  = ( A1 + A2 ) * Cos2 * Cos1;
+  c.st_N2 -= B1 * Cos2 * Sin1 + B2 * Cos1 * Sin2;
+  c.st_N2 *= 2 * Exp1 * Exp2;
+  c.st_N2 += A2 * Exp1 * Exp1 + A1 * Exp2 * Exp2;
+  c.st_N3  = Exp2 * Exp1 * Exp1 * ( B2 * Sin2 - A2 * Cos2 );
+  c.st_N3 += Exp1 * Exp2 * Exp2 * ( B1 * Sin1 - A1 * Cos1 );
+
+  /** Normalize the kernel to unit sum. */
+  const double SN     = c.st_N0 + c.st_N1 + c.st_N2 + c.st_N3;
+  const double alpha0 = 2 * SN / SD - c.st_N0;
+  c.st_N0 /= alpha0;
+  c.st_N1 /= alpha0;
+  c.st_N2 /= alpha0;
+  c.st_N3 /= alpha0;
+
+  /** The numerator coefficients of the anti-causal part (symmetric kernel). */
+  c.st_M1 = c.st_N1 - c.st_D1 * c.st_N0;
+  c.st_M2 = c.st_N2 - c.st_D2 * c.st_N0;
+  c.st_M3 = c.st_N3 - c.st_D3 * c.st_N0;
+  c.st_M4 = -c.st_D4 * c.st_N0;
+
+  /** The coefficients that simulate edge extension at the boundaries. */
+  const double SNn = c.st_N0 + c.st_N1 + c.st_N2 + c.st_N3;
+  const double SMn = c.st_M1 + c.st_M2 + c.st_M3 + c.st_M4;
+  c.st_BN1 = c.st_D1 * SNn / SD;
+  c.st_BN2 = c.st_D2 * SNn / SD;
+  c.st_BN3 = c.st_D3 * SNn / SD;
+  c.st_BN4 = c.st_D4 * SNn / SD;
+  c.st_BM1 = c.st_D1 * SMn / SD;
+  c.st_BM2 = c.st_D2 * SMn / SD;
+  c.st_BM3 = c.st_D3 * SMn / SD;
+  c.st_BM4 = c.st_D4 * SMn / SD;
+
+} // end ComputeCoefficients()
+
+
+/**
+ * ******************* GenerateInputRequestedRegion *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::GenerateInputRequestedRegion( void )
+{
+  /** This filter requires all of the input image to be in the buffer. */
+  InputImageType * inputPtr = const_cast< InputImageType * >( this->GetInput() );
+  if( inputPtr )
+  {
+    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end GenerateInputRequestedRegion()
+
+
+/**
+ * ******************* EnlargeOutputRequestedRegion *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::EnlargeOutputRequestedRegion( DataObject * output )
+{
+  /** This filter produces all of the output image at once. */
+  OutputImageType * imgData = dynamic_cast< OutputImageType * >( output );
+  if( imgData )
+  {
+    imgData->SetRequestedRegionToLargestPossibleRegion();
+  }
+
+} // end EnlargeOutputRequestedRegion()
+
+
+/**
+ * ******************* GenerateData *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::GenerateData( void )
+{
+  /** Allocate the output image. */
+  InputImageConstPointer inputPtr  = this->GetInput();
+  OutputImagePointer     outputPtr = this->GetOutput();
+  outputPtr->SetBufferedRegion( outputPtr->GetRequestedRegion() );
+  outputPtr->Allocate();
+
+  /** The output is initialized to the input data. */
+  ImageAlgorithm::Copy( inputPtr.GetPointer(), outputPtr.GetPointer(),
+    inputPtr->GetBufferedRegion(), outputPtr->GetBufferedRegion() );
+
+  /** Filter the lines of one dimension at a time. The tiles of a dimension
+   * are distributed over the threads, which requires the previous dimension
+   * to be finished.
+   */
+  const typename OutputImageType::SizeType    size    = outputPtr->GetBufferedRegion().GetSize();
+  const typename OutputImageType::SpacingType spacing = outputPtr->GetSpacing();
+  for( unsigned int n = 0; n < ImageDimension; ++n )
+  {
+    if( this->m_SigmaArray[ n ] <= 0.0 ) { continue; }
+
+    if( size[ n ] < 4 )
+    {
+      itkExceptionMacro( << "The number of pixels along direction " << n
+                         << " is less than 4. This filter requires a minimum of four pixels"
+                         << " along the dimension to be processed." );
+    }
+
+    ComputeCoefficients( this->m_SigmaArray[ n ] / spacing[ n ], this->m_Coefficients );
+    this->m_CurrentDirection = n;
+    this->GetMultiThreader()->SetNumberOfWorkUnits( this->GetNumberOfWorkUnits() );
+    this->GetMultiThreader()->SetSingleMethod( FilterTilesThreaderCallback, this );
+    this->GetMultiThreader()->SingleMethodExecute();
+  }
+
+} // end GenerateData()
+
+
+/**
+ * ******************* FilterTilesThreaderCallback *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::FilterTilesThreaderCallback( void * arg )
+{
+  typedef typename MultiThreaderBase::WorkUnitInfo ThreadInfoType;
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  Self *           filter     = static_cast< Self * >( infoStruct->UserData );
+
+  filter->ThreadedFilterTiles( infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end FilterTilesThreaderCallback()
+
+
+/**
+ * ******************* ThreadedFilterTiles *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::ThreadedFilterTiles( ThreadIdType threadId, ThreadIdType numberOfThreads )
+{
+  OutputImageType *   outputPtr = this->GetOutput();
+  OutputPixelType *   buffer    = outputPtr->GetBufferPointer();
+  const unsigned int  direction = this->m_CurrentDirection;
+  const SizeValueType length    = outputPtr->GetBufferedRegion().GetSize( direction );
+
+  /** Consecutive pixels of a line are stride pixels apart. Neighbouring
+   * lines are adjacent in memory, except along the first dimension, where
+   * the lines are contiguous and are filtered one by one.
+   */
+  SizeValueType stride = 1;
+  for( unsigned int n = 0; n < direction; ++n )
+  {
+    stride *= outputPtr->GetBufferedRegion().GetSize( n );
+  }
+  const SizeValueType numberOfBlocks
+    = outputPtr->GetBufferedRegion().GetNumberOfPixels() / ( stride * length );
+  const SizeValueType tileSize      = std::min( static_cast< SizeValueType >( this->m_TileSize ), stride );
+  const SizeValueType tilesPerBlock = ( stride + tileSize - 1 ) / tileSize;
+  const SizeValueType numberOfTiles = numberOfBlocks * tilesPerBlock;
+
+  /** Get the range of tiles of this thread. */
+  const SizeValueType chunkSize = ( numberOfTiles + numberOfThreads - 1 ) / numberOfThreads;
+  const SizeValueType begin     = std::min( chunkSize * threadId, numberOfTiles );
+  const SizeValueType end       = std::min( begin + chunkSize, numberOfTiles );
+  if( begin == end ) { return; }
+
+  /** Each thread has its own scratch buffers. */
+  ScratchType data( length * tileSize );
+  ScratchType causal( length * tileSize );
+  ScratchType antiCausal( length * tileSize );
+
+  for( SizeValueType tile = begin; tile < end; ++tile )
+  {
+    const SizeValueType block = tile / tilesPerBlock;
+    const SizeValueType first = ( tile % tilesPerBlock ) * tileSize;
+    const SizeValueType width = std::min( tileSize, stride - first );
+    OutputPixelType *   lines = buffer + block * stride * length + first;
+
+    /** Copy the tile to the scratch buffer, interleaving the lines. */
+    for( SizeValueType i = 0; i < length; ++i )
+    {
+      const OutputPixelType * pixel = lines + i * stride;
+      RealType *              value = &data[ i * width ];
+      for( SizeValueType b = 0; b < width; ++b )
+      {
+        value[ b ] = static_cast< RealType >( pixel[ b ] );
+      }
+    }
+
+    /** Apply the recursive filter to all lines of the tile. */
+    this->FilterTile( &data[ 0 ], &causal[ 0 ], &antiCausal[ 0 ], length, width );
+
+    /** Copy the result back to the lines. */
+    for( SizeValueType i = 0; i < length; ++i )
+    {
+      OutputPixelType * pixel = lines + i * stride;
+      const RealType *  c     = &causal[ i * width ];
+      const RealType *  a     = &antiCausal[ i * width ];
+      for( SizeValueType b = 0; b < width; ++b )
+      {
+        pixel[ b ] = static_cast< OutputPixelType >( c[ b ] + a[ b ] );
+      }
+    }
+  }
+
+} // end ThreadedFilterTiles()
+
+
+/**
+ * ******************* FilterTile *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::FilterTile( const RealType * data, RealType * causal, RealType * antiCausal,
+  const SizeValueType length, const SizeValueType width ) const
+{
+  /** This is RecursiveSeparableImageFilter::FilterDataArray(), with the
+   * loop over the lines of the tile innermost.
+   */
+  const CoefficientsType & c  = this->m_Coefficients;
+  const SizeValueType      w  = width;
+  const SizeValueType      ln = length;
+
+  /** Initialize the borders. The first and last values of a line are
+   * assumed to extend to infinity.
+   */
+  for( SizeValueType b = 0; b < w; ++b )
+  {
+    const RealType * x = data + b;
+    RealType *       y = causal + b;
+    RealType *       z = antiCausal + b;
+
+    const RealType v1 = x[ 0 ];
+    y[ 0 ]     = v1 * c.st_N0 + v1 * c.st_N1 + v1 * c.st_N2 + v1 * c.st_N3;
+    y[ w ]     = x[ w ] * c.st_N0 + v1 * c.st_N1 + v1 * c.st_N2 + v1 * c.st_N3;
+    y[ 2 * w ] = x[ 2 * w ] * c.st_N0 + x[ w ] * c.st_N1 + v1 * c.st_N2 + v1 * c.st_N3;
+    y[ 3 * w ] = x[ 3 * w ] * c.st_N0 + x[ 2 * w ] * c.st_N1 + x[ w ] * c.st_N2 + v1 * c.st_N3;
+
+    y[ 0 ]     -= v1 * c.st_BN1 + v1 * c.st_BN2 + v1 * c.st_BN3 + v1 * c.st_BN4;
+    y[ w ]     -= y[ 0 ] * c.st_D1 + v1 * c.st_BN2 + v1 * c.st_BN3 + v1 * c.st_BN4;
+    y[ 2 * w ] -= y[ w ] * c.st_D1 + y[ 0 ] * c.st_D2 + v1 * c.st_BN3 + v1 * c.st_BN4;
+    y[ 3 * w ] -= y[ 2 * w ] * c.st_D1 + y[ w ] * c.st_D2 + y[ 0 ] * c.st_D3 + v1 * c.st_BN4;
+
+    const SizeValueType l1 = ( ln - 1 ) * w;
+    const SizeValueType l2 = ( ln - 2 ) * w;
+    const SizeValueType l3 = ( ln - 3 ) * w;
+    const SizeValueType l4 = ( ln - 4 ) * w;
+    const RealType      v2 = x[ l1 ];
+    z[ l1 ] = v2 * c.st_M1 + v2 * c.st_M2 + v2 * c.st_M3 + v2 * c.st_M4;
+    z[ l2 ] = x[ l1 ] * c.st_M1 + v2 * c.st_M2 + v2 * c.st_M3 + v2 * c.st_M4;
+    z[ l3 ] = x[ l2 ] * c.st_M1 + x[ l1 ] * c.st_M2 + v2 * c.st_M3 + v2 * c.st_M4;
+    z[ l4 ] = x[ l3 ] * c.st_M1 + x[ l2 ] * c.st_M2 + x[ l1 ] * c.st_M3 + v2 * c.st_M4;
+
+    z[ l1 ] -= v2 * c.st_BM1 + v2 * c.st_BM2 + v2 * c.st_BM3 + v2 * c.st_BM4;
+    z[ l2 ] -= z[ l1 ] * c.st_D1 + v2 * c.st_BM2 + v2 * c.st_BM3 + v2 * c.st_BM4;
+    z[ l3 ] -= z[ l2 ] * c.st_D1 + z[ l1 ] * c.st_D2 + v2 * c.st_BM3 + v2 * c.st_BM4;
+    z[ l4 ] -= z[ l3 ] * c.st_D1 + z[ l2 ] * c.st_D2 + z[ l1 ] * c.st_D3 + v2 * c.st_BM4;
+  }
+
+  /** Recursively filter the rest, in the causal direction. */
+  for( SizeValueType i = 4; i < ln; ++i )
+  {
+    const RealType * x0 = data + i * w;
+    const RealType * x1 = x0 - w;
+    const RealType * x2 = x1 - w;
+    const RealType * x3 = x2 - w;
+    RealType *       y0 = causal + i * w;
+    const RealType * y1 = y0 - w;
+    const RealType * y2 = y1 - w;
+    const RealType * y3 = y2 - w;
+    const RealType * y4 = y3 - w;
+    for( SizeValueType b = 0; b < w; ++b )
+    {
+      y0[ b ]  = x0[ b ] * c.st_N0 + x1[ b ] * c.st_N1 + x2[ b ] * c.st_N2 + x3[ b ] * c.st_N3;
+      y0[ b ] -= y1[ b ] * c.st_D1 + y2[ b ] * c.st_D2 + y3[ b ] * c.st_D3 + y4[ b ] * c.st_D4;
+    }
+  }
+
+  /** Recursively filter the rest, in the anti-causal direction. */
+  for( SizeValueType i = ln - 4; i > 0; --i )
+  {
+    const RealType * x1 = data + i * w;
+    const RealType * x2 = x1 + w;
+    const RealType * x3 = x2 + w;
+    const RealType * x4 = x3 + w;
+    RealType *       z0 = antiCausal + ( i - 1 ) * w;
+    const RealType * z1 = z0 + w;
+    const RealType * z2 = z1 + w;
+    const RealType * z3 = z2 + w;
+    const RealType * z4 = z3 + w;
+    for( SizeValueType b = 0; b < w; ++b )
+    {
+      z0[ b ]  = x1[ b ] * c.st_M1 + x2[ b ] * c.st_M2 + x3[ b ] * c.st_M3 + x4[ b ] * c.st_M4;
+      z0[ b ] -= z1[ b ] * c.st_D1 + z2[ b ] * c.st_D2 + z3[ b ] * c.st_D3 + z4[ b ] * c.st_D4;
+    }
+  }
+
+} // end FilterTile()
+
+
+/**
+ * ******************* PrintSelf *******************
+ */
+
+template< class TInputImage, class TOutputImage >
+void
+ParallelRecursiveGaussianImageFilter< TInputImage, TOutputImage >
+::PrintSelf( std::ostream & os, Indent indent ) const
+{
+  Superclass::PrintSelf( os, indent );
+
+  os << indent << "SigmaArray: " << this->m_SigmaArray << std::endl;
+  os << indent << "TileSize: " << this->m_TileSize << std::endl;
+
+} // end PrintSelf()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkParallelRecursiveGaussianImageFilter_hxx
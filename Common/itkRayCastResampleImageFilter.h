@@ -0,0 +1,99 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRayCastResampleImageFilter_h
+#define __itkRayCastResampleImageFilter_h
+
+#include "itkResampleImageFilter.h"
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+
+namespace itk
+{
+
+/** \class RayCastResampleImageFilter
+ * \brief Resample filter that generates a projection (DRR) with packets of rays.
+ *
+ * When the interpolator is an AdvancedRayCastInterpolateImageFunction, this
+ * filter computes the output one row at a time: the points of all pixels in
+ * the row are mapped by the transform, and then passed at once to
+ * AdvancedRayCastInterpolateImageFunction::EvaluateRays(), which traverses
+ * neighbouring rays in lock step. The output is the same as that of the
+ * ResampleImageFilter. The threads work on the tiles of the output region
+ * that the dynamic multi-threading of the ResampleImageFilter hands out.
+ *
+ * For any other interpolator, the ResampleImageFilter implementation is used.
+ *
+ * \ingroup GeometricTransforms
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType = double >
+class RayCastResampleImageFilter :
+  public ResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+{
+public:
+
+  /** Standard ITK-stuff. */
+  typedef RayCastResampleImageFilter Self;
+  typedef ResampleImageFilter<
+    TInputImage, TOutputImage, TInterpolatorPrecisionType > Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( RayCastResampleImageFilter, ResampleImageFilter );
+
+  /** Typedefs from the superclass. */
+  typedef typename Superclass::InputImageType        InputImageType;
+  typedef typename Superclass::OutputImageType       OutputImageType;
+  typedef typename Superclass::OutputImageRegionType OutputImageRegionType;
+  typedef typename Superclass::PixelType             PixelType;
+  typedef typename Superclass::PointType             PointType;
+
+  /** Typedefs for the ray cast interpolator. */
+  typedef AdvancedRayCastInterpolateImageFunction<
+    InputImageType, TInterpolatorPrecisionType >     RayCastInterpolatorType;
+  typedef typename RayCastInterpolatorType::PointType  RayPointType;
+  typedef typename RayCastInterpolatorType::OutputType RayOutputType;
+
+protected:
+
+  /** The constructor. */
+  RayCastResampleImageFilter() {}
+
+  /** The destructor. */
+  ~RayCastResampleImageFilter() override {}
+
+  /** Compute the output in a region, with packets of rays. */
+  void DynamicThreadedGenerateData( const OutputImageRegionType & outputRegionForThread ) override;
+
+private:
+
+  RayCastResampleImageFilter( const Self & ); // purposely not implemented
+  void operator=( const Self & );             // purposely not implemented
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkRayCastResampleImageFilter.hxx"
+#endif
+
+#endif // end #ifndef __itkRayCastResampleImageFilter_h
@@ -0,0 +1,90 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkRayCastResampleImageFilter_hxx
+#define __itkRayCastResampleImageFilter_hxx
+
+#include "itkRayCastResampleImageFilter.h"
+#include "itkImageScanlineIterator.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+
+/**
+ * ******************* DynamicThreadedGenerateData *******************
+ */
+
+template< class TInputImage, class TOutputImage, class TInterpolatorPrecisionType >
+void
+RayCastResampleImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::DynamicThreadedGenerateData( const OutputImageRegionType & outputRegionForThread )
+{
+  const RayCastInterpolatorType * rayCaster
+    = dynamic_cast< const RayCastInterpolatorType * >( this->GetInterpolator() );
+  if( rayCaster == nullptr || outputRegionForThread.GetNumberOfPixels() == 0 )
+  {
+    this->Superclass::DynamicThreadedGenerateData( outputRegionForThread );
+    return;
+  }
+
+  OutputImageType * outputPtr = this->GetOutput();
+  const auto *      transform = this->GetTransform();
+
+  /** The interpolated values are clamped to the range of the output
+   * pixel type, as in the ResampleImageFilter.
+   */
+  typedef typename NumericTraits< PixelType >::ValueType ComponentType;
+  const double minValue = static_cast< double >( NumericTraits< ComponentType >::NonpositiveMin() );
+  const double maxValue = static_cast< double >( NumericTraits< ComponentType >::max() );
+
+  const SizeValueType          lineLength = outputRegionForThread.GetSize( 0 );
+  std::vector< RayPointType >  points( lineLength );
+  std::vector< RayOutputType > values( lineLength );
+
+  ImageScanlineIterator< OutputImageType > outIt( outputPtr, outputRegionForThread );
+  while( !outIt.IsAtEnd() )
+  {
+    /** Map the points of the row to the input space. */
+    typename OutputImageType::IndexType index = outIt.GetIndex();
+    for( SizeValueType i = 0; i < lineLength; ++i, ++index[ 0 ] )
+    {
+      PointType outputPoint;
+      outputPtr->TransformIndexToPhysicalPoint( index, outputPoint );
+      points[ i ] = transform->TransformPoint( outputPoint );
+    }
+
+    /** Cast the rays of the row in packets. */
+    rayCaster->EvaluateRays( &points[ 0 ], &values[ 0 ], static_cast< unsigned int >( lineLength ) );
+
+    for( SizeValueType i = 0; i < lineLength; ++i )
+    {
+      const double value = std::min( std::max( static_cast< double >( values[ i ] ), minValue ), maxValue );
+      outIt.Set( static_cast< PixelType >( value ) );
+      ++outIt;
+    }
+    outIt.NextLine();
+  }
+
+} // end DynamicThreadedGenerateData()
+
+
+} // end namespace itk
+
+#endif // end #ifndef __itkRayCastResampleImageFilter_hxx
@@ -19,7 +19,7 @@
 #define __elxBSplineInterpolator_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
@@ -35,6 +35,9 @@ namespace elastix
  * but it determines the derivative slightly more accurate at grid points. That's
  * why the registration results can be slightly different.
  *
+ * The B-spline coefficients are computed multi-threadedly, and shared with the
+ * other B-spline interpolators of the same image, see itk::BSplineCoefficientImageCache.
+ *
  * The parameters used in this class are:
  * \parameter Interpolator: Select this interpolator as follows:\n
  *    <tt>(Interpolator "BSplineInterpolator")</tt>
@@ -49,7 +52,7 @@ namespace elastix
 template< class TElastix >
 class BSplineInterpolator :
   public
-  itk::BSplineInterpolateImageFunction<
+  itk::CachedBSplineInterpolateImageFunction<
   typename InterpolatorBase< TElastix >::InputImageType,
   typename InterpolatorBase< TElastix >::CoordRepType,
   double >,        //CoefficientType
@@ -60,7 +63,7 @@ public:
 
   /** Standard ITK-stuff. */
   typedef BSplineInterpolator Self;
-  typedef itk::BSplineInterpolateImageFunction<
+  typedef itk::CachedBSplineInterpolateImageFunction<
     typename InterpolatorBase< TElastix >::InputImageType,
     typename InterpolatorBase< TElastix >::CoordRepType,
     double >                                  Superclass1;
@@ -55,6 +55,13 @@ BSplineInterpolator< TElastix >
   /** Set the splineOrder. */
   this->SetSplineOrder( splineOrder );
 
+  /** Compute the coefficients with the number of threads of elastix. */
+  const std::string threads = this->m_Configuration->GetCommandLineArgument( "-threads" );
+  if( threads != "" )
+  {
+    this->SetNumberOfWorkUnits( atoi( threads.c_str() ) );
+  }
+
 } // end BeforeEachResolution()
 
 
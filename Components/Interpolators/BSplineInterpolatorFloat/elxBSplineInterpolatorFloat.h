@@ -19,7 +19,7 @@
 #define __elxBSplineInterpolatorFloat_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
@@ -49,7 +49,7 @@ namespace elastix
 template< class TElastix >
 class BSplineInterpolatorFloat :
   public
-  itk::BSplineInterpolateImageFunction<
+  itk::CachedBSplineInterpolateImageFunction<
   typename InterpolatorBase< TElastix >::InputImageType,
   typename InterpolatorBase< TElastix >::CoordRepType,
   float >,        //CoefficientType
@@ -60,7 +60,7 @@ public:
 
   /** Standard ITK-stuff. */
   typedef BSplineInterpolatorFloat Self;
-  typedef itk::BSplineInterpolateImageFunction<
+  typedef itk::CachedBSplineInterpolateImageFunction<
     typename InterpolatorBase< TElastix >::InputImageType,
     typename InterpolatorBase< TElastix >::CoordRepType,
     float >                                   Superclass1;
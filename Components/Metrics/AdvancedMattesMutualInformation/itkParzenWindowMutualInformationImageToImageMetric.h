@@ -246,6 +246,11 @@ protected:
   /** Multi-threaded versions of the ComputePDF function. */
   inline void ThreadedComputeDerivativeLowMemory( ThreadIdType threadId );
 
+  /** Multi-threaded versions of the ComputePDF function, using the given sample evaluator. */
+  template< class TSampleEvaluator >
+  inline void ThreadedComputeDerivativeLowMemoryWithEvaluator(
+    ThreadIdType threadId, const TSampleEvaluator & evaluator );
+
   /** Single-threadedly accumulate results. */
   inline void AfterThreadedComputeDerivativeLowMemory(
     DerivativeType & derivative ) const;
@@ -263,6 +268,19 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );                                  // purposely not implemented
 
+  /** Calls ThreadedComputeDerivativeLowMemoryWithEvaluator(), for CallWithSampleEvaluator(). */
+  struct ThreadedComputeDerivativeLowMemoryFunctor
+  {
+    Self *       m_Metric;
+    ThreadIdType m_ThreadId;
+
+    template< class TSampleEvaluator >
+    void operator()( const TSampleEvaluator & evaluator ) const
+    {
+      this->m_Metric->ThreadedComputeDerivativeLowMemoryWithEvaluator( this->m_ThreadId, evaluator );
+    }
+  };
+
   /** Helper array for storing the values of the JointPDF ratios. */
   typedef double                PRatioType;
   typedef Array2D< PRatioType > PRatioArrayType;
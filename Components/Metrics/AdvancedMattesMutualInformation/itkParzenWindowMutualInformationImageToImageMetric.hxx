@@ -442,6 +442,23 @@ template< class TFixedImage, class TMovingImage >
 void
 ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedComputeDerivativeLowMemory( ThreadIdType threadId )
+{
+  /** Run the loop over the samples with the evaluator selected for this resolution. */
+  const ThreadedComputeDerivativeLowMemoryFunctor functor = { this, threadId };
+  this->CallWithSampleEvaluator( functor );
+
+} // end ThreadedComputeDerivativeLowMemory()
+
+
+/**
+ * ******************* ThreadedComputeDerivativeLowMemoryWithEvaluator *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TSampleEvaluator >
+void
+ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeDerivativeLowMemoryWithEvaluator( ThreadIdType threadId, const TSampleEvaluator & evaluator )
 {
   /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
   const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
@@ -495,7 +512,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     MovingImagePointType        mappedPoint;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = evaluator.TransformPoint( fixedPoint, mappedPoint );
 
     /** Check if the point is inside the moving mask. */
     if( sampleOk )
@@ -508,7 +525,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
      */
     if( sampleOk )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+      sampleOk = evaluator.EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, &movingImageDerivative );
     }
 
@@ -522,18 +539,9 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       movingImageValue = this->GetMovingImageLimiter()
         ->Evaluate( movingImageValue, movingImageDerivative );
 
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
       /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+      evaluator.EvaluateJacobianWithImageGradientProduct(
         fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
 
       /** If desired, apply the technique introduced by Tustison. */
       TransformJacobianType jacobian;
@@ -582,7 +590,7 @@ ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     }
   }
 
-} // end ThreadedComputeDerivativeLowMemory()
+} // end ThreadedComputeDerivativeLowMemoryWithEvaluator()
 
 
 /**
@@ -122,6 +122,9 @@ public:
   typedef typename Superclass::HessianType      HessianType;
   typedef typename Superclass::ThreaderType     ThreaderType;
   typedef typename Superclass::ThreadInfoType   ThreadInfoType;
+  typedef typename Superclass::AdvancedTransformType AdvancedTransformType;
+  typedef typename Superclass::EvaluationContextType EvaluationContextType;
+  typedef typename Superclass::EvaluationContextWorkUnitType EvaluationContextWorkUnitType;
 
   typedef typename Superclass::FixedImageMaskSpatialObject2Type    FixedImageMaskSpatialObject2Type;
   typedef typename Superclass::MovingImageMaskSpatialObject2Type   MovingImageMaskSpatialObject2Type;
@@ -150,7 +153,28 @@ public:
   void GetValueAndDerivative( const TransformParametersType & parameters,
     MeasureType & value, DerivativeType & derivative ) const override;
 
-  /** Experimental feature: compute SelfHessian */
+  /** This metric supports re-entrant evaluation. */
+  bool GetSupportsReentrantEvaluation( void ) const override { return true; }
+
+  /** Re-entrant version of GetValue(), using the transform and the work
+   * units of the context. The samples are processed by the same loop as in
+   * GetValue(). */
+  MeasureType GetValueInContext( const TransformParametersType & parameters,
+    EvaluationContextType & context ) const override;
+
+  /** Re-entrant version of GetValueAndDerivative(), using the transform,
+   * the work units and buffers of the context. */
+  void GetValueAndDerivativeInContext( const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative,
+    EvaluationContextType & context ) const override;
+
+  /** Experimental feature: compute SelfHessian.
+   * The samples are processed multi-threaded. Each thread collects the
+   * upper triangular contributions in a coordinate list, which is sorted and
+   * merged periodically to bound its memory. The lists of the threads are
+   * merged, in thread order, into compressed rows, which are copied into H
+   * one row at a time.
+   */
   void GetSelfHessian( const TransformParametersType & parameters, HessianType & H ) const override;
 
   /** Default: 1.0 mm */
@@ -230,12 +254,34 @@ protected:
     MeasureType & measure,
     DerivativeType & deriv ) const;
 
-  /** Compute a pixel's contribution to the SelfHessian;
-   * Called by GetSelfHessian(). */
-  void UpdateSelfHessianTerms(
-    const DerivativeType & imageJacobian,
-    const NonZeroJacobianIndicesType & nzji,
-    HessianType & H ) const;
+  /** An element of the self Hessian, in coordinate format. */
+  struct SelfHessianEntryType
+  {
+    unsigned int st_Row;
+    unsigned int st_Column;
+    double       st_Value;
+
+    bool operator<( const SelfHessianEntryType & other ) const
+    {
+      return this->st_Row < other.st_Row
+             || ( this->st_Row == other.st_Row && this->st_Column < other.st_Column );
+    }
+  };
+  typedef std::vector< SelfHessianEntryType > SelfHessianEntryContainerType;
+
+  /** Sort the entries by row and column, and sum the duplicates.
+   * The sort is stable, so the order of summation is deterministic.
+   */
+  static void CompactSelfHessianEntries( SelfHessianEntryContainerType & entries );
+
+  /** Check which samples of a thread are valid for the SelfHessian. */
+  void ThreadedCheckSelfHessianSamples( ThreadIdType threadId, ThreadIdType numberOfThreads ) const;
+
+  /** Compute the SelfHessian contributions of the valid samples of a thread. */
+  void ThreadedGetSelfHessian( ThreadIdType threadId, ThreadIdType numberOfThreads ) const;
+
+  /** The callback function for the SelfHessian. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION GetSelfHessianThreaderCallback( void * arg );
 
   /** Get value for each thread. */
   inline void ThreadedGetValue( ThreadIdType threadID ) override;
@@ -250,8 +296,71 @@ protected:
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & value, DerivativeType & derivative ) const override;
 
+  /** The loop over the samples [begin, end) of the sample container, shared
+   * by all variants of GetValue() and GetValueAndDerivative(). The sum of the
+   * squared differences is added to measure and, if derivative is not null,
+   * the unnormalized derivative to derivative. The image Jacobian buffers are
+   * only used for the derivative.
+   */
+  template< class TSampleEvaluator >
+  void AccumulateValueAndDerivative( const TSampleEvaluator & evaluator,
+    const unsigned long begin, const unsigned long end,
+    NonZeroJacobianIndicesType & nzji, DerivativeType & imageJacobian,
+    MeasureType & measure, DerivativeType * derivative,
+    SizeValueType & numberOfPixelsCounted ) const;
+
+  /** Compute the samples [begin, end) of a work unit. */
+  static void GetSampleRangeForWorkUnit( const unsigned long numberOfSamples,
+    const ThreadIdType workUnit, const ThreadIdType numberOfWorkUnits,
+    unsigned long & begin, unsigned long & end );
+
+  /** Compute the value and, if derivative is not null, the derivative in a
+   * context, distributing the samples over the work units of the context.
+   */
+  void EvaluateInContext( const TransformParametersType & parameters,
+    MeasureType & value, DerivativeType * derivative,
+    EvaluationContextType & context ) const;
+
+  /** Process the samples of a work unit of a context. */
+  void ThreadedEvaluateInContext( ThreadIdType workUnit,
+    EvaluationContextType & context, const bool computeDerivative ) const;
+
+  /** The callback function for the work units of a context. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION EvaluateInContextThreaderCallback( void * arg );
+
 private:
 
+  /** Calls AccumulateValueAndDerivative(), for CallWithSampleEvaluator()
+   * and CallWithSampleEvaluatorInContext().
+   */
+  struct AccumulateValueAndDerivativeFunctor
+  {
+    const Self *                 m_Metric;
+    unsigned long                m_Begin;
+    unsigned long                m_End;
+    NonZeroJacobianIndicesType * m_NonZeroJacobianIndices;
+    DerivativeType *             m_ImageJacobian;
+    MeasureType *                m_Measure;
+    DerivativeType *             m_Derivative;
+    SizeValueType *              m_NumberOfPixelsCounted;
+
+    template< class TSampleEvaluator >
+    void operator()( const TSampleEvaluator & evaluator ) const
+    {
+      this->m_Metric->AccumulateValueAndDerivative( evaluator, this->m_Begin, this->m_End,
+        *this->m_NonZeroJacobianIndices, *this->m_ImageJacobian,
+        *this->m_Measure, this->m_Derivative, *this->m_NumberOfPixelsCounted );
+    }
+  };
+
+  /** Struct to pass data to the work units of a context. */
+  struct EvaluateInContextThreaderParameterType
+  {
+    const Self *            st_Metric;
+    EvaluationContextType * st_Context;
+    bool                    st_ComputeDerivative;
+  };
+
   AdvancedMeanSquaresImageToImageMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );                        // purposely not implemented
 
@@ -260,6 +369,27 @@ private:
   double       m_SelfHessianNoiseRange;
   unsigned int m_NumberOfSamplesForSelfHessian;
 
+  /** Struct to pass data to the threads of GetSelfHessian(). */
+  struct SelfHessianThreaderParameterType
+  {
+    const Self *                       st_Metric;
+    const ImageSampleContainerType *   st_SampleContainer;
+    const FixedImageInterpolatorType * st_FixedInterpolator;
+    std::vector< unsigned char > *     st_ValidSamples;
+    const std::vector< double > *      st_Noise;
+    bool                               st_CheckSamplesOnly;
+  };
+
+  /** Per thread results of GetSelfHessian(). */
+  struct SelfHessianPerThreadStruct
+  {
+    SelfHessianEntryContainerType st_Entries;
+    SizeValueType                 st_NumberOfPixelsCounted;
+  };
+
+  mutable SelfHessianThreaderParameterType          m_SelfHessianThreaderParameters;
+  mutable std::vector< SelfHessianPerThreadStruct > m_SelfHessianPerThreadVariables;
+
 };
 
 } // end namespace itk
@@ -22,6 +22,7 @@
 #include "vnl/algo/vnl_matrix_update.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "itkComputeImageExtremaFilter.h"
+#include <algorithm>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -204,51 +205,16 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
-
   /** Loop over the fixed image samples to calculate the mean squares. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
-
-    /** Compute the moving image value and check if the point is
-     * inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, nullptr );
-    }
-
-    if( sampleOk )
-    {
-      this->m_NumberOfPixelsCounted++;
-
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue = static_cast< double >( ( *fiter ).Value().m_ImageValue );
-
-      /** The difference squared. */
-      const RealType diff = movingImageValue - fixedImageValue;
-      measure += diff * diff;
-
-    } // end if sampleOk
-
-  } // end for loop over the image sample container
+  NonZeroJacobianIndicesType nzji;
+  DerivativeType             imageJacobian;
+  SizeValueType              numberOfPixelsCounted = 0;
+  const AccumulateValueAndDerivativeFunctor functor = {
+    this, 0, static_cast< unsigned long >( sampleContainer->Size() ), &nzji, &imageJacobian,
+    &measure, nullptr, &numberOfPixelsCounted
+  };
+  this->CallWithSampleEvaluator( functor );
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
 
   /** Check if enough samples were valid. */
   this->CheckNumberOfSamples(
@@ -320,72 +286,26 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValue( ThreadIdType threadId )
 {
   /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend   += (int)pos_end;
+  unsigned long pos_begin = 0;
+  unsigned long pos_end   = 0;
+  Self::GetSampleRangeForWorkUnit( sampleContainer->Size(),
+    threadId, Self::GetNumberOfWorkUnits(), pos_begin, pos_end );
 
   /** Create variables to store intermediate results. circumvent false sharing */
-  unsigned long numberOfPixelsCounted = 0;
-  MeasureType   measure               = NumericTraits< MeasureType >::Zero;
+  NonZeroJacobianIndicesType nzji;
+  DerivativeType             imageJacobian;
+  SizeValueType              numberOfPixelsCounted = 0;
+  MeasureType                measure               = NumericTraits< MeasureType >::Zero;
 
   /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint ); // thread-safe?
-    }
-
-    /** Compute the moving image value M(T(x)) and check if
-     * the point is inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, nullptr );
-    }
-
-    if( sampleOk )
-    {
-      numberOfPixelsCounted++;
-
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
-
-      /** The difference squared. */
-      const RealType diff = movingImageValue - fixedImageValue;
-      measure += diff * diff;
-
-    } // end if sampleOk
-
-  } // end for loop over the image sample container
+  const AccumulateValueAndDerivativeFunctor functor = {
+    this, pos_begin, pos_end, &nzji, &imageJacobian,
+    &measure, nullptr, &numberOfPixelsCounted
+  };
+  this->CallWithSampleEvaluator( functor );
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -482,8 +402,7 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
   NonZeroJacobianIndicesType nzji(
     this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  DerivativeType        imageJacobian( nzji.size() );
-  TransformJacobianType jacobian;
+  DerivativeType imageJacobian( nzji.size() );
 
   /** Call non-thread-safe stuff, such as:
    *   this->SetTransformParameters( parameters );
@@ -503,69 +422,14 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
-
   /** Loop over the fixed image to calculate the mean squares. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint );
-    }
-
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
-    }
-
-    if( sampleOk )
-    {
-      this->m_NumberOfPixelsCounted++;
-
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
-
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
-      /** Compute the inner product of the transform Jacobian and the moving image gradient. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative,
-        imageJacobian, nzji );
-#endif
-
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(
-        fixedImageValue, movingImageValue,
-        imageJacobian, nzji,
-        measure, derivative );
-
-    } // end if sampleOk
-
-  } // end for loop over the image sample container
+  SizeValueType numberOfPixelsCounted = 0;
+  const AccumulateValueAndDerivativeFunctor functor = {
+    this, 0, static_cast< unsigned long >( sampleContainer->Size() ), &nzji, &imageJacobian,
+    &measure, &derivative, &numberOfPixelsCounted
+  };
+  this->CallWithSampleEvaluator( functor );
+  this->m_NumberOfPixelsCounted = numberOfPixelsCounted;
 
   /** Check if enough samples were valid. */
   this->CheckNumberOfSamples(
@@ -651,88 +515,24 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   DerivativeType & derivative = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
 
   /** Get a handle to the sample container. */
-  ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
-  const unsigned long         sampleContainerSize = sampleContainer->Size();
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
 
   /** Get the samples for this thread. */
-  const unsigned long nrOfSamplesPerThreads
-    = static_cast< unsigned long >( std::ceil( static_cast< double >( sampleContainerSize )
-    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
-
-  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
-  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
-  pos_begin = ( pos_begin > sampleContainerSize ) ? sampleContainerSize : pos_begin;
-  pos_end   = ( pos_end > sampleContainerSize ) ? sampleContainerSize : pos_end;
-
-  /** Create iterator over the sample container. */
-  typename ImageSampleContainerType::ConstIterator threader_fiter;
-  typename ImageSampleContainerType::ConstIterator threader_fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator threader_fend   = sampleContainer->Begin();
-
-  threader_fbegin += (int)pos_begin;
-  threader_fend   += (int)pos_end;
+  unsigned long pos_begin = 0;
+  unsigned long pos_end   = 0;
+  Self::GetSampleRangeForWorkUnit( sampleContainer->Size(),
+    threadId, Self::GetNumberOfWorkUnits(), pos_begin, pos_end );
 
   /** Create variables to store intermediate results. circumvent false sharing */
-  unsigned long numberOfPixelsCounted = 0;
+  SizeValueType numberOfPixelsCounted = 0;
   MeasureType   measure               = NumericTraits< MeasureType >::Zero;
 
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( threader_fiter = threader_fbegin; threader_fiter != threader_fend; ++threader_fiter )
-  {
-    /** Read fixed coordinates and initialize some variables. */
-    const FixedImagePointType & fixedPoint = ( *threader_fiter ).Value().m_ImageCoordinates;
-    RealType                    movingImageValue;
-    MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
-
-    /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
-
-    /** Check if point is inside mask. */
-    if( sampleOk )
-    {
-      sampleOk = this->IsInsideMovingMask( mappedPoint ); // thread-safe?
-    }
-
-    /** Compute the moving image value M(T(x)) and derivative dM/dx and check if
-     * the point is inside the moving image buffer.
-     */
-    if( sampleOk )
-    {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
-        mappedPoint, movingImageValue, &movingImageDerivative );
-    }
-
-    if( sampleOk )
-    {
-      numberOfPixelsCounted++;
-
-      /** Get the fixed image value. */
-      const RealType & fixedImageValue
-        = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
-
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
-      /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
-        fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
-
-      /** Compute this pixel's contribution to the measure and derivatives. */
-      this->UpdateValueAndDerivativeTerms(
-        fixedImageValue, movingImageValue,
-        imageJacobian, nzji,
-        measure, derivative );
-
-    } // end if sampleOk
-
-  } // end for loop over the image sample container
+  /** Run the loop over the samples with the evaluator selected for this resolution. */
+  const AccumulateValueAndDerivativeFunctor functor = {
+    this, pos_begin, pos_end, &nzji, &imageJacobian,
+    &measure, &derivative, &numberOfPixelsCounted
+  };
+  this->CallWithSampleEvaluator( functor );
 
   /** Only update these variables at the end to prevent unnecessary "false sharing". */
   this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
@@ -825,6 +625,280 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
 } // end AfterThreadedGetValueAndDerivative()
 
 
+/**
+ * ******************* AccumulateValueAndDerivative *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TSampleEvaluator >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::AccumulateValueAndDerivative( const TSampleEvaluator & evaluator,
+  const unsigned long begin, const unsigned long end,
+  NonZeroJacobianIndicesType & nzji, DerivativeType & imageJacobian,
+  MeasureType & measure, DerivativeType * derivative,
+  SizeValueType & numberOfPixelsCounted ) const
+{
+  /** Get a handle to the sample container. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+
+  /** Create iterator over the samples. */
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->Begin();
+  fbegin += (int)begin;
+  fend   += (int)end;
+
+  /** Loop over the fixed image samples to calculate the mean squares. */
+  for( fiter = fbegin; fiter != fend; ++fiter )
+  {
+    /** Read fixed coordinates and initialize some variables. */
+    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    RealType                    movingImageValue;
+    MovingImagePointType        mappedPoint;
+    MovingImageDerivativeType   movingImageDerivative;
+
+    /** Transform point and check if it is inside the B-spline support region. */
+    bool sampleOk = evaluator.TransformPoint( fixedPoint, mappedPoint );
+
+    /** Check if point is inside mask. */
+    if( sampleOk )
+    {
+      sampleOk = this->IsInsideMovingMask( mappedPoint );
+    }
+
+    /** Compute the moving image value M(T(x)) and, if needed, the derivative
+     * dM/dx and check if the point is inside the moving image buffer.
+     */
+    if( sampleOk )
+    {
+      sampleOk = evaluator.EvaluateMovingImageValueAndDerivative(
+        mappedPoint, movingImageValue, derivative ? &movingImageDerivative : nullptr );
+    }
+
+    if( sampleOk )
+    {
+      numberOfPixelsCounted++;
+
+      /** Get the fixed image value. */
+      const RealType & fixedImageValue
+        = static_cast< RealType >( ( *fiter ).Value().m_ImageValue );
+
+      if( derivative )
+      {
+        /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
+        evaluator.EvaluateJacobianWithImageGradientProduct(
+          fixedPoint, movingImageDerivative, imageJacobian, nzji );
+
+        /** Compute this pixel's contribution to the measure and derivatives. */
+        this->UpdateValueAndDerivativeTerms(
+          fixedImageValue, movingImageValue,
+          imageJacobian, nzji,
+          measure, *derivative );
+      }
+      else
+      {
+        /** The difference squared. */
+        const RealType diff = movingImageValue - fixedImageValue;
+        measure += diff * diff;
+      }
+
+    } // end if sampleOk
+
+  } // end for loop over the image sample container
+
+} // end AccumulateValueAndDerivative()
+
+
+/**
+ * ******************* GetSampleRangeForWorkUnit *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetSampleRangeForWorkUnit( const unsigned long numberOfSamples,
+  const ThreadIdType workUnit, const ThreadIdType numberOfWorkUnits,
+  unsigned long & begin, unsigned long & end )
+{
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( numberOfSamples )
+    / static_cast< double >( numberOfWorkUnits ) ) );
+
+  begin = nrOfSamplesPerThreads * workUnit;
+  end   = nrOfSamplesPerThreads * ( workUnit + 1 );
+  begin = ( begin > numberOfSamples ) ? numberOfSamples : begin;
+  end   = ( end > numberOfSamples ) ? numberOfSamples : end;
+
+} // end GetSampleRangeForWorkUnit()
+
+
+/**
+ * ******************* GetValueInContext *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueInContext(
+  const TransformParametersType & parameters,
+  EvaluationContextType & context ) const
+{
+  MeasureType value = NumericTraits< MeasureType >::Zero;
+  this->EvaluateInContext( parameters, value, nullptr, context );
+  return value;
+
+} // end GetValueInContext()
+
+
+/**
+ * ******************* GetValueAndDerivativeInContext *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivativeInContext(
+  const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative,
+  EvaluationContextType & context ) const
+{
+  this->EvaluateInContext( parameters, value, &derivative, context );
+
+} // end GetValueAndDerivativeInContext()
+
+
+/**
+ * ******************* EvaluateInContext *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateInContext(
+  const TransformParametersType & parameters,
+  MeasureType & value, DerivativeType * derivative,
+  EvaluationContextType & context ) const
+{
+  if( context.st_Transform.IsNull() || context.st_WorkUnits.empty() )
+  {
+    itkExceptionMacro( << "The evaluation context has not been initialized. "
+                       << "Call InitializeEvaluationContext() first." );
+  }
+
+  /** Set the parameters on the private transform, and select the samples
+   * in the same way as GetValue(). Only the context is modified.
+   */
+  this->SetTransformParametersInContext( parameters, context );
+  this->UpdateImageSamplerInContext();
+
+  /** Process the samples, by the threads of the context if it has several work units. */
+  const ThreadIdType numberOfWorkUnits = static_cast< ThreadIdType >( context.st_WorkUnits.size() );
+  if( context.st_Threader.IsNotNull() )
+  {
+    EvaluateInContextThreaderParameterType temp = { this, &context, derivative != nullptr };
+    context.st_Threader->SetSingleMethod( Self::EvaluateInContextThreaderCallback, &temp );
+    context.st_Threader->SingleMethodExecute();
+  }
+  else
+  {
+    for( ThreadIdType i = 0; i < numberOfWorkUnits; ++i )
+    {
+      this->ThreadedEvaluateInContext( i, context, derivative != nullptr );
+    }
+  }
+
+  /** Gather the results of the work units. */
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  context.st_NumberOfPixelsCounted = 0;
+  for( ThreadIdType i = 0; i < numberOfWorkUnits; ++i )
+  {
+    measure                          += context.st_WorkUnits[ i ].st_Value;
+    context.st_NumberOfPixelsCounted += context.st_WorkUnits[ i ].st_NumberOfPixelsCounted;
+  }
+
+  /** Check if enough samples were valid. */
+  ImageSampleContainerPointer sampleContainer = this->GetImageSampler()->GetOutput();
+  this->CheckNumberOfSamplesInContext( sampleContainer->Size(), context );
+
+  /** Compute the measure value and derivative. */
+  double normal_sum = 0.0;
+  if( context.st_NumberOfPixelsCounted > 0 )
+  {
+    normal_sum = this->m_NormalizationFactor
+      / static_cast< double >( context.st_NumberOfPixelsCounted );
+  }
+  value = measure * normal_sum;
+
+  if( derivative )
+  {
+    *derivative = context.st_WorkUnits[ 0 ].st_Derivative;
+    for( ThreadIdType i = 1; i < numberOfWorkUnits; ++i )
+    {
+      *derivative += context.st_WorkUnits[ i ].st_Derivative;
+    }
+    *derivative *= normal_sum;
+  }
+
+} // end EvaluateInContext()
+
+
+/**
+ * ******************* ThreadedEvaluateInContext *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedEvaluateInContext( ThreadIdType workUnit,
+  EvaluationContextType & context, const bool computeDerivative ) const
+{
+  EvaluationContextWorkUnitType & variables = context.st_WorkUnits[ workUnit ];
+  variables.st_Value                 = NumericTraits< MeasureType >::Zero;
+  variables.st_NumberOfPixelsCounted = 0;
+  if( computeDerivative )
+  {
+    variables.st_Derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  }
+
+  /** Get the samples for this work unit. */
+  unsigned long pos_begin = 0;
+  unsigned long pos_end   = 0;
+  Self::GetSampleRangeForWorkUnit( this->GetImageSampler()->GetOutput()->Size(),
+    workUnit, static_cast< ThreadIdType >( context.st_WorkUnits.size() ), pos_begin, pos_end );
+
+  /** Run the loop over the samples, with the evaluators of the context. */
+  const AccumulateValueAndDerivativeFunctor functor = {
+    this, pos_begin, pos_end,
+    &variables.st_NonZeroJacobianIndices, &variables.st_ImageJacobian, &variables.st_Value,
+    computeDerivative ? &variables.st_Derivative : nullptr, &variables.st_NumberOfPixelsCounted
+  };
+  this->CallWithSampleEvaluatorInContext( functor, context );
+
+} // end ThreadedEvaluateInContext()
+
+
+/**
+ * ******************* EvaluateInContextThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::EvaluateInContextThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  EvaluateInContextThreaderParameterType * temp
+    = static_cast< EvaluateInContextThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedEvaluateInContext( infoStruct->WorkUnitID,
+    *temp->st_Context, temp->st_ComputeDerivative );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end EvaluateInContextThreaderCallback()
+
+
 /**
  * *************** UpdateValueAndDerivativeTerms ***************************
  */
@@ -888,19 +962,12 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
   RandomGeneratorType::Pointer randomGenerator = RandomGeneratorType::GetInstance();
   randomGenerator->Initialize();
 
-  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
-  NonZeroJacobianIndicesType nzji(
-  this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
-  DerivativeType        imageJacobian( nzji.size() );
-  TransformJacobianType jacobian;
-
   /** Make sure the transform parameters are up to date. */
   this->SetTransformParameters( parameters );
 
   /** Prepare Hessian */
-  H.set_size( this->GetNumberOfParameters(),
-    this->GetNumberOfParameters() );
-  //H.Fill(0.0); // done by set_size if sparse matrix
+  const unsigned int numberOfParameters = this->GetNumberOfParameters();
+  H.set_size( numberOfParameters, numberOfParameters );
 
   /** Smooth fixed image */
   typename SmootherType::Pointer smoother = SmootherType::New();
@@ -924,30 +991,172 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
    * Actually we could do without a sampler, but it's easy like this.
    */
   typename SelfHessianSamplerType::Pointer sampler = SelfHessianSamplerType::New();
-  //typename DummyFixedImageInterpolatorType::Pointer dummyInterpolator =
-  //  DummyFixedImageInterpolatorType::New();
   sampler->SetInputImageRegion( this->GetImageSampler()->GetInputImageRegion() );
   sampler->SetMask( this->GetImageSampler()->GetMask() );
   sampler->SetInput( smoother->GetInput() );
   sampler->SetNumberOfSamples( this->m_NumberOfSamplesForSelfHessian );
-  //sampler->SetInterpolator( dummyInterpolator );
 
   /** Update the imageSampler and get a handle to the sample container. */
   sampler->Update();
-  ImageSampleContainerPointer sampleContainer = sampler->GetOutput();
+  ImageSampleContainerPointer sampleContainer     = sampler->GetOutput();
+  const unsigned long         sampleContainerSize = sampleContainer->Size();
+
+  /** Check which samples are valid, multi-threaded. A local threader
+   * is used, since this function may be called from the combination metric.
+   */
+  const ThreadIdType numberOfThreads
+    = this->m_UseMultiThread ? this->m_Threader->GetNumberOfWorkUnits() : 1;
+  std::vector< unsigned char > validSamples( sampleContainerSize, 0 );
+  std::vector< double >        noise( sampleContainerSize * FixedImageDimension, 0.0 );
+  this->m_SelfHessianPerThreadVariables.clear();
+  this->m_SelfHessianPerThreadVariables.resize( numberOfThreads );
+  this->m_SelfHessianThreaderParameters.st_Metric            = this;
+  this->m_SelfHessianThreaderParameters.st_SampleContainer   = sampleContainer.GetPointer();
+  this->m_SelfHessianThreaderParameters.st_FixedInterpolator = fixedInterpolator.GetPointer();
+  this->m_SelfHessianThreaderParameters.st_ValidSamples      = &validSamples;
+  this->m_SelfHessianThreaderParameters.st_Noise             = &noise;
+  this->m_SelfHessianThreaderParameters.st_CheckSamplesOnly  = true;
+
+  typename ThreaderType::Pointer local_threader = ThreaderType::New();
+  local_threader->SetNumberOfWorkUnits( numberOfThreads );
+  local_threader->SetSingleMethod( GetSelfHessianThreaderCallback,
+    static_cast< void * >( &this->m_SelfHessianThreaderParameters ) );
+  local_threader->SingleMethodExecute();
+
+  /** Draw the noise that is added to the image derivatives of the valid
+   * samples, in the order of the samples, since the random generator is not
+   * thread-safe. This is the same sequence as drawn by a sequential loop.
+   */
+  for( unsigned long i = 0; i < sampleContainerSize; ++i )
+  {
+    if( !validSamples[ i ] )
+    {
+      continue;
+    }
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
+    {
+      noise[ i * FixedImageDimension + d ] = randomGenerator->GetVariateWithClosedRange(
+        this->m_SelfHessianNoiseRange ) - this->m_SelfHessianNoiseRange / 2.0;
+    }
+  }
+
+  /** Compute the contributions of the valid samples multi-threaded. */
+  this->m_SelfHessianThreaderParameters.st_CheckSamplesOnly = false;
+  local_threader->SingleMethodExecute();
+
+  /** Merge the entries of the threads, in thread order. */
+  SelfHessianEntryContainerType entries;
+  std::size_t                   numberOfEntries = 0;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    numberOfEntries += this->m_SelfHessianPerThreadVariables[ i ].st_Entries.size();
+  }
+  entries.reserve( numberOfEntries );
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    SelfHessianPerThreadStruct & threadVariables = this->m_SelfHessianPerThreadVariables[ i ];
+    entries.insert( entries.end(), threadVariables.st_Entries.begin(), threadVariables.st_Entries.end() );
+    this->m_NumberOfPixelsCounted += threadVariables.st_NumberOfPixelsCounted;
+    SelfHessianEntryContainerType().swap( threadVariables.st_Entries );
+  }
+  Self::CompactSelfHessianEntries( entries );
+
+  /** Check if enough samples were valid. */
+  this->CheckNumberOfSamples( sampleContainerSize, this->m_NumberOfPixelsCounted );
+
+  /** Copy the compressed rows to H, and normalize. */
+  if( this->m_NumberOfPixelsCounted > 0 )
+  {
+    const double normal_sum = 2.0 * this->m_NormalizationFactor
+      / static_cast< double >( this->m_NumberOfPixelsCounted );
+
+    std::vector< int >    columns;
+    std::vector< double > values;
+    typename SelfHessianEntryContainerType::const_iterator it = entries.begin();
+    while( it != entries.end() )
+    {
+      const unsigned int row = it->st_Row;
+      columns.clear();
+      values.clear();
+      for(; it != entries.end() && it->st_Row == row; ++it )
+      {
+        columns.push_back( static_cast< int >( it->st_Column ) );
+        values.push_back( normal_sum * it->st_Value );
+      }
+      H.set_row( row, columns, values );
+    }
+  }
+  else
+  {
+    for( unsigned int i = 0; i < numberOfParameters; ++i )
+    {
+      H( i, i ) = 1.0;
+    }
+  }
+
+} // end GetSelfHessian()
+
+
+/**
+ * ******************* GetSelfHessianThreaderCallback *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::GetSelfHessianThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  SelfHessianThreaderParameterType * temp
+    = static_cast< SelfHessianThreaderParameterType * >( infoStruct->UserData );
+
+  if( temp->st_CheckSamplesOnly )
+  {
+    temp->st_Metric->ThreadedCheckSelfHessianSamples(
+      infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+  }
+  else
+  {
+    temp->st_Metric->ThreadedGetSelfHessian(
+      infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GetSelfHessianThreaderCallback()
+
+
+/**
+ * ******************* ThreadedCheckSelfHessianSamples *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedCheckSelfHessianSamples( ThreadIdType threadId, ThreadIdType numberOfThreads ) const
+{
+  const SelfHessianThreaderParameterType & parameters   = this->m_SelfHessianThreaderParameters;
+  std::vector< unsigned char > &           validSamples = *parameters.st_ValidSamples;
+
+  /** Get the samples for this thread. */
+  const unsigned long sampleContainerSize = parameters.st_SampleContainer->Size();
+  const unsigned long pos_begin           = sampleContainerSize * threadId / numberOfThreads;
+  const unsigned long pos_end             = sampleContainerSize * ( threadId + 1 ) / numberOfThreads;
 
   /** Create iterator over the sample container. */
   typename ImageSampleContainerType::ConstIterator fiter;
-  typename ImageSampleContainerType::ConstIterator fbegin = sampleContainer->Begin();
-  typename ImageSampleContainerType::ConstIterator fend   = sampleContainer->End();
-
-  /** Loop over the fixed image to calculate the mean squares. */
-  for( fiter = fbegin; fiter != fend; ++fiter )
+  typename ImageSampleContainerType::ConstIterator fbegin = parameters.st_SampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend   = parameters.st_SampleContainer->Begin();
+  fbegin += (int)pos_begin;
+  fend   += (int)pos_end;
+
+  /** Loop over the fixed image samples. */
+  unsigned long sampleNumber = pos_begin;
+  for( fiter = fbegin; fiter != fend; ++fiter, ++sampleNumber )
   {
     /** Read fixed coordinates and initialize some variables. */
     const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
     MovingImagePointType        mappedPoint;
-    MovingImageDerivativeType   movingImageDerivative;
 
     /** Transform point and check if it is inside the B-spline support region. */
     bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
@@ -968,132 +1177,154 @@ AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
       sampleOk = this->m_Interpolator->IsInsideBuffer( mappedPoint );
     }
 
-    if( sampleOk )
-    {
-      this->m_NumberOfPixelsCounted++;
-
-      /** Use the derivative of the fixed image for the self Hessian!
-       * \todo: we can do this more efficient without the interpolation,
-       * without the sampler, and with a precomputed gradient image,
-       * but is this the bottleneck?
-       */
-      movingImageDerivative = fixedInterpolator->EvaluateDerivative( fixedPoint );
-      for( unsigned int d = 0; d < FixedImageDimension; ++d )
-      {
-        movingImageDerivative[ d ] += randomGenerator->GetVariateWithClosedRange(
-          this->m_SelfHessianNoiseRange ) - this->m_SelfHessianNoiseRange / 2.0;
-      }
+    validSamples[ sampleNumber ] = sampleOk ? 1 : 0;
 
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+  } // end for loop over the image sample container
 
-      /** Compute the innerproducts (dM/dx)^T (dT/dmu) */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
+} // end ThreadedCheckSelfHessianSamples()
 
-      /** Compute this pixel's contribution to the SelfHessian. */
-      this->UpdateSelfHessianTerms( imageJacobian, nzji, H );
 
-    } // end if sampleOk
+/**
+ * ******************* ThreadedGetSelfHessian *******************
+ */
 
-  } // end for loop over the image sample container
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetSelfHessian( ThreadIdType threadId, ThreadIdType numberOfThreads ) const
+{
+  const SelfHessianThreaderParameterType & parameters = this->m_SelfHessianThreaderParameters;
+  const FixedImageInterpolatorType *       fixedInterpolator = parameters.st_FixedInterpolator;
+  const std::vector< unsigned char > &     validSamples = *parameters.st_ValidSamples;
+  const std::vector< double > &            noise = *parameters.st_Noise;
+  SelfHessianEntryContainerType &          entries
+    = this->m_SelfHessianPerThreadVariables[ threadId ].st_Entries;
 
-  /** Check if enough samples were valid. */
-  this->CheckNumberOfSamples(
-    sampleContainer->Size(), this->m_NumberOfPixelsCounted );
+  /** Array that stores dM(x)/dmu, and the sparse jacobian+indices. */
+  NonZeroJacobianIndicesType nzji(
+  this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices() );
+  DerivativeType        imageJacobian( nzji.size() );
+  TransformJacobianType jacobian;
 
-  /** Compute the measure value and derivative. */
-  if( this->m_NumberOfPixelsCounted > 0 )
+  /** Get the samples for this thread. */
+  const unsigned long sampleContainerSize = parameters.st_SampleContainer->Size();
+  const unsigned long pos_begin           = sampleContainerSize * threadId / numberOfThreads;
+  const unsigned long pos_end             = sampleContainerSize * ( threadId + 1 ) / numberOfThreads;
+
+  /** Create iterator over the sample container. */
+  typename ImageSampleContainerType::ConstIterator fiter;
+  typename ImageSampleContainerType::ConstIterator fbegin = parameters.st_SampleContainer->Begin();
+  typename ImageSampleContainerType::ConstIterator fend   = parameters.st_SampleContainer->Begin();
+  fbegin += (int)pos_begin;
+  fend   += (int)pos_end;
+
+  /** Compact the entries when the list grows too large. The number of
+   * distinct entries is bounded by the number of nonzeros of H.
+   */
+  const std::size_t minimumCompactionSize = 1 << 20;
+  std::size_t       compactionSize        = minimumCompactionSize;
+
+  /** Loop over the fixed image samples. */
+  SizeValueType numberOfPixelsCounted = 0;
+  unsigned long sampleNumber          = pos_begin;
+  for( fiter = fbegin; fiter != fend; ++fiter, ++sampleNumber )
   {
-    const double normal_sum = 2.0 * this->m_NormalizationFactor
-      / static_cast< double >( this->m_NumberOfPixelsCounted );
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
+    /** Skip the samples that are not valid. */
+    if( !validSamples[ sampleNumber ] )
     {
-      H.scale_row( i, normal_sum );
+      continue;
     }
-  }
-  else
-  {
-    //H.fill_diagonal(1.0);
-    for( unsigned int i = 0; i < this->GetNumberOfParameters(); ++i )
+
+    /** Read fixed coordinates and initialize some variables. */
+    const FixedImagePointType & fixedPoint = ( *fiter ).Value().m_ImageCoordinates;
+    MovingImageDerivativeType   movingImageDerivative;
+
+    numberOfPixelsCounted++;
+
+    /** Use the derivative of the fixed image for the self Hessian! */
+    movingImageDerivative = fixedInterpolator->EvaluateDerivative( fixedPoint );
+    for( unsigned int d = 0; d < FixedImageDimension; ++d )
     {
-      H( i, i ) = 1.0;
+      movingImageDerivative[ d ] += noise[ sampleNumber * FixedImageDimension + d ];
     }
-  }
 
-} // end GetSelfHessian()
+    /** Get the TransformJacobian dT/dmu. */
+    this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
+
+    /** Compute the innerproducts (dM/dx)^T (dT/dmu) */
+    this->EvaluateTransformJacobianInnerProduct(
+      jacobian, movingImageDerivative, imageJacobian );
+
+    /** Store this pixel's contribution to the upper triangular part of the SelfHessian. */
+    const unsigned int imjacsize = imageJacobian.GetSize();
+    for( unsigned int i = 0; i < imjacsize; ++i )
+    {
+      const double imjacrow = imageJacobian[ i ];
+      for( unsigned int j = i; j < imjacsize; ++j )
+      {
+        const double val = imjacrow * imageJacobian[ j ];
+        if( ( val < 1e-14 ) && ( val > -1e-14 ) )
+        {
+          continue;
+        }
+
+        /** Save only the upper triangular part of the matrix. */
+        SelfHessianEntryType entry;
+        entry.st_Row    = static_cast< unsigned int >( nzji[ i ] );
+        entry.st_Column = static_cast< unsigned int >( nzji[ j ] );
+        entry.st_Value  = val;
+        entries.push_back( entry );
+      }
+    }
+
+    if( entries.size() >= compactionSize )
+    {
+      Self::CompactSelfHessianEntries( entries );
+      compactionSize = std::max( minimumCompactionSize, 2 * entries.size() );
+    }
+
+  } // end for loop over the image sample container
+
+  Self::CompactSelfHessianEntries( entries );
+  this->m_SelfHessianPerThreadVariables[ threadId ].st_NumberOfPixelsCounted = numberOfPixelsCounted;
+
+} // end ThreadedGetSelfHessian()
 
 
 /**
- * *************** UpdateSelfHessianTerms ***************************
+ * *************** CompactSelfHessianEntries ***************************
  */
 
 template< class TFixedImage, class TMovingImage >
 void
 AdvancedMeanSquaresImageToImageMetric< TFixedImage, TMovingImage >
-::UpdateSelfHessianTerms(
-  const DerivativeType & imageJacobian,
-  const NonZeroJacobianIndicesType & nzji,
-  HessianType & H ) const
+::CompactSelfHessianEntries( SelfHessianEntryContainerType & entries )
 {
-  typedef typename HessianType::row    RowType;
-  typedef typename RowType::iterator   RowIteratorType;
-  typedef typename HessianType::pair_t ElementType;
-
-  // does not work for sparse matrix. \todo: distinguish between sparse and nonsparse
-  ///** Do rank-1 update of H */
-  //if ( nzji.size() == this->GetNumberOfParameters() )
-  //{
-  //  /** Loop over all Jacobians. */
-  //  vnl_matrix_update( H, imageJacobian, imageJacobian );
-  //}
-  //else
-  //{
-  /** Only pick the nonzero Jacobians.
-  * Save only upper triangular part of the matrix */
-  const unsigned int imjacsize = imageJacobian.GetSize();
-  for( unsigned int i = 0; i < imjacsize; ++i )
+  if( entries.empty() )
   {
-    const unsigned int row      = nzji[ i ];
-    const double       imjacrow = imageJacobian[ i ];
+    return;
+  }
 
-    RowType &       rowVector = H.get_row( row );
-    RowIteratorType rowIt     = rowVector.begin();
+  std::stable_sort( entries.begin(), entries.end() );
 
-    for( unsigned int j = i; j < imjacsize; ++j )
+  /** Sum the duplicates in place. */
+  typename SelfHessianEntryContainerType::iterator out = entries.begin();
+  typename SelfHessianEntryContainerType::iterator it  = entries.begin();
+  for( ++it; it != entries.end(); ++it )
+  {
+    if( it->st_Row == out->st_Row && it->st_Column == out->st_Column )
     {
-      const unsigned int col = nzji[ j ];
-      const double       val = imjacrow * imageJacobian[ j ];
-      if( ( val < 1e-14 ) && ( val > -1e-14 ) )
-      {
-        continue;
-      }
-
-      /** The following implements:
-       * H(row,col) += imjacrow * imageJacobian[ j ];
-       * But more efficient.
-       */
-
-      /** Go to next element */
-      for(; ( rowIt != rowVector.end() ) && ( ( *rowIt ).first < col ); ++rowIt )
-      {}
-
-      if( ( rowIt == rowVector.end() ) || ( ( *rowIt ).first != col ) )
-      {
-        /** Add new column to the row and set iterator to that column. */
-        rowIt = rowVector.insert( rowIt, ElementType( col, val ) );
-      }
-      else
-      {
-        /** Add to existing value */
-        ( *rowIt ).second += val;
-      }
+      out->st_Value += it->st_Value;
+    }
+    else
+    {
+      ++out;
+      *out = *it;
     }
   }
+  entries.erase( out + 1, entries.end() );
 
-  //} // end else
-
-} // end UpdateSelfHessianTerms()
+} // end CompactSelfHessianEntries()
 
 
 } // end namespace itk
@@ -81,6 +81,16 @@ namespace itk
  *
  * where Af and Am are the average of f and m, respectively.
  *
+ * The derivative is a sum over the samples of the differential times the per-sample
+ * coefficient [ f(x) - Af ] - ( sfm / smm ) * [ m(x+u(x,p)) - Am ], divided by the
+ * denominator (Af = Am = 0 if SubtractMean is false). The coefficient is only known
+ * after the pass over all samples. When the sparse differentials of all samples take
+ * less memory than the per-thread sums over f * differential and m * differential,
+ * the multi-threaded implementation stores them, and scatters them once with the
+ * combined coefficient into a single derivative vector per thread. Otherwise the
+ * two sums (and, if SubtractMean is true, the sum of the differentials) are
+ * accumulated per thread.
+ *
  *
  * \ingroup RegistrationMetrics
  * \ingroup Metrics
@@ -228,9 +238,26 @@ protected:
    */
   void InitializeThreadingParameters( void ) const override;
 
+  /** Select how the derivative is accumulated in this iteration, and
+   * allocate the per-thread variables that are needed for it.
+   * Called after the sample container has been updated.
+   */
+  void InitializeDerivativeAccumulation( void ) const;
+
+  /** Whether to accumulate the derivative with the stored sparse differentials
+   * of the samples, instead of with the dense per-thread sums. By default this
+   * is done when the sparse differentials take less memory.
+   */
+  virtual bool GetUseSparseJacobianAccumulation( const SizeValueType numberOfSamples ) const;
+
   /** Get value and derivatives for each thread. */
   inline void ThreadedGetValueAndDerivative( ThreadIdType threadID ) override;
 
+  /** Get value and derivatives for each thread, using the given sample evaluator. */
+  template< class TSampleEvaluator >
+  inline void ThreadedGetValueAndDerivativeWithEvaluator(
+    ThreadIdType threadID, const TSampleEvaluator & evaluator );
+
   /** Gather the values and derivatives from all threads */
   inline void AfterThreadedGetValueAndDerivative(
     MeasureType & value, DerivativeType & derivative ) const override;
@@ -238,12 +265,31 @@ protected:
   /** AccumulateDerivatives threader callback function */
   static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION AccumulateDerivativesThreaderCallback( void * arg );
 
+  /** Scatters the stored sparse differentials of each thread, weighted by
+   * the per-sample coefficient, into the derivative of that thread.
+   */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ScatterSparseJacobiansThreaderCallback( void * arg );
+
 private:
 
   AdvancedNormalizedCorrelationImageToImageMetric( const Self & ); // purposely not implemented
   void operator=( const Self & );                                  // purposely not implemented
 
+  /** Calls ThreadedGetValueAndDerivativeWithEvaluator(), for CallWithSampleEvaluator(). */
+  struct ThreadedGetValueAndDerivativeFunctor
+  {
+    Self *       m_Metric;
+    ThreadIdType m_ThreadId;
+
+    template< class TSampleEvaluator >
+    void operator()( const TSampleEvaluator & evaluator ) const
+    {
+      this->m_Metric->ThreadedGetValueAndDerivativeWithEvaluator( this->m_ThreadId, evaluator );
+    }
+  };
+
   mutable bool m_SubtractMean;
+  mutable bool m_AccumulateSparseJacobians;
 
   typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
 
@@ -272,6 +318,14 @@ private:
     DerivativeType st_DerivativeF;
     DerivativeType st_DerivativeM;
     DerivativeType st_Differential;
+
+    /** The stored samples, when m_AccumulateSparseJacobians is true.
+     * In that case st_DerivativeF holds the combined derivative.
+     */
+    std::vector< RealType >            st_FixedImageValues;
+    std::vector< RealType >            st_MovingImageValues;
+    std::vector< DerivativeValueType > st_ImageJacobians;
+    NonZeroJacobianIndicesType         st_NonZeroJacobianIndices;
   };
   itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, CorrelationGetValueAndDerivativePerThreadStruct,
     PaddedCorrelationGetValueAndDerivativePerThreadStruct );
@@ -35,7 +35,8 @@ template< class TFixedImage, class TMovingImage >
 AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::AdvancedNormalizedCorrelationImageToImageMetric()
 {
-  this->m_SubtractMean = false;
+  this->m_SubtractMean              = false;
+  this->m_AccumulateSparseJacobians = false;
 
   this->SetUseImageSampler( true );
   this->SetUseFixedImageLimiter( false );
@@ -99,16 +100,90 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sf                    = zero1;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Sm                    = zero1;
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF.SetSize( this->GetNumberOfParameters() );
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM.SetSize( this->GetNumberOfParameters() );
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential.SetSize( this->GetNumberOfParameters() );
     this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF.Fill( zero2 );
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM.Fill( zero2 );
-    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential.Fill( zero2 );
+
+    /** The other derivative terms are allocated in InitializeDerivativeAccumulation(). */
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM.SetSize( 0 );
+    this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential.SetSize( 0 );
   }
 
 } // end InitializeThreadingParameters()
 
 
+/**
+ * ******************* InitializeDerivativeAccumulation *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeDerivativeAccumulation( void ) const
+{
+  const ThreadIdType           numberOfThreads    = Self::GetNumberOfWorkUnits();
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  const NumberOfParametersType nnzji              = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+  const SizeValueType          numberOfSamples    = this->GetImageSampler()->GetOutput()->Size();
+
+  this->m_AccumulateSparseJacobians = this->GetUseSparseJacobianAccumulation( numberOfSamples );
+
+  const DerivativeValueType zero = NumericTraits< DerivativeValueType >::Zero;
+  const SizeValueType       numberOfSamplesPerThread
+    = ( numberOfSamples + numberOfThreads - 1 ) / numberOfThreads;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    CorrelationGetValueAndDerivativePerThreadStruct & perThread
+      = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ];
+    if( this->m_AccumulateSparseJacobians )
+    {
+      perThread.st_FixedImageValues.reserve( numberOfSamplesPerThread );
+      perThread.st_MovingImageValues.reserve( numberOfSamplesPerThread );
+      perThread.st_ImageJacobians.reserve( numberOfSamplesPerThread * nnzji );
+      perThread.st_NonZeroJacobianIndices.reserve( numberOfSamplesPerThread * nnzji );
+      continue;
+    }
+
+    /** The dense accumulation; a newly allocated vector needs to be zeroed. */
+    if( perThread.st_DerivativeM.GetSize() != numberOfParameters )
+    {
+      perThread.st_DerivativeM.SetSize( numberOfParameters );
+      perThread.st_DerivativeM.Fill( zero );
+    }
+    if( this->m_SubtractMean && perThread.st_Differential.GetSize() != numberOfParameters )
+    {
+      perThread.st_Differential.SetSize( numberOfParameters );
+      perThread.st_Differential.Fill( zero );
+    }
+  }
+
+} // end InitializeDerivativeAccumulation()
+
+
+/**
+ * ******************* GetUseSparseJacobianAccumulation *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::GetUseSparseJacobianAccumulation( const SizeValueType numberOfSamples ) const
+{
+  const ThreadIdType           numberOfThreads    = Self::GetNumberOfWorkUnits();
+  const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
+  const NumberOfParametersType nnzji              = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
+
+  /** The sparse differentials of all samples replace the per-thread sums over
+   * m * differential and, with SubtractMean, over the differential. Only store
+   * them when they take less memory.
+   */
+  const double sparseSize = static_cast< double >( numberOfSamples ) * nnzji
+    * ( sizeof( DerivativeValueType ) + sizeof( typename NonZeroJacobianIndicesType::value_type ) );
+  const double denseSize = ( this->m_SubtractMean ? 2.0 : 1.0 ) * numberOfThreads
+    * numberOfParameters * sizeof( DerivativeValueType );
+  return nnzji < numberOfParameters && sparseSize <= denseSize;
+
+} // end GetUseSparseJacobianAccumulation()
+
+
 /**
  * ******************* PrintSelf *******************
  */
@@ -140,24 +215,26 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   DerivativeType & derivativeM,
   DerivativeType & differential ) const
 {
+  /** The sum of the differentials is only needed when subtracting the mean. */
+  const bool updateDifferential = this->m_SubtractMean;
+
   /** Calculate the contributions to the derivatives with respect to each parameter. */
   if( nzji.size() == this->GetNumberOfParameters() )
   {
-    /** Loop over all Jacobians. */
-    typename DerivativeType::const_iterator imjacit  = imageJacobian.begin();
-    typename DerivativeType::iterator derivativeFit  = derivativeF.begin();
-    typename DerivativeType::iterator derivativeMit  = derivativeM.begin();
-    typename DerivativeType::iterator differentialit = differential.begin();
+    /** Loop over all Jacobians, using plain pointer loops. */
+    const DerivativeValueType *  imjac              = imageJacobian.data_block();
+    DerivativeValueType *        derF               = derivativeF.data_block();
+    DerivativeValueType *        derM               = derivativeM.data_block();
+    const NumberOfParametersType numberOfParameters = this->GetNumberOfParameters();
 
-    for( unsigned int mu = 0; mu < this->GetNumberOfParameters(); ++mu )
+    for( NumberOfParametersType mu = 0; mu < numberOfParameters; ++mu )
+    {
+      derF[ mu ] += fixedImageValue * imjac[ mu ];
+      derM[ mu ] += movingImageValue * imjac[ mu ];
+    }
+    if( updateDifferential )
     {
-      ( *derivativeFit )  += fixedImageValue * ( *imjacit );
-      ( *derivativeMit )  += movingImageValue * ( *imjacit );
-      ( *differentialit ) += ( *imjacit );
-      ++imjacit;
-      ++derivativeFit;
-      ++derivativeMit;
-      ++differentialit;
+      differential += imageJacobian;
     }
   }
   else
@@ -167,9 +244,12 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     {
       const unsigned int index           = nzji[ i ];
       const RealType     differentialtmp = imageJacobian[ i ];
-      derivativeF[ index ]  += fixedImageValue  * differentialtmp;
-      derivativeM[ index ]  += movingImageValue * differentialtmp;
-      differential[ index ] += differentialtmp;
+      derivativeF[ index ] += fixedImageValue  * differentialtmp;
+      derivativeM[ index ] += movingImageValue * differentialtmp;
+      if( updateDifferential )
+      {
+        differential[ index ] += differentialtmp;
+      }
     }
   }
 
@@ -513,6 +593,9 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
    */
   this->BeforeThreadedGetValueAndDerivative( parameters );
 
+  /** Select the derivative accumulation, now that the samples are known. */
+  this->InitializeDerivativeAccumulation();
+
   /** launch multithreading metric */
   this->LaunchGetValueAndDerivativeThreaderCallback();
 
@@ -530,6 +613,23 @@ template< class TFixedImage, class TMovingImage >
 void
 AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 ::ThreadedGetValueAndDerivative( ThreadIdType threadId )
+{
+  /** Run the loop over the samples with the evaluator selected for this resolution. */
+  const ThreadedGetValueAndDerivativeFunctor functor = { this, threadId };
+  this->CallWithSampleEvaluator( functor );
+
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ******************* ThreadedGetValueAndDerivativeWithEvaluator *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+template< class TSampleEvaluator >
+void
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivativeWithEvaluator( ThreadIdType threadId, const TSampleEvaluator & evaluator )
 {
   /** Initialize array that stores dM(x)/dmu, and the sparse Jacobian + indices. */
   const NumberOfParametersType nnzji = this->m_AdvancedTransform->GetNumberOfNonZeroJacobianIndices();
@@ -545,6 +645,17 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   DerivativeType & derivativeM  = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_DerivativeM;
   DerivativeType & differential = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Differential;
 
+  /** Get handles to the buffers that store the samples, when accumulating sparse Jacobians. */
+  const bool                           accumulateSparseJacobians = this->m_AccumulateSparseJacobians;
+  std::vector< RealType > &            fixedImageValues          = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_FixedImageValues;
+  std::vector< RealType > &            movingImageValues         = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_MovingImageValues;
+  std::vector< DerivativeValueType > & imageJacobians            = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_ImageJacobians;
+  NonZeroJacobianIndicesType &         nonZeroJacobianIndices    = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_NonZeroJacobianIndices;
+  fixedImageValues.clear();
+  movingImageValues.clear();
+  imageJacobians.clear();
+  nonZeroJacobianIndices.clear();
+
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer     = this->GetImageSampler()->GetOutput();
   const unsigned long         sampleContainerSize = sampleContainer->Size();
@@ -585,7 +696,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     MovingImageDerivativeType   movingImageDerivative;
 
     /** Transform point and check if it is inside the B-spline support region. */
-    bool sampleOk = this->TransformPoint( fixedPoint, mappedPoint );
+    bool sampleOk = evaluator.TransformPoint( fixedPoint, mappedPoint );
 
     /** Check if point is inside mask. */
     if( sampleOk )
@@ -598,7 +709,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
      */
     if( sampleOk )
     {
-      sampleOk = this->EvaluateMovingImageValueAndDerivative(
+      sampleOk = evaluator.EvaluateMovingImageValueAndDerivative(
         mappedPoint, movingImageValue, &movingImageDerivative );
     }
 
@@ -610,18 +721,9 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
       const RealType & fixedImageValue
         = static_cast< RealType >( ( *threader_fiter ).Value().m_ImageValue );
 
-#if 0
-      /** Get the TransformJacobian dT/dmu. */
-      this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-
-      /** Compute the inner products (dM/dx)^T (dT/dmu). */
-      this->EvaluateTransformJacobianInnerProduct(
-        jacobian, movingImageDerivative, imageJacobian );
-#else
       /** Compute the inner product of the transform Jacobian dT/dmu and the moving image gradient dM/dx. */
-      this->m_AdvancedTransform->EvaluateJacobianWithImageGradientProduct(
+      evaluator.EvaluateJacobianWithImageGradientProduct(
         fixedPoint, movingImageDerivative, imageJacobian, nzji );
-#endif
 
       /** Update some sums needed to calculate the value of NC. */
       sff += fixedImageValue  * fixedImageValue;
@@ -630,10 +732,22 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
       sf  += fixedImageValue;  // Only needed when m_SubtractMean == true
       sm  += movingImageValue; // Only needed when m_SubtractMean == true
 
-      /** Compute this voxel's contribution to the derivative terms. */
-      this->UpdateDerivativeTerms(
-        fixedImageValue, movingImageValue, imageJacobian, nzji,
-        derivativeF, derivativeM, differential );
+      /** Compute this voxel's contribution to the derivative terms, or store
+       * the sample, so that it can be scattered once the sums are known.
+       */
+      if( accumulateSparseJacobians )
+      {
+        fixedImageValues.push_back( fixedImageValue );
+        movingImageValues.push_back( movingImageValue );
+        imageJacobians.insert( imageJacobians.end(), imageJacobian.begin(), imageJacobian.end() );
+        nonZeroJacobianIndices.insert( nonZeroJacobianIndices.end(), nzji.begin(), nzji.end() );
+      }
+      else
+      {
+        this->UpdateDerivativeTerms(
+          fixedImageValue, movingImageValue, imageJacobian, nzji,
+          derivativeF, derivativeM, differential );
+      }
 
     } // end if sampleOk
 
@@ -647,7 +761,7 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sf                    = sf;
   this->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ].st_Sm                    = sm;
 
-} // end ThreadedGetValueAndDerivative()
+} // end ThreadedGetValueAndDerivativeWithEvaluator()
 
 
 /**
@@ -735,9 +849,12 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 
     for( ThreadIdType i = 1; i < numberOfThreads; ++i )
     {
-      derivativeF  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF;
-      derivativeM  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM;
-      differential += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential;
+      derivativeF += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF;
+      derivativeM += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM;
+      if( this->m_SubtractMean )
+      {
+        differential += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential;
+      }
     }
 
     /** If SubtractMean, then subtract things from  derivativeF and derivativeM. */
@@ -771,6 +888,13 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
     temp->st_InvertedDenominator = 1.0 / denom;
     temp->st_DerivativePointer   = derivative.begin();
 
+    /** Scatter the stored samples with their combined coefficient first. */
+    if( this->m_AccumulateSparseJacobians )
+    {
+      this->m_Threader->SetSingleMethod( ScatterSparseJacobiansThreaderCallback, temp );
+      this->m_Threader->SingleMethodExecute();
+    }
+
     this->m_Threader->SetSingleMethod( AccumulateDerivativesThreaderCallback, temp );
     this->m_Threader->SingleMethodExecute();
 
@@ -792,18 +916,20 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
         = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_DerivativeF[ j ];
       DerivativeValueType derivativeM
         = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_DerivativeM[ j ];
-      DerivativeValueType differential
-        = this->m_CorrelationGetValueAndDerivativePerThreadVariables[ 0 ].st_Differential[ j ];
 
       for( ThreadIdType i = 1; i < numberOfThreads; ++i )
       {
-        derivativeF  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ];
-        derivativeM  += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ];
-        differential += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ];
+        derivativeF += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ];
+        derivativeM += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ];
       }
 
       if( this->m_SubtractMean )
       {
+        DerivativeValueType differential = NumericTraits< DerivativeValueType >::Zero;
+        for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+        {
+          differential += this->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ];
+        }
         derivativeF -= sf_N * differential;
         derivativeM -= sm_N * differential;
       }
@@ -846,20 +972,46 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
   jmax = ( jmax > numPar ) ? numPar : jmax;
 
   const DerivativeValueType zero = NumericTraits< DerivativeValueType >::Zero;
-  DerivativeValueType       derivativeF, derivativeM, differential;
+  Self *                    metric = temp->st_Metric;
+
+  /** With sparse Jacobians, the per-thread derivatives are already combined. */
+  if( metric->m_AccumulateSparseJacobians )
+  {
+    for( unsigned int j = jmin; j < jmax; ++j )
+    {
+      DerivativeValueType derivative = zero;
+      for( ThreadIdType i = 0; i < nrOfThreads; ++i )
+      {
+        derivative += metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ];
+
+        /** Reset this variable for the next iteration. */
+        metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ] = zero;
+      }
+      temp->st_DerivativePointer[ j ] = derivative * invertedDenominator;
+    }
+
+    return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+  }
+
+  DerivativeValueType derivativeF, derivativeM, differential;
   for( unsigned int j = jmin; j < jmax; ++j )
   {
     derivativeF = derivativeM = differential = zero;
     for( ThreadIdType i = 0; i < nrOfThreads; ++i )
     {
-      derivativeF  += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ];
-      derivativeM  += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ];
-      differential += temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ];
+      derivativeF += metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ];
+      derivativeM += metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ];
 
       /** Reset these variables for the next iteration. */
-      temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ]  = zero;
-      temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ]  = zero;
-      temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ] = zero;
+      metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeF[ j ] = zero;
+      metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_DerivativeM[ j ] = zero;
+
+      /** The differential is only allocated when subtracting the mean. */
+      if( subtractMean )
+      {
+        differential += metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ];
+        metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ i ].st_Differential[ j ] = zero;
+      }
     }
 
     if( subtractMean )
@@ -877,6 +1029,60 @@ AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
 } // end AccumulateDerivativesThreaderCallback()
 
 
+/**
+ *********** ScatterSparseJacobiansThreaderCallback *************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+AdvancedNormalizedCorrelationImageToImageMetric< TFixedImage, TMovingImage >
+::ScatterSparseJacobiansThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  MultiThreaderAccumulateDerivativeType * temp
+    = static_cast< MultiThreaderAccumulateDerivativeType * >( infoStruct->UserData );
+
+  /** The means are only subtracted when asked for. */
+  const bool           subtractMean = temp->st_Metric->m_SubtractMean;
+  const AccumulateType sf_N         = subtractMean ? temp->st_sf_N : NumericTraits< AccumulateType >::Zero;
+  const AccumulateType sm_N         = subtractMean ? temp->st_sm_N : NumericTraits< AccumulateType >::Zero;
+  const AccumulateType sfm_smm      = temp->st_sfm_smm;
+
+  /** Each thread scatters the samples it stored into its own derivative. */
+  CorrelationGetValueAndDerivativePerThreadStruct & perThread
+    = temp->st_Metric->m_CorrelationGetValueAndDerivativePerThreadVariables[ threadId ];
+  const std::size_t numberOfSamples = perThread.st_FixedImageValues.size();
+  if( numberOfSamples == 0 )
+  {
+    return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+  }
+  const std::size_t nnzji = perThread.st_ImageJacobians.size() / numberOfSamples;
+
+  DerivativeValueType *                                   derivative = perThread.st_DerivativeF.data_block();
+  const DerivativeValueType *                             imjac      = perThread.st_ImageJacobians.data();
+  const typename NonZeroJacobianIndicesType::value_type * nzji       = perThread.st_NonZeroJacobianIndices.data();
+  for( std::size_t s = 0; s < numberOfSamples; ++s )
+  {
+    /** The contribution of this sample to the numerator of the derivative. */
+    const DerivativeValueType coefficient = static_cast< DerivativeValueType >(
+      ( perThread.st_FixedImageValues[ s ] - sf_N )
+      - sfm_smm * ( perThread.st_MovingImageValues[ s ] - sm_N ) );
+
+    for( std::size_t k = 0; k < nnzji; ++k )
+    {
+      derivative[ nzji[ k ] ] += coefficient * imjac[ k ];
+    }
+    imjac += nnzji;
+    nzji  += nnzji;
+  }
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ScatterSparseJacobiansThreaderCallback()
+
+
 } // end namespace itk
 
 #endif // end #ifndef _itkAdvancedNormalizedCorrelationImageToImageMetric_hxx
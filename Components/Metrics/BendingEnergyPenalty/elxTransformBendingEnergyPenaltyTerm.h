@@ -39,6 +39,12 @@ namespace elastix
  * The parameters used in this class are:
  * \parameter Metric: Select this metric as follows:\n
  *    <tt>(Metric "TransformBendingEnergyPenalty")</tt>
+ * \parameter UseAnalyticBendingEnergy: Compute the exact bending energy of a cubic
+ *    B-spline transform from its coefficients, instead of estimating it from the
+ *    image samples. The value is the mean bending energy over the B-spline grid.
+ *    For other transforms the sampled estimate is used.\n
+ *    example: <tt>(UseAnalyticBendingEnergy "true")</tt>\n
+ *    Can be specified for each resolution. The default is false.
  *
  * \ingroup Metrics
  *
@@ -144,6 +150,7 @@ public:
   /**
    * Do some things before each resolution:
    * \li Set options for SelfHessian
+   * \li Set whether the analytic bending energy is used
    */
   void BeforeEachResolution( void ) override;
 
@@ -62,6 +62,12 @@ TransformBendingEnergyPenalty< TElastix >
     "NumberOfSamplesForSelfHessian", this->GetComponentLabel(), level, 0 );
   this->SetNumberOfSamplesForSelfHessian( numberOfSamplesForSelfHessian );
 
+  /** Set whether the exact bending energy of the B-spline grid is used. */
+  bool useAnalyticBendingEnergy = false;
+  this->GetConfiguration()->ReadParameter( useAnalyticBendingEnergy,
+    "UseAnalyticBendingEnergy", this->GetComponentLabel(), level, 0 );
+  this->SetUseAnalyticBendingEnergy( useAnalyticBendingEnergy );
+
 } // end BeforeEachResolution()
 
 
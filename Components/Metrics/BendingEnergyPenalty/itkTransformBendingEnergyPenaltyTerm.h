@@ -35,6 +35,16 @@ namespace itk
  * zero.
  *
  *
+ * For cubic B-spline transforms (AdvancedBSplineDeformableTransform and
+ * RecursiveBSplineTransform) the bending energy is a quadratic form in the
+ * B-spline coefficients. When UseAnalyticBendingEnergy is set, the banded
+ * stiffness operator of this quadratic form is precomputed per grid in
+ * Initialize(), and the value and derivative are computed exactly, as the
+ * mean bending energy over the valid region of the B-spline grid, by
+ * multi-threaded separable stencil products over the coefficients. The image
+ * samples are then not used, and the number of pixels counted is the number of
+ * grid cells in the valid region. For other transforms the sampled estimate is used.
+ *
  * [1]: D. Rueckert, L. I. Sonoda, C. Hayes, D. L. G. Hill,
  *      M. O. Leach, and D. J. Hawkes, "Nonrigid registration
  *      using free-form deformations: Application to breast MR
@@ -128,6 +138,11 @@ public:
   /** Define the dimension. */
   itkStaticConstMacro( FixedImageDimension, unsigned int, FixedImageType::ImageDimension );
 
+  /** Initialize the penalty term. When the analytic bending energy is used,
+   * this precomputes the stiffness operator of the B-spline grid.
+   */
+  void Initialize( void ) override;
+
   /** Get the penalty term value. */
   MeasureType GetValue( const ParametersType & parameters ) const override;
 
@@ -160,6 +175,12 @@ public:
   itkSetMacro( NumberOfSamplesForSelfHessian, unsigned int );
   itkGetConstMacro( NumberOfSamplesForSelfHessian, unsigned int );
 
+  /** Compute the exact bending energy of a cubic B-spline transform,
+   * instead of estimating it from the image samples. Default: false
+   */
+  itkSetMacro( UseAnalyticBendingEnergy, bool );
+  itkGetConstMacro( UseAnalyticBendingEnergy, bool );
+
 protected:
 
   /** Typedefs for indices and points. */
@@ -189,6 +210,56 @@ private:
 
   unsigned int m_NumberOfSamplesForSelfHessian;
 
+  /** Typedefs for the analytic bending energy. */
+  typedef std::vector< double > BandedOperatorType;
+
+  /** The half bandwidth of the stiffness operator of a cubic B-spline. */
+  itkStaticConstMacro( BandRadius, unsigned int, 3 );
+
+  /** Compute the 1D banded Gram matrices of the B-spline basis functions
+   * and their first and second order derivatives, for each dimension.
+   */
+  void InitializeAnalyticBendingEnergy( const BSplineOrder3TransformType * bspline );
+
+  /** Compute the exact bending energy and, when requested, its derivative. */
+  void ComputeAnalyticBendingEnergy( const ParametersType & parameters,
+    MeasureType & value, DerivativeType * derivative ) const;
+
+  /** Apply a 1D banded operator along one dimension of all coefficient images,
+   * multi-threaded. When accumulate is true, weight * result is added to the output.
+   */
+  void ApplyBandedOperator( const double * input, double * output,
+    const unsigned int dimension, const BandedOperatorType & op,
+    const bool accumulate, const double weight ) const;
+
+  /** The threaded implementation of ApplyBandedOperator(). */
+  void ThreadedApplyBandedOperator( ThreadIdType threadId, ThreadIdType numberOfThreads ) const;
+
+  /** The callback function. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ApplyBandedOperatorThreaderCallback( void * arg );
+
+  /** Struct to pass data to the threads. */
+  struct BandedOperatorThreaderParameterType
+  {
+    const Self *               st_Metric;
+    const double *             st_Input;
+    double *                   st_Output;
+    unsigned int               st_Dimension;
+    const BandedOperatorType * st_Operator;
+    bool                       st_Accumulate;
+    double                     st_Weight;
+  };
+
+  bool                                        m_UseAnalyticBendingEnergy;
+  bool                                        m_AnalyticBendingEnergyIsInitialized;
+  BandedOperatorType                          m_BandedOperators[ FixedImageDimension ][ 3 ];
+  SizeValueType                               m_GridSize[ FixedImageDimension ];
+  SizeValueType                               m_NumberOfGridPoints;
+  SizeValueType                               m_NumberOfValidGridCells;
+  mutable std::vector< double >               m_AnalyticBuffers[ 2 ];
+  mutable std::vector< double >               m_AnalyticStiffnessTimesCoefficients;
+  mutable BandedOperatorThreaderParameterType m_BandedOperatorThreaderParameters;
+
 };
 
 } // end namespace itk
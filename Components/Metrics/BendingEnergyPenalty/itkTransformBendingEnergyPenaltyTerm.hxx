@@ -19,6 +19,10 @@
 #define __itkTransformBendingEnergyPenaltyTerm_hxx
 
 #include "itkTransformBendingEnergyPenaltyTerm.h"
+#include "itkBSplineKernelFunction2.h"
+#include "itkBSplineDerivativeKernelFunction2.h"
+#include "itkBSplineSecondOrderDerivativeKernelFunction2.h"
+#include <algorithm>
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -42,9 +46,329 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 
   this->m_NumberOfSamplesForSelfHessian = 100000;
 
+  this->m_UseAnalyticBendingEnergy           = false;
+  this->m_AnalyticBendingEnergyIsInitialized = false;
+  this->m_NumberOfGridPoints                 = 0;
+  this->m_NumberOfValidGridCells             = 0;
+
 } // end Constructor
 
 
+/**
+ * ****************** Initialize *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::Initialize( void )
+{
+  /** Call the initialize of the superclass. */
+  this->Superclass::Initialize();
+
+  /** Precompute the stiffness operator for the analytic bending energy. */
+  this->m_AnalyticBendingEnergyIsInitialized = false;
+  if( this->m_UseAnalyticBendingEnergy )
+  {
+    typename BSplineOrder3TransformType::Pointer bspline; // default-constructed (null)
+    this->CheckForBSplineTransform2( bspline );
+    if( bspline.IsNotNull() )
+    {
+      this->InitializeAnalyticBendingEnergy( bspline );
+    }
+    else
+    {
+      itkWarningMacro( << "WARNING: the analytic bending energy is only available for "
+                       << "third order B-spline transforms. The sampled bending energy is used." );
+    }
+  }
+
+} // end Initialize()
+
+
+/**
+ * ****************** InitializeAnalyticBendingEnergy *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::InitializeAnalyticBendingEnergy( const BSplineOrder3TransformType * bspline )
+{
+  /** The B-spline kernel and its first and second order derivatives. */
+  BSplineKernelFunction2< 3 >::Pointer kernel0
+    = BSplineKernelFunction2< 3 >::New();
+  BSplineDerivativeKernelFunction2< 3 >::Pointer kernel1
+    = BSplineDerivativeKernelFunction2< 3 >::New();
+  BSplineSecondOrderDerivativeKernelFunction2< 3 >::Pointer kernel2
+    = BSplineSecondOrderDerivativeKernelFunction2< 3 >::New();
+  const KernelFunctionBase2< double > * kernels[ 3 ]
+    = { kernel0.GetPointer(), kernel1.GetPointer(), kernel2.GetPointer() };
+
+  /** Four point Gauss-Legendre quadrature on [0,1]. The products of the
+   * (derivatives of the) cubic B-splines are polynomials of at most degree 6
+   * between two grid nodes, so this quadrature is exact.
+   */
+  const double gaussNodes[ 4 ] = {
+    0.5 - 0.5 * 0.8611363115940526, 0.5 - 0.5 * 0.3399810435848563,
+    0.5 + 0.5 * 0.3399810435848563, 0.5 + 0.5 * 0.8611363115940526
+  };
+  const double gaussWeights[ 4 ] = {
+    0.5 * 0.3478548451374538, 0.5 * 0.6521451548625461,
+    0.5 * 0.6521451548625461, 0.5 * 0.3478548451374538
+  };
+
+  const int bandRadius = static_cast< int >( BandRadius );
+  const int bandWidth  = 2 * bandRadius + 1;
+
+  this->m_NumberOfGridPoints     = 1;
+  this->m_NumberOfValidGridCells = 1;
+  for( unsigned int d = 0; d < FixedImageDimension; ++d )
+  {
+    const int    n       = static_cast< int >( bspline->GetGridRegion().GetSize()[ d ] );
+    const double spacing = bspline->GetGridSpacing()[ d ];
+    this->m_GridSize[ d ]       = static_cast< SizeValueType >( n );
+    this->m_NumberOfGridPoints *= this->m_GridSize[ d ];
+
+    /** The valid region of a cubic B-spline grid, relative to the grid index,
+     * is [1, n-2). The bending energy is averaged over this region.
+     */
+    const int    validBegin = 1;
+    const int    validEnd   = n - 2;
+    const double validSize  = validEnd > validBegin ? static_cast< double >( validEnd - validBegin ) : 1.0;
+    this->m_NumberOfValidGridCells *= validEnd > validBegin ? static_cast< SizeValueType >( validEnd - validBegin ) : 0;
+
+    for( unsigned int order = 0; order < 3; ++order )
+    {
+      BandedOperatorType & op = this->m_BandedOperators[ d ][ order ];
+      op.assign( n * bandWidth, 0.0 );
+
+      /** Scale for the derivatives in physical space and the averaging. */
+      const double scale = std::pow( spacing, -2.0 * order ) / validSize;
+
+      /** Integrate over the grid cells [m, m+1) in the valid region. The cell
+       * is only in the support of the basis functions of nodes m-1 .. m+2.
+       */
+      for( int m = validBegin; m < validEnd; ++m )
+      {
+        for( unsigned int g = 0; g < 4; ++g )
+        {
+          const double u = m + gaussNodes[ g ];
+          for( int p = m - 1; p <= m + 2; ++p )
+          {
+            if( p < 0 || p >= n ) { continue; }
+            const double bp = kernels[ order ]->Evaluate( u - p );
+            for( int q = m - 1; q <= m + 2; ++q )
+            {
+              if( q < 0 || q >= n ) { continue; }
+              const double bq = kernels[ order ]->Evaluate( u - q );
+              op[ p * bandWidth + ( q - p ) + bandRadius ] += scale * gaussWeights[ g ] * bp * bq;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /** Allocate the buffers. */
+  const SizeValueType numberOfParameters = FixedImageDimension * this->m_NumberOfGridPoints;
+  this->m_AnalyticBuffers[ 0 ].resize( numberOfParameters );
+  this->m_AnalyticBuffers[ 1 ].resize( numberOfParameters );
+  this->m_AnalyticStiffnessTimesCoefficients.resize( numberOfParameters );
+
+  this->m_AnalyticBendingEnergyIsInitialized = true;
+
+} // end InitializeAnalyticBendingEnergy()
+
+
+/**
+ * ****************** ComputeAnalyticBendingEnergy *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ComputeAnalyticBendingEnergy( const ParametersType & parameters,
+  MeasureType & value, DerivativeType * derivative ) const
+{
+  const SizeValueType numberOfParameters = FixedImageDimension * this->m_NumberOfGridPoints;
+  if( parameters.GetSize() != numberOfParameters )
+  {
+    itkExceptionMacro( << "ERROR: the number of parameters (" << parameters.GetSize()
+                       << ") does not match the B-spline grid (" << numberOfParameters << ")." );
+  }
+
+  /** The bending energy is averaged over the cells of the valid region. */
+  this->m_NumberOfPixelsCounted = this->m_NumberOfValidGridCells;
+
+  /** The bending energy is c^T A c, with the stiffness operator
+   * A = \sum_i \sum_j \bigotimes_d W_d^{o_d(i,j)},
+   * where o_d(i,j) is the order of the derivative in dimension d of the
+   * second order derivative d^2 / dx_i dx_j, and W_d^o are the 1D Gram
+   * matrices. The symmetric terms i != j are combined.
+   */
+  std::vector< double > & Ac = this->m_AnalyticStiffnessTimesCoefficients;
+  std::fill( Ac.begin(), Ac.end(), 0.0 );
+  const double * coefficients = parameters.data_block();
+
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    for( unsigned int j = i; j < FixedImageDimension; ++j )
+    {
+      const double weight = i == j ? 1.0 : 2.0;
+      const double * input = coefficients;
+      for( unsigned int d = 0; d < FixedImageDimension; ++d )
+      {
+        const unsigned int order = ( d == i ? 1 : 0 ) + ( d == j ? 1 : 0 );
+        const bool lastDimension = d + 1 == FixedImageDimension;
+        double * output = lastDimension ? &Ac[ 0 ] : &this->m_AnalyticBuffers[ d % 2 ][ 0 ];
+        this->ApplyBandedOperator( input, output, d,
+          this->m_BandedOperators[ d ][ order ], lastDimension, weight );
+        input = output;
+      }
+    }
+  }
+
+  /** Compute the value and the derivative. */
+  double measure = 0.0;
+  for( SizeValueType p = 0; p < numberOfParameters; ++p )
+  {
+    measure += coefficients[ p ] * Ac[ p ];
+  }
+  value = static_cast< MeasureType >( measure );
+
+  if( derivative != nullptr )
+  {
+    derivative->SetSize( numberOfParameters );
+    for( SizeValueType p = 0; p < numberOfParameters; ++p )
+    {
+      ( *derivative )[ p ] = 2.0 * Ac[ p ];
+    }
+  }
+
+} // end ComputeAnalyticBendingEnergy()
+
+
+/**
+ * ****************** ApplyBandedOperator *******************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ApplyBandedOperator( const double * input, double * output,
+  const unsigned int dimension, const BandedOperatorType & op,
+  const bool accumulate, const double weight ) const
+{
+  /** Fill the threader parameter struct with information. */
+  this->m_BandedOperatorThreaderParameters.st_Metric     = this;
+  this->m_BandedOperatorThreaderParameters.st_Input      = input;
+  this->m_BandedOperatorThreaderParameters.st_Output     = output;
+  this->m_BandedOperatorThreaderParameters.st_Dimension  = dimension;
+  this->m_BandedOperatorThreaderParameters.st_Operator   = &op;
+  this->m_BandedOperatorThreaderParameters.st_Accumulate = accumulate;
+  this->m_BandedOperatorThreaderParameters.st_Weight     = weight;
+
+  /** Use a local threader, since this penalty term may be evaluated
+   * from the threads of the combination metric.
+   */
+  typename ThreaderType::Pointer local_threader = ThreaderType::New();
+  local_threader->SetNumberOfWorkUnits(
+    this->m_UseMultiThread ? this->m_Threader->GetNumberOfWorkUnits() : 1 );
+  local_threader->SetSingleMethod( ApplyBandedOperatorThreaderCallback,
+    static_cast< void * >( &this->m_BandedOperatorThreaderParameters ) );
+  local_threader->SingleMethodExecute();
+
+} // end ApplyBandedOperator()
+
+
+/**
+ * ************ ApplyBandedOperatorThreaderCallback ****************************
+ */
+
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ApplyBandedOperatorThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  BandedOperatorThreaderParameterType * temp
+    = static_cast< BandedOperatorThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedApplyBandedOperator(
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ApplyBandedOperatorThreaderCallback()
+
+
+/**
+ * ************ ThreadedApplyBandedOperator ****************************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedApplyBandedOperator( ThreadIdType threadId, ThreadIdType numberOfThreads ) const
+{
+  const BandedOperatorThreaderParameterType & parameters = this->m_BandedOperatorThreaderParameters;
+  const double *             input     = parameters.st_Input;
+  double *                   output    = parameters.st_Output;
+  const unsigned int         dimension = parameters.st_Dimension;
+  const BandedOperatorType & op        = *parameters.st_Operator;
+  const double               weight    = parameters.st_Weight;
+
+  /** The lines along this dimension, in all coefficient images. */
+  SizeValueType stride = 1;
+  for( unsigned int d = 0; d < dimension; ++d )
+  {
+    stride *= this->m_GridSize[ d ];
+  }
+  const SizeValueType n                 = this->m_GridSize[ dimension ];
+  const SizeValueType linesPerImage     = this->m_NumberOfGridPoints / n;
+  const SizeValueType numberOfLines     = FixedImageDimension * linesPerImage;
+  const SizeValueType lineBegin         = numberOfLines * threadId / numberOfThreads;
+  const SizeValueType lineEnd           = numberOfLines * ( threadId + 1 ) / numberOfThreads;
+  const int           bandRadius        = static_cast< int >( BandRadius );
+  const int           bandWidth         = 2 * bandRadius + 1;
+
+  for( SizeValueType line = lineBegin; line < lineEnd; ++line )
+  {
+    /** Get the offset of the first element of this line. */
+    const SizeValueType image  = line / linesPerImage;
+    const SizeValueType inner  = ( line % linesPerImage ) % stride;
+    const SizeValueType outer  = ( line % linesPerImage ) / stride;
+    const SizeValueType offset = image * this->m_NumberOfGridPoints + inner + outer * stride * n;
+
+    const double * in  = input + offset;
+    double *       out = output + offset;
+    for( int p = 0; p < static_cast< int >( n ); ++p )
+    {
+      const int qBegin = std::max( p - bandRadius, 0 );
+      const int qEnd   = std::min( p + bandRadius, static_cast< int >( n ) - 1 );
+      const double * row = &op[ p * bandWidth + bandRadius - p ];
+
+      double sum = 0.0;
+      for( int q = qBegin; q <= qEnd; ++q )
+      {
+        sum += row[ q ] * in[ q * stride ];
+      }
+
+      if( parameters.st_Accumulate )
+      {
+        out[ p * stride ] += weight * sum;
+      }
+      else
+      {
+        out[ p * stride ] = sum;
+      }
+    }
+  }
+
+} // end ThreadedApplyBandedOperator()
+
+
 /**
  * ****************** GetValue *******************************
  */
@@ -54,6 +378,14 @@ typename TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >::MeasureT
 TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
 ::GetValue( const ParametersType & parameters ) const
 {
+  /** Compute the exact bending energy of the B-spline grid. */
+  if( this->m_AnalyticBendingEnergyIsInitialized )
+  {
+    MeasureType value = NumericTraits< MeasureType >::Zero;
+    this->ComputeAnalyticBendingEnergy( parameters, value, nullptr );
+    return value;
+  }
+
   /** Initialize some variables. */
   this->m_NumberOfPixelsCounted = 0;
   RealType           measure = NumericTraits< RealType >::Zero;
@@ -368,6 +700,12 @@ TransformBendingEnergyPenaltyTerm< TFixedImage, TScalarType >
   const ParametersType & parameters,
   MeasureType & value, DerivativeType & derivative ) const
 {
+  /** Compute the exact bending energy of the B-spline grid. */
+  if( this->m_AnalyticBendingEnergyIsInitialized )
+  {
+    return this->ComputeAnalyticBendingEnergy( parameters, value, &derivative );
+  }
+
   /** Option for now to still use the single threaded code. */
   if( !this->m_UseMultiThread )
   {
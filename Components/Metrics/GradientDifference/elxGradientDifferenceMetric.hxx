@@ -77,6 +77,16 @@ void
 GradientDifferenceMetric< TElastix >
 ::BeforeEachResolution( void )
 {
+  /** Get the current resolution level. */
+  unsigned int level
+    = ( this->m_Registration->GetAsITKBaseType() )->GetCurrentLevel();
+
+  /** Set the number of threads for the finite difference derivative. */
+  unsigned int numberOfDerivativeThreads = 1;
+  this->m_Configuration->ReadParameter( numberOfDerivativeThreads,
+    "NumberOfDerivativeThreads", this->GetComponentLabel(), level, 0 );
+  this->SetNumberOfDerivativeThreads( numberOfDerivativeThreads );
+
   typedef typename elastix::OptimizerBase< TElastix >::ITKBaseType::ScalesType ScalesType;
   ScalesType scales = this->m_Elastix->GetElxOptimizerBase()->GetAsITKBaseType()->GetScales();
   this->SetScales( scales );
@@ -40,11 +40,13 @@
 #include "itkNeighborhoodOperatorImageFilter.h"
 #include "itkPoint.h"
 #include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
+#include "itkRayCastResampleImageFilter.h"
 #include "itkOptimizer.h"
 #include "itkAdvancedCombinationTransform.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 
+#include <vector>
+
 namespace itk
 {
 /** \class GradientDifferenceImageToImageMetric
@@ -127,7 +129,7 @@ public:
   typedef typename CombinationTransformType::Pointer CombinationTransformPointer;
   typedef itk::Image< FixedImagePixelType, itkGetStaticConstMacro( FixedImageDimension ) >
     TransformedMovingImageType;
-  typedef itk::ResampleImageFilter< MovingImageType, TransformedMovingImageType >
+  typedef itk::RayCastResampleImageFilter< MovingImageType, TransformedMovingImageType >
     TransformMovingImageFilterType;
   typedef typename itk::AdvancedRayCastInterpolateImageFunction<
     MovingImageType, ScalarType >             RayCastInterpolatorType;
@@ -170,6 +172,15 @@ public:
   itkSetMacro( DerivativeDelta, double );
   itkGetConstReferenceMacro( DerivativeDelta, double );
 
+  /** Set/Get the number of threads over which the evaluations of the finite
+   * difference derivative are distributed. Each thread uses its own copy of
+   * the transform and of the projection and gradient pipeline. 0 uses the
+   * number of work units of the metric. The default 1 computes the
+   * derivative serially.
+   */
+  itkSetMacro( NumberOfDerivativeThreads, ThreadIdType );
+  itkGetConstMacro( NumberOfDerivativeThreads, ThreadIdType );
+
 protected:
 
   GradientDifferenceImageToImageMetric();
@@ -186,11 +197,69 @@ protected:
   MeasureType ComputeMeasure( const TransformParametersType & parameters,
     const double * subtractionFactor ) const;
 
+  /** Generate the projection of the moving image for the given parameters,
+   * unless it was already generated for these parameters. The transform
+   * parameters should have been set before.
+   */
+  void UpdateTransformedMovingImage( const TransformParametersType & parameters ) const;
+
   typedef NeighborhoodOperatorImageFilter<
     FixedGradientImageType, FixedGradientImageType > FixedSobelFilter;
 
   typedef NeighborhoodOperatorImageFilter<
     MovedGradientImageType, MovedGradientImageType > MovedSobelFilter;
+  typedef typename MovedSobelFilter::Pointer MovedSobelFilterPointer;
+
+  /** Compute the range of the gradients of the given moved Sobel filters. */
+  void ComputeMovedGradientRange( const MovedSobelFilterPointer * movedSobelFilters,
+    MovedGradientPixelType * minMovedGradient, MovedGradientPixelType * maxMovedGradient ) const;
+
+  /** Compute the similarity measure from the given moved Sobel filters,
+   * which should be connected to a projection that is up to date. */
+  MeasureType ComputeMeasure( const MovedSobelFilterPointer * movedSobelFilters,
+    const double * subtractionFactor ) const;
+
+  /** Update the given moved Sobel filters and compute the metric value. */
+  MeasureType ComputeValue( const MovedSobelFilterPointer * movedSobelFilters,
+    MovedGradientPixelType * minMovedGradient, MovedGradientPixelType * maxMovedGradient ) const;
+
+  /** A private copy of the projection and gradient pipeline, used by one
+   * thread of the finite difference derivative.
+   */
+  struct FiniteDifferencePipelineType
+  {
+    typename RayCastInterpolatorType::TransformPointer st_Transform;
+    RayCastInterpolatorPointer                         st_RayCaster;
+    typename TransformMovingImageFilterType::Pointer   st_TransformMovingImageFilter;
+    CastMovedImageFilterPointer                        st_CastMovedImageFilter;
+    MovedSobelFilterPointer                            st_MovedSobelFilters[ MovedImageDimension ];
+  };
+
+  /** The parameters of the threads of the finite difference derivative. */
+  struct FiniteDifferenceThreaderParameterType
+  {
+    const Self *                    st_Metric;
+    const TransformParametersType * st_Parameters;
+    std::vector< MeasureType > *    st_Values;
+  };
+
+  typedef typename Superclass::ThreaderType   ThreaderType;
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+
+  /** The number of threads used by GetDerivative(). */
+  ThreadIdType GetNumberOfThreadsForDerivative( void ) const;
+
+  /** Create a private copy of the projection and gradient pipeline. */
+  void InitializeFiniteDifferencePipeline( FiniteDifferencePipelineType & pipeline ) const;
+
+  /** Compute the values of the 2 * P finite difference evaluations multi-threaded. */
+  void ComputeFiniteDifferenceValues( const TransformParametersType & parameters,
+    std::vector< MeasureType > & values, const ThreadIdType numberOfThreads ) const;
+
+  /** The callback and the threaded part of ComputeFiniteDifferenceValues(). */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION FiniteDifferenceThreaderCallback( void * arg );
+
+  void ThreadedComputeFiniteDifferenceValues( ThreadIdType threadId, ThreadIdType numberOfThreads ) const;
 
 private:
 
@@ -211,6 +280,15 @@ private:
   /** The filter for transforming the moving image. */
   typename TransformMovingImageFilterType::Pointer m_TransformMovingImageFilter;
 
+  /** The parameters of the last generated projection. */
+  mutable TransformParametersType m_TransformedMovingImageParameters;
+  mutable bool                    m_TransformedMovingImageIsValid;
+
+  /** The state of the multi-threaded finite difference derivative. */
+  ThreadIdType                                        m_NumberOfDerivativeThreads;
+  mutable std::vector< FiniteDifferencePipelineType > m_FiniteDifferencePipelines;
+  mutable FiniteDifferenceThreaderParameterType       m_FiniteDifferenceThreaderParameters;
+
   /** The Sobel gradients of the fixed image */
   CastFixedImageFilterPointer m_CastFixedImageFilter;
 
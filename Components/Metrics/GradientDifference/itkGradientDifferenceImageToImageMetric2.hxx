@@ -40,6 +40,7 @@
 #include "itkRescaleIntensityImageFilter.h"
 #include "itkImageFileWriter.h"
 
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <stdio.h>
@@ -62,6 +63,8 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
   this->m_CastFixedImageFilter       = CastFixedImageFilterType::New();
   this->m_CombinationTransform       = CombinationTransformType::New();
   this->m_TransformMovingImageFilter = TransformMovingImageFilterType::New();
+  this->m_TransformedMovingImageIsValid = false;
+  this->m_NumberOfDerivativeThreads     = 1;
 
   for( iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
   {
@@ -131,6 +134,8 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
   this->m_TransformMovingImageFilter->SetOutputSpacing( this->m_FixedImage->GetSpacing() );
   this->m_TransformMovingImageFilter->SetOutputDirection( this->m_FixedImage->GetDirection() );
   this->m_TransformMovingImageFilter->Update();
+  this->m_TransformedMovingImageIsValid = false;
+  this->m_FiniteDifferencePipelines.clear();
 
   this->m_CastMovedImageFilter->SetInput(
     this->m_TransformMovingImageFilter->GetOutput() );
@@ -183,6 +188,22 @@ template< class TFixedImage, class TMovingImage >
 void
 GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 ::ComputeMovedGradientRange( void ) const
+{
+  this->ComputeMovedGradientRange( this->m_MovedSobelFilters,
+    this->m_MinMovedGradient, this->m_MaxMovedGradient );
+
+} // end ComputeMovedGradientRange()
+
+
+/**
+ * ******************** ComputeMovedGradientRange ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMovedGradientRange( const MovedSobelFilterPointer * movedSobelFilters,
+  MovedGradientPixelType * minMovedGradient, MovedGradientPixelType * maxMovedGradient ) const
 {
   unsigned int           iDimension;
   MovedGradientPixelType gradient;
@@ -192,26 +213,26 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
     typedef itk::ImageRegionConstIteratorWithIndex<
       MovedGradientImageType > IteratorType;
 
-    IteratorType iterate( m_MovedSobelFilters[ iDimension ]->GetOutput(),
+    IteratorType iterate( movedSobelFilters[ iDimension ]->GetOutput(),
     this->GetFixedImageRegion() );
 
     gradient = iterate.Get();
 
-    m_MinMovedGradient[ iDimension ] = gradient;
-    m_MaxMovedGradient[ iDimension ] = gradient;
+    minMovedGradient[ iDimension ] = gradient;
+    maxMovedGradient[ iDimension ] = gradient;
 
     while( !iterate.IsAtEnd() )
     {
       gradient = iterate.Get();
 
-      if( gradient > m_MaxMovedGradient[ iDimension ] )
+      if( gradient > maxMovedGradient[ iDimension ] )
       {
-        m_MaxMovedGradient[ iDimension ] = gradient;
+        maxMovedGradient[ iDimension ] = gradient;
       }
 
-      if( gradient < m_MinMovedGradient[ iDimension ] )
+      if( gradient < minMovedGradient[ iDimension ] )
       {
-        m_MinMovedGradient[ iDimension ] = gradient;
+        minMovedGradient[ iDimension ] = gradient;
       }
 
       ++iterate;
@@ -343,6 +364,33 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 } // end ComputeVariance()
 
 
+/**
+ * ******************** UpdateTransformedMovingImage ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateTransformedMovingImage( const TransformParametersType & parameters ) const
+{
+  /** The projection only depends on the transform parameters, so it is
+   * only regenerated when they differ from those of the last projection.
+   * The filter is modified explicitly, because the MTime of the transform
+   * of the ray caster does not change with the parameters.
+   */
+  if( this->m_TransformedMovingImageIsValid && this->m_TransformedMovingImageParameters == parameters )
+  {
+    return;
+  }
+
+  this->m_TransformMovingImageFilter->Modified();
+  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+  this->m_TransformedMovingImageParameters = parameters;
+  this->m_TransformedMovingImageIsValid    = true;
+
+} // end UpdateTransformedMovingImage()
+
+
 /**
  * ******************** ComputeMeasure ******************************
  */
@@ -369,10 +417,30 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
   this->BeforeThreadedGetValueAndDerivative( parameters );
   //this->SetTransformParameters( parameters );
 
+  this->UpdateTransformedMovingImage( parameters );
+
+  for( unsigned int iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
+  {
+    this->m_FixedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+  }
+
+  return this->ComputeMeasure( this->m_MovedSobelFilters, subtractionFactor );
+
+} // end ComputeMeasure()
+
+
+/**
+ * ******************** ComputeMeasure ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeMeasure( const MovedSobelFilterPointer * movedSobelFilters,
+  const double * subtractionFactor ) const
+{
   unsigned int iDimension;
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
-  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  MeasureType  measure = NumericTraits< MeasureType >::Zero;
 
   typename FixedImageType::IndexType currentIndex;
   typename FixedImageType::PointType point;
@@ -402,11 +470,10 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
     typedef  itk::ImageRegionConstIteratorWithIndex< MovedGradientImageType >
       MovedIteratorType;
 
-    MovedIteratorType movedIterator( this->m_MovedSobelFilters[ iDimension ]->GetOutput(),
+    MovedIteratorType movedIterator( movedSobelFilters[ iDimension ]->GetOutput(),
     this->GetFixedImageRegion() );
 
-    this->m_FixedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
-    this->m_MovedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+    movedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
 
     bool sampleOK = false;
 
@@ -456,28 +523,26 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 
 
 /**
- * ******************** GetValue ******************************
+ * ******************** ComputeValue ******************************
  */
 
 template< class TFixedImage, class TMovingImage >
 typename GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
 GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
-::GetValue( const TransformParametersType & parameters ) const
+::ComputeValue( const MovedSobelFilterPointer * movedSobelFilters,
+  MovedGradientPixelType * minMovedGradient, MovedGradientPixelType * maxMovedGradient ) const
 {
   unsigned int iFilter;
   unsigned int iDimension;
-  this->SetTransformParameters( parameters );
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
 
   /** Update the gradient images */
   for( iFilter = 0; iFilter < MovedImageDimension; iFilter++ )
   {
-    this->m_MovedSobelFilters[ iFilter ]->UpdateLargestPossibleRegion();
+    movedSobelFilters[ iFilter ]->UpdateLargestPossibleRegion();
   }
 
   /** Compute the range of the moved image gradients */
-  this->ComputeMovedGradientRange();
+  this->ComputeMovedGradientRange( movedSobelFilters, minMovedGradient, maxMovedGradient );
 
   MovedGradientPixelType subtractionFactor[ FixedImageDimension ];
   MeasureType            currentMeasure;
@@ -485,13 +550,36 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
   for( iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
   {
     subtractionFactor[ iDimension ] = this->m_MaxFixedGradient[ iDimension ]
-      / this->m_MaxMovedGradient[ iDimension ];
+      / maxMovedGradient[ iDimension ];
   }
 
-  currentMeasure = this->ComputeMeasure( parameters, subtractionFactor );
+  currentMeasure = this->ComputeMeasure( movedSobelFilters, subtractionFactor );
 
   return currentMeasure;
 
+} // end ComputeValue()
+
+
+/**
+ * ******************** GetValue ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::GetValue( const TransformParametersType & parameters ) const
+{
+  this->SetTransformParameters( parameters );
+  this->UpdateTransformedMovingImage( parameters );
+
+  for( unsigned int iDimension = 0; iDimension < FixedImageDimension; iDimension++ )
+  {
+    this->m_FixedSobelFilters[ iDimension ]->UpdateLargestPossibleRegion();
+  }
+
+  return this->ComputeValue( this->m_MovedSobelFilters,
+    this->m_MinMovedGradient, this->m_MaxMovedGradient );
+
 } // end GetValue()
 
 
@@ -505,11 +593,28 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 ::GetDerivative( const TransformParametersType & parameters,
   DerivativeType & derivative ) const
 {
-  TransformParametersType testPoint;
-  testPoint = parameters;
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
   derivative = DerivativeType( numberOfParameters );
 
+  /** The 2 * P evaluations of the central differences are independent, so
+   * they are distributed over threads, each with its own copy of the
+   * projection and gradient pipeline.
+   */
+  const ThreadIdType numberOfThreads = this->GetNumberOfThreadsForDerivative();
+  if( numberOfThreads > 1 )
+  {
+    std::vector< MeasureType > values( 2 * numberOfParameters );
+    this->ComputeFiniteDifferenceValues( parameters, values, numberOfThreads );
+    for( unsigned int i = 0; i < numberOfParameters; i++ )
+    {
+      derivative[ i ] = ( values[ 2 * i + 1 ] - values[ 2 * i ] )
+        / ( 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] ) );
+    }
+    return;
+  }
+
+  TransformParametersType testPoint;
+  testPoint = parameters;
   for( unsigned int i = 0; i < numberOfParameters; i++ )
   {
     testPoint[ i ] -= this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
@@ -523,6 +628,185 @@ GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetDerivative()
 
 
+/**
+ * ******************** GetNumberOfThreadsForDerivative ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ThreadIdType
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::GetNumberOfThreadsForDerivative( void ) const
+{
+  ThreadIdType numberOfThreads = this->m_NumberOfDerivativeThreads;
+  if( numberOfThreads == 0 )
+  {
+    numberOfThreads = this->m_UseMultiThread ? this->m_Threader->GetNumberOfWorkUnits() : 1;
+  }
+
+  /** There are no more than 2 * P evaluations to distribute. */
+  return std::min< ThreadIdType >( numberOfThreads, 2 * this->GetNumberOfParameters() );
+
+} // end GetNumberOfThreadsForDerivative()
+
+
+/**
+ * ******************** InitializeFiniteDifferencePipeline ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeFiniteDifferencePipeline( FiniteDifferencePipelineType & pipeline ) const
+{
+  const RayCastInterpolatorType * rayCaster
+    = dynamic_cast< const RayCastInterpolatorType * >( this->m_Interpolator.GetPointer() );
+
+  /** The transform of the ray caster is cloned, so that its parameters can
+   * be set independently.
+   */
+  pipeline.st_Transform = rayCaster->GetTransform()->Clone();
+
+  pipeline.st_RayCaster = RayCastInterpolatorType::New();
+  pipeline.st_RayCaster->SetTransform( pipeline.st_Transform );
+  pipeline.st_RayCaster->SetFocalPoint( rayCaster->GetFocalPoint() );
+  pipeline.st_RayCaster->SetThreshold( rayCaster->GetThreshold() );
+
+  /** The moving image is grafted into an image without a source, so that
+   * the threads do not update a shared upstream pipeline.
+   */
+  typename MovingImageType::Pointer movingImage = MovingImageType::New();
+  movingImage->Graft( this->m_MovingImage );
+
+  /** The threads already run in parallel, so each filter uses one work unit. */
+  pipeline.st_TransformMovingImageFilter = TransformMovingImageFilterType::New();
+  pipeline.st_TransformMovingImageFilter->SetNumberOfWorkUnits( 1 );
+  pipeline.st_TransformMovingImageFilter->SetTransform( pipeline.st_Transform );
+  pipeline.st_TransformMovingImageFilter->SetInterpolator( pipeline.st_RayCaster );
+  pipeline.st_TransformMovingImageFilter->SetInput( movingImage );
+  pipeline.st_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
+  pipeline.st_TransformMovingImageFilter->SetSize( this->m_FixedImage->GetLargestPossibleRegion().GetSize() );
+  pipeline.st_TransformMovingImageFilter->SetOutputOrigin( this->m_FixedImage->GetOrigin() );
+  pipeline.st_TransformMovingImageFilter->SetOutputSpacing( this->m_FixedImage->GetSpacing() );
+  pipeline.st_TransformMovingImageFilter->SetOutputDirection( this->m_FixedImage->GetDirection() );
+
+  pipeline.st_CastMovedImageFilter = CastMovedImageFilterType::New();
+  pipeline.st_CastMovedImageFilter->SetNumberOfWorkUnits( 1 );
+  pipeline.st_CastMovedImageFilter->SetInput(
+    pipeline.st_TransformMovingImageFilter->GetOutput() );
+
+  /** The boundary condition has no state, so it is shared by all filters. */
+  ZeroFluxNeumannBoundaryCondition< MovedGradientImageType > * movedBoundaryCondition
+    = const_cast< ZeroFluxNeumannBoundaryCondition< MovedGradientImageType > * >( &this->m_MovedBoundCond );
+
+  for( unsigned int iFilter = 0; iFilter < MovedImageDimension; iFilter++ )
+  {
+    pipeline.st_MovedSobelFilters[ iFilter ] = MovedSobelFilter::New();
+    pipeline.st_MovedSobelFilters[ iFilter ]->SetNumberOfWorkUnits( 1 );
+    pipeline.st_MovedSobelFilters[ iFilter ]->OverrideBoundaryCondition( movedBoundaryCondition );
+    pipeline.st_MovedSobelFilters[ iFilter ]->SetOperator( this->m_MovedSobelOperators[ iFilter ] );
+    pipeline.st_MovedSobelFilters[ iFilter ]->SetInput( pipeline.st_CastMovedImageFilter->GetOutput() );
+  }
+
+} // end InitializeFiniteDifferencePipeline()
+
+
+/**
+ * ******************** ComputeFiniteDifferenceValues ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeFiniteDifferenceValues( const TransformParametersType & parameters,
+  std::vector< MeasureType > & values, const ThreadIdType numberOfThreads ) const
+{
+  /** The pipelines are kept until the next Initialize(), since cloning the
+   * transform and allocating the images is not for free.
+   */
+  if( this->m_FiniteDifferencePipelines.size() < numberOfThreads )
+  {
+    const std::size_t first = this->m_FiniteDifferencePipelines.size();
+    this->m_FiniteDifferencePipelines.resize( numberOfThreads );
+    for( std::size_t i = first; i < numberOfThreads; ++i )
+    {
+      this->InitializeFiniteDifferencePipeline( this->m_FiniteDifferencePipelines[ i ] );
+    }
+  }
+
+  this->m_FiniteDifferenceThreaderParameters.st_Metric     = this;
+  this->m_FiniteDifferenceThreaderParameters.st_Parameters = &parameters;
+  this->m_FiniteDifferenceThreaderParameters.st_Values     = &values;
+
+  typename ThreaderType::Pointer local_threader = ThreaderType::New();
+  local_threader->SetNumberOfWorkUnits( numberOfThreads );
+  local_threader->SetSingleMethod( FiniteDifferenceThreaderCallback,
+    static_cast< void * >( &this->m_FiniteDifferenceThreaderParameters ) );
+  local_threader->SingleMethodExecute();
+
+} // end ComputeFiniteDifferenceValues()
+
+
+/**
+ * ******************** FiniteDifferenceThreaderCallback ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::FiniteDifferenceThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  FiniteDifferenceThreaderParameterType * temp
+    = static_cast< FiniteDifferenceThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedComputeFiniteDifferenceValues(
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end FiniteDifferenceThreaderCallback()
+
+
+/**
+ * ******************** ThreadedComputeFiniteDifferenceValues ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+GradientDifferenceImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeFiniteDifferenceValues( ThreadIdType threadId, ThreadIdType numberOfThreads ) const
+{
+  const TransformParametersType & parameters = *this->m_FiniteDifferenceThreaderParameters.st_Parameters;
+  std::vector< MeasureType > &    values     = *this->m_FiniteDifferenceThreaderParameters.st_Values;
+  FiniteDifferencePipelineType &  pipeline   = this->m_FiniteDifferencePipelines[ threadId ];
+
+  /** Evaluation 2 * i is parameter i minus delta, 2 * i + 1 is plus delta.
+   * The test points are computed as in the single-threaded GetDerivative().
+   */
+  MovedGradientPixelType  minMovedGradient[ MovedImageDimension ];
+  MovedGradientPixelType  maxMovedGradient[ MovedImageDimension ];
+  TransformParametersType testPoint = parameters;
+  for( std::size_t evaluation = threadId; evaluation < values.size(); evaluation += numberOfThreads )
+  {
+    const unsigned int i     = static_cast< unsigned int >( evaluation / 2 );
+    const double       delta = this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
+    testPoint[ i ] -= delta;
+    if( evaluation % 2 == 1 )
+    {
+      testPoint[ i ] += 2 * delta;
+    }
+
+    pipeline.st_Transform->SetParameters( testPoint );
+    pipeline.st_TransformMovingImageFilter->Modified();
+    values[ evaluation ] = this->ComputeValue(
+      pipeline.st_MovedSobelFilters, minMovedGradient, maxMovedGradient );
+
+    testPoint[ i ] = parameters[ i ];
+  }
+
+} // end ThreadedComputeFiniteDifferenceValues()
+
+
 /**
  * ******************** GetValueAndDerivative ******************************
  */
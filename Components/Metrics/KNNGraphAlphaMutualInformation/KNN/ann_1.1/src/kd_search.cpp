@@ -74,13 +74,16 @@
 //		To keep argument lists short, a number of global variables
 //		are maintained which are common to all the recursive calls.
 //		These are given below.
+//
+//		They are thread_local, so that different threads may search
+//		(the same or different) trees simultaneously.
 //----------------------------------------------------------------------
 
-int				ANNkdDim;				// dimension of space
-ANNpoint		ANNkdQ;					// query point
-double			ANNkdMaxErr;			// max tolerable squared error
-ANNpointArray	ANNkdPts;				// the points
-ANNmin_k		*ANNkdPointMK;			// set of k closest points
+thread_local int			ANNkdDim;		// dimension of space
+thread_local ANNpoint		ANNkdQ;			// query point
+thread_local double			ANNkdMaxErr;	// max tolerable squared error
+thread_local ANNpointArray	ANNkdPts;		// the points
+thread_local ANNmin_k		*ANNkdPointMK;	// set of k closest points
 
 //----------------------------------------------------------------------
 //	annkSearch - search for the k nearest neighbors
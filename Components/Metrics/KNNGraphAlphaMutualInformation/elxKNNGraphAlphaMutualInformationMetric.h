@@ -70,6 +70,13 @@ namespace elastix
  * \parameter AvoidDivisionBy: a small number to avoid division by zero in the implentation. \n
  *    <tt>(AvoidDivisionBy 0.000000001)</tt> \n
  *    The default is 1e-5.
+ * \parameter ReuseFixedTree: reuse the kNN tree of the fixed samples in the next iteration
+ *    when the set of valid samples did not change, instead of regenerating it. \n
+ *    <tt>(ReuseFixedTree "false")</tt> \n
+ *    The default is "true". The result is identical in both cases.
+ *
+ * With <tt>(UseMultiThreadingForMetrics "true")</tt> (the default) the trees are
+ * generated concurrently and the nearest neighbour searches are multi-threaded.
  *
  * \warning Note that we assume the FixedFeatureImageType to have the same
  * pixeltype as the FixedImageType
@@ -67,6 +67,14 @@ namespace itk
  * IEEE Transactions on Medical Imaging, vol. 28, no. 9, pp. 1412 - 1421,
  * September 2009.
  *
+ * When multi-threading is enabled (SetUseMultiThread), the three trees are
+ * generated concurrently and the k-nearest neighbour queries are distributed
+ * over the threads. The ANN search routines keep their state in thread local
+ * storage, so that a single tree can be searched from multiple threads.
+ * Since the fixed feature values do not depend on the transformation, the
+ * tree of the fixed samples is only regenerated when the set of valid
+ * samples changes (see SetReuseFixedTree).
+ *
  * \ingroup RegistrationMetrics
  */
 
@@ -247,6 +255,15 @@ public:
   /** Avoid division by a small number. */
   itkGetConstReferenceMacro( AvoidDivisionBy, double );
 
+  /** Reuse the tree of the fixed samples when these did not change since the
+   * previous call. The fixed feature values are independent of the transform
+   * parameters; only the subset of samples that map inside the moving image
+   * may change. In that case the fixed tree is regenerated. Default: true.
+   */
+  itkSetMacro( ReuseFixedTree, bool );
+  itkGetConstReferenceMacro( ReuseFixedTree, bool );
+  itkBooleanMacro( ReuseFixedTree );
+
 protected:
 
   /** Constructor. */
@@ -269,6 +286,7 @@ protected:
 
   double m_Alpha;
   double m_AvoidDivisionBy;
+  bool   m_ReuseFixedTree;
 
 private:
 
@@ -280,11 +298,12 @@ private:
   typedef typename Superclass::MovingImagePointType           MovingImagePointType;
   typedef typename Superclass::MovingImageDerivativeType      MovingImageDerivativeType;
   typedef typename Superclass::MovingImageContinuousIndexType MovingImageContinuousIndexType;
-  typedef std::vector< TransformJacobianType >                TransformJacobianContainerType;
+  typedef typename Superclass::ThreadInfoType                 ThreadInfoType;
   //typedef std::vector<ParameterIndexArrayType>           TransformJacobianIndicesContainerType;
   typedef std::vector< NonZeroJacobianIndicesType > TransformJacobianIndicesContainerType;
   typedef Array2D< double >                         SpatialDerivativeType;
   typedef std::vector< SpatialDerivativeType >      SpatialDerivativeContainerType;
+  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
 
   /** This function takes the fixed image samples from the ImageSampler
    * and puts them in the listSampleFixed, together with the fixed feature
@@ -294,17 +313,86 @@ private:
    * If desired, i.e. if doDerivative is true, then also things needed to
    * compute the derivative of the cost function to the transform parameters
    * are computed:
-   * - The sparse Jacobian of the transformation (dT/dmu).
-   * - The spatial derivatives of the moving (feature) images (dm/dx).
+   * - The sparse image Jacobian dm/dx * dT/dmu, i.e. the product of the
+   *   spatial derivatives of the moving (feature) images and the sparse
+   *   Jacobian of the transformation. Storing the product instead of both
+   *   factors avoids recomputing it for every neighbour a sample has.
+   * - The corresponding nonzero Jacobian indices.
    */
   virtual void ComputeListSampleValuesAndDerivativePlusJacobian(
     const ListSamplePointer & listSampleFixed,
     const ListSamplePointer & listSampleMoving,
     const ListSamplePointer & listSampleJoint,
     const bool & doDerivative,
-    TransformJacobianContainerType & jacobians,
-    TransformJacobianIndicesContainerType & jacobiansIndices,
-    SpatialDerivativeContainerType & spatialDerivatives ) const;
+    SpatialDerivativeContainerType & imageJacobians,
+    TransformJacobianIndicesContainerType & jacobiansIndices ) const;
+
+  /** Generate the three trees from the list samples and connect them to the
+   * searchers. The trees are generated concurrently if multi-threading is
+   * enabled. The fixed tree is possibly reused, see SetReuseFixedTree.
+   */
+  virtual void GenerateTrees(
+    const ListSamplePointer & listSampleFixed,
+    const ListSamplePointer & listSampleMoving,
+    const ListSamplePointer & listSampleJoint ) const;
+
+  /** Check if the current fixed tree was generated from exactly the
+   * samples in listSampleFixed.
+   */
+  virtual bool FixedTreeIsUpToDate( const ListSamplePointer & listSampleFixed ) const;
+
+  /** Search the neighbours of the query points [ begin, end [ and add their
+   * contribution to the graph length ratio sumG.
+   */
+  virtual void ComputeGraphLengths(
+    const ListSampleType * listSampleFixed,
+    const ListSampleType * listSampleMoving,
+    const ListSampleType * listSampleJoint,
+    const unsigned long begin, const unsigned long end,
+    AccumulateType & sumG ) const;
+
+  /** Search the neighbours of the query points [ begin, end [ and add their
+   * contribution to the graph length ratio sumG and to its (unnormalized)
+   * derivative.
+   */
+  virtual void ComputeGraphLengthsAndDerivatives(
+    const ListSampleType * listSampleFixed,
+    const ListSampleType * listSampleMoving,
+    const ListSampleType * listSampleJoint,
+    const SpatialDerivativeContainerType & imageJacobians,
+    const TransformJacobianIndicesContainerType & jacobiansIndices,
+    const unsigned long begin, const unsigned long end,
+    AccumulateType & sumG, DerivativeType & contribution ) const;
+
+  /** Helper struct that gives the threads access to the list samples and
+   * the image Jacobians of the current iteration.
+   */
+  struct KNNGraphMultiThreaderParameterType
+  {
+    Self *                                        m_Metric;
+    ListSampleType *                              st_ListSampleFixed;
+    ListSampleType *                              st_ListSampleMoving;
+    ListSampleType *                              st_ListSampleJoint;
+    const SpatialDerivativeContainerType *        st_ImageJacobians;
+    const TransformJacobianIndicesContainerType * st_JacobiansIndices;
+    bool                                          st_GenerateFixedTree;
+  };
+  mutable KNNGraphMultiThreaderParameterType m_KNNGraphThreaderParameters;
+
+  /** Multi-threaded k-NN queries for GetValue(). */
+  void ThreadedGetValue( ThreadIdType threadId ) override;
+
+  /** Multi-threaded k-NN queries for GetValueAndDerivative(). */
+  void ThreadedGetValueAndDerivative( ThreadIdType threadId ) override;
+
+  /** Generate the trees assigned to this thread. */
+  inline void ThreadedGenerateTrees( ThreadIdType threadId );
+
+  /** Helper function to launch the threads. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION GenerateTreesThreaderCallback( void * arg );
+
+  /** Helper function to launch the threads. */
+  void LaunchGenerateTreesThreaderCallback( void ) const;
 
   /** This function calculates the spatial derivative of the
    * featureNr feature image at the point mappedPoint.
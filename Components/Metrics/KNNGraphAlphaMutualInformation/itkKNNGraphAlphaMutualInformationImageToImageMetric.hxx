@@ -20,6 +20,8 @@
 
 #include "itkKNNGraphAlphaMutualInformationImageToImageMetric.h"
 
+#include <algorithm> // std::equal
+
 namespace itk
 {
 
@@ -35,6 +37,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->SetUseImageSampler( true );
   this->m_Alpha           = 0.99;
   this->m_AvoidDivisionBy = 1e-10;
+  this->m_ReuseFixedTree  = true;
 
   this->m_BinaryKNNTreeFixed  = nullptr;
   this->m_BinaryKNNTreeMoving = nullptr;
@@ -44,6 +47,15 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   this->m_BinaryKNNTreeSearcherMoving = nullptr;
   this->m_BinaryKNNTreeSearcherJoint  = nullptr;
 
+  /** Initialize the m_KNNGraphThreaderParameters. */
+  this->m_KNNGraphThreaderParameters.m_Metric             = this;
+  this->m_KNNGraphThreaderParameters.st_ListSampleFixed   = nullptr;
+  this->m_KNNGraphThreaderParameters.st_ListSampleMoving  = nullptr;
+  this->m_KNNGraphThreaderParameters.st_ListSampleJoint   = nullptr;
+  this->m_KNNGraphThreaderParameters.st_ImageJacobians    = nullptr;
+  this->m_KNNGraphThreaderParameters.st_JacobiansIndices  = nullptr;
+  this->m_KNNGraphThreaderParameters.st_GenerateFixedTree = true;
+
 } // end Constructor()
 
 
@@ -317,13 +329,11 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   ListSamplePointer listSampleJoint  = ListSampleType::New();
 
   /** Compute the three list samples. */
-  TransformJacobianContainerType        dummyJacobianContainer;
+  SpatialDerivativeContainerType        dummyImageJacobianContainer;
   TransformJacobianIndicesContainerType dummyJacobianIndicesContainer;
-  SpatialDerivativeContainerType        dummySpatialDerivativesContainer;
   this->ComputeListSampleValuesAndDerivativePlusJacobian(
     listSampleFixed, listSampleMoving, listSampleJoint,
-    false, dummyJacobianContainer, dummyJacobianIndicesContainer,
-    dummySpatialDerivativesContainer );
+    false, dummyImageJacobianContainer, dummyJacobianIndicesContainer );
 
   /** Check if enough samples were valid. */
   unsigned long size = this->GetImageSampler()->GetOutput()->Size();
@@ -336,25 +346,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
-  this->m_BinaryKNNTreeSearcherMoving
-  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
-  this->m_BinaryKNNTreeSearcherJoint
-  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+  this->GenerateTrees( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /**
    * *************** Estimate the \alpha MI ******************
@@ -389,77 +381,34 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
-  /** Temporary variables. */
-  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
-  MeasurementVectorType z_F, z_M, z_J;
-  IndexArrayType        indices_F, indices_M, indices_J;
-  DistanceArrayType     distances_F, distances_M, distances_J;
-
-  MeasureType    H, G;
+  /** Search the neighbours of all query points, i.e. all samples. */
   AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
-
-  /** Get the size of the feature vectors. */
-  unsigned int fixedSize  = this->GetNumberOfFixedImages();
-  unsigned int movingSize = this->GetNumberOfMovingImages();
-  unsigned int jointSize  = fixedSize + movingSize;
-
-  /** Get the number of neighbours and \gamma. */
-  unsigned int k        = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
-  double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
-
-  /** Loop over all query points, i.e. all samples. */
-  for( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
+  if( !this->m_UseMultiThread )
   {
-    /** Get the i-th query point. */
-    listSampleFixed->GetMeasurementVector(  i, z_F );
-    listSampleMoving->GetMeasurementVector( i, z_M );
-    listSampleJoint->GetMeasurementVector(  i, z_J );
-
-    /** Search for the K nearest neighbours of the current query point. */
-    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
-    this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
-    this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
-
-    /** Add the distances between the points to get the total graph length.
-     * The outcommented implementation calculates: sum J/sqrt(F*M)
-     *
-    for ( unsigned int j = 0; j < K; j++ )
-    {
-    enumerator = std::sqrt( distsJ[ j ] );
-    denominator = std::sqrt( std::sqrt( distsF[ j ] ) * std::sqrt( distsM[ j ] ) );
-    if ( denominator > 1e-14 )
-    {
-    contribution += std::pow( enumerator / denominator, twoGamma );
-    }
-    }*/
-
-    /** Add the distances of all neighbours of the query point,
-    * for the three graphs:
-    * sum M / sqrt( sum F * sum M)
-    */
+    this->ComputeGraphLengths(
+      listSampleFixed.GetPointer(), listSampleMoving.GetPointer(), listSampleJoint.GetPointer(),
+      0, this->m_NumberOfPixelsCounted, sumG );
+  }
+  else
+  {
+    /** Give the threads access to the list samples. */
+    this->m_KNNGraphThreaderParameters.st_ListSampleFixed  = listSampleFixed.GetPointer();
+    this->m_KNNGraphThreaderParameters.st_ListSampleMoving = listSampleMoving.GetPointer();
+    this->m_KNNGraphThreaderParameters.st_ListSampleJoint  = listSampleJoint.GetPointer();
 
-    /** Variables to compute the measure. */
-    AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
-    AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
+    /** Launch the threads. */
+    this->LaunchGetValueThreaderCallback();
 
-    /** Loop over the neighbours. */
-    for( unsigned int p = 0; p < k; p++ )
+    /** Accumulate the partial sums in a fixed order. */
+    const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
     {
-      Gamma_F += std::sqrt( distances_F[ p ] );
-      Gamma_M += std::sqrt( distances_M[ p ] );
-      Gamma_J += std::sqrt( distances_J[ p ] );
-    } // end loop over the k neighbours
+      sumG += this->m_GetValuePerThreadVariables[ i ].st_Value;
 
-    /** Calculate the contribution of this query point. */
-    H = std::sqrt( Gamma_F * Gamma_M );
-    if( H > this->m_AvoidDivisionBy )
-    {
-      /** Compute some sums. */
-      G     = Gamma_J / H;
-      sumG += std::pow( G, twoGamma );
+      /** Reset this variable for the next iteration. */
+      this->m_GetValuePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
     }
-  } // end looping over all query points
+  }
 
   /**
    * *************** Finally, calculate the metric value \alpha MI ******************
@@ -544,12 +493,11 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   ListSamplePointer listSampleJoint  = ListSampleType::New();
 
   /** Compute the three list samples and the derivatives. */
-  TransformJacobianContainerType        jacobianContainer;
+  SpatialDerivativeContainerType        imageJacobianContainer;
   TransformJacobianIndicesContainerType jacobianIndicesContainer;
-  SpatialDerivativeContainerType        spatialDerivativesContainer;
   this->ComputeListSampleValuesAndDerivativePlusJacobian(
     listSampleFixed, listSampleMoving, listSampleJoint,
-    true, jacobianContainer, jacobianIndicesContainer, spatialDerivativesContainer );
+    true, imageJacobianContainer, jacobianIndicesContainer );
 
   /** Check if enough samples were valid. */
   unsigned long size = this->GetImageSampler()->GetOutput()->Size();
@@ -561,25 +509,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * and connect them to the searchers.
    */
 
-  /** Generate the tree for the fixed image samples. */
-  this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
-  this->m_BinaryKNNTreeFixed->GenerateTree();
-
-  /** Generate the tree for the moving image samples. */
-  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
-  this->m_BinaryKNNTreeMoving->GenerateTree();
-
-  /** Generate the tree for the joint image samples. */
-  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
-  this->m_BinaryKNNTreeJoint->GenerateTree();
-
-  /** Initialize tree searchers. */
-  this->m_BinaryKNNTreeSearcherFixed
-  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
-  this->m_BinaryKNNTreeSearcherMoving
-  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
-  this->m_BinaryKNNTreeSearcherJoint
-  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+  this->GenerateTrees( listSampleFixed, listSampleMoving, listSampleJoint );
 
   /**
    * *************** Estimate the \alpha MI and its derivatives ******************
@@ -614,18 +544,300 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
    * where d1 and d2 are the possibly different dimensions of the two feature sets.
    */
 
+  /** Search the neighbours of all query points, i.e. all samples. */
+  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
+  if( !this->m_UseMultiThread )
+  {
+    DerivativeType contribution( this->GetNumberOfParameters() );
+    contribution.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+    this->ComputeGraphLengthsAndDerivatives(
+      listSampleFixed.GetPointer(), listSampleMoving.GetPointer(), listSampleJoint.GetPointer(),
+      imageJacobianContainer, jacobianIndicesContainer,
+      0, this->m_NumberOfPixelsCounted, sumG, contribution );
+
+    if( sumG > this->m_AvoidDivisionBy )
+    {
+      /** Compute the derivative (-2.0 * d = -jointSize). */
+      const unsigned int jointSize = this->GetNumberOfFixedImages() + this->GetNumberOfMovingImages();
+      derivative = ( static_cast< AccumulateType >( jointSize ) / sumG ) * contribution;
+    }
+  }
+  else
+  {
+    /** Give the threads access to the list samples and image Jacobians. */
+    this->m_KNNGraphThreaderParameters.st_ListSampleFixed  = listSampleFixed.GetPointer();
+    this->m_KNNGraphThreaderParameters.st_ListSampleMoving = listSampleMoving.GetPointer();
+    this->m_KNNGraphThreaderParameters.st_ListSampleJoint  = listSampleJoint.GetPointer();
+    this->m_KNNGraphThreaderParameters.st_ImageJacobians   = &imageJacobianContainer;
+    this->m_KNNGraphThreaderParameters.st_JacobiansIndices = &jacobianIndicesContainer;
+
+    /** Launch the threads. */
+    this->LaunchGetValueAndDerivativeThreaderCallback();
+
+    /** The containers are local to this function. */
+    this->m_KNNGraphThreaderParameters.st_ImageJacobians   = nullptr;
+    this->m_KNNGraphThreaderParameters.st_JacobiansIndices = nullptr;
+
+    /** Accumulate the partial sums in a fixed order. */
+    const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+    for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+    {
+      sumG += this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value;
+
+      /** Reset this variable for the next iteration. */
+      this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Value = NumericTraits< MeasureType >::Zero;
+    }
+
+    /** Accumulate the derivatives multi-threadedly, which also resets them.
+     * derivative = ( jointSize / sumG ) * contribution.
+     */
+    if( sumG > this->m_AvoidDivisionBy )
+    {
+      const unsigned int jointSize = this->GetNumberOfFixedImages() + this->GetNumberOfMovingImages();
+      this->m_ThreaderMetricParameters.st_DerivativePointer   = derivative.begin();
+      this->m_ThreaderMetricParameters.st_NormalizationFactor = sumG / static_cast< AccumulateType >( jointSize );
+
+      this->m_Threader->SetSingleMethod( this->AccumulateDerivativesThreaderCallback,
+        const_cast< void * >( static_cast< const void * >( &this->m_ThreaderMetricParameters ) ) );
+      this->m_Threader->SingleMethodExecute();
+    }
+    else
+    {
+      for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+      {
+        this->m_GetValueAndDerivativePerThreadVariables[ i ].st_Derivative.Fill(
+          NumericTraits< DerivativeValueType >::ZeroValue() );
+      }
+    }
+  }
+
+  /**
+   * *************** Finally, calculate the metric value and derivative ******************
+   */
+
+  /** Compute the value. */
+  double n, number;
+  if( sumG > this->m_AvoidDivisionBy )
+  {
+    /** Compute the measure. */
+    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
+    number  = std::pow( n, this->m_Alpha );
+    measure = std::log( sumG / number ) / ( this->m_Alpha - 1.0 );
+  }
+  value = -measure;
+
+} // end GetValueAndDerivative()
+
+
+/**
+ * ************************ GenerateTrees *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GenerateTrees(
+  const ListSamplePointer & listSampleFixed,
+  const ListSamplePointer & listSampleMoving,
+  const ListSamplePointer & listSampleJoint ) const
+{
+  /** The fixed feature values do not depend on the transform parameters,
+   * so the fixed tree only has to be regenerated when the set of valid
+   * samples changed.
+   */
+  const bool generateFixedTree = !this->FixedTreeIsUpToDate( listSampleFixed );
+
+  /** Set the samples. When reusing the fixed tree we keep its current
+   * sample, since the tree refers to the memory of that sample.
+   */
+  if( generateFixedTree )
+  {
+    this->m_BinaryKNNTreeFixed->SetSample( listSampleFixed );
+  }
+  this->m_BinaryKNNTreeMoving->SetSample( listSampleMoving );
+  this->m_BinaryKNNTreeJoint->SetSample( listSampleJoint );
+
+  /** Generate the trees, either single- or multi-threaded. */
+  if( !this->m_UseMultiThread )
+  {
+    if( generateFixedTree )
+    {
+      this->m_BinaryKNNTreeFixed->GenerateTree();
+    }
+    this->m_BinaryKNNTreeMoving->GenerateTree();
+    this->m_BinaryKNNTreeJoint->GenerateTree();
+  }
+  else
+  {
+    this->m_KNNGraphThreaderParameters.st_GenerateFixedTree = generateFixedTree;
+    this->LaunchGenerateTreesThreaderCallback();
+  }
+
+  /** Initialize tree searchers. */
+  this->m_BinaryKNNTreeSearcherFixed
+  ->SetBinaryTree( this->m_BinaryKNNTreeFixed );
+  this->m_BinaryKNNTreeSearcherMoving
+  ->SetBinaryTree( this->m_BinaryKNNTreeMoving );
+  this->m_BinaryKNNTreeSearcherJoint
+  ->SetBinaryTree( this->m_BinaryKNNTreeJoint );
+
+} // end GenerateTrees()
+
+
+/**
+ * ************************ FixedTreeIsUpToDate *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::FixedTreeIsUpToDate( const ListSamplePointer & listSampleFixed ) const
+{
+  /** Check if reusing is requested and if there is a tree to reuse. */
+  const ListSampleType * previousSample = this->m_BinaryKNNTreeFixed->GetSample();
+  if( !this->m_ReuseFixedTree || previousSample == nullptr )
+  {
+    return false;
+  }
+
+  /** Compare the sizes. */
+  const unsigned long numberOfSamples = listSampleFixed->GetActualSize();
+  const unsigned int  dimension       = listSampleFixed->GetMeasurementVectorSize();
+  if( this->m_BinaryKNNTreeFixed->GetActualNumberOfDataPoints() != numberOfSamples
+    || this->m_BinaryKNNTreeFixed->GetDataDimension() != dimension )
+  {
+    return false;
+  }
+
+  /** Compare the samples themselves. This is linear in the number of
+   * samples, whereas generating the tree is O( n log n ).
+   */
+  const typename ListSampleType::InternalDataContainerType previous = previousSample->GetInternalContainer();
+  const typename ListSampleType::InternalDataContainerType current  = listSampleFixed->GetInternalContainer();
+  for( unsigned long i = 0; i < numberOfSamples; ++i )
+  {
+    if( !std::equal( current[ i ], current[ i ] + dimension, previous[ i ] ) )
+    {
+      return false;
+    }
+  }
+
+  return true;
+
+} // end FixedTreeIsUpToDate()
+
+
+/**
+ * ************************ ComputeGraphLengths *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeGraphLengths(
+  const ListSampleType * listSampleFixed,
+  const ListSampleType * listSampleMoving,
+  const ListSampleType * listSampleJoint,
+  const unsigned long begin, const unsigned long end,
+  AccumulateType & sumG ) const
+{
+  /** Temporary variables. */
+  MeasurementVectorType z_F, z_M, z_J;
+  IndexArrayType        indices_F, indices_M, indices_J;
+  DistanceArrayType     distances_F, distances_M, distances_J;
+
+  MeasureType H, G;
+
+  /** Get the size of the feature vectors. */
+  unsigned int fixedSize  = this->GetNumberOfFixedImages();
+  unsigned int movingSize = this->GetNumberOfMovingImages();
+  unsigned int jointSize  = fixedSize + movingSize;
+
+  /** Get the number of neighbours and \gamma. */
+  unsigned int k        = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
+  double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
+
+  /** Loop over the query points. */
+  for( unsigned long i = begin; i < end; i++ )
+  {
+    /** Get the i-th query point. */
+    listSampleFixed->GetMeasurementVector(  i, z_F );
+    listSampleMoving->GetMeasurementVector( i, z_M );
+    listSampleJoint->GetMeasurementVector(  i, z_J );
+
+    /** Search for the K nearest neighbours of the current query point. */
+    this->m_BinaryKNNTreeSearcherFixed->Search(  z_F, indices_F, distances_F );
+    this->m_BinaryKNNTreeSearcherMoving->Search( z_M, indices_M, distances_M );
+    this->m_BinaryKNNTreeSearcherJoint->Search(  z_J, indices_J, distances_J );
+
+    /** Add the distances between the points to get the total graph length.
+     * The outcommented implementation calculates: sum J/sqrt(F*M)
+     *
+    for ( unsigned int j = 0; j < K; j++ )
+    {
+    enumerator = std::sqrt( distsJ[ j ] );
+    denominator = std::sqrt( std::sqrt( distsF[ j ] ) * std::sqrt( distsM[ j ] ) );
+    if ( denominator > 1e-14 )
+    {
+    contribution += std::pow( enumerator / denominator, twoGamma );
+    }
+    }*/
+
+    /** Add the distances of all neighbours of the query point,
+    * for the three graphs:
+    * sum M / sqrt( sum F * sum M)
+    */
+
+    /** Variables to compute the measure. */
+    AccumulateType Gamma_F = NumericTraits< AccumulateType >::Zero;
+    AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
+    AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
+
+    /** Loop over the neighbours. */
+    for( unsigned int p = 0; p < k; p++ )
+    {
+      Gamma_F += std::sqrt( distances_F[ p ] );
+      Gamma_M += std::sqrt( distances_M[ p ] );
+      Gamma_J += std::sqrt( distances_J[ p ] );
+    } // end loop over the k neighbours
+
+    /** Calculate the contribution of this query point. */
+    H = std::sqrt( Gamma_F * Gamma_M );
+    if( H > this->m_AvoidDivisionBy )
+    {
+      /** Compute some sums. */
+      G     = Gamma_J / H;
+      sumG += std::pow( G, twoGamma );
+    }
+  } // end looping over the query points
+
+} // end ComputeGraphLengths()
+
+
+/**
+ * ************************ ComputeGraphLengthsAndDerivatives *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeGraphLengthsAndDerivatives(
+  const ListSampleType * listSampleFixed,
+  const ListSampleType * listSampleMoving,
+  const ListSampleType * listSampleJoint,
+  const SpatialDerivativeContainerType & imageJacobians,
+  const TransformJacobianIndicesContainerType & jacobiansIndices,
+  const unsigned long begin, const unsigned long end,
+  AccumulateType & sumG, DerivativeType & contribution ) const
+{
   /** Temporary variables. */
-  typedef typename NumericTraits< MeasureType >::AccumulateType AccumulateType;
   MeasurementVectorType z_F, z_M, z_J, z_M_ip, z_J_ip, diff_M, diff_J;
   IndexArrayType        indices_F,   indices_M,   indices_J;
   DistanceArrayType     distances_F, distances_M, distances_J;
   MeasureType           distance_F,  distance_M,  distance_J;
 
-  MeasureType    H, G, Gpow;
-  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
+  MeasureType H, G, Gpow;
 
-  DerivativeType contribution( this->GetNumberOfParameters() );
-  contribution.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
   DerivativeType dGamma_M( this->GetNumberOfParameters() );
   DerivativeType dGamma_J( this->GetNumberOfParameters() );
 
@@ -638,8 +850,8 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   unsigned int k        = this->m_BinaryKNNTreeSearcherFixed->GetKNearestNeighbors();
   double       twoGamma = jointSize * ( 1.0 - this->m_Alpha );
 
-  /** Loop over all query points, i.e. all samples. */
-  for( unsigned long i = 0; i < this->m_NumberOfPixelsCounted; i++ )
+  /** Loop over the query points. */
+  for( unsigned long i = begin; i < end; i++ )
   {
     /** Get the i-th query point. */
     listSampleFixed->GetMeasurementVector(  i, z_F );
@@ -656,9 +868,6 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
     AccumulateType Gamma_M = NumericTraits< AccumulateType >::Zero;
     AccumulateType Gamma_J = NumericTraits< AccumulateType >::Zero;
 
-    SpatialDerivativeType D1sparse, D2sparse_M, D2sparse_J;
-    D1sparse = spatialDerivativesContainer[ i ] * jacobianContainer[ i ];
-
     dGamma_M.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
     dGamma_J.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
 
@@ -683,18 +892,14 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       diff_M = z_M - z_M_ip;
       diff_J = z_M - z_J_ip;
 
-      /** Compute derivatives. */
-      D2sparse_M = spatialDerivativesContainer[ indices_M[ p ] ]
-        * jacobianContainer[ indices_M[ p ] ];
-      D2sparse_J = spatialDerivativesContainer[ indices_J[ p ] ]
-        * jacobianContainer[ indices_J[ p ] ];
-
-      /** Update the dGamma's. */
+      /** Update the dGamma's, using the precomputed image Jacobians. */
       this->UpdateDerivativeOfGammas(
-        D1sparse, D2sparse_M, D2sparse_J,
-        jacobianIndicesContainer[ i ],
-        jacobianIndicesContainer[ indices_M[ p ] ],
-        jacobianIndicesContainer[ indices_J[ p ] ],
+        imageJacobians[ i ],
+        imageJacobians[ indices_M[ p ] ],
+        imageJacobians[ indices_J[ p ] ],
+        jacobiansIndices[ i ],
+        jacobiansIndices[ indices_M[ p ] ],
+        jacobiansIndices[ indices_J[ p ] ],
         diff_M, diff_J,
         distance_M, distance_J,
         dGamma_M, dGamma_J );
@@ -714,27 +919,160 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       contribution += ( Gpow / H ) * ( dGamma_J - ( 0.5 * Gamma_J / Gamma_M ) * dGamma_M );
     }
 
-  } // end looping over all query points
+  } // end looping over the query points
 
-  /**
-   * *************** Finally, calculate the metric value and derivative ******************
+} // end ComputeGraphLengthsAndDerivatives()
+
+
+/**
+ * ************************ ThreadedGetValue *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValue( ThreadIdType threadId )
+{
+  /** Get the query points for this thread. */
+  const unsigned long numberOfSamples = this->m_NumberOfPixelsCounted;
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( numberOfSamples )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > numberOfSamples ) ? numberOfSamples : pos_begin;
+  pos_end   = ( pos_end > numberOfSamples ) ? numberOfSamples : pos_end;
+
+  /** Search the neighbours, accumulating in a local variable to avoid false sharing. */
+  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
+  this->ComputeGraphLengths(
+    this->m_KNNGraphThreaderParameters.st_ListSampleFixed,
+    this->m_KNNGraphThreaderParameters.st_ListSampleMoving,
+    this->m_KNNGraphThreaderParameters.st_ListSampleJoint,
+    pos_begin, pos_end, sumG );
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValuePerThreadVariables[ threadId ].st_Value = sumG;
+
+} // end ThreadedGetValue()
+
+
+/**
+ * ************************ ThreadedGetValueAndDerivative *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGetValueAndDerivative( ThreadIdType threadId )
+{
+  /** Get a handle to the pre-allocated derivative for the current thread.
+   * The initialization is performed at the beginning of each resolution in
+   * InitializeThreadingParameters(), and at the end of each iteration in
+   * the accumulate function.
    */
+  DerivativeType & contribution = this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Derivative;
 
-  /** Compute the value. */
-  double n, number;
-  if( sumG > this->m_AvoidDivisionBy )
-  {
-    /** Compute the measure. */
-    n       = static_cast< double >( this->m_NumberOfPixelsCounted );
-    number  = std::pow( n, this->m_Alpha );
-    measure = std::log( sumG / number ) / ( this->m_Alpha - 1.0 );
+  /** Get the query points for this thread. */
+  const unsigned long numberOfSamples = this->m_NumberOfPixelsCounted;
+  const unsigned long nrOfSamplesPerThreads
+    = static_cast< unsigned long >( std::ceil( static_cast< double >( numberOfSamples )
+    / static_cast< double >( Self::GetNumberOfWorkUnits() ) ) );
+
+  unsigned long pos_begin = nrOfSamplesPerThreads * threadId;
+  unsigned long pos_end   = nrOfSamplesPerThreads * ( threadId + 1 );
+  pos_begin = ( pos_begin > numberOfSamples ) ? numberOfSamples : pos_begin;
+  pos_end   = ( pos_end > numberOfSamples ) ? numberOfSamples : pos_end;
+
+  /** Search the neighbours, accumulating in a local variable to avoid false sharing. */
+  AccumulateType sumG = NumericTraits< AccumulateType >::Zero;
+  this->ComputeGraphLengthsAndDerivatives(
+    this->m_KNNGraphThreaderParameters.st_ListSampleFixed,
+    this->m_KNNGraphThreaderParameters.st_ListSampleMoving,
+    this->m_KNNGraphThreaderParameters.st_ListSampleJoint,
+    *this->m_KNNGraphThreaderParameters.st_ImageJacobians,
+    *this->m_KNNGraphThreaderParameters.st_JacobiansIndices,
+    pos_begin, pos_end, sumG, contribution );
+
+  /** Only update these variables at the end to prevent unnecessary "false sharing". */
+  this->m_GetValueAndDerivativePerThreadVariables[ threadId ].st_Value = sumG;
 
-    /** Compute the derivative (-2.0 * d = -jointSize). */
-    derivative = ( static_cast< AccumulateType >( jointSize ) / sumG ) * contribution;
+} // end ThreadedGetValueAndDerivative()
+
+
+/**
+ * ************************ ThreadedGenerateTrees *************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedGenerateTrees( ThreadIdType threadId )
+{
+  /** Distribute the (at most) three trees over the threads. The trees are
+   * independent, and so is their construction.
+   */
+  const ThreadIdType numberOfThreads = Self::GetNumberOfWorkUnits();
+  for( ThreadIdType tree = threadId; tree < 3; tree += numberOfThreads )
+  {
+    if( tree == 0 && this->m_KNNGraphThreaderParameters.st_GenerateFixedTree )
+    {
+      this->m_BinaryKNNTreeFixed->GenerateTree();
+    }
+    else if( tree == 1 )
+    {
+      this->m_BinaryKNNTreeMoving->GenerateTree();
+    }
+    else if( tree == 2 )
+    {
+      this->m_BinaryKNNTreeJoint->GenerateTree();
+    }
   }
-  value = -measure;
 
-} // end GetValueAndDerivative()
+} // end ThreadedGenerateTrees()
+
+
+/**
+ * **************** GenerateTreesThreaderCallback *******
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::GenerateTreesThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadId   = infoStruct->WorkUnitID;
+
+  KNNGraphMultiThreaderParameterType * temp
+    = static_cast< KNNGraphMultiThreaderParameterType * >( infoStruct->UserData );
+
+  temp->m_Metric->ThreadedGenerateTrees( threadId );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end GenerateTreesThreaderCallback()
+
+
+/**
+ * *********************** LaunchGenerateTreesThreaderCallback***************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
+::LaunchGenerateTreesThreaderCallback( void ) const
+{
+  /** Setup threader. */
+  this->m_Threader->SetSingleMethod( this->GenerateTreesThreaderCallback,
+    const_cast< void * >( static_cast< const void * >(
+      &this->m_KNNGraphThreaderParameters ) ) );
+
+  /** Launch. */
+  this->m_Threader->SingleMethodExecute();
+
+} // end LaunchGenerateTreesThreaderCallback()
 
 
 /**
@@ -749,15 +1087,13 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   const ListSamplePointer & listSampleMoving,
   const ListSamplePointer & listSampleJoint,
   const bool & doDerivative,
-  TransformJacobianContainerType & jacobianContainer,
-  TransformJacobianIndicesContainerType & jacobianIndicesContainer,
-  SpatialDerivativeContainerType & spatialDerivativesContainer ) const
+  SpatialDerivativeContainerType & imageJacobianContainer,
+  TransformJacobianIndicesContainerType & jacobianIndicesContainer ) const
 {
   /** Initialize. */
   this->m_NumberOfPixelsCounted = 0;
-  jacobianContainer.resize( 0 );
+  imageJacobianContainer.resize( 0 );
   jacobianIndicesContainer.resize( 0 );
-  spatialDerivativesContainer.resize( 0 );
 
   /** Get a handle to the sample container. */
   ImageSampleContainerPointer sampleContainer      = this->GetImageSampler()->GetOutput();
@@ -784,9 +1120,8 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
   /** Potential speedup: it avoids re-allocations. I noticed performance
    * gains when nrOfRequestedSamples is about 10000 or higher.
    */
-  jacobianContainer.reserve( nrOfRequestedSamples );
+  imageJacobianContainer.reserve( nrOfRequestedSamples );
   jacobianIndicesContainer.reserve( nrOfRequestedSamples );
-  spatialDerivativesContainer.reserve( nrOfRequestedSamples );
 
   /** Create variables to store intermediate results. */
   RealType                   movingImageValue;
@@ -880,12 +1215,12 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
       /** Compute additional stuff for the computation of the derivative, if necessary.
        * - the Jacobian of the transform: dT/dmu(x_i).
        * - the spatial derivative of all moving feature images: dz_q^m/dx(T(x_i)).
+       * Only their product is stored, since that is all that is needed later on.
        */
       if( doDerivative )
       {
         /** Get the TransformJacobian dT/dmu. */
         this->EvaluateTransformJacobian( fixedPoint, jacobian, nzji );
-        jacobianContainer.push_back( jacobian );
         jacobianIndicesContainer.push_back( nzji );
 
         /** Get the spatial derivative of the moving image. */
@@ -902,8 +1237,8 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
           mappedPoint, movingFeatureImageDerivatives );
         spatialDerivatives.update( movingFeatureImageDerivatives, 1, 0 );
 
-        /** Put the spatial derivatives of this sample into the container. */
-        spatialDerivativesContainer.push_back( spatialDerivatives );
+        /** Put the image Jacobian dz^m/dx * dT/dmu of this sample into the container. */
+        imageJacobianContainer.push_back( SpatialDerivativeType( spatialDerivatives * jacobian ) );
 
       } // end if doDerivative
 
@@ -1089,6 +1424,7 @@ KNNGraphAlphaMutualInformationImageToImageMetric< TFixedImage, TMovingImage >
 
   os << indent << "Alpha: " << this->m_Alpha << std::endl;
   os << indent << "AvoidDivisionBy: " << this->m_AvoidDivisionBy << std::endl;
+  os << indent << "ReuseFixedTree: " << this->m_ReuseFixedTree << std::endl;
 
   os << indent << "BinaryKNNTreeFixed: "
      << this->m_BinaryKNNTreeFixed.GetPointer() << std::endl;
@@ -29,6 +29,15 @@ namespace elastix
  * \brief An metric based on the itk::PatternIntensityImageToImageMetric.
  *
  *
+ * The parameters used in this class are:
+ * \parameter NumberOfDerivativeThreads: the number of threads over which the
+ *    evaluations of the finite difference derivative are distributed. Each
+ *    thread uses its own copy of the transform and of the projection pipeline.
+ *    0 means the number of threads of the metric.\n
+ *    <tt>(NumberOfDerivativeThreads 4)</tt>\n
+ *    Can be given for each resolution. The default is 1, which computes the
+ *    derivative serially, as before.
+ *
  * \ingroup Metrics
  *
  */
@@ -92,6 +92,12 @@ PatternIntensityMetric< TElastix >
     "OptimizeNormalizationFactor", this->GetComponentLabel(), level, 0 );
   this->SetOptimizeNormalizationFactor( optimizenormalizationfactor );
 
+  /** Set the number of threads for the finite difference derivative. */
+  unsigned int numberOfDerivativeThreads = 1;
+  this->m_Configuration->ReadParameter( numberOfDerivativeThreads,
+    "NumberOfDerivativeThreads", this->GetComponentLabel(), level, 0 );
+  this->SetNumberOfDerivativeThreads( numberOfDerivativeThreads );
+
   typedef typename elastix::OptimizerBase< TElastix >::ITKBaseType::ScalesType ScalesType;
   ScalesType scales = this->m_Elastix->GetElxOptimizerBase()->GetAsITKBaseType()->GetScales();
   this->SetScales( scales );
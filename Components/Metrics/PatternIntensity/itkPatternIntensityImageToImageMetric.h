@@ -22,7 +22,7 @@
 
 #include "itkPoint.h"
 #include "itkCastImageFilter.h"
-#include "itkResampleImageFilter.h"
+#include "itkRayCastResampleImageFilter.h"
 #include "itkMultiplyImageFilter.h"
 #include "itkSubtractImageFilter.h"
 #include "itkOptimizer.h"
@@ -30,6 +30,8 @@
 #include "itkAdvancedCombinationTransform.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 
+#include <vector>
+
 namespace itk
 {
 
@@ -122,7 +124,7 @@ public:
   typedef typename itk::AdvancedRayCastInterpolateImageFunction<
     MovingImageType, ScalarType >                         RayCastInterpolatorType;
   typedef typename RayCastInterpolatorType::Pointer RayCastInterpolatorPointer;
-  typedef itk::ResampleImageFilter<
+  typedef itk::RayCastResampleImageFilter<
     MovingImageType, TransformedMovingImageType >         TransformMovingImageFilterType;
   typedef typename TransformMovingImageFilterType::Pointer TransformMovingImageFilterPointer;
   typedef itk::RescaleIntensityImageFilter<
@@ -174,6 +176,14 @@ public:
   itkSetMacro( OptimizeNormalizationFactor, bool );
   itkGetConstReferenceMacro( OptimizeNormalizationFactor, bool );
 
+  /** Set/Get the number of threads over which the evaluations of the finite
+   * difference derivative are distributed. Each thread uses its own copy of
+   * the transform and of the projection pipeline. 0 uses the number of work
+   * units of the metric. The default 1 computes the derivative serially.
+   */
+  itkSetMacro( NumberOfDerivativeThreads, ThreadIdType );
+  itkGetConstMacro( NumberOfDerivativeThreads, ThreadIdType );
+
 protected:
 
   PatternIntensityImageToImageMetric();
@@ -186,6 +196,62 @@ protected:
   /** Compute the pattern intensity difference image. */
   MeasureType ComputePIDiff( const TransformParametersType & parameters, float scalingfactor ) const;
 
+  /** Compute the pattern intensity of the difference image of the given
+   * filters, which should be connected to a projection that is up to date.
+   */
+  MeasureType ComputePIDiff( MultiplyImageFilterType * multiplyFilter,
+    DifferenceImageFilterType * differenceFilter, float scalingfactor ) const;
+
+  /** Compute the metric value from the given filters, optionally
+   * optimizing the normalization factor.
+   */
+  MeasureType ComputeValue( MultiplyImageFilterType * multiplyFilter,
+    DifferenceImageFilterType * differenceFilter ) const;
+
+  /** Generate the projection of the moving image for the given parameters,
+   * unless it was already generated for these parameters. The transform
+   * parameters should have been set before.
+   */
+  void UpdateTransformedMovingImage( const TransformParametersType & parameters ) const;
+
+  /** A private copy of the projection pipeline, used by one thread of the
+   * finite difference derivative.
+   */
+  struct FiniteDifferencePipelineType
+  {
+    typename RayCastInterpolatorType::TransformPointer st_Transform;
+    RayCastInterpolatorPointer                         st_RayCaster;
+    TransformMovingImageFilterPointer                  st_TransformMovingImageFilter;
+    MultiplyImageFilterPointer                         st_MultiplyImageFilter;
+    DifferenceImageFilterPointer                       st_DifferenceImageFilter;
+  };
+
+  /** The parameters of the threads of the finite difference derivative. */
+  struct FiniteDifferenceThreaderParameterType
+  {
+    const Self *                    st_Metric;
+    const TransformParametersType * st_Parameters;
+    std::vector< MeasureType > *    st_Values;
+  };
+
+  typedef typename Superclass::ThreaderType   ThreaderType;
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+
+  /** The number of threads used by GetDerivative(). */
+  ThreadIdType GetNumberOfThreadsForDerivative( void ) const;
+
+  /** Create a private copy of the projection pipeline. */
+  void InitializeFiniteDifferencePipeline( FiniteDifferencePipelineType & pipeline ) const;
+
+  /** Compute the values of the 2 * P finite difference evaluations multi-threaded. */
+  void ComputeFiniteDifferenceValues( const TransformParametersType & parameters,
+    std::vector< MeasureType > & values, const ThreadIdType numberOfThreads ) const;
+
+  /** The callback and the threaded part of ComputeFiniteDifferenceValues(). */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION FiniteDifferenceThreaderCallback( void * arg );
+
+  void ThreadedComputeFiniteDifferenceValues( ThreadIdType threadId, ThreadIdType numberOfThreads ) const;
+
 private:
 
   PatternIntensityImageToImageMetric( const Self & ); // purposely not implemented
@@ -205,6 +271,15 @@ private:
   MeasureType                        m_FixedMeasure;
   CombinationTransformPointer        m_CombinationTransform;
 
+  /** The parameters of the last generated projection. */
+  mutable TransformParametersType m_TransformedMovingImageParameters;
+  mutable bool                    m_TransformedMovingImageIsValid;
+
+  /** The state of the multi-threaded finite difference derivative. */
+  ThreadIdType                                        m_NumberOfDerivativeThreads;
+  mutable std::vector< FiniteDifferencePipelineType > m_FiniteDifferencePipelines;
+  mutable FiniteDifferenceThreaderParameterType       m_FiniteDifferenceThreaderParameters;
+
 };
 
 } // end namespace itk
@@ -22,6 +22,7 @@
 #include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkNumericTraits.h"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <iomanip>
@@ -51,6 +52,8 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   this->m_RescaleImageFilter          = RescaleIntensityImageFilterType::New();
   this->m_DifferenceImageFilter       = DifferenceImageFilterType::New();
   this->m_MultiplyImageFilter         = MultiplyImageFilterType::New();
+  this->m_TransformedMovingImageIsValid = false;
+  this->m_NumberOfDerivativeThreads     = 1;
 
 } // end Constructor
 
@@ -92,6 +95,8 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   this->m_TransformMovingImageFilter->SetOutputDirection(
     this->m_FixedImage->GetDirection() );
   this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+  this->m_TransformedMovingImageIsValid = false;
+  this->m_FiniteDifferencePipelines.clear();
 
   //this->InitializeLimiters();
 
@@ -224,6 +229,33 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 } // end ComputePIFixed()
 
 
+/**
+ * ********************* UpdateTransformedMovingImage ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::UpdateTransformedMovingImage( const TransformParametersType & parameters ) const
+{
+  /** The projection only depends on the transform parameters, so it is
+   * only regenerated when they differ from those of the last projection.
+   * The filter is modified explicitly, because the MTime of the transform
+   * of the ray caster does not change with the parameters.
+   */
+  if( this->m_TransformedMovingImageIsValid && this->m_TransformedMovingImageParameters == parameters )
+  {
+    return;
+  }
+
+  this->m_TransformMovingImageFilter->Modified();
+  this->m_TransformMovingImageFilter->UpdateLargestPossibleRegion();
+  this->m_TransformedMovingImageParameters = parameters;
+  this->m_TransformedMovingImageIsValid    = true;
+
+} // end UpdateTransformedMovingImage()
+
+
 /**
  * ********************* ComputePIDiff ******************************
  */
@@ -249,9 +281,25 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   this->BeforeThreadedGetValueAndDerivative( parameters );
   //this->SetTransformParameters( parameters );
 
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_MultiplyImageFilter->SetConstant( scalingfactor );
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
+  this->UpdateTransformedMovingImage( parameters );
+
+  return this->ComputePIDiff( this->m_MultiplyImageFilter, this->m_DifferenceImageFilter, scalingfactor );
+
+} // end ComputePIDiff()
+
+
+/**
+ * ********************* ComputePIDiff ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::ComputePIDiff( MultiplyImageFilterType * multiplyFilter,
+  DifferenceImageFilterType * differenceFilter, float scalingfactor ) const
+{
+  multiplyFilter->SetConstant( scalingfactor );
+  differenceFilter->UpdateLargestPossibleRegion();
   MeasureType measure = NumericTraits< MeasureType >::Zero;
   MeasureType diff    = NumericTraits< MeasureType >::Zero;
 
@@ -276,7 +324,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   typedef itk::ImageRegionConstIteratorWithIndex< TransformedMovingImageType >
     DifferenceImageIteratorType;
   DifferenceImageIteratorType differenceImageIt(
-  this->m_DifferenceImageFilter->GetOutput(), iterationRegion );
+  differenceFilter->GetOutput(), iterationRegion );
   differenceImageIt.GoToBegin();
 
   neighboriterationRegion.SetSize( neighborIterationSize );
@@ -317,7 +365,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 
       neighboriterationRegion.SetIndex( neighborIndex );
       DifferenceImageIteratorType neighborIt(
-      this->m_DifferenceImageFilter->GetOutput(), neighboriterationRegion );
+      differenceFilter->GetOutput(), neighboriterationRegion );
       neighborIt.GoToBegin();
 
       while( !neighborIt.IsAtEnd() )
@@ -362,8 +410,23 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   this->BeforeThreadedGetValueAndDerivative( parameters );
   //this->SetTransformParameters( parameters );
 
-  this->m_TransformMovingImageFilter->Modified();
-  this->m_DifferenceImageFilter->UpdateLargestPossibleRegion();
+  this->UpdateTransformedMovingImage( parameters );
+
+  return this->ComputeValue( this->m_MultiplyImageFilter, this->m_DifferenceImageFilter );
+
+} // end GetValue()
+
+
+/**
+ * ********************* ComputeValue ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeValue( MultiplyImageFilterType * multiplyFilter,
+  DifferenceImageFilterType * differenceFilter ) const
+{
   MeasureType measure        = 1e10;
   MeasureType currentMeasure = 1e10;
 
@@ -376,7 +439,7 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 
     while( tmpfactor <=  this->m_NormalizationFactor * 1.0 )
     {
-      measure    = this->ComputePIDiff( parameters, tmpfactor );
+      measure    = this->ComputePIDiff( multiplyFilter, differenceFilter, tmpfactor );
       tmpMeasure = ( measure - this->m_FixedMeasure ) / -this->m_Rescalingfactor;
 
       if( tmpMeasure < currentMeasure )
@@ -390,13 +453,13 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
   }
   else
   {
-    measure        = this->ComputePIDiff( parameters, this->m_NormalizationFactor );
+    measure        = this->ComputePIDiff( multiplyFilter, differenceFilter, this->m_NormalizationFactor );
     currentMeasure = -( measure - this->m_FixedMeasure ) / this->m_Rescalingfactor;
   }
 
   return currentMeasure;
 
-} // end GetValue()
+} // end ComputeValue()
 
 
 /**
@@ -409,11 +472,29 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 ::GetDerivative( const TransformParametersType & parameters,
   DerivativeType & derivative ) const
 {
-  TransformParametersType testPoint;
-  testPoint = parameters;
   const unsigned int numberOfParameters = this->GetNumberOfParameters();
   derivative = DerivativeType( numberOfParameters );
 
+  /** The 2 * P evaluations of the central differences are independent, so
+   * they are distributed over threads, each with its own copy of the
+   * projection pipeline. With one thread, the evaluations are done with
+   * the pipeline of the metric itself, as before.
+   */
+  const ThreadIdType numberOfThreads = this->GetNumberOfThreadsForDerivative();
+  if( numberOfThreads > 1 )
+  {
+    std::vector< MeasureType > values( 2 * numberOfParameters );
+    this->ComputeFiniteDifferenceValues( parameters, values, numberOfThreads );
+    for( unsigned int i = 0; i < numberOfParameters; i++ )
+    {
+      derivative[ i ] = ( values[ 2 * i + 1 ] - values[ 2 * i ] )
+        / ( 2 * this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] ) );
+    }
+    return;
+  }
+
+  TransformParametersType testPoint;
+  testPoint = parameters;
   for( unsigned int i = 0; i < numberOfParameters; i++ )
   {
     testPoint[ i ] -= this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
@@ -427,6 +508,182 @@ PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetDerivative()
 
 
+/**
+ * ********************* GetNumberOfThreadsForDerivative ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ThreadIdType
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::GetNumberOfThreadsForDerivative( void ) const
+{
+  ThreadIdType numberOfThreads = this->m_NumberOfDerivativeThreads;
+  if( numberOfThreads == 0 )
+  {
+    numberOfThreads = this->m_UseMultiThread ? this->m_Threader->GetNumberOfWorkUnits() : 1;
+  }
+
+  /** There are no more than 2 * P evaluations to distribute. */
+  return std::min< ThreadIdType >( numberOfThreads, 2 * this->GetNumberOfParameters() );
+
+} // end GetNumberOfThreadsForDerivative()
+
+
+/**
+ * ********************* InitializeFiniteDifferencePipeline ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeFiniteDifferencePipeline( FiniteDifferencePipelineType & pipeline ) const
+{
+  const RayCastInterpolatorType * rayCaster
+    = dynamic_cast< const RayCastInterpolatorType * >( this->m_Interpolator.GetPointer() );
+
+  /** The transform of the ray caster is cloned, so that its parameters can
+   * be set independently. The clone of an AdvancedCombinationTransform
+   * shares the initial transform and clones the current transform.
+   */
+  pipeline.st_Transform = rayCaster->GetTransform()->Clone();
+
+  pipeline.st_RayCaster = RayCastInterpolatorType::New();
+  pipeline.st_RayCaster->SetTransform( pipeline.st_Transform );
+  pipeline.st_RayCaster->SetFocalPoint( rayCaster->GetFocalPoint() );
+  pipeline.st_RayCaster->SetThreshold( rayCaster->GetThreshold() );
+
+  /** The images are grafted into images without a source, so that the
+   * pipelines of the threads do not update a shared upstream pipeline.
+   */
+  typename MovingImageType::Pointer movingImage = MovingImageType::New();
+  movingImage->Graft( this->m_MovingImage );
+  typename FixedImageType::Pointer fixedImage = FixedImageType::New();
+  fixedImage->Graft( this->m_FixedImage );
+
+  /** The threads already run in parallel, so each filter uses one work unit. */
+  pipeline.st_TransformMovingImageFilter = TransformMovingImageFilterType::New();
+  pipeline.st_TransformMovingImageFilter->SetNumberOfWorkUnits( 1 );
+  pipeline.st_TransformMovingImageFilter->SetTransform( pipeline.st_Transform );
+  pipeline.st_TransformMovingImageFilter->SetInterpolator( pipeline.st_RayCaster );
+  pipeline.st_TransformMovingImageFilter->SetInput( movingImage );
+  pipeline.st_TransformMovingImageFilter->SetDefaultPixelValue( 0 );
+  pipeline.st_TransformMovingImageFilter->SetSize(
+    this->m_FixedImage->GetLargestPossibleRegion().GetSize() );
+  pipeline.st_TransformMovingImageFilter->SetOutputOrigin(
+    this->m_FixedImage->GetOrigin() );
+  pipeline.st_TransformMovingImageFilter->SetOutputSpacing(
+    this->m_FixedImage->GetSpacing() );
+  pipeline.st_TransformMovingImageFilter->SetOutputDirection(
+    this->m_FixedImage->GetDirection() );
+
+  pipeline.st_MultiplyImageFilter = MultiplyImageFilterType::New();
+  pipeline.st_MultiplyImageFilter->SetNumberOfWorkUnits( 1 );
+  pipeline.st_MultiplyImageFilter->SetInput(
+    pipeline.st_TransformMovingImageFilter->GetOutput() );
+
+  pipeline.st_DifferenceImageFilter = DifferenceImageFilterType::New();
+  pipeline.st_DifferenceImageFilter->SetNumberOfWorkUnits( 1 );
+  pipeline.st_DifferenceImageFilter->SetInput1( fixedImage );
+  pipeline.st_DifferenceImageFilter->SetInput2( pipeline.st_MultiplyImageFilter->GetOutput() );
+
+} // end InitializeFiniteDifferencePipeline()
+
+
+/**
+ * ********************* ComputeFiniteDifferenceValues ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::ComputeFiniteDifferenceValues( const TransformParametersType & parameters,
+  std::vector< MeasureType > & values, const ThreadIdType numberOfThreads ) const
+{
+  /** The pipelines are kept until the next Initialize(), since cloning the
+   * transform and allocating the images is not for free.
+   */
+  if( this->m_FiniteDifferencePipelines.size() < numberOfThreads )
+  {
+    const std::size_t first = this->m_FiniteDifferencePipelines.size();
+    this->m_FiniteDifferencePipelines.resize( numberOfThreads );
+    for( std::size_t i = first; i < numberOfThreads; ++i )
+    {
+      this->InitializeFiniteDifferencePipeline( this->m_FiniteDifferencePipelines[ i ] );
+    }
+  }
+
+  this->m_FiniteDifferenceThreaderParameters.st_Metric     = this;
+  this->m_FiniteDifferenceThreaderParameters.st_Parameters = &parameters;
+  this->m_FiniteDifferenceThreaderParameters.st_Values     = &values;
+
+  typename ThreaderType::Pointer local_threader = ThreaderType::New();
+  local_threader->SetNumberOfWorkUnits( numberOfThreads );
+  local_threader->SetSingleMethod( FiniteDifferenceThreaderCallback,
+    static_cast< void * >( &this->m_FiniteDifferenceThreaderParameters ) );
+  local_threader->SingleMethodExecute();
+
+} // end ComputeFiniteDifferenceValues()
+
+
+/**
+ * ********************* FiniteDifferenceThreaderCallback ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::FiniteDifferenceThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  FiniteDifferenceThreaderParameterType * temp
+    = static_cast< FiniteDifferenceThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedComputeFiniteDifferenceValues(
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end FiniteDifferenceThreaderCallback()
+
+
+/**
+ * ********************* ThreadedComputeFiniteDifferenceValues ******************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+PatternIntensityImageToImageMetric< TFixedImage, TMovingImage >
+::ThreadedComputeFiniteDifferenceValues( ThreadIdType threadId, ThreadIdType numberOfThreads ) const
+{
+  const TransformParametersType & parameters = *this->m_FiniteDifferenceThreaderParameters.st_Parameters;
+  std::vector< MeasureType > &    values     = *this->m_FiniteDifferenceThreaderParameters.st_Values;
+  FiniteDifferencePipelineType &  pipeline   = this->m_FiniteDifferencePipelines[ threadId ];
+
+  /** Evaluation 2 * i is parameter i minus delta, 2 * i + 1 is plus delta.
+   * The test points are computed as in the single-threaded GetDerivative().
+   */
+  TransformParametersType testPoint = parameters;
+  for( std::size_t evaluation = threadId; evaluation < values.size(); evaluation += numberOfThreads )
+  {
+    const unsigned int i     = static_cast< unsigned int >( evaluation / 2 );
+    const double       delta = this->m_DerivativeDelta / std::sqrt( this->m_Scales[ i ] );
+    testPoint[ i ] -= delta;
+    if( evaluation % 2 == 1 )
+    {
+      testPoint[ i ] += 2 * delta;
+    }
+
+    pipeline.st_Transform->SetParameters( testPoint );
+    pipeline.st_TransformMovingImageFilter->Modified();
+    values[ evaluation ] = this->ComputeValue(
+      pipeline.st_MultiplyImageFilter, pipeline.st_DifferenceImageFilter );
+
+    testPoint[ i ] = parameters[ i ];
+  }
+
+} // end ThreadedComputeFiniteDifferenceValues()
+
+
 /**
  * ********************* GetValueAndDerivative ******************************
  */
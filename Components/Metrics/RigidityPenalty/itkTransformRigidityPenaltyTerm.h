@@ -49,8 +49,15 @@ namespace itk
  * The intended use for this metric is to filter a B-spline coefficient
  * image in order to calculate a rigidity penalty term on a B-spline transform.
  *
- * The RigidityPenaltyTermValueImageFilter at each pixel location is computed by
- * convolution with some separable 1D kernels.
+ * The first and second order spatial derivatives of the transformation at each
+ * B-spline grid point are computed by applying 3x3(x3) stencils to the B-spline
+ * coefficients. These stencils are the tensor products of the 1D B-spline
+ * (derivative) kernels, scaled by the grid spacing. From these derivatives the
+ * linearity, orthonormality and properness conditions and the parts of their
+ * derivatives are computed, in one multi-threaded pass over the grid. A second
+ * pass filters the parts with the adjoint stencils to obtain the derivative.
+ * The stencils and the scratch memory for the parts are set up once per
+ * resolution, in Initialize().
  *
  * The rigid penalty term penalizes deviations from a rigid
  * transformation at regions specified by the so-called rigidity images.
@@ -322,9 +329,69 @@ private:
   void CreateNDOperator( NeighborhoodType & F, const std::string & whichF,
     const CoefficientImageSpacingType & spacing ) const;
 
-  /** Private function used for the filtering. It performs 1D separable filtering. */
-  CoefficientImagePointer FilterSeparable( const CoefficientImageType *,
-    const std::vector< NeighborhoodType > & Operators ) const;
+  /** Typedefs for the fused stencil computation. */
+  typedef typename Superclass::ThreadInfoType ThreadInfoType;
+  typedef std::vector< ScalarType >           StencilType;
+
+  /** Create the 3x3(x3) stencils from the operators and allocate the scratch memory. */
+  void InitializeFusedStencils( void );
+
+  /** Compute the condition values and, when requested, the derivative of the
+   * rigidity penalty term in two multi-threaded passes over the B-spline grid.
+   * Returns the sum of the rigidity coefficients.
+   */
+  ScalarType ComputeFusedStencils( DerivativeType * derivative ) const;
+
+  /** Forward pass: first and second order derivatives of the coefficients,
+   * the (unnormalized) condition values and the parts of their derivatives.
+   */
+  void ThreadedComputeConditions( ThreadIdType threadId, ThreadIdType numberOfThreads ) const;
+
+  /** The orthonormality condition at a grid point, given the first order
+   * derivatives mu[ i ][ f ] of coefficient image i with stencil f. When parts
+   * is not null, the parts of its derivative are stored there.
+   */
+  ScalarType ComputeOrthonormalityCondition( const ScalarType mu[ 3 ][ 3 ], ScalarType * parts ) const;
+
+  /** The properness condition at a grid point, like ComputeOrthonormalityCondition(). */
+  ScalarType ComputePropernessCondition( const ScalarType mu[ 3 ][ 3 ], ScalarType * parts ) const;
+
+  /** The linearity condition at a grid point, given the second order derivatives nu. */
+  ScalarType ComputeLinearityCondition( const ScalarType nu[ 3 ][ 6 ], ScalarType * parts ) const;
+
+  /** Adjoint pass: filter the parts to obtain the derivative. */
+  void ThreadedComputeDerivative( ThreadIdType threadId, ThreadIdType numberOfThreads ) const;
+
+  /** The threader callbacks of the two passes. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ComputeConditionsThreaderCallback( void * arg );
+
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION ComputeDerivativeThreaderCallback( void * arg );
+
+  /** Compute the linear indices of the neighbours of all pixels in a row of the grid. */
+  void ComputeRowOffsets( const SizeValueType row, std::vector< SizeValueType > & rowOffsets ) const;
+
+  /** Struct to pass data to the threads of the fused stencils. */
+  struct FusedStencilsThreaderParameterType
+  {
+    const Self *     st_Metric;
+    DerivativeType * st_Derivative;
+    bool             st_ComputeDerivative;
+    ScalarType       st_RigidityCoefficientSum;
+  };
+
+  /** Per thread results of the fused stencils. */
+  struct FusedStencilsPerThreadStruct
+  {
+    MeasureType st_RigidityCoefficientSum;
+    MeasureType st_LinearityConditionValue;
+    MeasureType st_OrthonormalityConditionValue;
+    MeasureType st_PropernessConditionValue;
+    MeasureType st_LinearityConditionGradientMagnitude;
+    MeasureType st_OrthonormalityConditionGradientMagnitude;
+    MeasureType st_PropernessConditionGradientMagnitude;
+  };
+  itkPadStruct( ITK_CACHE_LINE_ALIGNMENT, FusedStencilsPerThreadStruct,
+    PaddedFusedStencilsPerThreadStruct );
 
   /** Member variables. */
   BSplineTransformPointer m_BSplineTransform;
@@ -361,6 +428,19 @@ private:
   bool                               m_UseFixedRigidityImage;
   bool                               m_UseMovingRigidityImage;
 
+  /** Fused stencil variables. The forward stencils filter the coefficients;
+   * the adjoint stencils filter the parts of the derivative. The order is
+   * A, B, (C), and D, E, G, (F, H, I) for the linearity condition.
+   */
+  std::vector< StencilType >                                m_ForwardStencils;
+  std::vector< StencilType >                                m_AdjointStencils;
+  SizeValueType                                             m_GridSize[ FixedImageDimension ];
+  SizeValueType                                             m_NumberOfGridPoints;
+  unsigned int                                              m_NumberOfParts;
+  mutable std::vector< ScalarType >                         m_ConditionParts;
+  mutable FusedStencilsThreaderParameterType                m_FusedStencilsParameters;
+  mutable std::vector< PaddedFusedStencilsPerThreadStruct > m_FusedStencilsPerThreadVariables;
+
 };
 
 } // end namespace itk
@@ -21,6 +21,8 @@
 #include "itkTransformRigidityPenaltyTerm.h"
 
 #include "itkZeroFluxNeumannBoundaryCondition.h"
+#include "vnl/vnl_math.h"
+#include <algorithm>
 
 namespace itk
 {
@@ -87,6 +89,10 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
 
   this->m_BSplineTransform = nullptr;
 
+  /** Initialize the fused stencils. */
+  this->m_NumberOfGridPoints = 0;
+  this->m_NumberOfParts      = 0;
+
 } // end Constructor
 
 
@@ -164,6 +170,9 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
     this->DilateRigidityImages();
   }
 
+  /** Setup the stencils and the scratch memory for this resolution. */
+  this->InitializeFusedStencils();
+
   /** Reset the filling bool. */
   this->m_RigidityCoefficientImageIsFilled = false;
 
@@ -495,364 +504,24 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
     itkExceptionMacro( << "ERROR: This filter is only implemented for dimension 2 and 3." );
   }
 
-  /** Get a handle to the B-spline coefficient images. */
-  std::vector< CoefficientImagePointer > inputImages( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    inputImages[ i ] = this->m_BSplineTransform->GetCoefficientImages()[ i ];
-  }
-
-  /** Get the B-spline coefficient image spacing. */
-  CoefficientImageSpacingType spacing = inputImages[ 0 ]->GetSpacing();
-
-  /** TASK 0:
-   * Compute the rigidityCoefficientSum and check on it.
+  /** TASK 1:
+   * Compute the condition values in a fused pass over the B-spline grid.
    *
    ************************************************************************* */
 
-  /** Create iterator over the rigidity coeficient image. */
-  CoefficientImageIteratorType it_RCI( this->m_RigidityCoefficientImage,
-  this->m_RigidityCoefficientImage->GetLargestPossibleRegion() );
-  it_RCI.GoToBegin();
-  ScalarType rigidityCoefficientSum = NumericTraits< ScalarType >::Zero;
-
-  /** Add the rigidity coefficients together. */
-  while( !it_RCI.IsAtEnd() )
-  {
-    rigidityCoefficientSum += it_RCI.Get();
-    ++it_RCI;
-  }
+  const ScalarType rigidityCoefficientSum = this->ComputeFusedStencils( nullptr );
 
   /** Check for early termination. */
   if( rigidityCoefficientSum < 1e-14 )
   {
-    this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
+    this->m_LinearityConditionValue      = NumericTraits< MeasureType >::Zero;
+    this->m_OrthonormalityConditionValue = NumericTraits< MeasureType >::Zero;
+    this->m_PropernessConditionValue     = NumericTraits< MeasureType >::Zero;
+    this->m_RigidityPenaltyTermValue     = NumericTraits< MeasureType >::Zero;
     return this->m_RigidityPenaltyTermValue;
   }
 
-  /** TASK 1:
-   * Prepare for the calculation of the rigidity penalty term.
-   *
-   ************************************************************************* */
-
-  /** Create 1D neighbourhood operators. */
-  std::vector< NeighborhoodType > Operators_A( ImageDimension ),
-  Operators_B( ImageDimension ), Operators_C( ImageDimension ),
-  Operators_D( ImageDimension ), Operators_E( ImageDimension ),
-  Operators_F( ImageDimension ), Operators_G( ImageDimension ),
-  Operators_H( ImageDimension ), Operators_I( ImageDimension );
-
-  /** Create B-spline coefficient images that are filtered once. */
-  std::vector< CoefficientImagePointer > ui_FA( ImageDimension ),
-  ui_FB( ImageDimension ), ui_FC( ImageDimension ),
-  ui_FD( ImageDimension ), ui_FE( ImageDimension ),
-  ui_FF( ImageDimension ), ui_FG( ImageDimension ),
-  ui_FH( ImageDimension ), ui_FI( ImageDimension );
-
-  /** For all dimensions ... */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    /** ... create the filtered images ... */
-    ui_FA[ i ] = CoefficientImageType::New();
-    ui_FB[ i ] = CoefficientImageType::New();
-    ui_FD[ i ] = CoefficientImageType::New();
-    ui_FE[ i ] = CoefficientImageType::New();
-    ui_FG[ i ] = CoefficientImageType::New();
-    if( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = CoefficientImageType::New();
-      ui_FF[ i ] = CoefficientImageType::New();
-      ui_FH[ i ] = CoefficientImageType::New();
-      ui_FI[ i ] = CoefficientImageType::New();
-    }
-    /** ... and the apropiate operators.
-     * The operators C, D and E from the paper are here created
-     * by Create1DOperator D, E and G, because of the 3D case and history.
-     */
-    this->Create1DOperator( Operators_A[ i ], "FA_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_B[ i ], "FB_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_D[ i ], "FD_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_E[ i ], "FE_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_G[ i ], "FG_xi", i + 1, spacing );
-    if( ImageDimension == 3 )
-    {
-      this->Create1DOperator( Operators_C[ i ], "FC_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_F[ i ], "FF_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_H[ i ], "FH_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_I[ i ], "FI_xi", i + 1, spacing );
-    }
-  } // end for loop
-
   /** TASK 2:
-   * Filter the B-spline coefficient images.
-   *
-   ************************************************************************* */
-
-  /** Filter the inputImages. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    ui_FA[ i ] = this->FilterSeparable( inputImages[ i ], Operators_A );
-    ui_FB[ i ] = this->FilterSeparable( inputImages[ i ], Operators_B );
-    ui_FD[ i ] = this->FilterSeparable( inputImages[ i ], Operators_D );
-    ui_FE[ i ] = this->FilterSeparable( inputImages[ i ], Operators_E );
-    ui_FG[ i ] = this->FilterSeparable( inputImages[ i ], Operators_G );
-    if( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = this->FilterSeparable( inputImages[ i ], Operators_C );
-      ui_FF[ i ] = this->FilterSeparable( inputImages[ i ], Operators_F );
-      ui_FH[ i ] = this->FilterSeparable( inputImages[ i ], Operators_H );
-      ui_FI[ i ] = this->FilterSeparable( inputImages[ i ], Operators_I );
-    }
-  }
-
-  /** TASK 3:
-   * Create iterators.
-   *
-   ************************************************************************* */
-
-  /** Create iterators over ui_F?. */
-  std::vector< CoefficientImageIteratorType > itA( ImageDimension ),
-  itB( ImageDimension ), itC( ImageDimension ),
-  itD( ImageDimension ), itE( ImageDimension ),
-  itF( ImageDimension ), itG( ImageDimension ),
-  itH( ImageDimension ), itI( ImageDimension );
-
-  /** Create iterators. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    /** Create iterators. */
-    itA[ i ] = CoefficientImageIteratorType( ui_FA[ i ], ui_FA[ i ]->GetLargestPossibleRegion() );
-    itB[ i ] = CoefficientImageIteratorType( ui_FB[ i ], ui_FB[ i ]->GetLargestPossibleRegion() );
-    itD[ i ] = CoefficientImageIteratorType( ui_FD[ i ], ui_FD[ i ]->GetLargestPossibleRegion() );
-    itE[ i ] = CoefficientImageIteratorType( ui_FE[ i ], ui_FE[ i ]->GetLargestPossibleRegion() );
-    itG[ i ] = CoefficientImageIteratorType( ui_FG[ i ], ui_FG[ i ]->GetLargestPossibleRegion() );
-    if( ImageDimension == 3 )
-    {
-      itC[ i ] = CoefficientImageIteratorType( ui_FC[ i ], ui_FC[ i ]->GetLargestPossibleRegion() );
-      itF[ i ] = CoefficientImageIteratorType( ui_FF[ i ], ui_FF[ i ]->GetLargestPossibleRegion() );
-      itH[ i ] = CoefficientImageIteratorType( ui_FH[ i ], ui_FH[ i ]->GetLargestPossibleRegion() );
-      itI[ i ] = CoefficientImageIteratorType( ui_FI[ i ], ui_FI[ i ]->GetLargestPossibleRegion() );
-    }
-    /** Reset iterators. */
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    itD[ i ].GoToBegin(); itE[ i ].GoToBegin(); itG[ i ].GoToBegin();
-    if( ImageDimension == 3 )
-    {
-      itC[ i ].GoToBegin(); itF[ i ].GoToBegin();
-      itH[ i ].GoToBegin(); itI[ i ].GoToBegin();
-    }
-  }
-
-  /** TASK 4A:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the orthonormality term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculateOrthonormalityCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    while( !itA[ 0 ].IsAtEnd() )
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
-
-      if( ImageDimension == 2 )
-      {
-        this->m_OrthonormalityConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B ),
-          2.0 )
-          );
-      }
-      else if( ImageDimension == 3 )
-      {
-        this->m_OrthonormalityConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          + mu3_A * mu3_A
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B )
-          + mu3_A * mu3_B,
-          2.0 )
-          + std::pow(
-          +( 1.0 + mu1_A ) * mu1_C
-          + mu2_A * mu2_C
-          + mu3_A * ( 1.0 + mu3_C ),
-          2.0 )
-          + std::pow(
-          +mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu3_B * mu3_B
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +mu1_B * mu1_C
-          + ( 1.0 + mu2_B ) * mu2_C
-          + mu3_B * ( 1.0 + mu3_C ),
-          2.0 )
-          + std::pow(
-          +mu1_C * mu1_C
-          + mu2_C * mu2_C
-          + ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - 1.0,
-          2.0 ) );
-      }
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ]; ++itB[ i ];
-        if( ImageDimension == 3 ) { ++itC[ i ]; }
-      }
-      ++it_RCI;
-    } // end while
-  } // end if do orthonormality
-
-  /** TASK 4B:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the properness term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    if( ImageDimension == 3 ) { itC[ i ].GoToBegin(); }
-  }
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculatePropernessCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    while( !itA[ 0 ].IsAtEnd() )
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
-
-      if( ImageDimension == 2 )
-      {
-        this->m_PropernessConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          +( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          - mu2_A * mu1_B
-          - 1.0,
-          2.0 )
-          );
-      }
-      else if( ImageDimension == 3 )
-      {
-        this->m_PropernessConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          -mu1_C * ( 1.0 + mu2_B ) * mu3_A
-          + mu1_B * mu2_C * mu3_A
-          + mu1_C * mu2_A * mu3_B
-          - ( 1.0 + mu1_A ) * mu2_C * mu3_B
-          - mu1_B * mu2_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          - 1.0,
-          2.0 )
-          );
-      }
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ]; ++itB[ i ];
-        if( ImageDimension == 3 ) { ++itC[ i ]; }
-      }
-      ++it_RCI;
-
-    } // end while
-  } // end if do properness
-
-  /** TASK 4C:
-   * Do the actual calculation of the rigidity penalty term value.
-   * Calculate the linearity term.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculateLinearityCondition )
-  {
-    while( !itD[ 0 ].IsAtEnd() )
-    {
-      /** Linearity condition part. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        this->m_LinearityConditionValue
-          += it_RCI.Get() * (
-          +itD[ i ].Get() * itD[ i ].Get()
-          + itE[ i ].Get() * itE[ i ].Get()
-          + itG[ i ].Get() * itG[ i ].Get()
-          );
-        if( ImageDimension == 3 )
-        {
-          this->m_LinearityConditionValue
-            += it_RCI.Get() * (
-            +itF[ i ].Get() * itF[ i ].Get()
-            + itH[ i ].Get() * itH[ i ].Get()
-            + itI[ i ].Get() * itI[ i ].Get()
-            );
-        }
-      } // end loop over i
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itD[ i ]; ++itE[ i ]; ++itG[ i ];
-        if( ImageDimension == 3 )
-        {
-          ++itF[ i ]; ++itH[ i ]; ++itI[ i ];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
-  } // end if do properness
-
-  /** TASK 5:
    * Do the actual calculation of the rigidity penalty term value.
    *
    ************************************************************************* */
@@ -979,790 +648,25 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
     itkExceptionMacro( << "ERROR: This filter is only implemented for dimension 2 and 3." );
   }
 
-  /** Get a handle to the B-spline coefficient images. */
-  std::vector< CoefficientImagePointer > inputImages( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    inputImages[ i ] = this->m_BSplineTransform->GetCoefficientImages()[ i ];
-  }
-
-  /** Get the B-spline coefficient image spacing. */
-  CoefficientImageSpacingType spacing = inputImages[ 0 ]->GetSpacing();
-
-  /** TASK 0:
-   * Compute the rigidityCoefficientSum and check on it.
+  /** TASK 1:
+   * Compute the condition values and the derivative in a fused pass
+   * over the B-spline grid.
    *
    ************************************************************************* */
 
-  /** Create iterator over the rigidity coeficient image. */
-  CoefficientImageIteratorType it_RCI( this->m_RigidityCoefficientImage,
-  this->m_RigidityCoefficientImage->GetLargestPossibleRegion() );
-  it_RCI.GoToBegin();
-  ScalarType rigidityCoefficientSum = NumericTraits< ScalarType >::Zero;
-
-  /** Add the rigidity coefficients together. */
-  while( !it_RCI.IsAtEnd() )
-  {
-    rigidityCoefficientSum += it_RCI.Get();
-    ++it_RCI;
-  }
+  const ScalarType rigidityCoefficientSum = this->ComputeFusedStencils( &derivative );
 
   /** Check for early termination. */
   if( rigidityCoefficientSum < 1e-14 )
   {
-    this->m_RigidityPenaltyTermValue = NumericTraits< MeasureType >::Zero;
+    this->m_LinearityConditionValue      = NumericTraits< MeasureType >::Zero;
+    this->m_OrthonormalityConditionValue = NumericTraits< MeasureType >::Zero;
+    this->m_PropernessConditionValue     = NumericTraits< MeasureType >::Zero;
+    this->m_RigidityPenaltyTermValue     = NumericTraits< MeasureType >::Zero;
     return;
   }
 
-  /** TASK 1:
-   * Prepare for the calculation of the rigidity penalty term.
-   *
-   ************************************************************************* */
-
-  /** Create 1D neighbourhood operators. */
-  std::vector< NeighborhoodType > Operators_A( ImageDimension ),
-  Operators_B( ImageDimension ), Operators_C( ImageDimension ),
-  Operators_D( ImageDimension ), Operators_E( ImageDimension ),
-  Operators_F( ImageDimension ), Operators_G( ImageDimension ),
-  Operators_H( ImageDimension ), Operators_I( ImageDimension );
-
-  /** Create B-spline coefficient images that are filtered once. */
-  std::vector< CoefficientImagePointer > ui_FA( ImageDimension ),
-  ui_FB( ImageDimension ), ui_FC( ImageDimension ),
-  ui_FD( ImageDimension ), ui_FE( ImageDimension ),
-  ui_FF( ImageDimension ), ui_FG( ImageDimension ),
-  ui_FH( ImageDimension ), ui_FI( ImageDimension );
-
-  /** For all dimensions ... */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    /** ... create the filtered images ... */
-    ui_FA[ i ] = CoefficientImageType::New();
-    ui_FB[ i ] = CoefficientImageType::New();
-    ui_FD[ i ] = CoefficientImageType::New();
-    ui_FE[ i ] = CoefficientImageType::New();
-    ui_FG[ i ] = CoefficientImageType::New();
-    if( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = CoefficientImageType::New();
-      ui_FF[ i ] = CoefficientImageType::New();
-      ui_FH[ i ] = CoefficientImageType::New();
-      ui_FI[ i ] = CoefficientImageType::New();
-    }
-    /** ... and the apropiate operators.
-     * The operators C, D and E from the paper are here created
-     * by Create1DOperator D, E and G, because of the 3D case and history.
-     */
-    this->Create1DOperator( Operators_A[ i ], "FA_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_B[ i ], "FB_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_D[ i ], "FD_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_E[ i ], "FE_xi", i + 1, spacing );
-    this->Create1DOperator( Operators_G[ i ], "FG_xi", i + 1, spacing );
-    if( ImageDimension == 3 )
-    {
-      this->Create1DOperator( Operators_C[ i ], "FC_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_F[ i ], "FF_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_H[ i ], "FH_xi", i + 1, spacing );
-      this->Create1DOperator( Operators_I[ i ], "FI_xi", i + 1, spacing );
-    }
-  } // end for loop
-
   /** TASK 2:
-   * Filter the B-spline coefficient images.
-   *
-   ************************************************************************* */
-
-  /** Filter the inputImages. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    ui_FA[ i ] = this->FilterSeparable( inputImages[ i ], Operators_A );
-    ui_FB[ i ] = this->FilterSeparable( inputImages[ i ], Operators_B );
-    ui_FD[ i ] = this->FilterSeparable( inputImages[ i ], Operators_D );
-    ui_FE[ i ] = this->FilterSeparable( inputImages[ i ], Operators_E );
-    ui_FG[ i ] = this->FilterSeparable( inputImages[ i ], Operators_G );
-    if( ImageDimension == 3 )
-    {
-      ui_FC[ i ] = this->FilterSeparable( inputImages[ i ], Operators_C );
-      ui_FF[ i ] = this->FilterSeparable( inputImages[ i ], Operators_F );
-      ui_FH[ i ] = this->FilterSeparable( inputImages[ i ], Operators_H );
-      ui_FI[ i ] = this->FilterSeparable( inputImages[ i ], Operators_I );
-    }
-  }
-
-  /** TASK 3:
-   * Create subparts and iterators.
-   *
-   ************************************************************************* */
-
-  /** Create iterators over ui_F?. */
-  std::vector< CoefficientImageIteratorType > itA( ImageDimension ),
-  itB( ImageDimension ), itC( ImageDimension ),
-  itD( ImageDimension ), itE( ImageDimension ),
-  itF( ImageDimension ), itG( ImageDimension ),
-  itH( ImageDimension ), itI( ImageDimension );
-
-  /** Create iterators. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    /** Create iterators. */
-    itA[ i ] = CoefficientImageIteratorType( ui_FA[ i ], ui_FA[ i ]->GetLargestPossibleRegion() );
-    itB[ i ] = CoefficientImageIteratorType( ui_FB[ i ], ui_FB[ i ]->GetLargestPossibleRegion() );
-    itD[ i ] = CoefficientImageIteratorType( ui_FD[ i ], ui_FD[ i ]->GetLargestPossibleRegion() );
-    itE[ i ] = CoefficientImageIteratorType( ui_FE[ i ], ui_FE[ i ]->GetLargestPossibleRegion() );
-    itG[ i ] = CoefficientImageIteratorType( ui_FG[ i ], ui_FG[ i ]->GetLargestPossibleRegion() );
-    if( ImageDimension == 3 )
-    {
-      itC[ i ] = CoefficientImageIteratorType( ui_FC[ i ], ui_FC[ i ]->GetLargestPossibleRegion() );
-      itF[ i ] = CoefficientImageIteratorType( ui_FF[ i ], ui_FF[ i ]->GetLargestPossibleRegion() );
-      itH[ i ] = CoefficientImageIteratorType( ui_FH[ i ], ui_FH[ i ]->GetLargestPossibleRegion() );
-      itI[ i ] = CoefficientImageIteratorType( ui_FI[ i ], ui_FI[ i ]->GetLargestPossibleRegion() );
-    }
-    /** Reset iterators. */
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    itD[ i ].GoToBegin(); itE[ i ].GoToBegin(); itG[ i ].GoToBegin();
-    if( ImageDimension == 3 )
-    {
-      itC[ i ].GoToBegin(); itF[ i ].GoToBegin();
-      itH[ i ].GoToBegin(); itI[ i ].GoToBegin();
-    }
-  }
-
-  /** Create orthonormality and properness parts. */
-  std::vector< std::vector< CoefficientImagePointer > > OCparts( ImageDimension );
-  std::vector< std::vector< CoefficientImagePointer > > PCparts( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    OCparts[ i ].resize( ImageDimension );
-    PCparts[ i ].resize( ImageDimension );
-    for( unsigned int j = 0; j < ImageDimension; j++ )
-    {
-      OCparts[ i ][ j ] = CoefficientImageType::New();
-      OCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      OCparts[ i ][ j ]->Allocate();
-      PCparts[ i ][ j ] = CoefficientImageType::New();
-      PCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      PCparts[ i ][ j ]->Allocate();
-    }
-  }
-
-  /** Create linearity parts. */
-  unsigned int                                          NofLParts = 3 * ImageDimension - 3;
-  std::vector< std::vector< CoefficientImagePointer > > LCparts( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    LCparts[ i ].resize( NofLParts );
-    for( unsigned int j = 0; j < NofLParts; j++ )
-    {
-      LCparts[ i ][ j ] = CoefficientImageType::New();
-      LCparts[ i ][ j ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-      LCparts[ i ][ j ]->Allocate();
-    }
-  }
-
-  /** Create iterators over all parts. */
-  std::vector< std::vector< CoefficientImageIteratorType > > itOCp( ImageDimension );
-  std::vector< std::vector< CoefficientImageIteratorType > > itPCp( ImageDimension );
-  std::vector< std::vector< CoefficientImageIteratorType > > itLCp( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itOCp[ i ].resize( ImageDimension );
-    itPCp[ i ].resize( ImageDimension );
-    itLCp[ i ].resize( NofLParts );
-    for( unsigned int j = 0; j < ImageDimension; j++ )
-    {
-      itOCp[ i ][ j ] = CoefficientImageIteratorType( OCparts[ i ][ j ],
-        OCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      itOCp[ i ][ j ].GoToBegin();
-      itPCp[ i ][ j ] = CoefficientImageIteratorType( PCparts[ i ][ j ],
-        PCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      itPCp[ i ][ j ].GoToBegin();
-    }
-    for( unsigned int j = 0; j < NofLParts; j++ )
-    {
-      itLCp[ i ][ j ] = CoefficientImageIteratorType( LCparts[ i ][ j ],
-        LCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      itLCp[ i ][ j ].GoToBegin();
-    }
-  }
-
-  /** TASK 4A:
-   * Do the calculation of the orthonormality subparts.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculateOrthonormalityCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    ScalarType valueOC;
-    while( !itOCp[ 0 ][ 0 ].IsAtEnd() )
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
-      if( ImageDimension == 2 )
-      {
-        /** Calculate the value of the orthonormality condition. */
-        this->m_OrthonormalityConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B ),
-          2.0 )
-          );
-        /** Calculate the derivative of the orthonormality condition. */
-        /** mu1, part 1 */
-        valueOC
-          = +2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + 2.0 * mu2_A * mu2_A * ( 1.0 + mu1_A )
-          - 2.0 * ( 1.0 + mu1_A )
-          + mu1_B * mu1_B * ( 1.0 + mu1_A )
-          + mu2_A * ( 1.0 + mu2_B ) * mu1_B;
-        itOCp[ 0 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu1, part2*/
-        valueOC
-          = +mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A )
-          + 2.0 * mu1_B * mu1_B * mu1_B
-          + 2.0 * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          - 2.0 * mu1_B;
-        itOCp[ 0 ][ 1 ].Set( 2.0 * valueOC );
-        /** mu2, part 1 */
-        valueOC
-          = +2.0 * mu2_A * mu2_A * mu2_A
-          + 2.0 * mu2_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          - 2.0 * mu2_A
-          + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
-        itOCp[ 1 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu2, part2*/
-        valueOC
-          = +mu2_A * mu2_A * ( 1.0 + mu2_B )
-          + mu1_B * ( 1.0 + mu1_A ) * mu2_A
-          + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + 2.0 * mu1_B * mu1_B * ( 1.0 + mu2_B )
-          - 2.0 * ( 1.0 + mu2_B );
-        itOCp[ 1 ][ 1 ].Set( 2.0 * valueOC );
-      } // end if dim == 2
-      else if( ImageDimension == 3 )
-      {
-        /** Calculate the value of the orthonormality condition. */
-        this->m_OrthonormalityConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + mu2_A * mu2_A
-          + mu3_A * mu3_A
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +( 1.0 + mu1_A ) * mu1_B
-          + mu2_A * ( 1.0 + mu2_B )
-          + mu3_A * mu3_B,
-          2.0 )
-          + std::pow(
-          +( 1.0 + mu1_A ) * mu1_C
-          + mu2_A * mu2_C
-          + mu3_A * ( 1.0 + mu3_C ),
-          2.0 )
-          + std::pow(
-          +mu1_B * mu1_B
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu3_B * mu3_B
-          - 1.0,
-          2.0 )
-          + std::pow(
-          +mu1_B * mu1_C
-          + ( 1.0 + mu2_B ) * mu2_C
-          + mu3_B * ( 1.0 + mu3_C ),
-          2.0 )
-          + std::pow(
-          +mu1_C * mu1_C
-          + mu2_C * mu2_C
-          + ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - 1.0,
-          2.0 ) );
-        /** Calculate the derivative of the orthonormality condition. */
-        /** mu1, part 1 */
-        valueOC
-          = +2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          + 2.0 * mu2_A * mu2_A * ( 1.0 + mu1_A )
-          + 2.0 * ( 1.0 + mu1_A ) * mu3_A * mu3_A
-          - 2.0 * ( 1.0 + mu1_A )
-          + mu1_B * mu1_B * ( 1.0 + mu1_A )
-          + mu2_A * ( 1.0 + mu2_B ) * mu1_B
-          + mu1_B * mu3_A * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_C * mu1_C
-          + mu1_C * mu2_A * mu2_C
-          + mu1_C * mu3_A * ( 1.0 + mu3_C );
-        itOCp[ 0 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu1, part2 */
-        valueOC
-          = +( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_B
-          + ( 1.0 + mu1_A ) * mu2_A * mu3_B
-          + ( 1.0 + mu1_A ) * mu3_A * mu3_B
-          + mu1_B * mu1_B * mu1_B
-          + mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu1_B * mu3_B * mu3_B
-          - mu1_B
-          + mu1_B * mu1_C * mu1_C
-          + mu1_C * ( 1.0 + mu2_B ) * mu2_C
-          + mu1_C * mu3_B * ( 1.0 + mu3_C );
-        itOCp[ 0 ][ 1 ].Set( 2.0 * valueOC );
-        /** mu1, part3 */
-        valueOC
-          = +( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_C
-          + ( 1.0 + mu1_A ) * mu2_A * mu2_C
-          + ( 1.0 + mu1_A ) * mu3_A * ( 1.0 + mu3_C )
-          + mu1_B * mu1_B * mu1_C
-          + mu1_B * ( 1.0 + mu2_B ) * mu2_C
-          + mu1_B * mu3_B * ( 1.0 + mu3_C )
-          + 2.0 * mu1_C * mu1_C * mu1_C
-          + 2.0 * mu1_C * mu2_C * mu2_C
-          + 2.0 * mu1_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - 2.0 * mu1_C;
-        itOCp[ 0 ][ 2 ].Set( 2.0 * valueOC );
-        /** mu2, part 1 */
-        valueOC
-          = +2.0 * mu2_A * mu2_A * mu2_A
-          + 2.0 * mu2_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          - 2.0 * mu2_A
-          + 2.0 * mu2_A * mu3_A * mu3_A
-          + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          + ( 1.0 + mu2_B ) * mu3_A * mu3_B
-          + mu2_A * mu2_C * mu2_C
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_C
-          + mu2_C * mu3_A * ( 1.0 + mu3_C );
-        itOCp[ 1 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu2, part2 */
-        valueOC
-          = +mu2_A * mu2_A * ( 1.0 + mu2_B )
-          + mu1_B * ( 1.0 + mu1_A ) * mu2_A
-          + mu2_A * mu3_A * mu3_B
-          + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
-          + 2.0 * mu1_B * mu1_B * ( 1.0 + mu2_B )
-          - 2.0 * ( 1.0 + mu2_B )
-          + 2.0 * ( 1.0 + mu2_B ) * mu3_B * mu3_B
-          + ( 1.0 + mu2_B ) * mu2_C * mu2_C
-          + mu1_B * mu1_C * mu2_C
-          + mu2_C * mu3_B * ( 1.0 + mu3_C );
-        itOCp[ 1 ][ 1 ].Set( 2.0 * valueOC );
-        /** mu2, part 3 */
-        valueOC
-          = +mu2_A * mu2_A * mu2_C
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_A
-          + mu2_A * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu2_C
-          + mu1_B * mu1_C * mu2_B
-          + ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          + 2.0 * mu2_C * mu2_C * mu2_C
-          + 2.0 * mu1_C * mu1_C * mu2_C
-          + 2.0 * mu2_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - 2.0 * mu2_C;
-        itOCp[ 1 ][ 2 ].Set( 2.0 * valueOC );
-        /** mu3, part 1 */
-        valueOC
-          = +2.0 * mu3_A * mu3_A * mu3_A
-          + 2.0 * mu3_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
-          - 2.0 * mu3_A
-          + 2.0 * mu2_A * mu2_A * mu3_A
-          + mu3_A * mu3_B * mu3_B
-          + mu1_B * ( 1.0 + mu1_A ) * mu3_B
-          + ( 1.0 + mu2_B ) * mu2_A * mu3_B
-          + mu3_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu3_C )
-          + mu2_C * mu2_A * ( 1.0 + mu3_C );
-        itOCp[ 2 ][ 0 ].Set( 2.0 * valueOC );
-        /** mu3, part2 */
-        valueOC
-          = +mu3_A * mu3_A * mu3_B
-          + mu1_B * ( 1.0 + mu1_A ) * mu3_A
-          + mu2_A * mu3_A * ( 1.0 + mu2_B )
-          + 2.0 *  mu3_B *  mu3_B *  mu3_B
-          + 2.0 * mu1_B * mu1_B *  mu3_B
-          - 2.0 *  mu3_B
-          + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_B
-          + mu3_B * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + mu1_B * mu1_C * ( 1.0 + mu3_C )
-          + mu2_C * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
-        itOCp[ 2 ][ 1 ].Set( 2.0 * valueOC );
-        /** mu3, part 3 */
-        valueOC
-          = +mu3_A * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * mu3_A
-          + mu2_A * mu3_A * mu2_C
-          + mu3_B * mu3_B * ( 1.0 + mu3_C )
-          + mu1_B * mu1_C * mu3_B
-          + ( 1.0 + mu2_B ) * mu3_B * mu2_C
-          + 2.0 * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + 2.0 * mu1_C * mu1_C * ( 1.0 + mu3_C )
-          + 2.0 * mu2_C * mu2_C * ( 1.0 + mu3_C )
-          - 2.0 * ( 1.0 + mu3_C );
-        itOCp[ 2 ][ 2 ].Set( 2.0 * valueOC );
-      } // end if dim == 3
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ]; ++itB[ i ];
-        if( ImageDimension == 3 ) { ++itC[ i ]; }
-        for( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++itOCp[ i ][ j ];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
-  } // end if do orthonormality
-
-  /** TASK 4B:
-   * Do the calculation of the properness parts.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itA[ i ].GoToBegin(); itB[ i ].GoToBegin();
-    if( ImageDimension == 3 ) { itC[ i ].GoToBegin(); }
-  }
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculatePropernessCondition )
-  {
-    ScalarType mu1_A, mu2_A, mu3_A, mu1_B, mu2_B, mu3_B, mu1_C, mu2_C, mu3_C;
-    ScalarType valuePC;
-    while( !itPCp[ 0 ][ 0 ].IsAtEnd() )
-    {
-      /** Copy values: this way we avoid calling Get() so many times.
-       * It also improves code readability.
-       */
-      mu1_A = itA[ 0 ].Get(); mu2_A = itA[ 1 ].Get();
-      mu1_B = itB[ 0 ].Get(); mu2_B = itB[ 1 ].Get();
-      if( ImageDimension == 3 )
-      {
-        mu3_A = itA[ 2 ].Get(); mu3_B = itB[ 2 ].Get();
-        mu1_C = itC[ 0 ].Get(); mu2_C = itC[ 1 ].Get(); mu3_C = itC[ 2 ].Get();
-      }
-      if( ImageDimension == 2 )
-      {
-        /** Calculate the value of the properness condition. */
-        this->m_PropernessConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          +( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          - mu2_A * mu1_B
-          - 1.0,
-          2.0 )
-          );
-        /** Calculate the derivative of the properness condition. */
-        /** mu1, part 1 */
-        valuePC
-          = +( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A )
-          - mu2_A * ( 1.0 + mu2_B ) * mu1_B
-          - ( 1.0 + mu2_B );
-        itPCp[ 0 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu1, part 2 */
-        valuePC
-          = +mu2_A
-          + mu2_A * mu2_A * mu1_B
-          - mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A );
-        itPCp[ 0 ][ 1 ].Set( 2.0 * valuePC );
-        /** mu2, part 1 */
-        valuePC
-          = +mu1_B * mu1_B * mu2_A
-          - mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          + mu1_B;
-        itPCp[ 1 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu2, part 2 */
-        valuePC
-          = -( 1.0 + mu1_A )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
-          - mu1_B * ( 1.0 + mu1_A ) * mu2_A;
-        itPCp[ 1 ][ 1 ].Set( 2.0 * valuePC );
-      } // end if dim == 2
-      else if( ImageDimension == 3 )
-      {
-        /** Calculate the value of the properness condition. */
-        this->m_PropernessConditionValue
-          += it_RCI.Get() * (
-          std::pow(
-          -mu1_C * ( 1.0 + mu2_B ) * mu3_A
-          + mu1_B * mu2_C * mu3_A
-          + mu1_C * mu2_A * mu3_B
-          - ( 1.0 + mu1_A ) * mu2_C * mu3_B
-          - mu1_B * mu2_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          - 1.0,
-          2.0 )
-          );
-        /** Calculate the derivative of the properness condition. */
-        /** mu1, part 1 */
-        valuePC
-          = +( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_B * mu3_B
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_B
-          - mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          - mu1_B * mu2_C * mu2_C * mu3_A * mu3_B
-          + mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          - mu1_C * mu2_A * mu2_C * mu3_B * mu3_B
-          + mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          + mu1_B * mu2_A * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          - 2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          + mu2_C * mu3_B
-          - mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
-        itPCp[ 0 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu1, part 2 */
-        valuePC
-          = +mu1_B * mu2_C * mu2_C * mu3_A * mu3_A
-          + mu1_B * mu2_A * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_A
-          + mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          + mu1_C * mu2_A * mu2_C * mu3_A * mu3_B
-          - ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_A * mu3_B
-          - 2.0 * mu1_B * mu2_A * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          - mu2_C * mu3_A
-          - mu1_C * mu2_A * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu2_A * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + mu2_A * ( 1.0 + mu3_C );
-        itPCp[ 0 ][ 1 ].Set( 2.0 * valuePC );
-        /** mu1, part 3 */
-        valuePC
-          = +mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * mu3_A
-          + mu1_C * mu2_A * mu2_A * mu3_B * mu3_B
-          - mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_A
-          - 2.0 * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A * mu3_B
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_B
-          + mu1_B * mu2_A * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu2_B ) * mu3_A
-          + mu1_B * mu2_A * mu2_C * mu3_A * mu3_B
-          - ( 1.0 + mu1_A ) * mu2_A * mu2_C * mu3_B * mu3_B
-          - mu1_B * mu2_A * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          - mu2_A * mu3_B;
-        itPCp[ 0 ][ 2 ].Set( 2.0 * valuePC );
-        /** mu2, part 1 */
-        valuePC
-          = +mu1_C * mu1_C * mu2_A * mu3_B * mu3_B
-          + mu1_B * mu1_B * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - mu1_C * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_B
-          + mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          + mu1_B * mu1_C * mu2_C * mu3_A * mu3_B
-          - mu1_B * mu1_B * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu1_C * mu2_C * mu3_B * mu3_B
-          - 2.0 * mu1_B * mu1_C * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          - mu1_C * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          + mu1_B * ( 1.0 + mu3_C );
-        itPCp[ 1 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu2, part 2 */
-        valuePC
-          = +mu1_C * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_A
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - mu1_B * mu1_C * mu2_C * mu3_A * mu3_A
-          - mu1_C * mu1_C * mu2_A * mu3_A * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_C * mu3_A * mu3_B
-          + mu1_B * mu1_C * mu2_A * mu3_A * ( 1.0 + mu3_C )
-          - 2.0 * ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          + mu1_C * mu3_A
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu3_C );
-        itPCp[ 1 ][ 1 ].Set( 2.0 * valuePC );
-        /** mu2, part 3 */
-        valuePC
-          = +mu1_B * mu1_B * mu2_C * mu3_A * mu3_A
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu3_B * mu3_B
-          - mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_A
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_B
-          + mu1_B * mu1_C * mu2_A * mu3_A * mu3_B
-          - 2.0 * ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_A * mu3_B
-          - mu1_B * mu1_B * mu2_A * mu3_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
-          - mu1_B * mu3_A
-          - ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu3_B * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu3_B * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu3_B;
-        itPCp[ 1 ][ 2 ].Set( 2.0 * valuePC );
-        /** mu3, part 1 */
-        valuePC
-          = +mu1_C * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A
-          + mu1_B * mu1_B * mu2_C * mu2_C * mu3_A
-          - 2.0 * mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A
-          - mu1_C * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_B
-          + mu1_B * mu1_C * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          + mu1_C * ( 1.0 + mu2_B )
-          + mu1_B * mu1_C * mu2_A * mu2_C * mu3_B
-          - ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu2_C * mu3_B
-          - mu1_B * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
-          + mu1_B * mu2_C;
-        itPCp[ 2 ][ 0 ].Set( 2.0 * valuePC );
-        /** mu3, part 2 */
-        valuePC
-          = +mu1_C * mu1_C * mu2_A * mu2_A * mu3_B
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_B
-          - mu1_C * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A
-          + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A
-          + mu1_B * mu1_C * mu2_A * mu2_C * mu3_A
-          - ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu2_C * mu3_A
-          - 2.0 * ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu2_C * mu3_B
-          - mu1_B * mu1_C * mu2_A * mu2_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          - mu1_C * mu2_A
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * mu2_C;
-        itPCp[ 2 ][ 1 ].Set( 2.0 * valuePC );
-        /** mu3, part 3 */
-        valuePC
-          = +mu1_B * mu1_B * mu2_A * mu2_A * ( 1.0 + mu3_C )
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          + mu1_B * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A
-          - ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A
-          - mu1_B * mu1_B * mu2_A * mu2_C * mu3_A
-          + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A
-          - mu1_B * mu1_C * mu2_A * mu2_A * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B
-          + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu2_C * mu3_B
-          + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_B
-          - 2.0 * ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
-          + mu1_B * mu2_A
-          - ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
-        itPCp[ 2 ][ 2 ].Set( 2.0 * valuePC );
-      } // end if dim == 3
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itA[ i ]; ++itB[ i ];
-        if( ImageDimension == 3 ) { ++itC[ i ]; }
-        for( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++itPCp[ i ][ j ];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
-  } // end if do properness
-
-  /** TASK 4C:
-   * Do the calculation of the linearity parts.
-   *
-   ************************************************************************* */
-
-  /** Reset all iterators. */
-  it_RCI.GoToBegin();
-
-  if( this->m_CalculateLinearityCondition )
-  {
-    while( !itLCp[ 0 ][ 0 ].IsAtEnd() )
-    {
-      /** Linearity condition part. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        /** Calculate the value of the linearity condition. */
-        this->m_LinearityConditionValue
-          += it_RCI.Get() * (
-          +itD[ i ].Get() * itD[ i ].Get()
-          + itE[ i ].Get() * itE[ i ].Get()
-          + itG[ i ].Get() * itG[ i ].Get()
-          );
-        if( ImageDimension == 3 )
-        {
-          this->m_LinearityConditionValue
-            += it_RCI.Get() * (
-            +itF[ i ].Get() * itF[ i ].Get()
-            + itH[ i ].Get() * itH[ i ].Get()
-            + itI[ i ].Get() * itI[ i ].Get()
-            );
-        }
-      } // end loop over i
-
-      /** Calculate the derivative of the linearity condition. */
-      if( ImageDimension == 2 )
-      {
-        itLCp[ 0 ][ 0 ].Set( 2.0 * itD[ 0 ].Get() );
-        itLCp[ 0 ][ 1 ].Set( 2.0 * itE[ 0 ].Get() );
-        itLCp[ 0 ][ 2 ].Set( 2.0 * itG[ 0 ].Get() );
-        itLCp[ 1 ][ 0 ].Set( 2.0 * itD[ 1 ].Get() );
-        itLCp[ 1 ][ 1 ].Set( 2.0 * itE[ 1 ].Get() );
-        itLCp[ 1 ][ 2 ].Set( 2.0 * itG[ 1 ].Get() );
-      } // end if dim == 2
-      else if( ImageDimension == 3 )
-      {
-        itLCp[ 0 ][ 0 ].Set( 2.0 * itD[ 0 ].Get() );
-        itLCp[ 0 ][ 1 ].Set( 2.0 * itE[ 0 ].Get() );
-        itLCp[ 0 ][ 2 ].Set( 2.0 * itG[ 0 ].Get() );
-        itLCp[ 0 ][ 3 ].Set( 2.0 * itF[ 0 ].Get() );
-        itLCp[ 0 ][ 4 ].Set( 2.0 * itH[ 0 ].Get() );
-        itLCp[ 0 ][ 5 ].Set( 2.0 * itI[ 0 ].Get() );
-        itLCp[ 1 ][ 0 ].Set( 2.0 * itD[ 1 ].Get() );
-        itLCp[ 1 ][ 1 ].Set( 2.0 * itE[ 1 ].Get() );
-        itLCp[ 1 ][ 2 ].Set( 2.0 * itG[ 1 ].Get() );
-        itLCp[ 1 ][ 3 ].Set( 2.0 * itF[ 1 ].Get() );
-        itLCp[ 1 ][ 4 ].Set( 2.0 * itH[ 1 ].Get() );
-        itLCp[ 1 ][ 5 ].Set( 2.0 * itI[ 1 ].Get() );
-        itLCp[ 2 ][ 0 ].Set( 2.0 * itD[ 2 ].Get() );
-        itLCp[ 2 ][ 1 ].Set( 2.0 * itE[ 2 ].Get() );
-        itLCp[ 2 ][ 2 ].Set( 2.0 * itG[ 2 ].Get() );
-        itLCp[ 2 ][ 3 ].Set( 2.0 * itF[ 2 ].Get() );
-        itLCp[ 2 ][ 4 ].Set( 2.0 * itH[ 2 ].Get() );
-        itLCp[ 2 ][ 5 ].Set( 2.0 * itI[ 2 ].Get() );
-      } // end if dim == 3
-
-      /** Increase all iterators. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itD[ i ]; ++itE[ i ]; ++itG[ i ];
-        if( ImageDimension == 3 )
-        {
-          ++itF[ i ]; ++itH[ i ]; ++itI[ i ];
-        }
-        for( unsigned int j = 0; j < NofLParts; j++ )
-        {
-          ++itLCp[ i ][ j ];
-        }
-      }
-      ++it_RCI;
-
-    } // end while
-  } // end if do linearity
-
-  /** TASK 5:
    * Do the actual calculation of the rigidity penalty term value.
    *
    ************************************************************************* */
@@ -1798,357 +702,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   }
   value = this->m_RigidityPenaltyTermValue;
 
-  /** TASK 6:
-   * Create filtered versions of the subparts.
-   * Create all necessary iterators and operators.
-   ************************************************************************* */
-
-  /** Create filtered orthonormality, properness and linearity parts. */
-  std::vector< CoefficientImagePointer > OCpartsF( ImageDimension );
-  std::vector< CoefficientImagePointer > PCpartsF( ImageDimension );
-  std::vector< CoefficientImagePointer > LCpartsF( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    OCpartsF[ i ] = CoefficientImageType::New();
-    OCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    OCpartsF[ i ]->Allocate();
-    PCpartsF[ i ] = CoefficientImageType::New();
-    PCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    PCpartsF[ i ]->Allocate();
-    LCpartsF[ i ] = CoefficientImageType::New();
-    LCpartsF[ i ]->SetRegions( inputImages[ 0 ]->GetLargestPossibleRegion() );
-    LCpartsF[ i ]->Allocate();
-  }
-
-  /** Create neighborhood iterators over the subparts. */
-  std::vector< std::vector< NeighborhoodIteratorType > > nitOCp( ImageDimension );
-  std::vector< std::vector< NeighborhoodIteratorType > > nitPCp( ImageDimension );
-  std::vector< std::vector< NeighborhoodIteratorType > > nitLCp( ImageDimension );
-  RadiusType                                             radius;
-  radius.Fill( 1 );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    nitOCp[ i ].resize( ImageDimension );
-    nitPCp[ i ].resize( ImageDimension );
-    nitLCp[ i ].resize( NofLParts );
-    for( unsigned int j = 0; j < ImageDimension; j++ )
-    {
-      nitOCp[ i ][ j ] = NeighborhoodIteratorType( radius,
-        OCparts[ i ][ j ], OCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      nitOCp[ i ][ j ].GoToBegin();
-      nitPCp[ i ][ j ] = NeighborhoodIteratorType( radius,
-        PCparts[ i ][ j ], PCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      nitPCp[ i ][ j ].GoToBegin();
-    }
-    for( unsigned int j = 0; j < NofLParts; j++ )
-    {
-      nitLCp[ i ][ j ] = NeighborhoodIteratorType( radius,
-        LCparts[ i ][ j ], LCparts[ i ][ j ]->GetLargestPossibleRegion() );
-      nitLCp[ i ][ j ].GoToBegin();
-    }
-  }
-
-  /** Create iterators over the filtered parts. */
-  std::vector< CoefficientImageIteratorType > itOCpf( ImageDimension );
-  std::vector< CoefficientImageIteratorType > itPCpf( ImageDimension );
-  std::vector< CoefficientImageIteratorType > itLCpf( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itOCpf[ i ] = CoefficientImageIteratorType( OCpartsF[ i ],
-      OCpartsF[ i ]->GetLargestPossibleRegion() );
-    itOCpf[ i ].GoToBegin();
-    itPCpf[ i ] = CoefficientImageIteratorType( PCpartsF[ i ],
-      PCpartsF[ i ]->GetLargestPossibleRegion() );
-    itPCpf[ i ].GoToBegin();
-    itLCpf[ i ] = CoefficientImageIteratorType( LCpartsF[ i ],
-      LCpartsF[ i ]->GetLargestPossibleRegion() );
-    itLCpf[ i ].GoToBegin();
-  }
-
-  /** Create a neigborhood iterator over the rigidity image. */
-  NeighborhoodIteratorType nit_RCI( radius, this->m_RigidityCoefficientImage,
-  this->m_RigidityCoefficientImage->GetLargestPossibleRegion() );
-  nit_RCI.GoToBegin();
-  unsigned int neighborhoodSize = nit_RCI.Size();
-
-  /** Create ND operators. */
-  NeighborhoodType Operator_A, Operator_B, Operator_C,
-    Operator_D, Operator_E, Operator_F,
-    Operator_G, Operator_H, Operator_I;
-  this->CreateNDOperator( Operator_A, "FA", spacing );
-  this->CreateNDOperator( Operator_B, "FB", spacing );
-  if( ImageDimension == 3 )
-  {
-    this->CreateNDOperator( Operator_C, "FC", spacing );
-  }
-
-  if( this->m_CalculateLinearityCondition )
-  {
-    this->CreateNDOperator( Operator_D, "FD", spacing );
-    this->CreateNDOperator( Operator_E, "FE", spacing );
-    this->CreateNDOperator( Operator_G, "FG", spacing );
-    if( ImageDimension == 3 )
-    {
-      this->CreateNDOperator( Operator_F, "FF", spacing );
-      this->CreateNDOperator( Operator_H, "FH", spacing );
-      this->CreateNDOperator( Operator_I, "FI", spacing );
-    }
-  }
-
-  /** TASK 7A:
-   * Calculate the filtered versions of the orthonormality subparts.
-   * These are F_A * {subpart_0} + F_B * {subpart_1},
-   * and (for 3D) + F_C * {subpart_2}, for all dimensions.
-   ************************************************************************* */
-
-  if( this->m_CalculateOrthonormalityCondition )
-  {
-    while( !itOCpf[ 0 ].IsAtEnd() )
-    {
-      /** Create and reset tmp with zeros. */
-      std::vector< double > tmp( ImageDimension, 0.0 );
-
-      /** Loop over all dimensions. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        /** Loop over the neighborhood. */
-        for( unsigned int k = 0; k < neighborhoodSize; ++k )
-        {
-          /** Calculation of the inner product. */
-          tmp[ i ] += Operator_A.GetElement( k )      // FA *
-            * nitOCp[ i ][ 0 ].GetPixel( k )          // subpart[ i ][ 0 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          tmp[ i ] += Operator_B.GetElement( k )      // FB *
-            * nitOCp[ i ][ 1 ].GetPixel( k )          // subpart[ i ][ 1 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          if( ImageDimension == 3 )
-          {
-            tmp[ i ] += Operator_C.GetElement( k )    // FC *
-              * nitOCp[ i ][ 2 ].GetPixel( k )        // subpart[ i ][ 2 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-          }
-        } // end loop over neighborhood
-
-        /** Set the result in the filtered part. */
-        itOCpf[ i ].Set( tmp[ i ] );
-
-      } // end loop over dimension i
-
-      /** Increase all iterators. */
-      ++nit_RCI;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itOCpf[ i ];
-        for( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++nitOCp[ i ][ j ];
-        }
-      }
-    } // end while
-  } // end if do orthonormality
-
-  /** TASK 7B:
-   * Calculate the filtered versions of the properness subparts.
-   * These are F_A * {subpart_0} + F_B * {subpart_1},
-   * and (for 3D) + F_C * {subpart_2}, for all dimensions.
-   ************************************************************************* */
-
-  nit_RCI.GoToBegin();
-  if( this->m_CalculatePropernessCondition )
-  {
-    while( !itPCpf[ 0 ].IsAtEnd() )
-    {
-      /** Create and reset tmp with zeros. */
-      std::vector< double > tmp( ImageDimension, 0.0 );
-
-      /** Loop over all dimensions. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        /** Loop over the neighborhood. */
-        for( unsigned int k = 0; k < neighborhoodSize; ++k )
-        {
-          /** Calculation of the inner product. */
-          tmp[ i ] += Operator_A.GetElement( k )      // FA *
-            * nitPCp[ i ][ 0 ].GetPixel( k )          // subpart[ i ][ 0 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          tmp[ i ] += Operator_B.GetElement( k )      // FB *
-            * nitPCp[ i ][ 1 ].GetPixel( k )          // subpart[ i ][ 1 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          if( ImageDimension == 3 )
-          {
-            tmp[ i ] += Operator_C.GetElement( k )    // FC *
-              * nitPCp[ i ][ 2 ].GetPixel( k )        // subpart[ i ][ 2 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-          }
-        } // end loop over neighborhood
-
-        /** Set the result in the filtered part. */
-        itPCpf[ i ].Set( tmp[ i ] );
-
-      } // end loop over dimension i
-
-      /** Increase all iterators. */
-      ++nit_RCI;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itPCpf[ i ];
-        for( unsigned int j = 0; j < ImageDimension; j++ )
-        {
-          ++nitPCp[ i ][ j ];
-        }
-      }
-    } // end while
-  } // end if do properness
-
-  /** TASK 7C:
-   * Calculate the filtered versions of the linearity subparts.
-   * These are sum_{i=1}^{NofLParts} F_{D,E,G,F,H,I} * {subpart_i}.
-   ************************************************************************* */
-
-  nit_RCI.GoToBegin();
-  if( this->m_CalculateLinearityCondition )
-  {
-    while( !itLCpf[ 0 ].IsAtEnd() )
-    {
-      /** Create and reset tmp with zeros. */
-      std::vector< double > tmp( ImageDimension, 0.0 );
-
-      /** Loop over all dimensions. */
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        /** Loop over the neighborhood. */
-        for( unsigned int k = 0; k < neighborhoodSize; ++k )
-        {
-          /** Calculation of the inner product. */
-          tmp[ i ] += Operator_D.GetElement( k )      // FD *
-            * nitLCp[ i ][ 0 ].GetPixel( k )          // subpart[ i ][ 0 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          tmp[ i ] += Operator_E.GetElement( k )      // FE *
-            * nitLCp[ i ][ 1 ].GetPixel( k )          // subpart[ i ][ 1 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          tmp[ i ] += Operator_G.GetElement( k )      // FG *
-            * nitLCp[ i ][ 2 ].GetPixel( k )          // subpart[ i ][ 1 ]
-            * nit_RCI.GetPixel( k );                  // c(k)
-          if( ImageDimension == 3 )
-          {
-            tmp[ i ] += Operator_F.GetElement( k )    // FF *
-              * nitLCp[ i ][ 3 ].GetPixel( k )        // subpart[ i ][ 1 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-            tmp[ i ] += Operator_H.GetElement( k )    // FH *
-              * nitLCp[ i ][ 4 ].GetPixel( k )        // subpart[ i ][ 1 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-            tmp[ i ] += Operator_I.GetElement( k )    // FI *
-              * nitLCp[ i ][ 5 ].GetPixel( k )        // subpart[ i ][ 1 ]
-              * nit_RCI.GetPixel( k );                // c(k)
-          }
-        } // end loop over neighborhood
-
-        /** Set the result in the filtered part. */
-        itLCpf[ i ].Set( tmp[ i ] );
-
-      } // end loop over dimension i
-
-      /** Increase all iterators. */
-      ++nit_RCI;
-      for( unsigned int i = 0; i < ImageDimension; i++ )
-      {
-        ++itLCpf[ i ];
-        for( unsigned int j = 0; j < NofLParts; j++ )
-        {
-          ++nitLCp[ i ][ j ];
-        }
-      }
-    } // end while
-  } // end if do linearity
-
-  /** TASK 8:
-   * Add it all to create the final derivative images.
-   ************************************************************************* */
-
-  /** Create derivative images, each holding a component of the vector field. */
-  std::vector< CoefficientImagePointer > derivativeImages( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    derivativeImages[ i ] = CoefficientImageType::New();
-    derivativeImages[ i ]->SetRegions( inputImages[ i ]->GetLargestPossibleRegion() );
-    derivativeImages[ i ]->Allocate();
-  }
-
-  /** Create iterators over the derivative images. */
-  std::vector< CoefficientImageIteratorType > itDIs( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itDIs[ i ] = CoefficientImageIteratorType( derivativeImages[ i ],
-      derivativeImages[ i ]->GetLargestPossibleRegion() );
-    itDIs[ i ].GoToBegin();
-    itOCpf[ i ].GoToBegin();
-    itPCpf[ i ].GoToBegin();
-    itLCpf[ i ].GoToBegin();
-  }
-
-  /** Do the addition. */
-  // NOTE: unlike the values, for the derivatives weight * derivative is returned.
-  MeasureType gradMagLC                 = NumericTraits< MeasureType >::Zero;
-  MeasureType gradMagOC                 = NumericTraits< MeasureType >::Zero;
-  MeasureType gradMagPC                 = NumericTraits< MeasureType >::Zero;
-  double      rigidityCoefficientSumSqr = rigidityCoefficientSum * rigidityCoefficientSum;
-  while( !itDIs[ 0 ].IsAtEnd() )
-  {
-    for( unsigned int i = 0; i < ImageDimension; i++ )
-    {
-      ScalarType tmpDIs = NumericTraits< ScalarType >::Zero;
-
-      /** Compute gradient magnitude of LC. */
-      ScalarType tmpLC = this->m_LinearityConditionWeight * itLCpf[ i ].Get();
-      gradMagLC += tmpLC * tmpLC / rigidityCoefficientSumSqr;
-
-      /** Compute gradient magnitude of OC. */
-      ScalarType tmpOC = this->m_OrthonormalityConditionWeight * itOCpf[ i ].Get();
-      gradMagOC += tmpOC * tmpOC / rigidityCoefficientSumSqr;
-
-      /** Compute gradient magnitude of PC. */
-      ScalarType tmpPC = this->m_PropernessConditionWeight * itPCpf[ i ].Get();
-      gradMagPC += tmpPC * tmpPC / rigidityCoefficientSumSqr;
-
-      /** Compute derivative contribution. */
-      if( this->m_UseLinearityCondition )
-      {
-        tmpDIs += tmpLC;
-      }
-      if( this->m_UseOrthonormalityCondition )
-      {
-        tmpDIs += tmpOC;
-      }
-      if( this->m_UsePropernessCondition )
-      {
-        tmpDIs += tmpPC;
-      }
-      itDIs[ i ].Set( tmpDIs );
-
-      /** Update iterators. */
-      ++itDIs[ i ]; ++itOCpf[ i ]; ++itPCpf[ i ]; ++itLCpf[ i ];
-    }
-  } // end while
-
-  /** Set the gradient magnitudes of the several terms. */
-  this->m_LinearityConditionGradientMagnitude      = std::sqrt( gradMagLC );
-  this->m_OrthonormalityConditionGradientMagnitude = std::sqrt( gradMagOC );
-  this->m_PropernessConditionGradientMagnitude     = std::sqrt( gradMagPC );
-
-  /** Rearrange to create a derivative. */
-  unsigned int j = 0;
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    itDIs[ i ].GoToBegin();
-    while( !itDIs[ i ].IsAtEnd() )
-    {
-      derivative[ j ] = itDIs[ i ].Get() / rigidityCoefficientSum;
-      ++itDIs[ i ];
-      j++;
-    } // end while
-  } // end for
-
-} // end GetValueAndDerivative()
+} // end GetValueAndDerivative()
 
 
 /**
@@ -2326,15 +880,11 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   }
   else if( WhichF == "FG_xi" && WhichDimension == 1 )
   {
-    F[ 0 ] = -0.5 / ( s[ 0 ] * s[ 1 ] );
-    F[ 1 ] = 0.0;
-    F[ 2 ] = 0.5 / ( s[ 0 ] * s[ 1 ] );
+    F[ 0 ] = -0.5 / s[ 0 ]; F[ 1 ] = 0.0; F[ 2 ] = 0.5 / s[ 0 ];
   }
   else if( WhichF == "FG_xi" && WhichDimension == 2 )
   {
-    F[ 0 ] = -0.5 / ( s[ 0 ] * s[ 1 ] );
-    F[ 1 ] = 0.0;
-    F[ 2 ] = 0.5 / ( s[ 0 ] * s[ 1 ] );
+    F[ 0 ] = -0.5 / s[ 1 ]; F[ 1 ] = 0.0; F[ 2 ] = 0.5 / s[ 1 ];
   }
   else if( WhichF == "FG_xi" && WhichDimension == 3 )
   {
@@ -2342,9 +892,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   }
   else if( WhichF == "FH_xi" && WhichDimension == 1 )
   {
-    F[ 0 ] = -0.5 / ( s[ 0 ] * s[ 2 ] );
-    F[ 1 ] = 0.0;
-    F[ 2 ] = 0.5 / ( s[ 0 ] * s[ 2 ] );
+    F[ 0 ] = -0.5 / s[ 0 ]; F[ 1 ] = 0.0; F[ 2 ] = 0.5 / s[ 0 ];
   }
   else if( WhichF == "FH_xi" && WhichDimension == 2 )
   {
@@ -2352,9 +900,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   }
   else if( WhichF == "FH_xi" && WhichDimension == 3 )
   {
-    F[ 0 ] = -0.5 / ( s[ 0 ] * s[ 2 ] );
-    F[ 1 ] = 0.0;
-    F[ 2 ] = 0.5 / ( s[ 0 ] * s[ 2 ] );
+    F[ 0 ] = -0.5 / s[ 2 ]; F[ 1 ] = 0.0; F[ 2 ] = 0.5 / s[ 2 ];
   }
   else if( WhichF == "FI_xi" && WhichDimension == 1 )
   {
@@ -2362,15 +908,11 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
   }
   else if( WhichF == "FI_xi" && WhichDimension == 2 )
   {
-    F[ 0 ] = -0.5 / ( s[ 1 ] * s[ 2 ] );
-    F[ 1 ] = 0.0;
-    F[ 2 ] = 0.5 / ( s[ 1 ] * s[ 2 ] );
+    F[ 0 ] = -0.5 / s[ 1 ]; F[ 1 ] = 0.0; F[ 2 ] = 0.5 / s[ 1 ];
   }
   else if( WhichF == "FI_xi" && WhichDimension == 3 )
   {
-    F[ 0 ] = -0.5 / ( s[ 1 ] * s[ 2 ] );
-    F[ 1 ] = 0.0;
-    F[ 2 ] = 0.5 / ( s[ 1 ] * s[ 2 ] );
+    F[ 0 ] = -0.5 / s[ 2 ]; F[ 1 ] = 0.0; F[ 2 ] = 0.5 / s[ 2 ];
   }
   else
   {
@@ -2381,40 +923,6 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
 } // end Create1DOperator()
 
 
-/**
- * ************************** FilterSeparable ********************
- */
-
-template< class TFixedImage, class TScalarType >
-typename TransformRigidityPenaltyTerm< TFixedImage, TScalarType >::CoefficientImagePointer
-TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
-::FilterSeparable(
-  const CoefficientImageType * image,
-  const std::vector< NeighborhoodType > & Operators ) const
-{
-  /** Create filters, supply them with boundary conditions and operators. */
-  std::vector< typename NOIFType::Pointer > filters( ImageDimension );
-  for( unsigned int i = 0; i < ImageDimension; i++ )
-  {
-    filters[ i ] = NOIFType::New();
-    filters[ i ]->SetOperator( Operators[ i ] );
-  }
-
-  /** Set up the mini-pipline. */
-  filters[ 0 ]->SetInput( image );
-  for( unsigned int i = 1; i < ImageDimension; i++ )
-  {
-    filters[ i ]->SetInput( filters[ i - 1 ]->GetOutput() );
-  }
-
-  /** Execute the mini-pipeline. */
-  filters[ ImageDimension - 1 ]->Update();
-
-  /** Return the filtered image. */
-  return filters[ ImageDimension - 1 ]->GetOutput();
-
-} // end FilterSeparable()
-
 
 /**
  * ************************ CreateNDOperator *********************
@@ -2581,7 +1089,7 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
       F[ 3 ] = 1.0 / 18.0 / sp; F[ 4 ] = 2.0 /  9.0 / sp; F[ 5 ] = 1.0 / 18.0 / sp;
       F[ 6 ] = 1.0 / 72.0 / sp; F[ 7 ] = 1.0 / 18.0 / sp; F[ 8 ] = 1.0 / 72.0 / sp;
       /** Second slice. */
-      F[  9 ] = -1.0 / 39.0 / sp; F[ 10 ] = -1.0 / 9.0 / sp;  F[ 11 ] = -1.0 / 36.0 / sp;
+      F[  9 ] = -1.0 / 36.0 / sp; F[ 10 ] = -1.0 / 9.0 / sp;  F[ 11 ] = -1.0 / 36.0 / sp;
       F[ 12 ] = -1.0 /  9.0 / sp; F[ 13 ] = -4.0 / 9.0 / sp;  F[ 14 ] = -1.0 /  9.0 / sp;
       F[ 15 ] = -1.0 / 36.0 / sp; F[ 16 ] = -1.0 / 9.0 / sp;  F[ 17 ] = -1.0 / 36.0 / sp;
       /** Third slice. */
@@ -2673,6 +1181,989 @@ TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
 } // end CreateNDOperator()
 
 
+/**
+ * ************************ InitializeFusedStencils *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::InitializeFusedStencils( void )
+{
+  /** Get the B-spline grid spacing, which is the coefficient image spacing. */
+  CoefficientImageSpacingType spacing;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+  {
+    spacing[ i ] = this->m_BSplineTransform->GetGridSpacing()[ i ];
+  }
+
+  /** The stencils of the first order derivatives, followed by those of the
+   * linearity condition. The operators C, F, H and I only exist in 3D.
+   */
+  const char * names[] = { "FA", "FB", "FC", "FD", "FE", "FG", "FF", "FH", "FI" };
+  const unsigned int numberOfFirstOrderStencils  = ImageDimension;
+  const unsigned int numberOfSecondOrderStencils = 3 * ImageDimension - 3;
+  const unsigned int numberOfStencils
+    = numberOfFirstOrderStencils + numberOfSecondOrderStencils;
+
+  /** The number of elements in a 3x3(x3) stencil. */
+  unsigned int numberOfNeighbours = 1;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+  {
+    numberOfNeighbours *= 3;
+  }
+
+  this->m_ForwardStencils.assign( numberOfStencils, StencilType( numberOfNeighbours, 1.0 ) );
+  this->m_AdjointStencils.assign( numberOfStencils, StencilType( numberOfNeighbours, 0.0 ) );
+  for( unsigned int f = 0; f < numberOfStencils; ++f )
+  {
+    const std::string name = f < numberOfFirstOrderStencils
+      ? names[ f ] : names[ 3 + f - numberOfFirstOrderStencils ];
+
+    /** The forward stencil is the tensor product of the 1D operators,
+     * that were previously applied by separable filtering.
+     */
+    unsigned int stride = 1;
+    for( unsigned int i = 0; i < ImageDimension; i++ )
+    {
+      NeighborhoodType F;
+      this->Create1DOperator( F, name + "_xi", i + 1, spacing );
+      for( unsigned int k = 0; k < numberOfNeighbours; ++k )
+      {
+        this->m_ForwardStencils[ f ][ k ] *= F[ ( k / stride ) % 3 ];
+      }
+      stride *= 3;
+    }
+
+    /** The adjoint stencil is used to filter the parts of the derivative. */
+    NeighborhoodType F;
+    this->CreateNDOperator( F, name, spacing );
+    for( unsigned int k = 0; k < numberOfNeighbours; ++k )
+    {
+      this->m_AdjointStencils[ f ][ k ] = F.GetElement( k );
+    }
+  }
+
+  /** Get the size of the B-spline grid. */
+  this->m_NumberOfGridPoints = 1;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+  {
+    this->m_GridSize[ i ]       = this->m_BSplineTransform->GetGridRegion().GetSize()[ i ];
+    this->m_NumberOfGridPoints *= this->m_GridSize[ i ];
+  }
+
+  /** Allocate the scratch memory for the parts of the derivative, interleaved
+   * per grid point: the orthonormality, properness and linearity parts.
+   */
+  this->m_NumberOfParts
+    = 2 * ImageDimension * ImageDimension + ImageDimension * numberOfSecondOrderStencils;
+  this->m_ConditionParts.resize( this->m_NumberOfGridPoints * this->m_NumberOfParts );
+
+} // end InitializeFusedStencils()
+
+
+/**
+ * ************************ ComputeFusedStencils *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+typename TransformRigidityPenaltyTerm< TFixedImage, TScalarType >::ScalarType
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeFusedStencils( DerivativeType * derivative ) const
+{
+  /** Setup the threads. */
+  const ThreadIdType numberOfThreads
+    = this->m_UseMultiThread ? this->m_Threader->GetNumberOfWorkUnits() : 1;
+  PaddedFusedStencilsPerThreadStruct zero;
+  zero.st_RigidityCoefficientSum                   = NumericTraits< MeasureType >::Zero;
+  zero.st_LinearityConditionValue                  = NumericTraits< MeasureType >::Zero;
+  zero.st_OrthonormalityConditionValue             = NumericTraits< MeasureType >::Zero;
+  zero.st_PropernessConditionValue                 = NumericTraits< MeasureType >::Zero;
+  zero.st_LinearityConditionGradientMagnitude      = NumericTraits< MeasureType >::Zero;
+  zero.st_OrthonormalityConditionGradientMagnitude = NumericTraits< MeasureType >::Zero;
+  zero.st_PropernessConditionGradientMagnitude     = NumericTraits< MeasureType >::Zero;
+  this->m_FusedStencilsPerThreadVariables.assign( numberOfThreads, zero );
+
+  this->m_FusedStencilsParameters.st_Metric                 = this;
+  this->m_FusedStencilsParameters.st_Derivative             = derivative;
+  this->m_FusedStencilsParameters.st_ComputeDerivative      = derivative != nullptr;
+  this->m_FusedStencilsParameters.st_RigidityCoefficientSum = NumericTraits< ScalarType >::Zero;
+
+  /** Forward pass: the condition values and the parts of the derivative. */
+  if( numberOfThreads > 1 )
+  {
+    this->m_Threader->SetSingleMethod( ComputeConditionsThreaderCallback,
+      static_cast< void * >( &this->m_FusedStencilsParameters ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+  else
+  {
+    this->ThreadedComputeConditions( 0, 1 );
+  }
+
+  /** Accumulate the results of the threads, in a fixed order. */
+  ScalarType rigidityCoefficientSum = NumericTraits< ScalarType >::Zero;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    const PaddedFusedStencilsPerThreadStruct & result = this->m_FusedStencilsPerThreadVariables[ i ];
+    rigidityCoefficientSum               += result.st_RigidityCoefficientSum;
+    this->m_LinearityConditionValue      += result.st_LinearityConditionValue;
+    this->m_OrthonormalityConditionValue += result.st_OrthonormalityConditionValue;
+    this->m_PropernessConditionValue     += result.st_PropernessConditionValue;
+  }
+
+  if( derivative == nullptr || rigidityCoefficientSum < 1e-14 )
+  {
+    return rigidityCoefficientSum;
+  }
+
+  /** Adjoint pass: the derivative. */
+  this->m_FusedStencilsParameters.st_RigidityCoefficientSum = rigidityCoefficientSum;
+  if( numberOfThreads > 1 )
+  {
+    this->m_Threader->SetSingleMethod( ComputeDerivativeThreaderCallback,
+      static_cast< void * >( &this->m_FusedStencilsParameters ) );
+    this->m_Threader->SingleMethodExecute();
+  }
+  else
+  {
+    this->ThreadedComputeDerivative( 0, 1 );
+  }
+
+  /** Set the gradient magnitudes of the several terms. */
+  MeasureType gradMagLC = NumericTraits< MeasureType >::Zero;
+  MeasureType gradMagOC = NumericTraits< MeasureType >::Zero;
+  MeasureType gradMagPC = NumericTraits< MeasureType >::Zero;
+  for( ThreadIdType i = 0; i < numberOfThreads; ++i )
+  {
+    const PaddedFusedStencilsPerThreadStruct & result = this->m_FusedStencilsPerThreadVariables[ i ];
+    gradMagLC += result.st_LinearityConditionGradientMagnitude;
+    gradMagOC += result.st_OrthonormalityConditionGradientMagnitude;
+    gradMagPC += result.st_PropernessConditionGradientMagnitude;
+  }
+  this->m_LinearityConditionGradientMagnitude      = std::sqrt( gradMagLC );
+  this->m_OrthonormalityConditionGradientMagnitude = std::sqrt( gradMagOC );
+  this->m_PropernessConditionGradientMagnitude     = std::sqrt( gradMagPC );
+
+  return rigidityCoefficientSum;
+
+} // end ComputeFusedStencils()
+
+
+/**
+ * ************************ ComputeRowOffsets *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeRowOffsets( const SizeValueType row, std::vector< SizeValueType > & rowOffsets ) const
+{
+  /** Get the grid index of the row, without the x-coordinate. */
+  OffsetValueType index[ ImageDimension ];
+  SizeValueType   remainder = row;
+  for( unsigned int i = 1; i < ImageDimension; i++ )
+  {
+    index[ i ]  = static_cast< OffsetValueType >( remainder % this->m_GridSize[ i ] );
+    remainder  /= this->m_GridSize[ i ];
+  }
+
+  /** Compute the offsets of the neighbouring rows. Outside the grid,
+   * the nearest row is used, like the zero flux Neumann boundary condition
+   * of the neighborhood filters.
+   */
+  for( unsigned int m = 0; m < rowOffsets.size(); ++m )
+  {
+    SizeValueType offset = 0;
+    SizeValueType stride = this->m_GridSize[ 0 ];
+    unsigned int  digits = m;
+    for( unsigned int i = 1; i < ImageDimension; i++ )
+    {
+      OffsetValueType neighbour = index[ i ] + static_cast< OffsetValueType >( digits % 3 ) - 1;
+      neighbour = std::max( neighbour, static_cast< OffsetValueType >( 0 ) );
+      neighbour = std::min( neighbour,
+        static_cast< OffsetValueType >( this->m_GridSize[ i ] ) - 1 );
+      offset += static_cast< SizeValueType >( neighbour ) * stride;
+      stride *= this->m_GridSize[ i ];
+      digits /= 3;
+    }
+    rowOffsets[ m ] = offset;
+  }
+
+} // end ComputeRowOffsets()
+
+
+/**
+ * ************************ ComputeConditionsThreaderCallback *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeConditionsThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  FusedStencilsThreaderParameterType * temp
+    = static_cast< FusedStencilsThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedComputeConditions(
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeConditionsThreaderCallback()
+
+
+/**
+ * ************************ ComputeDerivativeThreaderCallback *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeDerivativeThreaderCallback( void * arg )
+{
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  FusedStencilsThreaderParameterType * temp
+    = static_cast< FusedStencilsThreaderParameterType * >( infoStruct->UserData );
+
+  temp->st_Metric->ThreadedComputeDerivative(
+    infoStruct->WorkUnitID, infoStruct->NumberOfWorkUnits );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end ComputeDerivativeThreaderCallback()
+
+
+/**
+ * ************************ ThreadedComputeConditions *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedComputeConditions( ThreadIdType threadId, ThreadIdType numberOfThreads ) const
+{
+  /** Get handles to the B-spline coefficients and the rigidity coefficients. */
+  const ScalarType * coefficients[ ImageDimension ];
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+  {
+    coefficients[ i ] = this->m_BSplineTransform->GetCoefficientImages()[ i ]->GetBufferPointer();
+  }
+  const RigidityPixelType * rigidityCoefficients
+    = this->m_RigidityCoefficientImage->GetBufferPointer();
+
+  /** Get the rows of the grid for this thread. */
+  const SizeValueType gridSizeX    = this->m_GridSize[ 0 ];
+  const SizeValueType numberOfRows = this->m_NumberOfGridPoints / gridSizeX;
+  const SizeValueType rowBegin     = numberOfRows * threadId / numberOfThreads;
+  const SizeValueType rowEnd       = numberOfRows * ( threadId + 1 ) / numberOfThreads;
+
+  const unsigned int numberOfFirstOrderStencils  = ImageDimension;
+  const unsigned int numberOfSecondOrderStencils = 3 * ImageDimension - 3;
+  const unsigned int numberOfNeighbours          = this->m_ForwardStencils[ 0 ].size();
+  const bool         computeDerivative           = this->m_FusedStencilsParameters.st_ComputeDerivative;
+  const bool         computeFirstOrder
+    = this->m_CalculateOrthonormalityCondition || this->m_CalculatePropernessCondition;
+
+  std::vector< SizeValueType > rowOffsets( numberOfNeighbours / 3 );
+  std::vector< SizeValueType > neighbours( numberOfNeighbours );
+
+  MeasureType rigidityCoefficientSum = NumericTraits< MeasureType >::Zero;
+  MeasureType linearityValue         = NumericTraits< MeasureType >::Zero;
+  MeasureType orthonormalityValue    = NumericTraits< MeasureType >::Zero;
+  MeasureType propernessValue        = NumericTraits< MeasureType >::Zero;
+
+  for( SizeValueType row = rowBegin; row < rowEnd; ++row )
+  {
+    this->ComputeRowOffsets( row, rowOffsets );
+    for( SizeValueType x = 0; x < gridSizeX; ++x )
+    {
+      /** Get the linear indices of the neighbourhood. */
+      const SizeValueType xs[ 3 ] = {
+        x > 0 ? x - 1 : 0, x, x + 1 < gridSizeX ? x + 1 : gridSizeX - 1
+      };
+      for( unsigned int k = 0; k < numberOfNeighbours; ++k )
+      {
+        neighbours[ k ] = xs[ k % 3 ] + rowOffsets[ k / 3 ];
+      }
+      const SizeValueType n = neighbours[ numberOfNeighbours / 2 ];
+      const ScalarType    c = rigidityCoefficients[ n ];
+      rigidityCoefficientSum += c;
+
+      /** Filter the B-spline coefficients: first order derivatives in mu,
+       * second order derivatives in nu.
+       */
+      ScalarType mu[ 3 ][ 3 ] = { { 0.0 } };
+      ScalarType nu[ 3 ][ 6 ] = { { 0.0 } };
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+        for( unsigned int k = 0; k < numberOfNeighbours; ++k )
+        {
+          const ScalarType coefficient = coefficients[ i ][ neighbours[ k ] ];
+          if( computeFirstOrder )
+          {
+            for( unsigned int f = 0; f < numberOfFirstOrderStencils; ++f )
+            {
+              mu[ i ][ f ] += this->m_ForwardStencils[ f ][ k ] * coefficient;
+            }
+          }
+          if( this->m_CalculateLinearityCondition )
+          {
+            for( unsigned int f = 0; f < numberOfSecondOrderStencils; ++f )
+            {
+              nu[ i ][ f ] += this->m_ForwardStencils[ numberOfFirstOrderStencils + f ][ k ] * coefficient;
+            }
+          }
+        }
+      }
+
+      /** The parts of the derivative of this grid point. */
+      ScalarType * OCparts = nullptr;
+      ScalarType * PCparts = nullptr;
+      ScalarType * LCparts = nullptr;
+      if( computeDerivative )
+      {
+        OCparts = &this->m_ConditionParts[ n * this->m_NumberOfParts ];
+        PCparts = OCparts + ImageDimension * ImageDimension;
+        LCparts = PCparts + ImageDimension * ImageDimension;
+      }
+
+      /** The conditions, weighted with the rigidity coefficient. */
+      if( this->m_CalculateOrthonormalityCondition )
+      {
+        orthonormalityValue += c * this->ComputeOrthonormalityCondition( mu, OCparts );
+      }
+      if( this->m_CalculatePropernessCondition )
+      {
+        propernessValue += c * this->ComputePropernessCondition( mu, PCparts );
+      }
+      if( this->m_CalculateLinearityCondition )
+      {
+        linearityValue += c * this->ComputeLinearityCondition( nu, LCparts );
+      }
+
+    } // end for x
+  } // end for rows
+
+  /** Store the results of this thread. */
+  PaddedFusedStencilsPerThreadStruct & result = this->m_FusedStencilsPerThreadVariables[ threadId ];
+  result.st_RigidityCoefficientSum       = rigidityCoefficientSum;
+  result.st_LinearityConditionValue      = linearityValue;
+  result.st_OrthonormalityConditionValue = orthonormalityValue;
+  result.st_PropernessConditionValue     = propernessValue;
+
+} // end ThreadedComputeConditions()
+
+
+/**
+ * ************************ ComputeOrthonormalityCondition *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+typename TransformRigidityPenaltyTerm< TFixedImage, TScalarType >::ScalarType
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeOrthonormalityCondition( const ScalarType mu[ 3 ][ 3 ], ScalarType * parts ) const
+{
+  /** Copy values: this improves code readability. */
+  const ScalarType mu1_A = mu[ 0 ][ 0 ], mu2_A = mu[ 1 ][ 0 ], mu3_A = mu[ 2 ][ 0 ];
+  const ScalarType mu1_B = mu[ 0 ][ 1 ], mu2_B = mu[ 1 ][ 1 ], mu3_B = mu[ 2 ][ 1 ];
+  const ScalarType mu1_C = mu[ 0 ][ 2 ], mu2_C = mu[ 1 ][ 2 ], mu3_C = mu[ 2 ][ 2 ];
+
+  ScalarType value = NumericTraits< ScalarType >::Zero;
+  ScalarType valueOC;
+  if( ImageDimension == 2 )
+  {
+    /** Calculate the value of the orthonormality condition. */
+    value = (
+      vnl_math::sqr(
+      +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      + mu2_A * mu2_A
+      - 1.0 )
+      + vnl_math::sqr(
+      +mu1_B * mu1_B
+      + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      - 1.0 )
+      + vnl_math::sqr(
+      +( 1.0 + mu1_A ) * mu1_B
+      + mu2_A * ( 1.0 + mu2_B ) )
+      );
+    if( parts != nullptr )
+    {
+      /** Calculate the derivative of the orthonormality condition. */
+      /** mu1, part 1 */
+      valueOC
+        = +2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+        + 2.0 * mu2_A * mu2_A * ( 1.0 + mu1_A )
+        - 2.0 * ( 1.0 + mu1_A )
+        + mu1_B * mu1_B * ( 1.0 + mu1_A )
+        + mu2_A * ( 1.0 + mu2_B ) * mu1_B;
+      parts[ 0 ] = 2.0 * valueOC;
+      /** mu1, part2*/
+      valueOC
+        = +mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+        + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A )
+        + 2.0 * mu1_B * mu1_B * mu1_B
+        + 2.0 * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+        - 2.0 * mu1_B;
+      parts[ 1 ] = 2.0 * valueOC;
+      /** mu2, part 1 */
+      valueOC
+        = +2.0 * mu2_A * mu2_A * mu2_A
+        + 2.0 * mu2_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+        - 2.0 * mu2_A
+        + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+        + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
+      parts[ 2 ] = 2.0 * valueOC;
+      /** mu2, part2*/
+      valueOC
+        = +mu2_A * mu2_A * ( 1.0 + mu2_B )
+        + mu1_B * ( 1.0 + mu1_A ) * mu2_A
+        + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+        + 2.0 * mu1_B * mu1_B * ( 1.0 + mu2_B )
+        - 2.0 * ( 1.0 + mu2_B );
+      parts[ 3 ] = 2.0 * valueOC;
+    }
+  } // end if dim == 2
+  else if( ImageDimension == 3 )
+  {
+    /** Calculate the value of the orthonormality condition. */
+    value = (
+      vnl_math::sqr(
+      +( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+      + mu2_A * mu2_A
+      + mu3_A * mu3_A
+      - 1.0 )
+      + vnl_math::sqr(
+      +( 1.0 + mu1_A ) * mu1_B
+      + mu2_A * ( 1.0 + mu2_B )
+      + mu3_A * mu3_B )
+      + vnl_math::sqr(
+      +( 1.0 + mu1_A ) * mu1_C
+      + mu2_A * mu2_C
+      + mu3_A * ( 1.0 + mu3_C ) )
+      + vnl_math::sqr(
+      +mu1_B * mu1_B
+      + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+      + mu3_B * mu3_B
+      - 1.0 )
+      + vnl_math::sqr(
+      +mu1_B * mu1_C
+      + ( 1.0 + mu2_B ) * mu2_C
+      + mu3_B * ( 1.0 + mu3_C ) )
+      + vnl_math::sqr(
+      +mu1_C * mu1_C
+      + mu2_C * mu2_C
+      + ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+      - 1.0 ) );
+    if( parts != nullptr )
+    {
+      /** Calculate the derivative of the orthonormality condition. */
+      /** mu1, part 1 */
+      valueOC
+        = +2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+        + 2.0 * mu2_A * mu2_A * ( 1.0 + mu1_A )
+        + 2.0 * ( 1.0 + mu1_A ) * mu3_A * mu3_A
+        - 2.0 * ( 1.0 + mu1_A )
+        + mu1_B * mu1_B * ( 1.0 + mu1_A )
+        + mu2_A * ( 1.0 + mu2_B ) * mu1_B
+        + mu1_B * mu3_A * mu3_B
+        + ( 1.0 + mu1_A ) * mu1_C * mu1_C
+        + mu1_C * mu2_A * mu2_C
+        + mu1_C * mu3_A * ( 1.0 + mu3_C );
+      parts[ 0 ] = 2.0 * valueOC;
+      /** mu1, part2 */
+      valueOC
+        = +( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_B
+        + ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B )
+        + ( 1.0 + mu1_A ) * mu3_A * mu3_B
+        + 2.0 * mu1_B * mu1_B * mu1_B
+        + 2.0 * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+        + 2.0 * mu1_B * mu3_B * mu3_B
+        - 2.0 * mu1_B
+        + mu1_B * mu1_C * mu1_C
+        + mu1_C * ( 1.0 + mu2_B ) * mu2_C
+        + mu1_C * mu3_B * ( 1.0 + mu3_C );
+      parts[ 1 ] = 2.0 * valueOC;
+      /** mu1, part3 */
+      valueOC
+        = +( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu1_C
+        + ( 1.0 + mu1_A ) * mu2_A * mu2_C
+        + ( 1.0 + mu1_A ) * mu3_A * ( 1.0 + mu3_C )
+        + mu1_B * mu1_B * mu1_C
+        + mu1_B * ( 1.0 + mu2_B ) * mu2_C
+        + mu1_B * mu3_B * ( 1.0 + mu3_C )
+        + 2.0 * mu1_C * mu1_C * mu1_C
+        + 2.0 * mu1_C * mu2_C * mu2_C
+        + 2.0 * mu1_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        - 2.0 * mu1_C;
+      parts[ 2 ] = 2.0 * valueOC;
+      /** mu2, part 1 */
+      valueOC
+        = +2.0 * mu2_A * mu2_A * mu2_A
+        + 2.0 * mu2_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+        - 2.0 * mu2_A
+        + 2.0 * mu2_A * mu3_A * mu3_A
+        + mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+        + mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
+        + ( 1.0 + mu2_B ) * mu3_A * mu3_B
+        + mu2_A * mu2_C * mu2_C
+        + ( 1.0 + mu1_A ) * mu1_C * mu2_C
+        + mu2_C * mu3_A * ( 1.0 + mu3_C );
+      parts[ 3 ] = 2.0 * valueOC;
+      /** mu2, part2 */
+      valueOC
+        = +mu2_A * mu2_A * ( 1.0 + mu2_B )
+        + mu1_B * ( 1.0 + mu1_A ) * mu2_A
+        + mu2_A * mu3_A * mu3_B
+        + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B )
+        + 2.0 * mu1_B * mu1_B * ( 1.0 + mu2_B )
+        - 2.0 * ( 1.0 + mu2_B )
+        + 2.0 * ( 1.0 + mu2_B ) * mu3_B * mu3_B
+        + ( 1.0 + mu2_B ) * mu2_C * mu2_C
+        + mu1_B * mu1_C * mu2_C
+        + mu2_C * mu3_B * ( 1.0 + mu3_C );
+      parts[ 4 ] = 2.0 * valueOC;
+      /** mu2, part 3 */
+      valueOC
+        = +mu2_A * mu2_A * mu2_C
+        + ( 1.0 + mu1_A ) * mu1_C * mu2_A
+        + mu2_A * mu3_A * ( 1.0 + mu3_C )
+        + ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu2_C
+        + mu1_B * mu1_C * ( 1.0 + mu2_B )
+        + ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+        + 2.0 * mu2_C * mu2_C * mu2_C
+        + 2.0 * mu1_C * mu1_C * mu2_C
+        + 2.0 * mu2_C * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        - 2.0 * mu2_C;
+      parts[ 5 ] = 2.0 * valueOC;
+      /** mu3, part 1 */
+      valueOC
+        = +2.0 * mu3_A * mu3_A * mu3_A
+        + 2.0 * mu3_A * ( 1.0 + mu1_A ) * ( 1.0 + mu1_A )
+        - 2.0 * mu3_A
+        + 2.0 * mu2_A * mu2_A * mu3_A
+        + mu3_A * mu3_B * mu3_B
+        + mu1_B * ( 1.0 + mu1_A ) * mu3_B
+        + ( 1.0 + mu2_B ) * mu2_A * mu3_B
+        + mu3_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu3_C )
+        + mu2_C * mu2_A * ( 1.0 + mu3_C );
+      parts[ 6 ] = 2.0 * valueOC;
+      /** mu3, part2 */
+      valueOC
+        = +mu3_A * mu3_A * mu3_B
+        + mu1_B * ( 1.0 + mu1_A ) * mu3_A
+        + mu2_A * mu3_A * ( 1.0 + mu2_B )
+        + 2.0 *  mu3_B *  mu3_B *  mu3_B
+        + 2.0 * mu1_B * mu1_B *  mu3_B
+        - 2.0 *  mu3_B
+        + 2.0 * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_B
+        + mu3_B * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        + mu1_B * mu1_C * ( 1.0 + mu3_C )
+        + mu2_C * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
+      parts[ 7 ] = 2.0 * valueOC;
+      /** mu3, part 3 */
+      valueOC
+        = +mu3_A * mu3_A * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu1_C * mu3_A
+        + mu2_A * mu3_A * mu2_C
+        + mu3_B * mu3_B * ( 1.0 + mu3_C )
+        + mu1_B * mu1_C * mu3_B
+        + ( 1.0 + mu2_B ) * mu3_B * mu2_C
+        + 2.0 * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        + 2.0 * mu1_C * mu1_C * ( 1.0 + mu3_C )
+        + 2.0 * mu2_C * mu2_C * ( 1.0 + mu3_C )
+        - 2.0 * ( 1.0 + mu3_C );
+      parts[ 8 ] = 2.0 * valueOC;
+    }
+  } // end if dim == 3
+
+  return value;
+
+} // end ComputeOrthonormalityCondition()
+
+
+/**
+ * ************************ ComputePropernessCondition *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+typename TransformRigidityPenaltyTerm< TFixedImage, TScalarType >::ScalarType
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputePropernessCondition( const ScalarType mu[ 3 ][ 3 ], ScalarType * parts ) const
+{
+  /** Copy values: this improves code readability. */
+  const ScalarType mu1_A = mu[ 0 ][ 0 ], mu2_A = mu[ 1 ][ 0 ], mu3_A = mu[ 2 ][ 0 ];
+  const ScalarType mu1_B = mu[ 0 ][ 1 ], mu2_B = mu[ 1 ][ 1 ], mu3_B = mu[ 2 ][ 1 ];
+  const ScalarType mu1_C = mu[ 0 ][ 2 ], mu2_C = mu[ 1 ][ 2 ], mu3_C = mu[ 2 ][ 2 ];
+
+  ScalarType value = NumericTraits< ScalarType >::Zero;
+  ScalarType valuePC;
+  if( ImageDimension == 2 )
+  {
+    /** Calculate the value of the properness condition. */
+    value = (
+      vnl_math::sqr(
+      +( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
+      - mu2_A * mu1_B
+      - 1.0 )
+      );
+    if( parts != nullptr )
+    {
+      /** Calculate the derivative of the properness condition. */
+      /** mu1, part 1 */
+      valuePC
+        = +( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A )
+        - mu2_A * ( 1.0 + mu2_B ) * mu1_B
+        - ( 1.0 + mu2_B );
+      parts[ 0 ] = 2.0 * valuePC;
+      /** mu1, part 2 */
+      valuePC
+        = +mu2_A
+        + mu2_A * mu2_A * mu1_B
+        - mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu1_A );
+      parts[ 1 ] = 2.0 * valuePC;
+      /** mu2, part 1 */
+      valuePC
+        = +mu1_B * mu1_B * mu2_A
+        - mu1_B * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
+        + mu1_B;
+      parts[ 2 ] = 2.0 * valuePC;
+      /** mu2, part 2 */
+      valuePC
+        = -( 1.0 + mu1_A )
+        + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B )
+        - mu1_B * ( 1.0 + mu1_A ) * mu2_A;
+      parts[ 3 ] = 2.0 * valuePC;
+    }
+  } // end if dim == 2
+  else if( ImageDimension == 3 )
+  {
+    /** Calculate the value of the properness condition. */
+    value = (
+      vnl_math::sqr(
+      -mu1_C * ( 1.0 + mu2_B ) * mu3_A
+      + mu1_B * mu2_C * mu3_A
+      + mu1_C * mu2_A * mu3_B
+      - ( 1.0 + mu1_A ) * mu2_C * mu3_B
+      - mu1_B * mu2_A * ( 1.0 + mu3_C )
+      + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+      - 1.0 )
+      );
+    if( parts != nullptr )
+    {
+      /** Calculate the derivative of the properness condition. */
+      /** mu1, part 1 */
+      valuePC
+        = +( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_B * mu3_B
+        + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        + mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_B
+        - mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+        - mu1_B * mu2_C * mu2_C * mu3_A * mu3_B
+        + mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A * ( 1.0 + mu3_C )
+        - mu1_C * mu2_A * mu2_C * mu3_B * mu3_B
+        + mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+        + mu1_B * mu2_A * mu2_C * mu3_B * ( 1.0 + mu3_C )
+        - 2.0 * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_B * ( 1.0 + mu3_C )
+        + mu2_C * mu3_B
+        - mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        - ( 1.0 + mu2_B ) * ( 1.0 + mu3_C );
+      parts[ 0 ] = 2.0 * valuePC;
+      /** mu1, part 2 */
+      valuePC
+        = +mu1_B * mu2_C * mu2_C * mu3_A * mu3_A
+        + mu1_B * mu2_A * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        - mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_A
+        + mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+        + mu1_C * mu2_A * mu2_C * mu3_A * mu3_B
+        - ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_A * mu3_B
+        - 2.0 * mu1_B * mu2_A * mu2_C * mu3_A * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_A * ( 1.0 + mu3_C )
+        - mu2_C * mu3_A
+        - mu1_C * mu2_A * mu2_A * mu3_B * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu2_A * mu2_C * mu3_B * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        + mu2_A * ( 1.0 + mu3_C );
+      parts[ 1 ] = 2.0 * valuePC;
+      /** mu1, part 3 */
+      valuePC
+        = +mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * mu3_A
+        + mu1_C * mu2_A * mu2_A * mu3_B * mu3_B
+        - mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_A
+        - 2.0 * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A * mu3_B
+        + ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_A * mu3_B
+        + mu1_B * mu2_A * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+        + ( 1.0 + mu2_B ) * mu3_A
+        + mu1_B * mu2_A * mu2_C * mu3_A * mu3_B
+        - ( 1.0 + mu1_A ) * mu2_A * mu2_C * mu3_B * mu3_B
+        - mu1_B * mu2_A * mu2_A * mu3_B * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu2_A * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+        - mu2_A * mu3_B;
+      parts[ 2 ] = 2.0 * valuePC;
+      /** mu2, part 1 */
+      valuePC
+        = +mu1_C * mu1_C * mu2_A * mu3_B * mu3_B
+        + mu1_B * mu1_B * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        - mu1_C * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_B
+        + mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+        + mu1_B * mu1_C * mu2_C * mu3_A * mu3_B
+        - mu1_B * mu1_B * mu2_C * mu3_A * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * mu1_C * mu2_C * mu3_B * mu3_B
+        - 2.0 * mu1_B * mu1_C * mu2_A * mu3_B * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+        - mu1_C * mu3_B
+        + ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_B * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        + mu1_B * ( 1.0 + mu3_C );
+      parts[ 3 ] = 2.0 * valuePC;
+      /** mu2, part 2 */
+      valuePC
+        = +mu1_C * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_A
+        + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        - mu1_B * mu1_C * mu2_C * mu3_A * mu3_A
+        - mu1_C * mu1_C * mu2_A * mu3_A * mu3_B
+        + ( 1.0 + mu1_A ) * mu1_C * mu2_C * mu3_A * mu3_B
+        + mu1_B * mu1_C * mu2_A * mu3_A * ( 1.0 + mu3_C )
+        - 2.0 * ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+        + mu1_C * mu3_A
+        + ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_A * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu3_B * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu3_B * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu3_C ) * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * ( 1.0 + mu3_C );
+      parts[ 4 ] = 2.0 * valuePC;
+      /** mu2, part 3 */
+      valuePC
+        = +mu1_B * mu1_B * mu2_C * mu3_A * mu3_A
+        + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu3_B * mu3_B
+        - mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_A
+        + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu3_A * mu3_B
+        + mu1_B * mu1_C * mu2_A * mu3_A * mu3_B
+        - 2.0 * ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu3_A * mu3_B
+        - mu1_B * mu1_B * mu2_A * mu3_A * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu3_A * ( 1.0 + mu3_C )
+        - mu1_B * mu3_A
+        - ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu3_B * mu3_B
+        + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu3_B * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu3_B * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu3_B;
+      parts[ 5 ] = 2.0 * valuePC;
+      /** mu3, part 1 */
+      valuePC
+        = +mu1_C * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A
+        + mu1_B * mu1_B * mu2_C * mu2_C * mu3_A
+        - 2.0 * mu1_B * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A
+        - mu1_C * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B
+        + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_B
+        + mu1_B * mu1_C * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+        + mu1_C * ( 1.0 + mu2_B )
+        + mu1_B * mu1_C * mu2_A * mu2_C * mu3_B
+        - ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu2_C * mu3_B
+        - mu1_B * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
+        - mu1_B * mu2_C;
+      parts[ 6 ] = 2.0 * valuePC;
+      /** mu3, part 2 */
+      valuePC
+        = +mu1_C * mu1_C * mu2_A * mu2_A * mu3_B
+        + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * mu2_C * mu2_C * mu3_B
+        - mu1_C * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A
+        + ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * mu2_C * mu3_A
+        + mu1_B * mu1_C * mu2_A * mu2_C * mu3_A
+        - ( 1.0 + mu1_A ) * mu1_B * mu2_C * mu2_C * mu3_A
+        - 2.0 * ( 1.0 + mu1_A ) * mu1_C * mu2_A * mu2_C * mu3_B
+        - mu1_B * mu1_C * mu2_A * mu2_A * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu1_C * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+        - mu1_C * mu2_A
+        + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu2_C * ( 1.0 + mu3_C )
+        - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * mu2_C;
+      parts[ 7 ] = 2.0 * valuePC;
+      /** mu3, part 3 */
+      valuePC
+        = +mu1_B * mu1_B * mu2_A * mu2_A * ( 1.0 + mu3_C )
+        + ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+        + mu1_B * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_A
+        - ( 1.0 + mu1_A ) * mu1_C * ( 1.0 + mu2_B ) * ( 1.0 + mu2_B ) * mu3_A
+        - mu1_B * mu1_B * mu2_A * mu2_C * mu3_A
+        + ( 1.0 + mu1_A ) * mu1_B * ( 1.0 + mu2_B ) * mu2_C * mu3_A
+        - mu1_B * mu1_C * mu2_A * mu2_A * mu3_B
+        + ( 1.0 + mu1_A ) * mu1_C * mu2_A * ( 1.0 + mu2_B ) * mu3_B
+        + ( 1.0 + mu1_A ) * mu1_B * mu2_A * mu2_C * mu3_B
+        - ( 1.0 + mu1_A ) * ( 1.0 + mu1_A ) * ( 1.0 + mu2_B ) * mu2_C * mu3_B
+        - 2.0 * ( 1.0 + mu1_A ) * mu1_B * mu2_A * ( 1.0 + mu2_B ) * ( 1.0 + mu3_C )
+        + mu1_B * mu2_A
+        - ( 1.0 + mu1_A ) * ( 1.0 + mu2_B );
+      parts[ 8 ] = 2.0 * valuePC;
+    }
+  } // end if dim == 3
+
+  return value;
+
+} // end ComputePropernessCondition()
+
+
+/**
+ * ************************ ComputeLinearityCondition *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+typename TransformRigidityPenaltyTerm< TFixedImage, TScalarType >::ScalarType
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ComputeLinearityCondition( const ScalarType nu[ 3 ][ 6 ], ScalarType * parts ) const
+{
+  const unsigned int numberOfSecondOrderStencils = 3 * ImageDimension - 3;
+
+  ScalarType value = NumericTraits< ScalarType >::Zero;
+  for( unsigned int i = 0; i < ImageDimension; i++ )
+  {
+    for( unsigned int f = 0; f < numberOfSecondOrderStencils; ++f )
+    {
+      value += nu[ i ][ f ] * nu[ i ][ f ];
+      if( parts != nullptr )
+      {
+        parts[ i * numberOfSecondOrderStencils + f ] = 2.0 * nu[ i ][ f ];
+      }
+    }
+  }
+
+  return value;
+
+} // end ComputeLinearityCondition()
+
+
+/**
+ * ************************ ThreadedComputeDerivative *********************
+ */
+
+template< class TFixedImage, class TScalarType >
+void
+TransformRigidityPenaltyTerm< TFixedImage, TScalarType >
+::ThreadedComputeDerivative( ThreadIdType threadId, ThreadIdType numberOfThreads ) const
+{
+  const RigidityPixelType * rigidityCoefficients
+    = this->m_RigidityCoefficientImage->GetBufferPointer();
+  const ScalarType * parts      = &this->m_ConditionParts[ 0 ];
+  DerivativeType &   derivative = *this->m_FusedStencilsParameters.st_Derivative;
+
+  /** Get the rows of the grid for this thread. */
+  const SizeValueType gridSizeX    = this->m_GridSize[ 0 ];
+  const SizeValueType numberOfRows = this->m_NumberOfGridPoints / gridSizeX;
+  const SizeValueType rowBegin     = numberOfRows * threadId / numberOfThreads;
+  const SizeValueType rowEnd       = numberOfRows * ( threadId + 1 ) / numberOfThreads;
+
+  const unsigned int numberOfFirstOrderStencils  = ImageDimension;
+  const unsigned int numberOfSecondOrderStencils = 3 * ImageDimension - 3;
+  const unsigned int numberOfNeighbours          = this->m_AdjointStencils[ 0 ].size();
+  const unsigned int offsetPC                    = ImageDimension * ImageDimension;
+  const unsigned int offsetLC                    = 2 * ImageDimension * ImageDimension;
+
+  const double rigidityCoefficientSum    = this->m_FusedStencilsParameters.st_RigidityCoefficientSum;
+  const double rigidityCoefficientSumSqr = rigidityCoefficientSum * rigidityCoefficientSum;
+
+  std::vector< SizeValueType > rowOffsets( numberOfNeighbours / 3 );
+  std::vector< SizeValueType > neighbours( numberOfNeighbours );
+
+  MeasureType gradMagLC = NumericTraits< MeasureType >::Zero;
+  MeasureType gradMagOC = NumericTraits< MeasureType >::Zero;
+  MeasureType gradMagPC = NumericTraits< MeasureType >::Zero;
+
+  for( SizeValueType row = rowBegin; row < rowEnd; ++row )
+  {
+    this->ComputeRowOffsets( row, rowOffsets );
+    for( SizeValueType x = 0; x < gridSizeX; ++x )
+    {
+      /** Get the linear indices of the neighbourhood. */
+      const SizeValueType xs[ 3 ] = {
+        x > 0 ? x - 1 : 0, x, x + 1 < gridSizeX ? x + 1 : gridSizeX - 1
+      };
+      for( unsigned int k = 0; k < numberOfNeighbours; ++k )
+      {
+        neighbours[ k ] = xs[ k % 3 ] + rowOffsets[ k / 3 ];
+      }
+      const SizeValueType n = neighbours[ numberOfNeighbours / 2 ];
+
+      for( unsigned int i = 0; i < ImageDimension; i++ )
+      {
+        /** Filter the parts, weighted with the rigidity coefficients:
+         * F_A * {subpart_0} + F_B * {subpart_1}, and (for 3D) + F_C * {subpart_2}
+         * for the orthonormality and properness conditions, and
+         * sum_{i=1}^{NofLParts} F_{D,E,G,F,H,I} * {subpart_i} for the linearity condition.
+         */
+        ScalarType filteredOC = NumericTraits< ScalarType >::Zero;
+        ScalarType filteredPC = NumericTraits< ScalarType >::Zero;
+        ScalarType filteredLC = NumericTraits< ScalarType >::Zero;
+        for( unsigned int k = 0; k < numberOfNeighbours; ++k )
+        {
+          const ScalarType   c         = rigidityCoefficients[ neighbours[ k ] ];
+          const ScalarType * partsOfK  = parts + neighbours[ k ] * this->m_NumberOfParts;
+          if( this->m_CalculateOrthonormalityCondition )
+          {
+            for( unsigned int f = 0; f < numberOfFirstOrderStencils; ++f )
+            {
+              filteredOC += this->m_AdjointStencils[ f ][ k ]
+                * partsOfK[ i * ImageDimension + f ] * c;
+            }
+          }
+          if( this->m_CalculatePropernessCondition )
+          {
+            for( unsigned int f = 0; f < numberOfFirstOrderStencils; ++f )
+            {
+              filteredPC += this->m_AdjointStencils[ f ][ k ]
+                * partsOfK[ offsetPC + i * ImageDimension + f ] * c;
+            }
+          }
+          if( this->m_CalculateLinearityCondition )
+          {
+            for( unsigned int f = 0; f < numberOfSecondOrderStencils; ++f )
+            {
+              filteredLC += this->m_AdjointStencils[ numberOfFirstOrderStencils + f ][ k ]
+                * partsOfK[ offsetLC + i * numberOfSecondOrderStencils + f ] * c;
+            }
+          }
+        } // end loop over neighbourhood
+
+        /** Compute the gradient magnitudes and the derivative.
+         * NOTE: unlike the values, for the derivatives weight * derivative is returned.
+         */
+        const ScalarType tmpLC = this->m_LinearityConditionWeight * filteredLC;
+        const ScalarType tmpOC = this->m_OrthonormalityConditionWeight * filteredOC;
+        const ScalarType tmpPC = this->m_PropernessConditionWeight * filteredPC;
+        gradMagLC += tmpLC * tmpLC / rigidityCoefficientSumSqr;
+        gradMagOC += tmpOC * tmpOC / rigidityCoefficientSumSqr;
+        gradMagPC += tmpPC * tmpPC / rigidityCoefficientSumSqr;
+
+        ScalarType tmpDIs = NumericTraits< ScalarType >::Zero;
+        if( this->m_UseLinearityCondition )
+        {
+          tmpDIs += tmpLC;
+        }
+        if( this->m_UseOrthonormalityCondition )
+        {
+          tmpDIs += tmpOC;
+        }
+        if( this->m_UsePropernessCondition )
+        {
+          tmpDIs += tmpPC;
+        }
+        derivative[ i * this->m_NumberOfGridPoints + n ] = tmpDIs / rigidityCoefficientSum;
+
+      } // end loop over dimension i
+    } // end for x
+  } // end for rows
+
+  /** Store the results of this thread. */
+  PaddedFusedStencilsPerThreadStruct & result = this->m_FusedStencilsPerThreadVariables[ threadId ];
+  result.st_LinearityConditionGradientMagnitude      = gradMagLC;
+  result.st_OrthonormalityConditionGradientMagnitude = gradMagOC;
+  result.st_PropernessConditionGradientMagnitude     = gradMagPC;
+
+} // end ThreadedComputeDerivative()
+
+
 } // end namespace itk
 
 #endif // #ifndef __itkTransformRigidityPenaltyTerm_hxx
@@ -29,6 +29,8 @@
 #include <utility>
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkTimeProbe.h"
+#include "itkOptimizerVectorKernels.h"
+#include "itkHotPathProfiler.h"
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -448,6 +450,8 @@ void
 AdaGrad< TElastix >
 ::AdvanceOneStep( void )
 {
+  itkHotPathNamedScopedTimerMacro( advanceOneStepTimer, "Optimizer::AdvanceOneStep" );
+
   /** Get space dimension. */
   const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
 
@@ -463,18 +467,41 @@ AdaGrad< TElastix >
   /** Get a reference to the current position. */
   const ParametersType & currentPosition = this->GetScaledCurrentPosition();
 
-  /** Update the new position. */
-  const double eta = 1e-14;
+  /** Update the new position. The preconditioner, the search direction and
+   * the new position are updated in a single pass over the memory.
+   */
   const double lamda2 = lamda * this->m_NoiseFactor;
 //  const double lamda2 = 0.01;
-  for( unsigned int j = 0; j < spaceDimension; ++j )
+  struct UpdateKernel
   {
-    this->m_PreconditionVector[ j ] += this->m_Gradient[ j ] * this->m_Gradient[ j ];
-    searchDirection[ j ] = this->m_Gradient[ j ] / ( std::sqrt( this->m_PreconditionVector[ j ] + eta ) );
-    newPosition[ j ] = currentPosition[ j ] - lamda2 * searchDirection[ j ];
-  }
+    const double * gradient;
+    const double * currentPosition;
+    double *       precondition;
+    double *       searchDirection;
+    double *       newPosition;
+    double         lamda2;
+
+    void operator()( const itk::SizeValueType begin, const itk::SizeValueType end,
+      const itk::SizeValueType ) const
+    {
+      const double eta = 1e-14;
+      for( itk::SizeValueType j = begin; j < end; ++j )
+      {
+        precondition[ j ]   += gradient[ j ] * gradient[ j ];
+        searchDirection[ j ] = gradient[ j ] / ( std::sqrt( precondition[ j ] + eta ) );
+        newPosition[ j ]     = currentPosition[ j ] - lamda2 * searchDirection[ j ];
+      }
+    }
+  };
+  const UpdateKernel kernel = {
+    this->m_Gradient.data_block(), currentPosition.data_block(),
+    this->m_PreconditionVector.data_block(), searchDirection.data_block(),
+    newPosition.data_block(), lamda2 };
+  itk::OptimizerVectorKernels::Run( kernel, spaceDimension,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 
   this->Superclass1::UpdateCurrentTime();
+  itkHotPathStopTimerMacro( advanceOneStepTimer );
   this->InvokeEvent( itk::IterationEvent() );
 
 } // end AdvanceOneStep()
@@ -881,7 +908,8 @@ AdaGrad< TElastix >
       }
       this->GetScaledDerivativeWithExceptionHandling( perturbedMu0, exactgradient );
 
-      exactgg += inner_product(exactgradient, exactgradient);
+      exactgg += itk::OptimizerVectorKernels::SquaredNorm( exactgradient,
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 
       /** Set random sampler(s), select new spatial samples and get approximate derivative. */
       for( unsigned int m = 0; m < M; ++m )
@@ -897,7 +925,8 @@ AdaGrad< TElastix >
 
       /** Compute error vector. */
       diffgradient = exactgradient - approxgradient;
-      approxgg = inner_product(diffgradient, diffgradient);
+      approxgg = itk::OptimizerVectorKernels::SquaredNorm( diffgradient,
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
       diffgg += approxgg;
     }
     else // no stochastic gradients
@@ -20,6 +20,7 @@
 
 #include "itkAdaptiveStepsizeOptimizer.h"
 
+#include "itkOptimizerVectorKernels.h"
 #include "vnl/vnl_math.h"
 #include "itkSigmoidImageFilter.h"
 
@@ -67,8 +68,9 @@ AdaptiveStepsizeOptimizer
       sigmoid.SetBeta( beta );
 
       /** Formula (2) in Cruz */
-      const double inprod = inner_product(
-        this->m_PreviousSearchDirection, this->GetGradient() );
+      const double inprod = OptimizerVectorKernels::Dot(
+        this->m_PreviousSearchDirection, this->GetGradient(),
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
       this->m_CurrentTime += sigmoid( -inprod );
       this->m_CurrentTime  = std::max( 0.0, this->m_CurrentTime );
     }
@@ -31,6 +31,8 @@
 #include "itkCommand.h"
 #include "itkEventObject.h"
 #include "itkMacro.h"
+#include "itkOptimizerVectorKernels.h"
+#include "itkHotPathProfiler.h"
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -560,10 +562,6 @@ AdaptiveStochasticLBFGS<TElastix>
 {
   itkDebugMacro( "LBFGSUpdate" );
 
-  /** Get space dimension. */
-  const unsigned int spaceDimension
-    = this->GetScaledCostFunction()->GetNumberOfParameters();
-
   /** Get a reference to the previously allocated newPosition. */
   ParametersType & newPosition = this->m_ScaledCurrentPosition;
 
@@ -572,10 +570,9 @@ AdaptiveStochasticLBFGS<TElastix>
 
   /** Update the new position. */
   const double learningRate = this->GetLearningRate();
-  for( unsigned int j = 0; j < spaceDimension; ++j )
-  {
-    newPosition[ j ] = currentPosition[ j ] + learningRate * this->m_SearchDir[ j ];
-  }
+  itk::OptimizerVectorKernels::ScaledAdd(
+    currentPosition, learningRate, this->m_SearchDir, newPosition,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 
   this->InvokeEvent( itk::IterationEvent() );
 } // end LBFGSUpdate()
@@ -591,10 +588,7 @@ AdaptiveStochasticLBFGS<TElastix>
 ::AdvanceOneStep( void )
 {
   itkDebugMacro( "AdvanceOneStep" );
-
-  /** Get space dimension. */
-  const unsigned int spaceDimension
-    = this->GetScaledCostFunction()->GetNumberOfParameters();
+  itkHotPathNamedScopedTimerMacro( advanceOneStepTimer, "Optimizer::AdvanceOneStep" );
 
   /** Get a reference to the previously allocated newPosition. */
   ParametersType & newPosition = this->m_ScaledCurrentPosition;
@@ -604,10 +598,11 @@ AdaptiveStochasticLBFGS<TElastix>
 
   /** Update the new position. */
   const double learningRate = this->GetLearningRate();
-  for( unsigned int j = 0; j < spaceDimension; ++j )
-  {
-    newPosition[ j ] = currentPosition[ j ] - learningRate * this->m_Gradient[ j ];
-  }
+  itk::OptimizerVectorKernels::ScaledAdd(
+    currentPosition, -learningRate, this->m_Gradient, newPosition,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+
+  itkHotPathStopTimerMacro( advanceOneStepTimer );
 
   this->InvokeEvent( itk::IterationEvent() );
 
@@ -1645,9 +1640,11 @@ AdaptiveStochasticLBFGS<TElastix>
 
 //   const double rho = 1.0 / inner_product( step, grad_dif ) ; // 1/ys
 //   const double  ys = 1.0 / rho;
-  const double  ys = inner_product( step, grad_dif ) ; // 1/ys;
+  const double  ys = itk::OptimizerVectorKernels::Dot( step, grad_dif,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() ) ; // 1/ys;
   const double rho = 1.0 / ys;
-  const double  yy = grad_dif.squared_magnitude();
+  const double  yy = itk::OptimizerVectorKernels::SquaredNorm( grad_dif,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 
   double fill_value = ys / yy;
   if( fill_value < 0.0 )
@@ -1753,35 +1750,29 @@ AdaptiveStochasticLBFGS<TElastix>
     {
       cp = this->m_LBFGSMemory - 1;
     }
-    const double sq = inner_product( this->m_S[ cp ], searchDir );
+    const double sq = itk::OptimizerVectorKernels::Dot( this->m_S[ cp ], searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
     alpha[ cp ] = this->m_Rho[ cp ] * sq;
-    const double &         alpha_cp = alpha[ cp ];
-    const DerivativeType & y        = this->m_Y[ cp ];
-    for( unsigned int j = 0; j < numberOfParameters; ++j )
-    {
-      searchDir[ j ] -= alpha_cp * y[ j ];
-    }
+    itk::OptimizerVectorKernels::Axpy( -alpha[ cp ], this->m_Y[ cp ], searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
   }
 
-  for( unsigned int j = 0; j < numberOfParameters; ++j )
-  {
 #if 0
-    searchDir[ j ] *= H0[ j ];
+  itk::OptimizerVectorKernels::Multiply( H0, searchDir,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 #else
-    searchDir[ j ] *= fill_value;
+  itk::OptimizerVectorKernels::Scale( fill_value, searchDir,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 #endif
-  }
 
   for( unsigned int i = 0; i < this->m_Bound; ++i )
   {
-    const double           yr             = inner_product( this->m_Y[ cp ], searchDir );
-    const double           beta           = this->m_Rho[ cp ] * yr;
-    const double           alpha_min_beta = alpha[ cp ] - beta;
-    const ParametersType & s              = this->m_S[ cp ];
-    for( unsigned int j = 0; j < numberOfParameters; ++j )
-    {
-      searchDir[ j ] += alpha_min_beta * s[ j ];
-    }
+    const double yr             = itk::OptimizerVectorKernels::Dot( this->m_Y[ cp ], searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+    const double beta           = this->m_Rho[ cp ] * yr;
+    const double alpha_min_beta = alpha[ cp ] - beta;
+    itk::OptimizerVectorKernels::Axpy( alpha_min_beta, this->m_S[ cp ], searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
     ++cp;
     if( static_cast< unsigned int >( cp ) == this->m_LBFGSMemory )
     {
@@ -1792,7 +1783,10 @@ AdaptiveStochasticLBFGS<TElastix>
   /** Normalize if no information about previous steps is available yet */
   if( this->m_Bound == 0 )
   {
-    searchDir /= gradient.magnitude();
+    const double gradientNorm = itk::OptimizerVectorKernels::Norm( gradient,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+    itk::OptimizerVectorKernels::Scale( 1.0 / gradientNorm, searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
   }
 
 } // end ComputeSearchDirection()
@@ -20,6 +20,7 @@
 
 #include "itkAdaptiveStochasticLBFGSOptimizer.h"
 
+#include "itkOptimizerVectorKernels.h"
 #include "vnl/vnl_math.h"
 #include "itkSigmoidImageFilter.h"
 
@@ -68,7 +69,8 @@ AdaptiveStochasticLBFGSOptimizer
     if( this->GetCurrentIteration() > 0 )
     {
       /** Formula (2) in Cruz: <g_k, g_{k-1}>. */
-      const double inprod = inner_product( this->m_PreviousGradient, this->GetGradient() );
+      const double inprod = OptimizerVectorKernels::Dot( this->m_PreviousGradient, this->GetGradient(),
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
       this->m_CurrentTime += sigmoid( -inprod );
       this->m_CurrentTime = std::max( 0.0, this->m_CurrentTime );
     }
@@ -84,7 +86,8 @@ AdaptiveStochasticLBFGSOptimizer
       const DerivativeType & searchDir = this->GetSearchDir();
       //const double inprod = inner_product( this->m_PreviousSearchDir,  searchDir );
       /** test <g_k, d_k>, only using the information of current gradient and search direction. */
-      const double inprod = inner_product( this->GetGradient(),  searchDir );
+      const double inprod = OptimizerVectorKernels::Dot( this->GetGradient(), searchDir,
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
       this->m_CurrentTime += sigmoid( -inprod );
       this->m_CurrentTime = std::max( 0.0, this->m_CurrentTime );
     }
@@ -31,6 +31,8 @@
 #include "itkCommand.h"
 #include "itkEventObject.h"
 #include "itkMacro.h"
+#include "itkOptimizerVectorKernels.h"
+#include "itkHotPathProfiler.h"
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -474,10 +476,7 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>
 ::AdvanceOneStep( void )
 {
   itkDebugMacro( "AdvancedOneStep" );
-
-  /** Get space dimension. */
-  const unsigned int spaceDimension
-    = this->GetScaledCostFunction()->GetNumberOfParameters();
+  itkHotPathNamedScopedTimerMacro( advanceOneStepTimer, "Optimizer::AdvanceOneStep" );
 
   /** Get a reference to the previously allocated newPosition. */
   ParametersType &newPosition = this->m_ScaledCurrentPosition;
@@ -487,11 +486,11 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>
 
   /** Update the new position. */
   const double learningRate = this->GetLearningRate();
-  for( unsigned int j = 0; j < spaceDimension; ++j )
-  {
-    newPosition[j] = currentPosition[j] - learningRate * this->m_Gradient[j];
-  }
+  itk::OptimizerVectorKernels::ScaledAdd(
+    currentPosition, -learningRate, this->m_Gradient, newPosition,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 
+  itkHotPathStopTimerMacro( advanceOneStepTimer );
   this->InvokeEvent( itk::IterationEvent() );
 }
 
@@ -661,25 +660,32 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>
       this->GetConfiguration()->ReadParameter( this->m_UseNoiseFactor,
         "UseNoiseFactor", this->GetComponentLabel(), 0, 0 );
 
-      if ( this->m_UseNoiseFactor )
-      {
-//         for( unsigned int j = 0; j < spaceDimension; ++j )
-//         {
-//           this->m_Gradient[j] = this->m_NoiseFactor * (localCurrentGradient[j] - localPreviousGradient[j]) + this->m_PreviousGradient[j];
-//         }
-        for( unsigned int j = 0; j < spaceDimension; ++j )
-        {
-          this->m_Gradient[j] = this->m_NoiseFactor * (localCurrentGradient[j] - localPreviousGradient[j]) + this->m_MeanGradient[j];
-        }
-      }
-      else
+      /** Compute the variance reduced gradient in a single pass:
+       * g = noiseFactor * ( g_current - g_previous ) + g_mean.
+       */
+      struct VarianceReducedGradientKernel
       {
-        for( unsigned int j = 0; j < spaceDimension; ++j )
+        const double * currentGradient;
+        const double * previousGradient;
+        const double * meanGradient;
+        double *       gradient;
+        double         noiseFactor;
+
+        void operator()( const itk::SizeValueType begin, const itk::SizeValueType end,
+          const itk::SizeValueType ) const
         {
-          this->m_Gradient[j] = (localCurrentGradient[j] - localPreviousGradient[j]) + this->m_MeanGradient[j];
-          //this->m_Gradient[j] = this->m_PreviousGradient[j];
+          for( itk::SizeValueType j = begin; j < end; ++j )
+          {
+            gradient[ j ] = noiseFactor * ( currentGradient[ j ] - previousGradient[ j ] ) + meanGradient[ j ];
+          }
         }
-      }
+      };
+      const VarianceReducedGradientKernel kernel = {
+        localCurrentGradient.data_block(), localPreviousGradient.data_block(),
+        this->m_MeanGradient.data_block(), this->m_Gradient.data_block(),
+        this->m_UseNoiseFactor ? this->m_NoiseFactor : 1.0 };
+      itk::OptimizerVectorKernels::Run( kernel, spaceDimension,
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 
       timeCollector.Stop( "gvr" );
 
@@ -1247,8 +1253,10 @@ AdaptiveStochasticVarianceReducedGradient<TElastix>
       diffgradient = exactgradient - approxgradient;
 
       /** Compute g^T g and e^T e */
-      exactgg += exactgradient.squared_magnitude();
-      diffgg += diffgradient.squared_magnitude();
+      exactgg += itk::OptimizerVectorKernels::SquaredNorm( exactgradient,
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+      diffgg += itk::OptimizerVectorKernels::SquaredNorm( diffgradient,
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
     }
     else // no stochastic gradients
     {
@@ -20,6 +20,7 @@
 
 #include "itkAdaptiveStochasticVarianceReducedGradientOptimizer.h"
 
+#include "itkOptimizerVectorKernels.h"
 #include "vnl/vnl_math.h"
 #include "itkSigmoidImageFilter.h"
 
@@ -68,8 +69,9 @@ void AdaptiveStochasticVarianceReducedGradientOptimizer
       sigmoid.SetBeta( beta );
 
       ///** Formula (2) in Cruz */
-      const double inprod = inner_product(
-        this->m_PreviousGradient, this->GetGradient() );
+      const double inprod = OptimizerVectorKernels::Dot(
+        this->m_PreviousGradient, this->GetGradient(),
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
       this->m_CurrentTime += sigmoid( -inprod );
       this->m_CurrentTime = std::max( 0.0, this->m_CurrentTime );
     }
@@ -23,15 +23,8 @@
 #include "itkCommand.h"
 #include "itkEventObject.h"
 #include "itkMacro.h"
-
-#ifdef ELASTIX_USE_OPENMP
-#include <omp.h>
-#endif
-
-#ifdef ELASTIX_USE_EIGEN
-#include <Eigen/Dense>
-#include <Eigen/Core>
-#endif
+#include "itkOptimizerVectorKernels.h"
+#include "itkHotPathProfiler.h"
 
 namespace itk
 {
@@ -54,8 +47,6 @@ StochasticVarianceReducedGradientDescentOptimizer
 
   this->m_Threader = ThreaderType::New();
   this->m_UseMultiThread = false;
-  this->m_UseOpenMP = false;
-  this->m_UseEigen = false;
 
 } // end Constructor
 
@@ -220,165 +211,27 @@ StochasticVarianceReducedGradientDescentOptimizer
 ::AdvanceOneStep( void )
 {
   itkDebugMacro( "AdvanceOneStep" );
-
-  /** Get space dimension. */
-  const unsigned int spaceDimension
-    = this->GetScaledCostFunction()->GetNumberOfParameters();
+  itkHotPathNamedScopedTimerMacro( advanceOneStepTimer, "Optimizer::AdvanceOneStep" );
 
   /** Get a reference to the previously allocated newPosition. */
   ParametersType & newPosition = this->m_ScaledCurrentPosition;
 
-  /** Advance one step. */
-  // single-threadedly
-  if( !this->m_UseMultiThread || true ) // for now force single-threaded since it is fastest most of the times
-  //if( !this->m_UseMultiThread && false ) // force multi-threaded
-  {
-    /** Get a reference to the current position. */
-    const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-    /** Update the new position. */
-    for( unsigned int j = 0; j < spaceDimension; j++ )
-    {
-      newPosition[ j ] = currentPosition[ j ] - this->m_LearningRate * this->m_Gradient[ j ];
-    }
-  }
-#ifdef ELASTIX_USE_OPENMP
-  else if( this->m_UseOpenMP && !this->m_UseEigen )
-  {
-    /** Get a reference to the current position. */
-    const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-
-    /** Update the new position. */
-    const int nthreads = static_cast<int>( this->m_Threader->GetNumberOfWorkUnits() );
-    omp_set_num_threads( nthreads );
-#pragma omp parallel for
-    for( int j = 0; j < static_cast<int>( spaceDimension ); j++ )
-    {
-      newPosition[ j ] = currentPosition[ j ] - this->m_LearningRate * this->m_Gradient[ j ];
-    }
-  }
-#endif
-#ifdef ELASTIX_USE_EIGEN
-  else if( !this->m_UseOpenMP && this->m_UseEigen )
-  {
-    /** Get a reference to the current position. */
-    const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-    const double learningRate = this->m_LearningRate;
-
-    /** Wrap itk::Arrays into Eigen jackets. */
-    typedef Eigen::VectorXd ParametersTypeEigen;
-    Eigen::Map<ParametersTypeEigen> newPositionE( newPosition.data_block(), spaceDimension );
-    Eigen::Map<const ParametersTypeEigen> currentPositionE( currentPosition.data_block(), spaceDimension );
-    Eigen::Map<ParametersTypeEigen> gradientE( this->m_Gradient.data_block(), spaceDimension );
-
-    /** Update the new position. */
-    newPositionE = currentPositionE - learningRate * gradientE;
-  }
-#endif
-#if defined( ELASTIX_USE_OPENMP ) && defined( ELASTIX_USE_EIGEN )
-  else if( this->m_UseOpenMP && this->m_UseEigen )
-  {
-    /** Get a reference to the current position. */
-    const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-    const double learningRate = this->m_LearningRate;
-
-    /** Wrap itk::Arrays into Eigen jackets. */
-    typedef Eigen::VectorXd ParametersTypeEigen;
-    Eigen::Map<ParametersTypeEigen> newPositionE( newPosition.data_block(), spaceDimension );
-    Eigen::Map<const ParametersTypeEigen> currentPositionE( currentPosition.data_block(), spaceDimension );
-    Eigen::Map<ParametersTypeEigen> gradientE( this->m_Gradient.data_block(), spaceDimension );
-
-    /** Update the new position. */
-    const int spaceDim = static_cast<int>( spaceDimension );
-    const int nthreads = static_cast<int>( this->m_Threader->GetNumberOfWorkUnits() );
-    omp_set_num_threads( nthreads );
-#pragma omp parallel for
-    for( int i = 0; i < nthreads; i += 1 )
-    {
-      int threadId = omp_get_thread_num();
-      int chunk = ( spaceDimension + nthreads - 1 ) / nthreads;
-      int jmin = threadId * chunk;
-      int jmax = ( threadId + 1 ) * chunk < spaceDim ? ( threadId + 1 ) * chunk : spaceDim;
-      int subSize = jmax - jmin;
-
-      newPositionE.segment( jmin, subSize ) = currentPositionE.segment( jmin, subSize )
-        - learningRate * gradientE.segment( jmin, subSize );
-    }
-  }
-#endif
-  else
-  {
-    /** Fill the threader parameter struct with information. */
-    MultiThreaderParameterType * temp = new  MultiThreaderParameterType;
-    temp->t_NewPosition = &newPosition;
-    temp->t_Optimizer = this;
-
-    /** Call multi-threaded AdvanceOneStep(). */
-    ThreaderType::Pointer local_threader = ThreaderType::New();
-    local_threader->SetNumberOfWorkUnits( this->m_Threader->GetNumberOfWorkUnits() );
-    local_threader->SetSingleMethod( AdvanceOneStepThreaderCallback, (void *)( temp ) );
-    local_threader->SingleMethodExecute();
+  /** Advance one step: mu_{k+1} = mu_k - a_k * gradient_k. The vector
+   * kernels only multi-thread large vectors.
+   */
+  const ThreadIdType numberOfThreads
+    = this->m_UseMultiThread ? this->m_Threader->GetNumberOfWorkUnits() : 1;
+  OptimizerVectorKernels::ScaledAdd( this->GetScaledCurrentPosition(),
+    -this->m_LearningRate, this->m_Gradient, newPosition,
+    this->m_Threader, numberOfThreads );
 
-    delete temp;
-  }
+  itkHotPathStopTimerMacro( advanceOneStepTimer );
 
   this->InvokeEvent( IterationEvent() );
 
 } // end AdvanceOneStep()
 
 
-/**
- * ************ AdvanceOneStepThreaderCallback ****************************
- */
-
-ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION StochasticVarianceReducedGradientDescentOptimizer
-::AdvanceOneStepThreaderCallback( void * arg )
-{
-  /** Get the current thread id and user data. */
-  ThreadInfoType * infoStruct = static_cast<ThreadInfoType *>( arg );
-  ThreadIdType threadID = infoStruct->WorkUnitID;
-  MultiThreaderParameterType * temp
-    = static_cast<MultiThreaderParameterType *>( infoStruct->UserData );
-
-  /** Call the real implementation. */
-  temp->t_Optimizer->ThreadedAdvanceOneStep( threadID, *( temp->t_NewPosition ) );
-
-  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
-
-} // end AdvanceOneStepThreaderCallback()
-
-
-/**
- * ************ ThreadedAdvanceOneStep ****************************
- */
-
-void StochasticVarianceReducedGradientDescentOptimizer
-::ThreadedAdvanceOneStep( ThreadIdType threadId, ParametersType & newPosition )
-{
-  /** Compute the range for this thread. */
-  const unsigned int spaceDimension
-    = this->GetScaledCostFunction()->GetNumberOfParameters();
-  const unsigned int subSize = static_cast<unsigned int>(
-    std::ceil( static_cast<double>( spaceDimension )
-      / static_cast<double>( this->m_Threader->GetNumberOfWorkUnits() ) ) );
-  const unsigned int jmin = threadId * subSize;
-  unsigned int jmax = ( threadId + 1 ) * subSize;
-  jmax = ( jmax > spaceDimension ) ? spaceDimension : jmax;
-
-  /** Get a reference to the current position. */
-  const ParametersType & currentPosition = this->GetScaledCurrentPosition();
-  const double learningRate = this->m_LearningRate;
-  const DerivativeType & gradient = this->m_Gradient;
-
-  /** Advance one step: mu_{k+1} = mu_k - a_k * gradient_k */
-  for( unsigned int j = jmin; j < jmax; j++ )
-  {
-    newPosition[ j ] = currentPosition[ j ] - learningRate * gradient[ j ];
-  }
-
-} // end ThreadedAdvanceOneStep()
-
-
 } // end namespace itk
 
 #endif
@@ -159,9 +159,6 @@ public:
   //itkGetConstReferenceMacro( NumberOfThreads, ThreadIdType );
   itkSetMacro( UseMultiThread, bool );
 
-  itkSetMacro( UseOpenMP, bool );
-  itkSetMacro( UseEigen, bool );
-
 protected:
   StochasticVarianceReducedGradientDescentOptimizer();
   ~StochasticVarianceReducedGradientDescentOptimizer() override {};
@@ -198,20 +195,6 @@ private:
 
   // multi-threaded AdvanceOneStep:
   bool m_UseMultiThread;
-  struct MultiThreaderParameterType
-  {
-    ParametersType *  t_NewPosition;
-    Self *            t_Optimizer;
-  };
-
-  bool m_UseOpenMP;
-  bool m_UseEigen;
-
-  /** The callback function. */
-  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION AdvanceOneStepThreaderCallback( void * arg );
-
-  /** The threaded implementation of AdvanceOneStep(). */
-  inline void ThreadedAdvanceOneStep( ThreadIdType threadId, ParametersType & newPosition );
 
 };
 
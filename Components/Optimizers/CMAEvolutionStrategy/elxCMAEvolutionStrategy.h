@@ -107,6 +107,13 @@ namespace elastix
  *    reported back in the elastix.log file. This parameter can be specified for each resolution. \n
  *    example: <tt>(UpdateBDPeriod 0 0 50)</tt> \n
  *    Default: 0 (so, automatically determined).
+ * \parameter UseParallelPopulationEvaluation: whether to evaluate the members of the
+ *    population of one iteration concurrently, using one thread per member. This requires a
+ *    metric that supports re-entrant evaluation, such as the AdvancedMeanSquares; otherwise
+ *    the population is evaluated sequentially. The result does not depend on this setting.
+ *    This parameter can be specified for each resolution. \n
+ *    example: <tt>(UseParallelPopulationEvaluation "true")</tt> \n
+ *    Default: "false".
  *
  * \ingroup Optimizers
  */
@@ -156,6 +163,9 @@ public:
   typedef typename Superclass2::RegistrationPointer  RegistrationPointer;
   typedef typename Superclass2::ITKBaseType          ITKBaseType;
 
+  /** Typedef for the population cost functions. */
+  typedef Superclass1::CostFunctionContainerType CostFunctionContainerType;
+
   /** Check if any scales are set, and set the UseScales flag on or off;
    * after that call the superclass' implementation */
   void StartOptimization( void ) override;
@@ -180,6 +190,9 @@ protected:
   /** Call the superclass' implementation and print the value of some variables */
   void InitializeProgressVariables( void ) override;
 
+  /** Create a population cost function per thread, if the metric supports it. */
+  virtual void InitializeParallelPopulationEvaluation( void );
+
 private:
 
   CMAEvolutionStrategy( const Self & );   // purposely not implemented
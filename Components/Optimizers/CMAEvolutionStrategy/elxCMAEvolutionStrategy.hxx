@@ -49,12 +49,47 @@ CMAEvolutionStrategy< TElastix >::StartOptimization( void )
     }
   }
 
+  /** Setup the concurrent evaluation of the population, if requested */
+  this->InitializeParallelPopulationEvaluation();
+
   /** Call the superclass */
   this->Superclass1::StartOptimization();
 
 }   //end StartOptimization
 
 
+/**
+ * ***************** InitializeParallelPopulationEvaluation ************************
+ */
+
+template< class TElastix >
+void
+CMAEvolutionStrategy< TElastix >::InitializeParallelPopulationEvaluation( void )
+{
+  /** Release the cost functions of the previous resolution. */
+  this->SetPopulationCostFunctions( CostFunctionContainerType() );
+  if( !this->GetUseParallelPopulationEvaluation() )
+  {
+    return;
+  }
+
+  /** The metric is initialized at this point, so the contexts can be created.
+   * The optimizer does not use more of them than the population size.
+   */
+  CostFunctionContainerType costFunctions;
+  if( this->CreateReentrantCostFunctions( costFunctions ) )
+  {
+    this->SetPopulationCostFunctions( costFunctions );
+  }
+  else
+  {
+    xl::xout[ "warning" ] << "WARNING: The metric does not support re-entrant evaluation.\n"
+                          << "  The population is evaluated sequentially." << std::endl;
+  }
+
+} // end InitializeParallelPopulationEvaluation
+
+
 /**
  * ***************** InitializeProgressVariables ************************
  */
@@ -208,6 +243,12 @@ CMAEvolutionStrategy< TElastix >
     "MinimumDeviation", this->GetComponentLabel(), level, 0 );
   this->SetMinimumDeviation( minimumDeviation );
 
+  /** Set UseParallelPopulationEvaluation */
+  bool useParallelPopulationEvaluation = false;
+  this->m_Configuration->ReadParameter( useParallelPopulationEvaluation,
+    "UseParallelPopulationEvaluation", this->GetComponentLabel(), level, 0 );
+  this->SetUseParallelPopulationEvaluation( useParallelPopulationEvaluation );
+
 } // end BeforeEachResolution
 
 
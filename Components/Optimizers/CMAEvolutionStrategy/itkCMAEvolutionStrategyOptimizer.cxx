@@ -24,6 +24,7 @@
 #include "vnl/vnl_math.h"
 #include <algorithm>
 #include <cmath>
+#include <exception>
 #include "itkCommand.h"
 #include "itkEventObject.h"
 #include "itkMacro.h"
@@ -77,6 +78,9 @@ CMAEvolutionStrategyOptimizer::CMAEvolutionStrategyOptimizer()
   this->m_PositionToleranceMax       = 1e8;
   this->m_ValueTolerance             = 1e-12;
 
+  this->m_UseParallelPopulationEvaluation = false;
+  this->m_Threader                        = ThreaderType::New();
+
 } // end constructor
 
 
@@ -125,6 +129,8 @@ CMAEvolutionStrategyOptimizer::PrintSelf( std::ostream & os, Indent indent ) con
   os << indent << "m_PositionToleranceMin: " << this->m_PositionToleranceMin << std::endl;
   os << indent << "m_PositionToleranceMax: " << this->m_PositionToleranceMax << std::endl;
   os << indent << "m_ValueTolerance: " << this->m_ValueTolerance << std::endl;
+  os << indent << "m_UseParallelPopulationEvaluation: " << this->m_UseParallelPopulationEvaluation << std::endl;
+  os << indent << "m_PopulationCostFunctions: " << this->m_PopulationCostFunctions.size() << " workers" << std::endl;
 
   os << indent << "m_RecombinationWeights: " << this->m_RecombinationWeights << std::endl;
   os << indent << "m_C: " << this->m_C << std::endl;
@@ -159,6 +165,9 @@ CMAEvolutionStrategyOptimizer::StartOptimization()
   /** Initialize the scaledCostFunction with the currently set scales */
   this->InitializeScales();
 
+  /** Give the population cost functions the same scales */
+  this->InitializePopulationCostFunctions();
+
   /** Set the current position as the scaled initial position */
   this->SetCurrentPosition( this->GetInitialPosition() );
 
@@ -501,12 +510,15 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
 {
   itkDebugMacro( "GenerateOffspring" );
 
-  /** Get the number of parameters from the cost function */
-  const unsigned int numberOfParameters
-    = this->GetScaledCostFunction()->GetNumberOfParameters();
+  /** Evaluate the population concurrently, if possible */
+  if( this->m_UseParallelPopulationEvaluation
+    && this->m_ScaledPopulationCostFunctions.size() > 1 )
+  {
+    this->GenerateOffspringConcurrently();
+    return;
+  }
 
   /** Some casts/aliases: */
-  const unsigned int N      = numberOfParameters;
   const unsigned int lambda = this->m_PopulationSize;
 
   /** Clear the old values */
@@ -517,23 +529,8 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
   unsigned int nrOfFails = 0;
   while( lam < lambda )
   {
-    /** draw from distribution N(0,I) */
-    for( unsigned int par = 0; par < N; ++par )
-    {
-      this->m_NormalizedSearchDirs[ lam ][ par ]
-        = this->m_RandomGenerator->GetNormalVariate();
-    }
-    /** Make like it was drawn from N(0,C) */
-    if( this->GetUseCovarianceMatrixAdaptation() )
-    {
-      this->m_SearchDirs[ lam ] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[ lam ] );
-    }
-    else
-    {
-      this->m_SearchDirs[ lam ] = this->m_NormalizedSearchDirs[ lam ];
-    }
-    /** Make like it was drawn from N( 0, sigma^2 C ) */
-    this->m_SearchDirs[ lam ] *= this->m_CurrentSigma;
+    /** Draw from distribution N( 0, sigma^2 C ) */
+    this->DrawSearchDirection( lam );
 
     /** Compute the cost function */
     MeasureType costFunctionValue = 0.0;
@@ -573,6 +570,304 @@ CMAEvolutionStrategyOptimizer::GenerateOffspring( void )
 } // end GenerateOffspring
 
 
+/**
+ * ****************** DrawSearchDirection *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::DrawSearchDirection( unsigned int lam )
+{
+  /** draw from distribution N(0,I) */
+  this->DrawNormalizedSearchDirection( this->m_NormalizedSearchDirs[ lam ] );
+
+  /** Make like it was drawn from N( 0, sigma^2 C ) */
+  this->ComputeSearchDirection( lam );
+
+} // end DrawSearchDirection
+
+
+/**
+ * ****************** DrawNormalizedSearchDirection *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::DrawNormalizedSearchDirection( ParametersType & normalizedSearchDir )
+{
+  /** Get the number of parameters from the cost function */
+  const unsigned int N = this->GetScaledCostFunction()->GetNumberOfParameters();
+
+  /** draw from distribution N(0,I) */
+  normalizedSearchDir.SetSize( N );
+  for( unsigned int par = 0; par < N; ++par )
+  {
+    normalizedSearchDir[ par ] = this->m_RandomGenerator->GetNormalVariate();
+  }
+
+} // end DrawNormalizedSearchDirection
+
+
+/**
+ * ****************** ComputeSearchDirection *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::ComputeSearchDirection( unsigned int lam )
+{
+  /** Make like it was drawn from N(0,C) */
+  if( this->GetUseCovarianceMatrixAdaptation() )
+  {
+    this->m_SearchDirs[ lam ] = this->m_B * ( this->m_D * this->m_NormalizedSearchDirs[ lam ] );
+  }
+  else
+  {
+    this->m_SearchDirs[ lam ] = this->m_NormalizedSearchDirs[ lam ];
+  }
+  /** Make like it was drawn from N( 0, sigma^2 C ) */
+  this->m_SearchDirs[ lam ] *= this->m_CurrentSigma;
+
+} // end ComputeSearchDirection
+
+
+/**
+ * ****************** GenerateOffspringConcurrently *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::GenerateOffspringConcurrently( void )
+{
+  itkDebugMacro( "GenerateOffspringConcurrently" );
+
+  /** Some casts/aliases: */
+  const unsigned int lambda = this->m_PopulationSize;
+
+  /** Clear the old values */
+  this->m_CostFunctionValues.clear();
+
+  /** Prepare the containers that are shared with the workers */
+  this->m_PopulationPositions.resize( lambda );
+  this->m_PopulationValues.assign( lambda, NumericTraits< MeasureType >::Zero );
+  this->m_PopulationPending.assign( lambda, 1 );
+  this->m_PopulationStatus.assign( lambda, EvaluationSucceeded );
+  this->m_PopulationExceptions.assign( lambda, std::exception_ptr() );
+
+  /** The random draws, in the order in which the single-threaded
+   * GenerateOffspring() makes them. Member lam uses draws[ drawIndex[ lam ] ].
+   * In the single-threaded version, a failed member is retried with the next
+   * draw, so all later members shift by one draw. The same is done here, so
+   * that the result does not depend on the evaluation being concurrent. */
+  ParameterContainerType      draws( lambda );
+  std::vector< unsigned int > drawIndex( lambda );
+  for( unsigned int lam = 0; lam < lambda; ++lam )
+  {
+    this->DrawNormalizedSearchDirection( draws[ lam ] );
+    drawIndex[ lam ] = lam;
+    this->SetPopulationMember( lam, draws[ lam ] );
+  }
+
+  /** Setup the threader: one worker per population cost function */
+  const ThreadIdType numberOfWorkers = static_cast< ThreadIdType >(
+    std::min< std::size_t >( this->m_ScaledPopulationCostFunctions.size(), lambda ) );
+  this->m_Threader->SetNumberOfWorkUnits( numberOfWorkers );
+  this->m_Threader->SetSingleMethod( EvaluatePopulationThreaderCallback, static_cast< void * >( this ) );
+
+  /** nrOfFails counts the failures of the first unfinished member, just
+   * like in the single-threaded version, where it is reset after every
+   * successful member. */
+  unsigned int firstPending = 0;
+  unsigned int nrOfFails    = 0;
+  while( firstPending < lambda )
+  {
+    /** Evaluate all pending members concurrently */
+    this->m_Threader->SingleMethodExecute();
+
+    /** Handle the results in the order of the members. */
+    unsigned int lam = firstPending;
+    while( lam < lambda && this->m_PopulationStatus[ lam ] == EvaluationSucceeded )
+    {
+      this->m_PopulationPending[ lam ] = 0;
+      ++lam;
+    }
+    if( lam > firstPending )
+    {
+      nrOfFails = 0;
+    }
+    firstPending = lam;
+    if( firstPending == lambda )
+    {
+      break;
+    }
+
+    /** Exceptions that are not an itk::ExceptionObject are not caught by
+     * the single-threaded version either: pass them to the caller. */
+    if( this->m_PopulationStatus[ lam ] == EvaluationAborted )
+    {
+      std::rethrow_exception( this->m_PopulationExceptions[ lam ] );
+    }
+
+    /** try another parameter vector if we haven't tried that for 10 times already */
+    ++nrOfFails;
+    if( nrOfFails > 10 )
+    {
+      this->m_StopCondition = MetricError;
+      this->StopOptimization();
+      std::rethrow_exception( this->m_PopulationExceptions[ lam ] );
+    }
+
+    /** Member lam and all later members move on to the next draw. The
+     * later members are evaluated again, which only costs extra time
+     * when an evaluation fails. */
+    draws.push_back( ParametersType() );
+    this->DrawNormalizedSearchDirection( draws.back() );
+    for( unsigned int j = lam; j < lambda; ++j )
+    {
+      ++drawIndex[ j ];
+      this->SetPopulationMember( j, draws[ drawIndex[ j ] ] );
+      this->m_PopulationPending[ j ] = 1;
+      this->m_PopulationStatus[ j ]  = EvaluationSucceeded;
+    }
+  }
+
+  /** Store the cost function values in the order of the members */
+  for( unsigned int lam = 0; lam < lambda; ++lam )
+  {
+    this->m_CostFunctionValues.push_back(
+      MeasureIndexPairType( this->m_PopulationValues[ lam ], lam ) );
+  }
+
+} // end GenerateOffspringConcurrently
+
+
+/**
+ * ****************** SetPopulationMember *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::SetPopulationMember(
+  unsigned int lam, const ParametersType & normalizedSearchDir )
+{
+  this->m_NormalizedSearchDirs[ lam ] = normalizedSearchDir;
+  this->ComputeSearchDirection( lam );
+
+  /** x_lam = m + d_lam */
+  this->m_PopulationPositions[ lam ]  = this->GetScaledCurrentPosition();
+  this->m_PopulationPositions[ lam ] += this->m_SearchDirs[ lam ];
+
+} // end SetPopulationMember
+
+
+/**
+ * ************ EvaluatePopulationThreaderCallback ****************************
+ */
+
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+CMAEvolutionStrategyOptimizer::EvaluatePopulationThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType * infoStruct = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID   = infoStruct->WorkUnitID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfWorkUnits;
+  Self *           optimizer   = static_cast< Self * >( infoStruct->UserData );
+
+  /** Call the real implementation. */
+  optimizer->ThreadedEvaluatePopulation( threadID, nrOfThreads );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end EvaluatePopulationThreaderCallback()
+
+
+/**
+ * ************ ThreadedEvaluatePopulation ****************************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::ThreadedEvaluatePopulation(
+  ThreadIdType threadId, ThreadIdType numberOfWorkers )
+{
+  /** Each worker exclusively uses its own cost function. */
+  const ScaledCostFunctionType * costFunction
+    = this->m_ScaledPopulationCostFunctions[ threadId ].GetPointer();
+
+  const unsigned int lambda = this->m_PopulationSize;
+  for( unsigned int lam = threadId; lam < lambda; lam += numberOfWorkers )
+  {
+    if( !this->m_PopulationPending[ lam ] )
+    {
+      continue;
+    }
+
+    /** No exception may escape a worker thread: store it, so that the
+     * main thread can handle it. */
+    try
+    {
+      this->m_PopulationValues[ lam ] = costFunction->GetValue( this->m_PopulationPositions[ lam ] );
+      this->m_PopulationStatus[ lam ] = EvaluationSucceeded;
+    }
+    catch( ExceptionObject & )
+    {
+      this->m_PopulationStatus[ lam ]     = EvaluationFailed;
+      this->m_PopulationExceptions[ lam ] = std::current_exception();
+    }
+    catch( ... )
+    {
+      this->m_PopulationStatus[ lam ]     = EvaluationAborted;
+      this->m_PopulationExceptions[ lam ] = std::current_exception();
+    }
+  }
+
+} // end ThreadedEvaluatePopulation()
+
+
+/**
+ * ****************** SetPopulationCostFunctions *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::SetPopulationCostFunctions(
+  const CostFunctionContainerType & costFunctions )
+{
+  this->m_PopulationCostFunctions = costFunctions;
+  this->m_ScaledPopulationCostFunctions.clear();
+  this->Modified();
+
+} // end SetPopulationCostFunctions
+
+
+/**
+ * ****************** InitializePopulationCostFunctions *********************
+ */
+
+void
+CMAEvolutionStrategyOptimizer::InitializePopulationCostFunctions( void )
+{
+  const ScaledCostFunctionType * scaledCostFunction = this->GetScaledCostFunction();
+
+  this->m_ScaledPopulationCostFunctions.clear();
+  for( std::size_t i = 0; i < this->m_PopulationCostFunctions.size(); ++i )
+  {
+    if( this->m_PopulationCostFunctions[ i ].IsNull() )
+    {
+      itkExceptionMacro( << "Population cost function " << i << " is not set." );
+    }
+
+    /** Copy the settings of the scaled cost function of this optimizer. */
+    ScaledCostFunctionPointer workerCostFunction = ScaledCostFunctionType::New();
+    workerCostFunction->SetUnscaledCostFunction( this->m_PopulationCostFunctions[ i ] );
+    workerCostFunction->SetSquaredScales( scaledCostFunction->GetSquaredScales() );
+    workerCostFunction->SetUseScales( scaledCostFunction->GetUseScales() );
+    workerCostFunction->SetNegateCostFunction( scaledCostFunction->GetNegateCostFunction() );
+
+    if( workerCostFunction->GetNumberOfParameters() != scaledCostFunction->GetNumberOfParameters() )
+    {
+      itkExceptionMacro( << "Population cost function " << i
+                         << " has a different number of parameters than the cost function." );
+    }
+    this->m_ScaledPopulationCostFunctions.push_back( workerCostFunction );
+  }
+
+} // end InitializePopulationCostFunctions
+
+
 /**
  * ****************** SortCostFunctionValues *********************
  */
@@ -23,10 +23,12 @@
 #include <vector>
 #include <utility>
 #include <deque>
+#include <exception>
 
 #include "itkArray.h"
 #include "itkArray2D.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkPlatformMultiThreader.h"
 #include "vnl/vnl_diag_matrix.h"
 
 namespace itk
@@ -43,6 +45,13 @@ namespace itk
  *   - See also the Matlab code, cmaes.m, which you can download from the
  *     website mentioned above.
  *
+ * The offspring of one generation are independent, so they may be evaluated
+ * concurrently. Since a cost function in general cannot be evaluated by
+ * several threads simultaneously, this requires a separate cost function per
+ * worker, see SetPopulationCostFunctions() and UseParallelPopulationEvaluation.
+ * The random search directions are drawn single-threadedly before the
+ * evaluation, so that the result does not depend on the number of workers.
+ *
  * \ingroup Numerics Optimizers
  */
 
@@ -67,6 +76,9 @@ public:
   typedef Superclass::MeasureType            MeasureType;
   typedef Superclass::ScalesType             ScalesType;
 
+  typedef CostFunctionType::Pointer             CostFunctionPointer;
+  typedef std::vector< CostFunctionPointer >    CostFunctionContainerType;
+
   typedef enum {
     MetricError,
     MaximumNumberOfIterations,
@@ -219,6 +231,23 @@ public:
   itkSetMacro( ValueTolerance, double );
   itkGetConstMacro( ValueTolerance, double );
 
+  /** Setting: the cost functions used to evaluate the population concurrently,
+   * one per worker thread. Each of them must compute the same function as the
+   * cost function set by SetCostFunction(), but they must be safe to evaluate
+   * simultaneously, i.e. they must not share transform/metric state. A cost
+   * function that supports re-entrant evaluation may occur multiple times.
+   * Default: empty. */
+  virtual void SetPopulationCostFunctions( const CostFunctionContainerType & costFunctions );
+  const CostFunctionContainerType & GetPopulationCostFunctions( void ) const
+  { return this->m_PopulationCostFunctions; }
+
+  /** Setting: evaluate the offspring of one generation concurrently, using the
+   * population cost functions. Ignored when less than two population cost
+   * functions are set. Default: false */
+  itkSetMacro( UseParallelPopulationEvaluation, bool );
+  itkGetConstMacro( UseParallelPopulationEvaluation, bool );
+  itkBooleanMacro( UseParallelPopulationEvaluation );
+
 protected:
 
   typedef Array< double >               RecombinationWeightsType;
@@ -358,6 +387,30 @@ protected:
    * and m_CostFunctionValues */
   virtual void GenerateOffspring( void );
 
+  /** Same as GenerateOffspring(), but first draws all search directions and
+   * then evaluates the cost function for all offspring concurrently. Failed
+   * evaluations are retried with the same random draws as in the
+   * single-threaded version, so that the result is the same. */
+  virtual void GenerateOffspringConcurrently( void );
+
+  /** Draw a new search direction for offspring member lam, i.e. fill
+   * m_NormalizedSearchDirs[ lam ] and m_SearchDirs[ lam ]. */
+  virtual void DrawSearchDirection( unsigned int lam );
+
+  /** Draw a search direction from N(0,I). */
+  virtual void DrawNormalizedSearchDirection( ParametersType & normalizedSearchDir );
+
+  /** Compute m_SearchDirs[ lam ] from m_NormalizedSearchDirs[ lam ]. */
+  virtual void ComputeSearchDirection( unsigned int lam );
+
+  /** Set the normalized search direction of member lam, and compute its
+   * search direction and position. */
+  virtual void SetPopulationMember( unsigned int lam, const ParametersType & normalizedSearchDir );
+
+  /** Wrap the population cost functions in scaled cost functions, with the
+   * same settings as the scaled cost function of this optimizer. */
+  virtual void InitializePopulationCostFunctions( void );
+
   /** Sort the m_CostFunctionValues vector and update m_MeasureHistory */
   virtual void SortCostFunctionValues( void );
 
@@ -423,6 +476,41 @@ private:
   double        m_PositionToleranceMin;
   double        m_ValueTolerance;
 
+  /** Variables for the concurrent evaluation of the population. */
+  typedef itk::PlatformMultiThreader                 ThreaderType;
+  typedef ThreaderType::WorkUnitInfo                 ThreadInfoType;
+  typedef std::vector< ScaledCostFunctionPointer >   ScaledCostFunctionContainerType;
+  typedef std::vector< MeasureType >                 PopulationMeasureContainerType;
+  typedef std::vector< unsigned char >               PopulationFlagContainerType;
+  typedef std::vector< std::exception_ptr >          PopulationExceptionContainerType;
+
+  /** The result of the evaluation of a member: failed means that an
+   * itk::ExceptionObject was thrown, which leads to a retry; aborted means
+   * that another exception was thrown, which is passed to the caller. */
+  typedef enum {
+    EvaluationSucceeded,
+    EvaluationFailed,
+    EvaluationAborted
+  } EvaluationStatusType;
+  typedef std::vector< EvaluationStatusType > PopulationStatusContainerType;
+
+  bool                             m_UseParallelPopulationEvaluation;
+  ThreaderType::Pointer            m_Threader;
+  CostFunctionContainerType        m_PopulationCostFunctions;
+  ScaledCostFunctionContainerType  m_ScaledPopulationCostFunctions;
+  ParameterContainerType           m_PopulationPositions;
+  PopulationMeasureContainerType   m_PopulationValues;
+  PopulationFlagContainerType      m_PopulationPending;
+  PopulationStatusContainerType    m_PopulationStatus;
+  PopulationExceptionContainerType m_PopulationExceptions;
+
+  /** The callback function. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION EvaluatePopulationThreaderCallback( void * arg );
+
+  /** The threaded implementation of the population evaluation: worker
+   * threadId evaluates the pending members threadId, threadId + nrOfWorkers, etc. */
+  inline void ThreadedEvaluatePopulation( ThreadIdType threadId, ThreadIdType numberOfWorkers );
+
 };
 
 } // end namespace itk
@@ -103,6 +103,17 @@ ConjugateGradient< TElastix >::StartOptimization( void )
     }
   }
 
+  /** Create the cost functions for the speculative line search.
+   * The metric is initialized at this point. */
+  typename Superclass2::ReentrantCostFunctionContainerType costFunctions;
+  if( this->m_LineOptimizer->GetUseSpeculativeEvaluation()
+    && !this->CreateReentrantCostFunctions( costFunctions ) )
+  {
+    xl::xout[ "warning" ] << "WARNING: The metric does not support re-entrant evaluation.\n"
+                          << "  The line search is performed sequentially." << std::endl;
+  }
+  this->m_LineOptimizer->SetSpeculativeCostFunctions( costFunctions );
+
   this->Superclass1::StartOptimization();
 
 }   //end StartOptimization
@@ -292,6 +303,12 @@ ConjugateGradient< TElastix >
     this->m_StopIfWolfeNotSatisfied = false;
   }
 
+  /** Check whether to evaluate trial steps of the line search concurrently. */
+  bool useSpeculativeLineSearch = false;
+  this->m_Configuration->ReadParameter( useSpeculativeLineSearch,
+    "UseSpeculativeLineSearch", this->GetComponentLabel(), level, 0 );
+  this->m_LineOptimizer->SetUseSpeculativeEvaluation( useSpeculativeLineSearch );
+
   this->m_WolfeIsStopCondition     = false;
   this->m_SearchDirectionMagnitude = 0.0;
   this->m_StartLineSearch          = false;
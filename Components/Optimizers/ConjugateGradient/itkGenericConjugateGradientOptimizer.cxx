@@ -20,6 +20,7 @@
 #define __itkGenericConjugateGradientOptimizer_cxx
 
 #include "itkGenericConjugateGradientOptimizer.h"
+#include "itkOptimizerVectorKernels.h"
 #include "vnl/vnl_math.h"
 
 namespace itk
@@ -46,6 +47,7 @@ GenericConjugateGradientOptimizer::GenericConjugateGradientOptimizer()
   this->m_UseDefaultMaxNrOfItWithoutImprovement = true;
   this->m_LineSearchOptimizer                   = nullptr;
   this->m_PreviousGradientAndSearchDirValid     = false;
+  this->m_Threader                              = ThreaderType::New();
 
   this->AddBetaDefinition(
     "SteepestDescent", &Self::ComputeBetaSD );
@@ -284,10 +286,23 @@ GenericConjugateGradientOptimizer::ComputeSearchDirection(
   }
 
   /** Compute the new search direction */
-  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  struct SearchDirectionKernel
   {
-    searchDir[ i ] = -gradient[ i ] + beta * searchDir[ i ];
-  }
+    const double * gradient;
+    double *       searchDir;
+    double         beta;
+
+    void operator()( const SizeValueType begin, const SizeValueType end, const SizeValueType ) const
+    {
+      for( SizeValueType i = begin; i < end; ++i )
+      {
+        searchDir[ i ] = -gradient[ i ] + beta * searchDir[ i ];
+      }
+    }
+  };
+  const SearchDirectionKernel kernel = { gradient.data_block(), searchDir.data_block(), beta };
+  OptimizerVectorKernels::Run( kernel, numberOfParameters,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 
 } // end ComputeSearchDirection
 
@@ -405,17 +420,10 @@ GenericConjugateGradientOptimizer::ComputeBetaFR(
   const DerivativeType & gradient,
   const ParametersType & itkNotUsed( previousSearchDir ) )
 {
-  const unsigned int numberOfParameters = gradient.GetSize();
-  double             num                = 0.0;
-  double             den                = 0.0;
-
-  for( unsigned int i = 0; i < numberOfParameters; ++i )
-  {
-    const double & grad     = gradient[ i ];
-    const double & prevgrad = previousGradient[ i ];
-    num += grad * grad;
-    den += prevgrad * prevgrad;
-  }
+  const double num = OptimizerVectorKernels::SquaredNorm( gradient,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+  const double den = OptimizerVectorKernels::SquaredNorm( previousGradient,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 
   if( den <= NumericTraits< double >::epsilon() )
   {
@@ -612,8 +620,10 @@ GenericConjugateGradientOptimizer::TestConvergence( bool itkNotUsed( firstLineSe
   }
 
   /** Check for convergence of gradient magnitude */
-  const double gnorm = this->GetCurrentGradient().magnitude();
-  const double xnorm = this->GetScaledCurrentPosition().magnitude();
+  const double gnorm = OptimizerVectorKernels::Norm( this->GetCurrentGradient(),
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+  const double xnorm = OptimizerVectorKernels::Norm( this->GetScaledCurrentPosition(),
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
   if( gnorm / std::max( 1.0, xnorm ) <= this->GetGradientMagnitudeTolerance() )
   {
     this->m_StopCondition = GradientMagnitudeTolerance;
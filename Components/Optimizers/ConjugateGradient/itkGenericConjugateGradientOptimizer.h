@@ -21,6 +21,7 @@
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
 #include "itkLineSearchOptimizer.h"
+#include "itkPlatformMultiThreader.h"
 #include <vector>
 #include <map>
 
@@ -135,6 +136,15 @@ public:
 
   itkGetConstReferenceMacro( BetaDefinition, BetaDefinitionType );
 
+  /** Set the number of threads, used for the vector operations on large
+   * parameter vectors.
+   */
+  void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfWorkUnits( numberOfThreads );
+  }
+
+
 protected:
 
   GenericConjugateGradientOptimizer();
@@ -142,6 +152,9 @@ protected:
 
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Typedefs for multi-threading. */
+  typedef itk::PlatformMultiThreader ThreaderType;
+
   DerivativeType    m_CurrentGradient;
   MeasureType       m_CurrentValue;
   unsigned long     m_CurrentIteration;
@@ -170,6 +183,8 @@ protected:
    * compute \f$\beta\f$. */
   BetaDefinitionMapType m_BetaDefinitionMap;
 
+  ThreaderType::Pointer m_Threader;
+
   /** Function to add a new beta definition. The first argument should be a name
    * via which a user can select this \f$\beta\f$ definition. The second argument is a
    * pointer to a method that computes \f$\beta\f$.
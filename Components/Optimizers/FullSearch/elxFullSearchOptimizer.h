@@ -48,6 +48,13 @@ namespace elastix
  *   This varies the second transform parameter in the range [-4.0 3.0] with steps of 1.0
  *   and the third parameter in the range [-1.0 1.0] with steps of 0.5. The names are used
  *   as column headers in the screen output.
+ * \parameter UseParallelSearchSpaceEvaluation: whether to evaluate the points of the search
+ *    space concurrently, using one thread per point. This requires a metric that supports
+ *    re-entrant evaluation, such as the AdvancedMeanSquares; otherwise the search space is
+ *    evaluated sequentially. The result does not depend on this setting.
+ *    This parameter can be specified for each resolution. \n
+ *    example: <tt>(UseParallelSearchSpaceEvaluation "true")</tt> \n
+ *    Default: "false".
  *
  * \ingroup Optimizers
  * \sa FullSearchOptimizer
@@ -95,6 +102,7 @@ public:
   typedef Superclass1::SearchSpacePointType    SearchSpacePointType;
   typedef Superclass1::SearchSpaceIndexType    SearchSpaceIndexType;
   typedef Superclass1::SearchSpaceSizeType     SearchSpaceSizeType;
+  typedef Superclass1::CostFunctionContainerType CostFunctionContainerType;
 
   /** Typedef's inherited from Elastix.*/
   typedef typename Superclass2::ElastixType          ElastixType;
@@ -124,6 +132,9 @@ public:
 
   void AfterRegistration( void ) override;
 
+  /** Create the search cost functions, before starting the optimization. */
+  void StartOptimization( void ) override;
+
   /** \todo BeforeAll, checking parameters. */
 
   /** Get a pointer to the image containing the optimization surface. */
@@ -193,6 +193,12 @@ FullSearch< TElastix >
       << "." << resultImageFormat;
     this->m_OptimizationSurface->SetOutputFileName( makeString.str().c_str() );
 
+    /** Read whether the search space is evaluated concurrently. */
+    bool useParallelSearchSpaceEvaluation = false;
+    this->m_Configuration->ReadParameter( useParallelSearchSpaceEvaluation,
+      "UseParallelSearchSpaceEvaluation", this->GetComponentLabel(), level, 0 );
+    this->SetUseParallelSearchSpaceEvaluation( useParallelSearchSpaceEvaluation );
+
     elxout
       << "Total number of iterations needed in this resolution: "
       << this->GetNumberOfIterations()
@@ -208,6 +214,38 @@ FullSearch< TElastix >
 } // end BeforeEachResolution()
 
 
+/**
+ * ***************** StartOptimization ***********************
+ */
+
+template< class TElastix >
+void
+FullSearch< TElastix >
+::StartOptimization( void )
+{
+  /** Release the cost functions of the previous resolution. */
+  this->SetSearchCostFunctions( CostFunctionContainerType() );
+  if( this->GetUseParallelSearchSpaceEvaluation() )
+  {
+    /** The metric is initialized at this point, so the contexts can be created. */
+    CostFunctionContainerType costFunctions;
+    if( this->CreateReentrantCostFunctions( costFunctions ) )
+    {
+      this->SetSearchCostFunctions( costFunctions );
+    }
+    else
+    {
+      xl::xout[ "warning" ] << "WARNING: The metric does not support re-entrant evaluation.\n"
+                            << "  The search space is evaluated sequentially." << std::endl;
+    }
+  }
+
+  /** Call the superclass */
+  this->Superclass1::StartOptimization();
+
+} // end StartOptimization()
+
+
 /**
  * ***************** AfterEachIteration *************************
  */
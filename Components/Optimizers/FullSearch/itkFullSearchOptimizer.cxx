@@ -25,6 +25,8 @@
 #include "itkMacro.h"
 #include "itkNumericTraits.h"
 
+#include <algorithm>
+
 namespace itk
 {
 
@@ -46,6 +48,9 @@ FullSearchOptimizer
   m_SearchSpace                   = nullptr;
   m_LastSearchSpaceChanges        = 0;
 
+  this->m_UseParallelSearchSpaceEvaluation = false;
+  this->m_Threader                         = ThreaderType::New();
+
 }   //end constructor
 
 
@@ -95,6 +100,13 @@ FullSearchOptimizer
 
   itkDebugMacro( "ResumeOptimization" );
 
+  if( this->m_UseParallelSearchSpaceEvaluation
+    && this->m_SearchCostFunctions.size() > 1 )
+  {
+    this->ResumeOptimizationConcurrently();
+    return;
+  }
+
   m_Stop = false;
 
   InvokeEvent( StartEvent() );
@@ -149,6 +161,194 @@ FullSearchOptimizer
 }   //end function ResumeOptimization
 
 
+/**
+ * ************* Resume the optimization concurrently ************
+ */
+void
+FullSearchOptimizer
+::ResumeOptimizationConcurrently( void )
+{
+
+  itkDebugMacro( "ResumeOptimizationConcurrently" );
+
+  for( std::size_t i = 0; i < this->m_SearchCostFunctions.size(); ++i )
+  {
+    if( this->m_SearchCostFunctions[ i ].IsNull() )
+    {
+      itkExceptionMacro( << "Search cost function " << i << " is not set." );
+    }
+  }
+
+  const unsigned int numberOfWorkers = static_cast< unsigned int >(
+    this->m_SearchCostFunctions.size() );
+  std::vector< SearchSpaceIndexType > batchIndices( numberOfWorkers );
+  std::vector< SearchSpacePointType > batchPoints( numberOfWorkers );
+
+  m_Stop = false;
+
+  InvokeEvent( StartEvent() );
+  while( !m_Stop )
+  {
+    /** Collect the next points of the search space, starting with the current
+     * one, but not beyond the last one. */
+    const unsigned long numberOfIterationsLeft
+      = this->GetNumberOfIterations() - m_CurrentIteration;
+    const unsigned int batchSize = static_cast< unsigned int >(
+      std::min< unsigned long >( numberOfWorkers, numberOfIterationsLeft ) );
+    this->m_BatchPositions.resize( batchSize );
+    this->m_BatchValues.assign( batchSize, NumericTraits< MeasureType >::Zero );
+    this->m_BatchStatus.assign( batchSize, EvaluationSucceeded );
+    this->m_BatchExceptions.assign( batchSize, std::exception_ptr() );
+    for( unsigned int i = 0; i < batchSize; ++i )
+    {
+      if( i > 0 )
+      {
+        this->UpdateCurrentPosition();
+      }
+      batchIndices[ i ]           = m_CurrentIndexInSearchSpace;
+      batchPoints[ i ]            = m_CurrentPointInSearchSpace;
+      this->m_BatchPositions[ i ] = this->GetCurrentPosition();
+    }
+
+    /** Evaluate them concurrently. */
+    this->m_Threader->SetNumberOfWorkUnits( batchSize );
+    this->m_Threader->SetSingleMethod( EvaluateBatchThreaderCallback, static_cast< void * >( this ) );
+    this->m_Threader->SingleMethodExecute();
+
+    /** Process the results in the order of the search space, like
+     * ResumeOptimization() does. */
+    for( unsigned int i = 0; i < batchSize; ++i )
+    {
+      m_CurrentIndexInSearchSpace = batchIndices[ i ];
+      m_CurrentPointInSearchSpace = batchPoints[ i ];
+      this->SetCurrentPosition( this->m_BatchPositions[ i ] );
+
+      if( this->m_BatchStatus[ i ] == EvaluationFailed )
+      {
+        // An exception has occurred.
+        // Terminate immediately.
+        m_StopCondition = MetricError;
+        StopOptimization();
+      }
+      if( this->m_BatchStatus[ i ] != EvaluationSucceeded )
+      {
+        // Pass exception to caller
+        std::rethrow_exception( this->m_BatchExceptions[ i ] );
+      }
+      m_Value = this->m_BatchValues[ i ];
+
+      if( m_Stop )
+      {
+        break;
+      }
+
+      /** Check if the value is a minimum or maximum */
+      if( ( m_Value < m_BestValue )  ^  m_Maximize )         // ^ = xor, yields true if only one of the expressions is true
+      {
+        m_BestValue              = m_Value;
+        m_BestPointInSearchSpace = m_CurrentPointInSearchSpace;
+        m_BestIndexInSearchSpace = m_CurrentIndexInSearchSpace;
+      }
+
+      this->InvokeEvent( IterationEvent() );
+
+      /** Prepare for next step */
+      m_CurrentIteration++;
+
+      if( m_CurrentIteration >= this->GetNumberOfIterations() )
+      {
+        m_StopCondition = FullRangeSearched;
+        StopOptimization();
+        break;
+      }
+
+      /** Set the next position in search space, after the last point of
+       * the batch, or when an observer stopped the optimization. */
+      if( m_Stop || i + 1 == batchSize )
+      {
+        this->UpdateCurrentPosition();
+      }
+      if( m_Stop )
+      {
+        break;
+      }
+    }
+
+  } // end while
+
+}   //end function ResumeOptimizationConcurrently
+
+
+/**
+ * ************ EvaluateBatchThreaderCallback ********************
+ */
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+FullSearchOptimizer
+::EvaluateBatchThreaderCallback( void * arg )
+{
+  /** Get the current thread id and user data. */
+  ThreadInfoType * infoStruct  = static_cast< ThreadInfoType * >( arg );
+  ThreadIdType     threadID    = infoStruct->WorkUnitID;
+  ThreadIdType     nrOfThreads = infoStruct->NumberOfWorkUnits;
+  Self *           optimizer   = static_cast< Self * >( infoStruct->UserData );
+
+  /** Call the real implementation. */
+  optimizer->ThreadedEvaluateBatch( threadID, nrOfThreads );
+
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+
+} // end EvaluateBatchThreaderCallback()
+
+
+/**
+ * ******************* ThreadedEvaluateBatch *********************
+ */
+void
+FullSearchOptimizer
+::ThreadedEvaluateBatch( ThreadIdType threadId, ThreadIdType numberOfWorkers )
+{
+  /** Each worker exclusively uses its own cost function. */
+  const CostFunctionType * costFunction
+    = this->m_SearchCostFunctions[ threadId ].GetPointer();
+
+  const std::size_t batchSize = this->m_BatchPositions.size();
+  for( std::size_t i = threadId; i < batchSize; i += numberOfWorkers )
+  {
+    /** No exception may escape a worker thread: store it, so that the
+     * main thread can handle it. */
+    try
+    {
+      this->m_BatchValues[ i ] = costFunction->GetValue( this->m_BatchPositions[ i ] );
+      this->m_BatchStatus[ i ] = EvaluationSucceeded;
+    }
+    catch( ExceptionObject & )
+    {
+      this->m_BatchStatus[ i ]     = EvaluationFailed;
+      this->m_BatchExceptions[ i ] = std::current_exception();
+    }
+    catch( ... )
+    {
+      this->m_BatchStatus[ i ]     = EvaluationAborted;
+      this->m_BatchExceptions[ i ] = std::current_exception();
+    }
+  }
+
+} // end ThreadedEvaluateBatch()
+
+
+/**
+ * ******************* SetSearchCostFunctions ********************
+ */
+void
+FullSearchOptimizer
+::SetSearchCostFunctions( const CostFunctionContainerType & costFunctions )
+{
+  this->m_SearchCostFunctions = costFunctions;
+  this->Modified();
+
+} // end SetSearchCostFunctions()
+
+
 /**
  * ************************** Stop optimization ******************
  */
@@ -24,6 +24,10 @@
 #include "itkImage.h"
 #include "itkArray.h"
 #include "itkFixedArray.h"
+#include "itkPlatformMultiThreader.h"
+
+#include <exception>
+#include <vector>
 
 namespace itk
 {
@@ -35,6 +39,13 @@ namespace itk
  * Optimizer that scans a subspace of the parameter space
  * and searches for the best parameters.
  *
+ * The points of the search space are independent, so they may be evaluated
+ * concurrently. Since a cost function in general cannot be evaluated by
+ * several threads simultaneously, this requires a separate cost function per
+ * worker, see SetSearchCostFunctions() and UseParallelSearchSpaceEvaluation.
+ * The results are processed in the order of the search space, so the
+ * IterationEvents and the result are the same as without concurrency.
+ *
  * \todo This optimizer has similar functionality as the recently added
  * itkExhaustiveOptimizer. See if we can replace it by that optimizer,
  * or inherit from it.
@@ -71,6 +82,8 @@ public:
   typedef Superclass::CostFunctionPointer CostFunctionPointer;
   typedef Superclass::MeasureType         MeasureType;
 
+  typedef std::vector< CostFunctionPointer > CostFunctionContainerType;
+
   typedef ParametersType::ValueType               ParameterValueType;     // = double
   typedef ParameterValueType                      RangeValueType;
   typedef FixedArray< RangeValueType, 3 >         RangeType;
@@ -191,6 +204,23 @@ public:
   /** Get Stop condition. */
   itkGetConstMacro( StopCondition, StopConditionType );
 
+  /** Set/Get the cost functions used to evaluate the search space
+   * concurrently, one per worker thread. Each of them must compute the same
+   * function as the cost function set by SetCostFunction(), but they must be
+   * safe to evaluate simultaneously. Default: empty.
+   */
+  virtual void SetSearchCostFunctions( const CostFunctionContainerType & costFunctions );
+  const CostFunctionContainerType & GetSearchCostFunctions( void ) const
+  { return this->m_SearchCostFunctions; }
+
+  /** Set/Get whether to evaluate the points of the search space concurrently,
+   * using the search cost functions. Ignored when less than two search cost
+   * functions are set. Default: false.
+   */
+  itkSetMacro( UseParallelSearchSpaceEvaluation, bool );
+  itkGetConstMacro( UseParallelSearchSpaceEvaluation, bool );
+  itkBooleanMacro( UseParallelSearchSpaceEvaluation );
+
 protected:
 
   FullSearchOptimizer();
@@ -215,6 +245,11 @@ protected:
   unsigned long m_LastSearchSpaceChanges;
   virtual void ProcessSearchSpaceChanges( void );
 
+  /** Same as ResumeOptimization(), but evaluates a batch of points, one per
+   * search cost function, concurrently, before processing them in order.
+   */
+  virtual void ResumeOptimizationConcurrently( void );
+
 private:
 
   FullSearchOptimizer( const Self & ); // purposely not implemented
@@ -222,6 +257,40 @@ private:
 
   unsigned long m_CurrentIteration;
 
+  typedef itk::PlatformMultiThreader        ThreaderType;
+  typedef ThreaderType::WorkUnitInfo        ThreadInfoType;
+  typedef std::vector< ParametersType >     ParameterContainerType;
+  typedef std::vector< MeasureType >        MeasureContainerType;
+  typedef std::vector< std::exception_ptr > ExceptionContainerType;
+
+  /** The result of the evaluation of a point: failed means that an
+   * itk::ExceptionObject was thrown, which stops the optimization with a
+   * MetricError; aborted means that another exception was thrown. Both are
+   * passed to the caller.
+   */
+  typedef enum {
+    EvaluationSucceeded,
+    EvaluationFailed,
+    EvaluationAborted
+  } EvaluationStatusType;
+  typedef std::vector< EvaluationStatusType > StatusContainerType;
+
+  bool                      m_UseParallelSearchSpaceEvaluation;
+  ThreaderType::Pointer     m_Threader;
+  CostFunctionContainerType m_SearchCostFunctions;
+
+  /** The current batch of points and their results. */
+  ParameterContainerType m_BatchPositions;
+  MeasureContainerType   m_BatchValues;
+  StatusContainerType    m_BatchStatus;
+  ExceptionContainerType m_BatchExceptions;
+
+  /** The callback function. */
+  static ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION EvaluateBatchThreaderCallback( void * arg );
+
+  /** The threaded implementation: evaluate the points of a worker. */
+  void ThreadedEvaluateBatch( ThreadIdType threadId, ThreadIdType numberOfWorkers );
+
 };
 
 } // end namespace itk
@@ -439,6 +439,8 @@ PreconditionedGradientDescent<TElastix>
   elxout << "Sparsity: " << this->GetSparsity() << std::endl;
   elxout << "Largest eigenvalue: " << this->GetLargestEigenValue() << std::endl;
   elxout << "Condition number: " << this->GetConditionNumber() << std::endl;
+  elxout << "Reused symbolic factorization: "
+    << ( this->GetSymbolicFactorizationReused() ? "true" : "false" ) << std::endl;
   timer.Stop();
 
   elxout << "Computing Cholesky decomposition took: "
@@ -80,6 +80,7 @@ PreconditionedGradientDescentOptimizer
 
   this->m_CholmodFactor = 0;
   this->m_CholmodGradient = 0;
+  this->m_SymbolicFactorizationReused = false;
 
 } // end Constructor
 
@@ -447,7 +448,66 @@ PreconditionedGradientDescentOptimizer
    * column-based compressed format, so when we will copy this matrix,
    * we implicitly transpose the matrix. The cholmod_sparse will thus
    * have stype -1, meaning that the lower-triangular part is stored.
+   *
+   * The symbolic factorization only depends on the sparsity pattern.
+   * If the pattern is contained in the pattern of the previous
+   * precondition matrix, e.g. for a next resolution with the same
+   * B-spline grid, the previous pattern is used, padded with zeros,
+   * and the symbolic factorization is reused.
    */
+  bool reusePattern = this->m_CholmodFactor != 0
+    && this->m_PreconditionColumnPointers.size() == spaceDimension + 1;
+  for( unsigned int r = 0; r < spaceDimension && reusePattern; ++r )
+  {
+    RowType & rowVector = precondition.get_row( r );
+    CInt k = this->m_PreconditionColumnPointers[ r ];
+    const CInt kEnd = this->m_PreconditionColumnPointers[ r + 1 ];
+    for( RowIteratorType rowIt = rowVector.begin(); rowIt != rowVector.end(); ++rowIt )
+    {
+      while( k < kEnd && this->m_PreconditionRowIndices[ k ] < static_cast<CInt>( rowIt->first ) )
+      {
+        ++k;
+      }
+      if( k == kEnd || this->m_PreconditionRowIndices[ k ] != static_cast<CInt>( rowIt->first ) )
+      {
+        reusePattern = false;
+        break;
+      }
+    }
+  }
+  this->m_SymbolicFactorizationReused = reusePattern;
+
+  if( reusePattern )
+  {
+    nnz = this->m_PreconditionRowIndices.size();
+  }
+  else
+  {
+    /** Store the new pattern. */
+    this->m_PreconditionColumnPointers.resize( spaceDimension + 1 );
+    this->m_PreconditionRowIndices.resize( nnz );
+    CInt k = 0;
+    for( unsigned int r = 0; r < spaceDimension; ++r )
+    {
+      RowType & rowVector = precondition.get_row( r );
+      this->m_PreconditionColumnPointers[ r ] = k;
+      for( RowIteratorType rowIt = rowVector.begin(); rowIt != rowVector.end(); ++rowIt )
+      {
+        this->m_PreconditionRowIndices[ k ] = rowIt->first;
+        ++k;
+      }
+    }
+    this->m_PreconditionColumnPointers[ spaceDimension ] = k;
+
+    /** Sanity check */
+    if( static_cast<size_t>( k ) != nnz )
+    {
+      this->m_PreconditionColumnPointers.clear();
+      this->m_PreconditionRowIndices.clear();
+      itkExceptionMacro( "ERROR: unexpected error during conversion to cholmod format");
+    }
+  }
+
   const int stype = -1;
   const bool sorted = true;
   const bool packed = true;
@@ -461,38 +521,39 @@ PreconditionedGradientDescentOptimizer
   /** size spaceDimension+1 */
   CInt * cCol = reinterpret_cast<CInt *>( cPrecondition->p );
 
-  /** Loop over rows of input matrix */
-  const CInt * cRowBegin = cRow;
+  /** Copy the pattern and scatter the values of each row of the input matrix. */
+  std::copy( this->m_PreconditionColumnPointers.begin(),
+    this->m_PreconditionColumnPointers.end(), cCol );
+  std::copy( this->m_PreconditionRowIndices.begin(),
+    this->m_PreconditionRowIndices.end(), cRow );
+  std::fill( cVal, cVal + nnz, 0.0 );
   for( unsigned int r = 0; r < spaceDimension; ++r )
   {
     RowType & rowVector = precondition.get_row( r );
-    (*cCol) = static_cast<int>( cRow - cRowBegin );
-    ++cCol;
-
-    /** Iterate over each row */
+    CInt k = cCol[ r ];
     for( RowIteratorType rowIt = rowVector.begin(); rowIt != rowVector.end(); ++rowIt )
     {
-      (*cRow) = rowIt->first;
-      (*cVal) = rowIt->second;
-      ++cRow;
-      ++cVal;
+      while( cRow[ k ] != static_cast<CInt>( rowIt->first ) )
+      {
+        ++k;
+      }
+      cVal[ k ] = rowIt->second;
     }
   }
-  (*cCol) = static_cast<int>(cRow - cRowBegin);
-
-  /** Sanity check */
-  if( static_cast<size_t>(*cCol) != nnz )
-  {
-    /** Release memory */
-    cholmod_free_sparse( &cPrecondition, this->m_CholmodCommon );
-    itkExceptionMacro( "ERROR: unexpected error during conversion to cholmod format");
-  }
 
   /** Destroy precondition input, to save memory */
   precondition.set_size( 0, 0 );
 
   /** Prepare for factorization */
-  this->m_CholmodFactor = cholmod_analyze( cPrecondition, this->m_CholmodCommon );
+  if( !reusePattern )
+  {
+    if( this->m_CholmodFactor )
+    {
+      cholmod_free_factor( &this->m_CholmodFactor, this->m_CholmodCommon );
+      this->m_CholmodFactor = 0;
+    }
+    this->m_CholmodFactor = cholmod_analyze( cPrecondition, this->m_CholmodCommon );
+  }
 
   /** Factorize cPrediction + diagonalWeight * largestEig * Identity */
   double beta[2];
@@ -180,6 +180,11 @@ public:
    */
   itkGetConstMacro( Sparsity, double );
 
+  /** Get whether the symbolic factorization of the previous precondition
+   * matrix was reused; only valid after calling SetPreconditionMatrix.
+   */
+  itkGetConstMacro( SymbolicFactorizationReused, bool );
+
 protected:
   PreconditionedGradientDescentOptimizer();
   virtual ~PreconditionedGradientDescentOptimizer();
@@ -202,6 +207,13 @@ protected:
   cholmod_factor * m_CholmodFactor;
   cholmod_sparse * m_CholmodGradient;
 
+  /** The sparsity pattern of the symbolic factorization, in compressed
+   * column format, to detect whether it can be reused.
+   */
+  std::vector<CInt> m_PreconditionColumnPointers;
+  std::vector<CInt> m_PreconditionRowIndices;
+  bool              m_SymbolicFactorizationReused;
+
   /** Solve Hx = g, using the Cholesky decomposition of the preconditioner.
    * Matlab notation: x = L'\(L\g) = Pg = searchDirection
    * The last argument can be used to also solve different systems, like L x = g.
@@ -29,6 +29,7 @@
 #include <utility>
 #include "itkAdvancedImageToImageMetric.h"
 #include "itkTimeProbe.h"
+#include "itkHotPathProfiler.h"
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -452,6 +453,8 @@ void
 PreconditionedStochasticGradientDescent< TElastix >
 ::AdvanceOneStep( void )
 {
+  itkHotPathNamedScopedTimerMacro( advanceOneStepTimer, "Optimizer::AdvanceOneStep" );
+
   /** Get space dimension. */
   const unsigned int spaceDimension = this->GetScaledCostFunction()->GetNumberOfParameters();
 
@@ -476,6 +479,7 @@ PreconditionedStochasticGradientDescent< TElastix >
   }
 
   this->Superclass1::UpdateCurrentTime();
+  itkHotPathStopTimerMacro( advanceOneStepTimer );
   this->InvokeEvent( itk::IterationEvent() );
 
 } // end AdvanceOneStep()
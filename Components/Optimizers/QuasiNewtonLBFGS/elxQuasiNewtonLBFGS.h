@@ -80,6 +80,13 @@ namespace elastix
  *    In general it is wise to do so.\n
  *    example: <tt>(StopIfWolfeNotSatisfied "true" "false")</tt> \n
  *    Default value: "true".\n
+ * \parameter UseSpeculativeLineSearch: Whether the line search evaluates several
+ *    trial step lengths concurrently. The result equals the sequential line search;
+ *    only the extrapolation of a too short initial step is faster. Requires a
+ *    metric that supports re-entrant evaluation, such as AdvancedMeanSquares;
+ *    otherwise a warning is printed and the line search is sequential.\n
+ *    example: <tt>(UseSpeculativeLineSearch "true" "false")</tt> \n
+ *    Default value: "false".\n
  *
  * \ingroup Optimizers
  */
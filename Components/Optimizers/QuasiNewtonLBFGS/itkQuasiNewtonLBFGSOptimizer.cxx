@@ -21,6 +21,7 @@
 
 #include "itkQuasiNewtonLBFGSOptimizer.h"
 #include "itkArray.h"
+#include "itkOptimizerVectorKernels.h"
 #include "vnl/vnl_math.h"
 
 namespace itk
@@ -43,6 +44,7 @@ QuasiNewtonLBFGSOptimizer::QuasiNewtonLBFGSOptimizer()
   this->m_Point             = 0;
   this->m_PreviousPoint     = 0;
   this->m_Bound             = 0;
+  this->m_Threader          = ThreaderType::New();
 
   this->m_MaximumNumberOfIterations  = 100;
   this->m_GradientMagnitudeTolerance = 1e-5;
@@ -246,7 +248,8 @@ QuasiNewtonLBFGSOptimizer::ComputeDiagonalMatrix( DiagonalMatrixType & diag_H0 )
   {
     const DerivativeType & y  = this->m_Y[ this->m_PreviousPoint ];
     const double           ys = 1.0 / this->m_Rho[ this->m_PreviousPoint ];
-    const double           yy = y.squared_magnitude();
+    const double           yy = OptimizerVectorKernels::SquaredNorm( y,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
     fill_value = ys / yy;
     if( fill_value <= 0. )
     {
@@ -276,7 +279,6 @@ QuasiNewtonLBFGSOptimizer::ComputeSearchDirection(
   typedef Array< double > AlphaType;
   AlphaType alpha( this->GetMemory() );
 
-  const unsigned int numberOfParameters = gradient.GetSize();
   DiagonalMatrixType H0;
   this->ComputeDiagonalMatrix( H0 );
 
@@ -291,31 +293,24 @@ QuasiNewtonLBFGSOptimizer::ComputeSearchDirection(
     {
       cp = this->GetMemory() - 1;
     }
-    const double sq = inner_product( this->m_S[ cp ], searchDir );
+    const double sq = OptimizerVectorKernels::Dot( this->m_S[ cp ], searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
     alpha[ cp ] = this->m_Rho[ cp ] * sq;
-    const double &         alpha_cp = alpha[ cp ];
-    const DerivativeType & y        = this->m_Y[ cp ];
-    for( unsigned int j = 0; j < numberOfParameters; ++j )
-    {
-      searchDir[ j ] -= alpha_cp * y[ j ];
-    }
+    OptimizerVectorKernels::Axpy( -alpha[ cp ], this->m_Y[ cp ], searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
   }
 
-  for( unsigned int j = 0; j < numberOfParameters; ++j )
-  {
-    searchDir[ j ] *= H0[ j ];
-  }
+  OptimizerVectorKernels::Multiply( H0, searchDir,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
 
   for( unsigned int i = 0; i < this->m_Bound; ++i )
   {
-    const double           yr             = inner_product( this->m_Y[ cp ], searchDir );
-    const double           beta           = this->m_Rho[ cp ] * yr;
-    const double           alpha_min_beta = alpha[ cp ] - beta;
-    const ParametersType & s              = this->m_S[ cp ];
-    for( unsigned int j = 0; j < numberOfParameters; ++j )
-    {
-      searchDir[ j ] += alpha_min_beta * s[ j ];
-    }
+    const double yr             = OptimizerVectorKernels::Dot( this->m_Y[ cp ], searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+    const double beta           = this->m_Rho[ cp ] * yr;
+    const double alpha_min_beta = alpha[ cp ] - beta;
+    OptimizerVectorKernels::Axpy( alpha_min_beta, this->m_S[ cp ], searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
     ++cp;
     if( static_cast< unsigned int >( cp ) == this->GetMemory() )
     {
@@ -326,7 +321,10 @@ QuasiNewtonLBFGSOptimizer::ComputeSearchDirection(
   /** Normalize if no information about previous steps is available yet */
   if( this->m_Bound == 0 )
   {
-    searchDir /= gradient.magnitude();
+    const double gradientNorm = OptimizerVectorKernels::Norm( gradient,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+    OptimizerVectorKernels::Scale( 1.0 / gradientNorm, searchDir,
+      this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
   }
 
 } // end ComputeSearchDirection
@@ -409,7 +407,8 @@ QuasiNewtonLBFGSOptimizer::StoreCurrentPoint(
 
   this->m_S[ this->m_Point ]   = step;                                  // s
   this->m_Y[ this->m_Point ]   = grad_dif;                              // y
-  this->m_Rho[ this->m_Point ] = 1.0 / inner_product( step, grad_dif ); // 1/ys
+  this->m_Rho[ this->m_Point ] = 1.0 / OptimizerVectorKernels::Dot( step, grad_dif,
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() ); // 1/ys
 
 } // end StoreCurrentPoint
 
@@ -441,8 +440,10 @@ QuasiNewtonLBFGSOptimizer::TestConvergence( bool firstLineSearchDone )
   }
 
   /** Check for convergence of gradient magnitude */
-  const double gnorm = this->GetCurrentGradient().magnitude();
-  const double xnorm = this->GetScaledCurrentPosition().magnitude();
+  const double gnorm = OptimizerVectorKernels::Norm( this->GetCurrentGradient(),
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+  const double xnorm = OptimizerVectorKernels::Norm( this->GetScaledCurrentPosition(),
+    this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
   if( gnorm / std::max( 1.0, xnorm ) <= this->GetGradientMagnitudeTolerance() )
   {
     this->m_StopCondition = GradientMagnitudeTolerance;
@@ -21,6 +21,7 @@
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
 #include "itkLineSearchOptimizer.h"
+#include "itkPlatformMultiThreader.h"
 #include <vector>
 
 namespace itk
@@ -129,6 +130,15 @@ public:
   itkSetMacro( Memory, unsigned int );
   itkGetConstMacro( Memory, unsigned int );
 
+  /** Set the number of threads, used for the vector operations on large
+   * parameter vectors.
+   */
+  void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfWorkUnits( numberOfThreads );
+  }
+
+
 protected:
 
   QuasiNewtonLBFGSOptimizer();
@@ -137,6 +147,9 @@ protected:
   // \todo: should be implemented
   void PrintSelf( std::ostream & os, Indent indent ) const override {}
 
+  /** Typedefs for multi-threading. */
+  typedef itk::PlatformMultiThreader ThreaderType;
+
   DerivativeType    m_CurrentGradient;
   MeasureType       m_CurrentValue;
   unsigned long     m_CurrentIteration;
@@ -155,6 +168,8 @@ protected:
   unsigned int m_PreviousPoint;
   unsigned int m_Bound;
 
+  ThreaderType::Pointer m_Threader;
+
   itkSetMacro( InLineSearch, bool );
 
   /** Compute H0
@@ -19,6 +19,7 @@
 #define __itkGradientDescentOptimizer2_h
 
 #include "itkScaledSingleValuedNonLinearOptimizer.h"
+#include "itkPlatformMultiThreader.h"
 
 
 namespace itk
@@ -133,12 +134,24 @@ public:
   /** Set use OpenMP or not. */
   itkSetMacro( UseOpenMP, bool );
 
+  /** Set the number of threads, used for the vector operations on large
+   * parameter vectors.
+   */
+  void SetNumberOfWorkUnits( ThreadIdType numberOfThreads )
+  {
+    this->m_Threader->SetNumberOfWorkUnits( numberOfThreads );
+  }
+
+
 protected:
 
   GradientDescentOptimizer2();
   ~GradientDescentOptimizer2() override {}
   void PrintSelf( std::ostream & os, Indent indent ) const override;
 
+  /** Typedefs for multi-threading. */
+  typedef itk::PlatformMultiThreader ThreaderType;
+
   // made protected so subclass can access
   double            m_Value;
   DerivativeType    m_Gradient;
@@ -150,6 +163,8 @@ protected:
   unsigned long m_NumberOfIterations;
   unsigned long m_CurrentIteration;
 
+  ThreaderType::Pointer m_Threader;
+
 private:
 
   GradientDescentOptimizer2( const Self & ); // purposely not implemented
@@ -20,6 +20,7 @@
 #include "itkCommand.h"
 #include "itkEventObject.h"
 #include "itkMacro.h"
+#include "itkHotPathProfiler.h"
 
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -218,6 +219,7 @@ StochasticGradientDescentOptimizer
 ::AdvanceOneStep( void )
 {
   itkDebugMacro( "AdvanceOneStep" );
+  itkHotPathNamedScopedTimerMacro( advanceOneStepTimer, "Optimizer::AdvanceOneStep" );
 
   /** Get space dimension. */
   const unsigned int spaceDimension
@@ -320,6 +322,8 @@ StochasticGradientDescentOptimizer
     delete temp;
   }
 
+  itkHotPathStopTimerMacro( advanceOneStepTimer );
+
   this->InvokeEvent( IterationEvent() );
 
 } // end AdvanceOneStep()
@@ -165,6 +165,9 @@ public:
   typedef typename Superclass::ThreaderType   ThreaderType;
   typedef typename Superclass::ThreadInfoType ThreadInfoType;
 
+  /** Typedef for the re-entrant evaluation. */
+  typedef typename Superclass::EvaluationContextType EvaluationContextType;
+
   /**
    * Get and set the metrics and their weights.
    **/
@@ -395,6 +398,30 @@ public:
     const TransformParametersType & parameters,
     HessianType & H ) const override;
 
+  /** Returns true when all sub metrics are image metrics that support
+   * re-entrant evaluation.
+   */
+  bool GetSupportsReentrantEvaluation( void ) const override;
+
+  /** Initialize a context for each sub metric. When the re-entrant
+   * evaluation is not supported, the superclass' context is used.
+   */
+  void InitializeEvaluationContext( EvaluationContextType & context,
+    ThreadIdType numberOfWorkUnits = 1 ) const override;
+
+  /** Combine the values of the sub metrics, evaluated in their contexts,
+   * in the same way as GetValue().
+   */
+  MeasureType GetValueInContext( const ParametersType & parameters,
+    EvaluationContextType & context ) const override;
+
+  /** Combine the values and derivatives of the sub metrics, evaluated in
+   * their contexts, in the same way as GetValueAndDerivative().
+   */
+  void GetValueAndDerivativeInContext( const ParametersType & parameters,
+    MeasureType & value, DerivativeType & derivative,
+    EvaluationContextType & context ) const override;
+
   /** Method to return the latest modified time of this object or any of its
    * cached ivars.
    */
@@ -438,6 +465,13 @@ private:
    */
   double GetFinalMetricWeight( unsigned int pos ) const;
 
+  /** The same, given the derivative magnitudes of all metrics. */
+  double GetFinalMetricWeight( unsigned int pos,
+    const std::vector< double > & derivativesMagnitude ) const;
+
+  /** Return the combined value, using the weighting of GetValue(). */
+  MeasureType CombineMetricValues( const std::vector< MeasureType > & values ) const;
+
 };
 
 } // end namespace itk
@@ -671,6 +671,21 @@ template< class TFixedImage, class TMovingImage >
 double
 CombinationImageToImageMetric< TFixedImage, TMovingImage >
 ::GetFinalMetricWeight( unsigned int pos ) const
+{
+  return this->GetFinalMetricWeight( pos, this->m_MetricDerivativesMagnitude );
+
+} // end GetFinalMetricWeight()
+
+
+/**
+ * ******************* GetFinalMetricWeight *******************
+ */
+
+template< class TFixedImage, class TMovingImage >
+double
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetFinalMetricWeight( unsigned int pos,
+  const std::vector< double > & derivativesMagnitude ) const
 {
   double weight = 1.0;
   if( !this->m_UseRelativeWeights )
@@ -685,11 +700,11 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
      * defined by the fraction of the two relative weights.
      * Note that this weight is different in each iteration.
      */
-    if( this->m_MetricDerivativesMagnitude[ pos ] > 1e-10 )
+    if( derivativesMagnitude[ pos ] > 1e-10 )
     {
       weight = this->m_MetricRelativeWeights[ pos ]
-        * this->m_MetricDerivativesMagnitude[ 0 ]
-        / this->m_MetricDerivativesMagnitude[ pos ];
+        * derivativesMagnitude[ 0 ]
+        / derivativesMagnitude[ pos ];
     }
   }
 
@@ -723,13 +738,34 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
     /** store ... */
     this->m_MetricValues[ i ]          = tmpValue;
     this->m_MetricComputationTime[ i ] = timer.GetMean() * 1000.0;
+  }
 
-    /** and combine. */
+  /** and combine. */
+  measure = this->CombineMetricValues( this->m_MetricValues );
+
+  /** Return a value. */
+  return measure;
+
+} // end GetValue()
+
+
+/**
+ * ********************* CombineMetricValues ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename CombinationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::CombineMetricValues( const std::vector< MeasureType > & values ) const
+{
+  MeasureType measure = NumericTraits< MeasureType >::Zero;
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
     if( this->m_UseMetric[ i ] )
     {
       if( !this->m_UseRelativeWeights )
       {
-        measure += this->m_MetricWeights[ i ] * this->m_MetricValues[ i ];
+        measure += this->m_MetricWeights[ i ] * values[ i ];
       }
       else
       {
@@ -740,21 +776,20 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
          * Note that this weight is different in each iteration.
          */
         double weight = 1.0;
-        if( this->m_MetricValues[ i ] > 1e-10 )
+        if( values[ i ] > 1e-10 )
         {
           weight = this->m_MetricRelativeWeights[ i ]
-            * this->m_MetricValues[ 0 ]
-            / this->m_MetricValues[ i ];
-          measure += weight * this->m_MetricValues[ i ];
+            * values[ 0 ]
+            / values[ i ];
+          measure += weight * values[ i ];
         }
       }
     }
   }
 
-  /** Return a value. */
   return measure;
 
-} // end GetValue()
+} // end CombineMetricValues()
 
 
 /**
@@ -913,6 +948,160 @@ CombinationImageToImageMetric< TFixedImage, TMovingImage >
 } // end GetValueAndDerivative()
 
 
+/**
+ * ********************* GetSupportsReentrantEvaluation ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+bool
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetSupportsReentrantEvaluation( void ) const
+{
+  if( this->m_NumberOfMetrics == 0 )
+  {
+    return false;
+  }
+
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    const ImageMetricType * metric
+      = dynamic_cast< const ImageMetricType * >( this->m_Metrics[ i ].GetPointer() );
+    if( metric == nullptr || !metric->GetSupportsReentrantEvaluation() )
+    {
+      return false;
+    }
+  }
+
+  return true;
+
+} // end GetSupportsReentrantEvaluation()
+
+
+/**
+ * ********************* InitializeEvaluationContext ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::InitializeEvaluationContext( EvaluationContextType & context,
+  ThreadIdType numberOfWorkUnits ) const
+{
+  if( !this->GetSupportsReentrantEvaluation() )
+  {
+    Superclass::InitializeEvaluationContext( context, numberOfWorkUnits );
+    return;
+  }
+
+  /** The sub metrics each clone the transform into their own context. */
+  context.st_Transform                 = nullptr;
+  context.st_RecursiveBSplineTransform = nullptr;
+  context.st_Threader                  = nullptr;
+  context.st_WorkUnits.clear();
+  context.st_NumberOfPixelsCounted     = 0;
+  context.st_MetricContexts.resize( this->m_NumberOfMetrics );
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    const ImageMetricType * metric
+      = dynamic_cast< const ImageMetricType * >( this->m_Metrics[ i ].GetPointer() );
+    context.st_MetricContexts[ i ] = std::make_shared< EvaluationContextType >();
+    metric->InitializeEvaluationContext( *context.st_MetricContexts[ i ], numberOfWorkUnits );
+  }
+
+} // end InitializeEvaluationContext()
+
+
+/**
+ * ********************* GetValueInContext ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+typename CombinationImageToImageMetric< TFixedImage, TMovingImage >::MeasureType
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueInContext( const ParametersType & parameters,
+  EvaluationContextType & context ) const
+{
+  if( context.st_MetricContexts.empty() )
+  {
+    return Superclass::GetValueInContext( parameters, context );
+  }
+  if( context.st_MetricContexts.size() != this->m_NumberOfMetrics )
+  {
+    itkExceptionMacro( << "The evaluation context does not match the number of metrics. "
+                       << "Call InitializeEvaluationContext() again." );
+  }
+
+  /** Compute all metric values, in their own contexts. */
+  std::vector< MeasureType > values( this->m_NumberOfMetrics );
+  context.st_NumberOfPixelsCounted = 0;
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    const ImageMetricType * metric
+      = static_cast< const ImageMetricType * >( this->m_Metrics[ i ].GetPointer() );
+    values[ i ] = metric->GetValueInContext( parameters, *context.st_MetricContexts[ i ] );
+    context.st_NumberOfPixelsCounted += context.st_MetricContexts[ i ]->st_NumberOfPixelsCounted;
+  }
+
+  /** Combine them. */
+  return this->CombineMetricValues( values );
+
+} // end GetValueInContext()
+
+
+/**
+ * ********************* GetValueAndDerivativeInContext ****************************
+ */
+
+template< class TFixedImage, class TMovingImage >
+void
+CombinationImageToImageMetric< TFixedImage, TMovingImage >
+::GetValueAndDerivativeInContext( const ParametersType & parameters,
+  MeasureType & value, DerivativeType & derivative,
+  EvaluationContextType & context ) const
+{
+  if( context.st_MetricContexts.empty() )
+  {
+    Superclass::GetValueAndDerivativeInContext( parameters, value, derivative, context );
+    return;
+  }
+  if( context.st_MetricContexts.size() != this->m_NumberOfMetrics )
+  {
+    itkExceptionMacro( << "The evaluation context does not match the number of metrics. "
+                       << "Call InitializeEvaluationContext() again." );
+  }
+
+  /** Compute all metric values and derivatives, in their own contexts. */
+  std::vector< MeasureType >    values( this->m_NumberOfMetrics );
+  std::vector< DerivativeType > derivatives( this->m_NumberOfMetrics );
+  std::vector< double >         derivativesMagnitude( this->m_NumberOfMetrics );
+  context.st_NumberOfPixelsCounted = 0;
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    const ImageMetricType * metric
+      = static_cast< const ImageMetricType * >( this->m_Metrics[ i ].GetPointer() );
+    metric->GetValueAndDerivativeInContext( parameters,
+      values[ i ], derivatives[ i ], *context.st_MetricContexts[ i ] );
+    derivativesMagnitude[ i ] = derivatives[ i ].magnitude();
+    context.st_NumberOfPixelsCounted += context.st_MetricContexts[ i ]->st_NumberOfPixelsCounted;
+  }
+
+  /** Combine them, in the same way as GetValueAndDerivative(). */
+  value = NumericTraits< MeasureType >::Zero;
+  derivative.SetSize( this->GetNumberOfParameters() );
+  derivative.Fill( NumericTraits< DerivativeValueType >::ZeroValue() );
+  for( unsigned int i = 0; i < this->m_NumberOfMetrics; i++ )
+  {
+    if( this->m_UseMetric[ i ] )
+    {
+      const double weight = this->GetFinalMetricWeight( i, derivativesMagnitude );
+      value      += weight * values[ i ];
+      derivative += weight * derivatives[ i ];
+    }
+  }
+
+} // end GetValueAndDerivativeInContext()
+
+
 /**
  * ********************* GetSelfHessian ****************************
  */
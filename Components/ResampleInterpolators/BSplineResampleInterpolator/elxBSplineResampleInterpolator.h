@@ -19,7 +19,7 @@
 #define __elxBSplineResampleInterpolator_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
@@ -46,6 +46,9 @@ namespace elastix
  * If you are really in memory problems, you may use the LinearResampleInterpolator,
  * or the NearestNeighborResampleInterpolator.
  *
+ * The B-spline coefficients are computed multi-threadedly, and shared with the
+ * other B-spline interpolators of the same image, see itk::BSplineCoefficientImageCache.
+ *
  * \ingroup ResampleInterpolators
  * \sa BSplineResampleInterpolatorFloat
  */
@@ -53,7 +56,7 @@ namespace elastix
 template< class TElastix >
 class BSplineResampleInterpolator :
   public
-  itk::BSplineInterpolateImageFunction<
+  itk::CachedBSplineInterpolateImageFunction<
   typename ResampleInterpolatorBase< TElastix >::InputImageType,
   typename ResampleInterpolatorBase< TElastix >::CoordRepType,
   double >,   //CoefficientType
@@ -63,7 +66,7 @@ public:
 
   /** Standard ITK-stuff. */
   typedef BSplineResampleInterpolator Self;
-  typedef itk::BSplineInterpolateImageFunction<
+  typedef itk::CachedBSplineInterpolateImageFunction<
     typename ResampleInterpolatorBase< TElastix >::InputImageType,
     typename ResampleInterpolatorBase< TElastix >::CoordRepType,
     double >                                    Superclass1;
@@ -44,6 +44,13 @@ BSplineResampleInterpolator< TElastix >
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder( splineOrder );
 
+  /** Compute the coefficients with the number of threads of elastix. */
+  const std::string threads = this->m_Configuration->GetCommandLineArgument( "-threads" );
+  if( threads != "" )
+  {
+    this->SetNumberOfWorkUnits( atoi( threads.c_str() ) );
+  }
+
 } // end BeforeRegistration()
 
 
@@ -71,6 +78,13 @@ BSplineResampleInterpolator< TElastix >
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder( splineOrder );
 
+  /** Compute the coefficients with the number of threads of elastix. */
+  const std::string threads = this->m_Configuration->GetCommandLineArgument( "-threads" );
+  if( threads != "" )
+  {
+    this->SetNumberOfWorkUnits( atoi( threads.c_str() ) );
+  }
+
 } // end ReadFromFile()
 
 
@@ -19,7 +19,7 @@
 #define __elxBSplineResampleInterpolatorFloat_h
 
 #include "elxIncludes.h" // include first to avoid MSVS warning
-#include "itkBSplineInterpolateImageFunction.h"
+#include "itkCachedBSplineInterpolateImageFunction.h"
 
 namespace elastix
 {
@@ -53,7 +53,7 @@ namespace elastix
 template< class TElastix >
 class BSplineResampleInterpolatorFloat :
   public
-  itk::BSplineInterpolateImageFunction<
+  itk::CachedBSplineInterpolateImageFunction<
   typename ResampleInterpolatorBase< TElastix >::InputImageType,
   typename ResampleInterpolatorBase< TElastix >::CoordRepType,
   float >,   //CoefficientType
@@ -63,7 +63,7 @@ public:
 
   /** Standard ITK-stuff. */
   typedef BSplineResampleInterpolatorFloat Self;
-  typedef itk::BSplineInterpolateImageFunction<
+  typedef itk::CachedBSplineInterpolateImageFunction<
     typename ResampleInterpolatorBase< TElastix >::InputImageType,
     typename ResampleInterpolatorBase< TElastix >::CoordRepType,
     float >                                     Superclass1;
@@ -45,6 +45,13 @@ BSplineResampleInterpolatorFloat< TElastix >
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder( splineOrder );
 
+  /** Compute the coefficients with the number of threads of elastix. */
+  const std::string threads = this->m_Configuration->GetCommandLineArgument( "-threads" );
+  if( threads != "" )
+  {
+    this->SetNumberOfWorkUnits( atoi( threads.c_str() ) );
+  }
+
 } // end BeforeRegistration()
 
 
@@ -72,6 +79,13 @@ BSplineResampleInterpolatorFloat< TElastix >
   /** Set the splineOrder in the superclass. */
   this->SetSplineOrder( splineOrder );
 
+  /** Compute the coefficients with the number of threads of elastix. */
+  const std::string threads = this->m_Configuration->GetCommandLineArgument( "-threads" );
+  if( threads != "" )
+  {
+    this->SetNumberOfWorkUnits( atoi( threads.c_str() ) );
+  }
+
 } // end ReadFromFile()
 
 
@@ -70,6 +70,21 @@ namespace elastix
  * Default: 0.3. You cannot specify this parameter for each resolution differently.\n
  * Valid values are withing -1.0 and 0.5. 0.5 means incompressible.
  * Negative values are a bit odd, but possible. See Wikipedia on PoissonRatio.
+ * \parameter TPSMatrixInversionMethod: the method used to solve the landmark
+ * system, one of { SVD, QR, Iterative }. The Iterative method (MINRES) does not
+ * form the dense system matrix, and is meant for applying transforms with many
+ * landmarks. It does not support computation of the Jacobian, so it can not be
+ * used for optimization.\n
+ *   example: <tt>(TPSMatrixInversionMethod "Iterative")</tt>\n
+ * Default: SVD.
+ * \parameter TPSIterativeSolverTolerance: the relative residual at which the
+ * iterative solver stops.\n
+ *   example: <tt>(TPSIterativeSolverTolerance 1e-8)</tt>\n
+ * Default: 1e-10.
+ * \parameter TPSIterativeSolverMaximumNumberOfIterations: the maximum number
+ * of iterations of the iterative solver.\n
+ *   example: <tt>(TPSIterativeSolverMaximumNumberOfIterations 500)</tt>\n
+ * Default: 1000.
  *
  * \commandlinearg -fp: a file specifying a set of points that will serve
  * as fixed image landmarks.\n
@@ -104,6 +119,9 @@ namespace elastix
  *   example: <tt>(SplinePoissonRatio 0.3 )</tt>\n
  * Valid values are withing -1.0 and 0.5. 0.5 means incompressible.
  * Negative values are a bit odd, but possible. See Wikipedia on PoissonRatio.
+ * \transformparameter TPSMatrixInversionMethod: see above. Setting it to
+ * "Iterative" avoids the large matrix inversion when applying the transform.\n
+ *   example: <tt>(TPSMatrixInversionMethod "Iterative")</tt>
  * \transformparameter FixedImageLandmarks: The landmark positions in the
  * fixed image, in world coordinates. Positions written as x1 y1 [z1] x2 y2 [z2] etc.\n
  *   example: <tt>(FixedImageLandmarks 10.0 11.0 12.0 4.0 4.0 4.0 6.0 6.0 6.0 )</tt>
@@ -225,6 +243,11 @@ protected:
    */
   virtual bool SetKernelType( const std::string & kernelType );
 
+  /** Read the matrix inversion method and the settings of the
+   * iterative solver, and pass them to the kernel transform.
+   */
+  virtual void ReadMatrixInversionMethod( void );
+
   /** Read source landmarks from fp file
    * \li Try reading -fp file
    */
@@ -195,11 +195,8 @@ SplineKernelTransform< TElastix >
     this->m_KernelTransform->SetPoissonRatio( poissonRatio );
   }
 
-  /** Set the matrix inversion method (one of {SVD, QR}). */
-  std::string matrixInversionMethod = "SVD";
-  this->GetConfiguration()->ReadParameter(
-    matrixInversionMethod, "TPSMatrixInversionMethod", 0, true );
-  this->m_KernelTransform->SetMatrixInversionMethod( matrixInversionMethod );
+  /** Set the matrix inversion method (one of {SVD, QR, Iterative}). */
+  this->ReadMatrixInversionMethod();
 
   /** Load fixed image (source) landmark positions. */
   this->DetermineSourceLandmarks();
@@ -222,6 +219,37 @@ SplineKernelTransform< TElastix >
 } // end BeforeRegistration()
 
 
+/**
+ * ************************* ReadMatrixInversionMethod *********************
+ */
+
+template< class TElastix >
+void
+SplineKernelTransform< TElastix >
+::ReadMatrixInversionMethod( void )
+{
+  std::string matrixInversionMethod = "SVD";
+  this->GetConfiguration()->ReadParameter(
+    matrixInversionMethod, "TPSMatrixInversionMethod", 0, true );
+  this->m_KernelTransform->SetMatrixInversionMethod( matrixInversionMethod );
+
+  /** Settings for the iterative solver. */
+  if( matrixInversionMethod == "Iterative" )
+  {
+    double tolerance = 1e-10;
+    this->GetConfiguration()->ReadParameter(
+      tolerance, "TPSIterativeSolverTolerance", 0, true );
+    this->m_KernelTransform->SetIterativeSolverTolerance( tolerance );
+
+    unsigned int maximumNumberOfIterations = 1000;
+    this->GetConfiguration()->ReadParameter(
+      maximumNumberOfIterations, "TPSIterativeSolverMaximumNumberOfIterations", 0, true );
+    this->m_KernelTransform->SetIterativeSolverMaximumNumberOfIterations( maximumNumberOfIterations );
+  }
+
+} // end ReadMatrixInversionMethod()
+
+
 /**
  * ************************* DetermineSourceLandmarks *********************
  */
@@ -432,6 +460,11 @@ SplineKernelTransform< TElastix >
     poissonRatio, "SplinePoissonRatio", this->GetComponentLabel(), 0, -1 );
   this->m_KernelTransform->SetPoissonRatio( poissonRatio );
 
+  /** Set the matrix inversion method (one of {SVD, QR, Iterative}).
+   * This must be done before setting the source landmarks.
+   */
+  this->ReadMatrixInversionMethod();
+
   /** Read number of parameters. */
   unsigned int numberOfParameters = 0;
   this->GetConfiguration()->ReadParameter(
@@ -40,6 +40,7 @@ PURPOSE.  See the above copyright notices for more information.
 #include "itkMatrix.h"
 #include "itkPointSet.h"
 #include <deque>
+#include <vector>
 #include <math.h>
 #include "vnl/vnl_matrix_fixed.h"
 #include "vnl/vnl_matrix.h"
@@ -86,6 +87,11 @@ namespace itk
  * - Support for matrix inversion by QR decomposition, instead of SVD.
  *   QR is much faster. Used in SetParameters() and SetFixedParameters().
  * - Much faster Jacobian computation for some of the derived kernel transforms.
+ * - Support for an iterative (MINRES) solution of the L system, which never
+ *   forms L or its inverse. Used for large numbers of landmarks, where the
+ *   O(N^2) memory of SVD and QR is prohibitive. Note that every iteration
+ *   still evaluates all N^2 kernel pairs, so the time per iteration is
+ *   O(N^2); there is no fast summation of the kernel.
  *
  * \ingroup Transforms
  *
@@ -192,6 +198,13 @@ public:
   /** Compute the position of point in the new space */
   OutputPointType TransformPoint( const InputPointType & thisPoint ) const override;
 
+  /** Compute the position of many points in the new space. The points
+   * are distributed over the threads, when OpenMP is available.
+   */
+  virtual void TransformPoints(
+    const std::vector< InputPointType > & inputPoints,
+    std::vector< OutputPointType > & outputPoints ) const;
+
   /** These vector transforms are not implemented for this transform. */
   OutputVectorType TransformVector( const InputVectorType & ) const override
   {
@@ -261,10 +274,12 @@ public:
    */
   virtual void SetStiffness( double stiffness )
   {
-    this->m_Stiffness        = stiffness > 0 ? stiffness : 0.0;
-    this->m_LMatrixComputed  = false;
-    this->m_LInverseComputed = false;
-    this->m_WMatrixComputed  = false;
+    this->m_Stiffness                    = stiffness > 0 ? stiffness : 0.0;
+    this->m_LMatrixComputed              = false;
+    this->m_LInverseComputed             = false;
+    this->m_WMatrixComputed              = false;
+    this->m_LMatrixDecompositionComputed = false;
+    this->m_IterativeSolutionAvailable   = false;
   }
 
 
@@ -292,10 +307,37 @@ public:
   }
 
 
-  /** Matrix inversion by SVD or QR decomposition. */
-  itkSetMacro( MatrixInversionMethod, std::string );
+  /** Matrix inversion by SVD or QR decomposition, or by the iterative
+   * MINRES solver. The latter option ("Iterative") needs only O(N) memory,
+   * but does not support the computation of the Jacobian. Each of its
+   * iterations takes O(N^2) time, since the kernel is evaluated for all
+   * pairs of landmarks. The decomposition of one method is not reused
+   * by another, so changing the method invalidates it.
+   */
+  virtual void SetMatrixInversionMethod( const std::string & method )
+  {
+    if( this->m_MatrixInversionMethod != method )
+    {
+      this->m_MatrixInversionMethod        = method;
+      this->m_LMatrixDecompositionComputed = false;
+      this->Modified();
+    }
+  }
+
+
   itkGetConstReferenceMacro( MatrixInversionMethod, std::string );
 
+  /** Relative residual tolerance of the iterative solver; default 1e-10. */
+  itkSetMacro( IterativeSolverTolerance, double );
+  itkGetConstMacro( IterativeSolverTolerance, double );
+
+  /** Maximum number of iterations of the iterative solver; default 1000. */
+  itkSetMacro( IterativeSolverMaximumNumberOfIterations, unsigned int );
+  itkGetConstMacro( IterativeSolverMaximumNumberOfIterations, unsigned int );
+
+  /** Number of iterations performed during the last iterative solve. */
+  itkGetConstMacro( IterativeSolverNumberOfIterations, unsigned int );
+
   /** Must be provided. */
   void GetSpatialJacobian(
     const InputPointType & ipp, SpatialJacobianType & sj ) const override
@@ -386,6 +428,13 @@ public:
   /** Column matrix typedef. */
   typedef vnl_matrix_fixed< TScalarType, NDimensions, 1 > ColumnMatrixType;
 
+  /** Get the solution of the L system: the deformation coefficients D of
+   * the landmarks, and the affine part A and B. Valid after ComputeWMatrix().
+   */
+  itkGetConstReferenceMacro( DMatrix, DMatrixType );
+  itkGetConstReferenceMacro( AMatrix, AMatrixType );
+  itkGetConstReferenceMacro( BVector, BMatrixType );
+
   /** The list of source landmarks, denoted 'p'. */
   PointSetPointer m_SourceLandmarks;
 
@@ -441,6 +490,23 @@ protected:
    */
   void ReorganizeW( void );
 
+  /** Solve L W = Y with MINRES, without forming L. L is symmetric, but
+   * indefinite, so conjugate gradients can not be used. The previous
+   * solution, stored in D, A and B, is used as initial guess, which
+   * makes the repeated solves during a registration cheap.
+   */
+  void ComputeWMatrixIteratively( void );
+
+  /** Compute the product of L with a vector, evaluating the kernel on the fly.
+   * The landmarks and reflexive G matrices are passed in as random access
+   * containers, so that the rows can be distributed over the threads.
+   */
+  void ComputeLTimesVector(
+    const std::vector< InputPointType > & landmarks,
+    const std::vector< GMatrixType > & reflexiveG,
+    const vnl_vector< TScalarType > & x,
+    vnl_vector< TScalarType > & Lx ) const;
+
   /** Stiffness parameter. */
   double m_Stiffness;
 
@@ -495,6 +561,10 @@ protected:
   bool m_LInverseComputed;
   /** Has the L matrix decomposition been computed? */
   bool m_LMatrixDecompositionComputed;
+  /** Is there a solution of the iterative solver for the current L,
+   * to start the next iterative solve from?
+   */
+  bool m_IterativeSolutionAvailable;
 
   /** Decompositions, needed for the L matrix.
    * These decompositions are cached for performance reasons during registration.
@@ -529,9 +599,14 @@ private:
 
   TScalarType m_PoissonRatio;
 
-  /** Using SVD or QR decomposition. */
+  /** Using SVD or QR decomposition, or the iterative solver. */
   std::string m_MatrixInversionMethod;
 
+  /** Settings and statistics of the iterative solver. */
+  double       m_IterativeSolverTolerance;
+  unsigned int m_IterativeSolverMaximumNumberOfIterations;
+  unsigned int m_IterativeSolverNumberOfIterations;
+
 };
 
 } // end namespace itk
@@ -36,6 +36,10 @@ PURPOSE.  See the above copyright notices for more information.
 
 #include "itkKernelTransform2.h"
 
+#ifdef ELASTIX_USE_OPENMP
+#include <omp.h>
+#endif
+
 namespace itk
 {
 
@@ -61,6 +65,7 @@ KernelTransform2< TScalarType, NDimensions >
   this->m_LMatrixComputed              = false;
   this->m_LInverseComputed             = false;
   this->m_LMatrixDecompositionComputed = false;
+  this->m_IterativeSolutionAvailable   = false;
 
   this->m_LMatrixDecompositionSVD = nullptr;
   this->m_LMatrixDecompositionQR  = nullptr;
@@ -71,6 +76,10 @@ KernelTransform2< TScalarType, NDimensions >
   this->m_MatrixInversionMethod   = "SVD";
   this->m_FastComputationPossible = false;
 
+  this->m_IterativeSolverTolerance                 = 1e-10;
+  this->m_IterativeSolverMaximumNumberOfIterations = 1000;
+  this->m_IterativeSolverNumberOfIterations        = 0;
+
   this->m_HasNonZeroSpatialHessian           = true;
   this->m_HasNonZeroJacobianOfSpatialHessian = true;
 
@@ -112,6 +121,7 @@ KernelTransform2< TScalarType, NDimensions >
     this->m_LMatrixComputed              = false;
     this->m_LInverseComputed             = false;
     this->m_LMatrixDecompositionComputed = false;
+    this->m_IterativeSolutionAvailable   = false;
 
     // you must recompute L and Linv - this does not require the targ landmarks
     this->ComputeLInverse();
@@ -251,8 +261,8 @@ void
 KernelTransform2< TScalarType, NDimensions >
 ::ComputeWMatrix( void )
 {
-  /** Compute L and Y. */
-  if( !this->m_LMatrixComputed )
+  /** Compute L and Y. The iterative solver does not need L explicitly. */
+  if( !this->m_LMatrixComputed && this->m_MatrixInversionMethod != "Iterative" )
   {
     this->ComputeL();
   }
@@ -289,6 +299,10 @@ KernelTransform2< TScalarType, NDimensions >
 //     vnl_qr<TScalarType> qr( this->m_LMatrix );
 //     this->m_WMatrix = qr.solve( this->m_YMatrix );
   }
+  else if( this->m_MatrixInversionMethod == "Iterative" )
+  {
+    this->ComputeWMatrixIteratively();
+  }
   else
   {
     itkExceptionMacro( << "ERROR: invalid matrix inversion method ("
@@ -302,6 +316,220 @@ KernelTransform2< TScalarType, NDimensions >
 } // end ComputeWMatrix()
 
 
+/**
+ * ******************* ComputeWMatrixIteratively *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputeWMatrixIteratively( void )
+{
+  typedef vnl_vector< TScalarType > VnlVectorType;
+
+  const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
+  const unsigned long numberOfUnknowns  = NDimensions * ( numberOfLandmarks + NDimensions + 1 );
+
+  /** Copy the landmarks and their reflexive G's to random access containers. */
+  std::vector< InputPointType > landmarks( numberOfLandmarks );
+  std::vector< GMatrixType >    reflexiveG( numberOfLandmarks );
+  PointsIterator                sp = this->m_SourceLandmarks->GetPoints()->Begin();
+  for( unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd )
+  {
+    landmarks[ lnd ] = sp->Value();
+    this->ComputeReflexiveG( sp, reflexiveG[ lnd ] );
+    ++sp;
+  }
+
+  /** The initial guess is the previous solution, if still valid for this L. */
+  VnlVectorType x( numberOfUnknowns, 0.0 );
+  if( this->m_IterativeSolutionAvailable && this->m_DMatrix.cols() == numberOfLandmarks )
+  {
+    unsigned long ci = 0;
+    for( unsigned long lnd = 0; lnd < numberOfLandmarks; ++lnd )
+    {
+      for( unsigned int dim = 0; dim < NDimensions; ++dim )
+      {
+        x[ ci++ ] = this->m_DMatrix( dim, lnd );
+      }
+    }
+    for( unsigned int j = 0; j < NDimensions; ++j )
+    {
+      for( unsigned int i = 0; i < NDimensions; ++i )
+      {
+        x[ ci++ ] = this->m_AMatrix( i, j );
+      }
+    }
+    for( unsigned int k = 0; k < NDimensions; ++k )
+    {
+      x[ ci++ ] = this->m_BVector( k );
+    }
+  }
+
+  /** Initial residual r = y - L x. */
+  const VnlVectorType y = this->m_YMatrix.get_column( 0 );
+  VnlVectorType       Lv( numberOfUnknowns );
+  this->ComputeLTimesVector( landmarks, reflexiveG, x, Lv );
+  VnlVectorType r = y - Lv;
+
+  const TScalarType beta1     = r.two_norm();
+  const TScalarType threshold = this->m_IterativeSolverTolerance * y.two_norm();
+
+  /** MINRES, see Paige and Saunders, "Solution of sparse indefinite
+   * systems of linear equations", SIAM J. Numer. Anal. 12(4), 1975.
+   * The Lanczos vectors v are orthogonalized by the three-term recurrence;
+   * the tridiagonal matrix is QR-factorized by Givens rotations (c, s).
+   */
+  VnlVectorType v_prev( numberOfUnknowns, 0.0 );
+  VnlVectorType w_prev( numberOfUnknowns, 0.0 );
+  VnlVectorType w( numberOfUnknowns, 0.0 );
+  VnlVectorType v = r;
+  TScalarType   beta = 0.0; // coupling to v_prev, which is zero initially
+  TScalarType   eta  = beta1;
+  TScalarType   c_prev = 1.0, s_prev = 0.0, c = 1.0, s = 0.0;
+
+  unsigned int iteration = 0;
+  if( beta1 > threshold )
+  {
+    v /= beta1;
+    while( iteration < this->m_IterativeSolverMaximumNumberOfIterations )
+    {
+      ++iteration;
+
+      /** Lanczos step. */
+      this->ComputeLTimesVector( landmarks, reflexiveG, v, Lv );
+      const TScalarType alpha = dot_product( v, Lv );
+      Lv -= alpha * v;
+      Lv -= beta * v_prev;
+      const TScalarType beta_next = Lv.two_norm();
+
+      /** Apply the two previous rotations to the new column of T. */
+      const TScalarType epsilon   = s_prev * beta;
+      const TScalarType delta_bar = c_prev * beta;
+      const TScalarType delta     = c * delta_bar + s * alpha;
+      const TScalarType gamma_bar = -s * delta_bar + c * alpha;
+      const TScalarType gamma     = std::sqrt( gamma_bar * gamma_bar + beta_next * beta_next );
+      if( gamma == NumericTraits< TScalarType >::ZeroValue() )
+      {
+        break;
+      }
+
+      /** New rotation, search direction and solution update. */
+      const TScalarType c_next = gamma_bar / gamma;
+      const TScalarType s_next = beta_next / gamma;
+      VnlVectorType w_next = ( v - delta * w - epsilon * w_prev ) / gamma;
+      x   += ( c_next * eta ) * w_next;
+      eta  = -s_next * eta;
+
+      if( std::abs( eta ) <= threshold || beta_next == NumericTraits< TScalarType >::ZeroValue() )
+      {
+        break;
+      }
+
+      /** Shift. */
+      v_prev = v;
+      v      = Lv / beta_next;
+      beta   = beta_next;
+      w_prev = w;
+      w      = w_next;
+      c_prev = c; s_prev = s;
+      c      = c_next; s = s_next;
+    }
+  }
+
+  this->m_IterativeSolverNumberOfIterations = iteration;
+  itkDebugMacro( << "MINRES finished after " << iteration
+                 << " iterations, with residual norm " << std::abs( eta ) );
+
+  this->m_WMatrix.set_size( numberOfUnknowns, 1 );
+  this->m_WMatrix.set_column( 0, x );
+
+  /** The solution can serve as initial guess for the next solve. */
+  this->m_IterativeSolutionAvailable = true;
+
+} // end ComputeWMatrixIteratively()
+
+
+/**
+ * ******************* ComputeLTimesVector *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::ComputeLTimesVector(
+  const std::vector< InputPointType > & landmarks,
+  const std::vector< GMatrixType > & reflexiveG,
+  const vnl_vector< TScalarType > & x,
+  vnl_vector< TScalarType > & Lx ) const
+{
+  /** L = [ K P; P^T 0 ], with K the kernel matrix and P the affine part,
+   * see ComputeK() and ComputeP() for the layout.
+   */
+  const int           numberOfLandmarks = static_cast< int >( landmarks.size() );
+  const unsigned long affineOffset      = NDimensions * numberOfLandmarks;
+
+  Lx.set_size( x.size() );
+
+  /** Rows of K x + P z; each thread computes a set of landmark rows. */
+#ifdef ELASTIX_USE_OPENMP
+  #pragma omp parallel for
+#endif
+  for( int i = 0; i < numberOfLandmarks; ++i )
+  {
+    GMatrixType                                  G;
+    vnl_vector_fixed< TScalarType, NDimensions > row( 0.0 );
+    for( int j = 0; j < numberOfLandmarks; ++j )
+    {
+      if( i == j )
+      {
+        G = reflexiveG[ i ];
+      }
+      else
+      {
+        this->ComputeG( landmarks[ i ] - landmarks[ j ], G );
+      }
+      for( unsigned int a = 0; a < NDimensions; ++a )
+      {
+        for( unsigned int b = 0; b < NDimensions; ++b )
+        {
+          row[ a ] += G( a, b ) * x[ j * NDimensions + b ];
+        }
+      }
+    }
+
+    for( unsigned int a = 0; a < NDimensions; ++a )
+    {
+      for( unsigned int j = 0; j < NDimensions; ++j )
+      {
+        row[ a ] += landmarks[ i ][ j ] * x[ affineOffset + j * NDimensions + a ];
+      }
+      row[ a ] += x[ affineOffset + NDimensions * NDimensions + a ];
+      Lx[ i * NDimensions + a ] = row[ a ];
+    }
+  }
+
+  /** Rows of P^T x. */
+  for( unsigned int k = 0; k < NDimensions * ( NDimensions + 1 ); ++k )
+  {
+    Lx[ affineOffset + k ] = 0.0;
+  }
+  for( int i = 0; i < numberOfLandmarks; ++i )
+  {
+    for( unsigned int a = 0; a < NDimensions; ++a )
+    {
+      const TScalarType xia = x[ i * NDimensions + a ];
+      for( unsigned int j = 0; j < NDimensions; ++j )
+      {
+        Lx[ affineOffset + j * NDimensions + a ] += landmarks[ i ][ j ] * xia;
+      }
+      Lx[ affineOffset + NDimensions * NDimensions + a ] += xia;
+    }
+  }
+
+} // end ComputeLTimesVector()
+
+
 /**
  * ******************* ComputeLInverse *******************
  */
@@ -311,7 +539,7 @@ void
 KernelTransform2< TScalarType, NDimensions >
 ::ComputeLInverse( void )
 {
-  if( !this->m_LMatrixComputed )
+  if( !this->m_LMatrixComputed && this->m_MatrixInversionMethod != "Iterative" )
   {
     this->ComputeL();
   }
@@ -327,6 +555,12 @@ KernelTransform2< TScalarType, NDimensions >
     this->m_LMatrixInverse   = vnl_qr< TScalarType >( this->m_LMatrix ).inverse();
     this->m_LInverseComputed = true;
   }
+  else if( this->m_MatrixInversionMethod == "Iterative" )
+  {
+    /** The iterative solver never forms L, let alone its inverse. */
+    this->m_LMatrixInverse.set_size( 0, 0 );
+    this->m_LInverseComputed = false;
+  }
   else
   {
     itkExceptionMacro( << "ERROR: invalid matrix inversion method ("
@@ -562,6 +796,34 @@ KernelTransform2< TScalarType, NDimensions >
 } // end TransformPoint()
 
 
+/**
+ * ******************* TransformPoints *******************
+ */
+
+template< class TScalarType, unsigned int NDimensions >
+void
+KernelTransform2< TScalarType, NDimensions >
+::TransformPoints(
+  const std::vector< InputPointType > & inputPoints,
+  std::vector< OutputPointType > & outputPoints ) const
+{
+  const int numberOfPoints = static_cast< int >( inputPoints.size() );
+  outputPoints.resize( numberOfPoints );
+
+  /** TransformPoint() is thread-safe, and every point costs a loop over all
+   * landmarks, so distributing the points over the threads scales well.
+   */
+#ifdef ELASTIX_USE_OPENMP
+  #pragma omp parallel for schedule( static )
+#endif
+  for( int i = 0; i < numberOfPoints; ++i )
+  {
+    outputPoints[ i ] = this->TransformPoint( inputPoints[ i ] );
+  }
+
+} // end TransformPoints()
+
+
 /**
  * ******************* SetIdentity *******************
  *
@@ -667,6 +929,7 @@ KernelTransform2< TScalarType, NDimensions >
   this->m_LMatrixComputed              = false;
   this->m_LInverseComputed             = false;
   this->m_LMatrixDecompositionComputed = false;
+  this->m_IterativeSolutionAvailable   = false;
 
   // you must recompute L and Linv - this does not require the targ lms
   this->ComputeLInverse();
@@ -756,6 +1019,13 @@ KernelTransform2< TScalarType, NDimensions >
 ::GetJacobian( const InputPointType & p, JacobianType & jac,
   NonZeroJacobianIndicesType & nonZeroJacobianIndices ) const
 {
+  if( this->m_MatrixInversionMethod == "Iterative" )
+  {
+    itkExceptionMacro( << "GetJacobian() requires the inverse of the L matrix, "
+                       << "which is not computed by the Iterative matrix inversion method. "
+                       << "Use SVD or QR instead." );
+  }
+
   const unsigned long numberOfLandmarks = this->m_SourceLandmarks->GetNumberOfPoints();
   jac.SetSize( NDimensions, numberOfLandmarks * NDimensions );
   jac.Fill( 0.0 );
@@ -925,6 +1195,12 @@ KernelTransform2< TScalarType, NDimensions >
      << this->m_PoissonRatio << std::endl;
   os << indent << "MatrixInversionMethod: "
      << this->m_MatrixInversionMethod << std::endl;
+  os << indent << "IterativeSolverTolerance: "
+     << this->m_IterativeSolverTolerance << std::endl;
+  os << indent << "IterativeSolverMaximumNumberOfIterations: "
+     << this->m_IterativeSolverMaximumNumberOfIterations << std::endl;
+  os << indent << "IterativeSolverNumberOfIterations: "
+     << this->m_IterativeSolverNumberOfIterations << std::endl;
 
   /** Just print the sizes of these matrices, not their contents. */
   os << indent << "LMatrix: " << this->m_LMatrix.rows()
@@ -952,6 +1228,8 @@ KernelTransform2< TScalarType, NDimensions >
      << this->m_LInverseComputed << std::endl;
   os << indent << "LMatrixDecompositionComputed: "
      << this->m_LMatrixDecompositionComputed << std::endl;
+  os << indent << "IterativeSolutionAvailable: "
+     << this->m_IterativeSolutionAvailable << std::endl;
 
 } // end PrintSelf()
 
@@ -63,6 +63,14 @@ namespace elastix
  *    CheckNumberOfSamples. \n
  *    example: <tt>(RequiredRatioOfValidSamples 0.1)</tt> \n
  *    The default is 0.25.
+ * \parameter PrecomputeMovingImageGradient: Whether the gradient image of the
+ *    moving image is computed before each resolution, when the interpolator does
+ *    not provide a derivative (e.g. the NearestNeighborInterpolator). If false,
+ *    the gradient is computed in each sample, which saves the memory of the
+ *    gradient image at the cost of some computation time. Can be given for
+ *    each resolution or for all resolutions at once. \n
+ *    example: <tt>(PrecomputeMovingImageGradient "false")</tt> \n
+ *    The default is true.
  *
  * \ingroup Metrics
  * \ingroup ComponentBaseClasses
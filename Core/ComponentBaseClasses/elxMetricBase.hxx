@@ -129,6 +129,14 @@ MetricBase< TElastix >
       thisAsAdvanced->SetRequiredRatioOfValidSamples( ratio );
     }
 
+    /** Should the moving image gradient be precomputed, for interpolators
+     * that do not provide a derivative?
+     */
+    bool precomputeGradient = true;
+    this->GetConfiguration()->ReadParameter( precomputeGradient,
+      "PrecomputeMovingImageGradient", this->GetComponentLabel(), level, 0 );
+    thisAsAdvanced->SetPrecomputeMovingImageGradient( precomputeGradient );
+
     /** Set moving image derivative scales. */
     std::size_t usescales = this->GetConfiguration()
       ->CountNumberOfParameterEntries( "MovingImageDerivativeScales" );
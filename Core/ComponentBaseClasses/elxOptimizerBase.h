@@ -24,6 +24,8 @@
 
 #include "elxBaseComponentSE.h"
 #include "itkOptimizer.h"
+#include "itkSingleValuedCostFunction.h"
+#include <vector>
 
 namespace elastix
 {
@@ -123,6 +125,17 @@ protected:
   /** Check whether the user asked to select new samples every iteration. */
   virtual bool GetNewSamplesEveryIteration( void ) const;
 
+  /** Typedef for a set of cost functions that may be evaluated concurrently. */
+  typedef std::vector< itk::SingleValuedCostFunction::Pointer > ReentrantCostFunctionContainerType;
+
+  /** Create one cost function per thread, each with its own evaluation
+   * context of the metric, see AdvancedImageToImageMetric::GetValueInContext().
+   * Returns false, and leaves the container empty, when the metric does not
+   * support re-entrant evaluation. Call after the metric is initialized.
+   */
+  virtual bool CreateReentrantCostFunctions(
+    ReentrantCostFunctionContainerType & costFunctions ) const;
+
 private:
 
   /** The private constructor. */
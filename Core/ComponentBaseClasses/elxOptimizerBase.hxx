@@ -21,6 +21,8 @@
 #include "elxOptimizerBase.h"
 
 #include "itkSingleValuedNonLinearOptimizer.h"
+#include "itkAdvancedImageToImageMetric.h"
+#include "itkEvaluationContextCostFunction.h"
 #include "itk_zlib.h"
 
 namespace elastix
@@ -151,6 +153,54 @@ OptimizerBase< TElastix >
 } // end GetNewSamplesEveryIteration()
 
 
+/**
+ * ****************** CreateReentrantCostFunctions ********************
+ */
+
+template< class TElastix >
+bool
+OptimizerBase< TElastix >
+::CreateReentrantCostFunctions( ReentrantCostFunctionContainerType & costFunctions ) const
+{
+  typedef typename RegistrationType::FixedImageType  FixedImageType;
+  typedef typename RegistrationType::MovingImageType MovingImageType;
+  typedef itk::AdvancedImageToImageMetric<
+    FixedImageType, MovingImageType >                AdvancedMetricType;
+  typedef itk::EvaluationContextCostFunction<
+    AdvancedMetricType >                             EvaluationContextCostFunctionType;
+
+  costFunctions.clear();
+
+  /** Only the advanced metrics may be evaluated in a context. */
+  const itk::SingleValuedNonLinearOptimizer * optimizer
+    = dynamic_cast< const itk::SingleValuedNonLinearOptimizer * >( this->GetAsITKBaseType() );
+  if( optimizer == nullptr )
+  {
+    return false;
+  }
+  const AdvancedMetricType * metric
+    = dynamic_cast< const AdvancedMetricType * >( optimizer->GetCostFunction() );
+  if( metric == nullptr || !metric->GetSupportsReentrantEvaluation() )
+  {
+    return false;
+  }
+
+  /** One cost function, with its own evaluation context, per thread. */
+  const unsigned int numberOfThreads
+    = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  for( unsigned int i = 0; i < numberOfThreads; ++i )
+  {
+    typename EvaluationContextCostFunctionType::Pointer costFunction
+      = EvaluationContextCostFunctionType::New();
+    costFunction->SetMetric( metric );
+    costFunctions.push_back( costFunction.GetPointer() );
+  }
+
+  return true;
+
+} // end CreateReentrantCostFunctions()
+
+
 /**
  * ****************** SetSinusScales ********************
  */
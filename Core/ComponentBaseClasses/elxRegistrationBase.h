@@ -26,8 +26,11 @@
 
 /** Mask support. */
 #include "itkImageMaskSpatialObject.h"
+#include "itkBitPackedImageMaskSpatialObject.h"
 #include "itkErodeMaskImageFilter.h"
 
+#include <map>
+
 namespace elastix
 {
 
@@ -168,6 +171,10 @@ protected:
     FixedMaskSpatialObjectType::Pointer FixedMaskSpatialObjectPointer;
   typedef typename
     MovingMaskSpatialObjectType::Pointer MovingMaskSpatialObjectPointer;
+  typedef itk::BitPackedImageMaskSpatialObject<
+    itkGetStaticConstMacro( FixedImageDimension ) >          FixedBitPackedMaskSpatialObjectType;
+  typedef itk::BitPackedImageMaskSpatialObject<
+    itkGetStaticConstMacro( MovingImageDimension ) >         MovingBitPackedMaskSpatialObjectType;
 
   typedef typename ITKBaseType::FixedImagePyramidType  FixedImagePyramidType;
   typedef typename ITKBaseType::MovingImagePyramidType MovingImagePyramidType;
@@ -188,6 +195,10 @@ protected:
    * Output:
    * \li the mask as a spatial object, which can be set in a metric for example
    *
+   * An eroded mask is a BitPackedImageMaskSpatialObject, which also keeps the
+   * bit-packed mask of the level, for the lookup of the samplers and metrics.
+   * Every level gets its own mask image.
+   *
    * This function is used by the registration components
    */
   FixedMaskSpatialObjectPointer GenerateFixedMaskSpatialObject(
@@ -204,6 +215,8 @@ protected:
    * Output:
    * \li the mask as a spatial object, which can be set in a metric for example
    *
+   * As for the fixed mask, an eroded mask is a BitPackedImageMaskSpatialObject.
+   *
    * This function is used by the registration components
    */
   MovingMaskSpatialObjectPointer GenerateMovingMaskSpatialObject(
@@ -217,6 +230,16 @@ private:
   /** The private copy constructor. */
   void operator=( const Self & );     // purposely not implemented
 
+  /** One erosion filter per mask image, reused for all resolution levels.
+   * The filter erodes the mask for all levels at once, so that the later
+   * levels only need to unpack the stored result. The output of a level is
+   * taken over by its spatial object, so the filter never keeps it.
+   */
+  typedef std::map< const FixedMaskImageType *, FixedMaskErodeFilterPointer >   FixedMaskErodeFilterMapType;
+  typedef std::map< const MovingMaskImageType *, MovingMaskErodeFilterPointer > MovingMaskErodeFilterMapType;
+  mutable FixedMaskErodeFilterMapType  m_FixedMaskErodeFilters;
+  mutable MovingMaskErodeFilterMapType m_MovingMaskErodeFilters;
+
 };
 
 } // end namespace elastix
@@ -109,30 +109,38 @@ RegistrationBase< TElastix >
   {
     return fixedMaskSpatialObject;
   }
-  fixedMaskSpatialObject = FixedMaskSpatialObjectType::New();
 
   /** Just convert to spatial object if no erosion is needed. */
   if( !useMaskErosion || !pyramid )
   {
+    fixedMaskSpatialObject = FixedMaskSpatialObjectType::New();
     fixedMaskSpatialObject->SetImage( maskImage );
     fixedMaskSpatialObject->Update();
     return fixedMaskSpatialObject;
   }
 
-  /** Erode, and convert to spatial object. */
-  FixedMaskErodeFilterPointer erosion = FixedMaskErodeFilterType::New();
-  erosion->SetInput( maskImage );
+  /** Erode, and convert to spatial object. The filter of this mask is
+   * reused, so the erosion is only computed once for all levels.
+   */
+  FixedMaskErodeFilterPointer & erosion = this->m_FixedMaskErodeFilters[ maskImage ];
+  if( erosion.IsNull() )
+  {
+    erosion = FixedMaskErodeFilterType::New();
+    erosion->SetInput( maskImage );
+    erosion->SetIsMovingMask( false );
+  }
   erosion->SetSchedule( pyramid->GetSchedule() );
-  erosion->SetIsMovingMask( false );
   erosion->SetResolutionLevel( level );
 
-  /** Set output of the erosion to fixedImageMaskAsImage. */
-  FixedMaskImagePointer erodedFixedMaskAsImage = erosion->GetOutput();
+  /** The filter does not keep the output of a previous call, see below, so
+   * it must always unpack the mask again.
+   */
+  erosion->Modified();
 
   /** Do the erosion. */
   try
   {
-    erodedFixedMaskAsImage->Update();
+    erosion->Update();
   }
   catch( itk::ExceptionObject & excp )
   {
@@ -145,11 +153,24 @@ RegistrationBase< TElastix >
     throw excp;
   }
 
-  /** Release some memory. */
-  erodedFixedMaskAsImage->DisconnectPipeline();
+  /** Take the output over in an image of this level, and release the buffer
+   * of the filter. Otherwise the next level would be unpacked into the same
+   * buffer, and overwrite the mask of this level while it is still in use.
+   */
+  FixedMaskImagePointer erodedFixedMaskAsImage = FixedMaskImageType::New();
+  erodedFixedMaskAsImage->Graft( erosion->GetOutput() );
+  erosion->GetOutput()->ReleaseData();
 
-  fixedMaskSpatialObject->SetImage( erodedFixedMaskAsImage );
-  fixedMaskSpatialObject->Update();
+  /** The spatial object also keeps the bit mask of this level, which the
+   * mask lookup of the samplers and the metrics reads.
+   */
+  typename FixedBitPackedMaskSpatialObjectType::Pointer bitPackedMaskSpatialObject
+    = FixedBitPackedMaskSpatialObjectType::New();
+  bitPackedMaskSpatialObject->SetImage( erodedFixedMaskAsImage );
+  bitPackedMaskSpatialObject->SetBitMask( erosion->GetBitMask( level ),
+    erosion->GetNumberOfWordsPerLine() );
+  bitPackedMaskSpatialObject->Update();
+  fixedMaskSpatialObject = bitPackedMaskSpatialObject.GetPointer();
   return fixedMaskSpatialObject;
 
 } // end GenerateFixedMaskSpatialObject()
@@ -171,30 +192,38 @@ RegistrationBase< TElastix >
   {
     return movingMaskSpatialObject;
   }
-  movingMaskSpatialObject = MovingMaskSpatialObjectType::New();
 
   /** Just convert to spatial object if no erosion is needed. */
   if( !useMaskErosion || !pyramid )
   {
+    movingMaskSpatialObject = MovingMaskSpatialObjectType::New();
     movingMaskSpatialObject->SetImage( maskImage );
     movingMaskSpatialObject->Update();
     return movingMaskSpatialObject;
   }
 
-  /** Erode, and convert to spatial object. */
-  MovingMaskErodeFilterPointer erosion = MovingMaskErodeFilterType::New();
-  erosion->SetInput( maskImage );
+  /** Erode, and convert to spatial object. The filter of this mask is
+   * reused, so the erosion is only computed once for all levels.
+   */
+  MovingMaskErodeFilterPointer & erosion = this->m_MovingMaskErodeFilters[ maskImage ];
+  if( erosion.IsNull() )
+  {
+    erosion = MovingMaskErodeFilterType::New();
+    erosion->SetInput( maskImage );
+    erosion->SetIsMovingMask( true );
+  }
   erosion->SetSchedule( pyramid->GetSchedule() );
-  erosion->SetIsMovingMask( true );
   erosion->SetResolutionLevel( level );
 
-  /** Set output of the erosion to movingImageMaskAsImage. */
-  MovingMaskImagePointer erodedMovingMaskAsImage = erosion->GetOutput();
+  /** The filter does not keep the output of a previous call, see below, so
+   * it must always unpack the mask again.
+   */
+  erosion->Modified();
 
   /** Do the erosion. */
   try
   {
-    erodedMovingMaskAsImage->Update();
+    erosion->Update();
   }
   catch( itk::ExceptionObject & excp )
   {
@@ -207,11 +236,24 @@ RegistrationBase< TElastix >
     throw excp;
   }
 
-  /** Release some memory */
-  erodedMovingMaskAsImage->DisconnectPipeline();
+  /** Take the output over in an image of this level, and release the buffer
+   * of the filter. Otherwise the next level would be unpacked into the same
+   * buffer, and overwrite the mask of this level while it is still in use.
+   */
+  MovingMaskImagePointer erodedMovingMaskAsImage = MovingMaskImageType::New();
+  erodedMovingMaskAsImage->Graft( erosion->GetOutput() );
+  erosion->GetOutput()->ReleaseData();
 
-  movingMaskSpatialObject->SetImage( erodedMovingMaskAsImage );
-  movingMaskSpatialObject->Update();
+  /** The spatial object also keeps the bit mask of this level, which the
+   * mask lookup of the samplers and the metrics reads.
+   */
+  typename MovingBitPackedMaskSpatialObjectType::Pointer bitPackedMaskSpatialObject
+    = MovingBitPackedMaskSpatialObjectType::New();
+  bitPackedMaskSpatialObject->SetImage( erodedMovingMaskAsImage );
+  bitPackedMaskSpatialObject->SetBitMask( erosion->GetBitMask( level ),
+    erosion->GetNumberOfWordsPerLine() );
+  bitPackedMaskSpatialObject->Update();
+  movingMaskSpatialObject = bitPackedMaskSpatialObject.GetPointer();
   return movingMaskSpatialObject;
 
 } // end GenerateMovingMaskSpatialObject()
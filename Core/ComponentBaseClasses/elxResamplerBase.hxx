@@ -24,6 +24,7 @@
 #include "itkChangeInformationImageFilter.h"
 #include "itkAdvancedRayCastInterpolateImageFunction.h"
 #include "itkTimeProbe.h"
+#include "itkHotPathProfiler.h"
 
 namespace elastix
 {
@@ -340,6 +341,7 @@ ResamplerBase< TElastix >
   /** Do the resampling. */
   try
   {
+    itkHotPathScopedTimerMacro( "Resampler::Update" );
     this->GetAsITKBaseType()->Update();
   }
   catch( itk::ExceptionObject & excp )
@@ -476,6 +478,7 @@ ResamplerBase< TElastix >
   /** Do the resampling. */
   try
   {
+    itkHotPathScopedTimerMacro( "Resampler::Update" );
     this->GetAsITKBaseType()->Update();
   }
   catch( itk::ExceptionObject & excp )
@@ -55,6 +55,28 @@ namespace elastix
  *   "Compose" by composition: \f$T(x) = T_1 ( T_0(x) )\f$.\n
  *   example: <tt>(HowToCombineTransforms "Add")</tt>\n
  *   Default: "Add".
+ * \parameter CacheInitialTransform: Whether to replace a non-linear initial transform,
+ *   that is composed with this transform, by a displacement field on the grid of the
+ *   fixed image of the current resolution. This saves time when the initial transform
+ *   consists of one or more B-spline transforms, at the cost of memory and some accuracy,
+ *   since the displacement field is linearly interpolated. The final result is always
+ *   computed with the exact initial transform.\n
+ *   example: <tt>(CacheInitialTransform "true" "true" "false")</tt>\n
+ *   The default is "false" for each resolution.
+ * \parameter InitialTransformCacheSpacingInVoxels: The spacing of the displacement field
+ *   of CacheInitialTransform, in voxels of the fixed image of the current resolution.\n
+ *   example: <tt>(InitialTransformCacheSpacingInVoxels 2 1 1)</tt>\n
+ *   The default is 1 for each resolution.
+ * \parameter InitialTransformCacheMaximumMemory: The maximum size of the displacement field
+ *   of CacheInitialTransform, in megabytes. If the field would be larger, its spacing is increased.\n
+ *   example: <tt>(InitialTransformCacheMaximumMemory 256)</tt>\n
+ *   The default is 512 for each resolution.
+ * \parameter InitialTransformCacheMaximumError: The maximum allowed distance, in physical units,
+ *   between the cached and the exact initial transform, measured in 1000 random points.
+ *   If the error is larger, the initial transform is not cached in that resolution.
+ *   A negative value disables this check.\n
+ *   example: <tt>(InitialTransformCacheMaximumError 0.05)</tt>\n
+ *   The default is 0.01 for each resolution.
  *
  * \transformparameter UseDirectionCosines: Controls whether to use or ignore the
  * direction cosines (world matrix, transform matrix) set in the images.
@@ -246,7 +268,13 @@ public:
    */
   void BeforeRegistrationBase( void ) override;
 
+  /** Execute stuff before each resolution:
+   * \li Cache the initial transform in a displacement field, if desired.
+   */
+  void BeforeEachResolutionBase( void ) override;
+
   /** Execute stuff after the registration:
+   * \li Remove the cache of the initial transform.
    * \li Get and set the final parameters for the resampler.
    */
   void AfterRegistrationBase( void ) override;
@@ -37,7 +37,10 @@
 #include "itkMeshFileWriter.h"
 #include "itkTransformMeshFilter.h"
 #include "itkCommonEnums.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip> // For setprecision.
 
@@ -265,6 +268,12 @@ TransformBase< TElastix >
     }
   }
 
+  /** The initial transform is fixed from now on, so flatten it. */
+  if( thisAsGrouper )
+  {
+    thisAsGrouper->UpdateFlattenedInitialTransform();
+  }
+
 } // end BeforeRegistrationBase()
 
 
@@ -337,6 +346,149 @@ TransformBase< TElastix >
 } // end SetFinalParameters()
 
 
+/**
+ * ******************* BeforeEachResolutionBase *******************
+ */
+
+template< class TElastix >
+void
+TransformBase< TElastix >
+::BeforeEachResolutionBase( void )
+{
+  /** Remove the cache of the previous resolution. */
+  CombinationTransformType * thisAsGrouper = this->GetAsCombinationTransform();
+  if( !thisAsGrouper )
+  {
+    return;
+  }
+  thisAsGrouper->SetInitialTransformDisplacementField( nullptr );
+
+  /** Check if the initial transform should be cached in this resolution. */
+  const unsigned int level
+    = this->m_Registration->GetAsITKBaseType()->GetCurrentLevel();
+  bool cacheInitialTransform = false;
+  this->m_Configuration->ReadParameter( cacheInitialTransform,
+    "CacheInitialTransform", this->GetComponentLabel(), level, 0 );
+  const InitialTransformType * initialTransform = thisAsGrouper->GetInitialTransform();
+  if( !cacheInitialTransform || !initialTransform || !thisAsGrouper->GetUseComposition() )
+  {
+    return;
+  }
+  if( initialTransform->IsLinear() )
+  {
+    elxout << "  The initial transform is linear, so it is not cached." << std::endl;
+    return;
+  }
+
+  /** Read the settings of the cache. */
+  unsigned int spacingInVoxels = 1;
+  this->m_Configuration->ReadParameter( spacingInVoxels,
+    "InitialTransformCacheSpacingInVoxels", this->GetComponentLabel(), level, 0 );
+  double maximumMemory = 512.0;
+  this->m_Configuration->ReadParameter( maximumMemory,
+    "InitialTransformCacheMaximumMemory", this->GetComponentLabel(), level, 0 );
+  double maximumError = 0.01;
+  this->m_Configuration->ReadParameter( maximumError,
+    "InitialTransformCacheMaximumError", this->GetComponentLabel(), level, 0 );
+
+  /** Typedefs. */
+  typedef typename CombinationTransformType::InitialTransformDisplacementFieldType DisplacementFieldType;
+  typedef typename CombinationTransformType::InitialTransformDisplacementFieldInterpolatorType
+    DisplacementFieldInterpolatorType;
+  typedef itk::TransformToDisplacementFieldFilter<
+    DisplacementFieldType, CoordRepType >             DisplacementFieldGeneratorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+  /** The displacement field covers the fixed image of this resolution,
+   * with a spacing of a whole number of voxels. The spacing is increased
+   * until the field fits in the maximum memory.
+   */
+  const auto fixedPyramid = this->m_Elastix->GetElxFixedImagePyramidBase()->GetAsITKBaseType();
+  fixedPyramid->UpdateOutputInformation();
+  const FixedImageType * fixedImage = fixedPyramid->GetOutput( level );
+  const typename FixedImageType::RegionType fixedRegion = fixedImage->GetLargestPossibleRegion();
+
+  typename DisplacementFieldType::SizeType size;
+  double       numberOfMegaBytes = 0.0;
+  unsigned int step = std::max( spacingInVoxels, 1u );
+  for(; ; ++step )
+  {
+    numberOfMegaBytes = sizeof( typename DisplacementFieldType::PixelType ) / ( 1024.0 * 1024.0 );
+    bool isSingleNode = true;
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      size[ i ] = ( fixedRegion.GetSize()[ i ] + step - 2 ) / step + 1;
+      numberOfMegaBytes *= size[ i ];
+      isSingleNode &= ( size[ i ] == 1 );
+    }
+    if( numberOfMegaBytes <= maximumMemory || isSingleNode )
+    {
+      break;
+    }
+  }
+
+  typename DisplacementFieldType::SpacingType spacing;
+  for( unsigned int i = 0; i < FixedImageDimension; ++i )
+  {
+    spacing[ i ] = fixedImage->GetSpacing()[ i ] * step;
+  }
+  typename DisplacementFieldType::PointType origin;
+  fixedImage->TransformIndexToPhysicalPoint( fixedRegion.GetIndex(), origin );
+
+  /** Compute the displacement field of the initial transform. */
+  const auto generator = DisplacementFieldGeneratorType::New();
+  generator->SetSize( size );
+  generator->SetOutputSpacing( spacing );
+  generator->SetOutputOrigin( origin );
+  generator->SetOutputDirection( fixedImage->GetDirection() );
+  generator->SetTransform( initialTransform );
+  generator->Update();
+  typename DisplacementFieldType::Pointer displacementField = generator->GetOutput();
+
+  /** Measure the error of the cache in random points. */
+  const auto interpolator = DisplacementFieldInterpolatorType::New();
+  interpolator->SetInputImage( displacementField );
+  const auto random = RandomGeneratorType::New();
+  random->Initialize( 121212 );
+  double maximumMeasuredError = 0.0;
+  for( unsigned int k = 0; k < 1000; ++k )
+  {
+    typename DisplacementFieldInterpolatorType::ContinuousIndexType cindex;
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      cindex[ i ] = random->GetUniformVariate( 0.0, size[ i ] - 1.0 );
+    }
+    InputPointType point;
+    displacementField->TransformContinuousIndexToPhysicalPoint( cindex, point );
+    const OutputPointType exactPoint = initialTransform->TransformPoint( point );
+    const typename DisplacementFieldInterpolatorType::OutputType displacement
+      = interpolator->EvaluateAtContinuousIndex( cindex );
+    double error = 0.0;
+    for( unsigned int i = 0; i < FixedImageDimension; ++i )
+    {
+      const double difference = point[ i ] + displacement[ i ] - exactPoint[ i ];
+      error += difference * difference;
+    }
+    maximumMeasuredError = std::max( maximumMeasuredError, std::sqrt( error ) );
+  }
+
+  if( maximumError >= 0.0 && maximumMeasuredError > maximumError )
+  {
+    xl::xout[ "warning" ] << "WARNING: The error of the cached initial transform ("
+                          << maximumMeasuredError << ") exceeds InitialTransformCacheMaximumError ("
+                          << maximumError << ").\n  The initial transform is not cached in this resolution."
+                          << std::endl;
+    return;
+  }
+
+  thisAsGrouper->SetInitialTransformDisplacementField( displacementField );
+  elxout << "  The initial transform is cached in a displacement field of "
+         << size << " voxels (" << numberOfMegaBytes << " MB), with a maximum error of "
+         << maximumMeasuredError << "." << std::endl;
+
+} // end BeforeEachResolutionBase()
+
+
 /**
  * ******************* AfterRegistrationBase ********************
  */
@@ -346,6 +498,15 @@ void
 TransformBase< TElastix >
 ::AfterRegistrationBase( void )
 {
+  /** Remove the cache of the initial transform, so that the final
+   * result is computed with the exact initial transform.
+   */
+  CombinationTransformType * thisAsGrouper = this->GetAsCombinationTransform();
+  if( thisAsGrouper )
+  {
+    thisAsGrouper->SetInitialTransformDisplacementField( nullptr );
+  }
+
   /** Set the final Parameters. */
   this->SetFinalParameters();
 
@@ -502,6 +663,7 @@ TransformBase< TElastix >
     {
       thisAsGrouper->SetUseComposition( false );
     }
+    thisAsGrouper->UpdateFlattenedInitialTransform();
   }
 
   /** Task 4 - Remember the name of the TransformParametersFileName.
@@ -1245,11 +1407,22 @@ TransformBase< TElastix >
 
   /** Apply the transform. */
   elxout << "  The input points are transformed." << std::endl;
-  for( unsigned int j = 0; j < nrofpoints; j++ )
+  const CombinationTransformType * combinationTransform = this->GetAsCombinationTransform();
+  if( combinationTransform )
+  {
+    /** Transform all points at once, stage by stage. */
+    combinationTransform->TransformPoints( inputpointvec, outputpointvec );
+  }
+  else
   {
-    /** Call TransformPoint. */
-    outputpointvec[ j ] = this->GetAsITKBaseType()->TransformPoint( inputpointvec[ j ] );
+    for( unsigned int j = 0; j < nrofpoints; j++ )
+    {
+      outputpointvec[ j ] = this->GetAsITKBaseType()->TransformPoint( inputpointvec[ j ] );
+    }
+  }
 
+  for( unsigned int j = 0; j < nrofpoints; j++ )
+  {
     /** Transform back to index in fixed image domain. */
     dummyImage->TransformPhysicalPointToContinuousIndex(
       outputpointvec[ j ], fixedcindex );
@@ -38,6 +38,8 @@
 #include "elxResampleInterpolatorBase.h"
 #include "elxTransformBase.h"
 
+#include "itkHotPathProfiler.h"
+
 #include <sstream>
 
 /**
@@ -99,6 +101,21 @@ namespace elastix
  *  image, which relates voxel coordinates to world coordinates. Ignoring it
  *  may easily lead to left/right swaps for example, which could skrew up a
  *  (medical) analysis.
+ * \parameter Profiling: Controls whether to measure the time spent in the
+ *    hot paths of the registration: the metric, the interpolator, the
+ *    transform, the sampler, the optimizer step, the pyramids and the
+ *    resampler. A table with the number of calls and the time per component
+ *    is printed at the end of each resolution.\n
+ *    example: <tt>(Profiling "true")</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: "false".
+ * \parameter ProfilingTrace: Controls whether to also record a trace of the
+ *    timed sections, which is written to ProfilingTrace.?.json in the output
+ *    directory, in the Chrome trace event format. It can be inspected with
+ *    chrome://tracing or Perfetto. Only has effect when Profiling is true.\n
+ *    example: <tt>(ProfilingTrace "true")</tt>\n
+ *    This parameter can not be specified for each resolution separately.
+ *    Default value: "false".
  *
  * \ingroup Kernel
  */
@@ -253,6 +270,14 @@ private:
   AfterEachIterationCommandPointer   m_AfterEachIterationCommand{};
   AfterEachResolutionCommandPointer  m_AfterEachResolutionCommand{};
 
+  /** The hot path profiler of this registration, enabled by the parameter
+   * "Profiling" from BeforeRegistration() until AfterRegistration().
+   */
+  itk::HotPathProfiler m_Profiler;
+
+  /** The start of the current resolution, for the profiling trace. */
+  itk::HotPathProfiler::TimePointType m_ResolutionStartTime{};
+
   /** CreateTransformParameterFile. */
   void CreateTransformParameterFile( const std::string FileName,
     const bool ToLog );
@@ -508,6 +508,17 @@ ElastixTemplate< TFixedImage, TMovingImage >
   this->m_Timer0.Reset();
   this->m_Timer0.Start();
 
+  /** Enable the hot path profiler, if requested. */
+  bool profiling = false;
+  this->GetConfiguration()->ReadParameter( profiling, "Profiling", 0, false );
+  bool profilingTrace = false;
+  this->GetConfiguration()->ReadParameter( profilingTrace, "ProfilingTrace", 0, false );
+  itk::HotPathProfiler & profiler = this->m_Profiler;
+  profiler.Reset();
+  profiler.ResetTrace();
+  profiler.SetTraceEnabled( profiling && profilingTrace );
+  profiler.SetEnabled( profiling );
+
   /** Call all the BeforeRegistration() functions. */
   this->BeforeRegistrationBase();
   CallInEachComponent( &BaseComponentType::BeforeRegistrationBase );
@@ -586,6 +597,7 @@ ElastixTemplate< TFixedImage, TMovingImage >
   /** Start ResolutionTimer, which measures the total iteration time in this resolution. */
   this->m_ResolutionTimer.Reset();
   this->m_ResolutionTimer.Start();
+  this->m_ResolutionStartTime = itk::HotPathProfiler::ClockType::now();
 
   /** Start IterationTimer here, to make it possible to measure the time
    * of the first iteration.
@@ -620,6 +632,23 @@ ElastixTemplate< TFixedImage, TMovingImage >
     << " s.\n";
   elxout << std::setprecision( this->GetDefaultOutputPrecision() );
 
+  /** Print the time spent per component in this resolution. The time needed
+   * for the image pyramids is included in the first resolution.
+   */
+  itk::HotPathProfiler & profiler = this->m_Profiler;
+  if( profiler.GetEnabled() )
+  {
+    std::ostringstream marker( "" );
+    marker << "Resolution " << level;
+    profiler.AddTraceMarker( marker.str(), this->m_ResolutionStartTime,
+      itk::HotPathProfiler::ClockType::now() );
+
+    std::ostringstream report( "" );
+    profiler.PrintReport( report, this->m_ResolutionTimer.GetMean() );
+    elxout << "Profile of resolution " << level << ":\n" << report.str();
+    profiler.Reset();
+  }
+
   /** Call all the AfterEachResolution() functions. */
   this->AfterEachResolutionBase();
   CallInEachComponent( &BaseComponentType::AfterEachResolutionBase );
@@ -788,6 +817,38 @@ ElastixTemplate< TFixedImage, TMovingImage >
   elxout << "Time spent on saving the results, applying the final transform etc.: "
          << static_cast< unsigned long >( this->m_Timer0.GetMean() * 1000 ) << " ms.\n";
 
+  /** Print the profile of the resampling and write the trace. */
+  itk::HotPathProfiler & profiler = this->m_Profiler;
+  if( profiler.GetEnabled() )
+  {
+    std::ostringstream report( "" );
+    profiler.PrintReport( report, this->m_Timer0.GetMean() );
+    elxout << "Profile of the final transformation:\n" << report.str();
+    profiler.Reset();
+
+    if( profiler.GetTraceEnabled() )
+    {
+      std::ostringstream makeFileName( "" );
+      makeFileName << this->GetConfiguration()->GetCommandLineArgument( "-out" )
+                   << "ProfilingTrace."
+                   << this->GetConfiguration()->GetElastixLevel()
+                   << ".json";
+      const std::string fileName = makeFileName.str();
+      if( profiler.WriteChromeTrace( fileName ) )
+      {
+        elxout << "The profiling trace is written to " << fileName << std::endl;
+      }
+      else
+      {
+        xout[ "warning" ] << "WARNING: could not write the profiling trace to "
+                          << fileName << std::endl;
+      }
+      profiler.ResetTrace();
+    }
+    profiler.SetEnabled( false );
+    profiler.SetTraceEnabled( false );
+  }
+
 } // end AfterRegistration()
 
 
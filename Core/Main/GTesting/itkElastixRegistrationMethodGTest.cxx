@@ -20,15 +20,18 @@
  // First include the header file to be tested:
 #include <itkElastixRegistrationMethod.h>
 #include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
 #include <itkImageRegionRange.h>
 
 // GoogleTest header file:
 #include <gtest/gtest.h>
 
 #include <algorithm> // For transform
+#include <cmath>
 #include <map>
 #include <string>
 #include <utility> // For pair
+#include <vector>
 
 
 // Tests registering two small (5x6) binary images, which are translated with respect to each other.
@@ -112,3 +115,96 @@ GTEST_TEST(itkElastixRegistrationMethod, Translation)
     EXPECT_EQ(std::round(std::stod(transformParameters[i])), translationOffset[i]);
   }
 }
+
+
+// Tests that the PrecomputeMovingImageGradient parameter of the metric does not affect the result of a registration
+// with the nearest neighbor interpolator, for images with an anisotropic spacing and a non-identity direction.
+GTEST_TEST(itkElastixRegistrationMethod, PrecomputeMovingImageGradient)
+{
+  constexpr auto ImageDimension = 2U;
+  using ImageType = itk::Image<float, ImageDimension>;
+  using SizeType = itk::Size<ImageDimension>;
+  using PointType = ImageType::PointType;
+
+  const SizeType imageSize{ { 16, 14 } };
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.8;
+  spacing[1] = 1.5;
+  const double angle = 0.3;
+  ImageType::DirectionType direction;
+  direction[0][0] = std::cos(angle);
+  direction[0][1] = -std::sin(angle);
+  direction[1][0] = std::sin(angle);
+  direction[1][1] = std::cos(angle);
+
+  // Two smooth blobs, translated with respect to each other.
+  const auto createImage = [&](const double shiftX, const double shiftY)
+  {
+    const auto image = ImageType::New();
+    image->SetRegions(imageSize);
+    image->SetSpacing(spacing);
+    image->SetDirection(direction);
+    image->Allocate();
+    PointType center;
+    image->TransformIndexToPhysicalPoint(itk::Index<ImageDimension>{ { 8, 7 } }, center);
+    for (itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+    {
+      PointType point;
+      image->TransformIndexToPhysicalPoint(it.GetIndex(), point);
+      const double dx = point[0] - center[0] - shiftX;
+      const double dy = point[1] - center[1] - shiftY;
+      it.Set(static_cast<float>(100.0 * std::exp(-(dx * dx + dy * dy) / 20.0)));
+    }
+    return image;
+  };
+  const auto fixedImage = createImage(0.0, 0.0);
+  const auto movingImage = createImage(1.0, -0.5);
+
+  std::vector<std::string> transformParameters[2];
+
+  for (unsigned precompute{}; precompute < 2; ++precompute)
+  {
+    const auto parameterObject = elastix::ParameterObject::New();
+
+    const std::map<std::string, std::vector<std::string>> parameterMap =
+    {
+      // Parameters in alphabetic order:
+      { "FixedImageDimension", { std::to_string(ImageDimension) } },
+      { "ImageSampler", { "Full" } },
+      { "Interpolator", { "NearestNeighborInterpolator" } },
+      { "MaximumNumberOfIterations", { "10" } },
+      { "Metric", { "AdvancedMeanSquares" } },
+      { "MovingImageDimension", { std::to_string(ImageDimension) } },
+      { "NumberOfResolutions", { "1" } },
+      { "Optimizer", { "RegularStepGradientDescent" } },
+      { "PrecomputeMovingImageGradient", { precompute == 1 ? "true" : "false" } },
+      { "Transform", { "TranslationTransform" } }
+    };
+
+    parameterObject->SetParameterMap(parameterMap);
+
+    const auto filter = itk::ElastixRegistrationMethod<ImageType, ImageType>::New();
+    ASSERT_NE(filter, nullptr);
+
+    filter->SetFixedImage(fixedImage);
+    filter->SetMovingImage(movingImage);
+    filter->SetParameterObject(parameterObject);
+    filter->Update();
+
+    const auto& transformParameterMaps = filter->GetTransformParameterObject()->GetParameterMap();
+    ASSERT_EQ(transformParameterMaps.size(), 1);
+
+    const auto found = transformParameterMaps.front().find("TransformParameters");
+    ASSERT_NE(found, transformParameterMaps.front().cend());
+    ASSERT_EQ(found->second.size(), ImageDimension);
+    transformParameters[precompute] = found->second;
+  }
+
+  // The registration should have moved, so that the moving image gradient was used.
+  EXPECT_NE(std::stod(transformParameters[0][0]), 0.0);
+
+  for (unsigned i{}; i < ImageDimension; ++i)
+  {
+    EXPECT_NEAR(std::stod(transformParameters[0][i]), std::stod(transformParameters[1][i]), 1e-6);
+  }
+}
@@ -0,0 +1,85 @@
+import sys
+import json
+from optparse import OptionParser
+
+#-------------------------------------------------------------------------------
+# Compare two result files of itkRegistrationBenchmark, or of any benchmark
+# that writes the google-benchmark JSON format. Benchmarks are matched by name.
+# The test fails if a benchmark became slower than the threshold allows.
+
+def readBenchmarks( fileName ):
+    f = open( fileName )
+    data = json.load( f )
+    f.close()
+
+    benchmarks = {}
+    for benchmark in data[ "benchmarks" ]:
+        benchmarks[ benchmark[ "name" ] ] = benchmark
+    return benchmarks
+
+#-------------------------------------------------------------------------------
+# the main function
+def main():
+    # usage, parse parameters
+    usage = "usage: %prog [options] arg"
+    parser = OptionParser( usage )
+
+    # option to debug and verbose
+    parser.add_option( "-v", "--verbose",
+        action="store_true", dest="verbose" )
+
+    # options to control files
+    parser.add_option( "-b", "--baseline", dest="baseline", help="the baseline JSON results" )
+    parser.add_option( "-t", "--test", dest="test", help="the JSON results to test" )
+
+    # options to control the comparison
+    parser.add_option( "-r", "--threshold", dest="threshold", type="float", default=0.15,
+        help="the allowed relative slowdown, default 0.15" )
+    parser.add_option( "-m", "--minimum", dest="minimum", type="float", default=1000.0,
+        help="ignore benchmarks faster than this many ns in both runs, default 1000" )
+
+    (options, args) = parser.parse_args()
+
+    if options.baseline is None or options.test is None:
+        parser.error( "both --baseline and --test are required" )
+
+    baseline = readBenchmarks( options.baseline )
+    test = readBenchmarks( options.test )
+
+    # Compare the median time per iteration
+    slower = []
+    print( "%-64s %14s %14s %9s" % ( "Benchmark", "Baseline (ns)", "Test (ns)", "Change" ) )
+    for name in sorted( test.keys() ):
+        if name not in baseline:
+            if options.verbose:
+                print( "%-64s %14s %14.1f" % ( name, "-", test[ name ][ "real_time" ] ) )
+            continue
+
+        baseTime = baseline[ name ][ "real_time" ]
+        testTime = test[ name ][ "real_time" ]
+        if baseTime <= 0.0:
+            continue
+
+        change = ( testTime - baseTime ) / baseTime
+        flag = ""
+        if change > options.threshold and max( baseTime, testTime ) >= options.minimum:
+            slower.append( name )
+            flag = " SLOWER"
+        print( "%-64s %14.1f %14.1f %+8.1f%%%s" % ( name, baseTime, testTime, 100.0 * change, flag ) )
+
+    missing = [ name for name in baseline.keys() if name not in test ]
+    if missing:
+        print( "WARNING: %d baseline benchmarks were not run:" % len( missing ) )
+        for name in sorted( missing ):
+            print( "  " + name )
+
+    if slower:
+        print( "ERROR: %d benchmarks are more than %.0f%% slower than the baseline" % ( len( slower ), 100.0 * options.threshold ) )
+        return 1
+
+    print( "SUCCESS: no benchmark is more than %.0f%% slower than the baseline" % ( 100.0 * options.threshold ) )
+    return 0
+
+#-------------------------------------------------------------------------------
+if __name__ == '__main__':
+    sys.exit(main())
@@ -29,6 +29,9 @@
 // Multi-threading using ITK threads
 #include "itkPlatformMultiThreader.h"
 
+// Blocked, multi-threaded vector kernels used by the optimizers
+#include "itkOptimizerVectorKernels.h"
+
 // Multi-threading using OpenMP
 #ifdef ELASTIX_USE_OPENMP
 #include <omp.h>
@@ -77,6 +80,7 @@ public:
   bool                  m_UseOpenMP;
   bool                  m_UseEigen;
   bool                  m_UseMultiThreaded;
+  bool                  m_UseVectorKernels;
 
   struct MultiThreaderParameterType
   {
@@ -93,6 +97,7 @@ public:
     this->m_UseOpenMP        = false;
     this->m_UseEigen         = false;
     this->m_UseMultiThreaded = false;
+    this->m_UseVectorKernels = false;
   }
 
 
@@ -101,7 +106,14 @@ public:
     const unsigned int spaceDimension = m_NumberOfParameters;
     ParametersType &   newPosition    = this->m_CurrentPosition;
 
-    if( !this->m_UseMultiThreaded )
+    if( this->m_UseVectorKernels )
+    {
+      /** Update the new position, as done by the optimizers. */
+      itk::OptimizerVectorKernels::ScaledAdd( this->m_CurrentPosition.data_block(),
+        -this->m_LearningRate, this->m_Gradient.data_block(), newPosition.data_block(), spaceDimension,
+        this->m_Threader, this->m_Threader->GetNumberOfWorkUnits() );
+    }
+    else if( !this->m_UseMultiThreaded )
     {
       /** Get a pointer to the current position. */
       const InternalScalarType * currentPosition = this->m_CurrentPosition.data_block();
@@ -312,6 +324,37 @@ main( int argc, char * argv[] )
       timeCollector.Stop( "ITK (mt)" );
     }
 
+    /** Time the vector kernels of the optimizers. */
+    optimizer->m_UseVectorKernels = true;
+    for( unsigned int i = 0; i < repetitions[ s ]; ++i )
+    {
+      timeCollector.Start( "Kernels" );
+      optimizer->AdvanceOneStep();
+      timeCollector.Stop( "Kernels" );
+    }
+    optimizer->m_UseVectorKernels = false;
+
+    /** Check that the inner product of the vector kernels does not depend
+     * on the number of threads, and that it equals the serial result
+     * up to round-off.
+     */
+    double serialDot = 0.0;
+    for( unsigned int i = 0; i < arraySizes[ s ]; ++i )
+    {
+      serialDot += curPos[ i ] * gradient[ i ];
+    }
+    const itk::ThreadIdType numberOfThreads = optimizer->m_Threader->GetNumberOfWorkUnits();
+    const double dot1 = itk::OptimizerVectorKernels::Dot( curPos, gradient,
+      optimizer->m_Threader, 1 );
+    const double dotN = itk::OptimizerVectorKernels::Dot( curPos, gradient,
+      optimizer->m_Threader, numberOfThreads );
+    if( dot1 != dotN || std::abs( dotN - serialDot ) > 1e-10 * std::abs( serialDot ) )
+    {
+      std::cerr << "ERROR: inner product of the vector kernels differs: "
+                << dot1 << " " << dotN << " " << serialDot << std::endl;
+      return EXIT_FAILURE;
+    }
+
     /** Time the OpenMP multi-threaded implementation. */
 #ifdef ELASTIX_USE_OPENMP
     optimizer->m_UseOpenMP        = true;
@@ -0,0 +1,270 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the re-entrant evaluation of the AdvancedMeanSquares metric
+ with GetValueAndDerivative().
+
+ Two evaluation contexts, one with a single and one with several work units,
+ evaluate different parameters simultaneously, each in its own thread. Their
+ values and derivatives should equal those of GetValueAndDerivative(), for
+ the default and for the specialized sample evaluator.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "itkEvaluationContextCostFunction.h"
+
+#include "itkAdvancedCombinationTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageGridSampler.h"
+#include "itkPlatformMultiThreader.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 2;
+typedef double CoordinateRepresentationType;
+
+typedef itk::Image< float, Dimension >                 ImageType;
+typedef itk::RecursiveBSplineTransform<
+  CoordinateRepresentationType, Dimension, 3 >         BSplineTransformType;
+typedef itk::AdvancedCombinationTransform<
+  CoordinateRepresentationType, Dimension >            CombinationTransformType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, CoordinateRepresentationType, double >    InterpolatorType;
+typedef itk::ImageGridSampler< ImageType >             SamplerType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric<
+  ImageType, ImageType >                               MetricType;
+typedef MetricType::TransformParametersType            ParametersType;
+typedef MetricType::MeasureType                        MeasureType;
+typedef MetricType::DerivativeType                     DerivativeType;
+typedef itk::EvaluationContextCostFunction< MetricType > CostFunctionType;
+typedef itk::PlatformMultiThreader                     ThreaderType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+/** The evaluations of one thread. */
+struct EvaluationType
+{
+  CostFunctionType::Pointer st_CostFunction;
+  ParametersType            st_Parameters;
+  MeasureType               st_Value;
+  DerivativeType            st_Derivative;
+  bool                      st_Failed;
+};
+
+/** Each thread evaluates its cost function a few times. */
+ITK_THREAD_RETURN_FUNCTION_CALL_CONVENTION
+EvaluateThreaderCallback( void * arg )
+{
+  ThreaderType::WorkUnitInfo * info = static_cast< ThreaderType::WorkUnitInfo * >( arg );
+  EvaluationType * evaluation = static_cast< EvaluationType * >( info->UserData ) + info->WorkUnitID;
+  try
+  {
+    for( unsigned int i = 0; i < 5; ++i )
+    {
+      evaluation->st_CostFunction->GetValueAndDerivative(
+        evaluation->st_Parameters, evaluation->st_Value, evaluation->st_Derivative );
+    }
+  }
+  catch( itk::ExceptionObject & err )
+  {
+    std::cerr << err << std::endl;
+    evaluation->st_Failed = true;
+  }
+  return itk::ITK_THREAD_RETURN_DEFAULT_VALUE;
+}
+
+
+/** Create a smooth image, shifted by the given offset. */
+ImageType::Pointer
+CreateImage( const double shift )
+{
+  ImageType::SizeType size;
+  size.Fill( 48 );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( ImageType::RegionType( size ) );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double x = index[ 0 ] - 24.0 - shift;
+    const double y = index[ 1 ] - 22.0;
+    it.Set( static_cast< float >( 100.0 * std::exp( -( x * x + y * y ) / 128.0 )
+      + 10.0 * std::sin( 0.3 * index[ 0 ] ) ) );
+  }
+  return image;
+}
+
+
+/** Compare an evaluation in a context with the reference. */
+bool
+Compare( const std::string & name, const MeasureType value, const DerivativeType & derivative,
+  const MeasureType referenceValue, const DerivativeType & referenceDerivative )
+{
+  const double valueError = std::abs( value - referenceValue ) / std::abs( referenceValue );
+  const double derivativeError = ( derivative - referenceDerivative ).magnitude()
+    / referenceDerivative.magnitude();
+  std::cout << std::setprecision( 12 ) << "  " << name << ": value " << value
+            << " (reference " << referenceValue << "), relative error " << valueError
+            << ", derivative relative error " << derivativeError << std::endl;
+  if( !( valueError < 1e-10 ) || !( derivativeError < 1e-10 ) )
+  {
+    std::cerr << "ERROR: the evaluation in a context differs from GetValueAndDerivative()." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  /** Create the images. */
+  ImageType::Pointer fixedImage  = CreateImage( 0.0 );
+  ImageType::Pointer movingImage = CreateImage( 1.5 );
+
+  /** A B-spline transform, as the current transform of a combination transform. */
+  BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  BSplineTransformType::OriginType origin;
+  origin.Fill( -8.0 );
+  BSplineTransformType::SpacingType spacing;
+  spacing.Fill( 8.0 );
+  BSplineTransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( 10 );
+  BSplineTransformType::DirectionType direction;
+  direction.SetIdentity();
+  bsplineTransform->SetGridOrigin( origin );
+  bsplineTransform->SetGridSpacing( spacing );
+  bsplineTransform->SetGridRegion( BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( direction );
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  /** Two random parameter vectors. */
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 787878 );
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     parameters1( numberOfParameters );
+  ParametersType     parameters2( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters1[ i ] = random->GetUniformVariate( -1.0, 1.0 );
+    parameters2[ i ] = random->GetUniformVariate( -1.0, 1.0 );
+  }
+  transform->SetParameters( parameters1 );
+
+  for( unsigned int specialized = 0; specialized < 2; ++specialized )
+  {
+    std::cout << ( specialized ? "Specialized" : "Default" ) << " sample evaluator:" << std::endl;
+
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 3 );
+    SamplerType::Pointer sampler = SamplerType::New();
+    SamplerType::SampleGridSpacingType gridSpacing;
+    gridSpacing.Fill( 2 );
+    sampler->SetSampleGridSpacing( gridSpacing );
+
+    MetricType::Pointer metric = MetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( transform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetUseSpecializedSampleEvaluator( specialized == 1 );
+    metric->SetUseMultiThread( true );
+    metric->SetNumberOfWorkUnits( 4 );
+    metric->Initialize();
+
+    /** The reference values. */
+    MeasureType    referenceValue1 = 0.0;
+    MeasureType    referenceValue2 = 0.0;
+    DerivativeType referenceDerivative1;
+    DerivativeType referenceDerivative2;
+    metric->GetValueAndDerivative( parameters1, referenceValue1, referenceDerivative1 );
+    metric->GetValueAndDerivative( parameters2, referenceValue2, referenceDerivative2 );
+
+    /** Two contexts, with one and with three work units, evaluated simultaneously. */
+    EvaluationType evaluations[ 2 ];
+    for( unsigned int i = 0; i < 2; ++i )
+    {
+      evaluations[ i ].st_CostFunction = CostFunctionType::New();
+      evaluations[ i ].st_CostFunction->SetNumberOfWorkUnits( i == 0 ? 1 : 3 );
+      evaluations[ i ].st_CostFunction->SetMetric( metric );
+      evaluations[ i ].st_Parameters = i == 0 ? parameters1 : parameters2;
+      evaluations[ i ].st_Value      = 0.0;
+      evaluations[ i ].st_Failed     = false;
+    }
+    ThreaderType::Pointer threader = ThreaderType::New();
+    threader->SetNumberOfWorkUnits( 2 );
+    threader->SetSingleMethod( EvaluateThreaderCallback, evaluations );
+    threader->SingleMethodExecute();
+    if( evaluations[ 0 ].st_Failed || evaluations[ 1 ].st_Failed )
+    {
+      return EXIT_FAILURE;
+    }
+
+    if( !Compare( "context with 1 work unit", evaluations[ 0 ].st_Value, evaluations[ 0 ].st_Derivative,
+      referenceValue1, referenceDerivative1 ) )
+    {
+      return EXIT_FAILURE;
+    }
+    if( !Compare( "context with 3 work units", evaluations[ 1 ].st_Value, evaluations[ 1 ].st_Derivative,
+      referenceValue2, referenceDerivative2 ) )
+    {
+      return EXIT_FAILURE;
+    }
+
+    /** The value only. */
+    const MeasureType value = evaluations[ 1 ].st_CostFunction->GetValue( parameters1 );
+    if( !Compare( "GetValue in context", value, referenceDerivative1,
+      referenceValue1, referenceDerivative1 ) )
+    {
+      return EXIT_FAILURE;
+    }
+
+    /** The metric itself should not have been changed by the contexts. */
+    if( transform->GetParameters() != parameters2 )
+    {
+      std::cerr << "ERROR: the evaluation in a context changed the transform of the metric." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
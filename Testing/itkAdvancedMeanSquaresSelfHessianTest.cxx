@@ -0,0 +1,219 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the multi-threaded self Hessian of the AdvancedMeanSquares
+ metric with the single-threaded one.
+
+ The moving image is smaller than the fixed image, so that part of the
+ samples is not valid. The self Hessian computed with several work units
+ should then have the same sparsity pattern and values as the one computed
+ with a single thread, as well as the same number of pixels counted.
+ The noise is switched off, since GetSelfHessian() seeds the random generator
+ from the clock.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageGridSampler.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 2;
+typedef double CoordinateRepresentationType;
+
+typedef itk::Image< float, Dimension >                 ImageType;
+typedef itk::AdvancedBSplineDeformableTransform<
+  CoordinateRepresentationType, Dimension, 3 >         BSplineTransformType;
+typedef itk::AdvancedCombinationTransform<
+  CoordinateRepresentationType, Dimension >            CombinationTransformType;
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, CoordinateRepresentationType, double >    InterpolatorType;
+typedef itk::ImageGridSampler< ImageType >             SamplerType;
+typedef itk::AdvancedMeanSquaresImageToImageMetric<
+  ImageType, ImageType >                               MetricType;
+typedef MetricType::TransformParametersType            ParametersType;
+typedef MetricType::HessianType                        HessianType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+/** Create a smooth image of the given size. */
+ImageType::Pointer
+CreateImage( const unsigned int imageSize )
+{
+  ImageType::SizeType size;
+  size.Fill( imageSize );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( ImageType::RegionType( size ) );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double x = index[ 0 ] - 20.0;
+    const double y = index[ 1 ] - 18.0;
+    it.Set( static_cast< float >( 100.0 * std::exp( -( x * x + y * y ) / 128.0 )
+      + 10.0 * std::sin( 0.3 * index[ 0 ] ) ) );
+  }
+  return image;
+}
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  /** Create the images. The moving image is smaller, so some samples are not valid. */
+  ImageType::Pointer fixedImage  = CreateImage( 40 );
+  ImageType::Pointer movingImage = CreateImage( 30 );
+
+  /** A B-spline transform, as the current transform of a combination transform. */
+  BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  BSplineTransformType::OriginType origin;
+  origin.Fill( -8.0 );
+  BSplineTransformType::SpacingType spacing;
+  spacing.Fill( 8.0 );
+  BSplineTransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( 9 );
+  BSplineTransformType::DirectionType direction;
+  direction.SetIdentity();
+  bsplineTransform->SetGridOrigin( origin );
+  bsplineTransform->SetGridSpacing( spacing );
+  bsplineTransform->SetGridRegion( BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( direction );
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  /** Random parameters. */
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 565656 );
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     parameters( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ] = random->GetUniformVariate( -1.0, 1.0 );
+  }
+  transform->SetParameters( parameters );
+
+  /** Compute the self Hessian with 1, 2, 3 and 4 work units. */
+  HessianType   reference;
+  unsigned long referenceNumberOfPixelsCounted = 0;
+  for( unsigned int numberOfWorkUnits = 1; numberOfWorkUnits <= 4; ++numberOfWorkUnits )
+  {
+    InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 3 );
+    SamplerType::Pointer sampler = SamplerType::New();
+
+    MetricType::Pointer metric = MetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( transform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetSelfHessianNoiseRange( 0.0 );
+    metric->SetNumberOfSamplesForSelfHessian( 1000 );
+    metric->SetUseMultiThread( numberOfWorkUnits > 1 );
+    metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+    metric->Initialize();
+
+    HessianType H;
+    metric->GetSelfHessian( parameters, H );
+    const unsigned long numberOfPixelsCounted = metric->GetNumberOfPixelsCounted();
+
+    if( numberOfWorkUnits == 1 )
+    {
+      reference                      = H;
+      referenceNumberOfPixelsCounted = numberOfPixelsCounted;
+      std::cout << "1 work unit: " << numberOfPixelsCounted << " pixels counted" << std::endl;
+      continue;
+    }
+
+    /** Compare the sparsity pattern and the values, row by row. */
+    bool   samePattern  = numberOfPixelsCounted == referenceNumberOfPixelsCounted;
+    double maximumError = 0.0;
+    double maximumValue = 0.0;
+    for( unsigned int r = 0; r < numberOfParameters && samePattern; ++r )
+    {
+      const HessianType::row & row          = H.get_row( r );
+      const HessianType::row & referenceRow = reference.get_row( r );
+      if( row.size() != referenceRow.size() )
+      {
+        samePattern = false;
+        break;
+      }
+      for( std::size_t k = 0; k < row.size(); ++k )
+      {
+        if( row[ k ].first != referenceRow[ k ].first )
+        {
+          samePattern = false;
+          break;
+        }
+        maximumError = std::max( maximumError, std::abs( row[ k ].second - referenceRow[ k ].second ) );
+        maximumValue = std::max( maximumValue, std::abs( referenceRow[ k ].second ) );
+      }
+    }
+
+    std::cout << std::setprecision( 12 ) << numberOfWorkUnits << " work units: "
+              << numberOfPixelsCounted << " pixels counted, maximum difference "
+              << maximumError << " (maximum value " << maximumValue << ")" << std::endl;
+
+    if( !samePattern )
+    {
+      std::cerr << "ERROR: the multi-threaded self Hessian has a different sparsity pattern "
+                << "or number of pixels counted than the single-threaded one." << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( !( maximumError <= 1e-12 * maximumValue ) )
+    {
+      std::cerr << "ERROR: the multi-threaded self Hessian differs from the single-threaded one." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Some, but not all, samples should have been valid. */
+  if( referenceNumberOfPixelsCounted == 0 || referenceNumberOfPixelsCounted >= 1000 )
+  {
+    std::cerr << "ERROR: expected part of the samples to be valid, but "
+              << referenceNumberOfPixelsCounted << " were counted." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,235 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the sparse and the dense accumulation of the derivative of
+ the AdvancedNormalizedCorrelation metric.
+
+ For a B-spline transform, the multi-threaded derivative can be accumulated
+ with the stored sparse differentials of the samples, or with dense
+ per-thread sums. Both should give the value and the derivative of the
+ single-threaded implementation, with and without SubtractMean, in 2D and 3D.
+ The accumulation is switched between the evaluations of one metric, so that
+ the per-thread variables are reused in both modes.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+/** A metric of which the accumulation of the derivative can be selected. */
+template< class TImage >
+class AccumulationTestMetric :
+  public itk::AdvancedNormalizedCorrelationImageToImageMetric< TImage, TImage >
+{
+public:
+
+  typedef AccumulationTestMetric          Self;
+  typedef itk::AdvancedNormalizedCorrelationImageToImageMetric<
+    TImage, TImage >                      Superclass;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+  itkNewMacro( Self );
+
+  itkSetMacro( UseSparseAccumulation, bool );
+
+protected:
+
+  AccumulationTestMetric() : m_UseSparseAccumulation( false ) {}
+  ~AccumulationTestMetric() override {}
+
+  bool GetUseSparseJacobianAccumulation( const itk::SizeValueType ) const override
+  {
+    return this->m_UseSparseAccumulation;
+  }
+
+
+private:
+
+  bool m_UseSparseAccumulation;
+};
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestNormalizedCorrelationAccumulation( const unsigned int imageSize )
+{
+  typedef itk::Image< float, Dimension >                                   ImageType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >  BSplineTransformType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension >           CombinationTransformType;
+  typedef itk::BSplineInterpolateImageFunction< ImageType, double, double > InterpolatorType;
+  typedef itk::ImageFullSampler< ImageType >                               SamplerType;
+  typedef AccumulationTestMetric< ImageType >                              MetricType;
+  typedef typename MetricType::DerivativeType                              DerivativeType;
+  typedef typename MetricType::MeasureType                                 MeasureType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator           RandomGeneratorType;
+
+  /** Smooth images, with a different pattern. */
+  typename ImageType::SizeType size;
+  size.Fill( imageSize );
+  typename ImageType::Pointer fixedImage  = ImageType::New();
+  typename ImageType::Pointer movingImage = ImageType::New();
+  fixedImage->SetRegions( typename ImageType::RegionType( size ) );
+  fixedImage->Allocate();
+  movingImage->SetRegions( typename ImageType::RegionType( size ) );
+  movingImage->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > itF( fixedImage, fixedImage->GetLargestPossibleRegion() );
+  itk::ImageRegionIteratorWithIndex< ImageType > itM( movingImage, movingImage->GetLargestPossibleRegion() );
+  for( ; !itF.IsAtEnd(); ++itF, ++itM )
+  {
+    double f = 0.0, m = 0.0;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      const double x = itF.GetIndex()[ i ] - 0.5 * imageSize;
+      f += 50.0 * std::sin( 0.3 * x + i ) + 0.1 * x * x;
+      m += 45.0 * std::sin( 0.3 * x + i + 0.4 ) + 0.12 * x * x;
+    }
+    itF.Set( static_cast< float >( f ) );
+    itM.Set( static_cast< float >( m ) );
+  }
+
+  /** A B-spline transform with random coefficients. */
+  typename BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  typename BSplineTransformType::OriginType origin;
+  origin.Fill( -8.0 );
+  typename BSplineTransformType::SpacingType spacing;
+  spacing.Fill( 6.0 );
+  typename BSplineTransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( imageSize / 6 + 4 );
+  typename BSplineTransformType::DirectionType direction;
+  direction.SetIdentity();
+  bsplineTransform->SetGridOrigin( origin );
+  bsplineTransform->SetGridSpacing( spacing );
+  bsplineTransform->SetGridRegion( typename BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( direction );
+  typename CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 989898 + Dimension );
+  typename CombinationTransformType::ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = random->GetUniformVariate( -1.0, 1.0 );
+  }
+  transform->SetParameters( parameters );
+
+  for( unsigned int subtractMean = 0; subtractMean < 2; ++subtractMean )
+  {
+    /** The single-threaded value and derivative, and then the multi-threaded
+     * ones, alternating the accumulation: dense, sparse, dense, sparse.
+     */
+    const unsigned int numberOfWorkUnits[] = { 1, 3 };
+    MeasureType        referenceValue = 0.0;
+    DerivativeType     referenceDerivative;
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+      typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+      interpolator->SetSplineOrder( 3 );
+      typename SamplerType::Pointer sampler = SamplerType::New();
+      typename MetricType::Pointer  metric  = MetricType::New();
+      metric->SetFixedImage( fixedImage );
+      metric->SetMovingImage( movingImage );
+      metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+      metric->SetTransform( transform );
+      metric->SetInterpolator( interpolator );
+      metric->SetImageSampler( sampler );
+      metric->SetSubtractMean( subtractMean == 1 );
+      metric->SetUseMultiThread( numberOfWorkUnits[ t ] > 1 );
+      metric->SetNumberOfWorkUnits( numberOfWorkUnits[ t ] );
+      metric->SetRequiredRatioOfValidSamples( 0.1 );
+      metric->Initialize();
+
+      if( numberOfWorkUnits[ t ] == 1 )
+      {
+        metric->GetValueAndDerivative( parameters, referenceValue, referenceDerivative );
+        continue;
+      }
+
+      for( unsigned int k = 0; k < 4; ++k )
+      {
+        const bool sparse = k % 2 == 1;
+        metric->SetUseSparseAccumulation( sparse );
+        MeasureType    value = 0.0;
+        DerivativeType derivative;
+        metric->GetValueAndDerivative( parameters, value, derivative );
+
+        const double valueError = std::abs( value - referenceValue ) / std::abs( referenceValue );
+        const double derivativeError = ( derivative - referenceDerivative ).magnitude()
+          / referenceDerivative.magnitude();
+
+        std::cout << std::setprecision( 12 ) << Dimension << "D, SubtractMean " << subtractMean
+                  << ", " << ( sparse ? "sparse" : "dense" ) << " accumulation: value " << value
+                  << ", relative errors: value " << valueError << ", derivative " << derivativeError
+                  << std::endl;
+
+        if( !( referenceDerivative.magnitude() > 0.0 ) )
+        {
+          std::cerr << "ERROR: the derivative is zero." << std::endl;
+          return false;
+        }
+        if( !( valueError < 1e-10 ) || !( derivativeError < 1e-10 ) )
+        {
+          std::cerr << "ERROR: the " << ( sparse ? "sparse" : "dense" )
+                    << " accumulation differs from the single-threaded derivative." << std::endl;
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+
+} // end TestNormalizedCorrelationAccumulation()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  // 2D tests
+  if( !TestNormalizedCorrelationAccumulation< 2 >( 40 ) ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  if( !TestNormalizedCorrelationAccumulation< 3 >( 16 ) ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,230 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the ray packets of the AdvancedRayCastInterpolateImageFunction
+ with the rays cast one by one.
+
+ On a small random volume, rotated and translated by a rigid transform, the
+ integrals computed by EvaluateRays() for a grid of detector points, some of
+ which miss the volume, should equal those of Evaluate() for each point. The
+ number of rays is not a multiple of the packet size. The projection of the
+ RayCastResampleImageFilter should equal the rays cast one by one, and agree
+ with that of the ResampleImageFilter, with one and with several threads.
+ */
+
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+#include "itkRayCastResampleImageFilter.h"
+
+#include "itkEuler3DTransform.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkResampleImageFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 3;
+typedef itk::Image< float, Dimension >                               ImageType;
+typedef itk::AdvancedRayCastInterpolateImageFunction< ImageType, double > RayCastInterpolatorType;
+typedef RayCastInterpolatorType::PointType                           PointType;
+typedef RayCastInterpolatorType::OutputType                          OutputType;
+typedef itk::Euler3DTransform< double >                              TransformType;
+typedef itk::ResampleImageFilter< ImageType, ImageType, double >     ResampleFilterType;
+typedef itk::RayCastResampleImageFilter< ImageType, ImageType, double > RayCastResampleFilterType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator       RandomGeneratorType;
+
+/** The detector: a plane of sizeX x sizeY pixels, at z = 60. */
+const unsigned int DetectorSizeX   = 13;
+const unsigned int DetectorSizeY   = 11;
+const double       DetectorSpacing = 4.0;
+
+/** Project the volume on the detector with a resample filter. */
+template< class TFilter >
+ImageType::Pointer
+Project( ImageType * volume, TransformType * transform, RayCastInterpolatorType * rayCaster,
+  const unsigned int numberOfWorkUnits )
+{
+  ImageType::SizeType size;
+  size[ 0 ] = DetectorSizeX;
+  size[ 1 ] = DetectorSizeY;
+  size[ 2 ] = 1;
+  ImageType::SpacingType spacing;
+  spacing.Fill( DetectorSpacing );
+  ImageType::PointType origin;
+  origin[ 0 ] = -0.5 * DetectorSpacing * ( DetectorSizeX - 1 );
+  origin[ 1 ] = -0.5 * DetectorSpacing * ( DetectorSizeY - 1 );
+  origin[ 2 ] = 60.0;
+
+  typename TFilter::Pointer filter = TFilter::New();
+  filter->SetInput( volume );
+  filter->SetTransform( transform );
+  filter->SetInterpolator( rayCaster );
+  filter->SetSize( size );
+  filter->SetOutputSpacing( spacing );
+  filter->SetOutputOrigin( origin );
+  filter->SetDefaultPixelValue( 0.0 );
+  filter->SetNumberOfWorkUnits( numberOfWorkUnits );
+  filter->Update();
+  return filter->GetOutput();
+
+} // end Project()
+
+
+int
+main( int argc, char * argv[] )
+{
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 252525 );
+
+  /** A small volume with random intensities, partly below the threshold. */
+  ImageType::SizeType size;
+  size[ 0 ] = 20;
+  size[ 1 ] = 18;
+  size[ 2 ] = 16;
+  ImageType::SpacingType spacing;
+  spacing[ 0 ] = 1.2;
+  spacing[ 1 ] = 1.0;
+  spacing[ 2 ] = 1.5;
+  ImageType::PointType origin;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    origin[ i ] = -0.5 * spacing[ i ] * ( size[ i ] - 1 ) + 0.3;
+  }
+  ImageType::Pointer volume = ImageType::New();
+  volume->SetRegions( ImageType::RegionType( size ) );
+  volume->SetSpacing( spacing );
+  volume->SetOrigin( origin );
+  volume->Allocate();
+  itk::ImageRegionIterator< ImageType > it( volume, volume->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    it.Set( static_cast< float >( random->GetUniformVariate( -100.0, 400.0 ) ) );
+  }
+
+  /** A rigid transform of the volume. */
+  TransformType::Pointer transform = TransformType::New();
+  transform->SetRotation( 0.2, -0.15, 0.35 );
+  TransformType::OutputVectorType translation;
+  translation[ 0 ] = 1.5;
+  translation[ 1 ] = -2.0;
+  translation[ 2 ] = 0.5;
+  transform->SetTranslation( translation );
+
+  /** The ray caster, with the focal point in front of the volume. */
+  PointType focalPoint;
+  focalPoint[ 0 ] = 1.0;
+  focalPoint[ 1 ] = -0.5;
+  focalPoint[ 2 ] = -80.0;
+  RayCastInterpolatorType::Pointer rayCaster = RayCastInterpolatorType::New();
+  rayCaster->SetInputImage( volume );
+  rayCaster->SetTransform( transform );
+  rayCaster->SetFocalPoint( focalPoint );
+  rayCaster->SetThreshold( 50.0 );
+
+  /** The detector points; the outer ones miss the volume. */
+  std::vector< PointType > points;
+  for( unsigned int y = 0; y < DetectorSizeY; ++y )
+  {
+    for( unsigned int x = 0; x < DetectorSizeX; ++x )
+    {
+      PointType point;
+      point[ 0 ] = DetectorSpacing * ( x - 0.5 * ( DetectorSizeX - 1 ) );
+      point[ 1 ] = DetectorSpacing * ( y - 0.5 * ( DetectorSizeY - 1 ) );
+      point[ 2 ] = 60.0;
+      points.push_back( point );
+    }
+  }
+  const unsigned int numberOfRays = static_cast< unsigned int >( points.size() );
+
+  /** Cast the rays in packets, and one by one. */
+  std::vector< OutputType > values( numberOfRays );
+  rayCaster->EvaluateRays( &points[ 0 ], &values[ 0 ], numberOfRays );
+
+  unsigned int numberOfNonZeroRays = 0;
+  double       maximumValue        = 0.0;
+  for( unsigned int i = 0; i < numberOfRays; ++i )
+  {
+    const OutputType value = rayCaster->Evaluate( points[ i ] );
+    if( values[ i ] != value )
+    {
+      std::cerr << std::setprecision( 17 ) << "ERROR: ray " << i << " gives " << values[ i ]
+                << " with EvaluateRays() and " << value << " with Evaluate()." << std::endl;
+      return EXIT_FAILURE;
+    }
+    numberOfNonZeroRays += value != 0.0 ? 1 : 0;
+    maximumValue = std::max( maximumValue, static_cast< double >( value ) );
+  }
+
+  std::cout << numberOfRays << " rays, in packets of " << RayCastInterpolatorType::RayPacketSize
+            << ": " << numberOfNonZeroRays << " hit the volume, maximum integral "
+            << maximumValue << std::endl;
+
+  /** Both hits and misses should have been tested. */
+  if( numberOfNonZeroRays == 0 || numberOfNonZeroRays == numberOfRays )
+  {
+    std::cerr << "ERROR: expected some, but not all, rays to hit the volume." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** The projection of the RayCastResampleImageFilter should equal Evaluate()
+   * for each pixel. The ResampleImageFilter maps linear transforms through
+   * continuous indices, so it agrees up to rounding.
+   */
+  const ImageType::Pointer reference = Project< ResampleFilterType >( volume, transform, rayCaster, 1 );
+  const unsigned int numberOfWorkUnits[] = { 1, 4 };
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    const ImageType::Pointer projection
+      = Project< RayCastResampleFilterType >( volume, transform, rayCaster, numberOfWorkUnits[ t ] );
+    itk::ImageRegionConstIteratorWithIndex< ImageType > itProj( projection, projection->GetLargestPossibleRegion() );
+    itk::ImageRegionConstIterator< ImageType >          itRef( reference, reference->GetLargestPossibleRegion() );
+    double maximumError = 0.0;
+    for( ; !itProj.IsAtEnd(); ++itProj, ++itRef )
+    {
+      PointType outputPoint;
+      projection->TransformIndexToPhysicalPoint( itProj.GetIndex(), outputPoint );
+      const float expected = static_cast< float >( rayCaster->Evaluate( transform->TransformPoint( outputPoint ) ) );
+      if( itProj.Get() != expected )
+      {
+        std::cerr << "ERROR: the RayCastResampleImageFilter with " << numberOfWorkUnits[ t ]
+                  << " work unit(s) differs from Evaluate() at " << itProj.GetIndex() << "." << std::endl;
+        return EXIT_FAILURE;
+      }
+      maximumError = std::max( maximumError, static_cast< double >( std::abs( itProj.Get() - itRef.Get() ) ) );
+    }
+
+    std::cout << numberOfWorkUnits[ t ] << " work unit(s): maximum difference with the ResampleImageFilter "
+              << maximumError << std::endl;
+    if( !( maximumError <= 1e-4 * maximumValue ) )
+    {
+      std::cerr << "ERROR: the RayCastResampleImageFilter differs from the ResampleImageFilter." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
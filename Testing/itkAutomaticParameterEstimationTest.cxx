@@ -0,0 +1,299 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the multi-threaded Jacobian terms and displacement distribution
+ of the automatic parameter estimation with the single-threaded ones.
+
+ On a B-spline transform with random coefficients, the four terms computed by
+ ComputeJacobianTerms, and the jacg and maxJJ computed by
+ ComputeDisplacementDistribution, should be identical for any number of
+ threads, and identical to the single-threaded computation, in 2D and 3D.
+ */
+
+#include "itkComputeJacobianTerms.h"
+#include "itkComputeDisplacementDistribution.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkSingleValuedCostFunction.h"
+
+#include "itkImage.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+//-------------------------------------------------------------------------------------
+
+/** A cost function with a fixed, pseudo-random derivative. */
+class FixedDerivativeCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+
+  typedef FixedDerivativeCostFunction     Self;
+  typedef itk::SingleValuedCostFunction   Superclass;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+  itkNewMacro( Self );
+  itkTypeMacro( FixedDerivativeCostFunction, SingleValuedCostFunction );
+
+  typedef Superclass::MeasureType    MeasureType;
+  typedef Superclass::ParametersType ParametersType;
+  typedef Superclass::DerivativeType DerivativeType;
+
+  void SetDerivative( const DerivativeType & derivative )
+  {
+    this->m_Derivative = derivative;
+  }
+
+
+  unsigned int GetNumberOfParameters( void ) const override
+  {
+    return this->m_Derivative.GetSize();
+  }
+
+
+  MeasureType GetValue( const ParametersType & itkNotUsed( parameters ) ) const override
+  {
+    return 0.0;
+  }
+
+
+  void GetDerivative( const ParametersType & itkNotUsed( parameters ),
+    DerivativeType & derivative ) const override
+  {
+    derivative = this->m_Derivative;
+  }
+
+
+protected:
+
+  FixedDerivativeCostFunction() {}
+  ~FixedDerivativeCostFunction() override {}
+
+private:
+
+  DerivativeType m_Derivative;
+
+};
+
+//-------------------------------------------------------------------------------------
+
+/** Compare a result with its single-threaded reference. */
+bool
+CompareExactly( const std::string & name, const double value, const double reference )
+{
+  if( value != reference )
+  {
+    std::cerr << std::setprecision( 17 ) << "ERROR: " << name << " is " << value
+              << ", but the single-threaded result is " << reference << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestAutomaticParameterEstimation( const unsigned int imageSize )
+{
+  typedef itk::Image< short, Dimension >                                  ImageType;
+  typedef itk::AdvancedTransform< double, Dimension, Dimension >          TransformType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > BSplineTransformType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension >          CombinationTransformType;
+  typedef itk::ComputeJacobianTerms< ImageType, TransformType >           JacobianTermsType;
+  typedef itk::ComputeDisplacementDistribution< ImageType, TransformType > DisplacementDistributionType;
+  typedef typename TransformType::ParametersType                          ParametersType;
+  typedef typename DisplacementDistributionType::ScalesType               ScalesType;
+  typedef FixedDerivativeCostFunction::DerivativeType                     DerivativeType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator          RandomGeneratorType;
+
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 252525 + Dimension );
+
+  /** The fixed image. */
+  typename ImageType::SizeType size;
+  size.Fill( imageSize );
+  typename ImageType::Pointer image = ImageType::New();
+  image->SetRegions( typename ImageType::RegionType( size ) );
+  image->Allocate();
+  image->FillBuffer( 0 );
+
+  /** A B-spline transform with random coefficients, covering the image. */
+  typename BSplineTransformType::OriginType      gridOrigin;
+  typename BSplineTransformType::SpacingType     gridSpacing;
+  typename BSplineTransformType::RegionType::SizeType gridSize;
+  typename BSplineTransformType::DirectionType   gridDirection;
+  gridDirection.SetIdentity();
+  gridSpacing.Fill( 8.0 );
+  gridOrigin.Fill( -8.0 );
+  gridSize.Fill( imageSize / 8 + 3 );
+  typename BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridRegion( typename BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( gridDirection );
+  typename CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  const unsigned int numberOfParameters = transform->GetNumberOfParameters();
+  ParametersType     parameters( numberOfParameters );
+  ParametersType     searchDirection( numberOfParameters );
+  DerivativeType     derivative( numberOfParameters );
+  ScalesType         scales( numberOfParameters );
+  for( unsigned int i = 0; i < numberOfParameters; ++i )
+  {
+    parameters[ i ]      = random->GetUniformVariate( -2.0, 2.0 );
+    derivative[ i ]      = random->GetUniformVariate( -1.0, 1.0 );
+    searchDirection[ i ] = random->GetUniformVariate( -1.0, 1.0 );
+    scales[ i ]          = random->GetUniformVariate( 1.0, 3.0 );
+  }
+  transform->SetParameters( parameters );
+
+  FixedDerivativeCostFunction::Pointer costFunction = FixedDerivativeCostFunction::New();
+  costFunction->SetDerivative( derivative );
+
+  /** Several blocks of samples, and a band that does not hold all elements,
+   * so that both the band and the sparse part of the covariance are used.
+   */
+  const itk::SizeValueType numberOfJacobianMeasurements = 5000;
+
+  /** The Jacobian terms, with 1 (the reference), 2, 3 and 8 work units. */
+  double referenceTerms[ 4 ] = { 0.0, 0.0, 0.0, 0.0 };
+  const unsigned int numberOfWorkUnits[] = { 1, 2, 3, 8 };
+  for( unsigned int t = 0; t < 4; ++t )
+  {
+    typename JacobianTermsType::Pointer jacobianTerms = JacobianTermsType::New();
+    jacobianTerms->SetFixedImage( image );
+    jacobianTerms->SetFixedImageRegion( image->GetBufferedRegion() );
+    jacobianTerms->SetTransform( transform );
+    jacobianTerms->SetMaxBandCovSize( 24 );
+    jacobianTerms->SetNumberOfBandStructureSamples( 10 );
+    jacobianTerms->SetNumberOfJacobianMeasurements( numberOfJacobianMeasurements );
+    jacobianTerms->SetScales( scales );
+    jacobianTerms->SetUseScales( true );
+    jacobianTerms->SetNumberOfWorkUnits( numberOfWorkUnits[ t ] );
+
+    double terms[ 4 ] = { 0.0, 0.0, 0.0, 0.0 };
+    jacobianTerms->Compute( terms[ 0 ], terms[ 1 ], terms[ 2 ], terms[ 3 ] );
+
+    std::cout << std::setprecision( 17 ) << Dimension << "D, " << numberOfWorkUnits[ t ]
+              << " work unit(s): TrC " << terms[ 0 ] << ", TrCC " << terms[ 1 ]
+              << ", maxJJ " << terms[ 2 ] << ", maxJCJ " << terms[ 3 ] << std::endl;
+
+    if( t == 0 )
+    {
+      std::copy( terms, terms + 4, referenceTerms );
+      if( !( terms[ 0 ] > 0.0 ) || !( terms[ 1 ] > 0.0 ) )
+      {
+        std::cerr << "ERROR: the covariance matrix is empty." << std::endl;
+        return false;
+      }
+      continue;
+    }
+
+    if( !CompareExactly( "TrC", terms[ 0 ], referenceTerms[ 0 ] )
+      || !CompareExactly( "TrCC", terms[ 1 ], referenceTerms[ 1 ] )
+      || !CompareExactly( "maxJJ", terms[ 2 ], referenceTerms[ 2 ] )
+      || !CompareExactly( "maxJCJ", terms[ 3 ], referenceTerms[ 3 ] ) )
+    {
+      return false;
+    }
+  }
+
+  /** The displacement distribution, for both methods, single-threaded
+   * (the reference) and with 1, 3 and 8 work units.
+   */
+  const std::string  methods[] = { "2sigma", "95percentile" };
+  const unsigned int distributionNumberOfWorkUnits[] = { 1, 1, 3, 8 };
+  for( unsigned int m = 0; m < 2; ++m )
+  {
+    double referenceJacg        = 0.0;
+    double referenceMaxJJ       = 0.0;
+    double referenceSearchJacg  = 0.0;
+    double referenceSearchMaxJJ = 0.0;
+    for( unsigned int t = 0; t < 4; ++t )
+    {
+      typename DisplacementDistributionType::Pointer distribution = DisplacementDistributionType::New();
+      distribution->SetFixedImage( image );
+      distribution->SetFixedImageRegion( image->GetBufferedRegion() );
+      distribution->SetTransform( transform );
+      distribution->SetCostFunction( costFunction );
+      distribution->SetNumberOfJacobianMeasurements( numberOfJacobianMeasurements );
+      distribution->SetScales( scales );
+      distribution->SetUseScales( true );
+      distribution->SetUseMultiThread( t > 0 );
+      distribution->SetNumberOfWorkUnits( distributionNumberOfWorkUnits[ t ] );
+
+      double jacg        = 0.0;
+      double maxJJ       = 0.0;
+      double searchJacg  = 0.0;
+      double searchMaxJJ = 0.0;
+      distribution->Compute( parameters, jacg, maxJJ, methods[ m ] );
+      distribution->ComputeUsingSearchDirection( searchDirection, searchJacg, searchMaxJJ, methods[ m ] );
+
+      std::cout << std::setprecision( 17 ) << Dimension << "D, " << methods[ m ] << ", "
+                << distributionNumberOfWorkUnits[ t ] << " work unit(s), "
+                << ( t == 0 ? "single-threaded" : "multi-threaded" ) << ": jacg " << jacg
+                << ", maxJJ " << maxJJ << ", jacg along the search direction " << searchJacg << std::endl;
+
+      if( t == 0 )
+      {
+        referenceJacg        = jacg;
+        referenceMaxJJ       = maxJJ;
+        referenceSearchJacg  = searchJacg;
+        referenceSearchMaxJJ = searchMaxJJ;
+        if( !( jacg > 0.0 ) || !( maxJJ > 0.0 ) || !( searchJacg > 0.0 ) )
+        {
+          std::cerr << "ERROR: the displacement distribution is empty." << std::endl;
+          return false;
+        }
+        continue;
+      }
+
+      if( !CompareExactly( "jacg", jacg, referenceJacg )
+        || !CompareExactly( "maxJJ", maxJJ, referenceMaxJJ )
+        || !CompareExactly( "jacg along the search direction", searchJacg, referenceSearchJacg )
+        || !CompareExactly( "maxJJ along the search direction", searchMaxJJ, referenceSearchMaxJJ ) )
+      {
+        return false;
+      }
+    }
+  }
+
+  return true;
+
+} // end TestAutomaticParameterEstimation()
+
+
+int
+main( int argc, char ** argv )
+{
+  // 2D tests
+  bool success = TestAutomaticParameterEstimation< 2 >( 96 );
+  if( !success ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  success = TestAutomaticParameterEstimation< 3 >( 24 );
+  if( !success ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+} // end main
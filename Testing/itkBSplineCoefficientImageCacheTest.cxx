@@ -0,0 +1,196 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Check that the BSplineCoefficientImageCache shares the coefficients
+ that are in use, and forgets the others.
+
+ Interpolators of the same image should get one cache entry, also when they
+ ask for it from several threads at the same time, and interpolate as the
+ BSplineInterpolateImageFunction. When the interpolators move to another
+ image, or are destroyed, the entries they used should be removed.
+ */
+
+#include "itkCachedBSplineInterpolateImageFunction.h"
+#include "itkBSplineInterpolateImageFunction.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 2;
+typedef itk::Image< short, Dimension >                                    ImageType;
+typedef itk::CachedBSplineInterpolateImageFunction< ImageType, double, double > CachedInterpolatorType;
+typedef itk::BSplineInterpolateImageFunction< ImageType, double, double > InterpolatorType;
+typedef CachedInterpolatorType::CoefficientImageCacheType                 CacheType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator            RandomGeneratorType;
+
+/** Create a random image. */
+ImageType::Pointer
+CreateImage( RandomGeneratorType * random )
+{
+  ImageType::SizeType size;
+  size[ 0 ] = 61;
+  size[ 1 ] = 47;
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( ImageType::RegionType( size ) );
+  image->Allocate();
+
+  itk::ImageRegionIterator< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    it.Set( static_cast< short >( random->GetUniformVariate( -1000.0, 1000.0 ) ) );
+  }
+  return image;
+}
+
+
+/** Set the input of the interpolator, as a thread of a metric would. */
+void
+SetInputImage( CachedInterpolatorType * interpolator, const ImageType * image )
+{
+  interpolator->SetInputImage( image );
+}
+
+
+/** Compare the interpolator with the BSplineInterpolateImageFunction. */
+bool
+CompareInterpolators( CachedInterpolatorType * interpolator, const ImageType * image )
+{
+  InterpolatorType::Pointer reference = InterpolatorType::New();
+  reference->SetSplineOrder( interpolator->GetSplineOrder() );
+  reference->SetInputImage( image );
+
+  double maximumDifference = 0.0;
+  for( unsigned int i = 0; i < 200; ++i )
+  {
+    InterpolatorType::ContinuousIndexType cindex;
+    cindex[ 0 ] = 0.3 * i;
+    cindex[ 1 ] = 0.23 * i;
+    maximumDifference = std::max( maximumDifference, std::abs(
+      interpolator->EvaluateAtContinuousIndex( cindex ) - reference->EvaluateAtContinuousIndex( cindex ) ) );
+  }
+  if( maximumDifference > 1e-8 )
+  {
+    std::cerr << "ERROR: the cached interpolator differs from the BSplineInterpolateImageFunction by "
+              << maximumDifference << "." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+/** Check the number of entries of the cache. */
+bool
+CheckNumberOfEntries( const unsigned int expected, const char * when )
+{
+  const unsigned int numberOfEntries = CacheType::GetInstance()->GetNumberOfEntries();
+  std::cout << numberOfEntries << " cache entries " << when << std::endl;
+  if( numberOfEntries != expected )
+  {
+    std::cerr << "ERROR: expected " << expected << " cache entries " << when << "." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+
+int
+main( int argc, char * argv[] )
+{
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 121212 );
+  ImageType::Pointer image      = CreateImage( random );
+  ImageType::Pointer otherImage = CreateImage( random );
+
+  /** Two interpolators of the same image share one entry. */
+  CachedInterpolatorType::Pointer interpolator = CachedInterpolatorType::New();
+  interpolator->SetSplineOrder( 3 );
+  interpolator->SetNumberOfWorkUnits( 4 );
+  interpolator->SetInputImage( image );
+  {
+    CachedInterpolatorType::Pointer otherInterpolator = CachedInterpolatorType::New();
+    otherInterpolator->SetSplineOrder( 3 );
+    otherInterpolator->SetInputImage( image );
+    if( !CheckNumberOfEntries( 1, "for two interpolators of one image" )
+      || !CompareInterpolators( otherInterpolator, image ) )
+    {
+      return EXIT_FAILURE;
+    }
+  }
+
+  /** Interpolators that ask for the other image at the same time share its entry. */
+  {
+    const unsigned int numberOfThreads = 4;
+    std::vector< CachedInterpolatorType::Pointer > interpolators( numberOfThreads );
+    std::vector< std::thread >                     threads;
+    for( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+      interpolators[ t ] = CachedInterpolatorType::New();
+      interpolators[ t ]->SetSplineOrder( 3 );
+      interpolators[ t ]->SetNumberOfWorkUnits( 2 );
+      threads.push_back( std::thread( SetInputImage, interpolators[ t ].GetPointer(), otherImage.GetPointer() ) );
+    }
+    for( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+      threads[ t ].join();
+    }
+    if( !CheckNumberOfEntries( 2, "after the concurrent requests" ) )
+    {
+      return EXIT_FAILURE;
+    }
+    for( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+      if( !CompareInterpolators( interpolators[ t ], otherImage ) )
+      {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  /** The interpolators of the other image are destroyed, so its entry is removed. */
+  if( !CheckNumberOfEntries( 1, "after destroying the interpolators of the other image" ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Moving to the other image releases the first one. */
+  interpolator->SetInputImage( otherImage );
+  if( !CheckNumberOfEntries( 1, "after moving to the other image" )
+    || !CompareInterpolators( interpolator, otherImage ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  /** Without interpolators, the cache is empty. */
+  interpolator = nullptr;
+  if( !CheckNumberOfEntries( 0, "after destroying all interpolators" ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
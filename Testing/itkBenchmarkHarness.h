@@ -0,0 +1,418 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef __itkBenchmarkHarness_h
+#define __itkBenchmarkHarness_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkTimeProbe.h"
+#include "itkMultiThreaderBase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace itk
+{
+
+/** \class BenchmarkHarness
+ * \brief A small micro-benchmark harness for the registration hot paths.
+ *
+ * Benchmarks are registered with a name, a list of (name, value)
+ * parameters and a setup function. The harness runs every benchmark for
+ * every thread count in the thread sweep: it sets the global default number
+ * of threads, calls the setup function, which allocates the images,
+ * transforms, etc. and returns the function to be timed, and then times that
+ * function. The number of iterations is increased until a single run takes
+ * at least MinimumTime seconds, after which the run is repeated
+ * NumberOfRepetitions times. The median time per iteration is reported.
+ *
+ * The benchmark names follow the google-benchmark convention, e.g.
+ * "TransformPoint/BSpline/size:64/spacing:8/threads:4", and the results
+ * can be written in the google-benchmark JSON format, such that they can be
+ * compared between versions with elx_compare_benchmarks.py.
+ *
+ * Example:
+ *
+ *   itk::BenchmarkHarness::Pointer harness = itk::BenchmarkHarness::New();
+ *   harness->AddBenchmark( "Dot", { { "size", n } }, [ n ]()
+ *   {
+ *     auto x = std::make_shared< std::vector< double > >( n, 1.0 );
+ *     return [ x ]() { ... };
+ *   }, n );
+ *   harness->Run();
+ *   harness->WriteJSON( "results.json", argv[ 0 ] );
+ */
+
+class BenchmarkHarness : public Object
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef BenchmarkHarness           Self;
+  typedef Object                     Superclass;
+  typedef SmartPointer< Self >       Pointer;
+  typedef SmartPointer< const Self > ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro( Self );
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro( BenchmarkHarness, Object );
+
+  /** The function that is timed, and the function that prepares it. */
+  typedef std::function< void ( void ) >         FunctionType;
+  typedef std::function< FunctionType( void ) >  SetupFunctionType;
+  typedef std::pair< std::string, double >       ParameterType;
+  typedef std::vector< ParameterType >           ParameterListType;
+  typedef std::vector< ThreadIdType >            ThreadListType;
+
+  /** The result of a single benchmark. Times are in nanoseconds. */
+  struct ResultType
+  {
+    std::string       m_Name;
+    std::string       m_BaseName;
+    ParameterListType m_Parameters;
+    ThreadIdType      m_NumberOfThreads;
+    SizeValueType     m_Iterations;
+    unsigned int      m_Repetitions;
+    double            m_MedianTime;
+    double            m_MeanTime;
+    double            m_MinimumTime;
+    double            m_StandardDeviation;
+    double            m_ItemsPerSecond;
+  };
+  typedef std::vector< ResultType > ResultListType;
+
+  /** The minimum duration in seconds of a single repetition. */
+  itkSetMacro( MinimumTime, double );
+  itkGetConstMacro( MinimumTime, double );
+
+  /** The number of repetitions over which the median is taken. */
+  itkSetClampMacro( NumberOfRepetitions, unsigned int, 1, 1000 );
+  itkGetConstMacro( NumberOfRepetitions, unsigned int );
+
+  /** Only benchmarks whose name contains the filter string are run. */
+  itkSetStringMacro( Filter );
+  itkGetStringMacro( Filter );
+
+  /** The thread counts that every benchmark is run with. */
+  void SetThreadList( const ThreadListType & threads )
+  {
+    this->m_ThreadList = threads;
+    this->Modified();
+  }
+
+
+  const ThreadListType & GetThreadList( void ) const
+  {
+    return this->m_ThreadList;
+  }
+
+
+  /** Register a benchmark. The optional itemsPerIteration, for example the
+   * number of points that is transformed in one call of the timed function,
+   * is used to report a throughput. Benchmarks that are not multi-threaded
+   * are only run with a single thread, instead of the full thread sweep.
+   */
+  void AddBenchmark( const std::string & name, const ParameterListType & parameters,
+    const SetupFunctionType & setup, const double itemsPerIteration = 0.0,
+    const bool multiThreaded = true )
+  {
+    BenchmarkType benchmark;
+    benchmark.m_Name              = name;
+    benchmark.m_Parameters        = parameters;
+    benchmark.m_Setup             = setup;
+    benchmark.m_ItemsPerIteration = itemsPerIteration;
+    benchmark.m_MultiThreaded     = multiThreaded;
+    this->m_Benchmarks.push_back( benchmark );
+  }
+
+
+  /** Run all registered benchmarks that pass the filter. Returns the
+   * number of benchmarks that failed with an exception.
+   */
+  unsigned int Run( void )
+  {
+    this->m_Results.clear();
+    unsigned int numberOfFailures = 0;
+
+    const ThreadIdType defaultNumberOfThreads = MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+    ThreadListType     threadSweep            = this->m_ThreadList;
+    if( threadSweep.empty() )
+    {
+      threadSweep.push_back( defaultNumberOfThreads );
+    }
+
+    std::cout << std::left << std::setw( 64 ) << "Benchmark"
+              << std::right << std::setw( 16 ) << "Time (ns)"
+              << std::setw( 12 ) << "Iterations"
+              << std::setw( 16 ) << "Items/s" << std::endl;
+    std::cout << std::string( 108, '-' ) << std::endl;
+
+    for( std::size_t b = 0; b < this->m_Benchmarks.size(); ++b )
+    {
+      const BenchmarkType & benchmark = this->m_Benchmarks[ b ];
+      const ThreadListType  threads   = benchmark.m_MultiThreaded ? threadSweep : ThreadListType( 1, 1 );
+      for( std::size_t t = 0; t < threads.size(); ++t )
+      {
+        ResultType result;
+        result.m_BaseName        = benchmark.m_Name;
+        result.m_Parameters      = benchmark.m_Parameters;
+        result.m_NumberOfThreads = threads[ t ];
+        result.m_Name            = Self::GetFullName( benchmark, threads[ t ] );
+        if( result.m_Name.find( this->m_Filter ) == std::string::npos )
+        {
+          continue;
+        }
+
+        MultiThreaderBase::SetGlobalDefaultNumberOfThreads( threads[ t ] );
+        try
+        {
+          this->RunBenchmark( benchmark, result );
+        }
+        catch( ExceptionObject & err )
+        {
+          std::cerr << "ERROR: benchmark " << result.m_Name << " failed:\n" << err << std::endl;
+          ++numberOfFailures;
+          continue;
+        }
+
+        std::cout << std::left << std::setw( 64 ) << result.m_Name
+                  << std::right << std::setw( 16 ) << std::fixed << std::setprecision( 1 ) << result.m_MedianTime
+                  << std::setw( 12 ) << result.m_Iterations
+                  << std::setw( 16 ) << std::scientific << std::setprecision( 3 ) << result.m_ItemsPerSecond
+                  << std::endl;
+        this->m_Results.push_back( result );
+      }
+    }
+
+    MultiThreaderBase::SetGlobalDefaultNumberOfThreads( defaultNumberOfThreads );
+    return numberOfFailures;
+
+  } // end Run()
+
+
+  /** Get the results of the last Run(). */
+  const ResultListType & GetResults( void ) const
+  {
+    return this->m_Results;
+  }
+
+
+  /** Write the results of the last Run() in the google-benchmark JSON format. */
+  bool WriteJSON( const std::string & fileName, const std::string & executable ) const
+  {
+    std::ofstream output( fileName.c_str() );
+    if( !output.is_open() )
+    {
+      std::cerr << "ERROR: could not open " << fileName << " for writing." << std::endl;
+      return false;
+    }
+
+    char              date[ 64 ];
+    const std::time_t now = std::time( nullptr );
+    std::strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%S", std::localtime( &now ) );
+
+    output << std::setprecision( 17 );
+    output << "{\n  \"context\": {\n";
+    output << "    \"date\": \"" << date << "\",\n";
+    output << "    \"executable\": \"" << Self::Escape( executable ) << "\",\n";
+    output << "    \"num_cpus\": " << MultiThreaderBase::GetGlobalMaximumNumberOfThreads() << ",\n";
+#ifdef NDEBUG
+    output << "    \"library_build_type\": \"release\",\n";
+#else
+    output << "    \"library_build_type\": \"debug\",\n";
+#endif
+    output << "    \"min_time\": " << this->m_MinimumTime << ",\n";
+    output << "    \"repetitions\": " << this->m_NumberOfRepetitions << "\n";
+    output << "  },\n  \"benchmarks\": [\n";
+
+    for( std::size_t i = 0; i < this->m_Results.size(); ++i )
+    {
+      const ResultType & result = this->m_Results[ i ];
+      output << "    {\n";
+      output << "      \"name\": \"" << Self::Escape( result.m_Name ) << "\",\n";
+      output << "      \"run_name\": \"" << Self::Escape( result.m_BaseName ) << "\",\n";
+      output << "      \"parameters\": {";
+      for( std::size_t p = 0; p < result.m_Parameters.size(); ++p )
+      {
+        output << ( p == 0 ? " " : ", " ) << "\"" << Self::Escape( result.m_Parameters[ p ].first )
+               << "\": " << result.m_Parameters[ p ].second;
+      }
+      output << " },\n";
+      output << "      \"threads\": " << result.m_NumberOfThreads << ",\n";
+      output << "      \"iterations\": " << result.m_Iterations << ",\n";
+      output << "      \"repetitions\": " << result.m_Repetitions << ",\n";
+      output << "      \"real_time\": " << result.m_MedianTime << ",\n";
+      output << "      \"mean_time\": " << result.m_MeanTime << ",\n";
+      output << "      \"min_time\": " << result.m_MinimumTime << ",\n";
+      output << "      \"stddev_time\": " << result.m_StandardDeviation << ",\n";
+      output << "      \"items_per_second\": " << result.m_ItemsPerSecond << ",\n";
+      output << "      \"time_unit\": \"ns\"\n";
+      output << "    }" << ( i + 1 < this->m_Results.size() ? "," : "" ) << "\n";
+    }
+    output << "  ]\n}\n";
+
+    return true;
+
+  } // end WriteJSON()
+
+
+protected:
+
+  BenchmarkHarness()
+  {
+    this->m_MinimumTime         = 0.1;
+    this->m_NumberOfRepetitions = 5;
+  }
+
+
+  ~BenchmarkHarness() override {}
+
+private:
+
+  BenchmarkHarness( const Self & );  // purposely not implemented
+  void operator=( const Self & );    // purposely not implemented
+
+  struct BenchmarkType
+  {
+    std::string       m_Name;
+    ParameterListType m_Parameters;
+    SetupFunctionType m_Setup;
+    double            m_ItemsPerIteration;
+    bool              m_MultiThreaded;
+  };
+
+  /** Time iterations calls of the function, in seconds. */
+  static double Time( const FunctionType & function, const SizeValueType iterations )
+  {
+    TimeProbe timer;
+    timer.Start();
+    for( SizeValueType i = 0; i < iterations; ++i )
+    {
+      function();
+    }
+    timer.Stop();
+    return timer.GetTotal();
+  }
+
+
+  /** Run a single benchmark with the current global number of threads. */
+  void RunBenchmark( const BenchmarkType & benchmark, ResultType & result ) const
+  {
+    const FunctionType function = benchmark.m_Setup();
+
+    /** Warm up, and find the number of iterations that takes at least MinimumTime. */
+    function();
+    SizeValueType iterations = 1;
+    for(;; )
+    {
+      const double time = Self::Time( function, iterations );
+      if( time >= this->m_MinimumTime || iterations >= 1000000000UL )
+      {
+        break;
+      }
+      const double factor = time > 0.0 ? 1.4 * this->m_MinimumTime / time : 10.0;
+      iterations = static_cast< SizeValueType >( std::ceil( iterations * std::min( std::max( factor, 2.0 ), 10.0 ) ) );
+    }
+
+    /** The timed repetitions. */
+    std::vector< double > times( this->m_NumberOfRepetitions );
+    for( unsigned int r = 0; r < this->m_NumberOfRepetitions; ++r )
+    {
+      times[ r ] = 1e9 * Self::Time( function, iterations ) / static_cast< double >( iterations );
+    }
+
+    double mean = 0.0;
+    for( std::size_t r = 0; r < times.size(); ++r )
+    {
+      mean += times[ r ];
+    }
+    mean /= static_cast< double >( times.size() );
+    double variance = 0.0;
+    for( std::size_t r = 0; r < times.size(); ++r )
+    {
+      variance += ( times[ r ] - mean ) * ( times[ r ] - mean );
+    }
+    variance /= static_cast< double >( std::max< std::size_t >( times.size() - 1, 1 ) );
+
+    std::sort( times.begin(), times.end() );
+    const std::size_t half = times.size() / 2;
+    result.m_MedianTime        = times.size() % 2 ? times[ half ] : 0.5 * ( times[ half - 1 ] + times[ half ] );
+    result.m_MeanTime          = mean;
+    result.m_MinimumTime       = times[ 0 ];
+    result.m_StandardDeviation = std::sqrt( variance );
+    result.m_Iterations        = iterations;
+    result.m_Repetitions       = this->m_NumberOfRepetitions;
+    result.m_ItemsPerSecond    = benchmark.m_ItemsPerIteration > 0.0 && result.m_MedianTime > 0.0
+      ? 1e9 * benchmark.m_ItemsPerIteration / result.m_MedianTime : 0.0;
+
+  } // end RunBenchmark()
+
+
+  /** Compose the name, e.g. "Name/size:64/spacing:8/threads:4". */
+  static std::string GetFullName( const BenchmarkType & benchmark, const ThreadIdType threads )
+  {
+    std::ostringstream name;
+    name << benchmark.m_Name;
+    for( std::size_t p = 0; p < benchmark.m_Parameters.size(); ++p )
+    {
+      name << "/" << benchmark.m_Parameters[ p ].first << ":" << benchmark.m_Parameters[ p ].second;
+    }
+    name << "/threads:" << threads;
+    return name.str();
+  }
+
+
+  /** Escape a string for JSON. */
+  static std::string Escape( const std::string & input )
+  {
+    std::string output;
+    for( std::size_t i = 0; i < input.size(); ++i )
+    {
+      if( input[ i ] == '"' || input[ i ] == '\\' )
+      {
+        output += '\\';
+      }
+      output += input[ i ];
+    }
+    return output;
+  }
+
+
+  std::vector< BenchmarkType > m_Benchmarks;
+  ResultListType               m_Results;
+  ThreadListType               m_ThreadList;
+  std::string                  m_Filter;
+  double                       m_MinimumTime;
+  unsigned int                 m_NumberOfRepetitions;
+
+};
+
+} // end namespace itk
+
+#endif // end #ifndef __itkBenchmarkHarness_h
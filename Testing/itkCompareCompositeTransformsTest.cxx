@@ -26,6 +26,9 @@
 #include "itkAdvancedTranslationTransform.h"
 #include "itkAdvancedBSplineDeformableTransform.h"
 #include "itkAdvancedCombinationTransform.h"
+#include "BSplineDeformableTransformWithDiffusion/itkDeformationFieldRegulizer.h"
+
+#include "itkImageRegionIteratorWithIndex.h"
 
 #include <iomanip>
 
@@ -229,6 +232,199 @@ main( int argc, char * argv[] )
     return EXIT_FAILURE;
   }
 
+  // Checks for the flattened initial transform: the chain
+  // translation -> affine -> translation is flattened into a single linear stage
+  AdvancedTranslationTransformType::Pointer translation0 = AdvancedTranslationTransformType::New();
+  AdvancedAffineTransformType::Pointer      affine1      = AdvancedAffineTransformType::New();
+  AdvancedTranslationTransformType::Pointer translation2 = AdvancedTranslationTransformType::New();
+  AdvancedAffineTransformType::Pointer      affine3      = AdvancedAffineTransformType::New();
+
+  AdvancedTranslationTransformType::ParametersType translationParameters( Dimension );
+  AdvancedAffineTransformType::ParametersType      affineParameters( Dimension * ( Dimension + 1 ) );
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    translationParameters[ i ] = 1.5 * i - 2.0;
+  }
+  translation0->SetParameters( translationParameters );
+  translationParameters.Fill( 0.25 );
+  translation2->SetParameters( translationParameters );
+  for( unsigned int i = 0; i < affineParameters.GetSize(); ++i )
+  {
+    affineParameters[ i ] = 0.1 * i;
+  }
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    affineParameters[ i * Dimension + i ] += 1.0;
+  }
+  affine1->SetParameters( affineParameters );
+  affineParameters[ 1 ] = -0.3;
+  affine3->SetParameters( affineParameters );
+
+  AdvancedCombinationTransformType::Pointer combination0 = AdvancedCombinationTransformType::New();
+  AdvancedCombinationTransformType::Pointer combination1 = AdvancedCombinationTransformType::New();
+  AdvancedCombinationTransformType::Pointer combination2 = AdvancedCombinationTransformType::New();
+  AdvancedCombinationTransformType::Pointer combination3 = AdvancedCombinationTransformType::New();
+  combination0->SetCurrentTransform( translation0 );
+  combination1->SetCurrentTransform( affine1 );
+  combination1->SetInitialTransform( combination0 );
+  combination2->SetCurrentTransform( translation2 );
+  combination2->SetInitialTransform( combination1 );
+  combination3->SetCurrentTransform( affine3 );
+  combination3->SetInitialTransform( combination2 );
+
+  std::vector< AdvancedCombinationTransformType::InputPointType > inputPoints( 10 );
+  std::vector< AdvancedCombinationTransformType::OutputPointType > expectedPoints( 10 );
+  for( unsigned int k = 0; k < inputPoints.size(); ++k )
+  {
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      inputPoints[ k ][ i ] = 3.0 * k - 7.0 * i;
+    }
+    expectedPoints[ k ] = combination3->TransformPoint( inputPoints[ k ] );
+  }
+
+  combination3->UpdateFlattenedInitialTransform();
+  if( combination3->GetNumberOfFlattenedInitialTransformStages() != 1 )
+  {
+    std::cerr << "Error expecting a single linear stage in the flattened initial transform." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector< AdvancedCombinationTransformType::OutputPointType > outputPoints;
+  combination3->TransformPoints( inputPoints, outputPoints );
+  for( unsigned int k = 0; k < inputPoints.size(); ++k )
+  {
+    const AdvancedCombinationTransformType::OutputPointType outputPoint
+      = combination3->TransformPoint( inputPoints[ k ] );
+    if( expectedPoints[ k ].EuclideanDistanceTo( outputPoint ) > 1e-3
+      || expectedPoints[ k ].EuclideanDistanceTo( outputPoints[ k ] ) > 1e-3 )
+    {
+      std::cerr << "Error in the flattened initial transform: expected "
+                << expectedPoints[ k ] << ", got " << outputPoint
+                << " and " << outputPoints[ k ] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Checks for the displacement field that replaces the initial transform:
+  // it is exact for a linear initial transform, also outside the field
+  typedef AdvancedCombinationTransformType::InitialTransformDisplacementFieldType DisplacementFieldType;
+  DisplacementFieldType::Pointer displacementField = DisplacementFieldType::New();
+  DisplacementFieldType::SizeType fieldSize;
+  fieldSize.Fill( 5 );
+  DisplacementFieldType::SpacingType fieldSpacing;
+  fieldSpacing.Fill( 5.0 );
+  DisplacementFieldType::PointType fieldOrigin;
+  fieldOrigin.Fill( -10.0 );
+  displacementField->SetRegions( fieldSize );
+  displacementField->SetSpacing( fieldSpacing );
+  displacementField->SetOrigin( fieldOrigin );
+  displacementField->Allocate();
+  itk::ImageRegionIteratorWithIndex< DisplacementFieldType > fieldIt(
+    displacementField, displacementField->GetLargestPossibleRegion() );
+  for( fieldIt.GoToBegin(); !fieldIt.IsAtEnd(); ++fieldIt )
+  {
+    DisplacementFieldType::PointType fieldPoint;
+    displacementField->TransformIndexToPhysicalPoint( fieldIt.GetIndex(), fieldPoint );
+    AdvancedCombinationTransformType::InputPointType point;
+    point.CastFrom( fieldPoint );
+    fieldIt.Set( combination2->TransformPoint( point ) - point );
+  }
+
+  combination3->SetInitialTransformDisplacementField( displacementField );
+  for( unsigned int k = 0; k < inputPoints.size(); ++k )
+  {
+    const AdvancedCombinationTransformType::OutputPointType outputPoint
+      = combination3->TransformPoint( inputPoints[ k ] );
+    if( expectedPoints[ k ].EuclideanDistanceTo( outputPoint ) > 1e-3 )
+    {
+      std::cerr << "Error in the displacement field of the initial transform: expected "
+                << expectedPoints[ k ] << ", got " << outputPoint << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Checks for a subclass of the combination transform in the chain: the
+  // DeformationFieldRegulizer adds a deformation field in TransformPoint(),
+  // so it must not be flattened into its initial and current transform
+  typedef itk::DeformationFieldRegulizer< AdvancedCombinationTransformType > RegulizerTransformType;
+  typedef RegulizerTransformType::VectorImageType                            VectorImageType;
+  RegulizerTransformType::Pointer regulizer = RegulizerTransformType::New();
+  regulizer->SetCurrentTransform( affine1 );
+  regulizer->SetInitialTransform( combination0 );
+  VectorImageType::SizeType vectorFieldSize;
+  vectorFieldSize.Fill( 12 );
+  VectorImageType::SpacingType vectorFieldSpacing;
+  vectorFieldSpacing.Fill( 5.0 );
+  VectorImageType::PointType vectorFieldOrigin;
+  vectorFieldOrigin.Fill( -20.0 );
+  regulizer->SetDeformationFieldRegion( VectorImageType::RegionType( vectorFieldSize ) );
+  regulizer->SetDeformationFieldSpacing( vectorFieldSpacing );
+  regulizer->SetDeformationFieldOrigin( vectorFieldOrigin );
+  regulizer->InitializeDeformationFields();
+
+  VectorImageType::Pointer vectorField = VectorImageType::New();
+  vectorField->SetRegions( VectorImageType::RegionType( vectorFieldSize ) );
+  vectorField->SetSpacing( vectorFieldSpacing );
+  vectorField->SetOrigin( vectorFieldOrigin );
+  vectorField->Allocate();
+  itk::ImageRegionIteratorWithIndex< VectorImageType > vectorFieldIt(
+    vectorField, vectorField->GetLargestPossibleRegion() );
+  for( vectorFieldIt.GoToBegin(); !vectorFieldIt.IsAtEnd(); ++vectorFieldIt )
+  {
+    VectorImageType::PixelType displacement;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      displacement[ i ] = 1.0 + 0.2 * vectorFieldIt.GetIndex()[ ( i + 1 ) % Dimension ];
+    }
+    vectorFieldIt.Set( displacement );
+  }
+  regulizer->UpdateIntermediaryDeformationFieldTransform( vectorField );
+
+  AdvancedCombinationTransformType::Pointer combination4 = AdvancedCombinationTransformType::New();
+  combination4->SetCurrentTransform( translation2 );
+  combination4->SetInitialTransform( regulizer );
+
+  std::vector< AdvancedCombinationTransformType::OutputPointType > regulizerPoints( inputPoints.size() );
+  for( unsigned int k = 0; k < inputPoints.size(); ++k )
+  {
+    regulizerPoints[ k ] = regulizer->TransformPoint( inputPoints[ k ] );
+    expectedPoints[ k ]  = translation2->TransformPoint( regulizerPoints[ k ] );
+    if( regulizerPoints[ k ].EuclideanDistanceTo( affine1->TransformPoint(
+      translation0->TransformPoint( inputPoints[ k ] ) ) ) < 0.5 )
+    {
+      std::cerr << "Error: the deformation field of the DeformationFieldRegulizer has no effect." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  combination4->UpdateFlattenedInitialTransform();
+  regulizer->UpdateFlattenedInitialTransform();
+  if( combination4->GetNumberOfFlattenedInitialTransformStages() != 1 )
+  {
+    std::cerr << "Error expecting the DeformationFieldRegulizer as a single stage." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector< AdvancedCombinationTransformType::OutputPointType > regulizerOutputPoints;
+  combination4->TransformPoints( inputPoints, outputPoints );
+  regulizer->TransformPoints( inputPoints, regulizerOutputPoints );
+  for( unsigned int k = 0; k < inputPoints.size(); ++k )
+  {
+    const AdvancedCombinationTransformType::OutputPointType outputPoint
+      = combination4->TransformPoint( inputPoints[ k ] );
+    if( expectedPoints[ k ].EuclideanDistanceTo( outputPoint ) > 1e-3
+      || expectedPoints[ k ].EuclideanDistanceTo( outputPoints[ k ] ) > 1e-3
+      || regulizerPoints[ k ].EuclideanDistanceTo( regulizerOutputPoints[ k ] ) > 1e-3 )
+    {
+      std::cerr << "Error in the flattened initial transform with a DeformationFieldRegulizer: expected "
+                << expectedPoints[ k ] << ", got " << outputPoint << " and " << outputPoints[ k ]
+                << "; expected " << regulizerPoints[ k ] << " from the DeformationFieldRegulizer, got "
+                << regulizerOutputPoints[ k ] << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   /** Return a value. */
   return EXIT_SUCCESS;
 } // end main
@@ -0,0 +1,358 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the concurrent evaluation of the CMAEvolutionStrategy and
+ FullSearch optimizers with their single-threaded evaluation.
+
+ Both optimizers may evaluate their cost function concurrently, with one cost
+ function per worker. The result must not depend on that: with the same seed,
+ the same positions and values must be found, also when some evaluations fail.
+ */
+
+#include "CMAEvolutionStrategy/itkCMAEvolutionStrategyOptimizer.h"
+#include "FullSearch/itkFullSearchOptimizer.h"
+
+#include "itkSingleValuedCostFunction.h"
+#include "itkCommand.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <iostream>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+/** A quadratic cost function, which throws an itk::ExceptionObject for
+ * positions with a first parameter above a threshold.
+ */
+class QuadraticCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+
+  typedef QuadraticCostFunction          Self;
+  typedef itk::SingleValuedCostFunction  Superclass;
+  typedef itk::SmartPointer< Self >      Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+  itkNewMacro( Self );
+  itkTypeMacro( QuadraticCostFunction, SingleValuedCostFunction );
+
+  typedef Superclass::MeasureType    MeasureType;
+  typedef Superclass::ParametersType ParametersType;
+  typedef Superclass::DerivativeType DerivativeType;
+
+  itkSetMacro( NumberOfParameters, unsigned int );
+  itkSetMacro( FailureThreshold, double );
+
+  unsigned int GetNumberOfParameters( void ) const override
+  {
+    return this->m_NumberOfParameters;
+  }
+
+
+  MeasureType GetValue( const ParametersType & parameters ) const override
+  {
+    if( parameters[ 0 ] > this->m_FailureThreshold )
+    {
+      itkExceptionMacro( << "Position outside the domain." );
+    }
+    MeasureType value = 0.0;
+    for( unsigned int i = 0; i < this->m_NumberOfParameters; ++i )
+    {
+      const double d = parameters[ i ] - 0.5 * i;
+      value += ( i + 1.0 ) * d * d;
+    }
+    return value;
+  }
+
+
+  void GetDerivative( const ParametersType & parameters,
+    DerivativeType & derivative ) const override
+  {
+    derivative.SetSize( this->m_NumberOfParameters );
+    for( unsigned int i = 0; i < this->m_NumberOfParameters; ++i )
+    {
+      derivative[ i ] = 2.0 * ( i + 1.0 ) * ( parameters[ i ] - 0.5 * i );
+    }
+  }
+
+
+protected:
+
+  QuadraticCostFunction()
+  {
+    this->m_NumberOfParameters = 4;
+    this->m_FailureThreshold   = itk::NumericTraits< double >::max();
+  }
+
+
+  ~QuadraticCostFunction() override {}
+
+private:
+
+  unsigned int m_NumberOfParameters;
+  double       m_FailureThreshold;
+
+};
+
+//-------------------------------------------------------------------------------------
+
+/** Record the value of every iteration of a FullSearchOptimizer. */
+class FullSearchIterationRecorder : public itk::Command
+{
+public:
+
+  typedef FullSearchIterationRecorder Self;
+  typedef itk::Command                Superclass;
+  typedef itk::SmartPointer< Self >   Pointer;
+  itkNewMacro( Self );
+
+  void Execute( itk::Object * caller, const itk::EventObject & event ) override
+  {
+    this->Execute( static_cast< const itk::Object * >( caller ), event );
+  }
+
+
+  void Execute( const itk::Object * caller, const itk::EventObject & event ) override
+  {
+    if( !itk::IterationEvent().CheckEvent( &event ) )
+    {
+      return;
+    }
+    const itk::FullSearchOptimizer * optimizer
+      = dynamic_cast< const itk::FullSearchOptimizer * >( caller );
+    this->m_Values.push_back( optimizer->GetValue() );
+  }
+
+
+  std::vector< double > m_Values;
+
+};
+
+//-------------------------------------------------------------------------------------
+
+/** Run the CMAEvolutionStrategyOptimizer with the given number of population
+ * cost functions; zero means single-threaded.
+ */
+bool
+RunCMAEvolutionStrategy( const unsigned int numberOfWorkers, const double failureThreshold,
+  itk::CMAEvolutionStrategyOptimizer::ParametersType & position,
+  double & value, unsigned long & numberOfIterations )
+{
+  typedef itk::CMAEvolutionStrategyOptimizer OptimizerType;
+  typedef OptimizerType::ParametersType      ParametersType;
+
+  const unsigned int numberOfParameters = 4;
+
+  QuadraticCostFunction::Pointer costFunction = QuadraticCostFunction::New();
+  costFunction->SetNumberOfParameters( numberOfParameters );
+  costFunction->SetFailureThreshold( failureThreshold );
+
+  OptimizerType::CostFunctionContainerType populationCostFunctions;
+  for( unsigned int i = 0; i < numberOfWorkers; ++i )
+  {
+    QuadraticCostFunction::Pointer workerCostFunction = QuadraticCostFunction::New();
+    workerCostFunction->SetNumberOfParameters( numberOfParameters );
+    workerCostFunction->SetFailureThreshold( failureThreshold );
+    populationCostFunctions.push_back( workerCostFunction.GetPointer() );
+  }
+
+  ParametersType initialPosition( numberOfParameters );
+  initialPosition.Fill( 1.0 );
+  OptimizerType::ScalesType scales( numberOfParameters );
+  scales.Fill( 1.0 );
+
+  OptimizerType::Pointer optimizer = OptimizerType::New();
+  optimizer->SetCostFunction( costFunction );
+  optimizer->SetInitialPosition( initialPosition );
+  optimizer->SetScales( scales );
+  optimizer->SetMaximumNumberOfIterations( 50 );
+  optimizer->SetPopulationSize( 12 );
+  optimizer->SetInitialSigma( 1.0 );
+  optimizer->SetPopulationCostFunctions( populationCostFunctions );
+  optimizer->SetUseParallelPopulationEvaluation( numberOfWorkers > 0 );
+
+  /** The same seed for every run. */
+  itk::Statistics::MersenneTwisterRandomVariateGenerator::GetInstance()->Initialize( 121212 );
+
+  try
+  {
+    optimizer->StartOptimization();
+  }
+  catch( itk::ExceptionObject & err )
+  {
+    std::cerr << "ERROR: the CMAEvolutionStrategyOptimizer threw an exception:\n" << err << std::endl;
+    return false;
+  }
+
+  position           = optimizer->GetCurrentPosition();
+  value              = optimizer->GetCurrentValue();
+  numberOfIterations = optimizer->GetCurrentIteration();
+  return true;
+
+} // end RunCMAEvolutionStrategy()
+
+
+/** Run the FullSearchOptimizer with the given number of search cost
+ * functions; zero means single-threaded.
+ */
+bool
+RunFullSearch( const unsigned int numberOfWorkers, const double failureThreshold,
+  std::vector< double > & values, itk::FullSearchOptimizer::SearchSpaceIndexType & bestIndex,
+  bool & threwMetricError )
+{
+  typedef itk::FullSearchOptimizer      OptimizerType;
+  typedef OptimizerType::ParametersType ParametersType;
+
+  const unsigned int numberOfParameters = 3;
+
+  QuadraticCostFunction::Pointer costFunction = QuadraticCostFunction::New();
+  costFunction->SetNumberOfParameters( numberOfParameters );
+  costFunction->SetFailureThreshold( failureThreshold );
+
+  OptimizerType::CostFunctionContainerType searchCostFunctions;
+  for( unsigned int i = 0; i < numberOfWorkers; ++i )
+  {
+    QuadraticCostFunction::Pointer workerCostFunction = QuadraticCostFunction::New();
+    workerCostFunction->SetNumberOfParameters( numberOfParameters );
+    workerCostFunction->SetFailureThreshold( failureThreshold );
+    searchCostFunctions.push_back( workerCostFunction.GetPointer() );
+  }
+
+  ParametersType initialPosition( numberOfParameters );
+  initialPosition.Fill( 0.0 );
+
+  OptimizerType::Pointer optimizer = OptimizerType::New();
+  optimizer->SetCostFunction( costFunction );
+  optimizer->SetInitialPosition( initialPosition );
+  optimizer->AddSearchDimension( 0, -1.0, 1.0, 0.25 );
+  optimizer->AddSearchDimension( 2, -1.0, 2.0, 0.5 );
+  optimizer->SetSearchCostFunctions( searchCostFunctions );
+  optimizer->SetUseParallelSearchSpaceEvaluation( numberOfWorkers > 0 );
+
+  FullSearchIterationRecorder::Pointer recorder = FullSearchIterationRecorder::New();
+  optimizer->AddObserver( itk::IterationEvent(), recorder );
+
+  threwMetricError = false;
+  try
+  {
+    optimizer->StartOptimization();
+  }
+  catch( itk::ExceptionObject & )
+  {
+    threwMetricError = optimizer->GetStopCondition() == OptimizerType::MetricError;
+    if( !threwMetricError )
+    {
+      std::cerr << "ERROR: the FullSearchOptimizer threw without a MetricError." << std::endl;
+      return false;
+    }
+  }
+
+  values    = recorder->m_Values;
+  bestIndex = optimizer->GetBestIndexInSearchSpace();
+  return true;
+
+} // end RunFullSearch()
+
+
+int
+main( int argc, char ** argv )
+{
+  const double       noFailures = itk::NumericTraits< double >::max();
+  const unsigned int workers[]  = { 2, 3, 8 };
+
+  /** The CMAEvolutionStrategyOptimizer, with and without failing evaluations. */
+  const double cmaThresholds[] = { noFailures, 1.8 };
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    itk::CMAEvolutionStrategyOptimizer::ParametersType serialPosition;
+    double                                             serialValue      = 0.0;
+    unsigned long                                      serialIterations = 0;
+    if( !RunCMAEvolutionStrategy( 0, cmaThresholds[ t ], serialPosition, serialValue, serialIterations ) )
+    {
+      return EXIT_FAILURE;
+    }
+    std::cout << "CMAEvolutionStrategy, single-threaded: value " << serialValue
+              << " after " << serialIterations << " iterations, position " << serialPosition << std::endl;
+
+    for( unsigned int w = 0; w < 3; ++w )
+    {
+      itk::CMAEvolutionStrategyOptimizer::ParametersType position;
+      double                                             value      = 0.0;
+      unsigned long                                      iterations = 0;
+      itk::TimeProbe                                     timer;
+      timer.Start();
+      if( !RunCMAEvolutionStrategy( workers[ w ], cmaThresholds[ t ], position, value, iterations ) )
+      {
+        return EXIT_FAILURE;
+      }
+      timer.Stop();
+      std::cout << "CMAEvolutionStrategy, " << workers[ w ] << " workers: value " << value
+                << " after " << iterations << " iterations, time " << timer.GetMean() << " s" << std::endl;
+
+      if( value != serialValue || iterations != serialIterations || position != serialPosition )
+      {
+        std::cerr << "ERROR: the concurrent CMAEvolutionStrategyOptimizer gives another result "
+                  << "than the single-threaded one: position " << position << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  /** The FullSearchOptimizer, with and without a failing evaluation. */
+  const double fullSearchThresholds[] = { noFailures, 0.6 };
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    std::vector< double >                         serialValues;
+    itk::FullSearchOptimizer::SearchSpaceIndexType serialBestIndex;
+    bool                                          serialThrew = false;
+    if( !RunFullSearch( 0, fullSearchThresholds[ t ], serialValues, serialBestIndex, serialThrew ) )
+    {
+      return EXIT_FAILURE;
+    }
+    std::cout << "FullSearch, single-threaded: " << serialValues.size() << " iterations, best index "
+              << serialBestIndex << ( serialThrew ? ", stopped by a MetricError" : "" ) << std::endl;
+    if( serialThrew != ( t == 1 ) )
+    {
+      std::cerr << "ERROR: unexpected MetricError in the single-threaded FullSearchOptimizer." << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    for( unsigned int w = 0; w < 3; ++w )
+    {
+      std::vector< double >                         values;
+      itk::FullSearchOptimizer::SearchSpaceIndexType bestIndex;
+      bool                                          threw = false;
+      if( !RunFullSearch( workers[ w ], fullSearchThresholds[ t ], values, bestIndex, threw ) )
+      {
+        return EXIT_FAILURE;
+      }
+      std::cout << "FullSearch, " << workers[ w ] << " workers: " << values.size()
+                << " iterations, best index " << bestIndex << std::endl;
+
+      if( values != serialValues || bestIndex != serialBestIndex || threw != serialThrew )
+      {
+        std::cerr << "ERROR: the concurrent FullSearchOptimizer gives another result "
+                  << "than the single-threaded one." << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
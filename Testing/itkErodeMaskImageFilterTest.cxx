@@ -0,0 +1,242 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the ErodeMaskImageFilter with the ParabolicErodeImageFilter.
+
+ The ErodeMaskImageFilter used to run a ParabolicErodeImageFilter for the
+ current resolution level. The bit-packed erosion should give the same mask,
+ for all levels, for fixed and moving masks.
+
+ As in the registration, the output of every level is taken over in an image
+ of its own, which must not change when the next levels are computed. The
+ ImageMaskLookup of a BitPackedImageMaskSpatialObject with the bit mask of a
+ level should agree with the lookup built from the pixels of that level.
+ */
+
+#include "itkErodeMaskImageFilter.h"
+#include "itkBitPackedImageMaskSpatialObject.h"
+#include "itkImageMaskLookup.h"
+#include "itkParabolicErodeImageFilter.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestErodeMask( void )
+{
+  typedef itk::Image< unsigned char, Dimension >  MaskImageType;
+  typedef typename MaskImageType::SizeType        SizeType;
+  typedef typename MaskImageType::IndexType       IndexType;
+  typedef typename MaskImageType::RegionType      RegionType;
+  typedef itk::ErodeMaskImageFilter< MaskImageType > ErodeFilterType;
+  typedef typename ErodeFilterType::ScheduleType  ScheduleType;
+  typedef itk::ParabolicErodeImageFilter<
+    MaskImageType, MaskImageType >                ParabolicErodeFilterType;
+  typedef typename ParabolicErodeFilterType::RadiusType ParabolicRadiusType;
+  typedef itk::ImageMaskSpatialObject< Dimension >          MaskSpatialObjectType;
+  typedef itk::BitPackedImageMaskSpatialObject< Dimension > BitPackedMaskSpatialObjectType;
+  typedef itk::ImageMaskLookup< Dimension >                 MaskLookupType;
+
+  typedef itk::ImageRegionIterator< MaskImageType >              IteratorType;
+  typedef itk::ImageRegionConstIterator< MaskImageType >         ConstIteratorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->Initialize( 565656 );
+
+  /** Create a mask of a few random boxes, with a size that is not a
+   * multiple of the word size, and some random holes.
+   */
+  SizeType size;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    size[ i ] = 70 + 13 * i;
+  }
+
+  typename MaskImageType::Pointer mask = MaskImageType::New();
+  mask->SetRegions( RegionType( size ) );
+  mask->Allocate();
+  mask->FillBuffer( 0 );
+
+  for( unsigned int box = 0; box < 4; ++box )
+  {
+    IndexType index;
+    SizeType  boxSize;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      index[ i ]   = randomNum->GetIntegerVariate( size[ i ] / 2 );
+      boxSize[ i ] = 1 + randomNum->GetIntegerVariate( size[ i ] - index[ i ] - 1 );
+    }
+    IteratorType it( mask, RegionType( index, boxSize ) );
+    for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+      it.Set( randomNum->GetUniformVariate( 0.0, 1.0 ) < 0.995 ? 1 : 0 );
+    }
+  }
+
+  /** A schedule that is not the same in all dimensions. */
+  const unsigned int numberOfLevels = 4;
+  ScheduleType       schedule( numberOfLevels, Dimension );
+  for( unsigned int level = 0; level < numberOfLevels; ++level )
+  {
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      schedule[ level ][ i ] = ( 1u << ( numberOfLevels - 1 - level ) ) + ( i == 1 ? 1 : 0 );
+    }
+  }
+
+  for( unsigned int moving = 0; moving < 2; ++moving )
+  {
+    /** One filter for all levels, as in the registration. */
+    typename ErodeFilterType::Pointer erosion = ErodeFilterType::New();
+    erosion->SetInput( mask );
+    erosion->SetSchedule( schedule );
+    erosion->SetIsMovingMask( moving == 1 );
+
+    std::vector< typename MaskImageType::Pointer > levelMasks( numberOfLevels );
+    std::vector< typename MaskImageType::Pointer > references( numberOfLevels );
+    for( unsigned int level = 0; level < numberOfLevels; ++level )
+    {
+      erosion->SetResolutionLevel( level );
+      itk::TimeProbe timer;
+      timer.Start();
+      erosion->Update();
+      timer.Stop();
+
+      /** The reference: the parabolic erosion with the same radius. */
+      ParabolicRadiusType radius;
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        const double r = moving == 1 ? 2.0 * schedule[ level ][ i ] + 1.0 : schedule[ level ][ i ] + 1.0;
+        radius[ i ] = r * r / 2.0 + 1.0;
+      }
+      typename ParabolicErodeFilterType::Pointer parabolic = ParabolicErodeFilterType::New();
+      parabolic->SetUseImageSpacing( false );
+      parabolic->SetScale( radius );
+      parabolic->SetInput( mask );
+      itk::TimeProbe parabolicTimer;
+      parabolicTimer.Start();
+      parabolic->Update();
+      parabolicTimer.Stop();
+
+      ConstIteratorType eit( erosion->GetOutput(), erosion->GetOutput()->GetLargestPossibleRegion() );
+      ConstIteratorType pit( parabolic->GetOutput(), parabolic->GetOutput()->GetLargestPossibleRegion() );
+      unsigned long numberOfDifferences = 0;
+      unsigned long numberOfVoxelsInside = 0;
+      for( eit.GoToBegin(), pit.GoToBegin(); !eit.IsAtEnd(); ++eit, ++pit )
+      {
+        numberOfDifferences  += ( eit.Get() != 0 ) != ( pit.Get() != 0 ) ? 1 : 0;
+        numberOfVoxelsInside += eit.Get() != 0 ? 1 : 0;
+      }
+
+      std::cout << Dimension << "D, " << ( moving == 1 ? "moving" : "fixed" )
+                << " mask, level " << level << ": " << numberOfVoxelsInside
+                << " voxels inside, " << numberOfDifferences << " differences, time "
+                << timer.GetMean() << " s (bit-packed) vs "
+                << parabolicTimer.GetMean() << " s (parabolic)." << std::endl;
+      if( numberOfDifferences != 0 )
+      {
+        std::cerr << "ERROR: the eroded mask differs from the ParabolicErodeImageFilter." << std::endl;
+        return false;
+      }
+
+      /** The lookup from the bit mask of this level, and the one from its pixels. */
+      typename BitPackedMaskSpatialObjectType::Pointer bitPackedMask = BitPackedMaskSpatialObjectType::New();
+      bitPackedMask->SetImage( erosion->GetOutput() );
+      bitPackedMask->SetBitMask( erosion->GetBitMask( level ), erosion->GetNumberOfWordsPerLine() );
+      bitPackedMask->Update();
+      typename MaskSpatialObjectType::Pointer pixelMask = MaskSpatialObjectType::New();
+      pixelMask->SetImage( erosion->GetOutput() );
+      pixelMask->Update();
+
+      typename MaskLookupType::Pointer bitLookup   = MaskLookupType::New();
+      typename MaskLookupType::Pointer pixelLookup = MaskLookupType::New();
+      bitLookup->SetMask( bitPackedMask );
+      bitLookup->Update();
+      pixelLookup->SetMask( pixelMask );
+      pixelLookup->Update();
+      if( !bitPackedMask->HasValidBitMask()
+        || bitLookup->GetBoundingBoxRegion() != pixelLookup->GetBoundingBoxRegion() )
+      {
+        std::cerr << "ERROR: the bounding box of the bit mask differs from that of the pixels." << std::endl;
+        return false;
+      }
+      typename MaskSpatialObjectType::PointType point;
+      for( eit.GoToBegin(); !eit.IsAtEnd(); ++eit )
+      {
+        erosion->GetOutput()->TransformIndexToPhysicalPoint( eit.GetIndex(), point );
+        point[ 0 ] += 0.3;
+        if( bitLookup->IsInside( point ) != pixelLookup->IsInside( point ) )
+        {
+          std::cerr << "ERROR: the lookup of the bit mask differs from that of the pixels." << std::endl;
+          return false;
+        }
+      }
+
+      /** Take the output over, as the registration does. */
+      levelMasks[ level ] = MaskImageType::New();
+      levelMasks[ level ]->Graft( erosion->GetOutput() );
+      erosion->GetOutput()->ReleaseData();
+      erosion->Modified();
+      references[ level ] = parabolic->GetOutput();
+    }
+
+    /** The masks of the earlier levels are still intact. */
+    for( unsigned int level = 0; level < numberOfLevels; ++level )
+    {
+      ConstIteratorType lit( levelMasks[ level ], levelMasks[ level ]->GetLargestPossibleRegion() );
+      ConstIteratorType rit( references[ level ], references[ level ]->GetLargestPossibleRegion() );
+      for( lit.GoToBegin(), rit.GoToBegin(); !lit.IsAtEnd(); ++lit, ++rit )
+      {
+        if( ( lit.Get() != 0 ) != ( rit.Get() != 0 ) )
+        {
+          std::cerr << "ERROR: the mask of level " << level
+                    << " changed while the later levels were computed." << std::endl;
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+
+} // end TestErodeMask()
+
+
+int
+main( int argc, char ** argv )
+{
+  // 2D tests
+  bool success = TestErodeMask< 2 >();
+  if( !success ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  success = TestErodeMask< 3 >();
+  if( !success ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+} // end main
@@ -0,0 +1,271 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the multi-threaded finite difference derivative of the
+ PatternIntensity and GradientDifference metrics with the single-threaded one.
+
+ A small random volume is projected on a detector by a ray caster, through a
+ rigid transform. The derivative computed with several threads, each with its
+ own copy of the projection pipeline, should then equal the one computed with
+ a single thread. By default, the derivative should be single-threaded.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "GradientDifference/itkGradientDifferenceImageToImageMetric2.h"
+#include "PatternIntensity/itkPatternIntensityImageToImageMetric.h"
+
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedEuler3DTransform.h"
+#include "itkAdvancedRayCastInterpolateImageFunction.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkResampleImageFilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+/** Some basic type definitions. */
+const unsigned int Dimension = 3;
+typedef itk::Image< float, Dimension >                                  ImageType;
+typedef itk::AdvancedEuler3DTransform< double >                         EulerTransformType;
+typedef itk::AdvancedCombinationTransform< double, Dimension >          CombinationTransformType;
+typedef itk::AdvancedRayCastInterpolateImageFunction< ImageType, double > RayCastInterpolatorType;
+typedef itk::ResampleImageFilter< ImageType, ImageType, double >        ResampleFilterType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator          RandomGeneratorType;
+typedef CombinationTransformType::ParametersType                        ParametersType;
+
+/** Compute the derivative of the metric, with the given number of derivative
+ * threads. With 0 threads, the metric uses its work units.
+ */
+template< class TMetric >
+bool
+ComputeDerivative( ImageType * fixedImage, ImageType * movingImage,
+  CombinationTransformType * transform, RayCastInterpolatorType * rayCaster,
+  const ParametersType & parameters, const unsigned int numberOfDerivativeThreads,
+  typename TMetric::DerivativeType & derivative )
+{
+  typename TMetric::ScalesType scales( parameters.GetSize() );
+  for( unsigned int i = 0; i < scales.GetSize(); ++i )
+  {
+    /** The rotations are scaled, as the Euler transform of elastix does. */
+    scales[ i ] = i < 3 ? 100.0 : 1.0;
+  }
+
+  /** Initialize() evaluates the metric at the current parameters. */
+  transform->SetParameters( parameters );
+
+  typename TMetric::Pointer metric = TMetric::New();
+  if( metric->GetNumberOfDerivativeThreads() != 1 )
+  {
+    std::cerr << "ERROR: the default number of derivative threads is "
+              << metric->GetNumberOfDerivativeThreads() << " instead of 1." << std::endl;
+    return false;
+  }
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( rayCaster );
+  metric->SetScales( scales );
+  metric->SetUseMultiThread( true );
+  metric->SetNumberOfWorkUnits( 4 );
+  metric->SetNumberOfDerivativeThreads( numberOfDerivativeThreads );
+  metric->Initialize();
+
+  metric->GetDerivative( parameters, derivative );
+  return true;
+
+} // end ComputeDerivative()
+
+
+// Test function templated over the metric
+template< class TMetric >
+bool
+TestDerivativeThreading( const char * name, ImageType * fixedImage, ImageType * movingImage,
+  CombinationTransformType * transform, RayCastInterpolatorType * rayCaster,
+  const ParametersType & parameters )
+{
+  typename TMetric::DerivativeType reference;
+  if( !ComputeDerivative< TMetric >( fixedImage, movingImage, transform, rayCaster,
+    parameters, 1, reference ) )
+  {
+    return false;
+  }
+
+  double maximumValue = 0.0;
+  for( unsigned int i = 0; i < reference.GetSize(); ++i )
+  {
+    maximumValue = std::max( maximumValue, std::abs( reference[ i ] ) );
+  }
+  std::cout << std::setprecision( 12 ) << name << ", 1 thread: derivative " << reference << std::endl;
+  if( !( maximumValue > 0.0 ) )
+  {
+    std::cerr << "ERROR: the " << name << " derivative is zero." << std::endl;
+    return false;
+  }
+
+  /** 0 threads uses the 4 work units; 12 threads is more than the 2 * P evaluations. */
+  const unsigned int numberOfDerivativeThreads[] = { 2, 3, 0, 12 };
+  for( unsigned int t = 0; t < 4; ++t )
+  {
+    typename TMetric::DerivativeType derivative;
+    if( !ComputeDerivative< TMetric >( fixedImage, movingImage, transform, rayCaster,
+      parameters, numberOfDerivativeThreads[ t ], derivative ) )
+    {
+      return false;
+    }
+
+    double maximumError = 0.0;
+    for( unsigned int i = 0; i < reference.GetSize(); ++i )
+    {
+      maximumError = std::max( maximumError, std::abs( derivative[ i ] - reference[ i ] ) );
+    }
+
+    std::cout << name << ", " << numberOfDerivativeThreads[ t ] << " thread(s): maximum difference "
+              << maximumError << std::endl;
+    if( !( maximumError <= 1e-12 * maximumValue ) )
+    {
+      std::cerr << "ERROR: the " << name << " derivative with " << numberOfDerivativeThreads[ t ]
+                << " thread(s) differs from the single-threaded one." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+
+} // end TestDerivativeThreading()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 343434 );
+
+  /** A small volume with a bright blob and random intensities. */
+  ImageType::SizeType size;
+  size[ 0 ] = 20;
+  size[ 1 ] = 18;
+  size[ 2 ] = 16;
+  ImageType::SpacingType spacing;
+  spacing.Fill( 1.5 );
+  ImageType::PointType origin;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    origin[ i ] = -0.5 * spacing[ i ] * ( size[ i ] - 1 );
+  }
+  ImageType::Pointer movingImage = ImageType::New();
+  movingImage->SetRegions( ImageType::RegionType( size ) );
+  movingImage->SetSpacing( spacing );
+  movingImage->SetOrigin( origin );
+  movingImage->Allocate();
+  itk::ImageRegionIterator< ImageType > it( movingImage, movingImage->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    ImageType::PointType point;
+    movingImage->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    const double r2 = point[ 0 ] * point[ 0 ] + 2.0 * point[ 1 ] * point[ 1 ] + point[ 2 ] * point[ 2 ];
+    it.Set( static_cast< float >( 300.0 * std::exp( -r2 / 50.0 ) + random->GetUniformVariate( 0.0, 50.0 ) ) );
+  }
+
+  /** A rigid transform, as the current transform of a combination transform. */
+  EulerTransformType::Pointer eulerTransform = EulerTransformType::New();
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( eulerTransform );
+
+  /** The ray caster, with the focal point in front of the volume. */
+  RayCastInterpolatorType::PointType focalPoint;
+  focalPoint[ 0 ] = 0.5;
+  focalPoint[ 1 ] = -1.0;
+  focalPoint[ 2 ] = -100.0;
+  RayCastInterpolatorType::Pointer rayCaster = RayCastInterpolatorType::New();
+  rayCaster->SetTransform( transform );
+  rayCaster->SetFocalPoint( focalPoint );
+  rayCaster->SetThreshold( 20.0 );
+
+  /** The fixed image: the projection at slightly different parameters, on a
+   * detector of one slice at z = 50.
+   */
+  ParametersType fixedParameters( transform->GetNumberOfParameters() );
+  fixedParameters.Fill( 0.0 );
+  fixedParameters[ 0 ] = 0.02;
+  fixedParameters[ 4 ] = 1.0;
+  transform->SetParameters( fixedParameters );
+
+  ImageType::SizeType detectorSize;
+  detectorSize[ 0 ] = 24;
+  detectorSize[ 1 ] = 20;
+  detectorSize[ 2 ] = 1;
+  ImageType::SpacingType detectorSpacing;
+  detectorSpacing.Fill( 2.0 );
+  ImageType::PointType detectorOrigin;
+  detectorOrigin[ 0 ] = -0.5 * detectorSpacing[ 0 ] * ( detectorSize[ 0 ] - 1 );
+  detectorOrigin[ 1 ] = -0.5 * detectorSpacing[ 1 ] * ( detectorSize[ 1 ] - 1 );
+  detectorOrigin[ 2 ] = 50.0;
+
+  ResampleFilterType::Pointer projector = ResampleFilterType::New();
+  projector->SetInput( movingImage );
+  projector->SetTransform( transform );
+  projector->SetInterpolator( rayCaster );
+  projector->SetSize( detectorSize );
+  projector->SetOutputSpacing( detectorSpacing );
+  projector->SetOutputOrigin( detectorOrigin );
+  projector->SetDefaultPixelValue( 0.0 );
+  projector->Update();
+  ImageType::Pointer fixedImage = projector->GetOutput();
+  fixedImage->DisconnectPipeline();
+
+  /** The parameters at which the derivative is computed. */
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  parameters[ 0 ] = 0.05;
+  parameters[ 1 ] = -0.03;
+  parameters[ 2 ] = 0.04;
+  parameters[ 3 ] = 1.5;
+  parameters[ 4 ] = -0.5;
+  parameters[ 5 ] = 2.0;
+
+  typedef itk::PatternIntensityImageToImageMetric< ImageType, ImageType >   PatternIntensityMetricType;
+  typedef itk::GradientDifferenceImageToImageMetric< ImageType, ImageType > GradientDifferenceMetricType;
+  if( !TestDerivativeThreading< PatternIntensityMetricType >( "PatternIntensity",
+    fixedImage, movingImage, transform, rayCaster, parameters ) )
+  {
+    return EXIT_FAILURE;
+  }
+  if( !TestDerivativeThreading< GradientDifferenceMetricType >( "GradientDifference",
+    fixedImage, movingImage, transform, rayCaster, parameters ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
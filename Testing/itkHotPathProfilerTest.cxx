@@ -0,0 +1,445 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Check that the Chrome trace of the HotPathProfiler is valid JSON.
+
+ Sections and markers with quotes, backslashes and control characters in
+ their names are timed in several threads. The trace should then be parsed
+ by a strict JSON parser, and contain the names unchanged, one event per
+ traced call. Timers should only report to the enabled profiler.
+ */
+
+#include "itkHotPathProfiler.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+/** A strict parser of JSON, that collects the values of the "name" members. */
+class JSONParser
+{
+public:
+
+  JSONParser( const std::string & text ) : m_Text( text ), m_Position( 0 ) {}
+
+  /** Parse the text, which should be a single value. */
+  bool Parse( void )
+  {
+    this->SkipWhiteSpace();
+    if( !this->ParseValue() )
+    {
+      return false;
+    }
+    this->SkipWhiteSpace();
+    return this->m_Position == this->m_Text.size();
+  }
+
+
+  const std::vector< std::string > & GetNames( void ) const
+  {
+    return this->m_Names;
+  }
+
+
+  std::size_t GetPosition( void ) const
+  {
+    return this->m_Position;
+  }
+
+
+private:
+
+  bool AtEnd( void ) const
+  {
+    return this->m_Position >= this->m_Text.size();
+  }
+
+
+  char Peek( void ) const
+  {
+    return this->AtEnd() ? '\0' : this->m_Text[ this->m_Position ];
+  }
+
+
+  void SkipWhiteSpace( void )
+  {
+    while( !this->AtEnd() && ( this->Peek() == ' ' || this->Peek() == '\t'
+      || this->Peek() == '\n' || this->Peek() == '\r' ) )
+    {
+      ++this->m_Position;
+    }
+  }
+
+
+  bool Expect( const char * token )
+  {
+    const std::string expected( token );
+    if( this->m_Text.compare( this->m_Position, expected.size(), expected ) != 0 )
+    {
+      return false;
+    }
+    this->m_Position += expected.size();
+    return true;
+  }
+
+
+  bool ParseValue( void )
+  {
+    switch( this->Peek() )
+    {
+      case '{': return this->ParseObject();
+      case '[': return this->ParseArray();
+      case '"':
+      {
+        std::string value;
+        return this->ParseString( value );
+      }
+      case 't': return this->Expect( "true" );
+      case 'f': return this->Expect( "false" );
+      case 'n': return this->Expect( "null" );
+      default: return this->ParseNumber();
+    }
+  }
+
+
+  bool ParseObject( void )
+  {
+    ++this->m_Position;
+    this->SkipWhiteSpace();
+    if( this->Peek() == '}' )
+    {
+      ++this->m_Position;
+      return true;
+    }
+    while( true )
+    {
+      std::string key;
+      this->SkipWhiteSpace();
+      if( this->Peek() != '"' || !this->ParseString( key ) )
+      {
+        return false;
+      }
+      this->SkipWhiteSpace();
+      if( !this->Expect( ":" ) )
+      {
+        return false;
+      }
+      this->SkipWhiteSpace();
+      if( key == "name" && this->Peek() == '"' )
+      {
+        std::string name;
+        if( !this->ParseString( name ) )
+        {
+          return false;
+        }
+        this->m_Names.push_back( name );
+      }
+      else if( !this->ParseValue() )
+      {
+        return false;
+      }
+      this->SkipWhiteSpace();
+      if( this->Peek() == ',' )
+      {
+        ++this->m_Position;
+        continue;
+      }
+      return this->Expect( "}" );
+    }
+  }
+
+
+  bool ParseArray( void )
+  {
+    ++this->m_Position;
+    this->SkipWhiteSpace();
+    if( this->Peek() == ']' )
+    {
+      ++this->m_Position;
+      return true;
+    }
+    while( true )
+    {
+      this->SkipWhiteSpace();
+      if( !this->ParseValue() )
+      {
+        return false;
+      }
+      this->SkipWhiteSpace();
+      if( this->Peek() == ',' )
+      {
+        ++this->m_Position;
+        continue;
+      }
+      return this->Expect( "]" );
+    }
+  }
+
+
+  /** Parse a string, without unescaped quotes, backslashes or control
+   * characters. Only the \u escapes below 0x80 are decoded.
+   */
+  bool ParseString( std::string & value )
+  {
+    ++this->m_Position;
+    while( !this->AtEnd() )
+    {
+      const unsigned char c = static_cast< unsigned char >( this->m_Text[ this->m_Position++ ] );
+      if( c == '"' )
+      {
+        return true;
+      }
+      if( c < 0x20 )
+      {
+        return false;
+      }
+      if( c != '\\' )
+      {
+        value += static_cast< char >( c );
+        continue;
+      }
+      if( this->AtEnd() )
+      {
+        return false;
+      }
+      const char escape = this->m_Text[ this->m_Position++ ];
+      switch( escape )
+      {
+        case '"': value += '"'; break;
+        case '\\': value += '\\'; break;
+        case '/': value += '/'; break;
+        case 'b': value += '\b'; break;
+        case 'f': value += '\f'; break;
+        case 'n': value += '\n'; break;
+        case 'r': value += '\r'; break;
+        case 't': value += '\t'; break;
+        case 'u':
+        {
+          if( this->m_Position + 4 > this->m_Text.size() )
+          {
+            return false;
+          }
+          unsigned int code = 0;
+          for( unsigned int i = 0; i < 4; ++i )
+          {
+            const char h = this->m_Text[ this->m_Position++ ];
+            code *= 16;
+            if( h >= '0' && h <= '9' ) { code += h - '0'; }
+            else if( h >= 'a' && h <= 'f' ) { code += h - 'a' + 10; }
+            else if( h >= 'A' && h <= 'F' ) { code += h - 'A' + 10; }
+            else { return false; }
+          }
+          if( code >= 0x80 )
+          {
+            return false;
+          }
+          value += static_cast< char >( code );
+          break;
+        }
+        default: return false;
+      }
+    }
+    return false;
+  }
+
+
+  bool ParseNumber( void )
+  {
+    const std::size_t start = this->m_Position;
+    if( this->Peek() == '-' )
+    {
+      ++this->m_Position;
+    }
+    std::size_t digits = 0;
+    while( this->Peek() >= '0' && this->Peek() <= '9' )
+    {
+      ++this->m_Position;
+      ++digits;
+    }
+    if( digits == 0 )
+    {
+      return false;
+    }
+    if( this->Peek() == '.' )
+    {
+      ++this->m_Position;
+      digits = 0;
+      while( this->Peek() >= '0' && this->Peek() <= '9' )
+      {
+        ++this->m_Position;
+        ++digits;
+      }
+      if( digits == 0 )
+      {
+        return false;
+      }
+    }
+    if( this->Peek() == 'e' || this->Peek() == 'E' )
+    {
+      ++this->m_Position;
+      if( this->Peek() == '+' || this->Peek() == '-' )
+      {
+        ++this->m_Position;
+      }
+      digits = 0;
+      while( this->Peek() >= '0' && this->Peek() <= '9' )
+      {
+        ++this->m_Position;
+        ++digits;
+      }
+      if( digits == 0 )
+      {
+        return false;
+      }
+    }
+    return this->m_Position > start;
+  }
+
+
+  std::string                m_Text;
+  std::size_t                m_Position;
+  std::vector< std::string > m_Names;
+};
+
+//-------------------------------------------------------------------------------------
+
+/** The names of the traced sections. */
+const char * const QuotedSectionName    = "Metric::\"Quoted\"";
+const char * const BackslashSectionName = "Metric::C:\\path\\to\\image";
+
+/** Time the sections a number of times, as an instrumented component would. */
+void
+RunSections( const unsigned int numberOfCalls )
+{
+  for( unsigned int i = 0; i < numberOfCalls; ++i )
+  {
+    {
+      itkHotPathScopedTimerMacro( "Metric::\"Quoted\"" );
+    }
+    {
+      itkHotPathScopedTimerMacro( "Metric::C:\\path\\to\\image" );
+    }
+    {
+      /** Fine timers are not traced. */
+      itkHotPathFineScopedTimerMacro( "Transform::\"Fine\"" );
+    }
+    itkHotPathCounterMacro( "Metric::\"Counter\"", 1 );
+  }
+}
+
+
+int
+main( int argc, char * argv[] )
+{
+  const unsigned int numberOfThreads = 4;
+  const unsigned int numberOfCalls   = 25;
+  const std::string  markerName      = "Resolution \"0\" \\ new\nline\ttab\x01";
+
+  itk::HotPathProfiler profiler;
+  profiler.SetTraceEnabled( true );
+  profiler.SetEnabled( true );
+  if( itk::HotPathProfiler::GetEnabledProfiler() != &profiler )
+  {
+    std::cerr << "ERROR: the profiler is not enabled." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Time the sections in several threads, so that several buffers are used. */
+  const itk::HotPathProfiler::TimePointType begin = itk::HotPathProfiler::ClockType::now();
+  std::vector< std::thread > threads;
+  for( unsigned int t = 0; t < numberOfThreads; ++t )
+  {
+    threads.push_back( std::thread( RunSections, numberOfCalls ) );
+  }
+  for( unsigned int t = 0; t < numberOfThreads; ++t )
+  {
+    threads[ t ].join();
+  }
+  profiler.AddTraceMarker( markerName, begin, itk::HotPathProfiler::ClockType::now() );
+
+  /** A second profiler takes over; the first one should not get its timings. */
+  {
+    itk::HotPathProfiler otherProfiler;
+    otherProfiler.SetTraceEnabled( true );
+    otherProfiler.SetEnabled( true );
+    RunSections( numberOfCalls );
+    if( profiler.GetEnabled() || !otherProfiler.GetEnabled() )
+    {
+      std::cerr << "ERROR: enabling a profiler did not disable the other one." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if( itk::HotPathProfiler::GetEnabledProfiler() != nullptr )
+  {
+    std::cerr << "ERROR: a destructed profiler is still enabled." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** Write the trace, and parse it. */
+  std::ostringstream trace( "" );
+  profiler.WriteChromeTrace( trace );
+  JSONParser parser( trace.str() );
+  if( !parser.Parse() )
+  {
+    std::cerr << "ERROR: the trace is not valid JSON, at position " << parser.GetPosition()
+              << ":\n" << trace.str() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** The names should be unchanged, with one event per traced call. */
+  const std::vector< std::string > & names = parser.GetNames();
+  std::size_t numberOfMarkers = 0, numberOfQuoted = 0, numberOfBackslash = 0;
+  for( std::size_t i = 0; i < names.size(); ++i )
+  {
+    if( names[ i ] == markerName ) { ++numberOfMarkers; }
+    else if( names[ i ] == QuotedSectionName ) { ++numberOfQuoted; }
+    else if( names[ i ] == BackslashSectionName ) { ++numberOfBackslash; }
+    else
+    {
+      std::cerr << "ERROR: unexpected event \"" << names[ i ] << "\" in the trace." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << "The trace has " << names.size() << " events: " << numberOfMarkers << " marker(s), "
+            << numberOfQuoted << " and " << numberOfBackslash << " timings." << std::endl;
+
+  const std::size_t expected = numberOfThreads * numberOfCalls;
+  if( numberOfMarkers != 1 || numberOfQuoted != expected || numberOfBackslash != expected )
+  {
+    std::cerr << "ERROR: expected 1 marker and " << expected << " timings of each section." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  /** The report should mention all sections. */
+  std::ostringstream report( "" );
+  profiler.PrintReport( report, 1.0 );
+  if( report.str().find( "Transform::\"Fine\"" ) == std::string::npos
+    || report.str().find( "Metric::\"Counter\"" ) == std::string::npos )
+  {
+    std::cerr << "ERROR: the report misses sections:\n" << report.str() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,148 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the ImageMaskLookup with IsInsideInWorldSpace() of the mask.
+ */
+
+#include "itkImageMaskLookup.h"
+#include "itkImageMaskSpatialObject.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestImageMaskLookup( void )
+{
+  typedef itk::ImageMaskSpatialObject< Dimension >  MaskSpatialObjectType;
+  typedef typename MaskSpatialObjectType::ImageType MaskImageType;
+  typedef typename MaskSpatialObjectType::PointType PointType;
+  typedef typename MaskImageType::SizeType          SizeType;
+  typedef typename MaskImageType::SpacingType       SpacingType;
+  typedef typename MaskImageType::PointType         OriginType;
+  typedef typename MaskImageType::RegionType        RegionType;
+  typedef typename MaskImageType::DirectionType     DirectionType;
+  typedef itk::ImageMaskLookup< Dimension >         MaskLookupType;
+
+  typedef itk::ImageRegionIteratorWithIndex< MaskImageType >     IteratorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->Initialize( 565656 );
+
+  /** Create a mask image with a non-identity direction. */
+  SizeType size; SpacingType spacing; OriginType origin;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    size[ i ]    = 40 + 3 * i;
+    spacing[ i ] = randomNum->GetUniformVariate( 0.5, 2.0 );
+    origin[ i ]  = randomNum->GetUniformVariate( -10.0, 10.0 );
+  }
+  const double  angle = 0.3;
+  DirectionType direction; direction.SetIdentity();
+  direction[ 0 ][ 0 ] = std::cos( angle ); direction[ 0 ][ 1 ] = -std::sin( angle );
+  direction[ 1 ][ 0 ] = std::sin( angle ); direction[ 1 ][ 1 ] = std::cos( angle );
+
+  typename MaskImageType::Pointer image = MaskImageType::New();
+  image->SetRegions( RegionType( size ) );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->SetDirection( direction );
+  image->Allocate();
+
+  /** The mask is a full box, with a sphere of random voxels around it,
+   * so that there are empty, full and mixed blocks.
+   */
+  IteratorType it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    bool   inBox = true;
+    double r2    = 0.0;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      const double x = it.GetIndex()[ i ] - 0.5 * size[ i ];
+      inBox &= std::abs( x ) < 8.0;
+      r2    += x * x;
+    }
+    const bool random = r2 < 15.0 * 15.0 && randomNum->GetUniformVariate( 0.0, 1.0 ) < 0.5;
+    it.Set( ( inBox || random ) ? 1 : 0 );
+  }
+
+  typename MaskSpatialObjectType::Pointer mask = MaskSpatialObjectType::New();
+  mask->SetImage( image );
+  mask->Update();
+
+  /** Compare in random points around the image, with and without blocks. */
+  for( unsigned int blockSize = 0; blockSize <= 8; blockSize += 8 )
+  {
+    typename MaskLookupType::Pointer lookup = MaskLookupType::New();
+    lookup->SetBlockSize( blockSize );
+    lookup->SetMask( mask );
+    lookup->Update();
+    if( !lookup->GetUseFastLookup() )
+    {
+      std::cerr << "ERROR: the fast lookup is not used for an ImageMaskSpatialObject." << std::endl;
+      return false;
+    }
+
+    unsigned int numberOfInside = 0;
+    for( unsigned int n = 0; n < 100000; ++n )
+    {
+      PointType point;
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        point[ i ] = randomNum->GetUniformVariate( -80.0, 80.0 );
+      }
+
+      const bool expected = mask->IsInsideInWorldSpace( point );
+      if( lookup->IsInside( point ) != expected )
+      {
+        std::cerr << "ERROR: the lookup differs from IsInsideInWorldSpace() in " << point
+                  << " (block size " << blockSize << ")." << std::endl;
+        return false;
+      }
+      numberOfInside += expected;
+    }
+    std::cout << Dimension << "D, block size " << blockSize << ": "
+              << numberOfInside << " points inside the mask." << std::endl;
+  }
+
+  return true;
+
+} // end TestImageMaskLookup()
+
+
+int
+main( int argc, char ** argv )
+{
+  // 2D tests
+  bool success = TestImageMaskLookup< 2 >();
+  if( !success ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  success = TestImageMaskLookup< 3 >();
+  if( !success ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+} // end main
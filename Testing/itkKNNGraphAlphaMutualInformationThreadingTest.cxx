@@ -0,0 +1,229 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the multi-threaded and the single-threaded evaluation of the
+ KNNGraphAlphaMutualInformation metric, and check the reuse of the fixed tree.
+
+ The value and the derivative computed with several work units should be
+ equal to the single-threaded ones, up to the order of the summation.
+ Reusing the fixed tree in a second evaluation, with other transform
+ parameters but the same fixed samples, should give the same results as
+ rebuilding it.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "KNNGraphAlphaMutualInformation/itkKNNGraphAlphaMutualInformationImageToImageMetric.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+/** Compute the relative errors of a value and a derivative. */
+template< class TMeasure, class TDerivative >
+void
+ComputeRelativeErrors(
+  const TMeasure value, const TDerivative & derivative,
+  const TMeasure referenceValue, const TDerivative & referenceDerivative,
+  double & valueError, double & derivativeError )
+{
+  valueError      = std::abs( value - referenceValue ) / std::abs( referenceValue );
+  derivativeError = ( derivative - referenceDerivative ).magnitude()
+    / referenceDerivative.magnitude();
+}
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestKNNGraphAlphaMutualInformationThreading( const unsigned int imageSize )
+{
+  typedef itk::Image< float, Dimension >                                          ImageType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 >         BSplineTransformType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension >                  CombinationTransformType;
+  typedef itk::BSplineInterpolateImageFunction< ImageType, double, double >       InterpolatorType;
+  typedef itk::ImageFullSampler< ImageType >                                      SamplerType;
+  typedef itk::KNNGraphAlphaMutualInformationImageToImageMetric< ImageType, ImageType > MetricType;
+  typedef typename MetricType::DerivativeType                                     DerivativeType;
+  typedef typename MetricType::MeasureType                                        MeasureType;
+  typedef typename CombinationTransformType::ParametersType                       ParametersType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator                  RandomGeneratorType;
+
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 565656 + Dimension );
+
+  /** Smooth images, with a different pattern. A little noise avoids equal
+   * feature vectors, i.e. zero distances to the nearest neighbours.
+   */
+  typename ImageType::SizeType size;
+  size.Fill( imageSize );
+  typename ImageType::Pointer fixedImage  = ImageType::New();
+  typename ImageType::Pointer movingImage = ImageType::New();
+  fixedImage->SetRegions( typename ImageType::RegionType( size ) );
+  fixedImage->Allocate();
+  movingImage->SetRegions( typename ImageType::RegionType( size ) );
+  movingImage->Allocate();
+  itk::ImageRegionIteratorWithIndex< ImageType > itF( fixedImage, fixedImage->GetLargestPossibleRegion() );
+  itk::ImageRegionIteratorWithIndex< ImageType > itM( movingImage, movingImage->GetLargestPossibleRegion() );
+  for( ; !itF.IsAtEnd(); ++itF, ++itM )
+  {
+    double f = random->GetUniformVariate( -0.5, 0.5 );
+    double m = random->GetUniformVariate( -0.5, 0.5 );
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      const double x = itF.GetIndex()[ i ] - 0.5 * imageSize;
+      f += 50.0 * std::sin( 0.3 * x + i ) + 0.1 * x * x;
+      m += 45.0 * std::sin( 0.3 * x + i + 0.4 ) + 0.12 * x * x;
+    }
+    itF.Set( static_cast< float >( f ) );
+    itM.Set( static_cast< float >( m ) );
+  }
+
+  /** A B-spline transform, and two sets of random coefficients. */
+  typename BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  typename BSplineTransformType::OriginType origin;
+  origin.Fill( -8.0 );
+  typename BSplineTransformType::SpacingType spacing;
+  spacing.Fill( 6.0 );
+  typename BSplineTransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( imageSize / 6 + 4 );
+  typename BSplineTransformType::DirectionType direction;
+  direction.SetIdentity();
+  bsplineTransform->SetGridOrigin( origin );
+  bsplineTransform->SetGridSpacing( spacing );
+  bsplineTransform->SetGridRegion( typename BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( direction );
+  typename CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  ParametersType parameters[ 2 ];
+  for( unsigned int p = 0; p < 2; ++p )
+  {
+    parameters[ p ].SetSize( transform->GetNumberOfParameters() );
+    for( unsigned int i = 0; i < parameters[ p ].GetSize(); ++i )
+    {
+      parameters[ p ][ i ] = random->GetUniformVariate( -1.0, 1.0 );
+    }
+  }
+  transform->SetParameters( parameters[ 0 ] );
+
+  /** Evaluate the metric with several numbers of work units, and with and
+   * without reusing the fixed tree. Every metric is evaluated twice, with the
+   * two sets of parameters, so that the second evaluation may reuse the
+   * fixed tree of the first one. The first configuration is the reference.
+   */
+  const unsigned int numberOfWorkUnits[] = { 1, 1, 2, 2, 4 };
+  const bool         reuseFixedTree[]    = { false, true, false, true, true };
+  MeasureType        referenceValue[ 2 ];
+  MeasureType        referenceValueOnly[ 2 ];
+  DerivativeType     referenceDerivative[ 2 ];
+  for( unsigned int t = 0; t < 5; ++t )
+  {
+    typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    interpolator->SetSplineOrder( 3 );
+    typename SamplerType::Pointer sampler = SamplerType::New();
+    typename MetricType::Pointer  metric  = MetricType::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( transform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetANNkDTree( 50, "ANN_KD_SL_MIDPT" );
+    metric->SetANNStandardTreeSearch( 5, 0.0 );
+    metric->SetAlpha( 0.99 );
+    metric->SetReuseFixedTree( reuseFixedTree[ t ] );
+    metric->SetUseMultiThread( numberOfWorkUnits[ t ] > 1 );
+    metric->SetNumberOfWorkUnits( numberOfWorkUnits[ t ] );
+    metric->SetRequiredRatioOfValidSamples( 0.1 );
+    metric->Initialize();
+
+    for( unsigned int p = 0; p < 2; ++p )
+    {
+      MeasureType    value = 0.0;
+      DerivativeType derivative;
+      metric->GetValueAndDerivative( parameters[ p ], value, derivative );
+      const MeasureType valueOnly = metric->GetValue( parameters[ p ] );
+
+      if( t == 0 )
+      {
+        referenceValue[ p ]      = value;
+        referenceValueOnly[ p ]  = valueOnly;
+        referenceDerivative[ p ] = derivative;
+        if( !( referenceDerivative[ p ].magnitude() > 0.0 ) )
+        {
+          std::cerr << "ERROR: the derivative is zero." << std::endl;
+          return false;
+        }
+        continue;
+      }
+
+      double valueError = 0.0, derivativeError = 0.0;
+      ComputeRelativeErrors( value, derivative,
+        referenceValue[ p ], referenceDerivative[ p ], valueError, derivativeError );
+      const double valueOnlyError = std::abs( valueOnly - referenceValueOnly[ p ] )
+        / std::abs( referenceValueOnly[ p ] );
+
+      std::cout << std::setprecision( 12 ) << Dimension << "D, " << numberOfWorkUnits[ t ]
+                << " work units, ReuseFixedTree " << reuseFixedTree[ t ] << ", evaluation " << p
+                << ": value " << value << ", relative errors: value " << valueError
+                << ", GetValue " << valueOnlyError << ", derivative " << derivativeError << std::endl;
+
+      if( !( valueError < 1e-10 ) || !( valueOnlyError < 1e-10 ) || !( derivativeError < 1e-10 ) )
+      {
+        std::cerr << "ERROR: the results with " << numberOfWorkUnits[ t ]
+                  << " work units and ReuseFixedTree " << reuseFixedTree[ t ]
+                  << " differ from the single-threaded results without reuse." << std::endl;
+        return false;
+      }
+    }
+  }
+
+  return true;
+
+} // end TestKNNGraphAlphaMutualInformationThreading()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  // 2D tests
+  if( !TestKNNGraphAlphaMutualInformationThreading< 2 >( 32 ) ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,214 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the speculative MoreThuenteLineSearchOptimizer with the
+ sequential one.
+
+ On a quadratic cost function, for initial step lengths that are much too
+ short, about right, and much too long, the speculative line search should
+ take the same step, with the same value, stop condition and number of
+ iterations, as the sequential line search.
+ */
+
+#include "itkMoreThuenteLineSearchOptimizer.h"
+#include "itkSingleValuedCostFunction.h"
+
+#include <iomanip>
+#include <iostream>
+
+//-------------------------------------------------------------------------------------
+
+/** A quadratic cost function, that counts its evaluations. */
+class QuadraticCostFunction : public itk::SingleValuedCostFunction
+{
+public:
+
+  typedef QuadraticCostFunction           Self;
+  typedef itk::SingleValuedCostFunction   Superclass;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+  itkNewMacro( Self );
+  itkTypeMacro( QuadraticCostFunction, SingleValuedCostFunction );
+
+  typedef Superclass::MeasureType    MeasureType;
+  typedef Superclass::ParametersType ParametersType;
+  typedef Superclass::DerivativeType DerivativeType;
+
+  itkGetConstMacro( NumberOfEvaluations, unsigned long );
+
+  unsigned int GetNumberOfParameters( void ) const override
+  {
+    return 3;
+  }
+
+
+  MeasureType GetValue( const ParametersType & parameters ) const override
+  {
+    ++this->m_NumberOfEvaluations;
+    MeasureType value = 0.0;
+    for( unsigned int i = 0; i < 3; ++i )
+    {
+      const double d = parameters[ i ] - ( 1.0 + i );
+      value += ( 1.0 + 4.0 * i ) * d * d;
+    }
+    return value;
+  }
+
+
+  void GetDerivative( const ParametersType & parameters,
+    DerivativeType & derivative ) const override
+  {
+    derivative.SetSize( 3 );
+    for( unsigned int i = 0; i < 3; ++i )
+    {
+      derivative[ i ] = 2.0 * ( 1.0 + 4.0 * i ) * ( parameters[ i ] - ( 1.0 + i ) );
+    }
+  }
+
+
+protected:
+
+  QuadraticCostFunction()
+  {
+    this->m_NumberOfEvaluations = 0;
+  }
+
+
+  ~QuadraticCostFunction() override {}
+
+private:
+
+  mutable unsigned long m_NumberOfEvaluations;
+
+};
+
+//-------------------------------------------------------------------------------------
+
+typedef itk::MoreThuenteLineSearchOptimizer LineSearchType;
+typedef LineSearchType::ParametersType      ParametersType;
+typedef LineSearchType::DerivativeType      DerivativeType;
+
+/** The result of one line search. */
+struct LineSearchResultType
+{
+  double                            st_Step;
+  LineSearchType::MeasureType       st_Value;
+  LineSearchType::StopConditionType st_StopCondition;
+  unsigned long                     st_NumberOfIterations;
+  unsigned long                     st_NumberOfSpeculativeEvaluations;
+};
+
+/** Run a line search from the origin, in the steepest descent direction. */
+LineSearchResultType
+RunLineSearch( const double initialStep, const double gradientTolerance,
+  const unsigned int numberOfSpeculativeCostFunctions )
+{
+  QuadraticCostFunction::Pointer costFunction = QuadraticCostFunction::New();
+  ParametersType                 initialPosition( 3 );
+  initialPosition.Fill( 0.0 );
+  DerivativeType initialDerivative;
+  costFunction->GetDerivative( initialPosition, initialDerivative );
+  ParametersType direction( 3 );
+  for( unsigned int i = 0; i < 3; ++i )
+  {
+    direction[ i ] = -initialDerivative[ i ];
+  }
+
+  LineSearchType::Pointer lineSearch = LineSearchType::New();
+  lineSearch->SetCostFunction( costFunction );
+  lineSearch->SetInitialPosition( initialPosition );
+  lineSearch->SetLineSearchDirection( direction );
+  lineSearch->SetInitialStepLengthEstimate( initialStep );
+  lineSearch->SetGradientTolerance( gradientTolerance );
+  lineSearch->SetMaximumNumberOfIterations( 30 );
+
+  LineSearchType::CostFunctionContainerType speculativeCostFunctions;
+  for( unsigned int i = 0; i < numberOfSpeculativeCostFunctions; ++i )
+  {
+    speculativeCostFunctions.push_back( QuadraticCostFunction::New().GetPointer() );
+  }
+  lineSearch->SetSpeculativeCostFunctions( speculativeCostFunctions );
+  lineSearch->SetUseSpeculativeEvaluation( numberOfSpeculativeCostFunctions > 0 );
+
+  lineSearch->StartOptimization();
+
+  LineSearchResultType result;
+  result.st_Step                           = lineSearch->GetCurrentStepLength();
+  result.st_Value                          = lineSearch->GetCurrentValue();
+  result.st_StopCondition                  = lineSearch->GetStopCondition();
+  result.st_NumberOfIterations             = lineSearch->GetCurrentIteration();
+  result.st_NumberOfSpeculativeEvaluations = 0;
+  for( unsigned int i = 0; i < numberOfSpeculativeCostFunctions; ++i )
+  {
+    result.st_NumberOfSpeculativeEvaluations += static_cast< const QuadraticCostFunction * >(
+      speculativeCostFunctions[ i ].GetPointer() )->GetNumberOfEvaluations();
+  }
+  return result;
+
+} // end RunLineSearch()
+
+
+int
+main( int argc, char * argv[] )
+{
+  const double initialSteps[]       = { 1e-6, 1e-3, 0.05, 1.0, 1e3 };
+  const double gradientTolerances[] = { 0.9, 0.1, 1e-3 };
+
+  unsigned long numberOfSpeculativeEvaluations = 0;
+  for( unsigned int s = 0; s < 5; ++s )
+  {
+    for( unsigned int g = 0; g < 3; ++g )
+    {
+      const LineSearchResultType sequential
+        = RunLineSearch( initialSteps[ s ], gradientTolerances[ g ], 0 );
+
+      for( unsigned int n = 2; n <= 4; ++n )
+      {
+        const LineSearchResultType speculative
+          = RunLineSearch( initialSteps[ s ], gradientTolerances[ g ], n );
+        numberOfSpeculativeEvaluations += speculative.st_NumberOfSpeculativeEvaluations;
+
+        std::cout << std::setprecision( 17 ) << "initial step " << initialSteps[ s ]
+                  << ", gradient tolerance " << gradientTolerances[ g ]
+                  << ", " << n << " workers: step " << speculative.st_Step
+                  << " (sequential " << sequential.st_Step << "), iterations "
+                  << speculative.st_NumberOfIterations << " (sequential "
+                  << sequential.st_NumberOfIterations << ")" << std::endl;
+
+        if( speculative.st_Step != sequential.st_Step
+          || speculative.st_Value != sequential.st_Value
+          || speculative.st_StopCondition != sequential.st_StopCondition
+          || speculative.st_NumberOfIterations != sequential.st_NumberOfIterations )
+        {
+          std::cerr << "ERROR: the speculative line search differs from the sequential one." << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  /** The much too short initial steps must have been extrapolated speculatively. */
+  if( numberOfSpeculativeEvaluations == 0 )
+  {
+    std::cerr << "ERROR: no step was evaluated speculatively." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,333 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the moving image gradient computed in each sample with the
+ precomputed gradient image.
+
+ For interpolators that do not provide a derivative, the metrics take the
+ moving image gradient from a precomputed central difference gradient image,
+ or, when PrecomputeMovingImageGradient is false, compute the central
+ difference in the nearest voxel on the fly. Both should give the same
+ gradient, also at the border of the image, where the neighbours are clamped.
+
+ The moving image is linear in the physical coordinates, and has an
+ anisotropic spacing and a non-identity direction, so that the gradient can
+ also be compared with the analytic one: the gradient itself in the interior,
+ and half of it along the axes where the voxel is at the border.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+/** A metric that gives access to the moving image value and derivative. */
+template< class TImage >
+class GradientTestMetric :
+  public itk::AdvancedMeanSquaresImageToImageMetric< TImage, TImage >
+{
+public:
+
+  typedef GradientTestMetric              Self;
+  typedef itk::AdvancedMeanSquaresImageToImageMetric<
+    TImage, TImage >                      Superclass;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+  itkNewMacro( Self );
+
+  typedef typename Superclass::MovingImagePointType      MovingImagePointType;
+  typedef typename Superclass::MovingImageDerivativeType MovingImageDerivativeType;
+  typedef typename Superclass::RealType                  RealType;
+
+  bool EvaluateMovingImage( const MovingImagePointType & point,
+    RealType & value, MovingImageDerivativeType & gradient ) const
+  {
+    return this->EvaluateMovingImageValueAndDerivative( point, value, &gradient );
+  }
+
+
+  bool HasGradientImage( void ) const
+  {
+    return this->m_GradientImage.IsNotNull();
+  }
+
+
+protected:
+
+  GradientTestMetric() {}
+  ~GradientTestMetric() override {}
+};
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestMovingImageCentralDifferenceGradient( void )
+{
+  typedef itk::Image< float, Dimension >                                      ImageType;
+  typedef itk::AdvancedTranslationTransform< double, Dimension >              TranslationTransformType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension >              CombinationTransformType;
+  typedef itk::InterpolateImageFunction< ImageType, double >                  InterpolatorType;
+  typedef itk::NearestNeighborInterpolateImageFunction< ImageType, double >   NearestNeighborInterpolatorType;
+  typedef itk::LinearInterpolateImageFunction< ImageType, double >            LinearInterpolatorType;
+  typedef itk::ImageFullSampler< ImageType >                                  SamplerType;
+  typedef GradientTestMetric< ImageType >                                     MetricType;
+  typedef typename MetricType::MovingImagePointType                           PointType;
+  typedef typename MetricType::MovingImageDerivativeType                      DerivativeType;
+  typedef typename MetricType::RealType                                       RealType;
+  typedef typename ImageType::DirectionType                                   DirectionType;
+  typedef itk::ContinuousIndex< double, Dimension >                           ContinuousIndexType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator              RandomGeneratorType;
+
+  /** An image with anisotropic spacing, and a direction that is a product of
+   * rotations in the planes of consecutive axes.
+   */
+  typename ImageType::SizeType    size;
+  typename ImageType::SpacingType spacing;
+  typename ImageType::PointType   origin;
+  DirectionType                   direction;
+  direction.SetIdentity();
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    size[ i ]    = 9 - 2 * i;
+    spacing[ i ] = 0.6 + 0.7 * i;
+    origin[ i ]  = -3.0 + i;
+    if( i + 1 < Dimension )
+    {
+      const double  angle = 0.5 + 0.3 * i;
+      DirectionType rotation;
+      rotation.SetIdentity();
+      rotation[ i ][ i ]         = std::cos( angle );
+      rotation[ i ][ i + 1 ]     = -std::sin( angle );
+      rotation[ i + 1 ][ i ]     = std::sin( angle );
+      rotation[ i + 1 ][ i + 1 ] = std::cos( angle );
+      direction = direction * rotation;
+    }
+  }
+
+  typename ImageType::Pointer image = ImageType::New();
+  image->SetRegions( typename ImageType::RegionType( size ) );
+  image->SetSpacing( spacing );
+  image->SetOrigin( origin );
+  image->SetDirection( direction );
+  image->Allocate();
+
+  /** The image is linear in the physical coordinates: f( p ) = a . p. */
+  DerivativeType slope;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    slope[ i ] = 0.7 - 1.1 * i;
+  }
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( ; !it.IsAtEnd(); ++it )
+  {
+    PointType point;
+    image->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    double value = 0.0;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      value += slope[ i ] * point[ i ];
+    }
+    it.Set( static_cast< float >( value ) );
+  }
+
+  /** The samples: all voxel centres, which includes the border, and random
+   * points in the buffer, which are rounded to the nearest voxel.
+   */
+  std::vector< PointType > points;
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    PointType point;
+    image->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    points.push_back( point );
+  }
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 121212 + Dimension );
+  for( unsigned int n = 0; n < 200; ++n )
+  {
+    ContinuousIndexType cindex;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      cindex[ i ] = random->GetUniformVariate( -0.45, size[ i ] - 0.55 );
+    }
+    PointType point;
+    image->TransformContinuousIndexToPhysicalPoint( cindex, point );
+    points.push_back( point );
+  }
+
+  /** The analytic central difference: along the axes where the nearest voxel
+   * is at the border only one neighbour differs, so that the local derivative
+   * is halved.
+   */
+  std::vector< DerivativeType > expectedGradients( points.size() );
+  unsigned long                 numberOfBorderSamples = 0;
+  for( unsigned int n = 0; n < points.size(); ++n )
+  {
+    ContinuousIndexType cindex;
+    image->TransformPhysicalPointToContinuousIndex( points[ n ], cindex );
+    DerivativeType localGradient;
+    bool           isBorder = false;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      /** The derivative along axis i is the slope along the direction of axis i. */
+      double localSlope = 0.0;
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        localSlope += direction[ j ][ i ] * slope[ j ];
+      }
+      const long index    = static_cast< long >( itk::Math::Round< double >( cindex[ i ] ) );
+      const bool atBorder = index == 0 || index == static_cast< long >( size[ i ] ) - 1;
+      localGradient[ i ] = atBorder ? 0.5 * localSlope : localSlope;
+      isBorder          |= atBorder;
+    }
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      expectedGradients[ n ][ j ] = 0.0;
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        expectedGradients[ n ][ j ] += direction[ j ][ i ] * localGradient[ i ];
+      }
+    }
+    numberOfBorderSamples += isBorder ? 1 : 0;
+  }
+  if( numberOfBorderSamples == 0 || numberOfBorderSamples == points.size() )
+  {
+    std::cerr << "ERROR: the samples should be at the border and in the interior." << std::endl;
+    return false;
+  }
+
+  typename TranslationTransformType::Pointer translation = TranslationTransformType::New();
+  typename CombinationTransformType::Pointer transform   = CombinationTransformType::New();
+  transform->SetCurrentTransform( translation );
+
+  /** Compare the gradients with and without the gradient image, for the
+   * nearest neighbour and the (non-advanced) linear interpolator.
+   */
+  for( unsigned int interpolatorIndex = 0; interpolatorIndex < 2; ++interpolatorIndex )
+  {
+    std::vector< DerivativeType > gradients[ 2 ];
+    for( unsigned int precompute = 0; precompute < 2; ++precompute )
+    {
+      typename InterpolatorType::Pointer interpolator;
+      if( interpolatorIndex == 0 )
+      {
+        interpolator = NearestNeighborInterpolatorType::New();
+      }
+      else
+      {
+        interpolator = LinearInterpolatorType::New();
+      }
+      typename SamplerType::Pointer sampler = SamplerType::New();
+      typename MetricType::Pointer  metric  = MetricType::New();
+      metric->SetFixedImage( image );
+      metric->SetMovingImage( image );
+      metric->SetFixedImageRegion( image->GetBufferedRegion() );
+      metric->SetTransform( transform );
+      metric->SetInterpolator( interpolator );
+      metric->SetImageSampler( sampler );
+      metric->SetPrecomputeMovingImageGradient( precompute == 1 );
+      metric->Initialize();
+
+      if( metric->HasGradientImage() != ( precompute == 1 ) )
+      {
+        std::cerr << "ERROR: the gradient image should only be computed when requested." << std::endl;
+        return false;
+      }
+
+      for( unsigned int n = 0; n < points.size(); ++n )
+      {
+        RealType       value = 0.0;
+        DerivativeType gradient;
+        if( !metric->EvaluateMovingImage( points[ n ], value, gradient ) )
+        {
+          std::cerr << "ERROR: sample " << n << " is outside the image buffer." << std::endl;
+          return false;
+        }
+        gradients[ precompute ].push_back( gradient );
+
+        const double analyticError = ( gradient - expectedGradients[ n ] ).GetNorm();
+        if( !( analyticError < 1e-4 ) )
+        {
+          std::cerr << "ERROR: " << Dimension << "D, interpolator " << interpolatorIndex
+                    << ", PrecomputeMovingImageGradient " << precompute << ", sample " << n
+                    << ": the gradient " << gradient << " differs from the analytic gradient "
+                    << expectedGradients[ n ] << std::endl;
+          return false;
+        }
+      }
+    }
+
+    double maximumDifference = 0.0;
+    for( unsigned int n = 0; n < points.size(); ++n )
+    {
+      maximumDifference = std::max( maximumDifference, ( gradients[ 0 ][ n ] - gradients[ 1 ][ n ] ).GetNorm() );
+    }
+
+    std::cout << std::setprecision( 6 ) << Dimension << "D, interpolator " << interpolatorIndex
+              << ", " << points.size() << " samples, of which " << numberOfBorderSamples
+              << " at the border: maximum difference between the gradients " << maximumDifference << std::endl;
+
+    if( !( maximumDifference < 1e-10 ) )
+    {
+      std::cerr << "ERROR: the central difference computed on the fly differs from the gradient image." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+
+} // end TestMovingImageCentralDifferenceGradient()
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  // 2D tests
+  if( !TestMovingImageCentralDifferenceGradient< 2 >() ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  if( !TestMovingImageCentralDifferenceGradient< 3 >() ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+
+} // end main
@@ -0,0 +1,137 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the ParallelBSplineDecompositionImageFilter with the BSplineDecompositionImageFilter.
+ */
+
+#include "itkParallelBSplineDecompositionImageFilter.h"
+#include "itkBSplineDecompositionImageFilter.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestParallelBSplineDecomposition( void )
+{
+  typedef itk::Image< short, Dimension >           InputImageType;
+  typedef itk::Image< double, Dimension >          CoefficientImageType;
+  typedef typename InputImageType::SizeType        SizeType;
+  typedef typename InputImageType::RegionType      RegionType;
+  typedef itk::BSplineDecompositionImageFilter<
+    InputImageType, CoefficientImageType >         DecompositionFilterType;
+  typedef itk::ParallelBSplineDecompositionImageFilter<
+    InputImageType, CoefficientImageType >         ParallelDecompositionFilterType;
+
+  typedef itk::ImageRegionIterator< InputImageType >             InputIteratorType;
+  typedef itk::ImageRegionConstIterator< CoefficientImageType >  CoefficientIteratorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->Initialize( 565656 );
+
+  /** Create a random image; in 3D one dimension has size 1. */
+  SizeType size;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    size[ i ] = 50 + 7 * i;
+  }
+  if( Dimension == 3 ) { size[ 1 ] = 1; }
+
+  typename InputImageType::Pointer image = InputImageType::New();
+  image->SetRegions( RegionType( size ) );
+  image->Allocate();
+
+  InputIteratorType it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    it.Set( static_cast< short >( randomNum->GetUniformVariate( -1000.0, 1000.0 ) ) );
+  }
+
+  /** Compare the coefficients for all spline orders and several numbers of threads. */
+  for( unsigned int splineOrder = 0; splineOrder <= 5; ++splineOrder )
+  {
+    typename DecompositionFilterType::Pointer decomposition = DecompositionFilterType::New();
+    decomposition->SetSplineOrder( splineOrder );
+    decomposition->SetInput( image );
+    itk::TimeProbe timer;
+    timer.Start();
+    decomposition->Update();
+    timer.Stop();
+
+    for( unsigned int threads = 1; threads <= 8; threads *= 2 )
+    {
+      typename ParallelDecompositionFilterType::Pointer parallelDecomposition
+        = ParallelDecompositionFilterType::New();
+      parallelDecomposition->SetSplineOrder( splineOrder );
+      parallelDecomposition->SetNumberOfWorkUnits( threads );
+      parallelDecomposition->SetInput( image );
+      itk::TimeProbe parallelTimer;
+      parallelTimer.Start();
+      parallelDecomposition->Update();
+      parallelTimer.Stop();
+
+      CoefficientIteratorType cit( decomposition->GetOutput(),
+        decomposition->GetOutput()->GetLargestPossibleRegion() );
+      CoefficientIteratorType pit( parallelDecomposition->GetOutput(),
+        parallelDecomposition->GetOutput()->GetLargestPossibleRegion() );
+      double maxDifference = 0.0;
+      for( cit.GoToBegin(), pit.GoToBegin(); !cit.IsAtEnd(); ++cit, ++pit )
+      {
+        maxDifference = std::max( maxDifference, std::abs( cit.Get() - pit.Get() ) );
+      }
+
+      std::cout << Dimension << "D, order " << splineOrder << ", " << threads << " threads: "
+                << "max difference " << maxDifference << ", time "
+                << timer.GetMean() << " s (ITK) vs "
+                << parallelTimer.GetMean() << " s (parallel)." << std::endl;
+      if( maxDifference > 1e-8 )
+      {
+        std::cerr << "ERROR: the coefficients differ from the BSplineDecompositionImageFilter." << std::endl;
+        return false;
+      }
+    }
+  }
+
+  return true;
+
+} // end TestParallelBSplineDecomposition()
+
+
+int
+main( int argc, char ** argv )
+{
+  // 2D tests
+  bool success = TestParallelBSplineDecomposition< 2 >();
+  if( !success ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  success = TestParallelBSplineDecomposition< 3 >();
+  if( !success ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+} // end main
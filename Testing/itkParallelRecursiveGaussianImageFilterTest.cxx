@@ -0,0 +1,165 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the ParallelRecursiveGaussianImageFilter with a series of RecursiveGaussianImageFilter's.
+ */
+
+#include "itkParallelRecursiveGaussianImageFilter.h"
+#include "itkRecursiveGaussianImageFilter.h"
+#include "itkCastImageFilter.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestParallelRecursiveGaussian( void )
+{
+  typedef itk::Image< short, Dimension >           InputImageType;
+  typedef itk::Image< double, Dimension >          OutputImageType;
+  typedef typename InputImageType::SizeType        SizeType;
+  typedef typename InputImageType::SpacingType     SpacingType;
+  typedef typename InputImageType::RegionType      RegionType;
+  typedef itk::CastImageFilter<
+    InputImageType, OutputImageType >              CasterType;
+  typedef itk::RecursiveGaussianImageFilter<
+    OutputImageType, OutputImageType >             SmootherType;
+  typedef itk::ParallelRecursiveGaussianImageFilter<
+    InputImageType, OutputImageType >              ParallelSmootherType;
+  typedef typename ParallelSmootherType::SigmaArrayType SigmaArrayType;
+
+  typedef itk::ImageRegionIterator< InputImageType >             InputIteratorType;
+  typedef itk::ImageRegionConstIterator< OutputImageType >       OutputIteratorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->Initialize( 565656 );
+
+  /** Create a random image with anisotropic spacing. */
+  SizeType    size;
+  SpacingType spacing;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    size[ i ]    = 50 + 7 * i;
+    spacing[ i ] = 1.0 + 0.5 * i;
+  }
+
+  typename InputImageType::Pointer image = InputImageType::New();
+  image->SetRegions( RegionType( size ) );
+  image->SetSpacing( spacing );
+  image->Allocate();
+
+  InputIteratorType it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    it.Set( static_cast< short >( randomNum->GetUniformVariate( -1000.0, 1000.0 ) ) );
+  }
+
+  /** Smooth with and without skipping the first dimension. */
+  for( unsigned int skip = 0; skip < 2; ++skip )
+  {
+    SigmaArrayType sigma;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      sigma[ i ] = ( skip == 1 && i == 0 ) ? 0.0 : 2.0 + i;
+    }
+
+    /** The reference: one RecursiveGaussianImageFilter per smoothed dimension. */
+    typename CasterType::Pointer caster = CasterType::New();
+    caster->SetInput( image );
+    typename OutputImageType::Pointer reference = caster->GetOutput();
+    itk::TimeProbe timer;
+    timer.Start();
+    caster->Update();
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      if( sigma[ i ] == 0.0 ) { continue; }
+      typename SmootherType::Pointer smoother = SmootherType::New();
+      smoother->SetDirection( i );
+      smoother->SetZeroOrder();
+      smoother->SetNormalizeAcrossScale( false );
+      smoother->SetSigma( sigma[ i ] );
+      smoother->SetInput( reference );
+      smoother->Update();
+      reference = smoother->GetOutput();
+    }
+    timer.Stop();
+
+    for( unsigned int threads = 1; threads <= 8; threads *= 2 )
+    {
+      for( unsigned int tileSize = 1; tileSize <= 16; tileSize *= 4 )
+      {
+        typename ParallelSmootherType::Pointer parallelSmoother = ParallelSmootherType::New();
+        parallelSmoother->SetSigmaArray( sigma );
+        parallelSmoother->SetTileSize( tileSize );
+        parallelSmoother->SetNumberOfWorkUnits( threads );
+        parallelSmoother->SetInput( image );
+        itk::TimeProbe parallelTimer;
+        parallelTimer.Start();
+        parallelSmoother->Update();
+        parallelTimer.Stop();
+
+        OutputIteratorType rit( reference, reference->GetLargestPossibleRegion() );
+        OutputIteratorType pit( parallelSmoother->GetOutput(),
+          parallelSmoother->GetOutput()->GetLargestPossibleRegion() );
+        double maxDifference = 0.0;
+        for( rit.GoToBegin(), pit.GoToBegin(); !rit.IsAtEnd(); ++rit, ++pit )
+        {
+          maxDifference = std::max( maxDifference, std::abs( rit.Get() - pit.Get() ) );
+        }
+
+        std::cout << Dimension << "D, skip " << skip << ", " << threads << " threads, tile size "
+                  << tileSize << ": max difference " << maxDifference << ", time "
+                  << timer.GetMean() << " s (ITK) vs "
+                  << parallelTimer.GetMean() << " s (parallel)." << std::endl;
+        if( maxDifference > 1e-8 )
+        {
+          std::cerr << "ERROR: the result differs from the RecursiveGaussianImageFilter." << std::endl;
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+
+} // end TestParallelRecursiveGaussian()
+
+
+int
+main( int argc, char ** argv )
+{
+  // 2D tests
+  bool success = TestParallelRecursiveGaussian< 2 >();
+  if( !success ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  success = TestParallelRecursiveGaussian< 3 >();
+  if( !success ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+} // end main
@@ -0,0 +1,151 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the mutual information computed with single precision
+ per-thread joint histograms with the one computed in double precision.
+
+ The accumulator type is selected at compile time, by
+ ELASTIX_USE_SINGLE_PRECISION_ACCUMULATORS. This unit is compiled without it;
+ itkParzenWindowAccumulatorPrecisionTestSinglePrecision.cxx with it. The
+ fixed image is float here and double there, with the same values, so that
+ both metrics can be linked into one executable. The value and the derivative
+ should agree up to a relative tolerance, with one and with several threads.
+ */
+
+#ifdef ELASTIX_USE_SINGLE_PRECISION_ACCUMULATORS
+#undef ELASTIX_USE_SINGLE_PRECISION_ACCUMULATORS
+#endif
+
+#include "itkParzenWindowAccumulatorPrecisionTest.h"
+
+#include "itkCastImageFilter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+typedef itk::Image< float, Dimension >                         DoublePrecisionFixedImageType;
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+
+/** Create a smooth image, with a pattern that depends on the phase. */
+MovingImageType::Pointer
+CreateImage( const unsigned int imageSize, const double phase )
+{
+  MovingImageType::SizeType size;
+  size.Fill( imageSize );
+  MovingImageType::Pointer image = MovingImageType::New();
+  image->SetRegions( MovingImageType::RegionType( size ) );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< MovingImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const double x = it.GetIndex()[ 0 ] - 0.5 * imageSize;
+    const double y = it.GetIndex()[ 1 ] - 0.5 * imageSize;
+    it.Set( static_cast< float >( 100.0 * std::exp( -( x * x + y * y ) / 200.0 )
+      + 30.0 * std::sin( 0.3 * x + phase ) * std::cos( 0.2 * y ) ) );
+  }
+  return image;
+}
+
+
+int
+main( int argc, char * argv[] )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  /** The fixed image, also as a double image with the same values. */
+  DoublePrecisionFixedImageType::Pointer fixedImage  = CreateImage( 64, 0.0 );
+  MovingImageType::Pointer               movingImage = CreateImage( 64, 0.5 );
+  typedef itk::CastImageFilter< DoublePrecisionFixedImageType, SinglePrecisionFixedImageType > CastFilterType;
+  CastFilterType::Pointer caster = CastFilterType::New();
+  caster->SetInput( fixedImage );
+  caster->Update();
+  SinglePrecisionFixedImageType::Pointer castFixedImage = caster->GetOutput();
+
+  /** A B-spline transform with random coefficients. */
+  BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  BSplineTransformType::OriginType origin;
+  origin.Fill( -16.0 );
+  BSplineTransformType::SpacingType spacing;
+  spacing.Fill( 16.0 );
+  BSplineTransformType::RegionType::SizeType gridSize;
+  gridSize.Fill( 7 );
+  BSplineTransformType::DirectionType direction;
+  direction.SetIdentity();
+  bsplineTransform->SetGridOrigin( origin );
+  bsplineTransform->SetGridSpacing( spacing );
+  bsplineTransform->SetGridRegion( BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( direction );
+  CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 454545 );
+  CombinationTransformType::ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = random->GetUniformVariate( -2.0, 2.0 );
+  }
+  transform->SetParameters( parameters );
+
+  /** The float sums are rounded, so compare with a relative tolerance. */
+  const double       tolerance           = 1e-5;
+  const unsigned int numberOfWorkUnits[] = { 1, 4 };
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    const MetricResultType reference = EvaluateMutualInformation< DoublePrecisionFixedImageType >(
+      fixedImage, movingImage, transform, numberOfWorkUnits[ t ] );
+    const MetricResultType single = EvaluateWithSinglePrecisionAccumulators(
+      castFixedImage, movingImage, transform, numberOfWorkUnits[ t ] );
+
+    const double valueError = std::abs( single.st_Value - reference.st_Value )
+      / std::abs( reference.st_Value );
+    const double valueOnlyError = std::abs( single.st_ValueOnly - reference.st_ValueOnly )
+      / std::abs( reference.st_ValueOnly );
+    const double derivativeError = ( single.st_Derivative - reference.st_Derivative ).magnitude()
+      / reference.st_Derivative.magnitude();
+
+    std::cout << std::setprecision( 12 ) << numberOfWorkUnits[ t ] << " work unit(s): value "
+              << single.st_Value << " (double " << reference.st_Value << "), relative errors: value "
+              << valueError << ", GetValue " << valueOnlyError << ", derivative " << derivativeError
+              << std::endl;
+
+    if( !( reference.st_Value != 0.0 ) || !( reference.st_Derivative.magnitude() > 0.0 ) )
+    {
+      std::cerr << "ERROR: the mutual information or its derivative is zero." << std::endl;
+      return EXIT_FAILURE;
+    }
+    if( !( valueError < tolerance ) || !( valueOnlyError < tolerance ) || !( derivativeError < tolerance ) )
+    {
+      std::cerr << "ERROR: the single precision accumulators differ from the double precision ones "
+                << "by more than " << tolerance << "." << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
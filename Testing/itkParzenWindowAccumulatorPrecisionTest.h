@@ -0,0 +1,115 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+#ifndef itkParzenWindowAccumulatorPrecisionTest_h
+#define itkParzenWindowAccumulatorPrecisionTest_h
+
+/** \file
+ \brief The evaluation of the mutual information for the accumulator
+ precision test.
+
+ This header is included by two translation units: one with, and one without
+ ELASTIX_USE_SINGLE_PRECISION_ACCUMULATORS defined. To keep the two metric
+ classes distinct, the fixed image type differs between the units.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+
+#include "itkArray.h"
+#include "itkImage.h"
+
+//-------------------------------------------------------------------------------------
+
+/** Some basic type definitions, common to both translation units. */
+const unsigned int Dimension = 2;
+typedef itk::Image< float, Dimension >                        MovingImageType;
+typedef itk::Image< double, Dimension >                       SinglePrecisionFixedImageType;
+typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > BSplineTransformType;
+typedef itk::AdvancedCombinationTransform< double, Dimension > CombinationTransformType;
+typedef itk::BSplineInterpolateImageFunction<
+  MovingImageType, double, double >                           InterpolatorType;
+
+/** The result of a metric evaluation. */
+struct MetricResultType
+{
+  double               st_Value;
+  double               st_ValueOnly;
+  itk::Array< double > st_Derivative;
+};
+
+/** Evaluate the mutual information with the per-thread joint histograms in
+ * float. Defined in the translation unit with single precision accumulators.
+ */
+MetricResultType
+EvaluateWithSinglePrecisionAccumulators( SinglePrecisionFixedImageType * fixedImage,
+  MovingImageType * movingImage, CombinationTransformType * transform,
+  const unsigned int numberOfWorkUnits );
+
+/** Evaluate the value, and the value and derivative, of the mutual information. */
+template< class TFixedImage >
+MetricResultType
+EvaluateMutualInformation( TFixedImage * fixedImage, MovingImageType * movingImage,
+  CombinationTransformType * transform, const unsigned int numberOfWorkUnits )
+{
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+    TFixedImage, MovingImageType >                            MetricType;
+  typedef itk::ImageFullSampler< TFixedImage >                SamplerType;
+
+  typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetSplineOrder( 3 );
+  typename SamplerType::Pointer sampler = SamplerType::New();
+
+  /** The low memory derivative computes the histograms with the per-thread
+   * joint PDFs, as the value does.
+   */
+  typename MetricType::Pointer metric = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( interpolator );
+  metric->SetImageSampler( sampler );
+  metric->SetNumberOfFixedHistogramBins( 32 );
+  metric->SetNumberOfMovingHistogramBins( 32 );
+  metric->SetUseExplicitPDFDerivatives( false );
+  metric->SetUseMultiThread( true );
+  metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+  metric->SetRequiredRatioOfValidSamples( 0.1 );
+  metric->Initialize();
+
+  MetricResultType                   result;
+  typename MetricType::DerivativeType derivative;
+  typename MetricType::MeasureType    value = 0.0;
+  metric->GetValueAndDerivative( transform->GetParameters(), value, derivative );
+  result.st_Value      = value;
+  result.st_ValueOnly  = metric->GetValue( transform->GetParameters() );
+  result.st_Derivative = derivative;
+  return result;
+
+} // end EvaluateMutualInformation()
+
+
+#endif // end #ifndef itkParzenWindowAccumulatorPrecisionTest_h
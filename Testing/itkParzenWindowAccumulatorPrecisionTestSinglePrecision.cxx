@@ -0,0 +1,41 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief The single precision half of the ParzenWindowAccumulatorPrecisionTest.
+
+ The per-thread joint histograms of the metric are float in this unit,
+ whatever the CMake option ELASTIX_USE_SINGLE_PRECISION_ACCUMULATORS is.
+ */
+
+#ifndef ELASTIX_USE_SINGLE_PRECISION_ACCUMULATORS
+#define ELASTIX_USE_SINGLE_PRECISION_ACCUMULATORS
+#endif
+
+#include "itkParzenWindowAccumulatorPrecisionTest.h"
+
+//-------------------------------------------------------------------------------------
+
+MetricResultType
+EvaluateWithSinglePrecisionAccumulators( SinglePrecisionFixedImageType * fixedImage,
+  MovingImageType * movingImage, CombinationTransformType * transform,
+  const unsigned int numberOfWorkUnits )
+{
+  return EvaluateMutualInformation< SinglePrecisionFixedImageType >(
+    fixedImage, movingImage, transform, numberOfWorkUnits );
+
+} // end EvaluateWithSinglePrecisionAccumulators()
@@ -0,0 +1,351 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the specialized sample evaluators of the metrics with the
+ default evaluator.
+
+ For a recursive B-spline transform, composed with an affine initial
+ transform, and a B-spline and a linear interpolator, the value and the
+ derivative of the mean squares, normalized correlation and mutual
+ information metrics should be the same with the specialized evaluator as
+ with the default one, in 2D and 3D, with one and with several threads.
+ A metric that overrides TransformPoint() should not use the specialized
+ evaluator, and its override should be called.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkImageFullSampler.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iomanip>
+#include <string>
+
+//-------------------------------------------------------------------------------------
+
+/** A metric that reports which sample evaluator it selected, and that can
+ * override TransformPoint() with a shift of the mapped point.
+ */
+template< class TMetric >
+class SampleEvaluatorTestMetric : public TMetric
+{
+public:
+
+  typedef SampleEvaluatorTestMetric       Self;
+  typedef TMetric                         Superclass;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+  itkNewMacro( Self );
+
+  typedef typename Superclass::FixedImagePointType  FixedImagePointType;
+  typedef typename Superclass::MovingImagePointType MovingImagePointType;
+
+  itkSetMacro( OverrideTransformPoint, bool );
+
+  bool GetUsesSpecializedSampleEvaluator( void ) const
+  {
+    return this->m_SampleEvaluator != Superclass::DefaultSampleEvaluatorId;
+  }
+
+
+protected:
+
+  SampleEvaluatorTestMetric() : m_OverrideTransformPoint( false ) {}
+  ~SampleEvaluatorTestMetric() override {}
+
+  bool GetSampleEvaluationIsOverridden( void ) const override
+  {
+    return this->m_OverrideTransformPoint;
+  }
+
+
+  bool TransformPoint( const FixedImagePointType & fixedImagePoint,
+    MovingImagePointType & mappedPoint ) const override
+  {
+    const bool valid = Superclass::TransformPoint( fixedImagePoint, mappedPoint );
+    if( this->m_OverrideTransformPoint )
+    {
+      mappedPoint[ 0 ] += 0.7;
+    }
+    return valid;
+  }
+
+
+private:
+
+  bool m_OverrideTransformPoint;
+};
+
+//-------------------------------------------------------------------------------------
+
+/** The result of a metric evaluation. */
+struct MetricResultType
+{
+  double               st_Value;
+  itk::Array< double > st_Derivative;
+  bool                 st_Specialized;
+};
+
+/** Use the low memory derivative of the mutual information, which loops over
+ * the samples with the sample evaluator; other metrics are left unchanged.
+ */
+template< class TMetric >
+void
+ConfigureMetric( TMetric * )
+{}
+
+template< class TFixedImage, class TMovingImage >
+void
+ConfigureMetric( itk::ParzenWindowMutualInformationImageToImageMetric< TFixedImage, TMovingImage > * metric )
+{
+  metric->SetUseExplicitPDFDerivatives( false );
+}
+
+/** Create a smooth image, with a pattern that depends on the phase. */
+template< class TImage >
+typename TImage::Pointer
+CreateImage( const unsigned int imageSize, const double phase )
+{
+  typename TImage::SizeType size;
+  size.Fill( imageSize );
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions( typename TImage::RegionType( size ) );
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< TImage > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    double value = 0.0;
+    for( unsigned int i = 0; i < TImage::ImageDimension; ++i )
+    {
+      const double x = it.GetIndex()[ i ] - 0.5 * imageSize;
+      value += 40.0 * std::sin( 0.25 * x + phase * ( i + 1 ) ) + 0.2 * x * x;
+    }
+    it.Set( static_cast< typename TImage::PixelType >( value ) );
+  }
+  return image;
+}
+
+
+/** Evaluate the metric, with or without the specialized sample evaluator. */
+template< class TMetric, class TImage, class TTransform, class TInterpolator >
+MetricResultType
+EvaluateMetric( TImage * fixedImage, TImage * movingImage, TTransform * transform,
+  const unsigned int numberOfWorkUnits, const bool useSpecializedSampleEvaluator,
+  const bool overrideTransformPoint )
+{
+  typedef SampleEvaluatorTestMetric< TMetric > MetricType;
+  typedef itk::ImageFullSampler< TImage >      SamplerType;
+
+  typename TInterpolator::Pointer interpolator = TInterpolator::New();
+  typename SamplerType::Pointer   sampler      = SamplerType::New();
+  typename MetricType::Pointer    metric       = MetricType::New();
+  metric->SetFixedImage( fixedImage );
+  metric->SetMovingImage( movingImage );
+  metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+  metric->SetTransform( transform );
+  metric->SetInterpolator( interpolator );
+  metric->SetImageSampler( sampler );
+  metric->SetUseMultiThread( numberOfWorkUnits > 1 );
+  metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+  metric->SetUseSpecializedSampleEvaluator( useSpecializedSampleEvaluator );
+  metric->SetOverrideTransformPoint( overrideTransformPoint );
+  metric->SetRequiredRatioOfValidSamples( 0.1 );
+  ConfigureMetric( static_cast< TMetric * >( metric.GetPointer() ) );
+  metric->Initialize();
+
+  MetricResultType result;
+  typename MetricType::DerivativeType derivative;
+  typename MetricType::MeasureType    value = 0.0;
+  metric->GetValueAndDerivative( transform->GetParameters(), value, derivative );
+  result.st_Value       = value;
+  result.st_Derivative  = derivative;
+  result.st_Specialized = metric->GetUsesSpecializedSampleEvaluator();
+  return result;
+
+} // end EvaluateMetric()
+
+
+/** Compare the specialized and the default evaluator for a metric and interpolator. */
+template< class TMetric, class TImage, class TTransform, class TInterpolator >
+bool
+CompareSampleEvaluators( const std::string & name, TImage * fixedImage, TImage * movingImage,
+  TTransform * transform )
+{
+  const unsigned int numberOfWorkUnits[] = { 1, 3 };
+  for( unsigned int t = 0; t < 2; ++t )
+  {
+    const MetricResultType reference = EvaluateMetric< TMetric, TImage, TTransform, TInterpolator >(
+      fixedImage, movingImage, transform, numberOfWorkUnits[ t ], false, false );
+    const MetricResultType specialized = EvaluateMetric< TMetric, TImage, TTransform, TInterpolator >(
+      fixedImage, movingImage, transform, numberOfWorkUnits[ t ], true, false );
+
+    const double valueError = std::abs( specialized.st_Value - reference.st_Value )
+      / std::abs( reference.st_Value );
+    const double derivativeError = ( specialized.st_Derivative - reference.st_Derivative ).magnitude()
+      / reference.st_Derivative.magnitude();
+
+    std::cout << std::setprecision( 12 ) << TImage::ImageDimension << "D, " << name << ", "
+              << numberOfWorkUnits[ t ] << " work unit(s): value " << specialized.st_Value
+              << " (default " << reference.st_Value << "), relative errors: value " << valueError
+              << ", derivative " << derivativeError << std::endl;
+
+    if( reference.st_Specialized || !specialized.st_Specialized )
+    {
+      std::cerr << "ERROR: the specialized sample evaluator was not selected as expected." << std::endl;
+      return false;
+    }
+    if( !( valueError < 1e-10 ) || !( derivativeError < 1e-10 ) )
+    {
+      std::cerr << "ERROR: the specialized sample evaluator differs from the default one." << std::endl;
+      return false;
+    }
+
+    /** An overridden TransformPoint() should disable the specialized evaluator. */
+    const MetricResultType overridden = EvaluateMetric< TMetric, TImage, TTransform, TInterpolator >(
+      fixedImage, movingImage, transform, numberOfWorkUnits[ t ], true, true );
+    const MetricResultType overriddenReference = EvaluateMetric< TMetric, TImage, TTransform, TInterpolator >(
+      fixedImage, movingImage, transform, numberOfWorkUnits[ t ], false, true );
+    if( overridden.st_Specialized
+      || overridden.st_Value != overriddenReference.st_Value
+      || overridden.st_Value == reference.st_Value )
+    {
+      std::cerr << "ERROR: the overridden TransformPoint() was not used." << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+
+} // end CompareSampleEvaluators()
+
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestSampleEvaluators( const unsigned int imageSize )
+{
+  typedef itk::Image< float, Dimension >                                   ImageType;
+  typedef itk::RecursiveBSplineTransform< double, Dimension, 3 >           BSplineTransformType;
+  typedef itk::AdvancedMatrixOffsetTransformBase< double, Dimension, Dimension > AffineTransformType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension >           CombinationTransformType;
+  typedef itk::BSplineInterpolateImageFunction< ImageType, double, double > BSplineInterpolatorType;
+  typedef itk::AdvancedLinearInterpolateImageFunction< ImageType, double > LinearInterpolatorType;
+  typedef itk::AdvancedMeanSquaresImageToImageMetric< ImageType, ImageType > MeanSquaresMetricType;
+  typedef itk::AdvancedNormalizedCorrelationImageToImageMetric<
+    ImageType, ImageType >                                                 NormalizedCorrelationMetricType;
+  typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+    ImageType, ImageType >                                                 MutualInformationMetricType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator           RandomGeneratorType;
+
+  typename ImageType::Pointer fixedImage  = CreateImage< ImageType >( imageSize, 0.0 );
+  typename ImageType::Pointer movingImage = CreateImage< ImageType >( imageSize, 0.4 );
+
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 787878 + Dimension );
+
+  /** An affine initial transform, close to the identity. */
+  typename AffineTransformType::Pointer affine = AffineTransformType::New();
+  typename AffineTransformType::ParametersType affineParameters = affine->GetParameters();
+  for( unsigned int i = 0; i < Dimension * Dimension; ++i )
+  {
+    affineParameters[ i ] += random->GetUniformVariate( -0.03, 0.03 );
+  }
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    affineParameters[ Dimension * Dimension + i ] = random->GetUniformVariate( -1.0, 1.0 );
+  }
+  affine->SetParameters( affineParameters );
+
+  /** A B-spline grid that covers the image, with random coefficients. */
+  typename BSplineTransformType::OriginType          gridOrigin;
+  typename BSplineTransformType::SpacingType         gridSpacing;
+  typename BSplineTransformType::RegionType::SizeType gridSize;
+  typename BSplineTransformType::DirectionType       gridDirection;
+  gridDirection.SetIdentity();
+  gridSpacing.Fill( 6.0 );
+  gridOrigin.Fill( -8.0 );
+  gridSize.Fill( imageSize / 6 + 5 );
+  typename BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridRegion( typename BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( gridDirection );
+
+  typename CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+  transform->SetInitialTransform( affine );
+  typename CombinationTransformType::ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = random->GetUniformVariate( -1.5, 1.5 );
+  }
+  transform->SetParameters( parameters );
+
+  /** Compare for all metrics and interpolators. */
+  bool success = true;
+  success &= CompareSampleEvaluators< MeanSquaresMetricType, ImageType, CombinationTransformType,
+    BSplineInterpolatorType >( "mean squares, B-spline interpolator", fixedImage, movingImage, transform );
+  success &= CompareSampleEvaluators< MeanSquaresMetricType, ImageType, CombinationTransformType,
+    LinearInterpolatorType >( "mean squares, linear interpolator", fixedImage, movingImage, transform );
+  success &= CompareSampleEvaluators< NormalizedCorrelationMetricType, ImageType, CombinationTransformType,
+    BSplineInterpolatorType >( "normalized correlation, B-spline interpolator", fixedImage, movingImage, transform );
+  success &= CompareSampleEvaluators< MutualInformationMetricType, ImageType, CombinationTransformType,
+    BSplineInterpolatorType >( "mutual information, B-spline interpolator", fixedImage, movingImage, transform );
+  success &= CompareSampleEvaluators< MutualInformationMetricType, ImageType, CombinationTransformType,
+    LinearInterpolatorType >( "mutual information, linear interpolator", fixedImage, movingImage, transform );
+
+  return success;
+
+} // end TestSampleEvaluators()
+
+
+int
+main( int argc, char ** argv )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  // 2D tests
+  bool success = TestSampleEvaluators< 2 >( 40 );
+  if( !success ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  success = TestSampleEvaluators< 3 >( 16 );
+  if( !success ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+} // end main
@@ -0,0 +1,858 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/** This benchmark times the hot paths of a registration:
+ * transform point and Jacobian evaluation, interpolation, sampling, the
+ * GetValueAndDerivative() of the metrics, the optimizer update, pyramid
+ * generation and resampling. It sweeps the image size, the B-spline grid
+ * spacing and the number of threads, and writes the results in the
+ * google-benchmark JSON format. Use elx_compare_benchmarks.py to compare
+ * the results of two versions.
+ *
+ * The metrics are the pairwise image metrics and the transform penalties
+ * that are evaluated on samples or on the B-spline grid. Not included are
+ * the groupwise metrics, which need a stack of images along the last
+ * dimension, the point set metrics, the KNN metric, which depends on the
+ * optional ANN library and has its own test, and the gradient difference
+ * and pattern intensity metrics, which compute their derivative with finite
+ * differences over all transform parameters.
+ */
+
+#include "itkBenchmarkHarness.h"
+#include "itkCommandLineArgumentParser.h"
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkRecursiveBSplineTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkAdvancedMatrixOffsetTransformBase.h"
+#include "itkAdvancedTranslationTransform.h"
+#include "itkBSplineInterpolateImageFunction.h"
+#include "itkAdvancedLinearInterpolateImageFunction.h"
+#include "itkImageRandomSampler.h"
+#include "itkImageGridSampler.h"
+#include "itkImageFullSampler.h"
+#include "itkImageMaskSpatialObject.h"
+#include "itkImageMaskLookup.h"
+#include "itkHardLimiterFunction.h"
+#include "itkExponentialLimiterFunction.h"
+#include "AdvancedMeanSquares/itkAdvancedMeanSquaresImageToImageMetric.h"
+#include "AdvancedNormalizedCorrelation/itkAdvancedNormalizedCorrelationImageToImageMetric.h"
+#include "AdvancedMattesMutualInformation/itkParzenWindowMutualInformationImageToImageMetric.h"
+#include "NormalizedMutualInformation/itkParzenWindowNormalizedMutualInformationImageToImageMetric.h"
+#include "AdvancedKappaStatistic/itkAdvancedKappaStatisticImageToImageMetric.h"
+#include "SumSquaredTissueVolumeDifferenceMetric/itkSumSquaredTissueVolumeDifferenceImageToImageMetric.h"
+#include "BendingEnergyPenalty/itkTransformBendingEnergyPenaltyTerm.h"
+#include "DisplacementMagnitudePenalty/itkDisplacementMagnitudePenaltyTerm.h"
+#include "RigidityPenalty/itkTransformRigidityPenaltyTerm.h"
+#include "itkOptimizerVectorKernels.h"
+#include "itkPlatformMultiThreader.h"
+#include "itkGenericMultiResolutionPyramidImageFilter.h"
+#include "itkResampleImageFilter.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+//-------------------------------------------------------------------------------------
+
+namespace
+{
+
+/** Some basic type definitions. */
+const unsigned int Dimension   = 3;
+const unsigned int SplineOrder = 3;
+typedef double CoordinateRepresentationType;
+typedef float  PixelType;
+
+typedef itk::Image< PixelType, Dimension > ImageType;
+typedef itk::AdvancedBSplineDeformableTransform<
+  CoordinateRepresentationType, Dimension, SplineOrder >    BSplineTransformType;
+typedef itk::RecursiveBSplineTransform<
+  CoordinateRepresentationType, Dimension, SplineOrder >    RecursiveBSplineTransformType;
+typedef itk::AdvancedCombinationTransform<
+  CoordinateRepresentationType, Dimension >                 CombinationTransformType;
+typedef itk::AdvancedMatrixOffsetTransformBase<
+  CoordinateRepresentationType, Dimension, Dimension >      AffineTransformType;
+typedef itk::AdvancedTranslationTransform<
+  CoordinateRepresentationType, Dimension >                 TranslationTransformType;
+typedef BSplineTransformType::ParametersType                ParametersType;
+typedef BSplineTransformType::InputPointType                PointType;
+typedef BSplineTransformType::JacobianType                  JacobianType;
+typedef BSplineTransformType::NonZeroJacobianIndicesType    NonZeroJacobianIndicesType;
+typedef BSplineTransformType::DerivativeType                DerivativeType;
+typedef BSplineTransformType::MovingImageGradientType       MovingImageGradientType;
+
+typedef itk::BSplineInterpolateImageFunction<
+  ImageType, CoordinateRepresentationType, double >         BSplineInterpolatorType;
+typedef itk::AdvancedLinearInterpolateImageFunction<
+  ImageType, CoordinateRepresentationType >                 LinearInterpolatorType;
+typedef BSplineInterpolatorType::ContinuousIndexType        ContinuousIndexType;
+
+typedef itk::ImageRandomSampler< ImageType >                RandomSamplerType;
+typedef itk::ImageGridSampler< ImageType >                  GridSamplerType;
+typedef itk::ImageFullSampler< ImageType >                  FullSamplerType;
+typedef itk::ImageMaskSpatialObject< Dimension >            MaskSpatialObjectType;
+typedef MaskSpatialObjectType::ImageType                    MaskImageType;
+typedef itk::ImageMaskLookup< Dimension >                   MaskLookupType;
+
+typedef itk::AdvancedMeanSquaresImageToImageMetric<
+  ImageType, ImageType >                                    MeanSquaresMetricType;
+typedef itk::AdvancedNormalizedCorrelationImageToImageMetric<
+  ImageType, ImageType >                                    NormalizedCorrelationMetricType;
+typedef itk::ParzenWindowMutualInformationImageToImageMetric<
+  ImageType, ImageType >                                    MutualInformationMetricType;
+typedef itk::ParzenWindowNormalizedMutualInformationImageToImageMetric<
+  ImageType, ImageType >                                    NormalizedMutualInformationMetricType;
+typedef itk::AdvancedKappaStatisticImageToImageMetric<
+  ImageType, ImageType >                                    KappaStatisticMetricType;
+typedef itk::SumSquaredTissueVolumeDifferenceImageToImageMetric<
+  ImageType, ImageType >                                    TissueVolumeDifferenceMetricType;
+typedef itk::TransformBendingEnergyPenaltyTerm<
+  ImageType, CoordinateRepresentationType >                 BendingEnergyPenaltyType;
+typedef itk::DisplacementMagnitudePenaltyTerm<
+  ImageType, CoordinateRepresentationType >                 DisplacementMagnitudePenaltyType;
+typedef itk::TransformRigidityPenaltyTerm<
+  ImageType, CoordinateRepresentationType >                 RigidityPenaltyType;
+
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
+typedef itk::PlatformMultiThreader                             ThreaderType;
+typedef itk::BenchmarkHarness                                  HarnessType;
+typedef HarnessType::FunctionType                              FunctionType;
+typedef HarnessType::ParameterListType                         ParameterListType;
+
+/** The number of points per call in the point-wise benchmarks. */
+const unsigned int NumberOfPoints = 1000;
+
+/**
+ * ******************* CreateImage ***********************
+ *
+ * A smooth synthetic image: a blob plus a low-frequency pattern. The moving
+ * image is a shifted version of the fixed image.
+ */
+
+ImageType::Pointer
+CreateImage( const unsigned int size, const double shift )
+{
+  ImageType::SizeType imageSize;
+  imageSize.Fill( size );
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions( ImageType::RegionType( imageSize ) );
+  image->Allocate();
+
+  const double center = 0.5 * size + shift;
+  const double sigma2 = 0.1 * size * size;
+  itk::ImageRegionIteratorWithIndex< ImageType > it( image, image->GetLargestPossibleRegion() );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    const ImageType::IndexType & index = it.GetIndex();
+    double                       r2    = 0.0;
+    double                       wave  = 0.0;
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      const double x = index[ d ] - center;
+      r2   += x * x;
+      wave += std::sin( 0.2 * ( index[ d ] - shift ) );
+    }
+    it.Set( static_cast< PixelType >( 1000.0 * std::exp( -r2 / sigma2 ) + 50.0 * wave ) );
+  }
+
+  return image;
+
+} // end CreateImage()
+
+
+/**
+ * ******************* CreateBSplineTransform ***********************
+ *
+ * A B-spline transform covering an image of the given size, with the given
+ * grid spacing in voxels and random parameters.
+ */
+
+template< class TTransform >
+typename TTransform::Pointer
+CreateBSplineTransform( const unsigned int size, const unsigned int gridSpacing )
+{
+  typedef typename TTransform::RegionType RegionType;
+  typename RegionType::SizeType gridSize;
+  gridSize.Fill( ( size + gridSpacing - 1 ) / gridSpacing + SplineOrder );
+  typename TTransform::SpacingType spacing;
+  spacing.Fill( gridSpacing );
+  typename TTransform::OriginType origin;
+  origin.Fill( -static_cast< double >( gridSpacing ) );
+  typename TTransform::DirectionType direction;
+  direction.SetIdentity();
+
+  typename TTransform::Pointer transform = TTransform::New();
+  transform->SetGridOrigin( origin );
+  transform->SetGridSpacing( spacing );
+  transform->SetGridRegion( RegionType( gridSize ) );
+  transform->SetGridDirection( direction );
+
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 121212 );
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = random->GetUniformVariate( -0.5, 0.5 );
+  }
+  transform->SetParametersByValue( parameters );
+
+  return transform;
+
+} // end CreateBSplineTransform()
+
+
+/**
+ * ******************* CreatePoints ***********************
+ */
+
+std::shared_ptr< std::vector< PointType > >
+CreatePoints( const unsigned int size )
+{
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 343434 );
+  std::shared_ptr< std::vector< PointType > > points( new std::vector< PointType >( NumberOfPoints ) );
+  for( unsigned int i = 0; i < NumberOfPoints; ++i )
+  {
+    for( unsigned int d = 0; d < Dimension; ++d )
+    {
+      ( *points )[ i ][ d ] = random->GetUniformVariate( 1.0, size - 2.0 );
+    }
+  }
+  return points;
+
+} // end CreatePoints()
+
+
+/**
+ * ******************* AddTransformBenchmarks ***********************
+ */
+
+template< class TTransform >
+void
+AddTransformBenchmarks( HarnessType * harness, const std::string & name,
+  const unsigned int size, const unsigned int gridSpacing )
+{
+  const ParameterListType parameters = { { "size", size }, { "spacing", gridSpacing } };
+
+  harness->AddBenchmark( "TransformPoint/" + name, parameters, [ size, gridSpacing ]()
+  {
+    typename TTransform::Pointer transform = CreateBSplineTransform< TTransform >( size, gridSpacing );
+    std::shared_ptr< std::vector< PointType > > points = CreatePoints( size );
+    return FunctionType( [ transform, points ]()
+    {
+      double sum = 0.0;
+      for( unsigned int i = 0; i < NumberOfPoints; ++i )
+      {
+        sum += transform->TransformPoint( ( *points )[ i ] )[ 0 ];
+      }
+      itkAssertOrThrowMacro( std::isfinite( sum ), "Invalid transformed point" );
+    } );
+  }, NumberOfPoints, false );
+
+  harness->AddBenchmark( "Jacobian/" + name, parameters, [ size, gridSpacing ]()
+  {
+    typename TTransform::Pointer transform = CreateBSplineTransform< TTransform >( size, gridSpacing );
+    std::shared_ptr< std::vector< PointType > > points = CreatePoints( size );
+    const unsigned int nnzji = transform->GetNumberOfNonZeroJacobianIndices();
+    std::shared_ptr< JacobianType > jacobian( new JacobianType( Dimension, nnzji ) );
+    std::shared_ptr< NonZeroJacobianIndicesType > nzji( new NonZeroJacobianIndicesType( nnzji ) );
+    return FunctionType( [ transform, points, jacobian, nzji ]()
+    {
+      for( unsigned int i = 0; i < NumberOfPoints; ++i )
+      {
+        transform->GetJacobian( ( *points )[ i ], *jacobian, *nzji );
+      }
+    } );
+  }, NumberOfPoints, false );
+
+  harness->AddBenchmark( "JacobianGradient/" + name, parameters, [ size, gridSpacing ]()
+  {
+    typename TTransform::Pointer transform = CreateBSplineTransform< TTransform >( size, gridSpacing );
+    std::shared_ptr< std::vector< PointType > > points = CreatePoints( size );
+    const unsigned int nnzji = transform->GetNumberOfNonZeroJacobianIndices();
+    std::shared_ptr< DerivativeType > imageJacobian( new DerivativeType( nnzji ) );
+    std::shared_ptr< NonZeroJacobianIndicesType > nzji( new NonZeroJacobianIndicesType( nnzji ) );
+    MovingImageGradientType movingImageGradient;
+    movingImageGradient[ 0 ] = 29.43; movingImageGradient[ 1 ] = 18.21; movingImageGradient[ 2 ] = 1.7;
+    return FunctionType( [ transform, points, imageJacobian, nzji, movingImageGradient ]()
+    {
+      for( unsigned int i = 0; i < NumberOfPoints; ++i )
+      {
+        transform->EvaluateJacobianWithImageGradientProduct(
+          ( *points )[ i ], movingImageGradient, *imageJacobian, *nzji );
+      }
+    } );
+  }, NumberOfPoints, false );
+
+} // end AddTransformBenchmarks()
+
+
+/**
+ * ******************* AddCombinationTransformBenchmarks ***********************
+ *
+ * A multi-stage transform, as in elastix with several parameter files:
+ * translation, affine, B-spline and B-spline, with and without flattening
+ * the chain of initial transforms.
+ */
+
+void
+AddCombinationTransformBenchmarks( HarnessType * harness,
+  const unsigned int size, const unsigned int gridSpacing )
+{
+  for( unsigned int flattened = 0; flattened < 2; ++flattened )
+  {
+    const ParameterListType parameters
+      = { { "size", size }, { "spacing", gridSpacing }, { "flattened", flattened } };
+    harness->AddBenchmark( "TransformPoint/CombinationChain", parameters, [ size, gridSpacing, flattened ]()
+    {
+      TranslationTransformType::Pointer translation = TranslationTransformType::New();
+      TranslationTransformType::ParametersType translationParameters( Dimension );
+      translationParameters.Fill( 1.5 );
+      translation->SetParameters( translationParameters );
+
+      AffineTransformType::Pointer affine = AffineTransformType::New();
+      AffineTransformType::ParametersType affineParameters = affine->GetParameters();
+      affineParameters[ 1 ] = 0.05;
+      affineParameters[ Dimension * Dimension ] = -2.0;
+      affine->SetParameters( affineParameters );
+
+      CombinationTransformType::Pointer stage0 = CombinationTransformType::New();
+      stage0->SetCurrentTransform( translation );
+      CombinationTransformType::Pointer stage1 = CombinationTransformType::New();
+      stage1->SetCurrentTransform( affine );
+      stage1->SetInitialTransform( stage0 );
+      CombinationTransformType::Pointer stage2 = CombinationTransformType::New();
+      stage2->SetCurrentTransform( CreateBSplineTransform< RecursiveBSplineTransformType >( size, gridSpacing ) );
+      stage2->SetInitialTransform( stage1 );
+      CombinationTransformType::Pointer transform = CombinationTransformType::New();
+      transform->SetCurrentTransform( CreateBSplineTransform< RecursiveBSplineTransformType >( size, gridSpacing ) );
+      transform->SetInitialTransform( stage2 );
+      if( flattened )
+      {
+        transform->UpdateFlattenedInitialTransform();
+      }
+
+      std::shared_ptr< std::vector< PointType > > points = CreatePoints( size );
+      return FunctionType( [ transform, points ]()
+      {
+        double sum = 0.0;
+        for( unsigned int i = 0; i < NumberOfPoints; ++i )
+        {
+          sum += transform->TransformPoint( ( *points )[ i ] )[ 0 ];
+        }
+        itkAssertOrThrowMacro( std::isfinite( sum ), "Invalid transformed point" );
+      } );
+    }, NumberOfPoints, false );
+  }
+
+} // end AddCombinationTransformBenchmarks()
+
+
+/**
+ * ******************* AddInterpolatorBenchmarks ***********************
+ */
+
+void
+AddInterpolatorBenchmarks( HarnessType * harness, const unsigned int size )
+{
+  for( unsigned int splineOrder = 1; splineOrder <= 3; splineOrder += 2 )
+  {
+    harness->AddBenchmark( "Interpolator/BSpline", { { "size", size }, { "order", splineOrder } },
+      [ size, splineOrder ]()
+    {
+      BSplineInterpolatorType::Pointer interpolator = BSplineInterpolatorType::New();
+      interpolator->SetSplineOrder( splineOrder );
+      interpolator->SetInputImage( CreateImage( size, 0.0 ) );
+      std::shared_ptr< std::vector< PointType > > points = CreatePoints( size );
+      return FunctionType( [ interpolator, points ]()
+      {
+        BSplineInterpolatorType::OutputType          value;
+        BSplineInterpolatorType::CovariantVectorType derivative;
+        ContinuousIndexType                          cindex;
+        for( unsigned int i = 0; i < NumberOfPoints; ++i )
+        {
+          interpolator->ConvertPointToContinuousIndex( ( *points )[ i ], cindex );
+          interpolator->EvaluateValueAndDerivativeAtContinuousIndex( cindex, value, derivative );
+        }
+      } );
+    }, NumberOfPoints, false );
+  }
+
+  harness->AddBenchmark( "Interpolator/AdvancedLinear", { { "size", size } }, [ size ]()
+  {
+    LinearInterpolatorType::Pointer interpolator = LinearInterpolatorType::New();
+    interpolator->SetInputImage( CreateImage( size, 0.0 ) );
+    std::shared_ptr< std::vector< PointType > > points = CreatePoints( size );
+    return FunctionType( [ interpolator, points ]()
+    {
+      LinearInterpolatorType::OutputType          value;
+      LinearInterpolatorType::CovariantVectorType derivative;
+      ContinuousIndexType                         cindex;
+      for( unsigned int i = 0; i < NumberOfPoints; ++i )
+      {
+        interpolator->ConvertPointToContinuousIndex( ( *points )[ i ], cindex );
+        interpolator->EvaluateValueAndDerivativeAtContinuousIndex( cindex, value, derivative );
+      }
+    } );
+  }, NumberOfPoints, false );
+
+} // end AddInterpolatorBenchmarks()
+
+
+/**
+ * ******************* AddSamplerBenchmarks ***********************
+ */
+
+void
+AddSamplerBenchmarks( HarnessType * harness, const unsigned int size, const unsigned long numberOfSamples )
+{
+  harness->AddBenchmark( "Sampler/Random", { { "size", size }, { "samples", numberOfSamples } },
+    [ size, numberOfSamples ]()
+  {
+    RandomSamplerType::Pointer sampler = RandomSamplerType::New();
+    sampler->SetInput( CreateImage( size, 0.0 ) );
+    sampler->SetNumberOfSamples( numberOfSamples );
+    return FunctionType( [ sampler ]()
+    {
+      sampler->Modified();
+      sampler->Update();
+    } );
+  }, numberOfSamples );
+
+  harness->AddBenchmark( "Sampler/Grid", { { "size", size } }, [ size ]()
+  {
+    GridSamplerType::Pointer sampler = GridSamplerType::New();
+    sampler->SetInput( CreateImage( size, 0.0 ) );
+    GridSamplerType::SampleGridSpacingType gridSpacing;
+    gridSpacing.Fill( 2 );
+    sampler->SetSampleGridSpacing( gridSpacing );
+    return FunctionType( [ sampler ]()
+    {
+      sampler->Modified();
+      sampler->Update();
+    } );
+  }, std::pow( size / 2.0, static_cast< double >( Dimension ) ) );
+
+  harness->AddBenchmark( "Sampler/Full", { { "size", size } }, [ size ]()
+  {
+    FullSamplerType::Pointer sampler = FullSamplerType::New();
+    sampler->SetInput( CreateImage( size, 0.0 ) );
+    return FunctionType( [ sampler ]()
+    {
+      sampler->Modified();
+      sampler->Update();
+    } );
+  }, std::pow( static_cast< double >( size ), static_cast< double >( Dimension ) ) );
+
+} // end AddSamplerBenchmarks()
+
+
+/**
+ * ******************* AddMaskBenchmarks ***********************
+ *
+ * Times the point-in-mask test for a spherical mask, with
+ * IsInsideInWorldSpace() (lookup 0) and with the ImageMaskLookup (lookup 1).
+ */
+
+void
+AddMaskBenchmarks( HarnessType * harness, const unsigned int size )
+{
+  for( unsigned int useLookup = 0; useLookup < 2; ++useLookup )
+  {
+    harness->AddBenchmark( "Mask/IsInside", { { "size", size }, { "lookup", useLookup } },
+      [ size, useLookup ]()
+    {
+      MaskImageType::SizeType imageSize;
+      imageSize.Fill( size );
+      MaskImageType::Pointer image = MaskImageType::New();
+      image->SetRegions( MaskImageType::RegionType( imageSize ) );
+      image->Allocate();
+
+      const double center  = 0.5 * size;
+      const double radius2 = ( size / 3.0 ) * ( size / 3.0 );
+      itk::ImageRegionIteratorWithIndex< MaskImageType > it( image, image->GetLargestPossibleRegion() );
+      for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+      {
+        double r2 = 0.0;
+        for( unsigned int d = 0; d < Dimension; ++d )
+        {
+          const double x = it.GetIndex()[ d ] - center;
+          r2 += x * x;
+        }
+        it.Set( r2 < radius2 ? 1 : 0 );
+      }
+
+      MaskSpatialObjectType::Pointer mask = MaskSpatialObjectType::New();
+      mask->SetImage( image );
+      mask->Update();
+
+      MaskLookupType::Pointer lookup = MaskLookupType::New();
+      lookup->SetMask( mask );
+      lookup->Update();
+
+      std::shared_ptr< std::vector< PointType > > points = CreatePoints( size );
+      std::shared_ptr< unsigned int >             result( new unsigned int( 0 ) );
+      if( useLookup )
+      {
+        return FunctionType( [ lookup, points, result ]()
+        {
+          unsigned int count = 0;
+          for( unsigned int i = 0; i < NumberOfPoints; ++i )
+          {
+            count += lookup->IsInside( ( *points )[ i ] );
+          }
+          *result = count;
+        } );
+      }
+      return FunctionType( [ mask, points, result ]()
+      {
+        unsigned int count = 0;
+        for( unsigned int i = 0; i < NumberOfPoints; ++i )
+        {
+          count += mask->IsInsideInWorldSpace( ( *points )[ i ] );
+        }
+        *result = count;
+      } );
+    }, NumberOfPoints, false );
+  }
+
+} // end AddMaskBenchmarks()
+
+
+/**
+ * ******************* ConfigureMetric ***********************
+ *
+ * Metric specific settings, needed for the synthetic images.
+ */
+
+template< class TMetric >
+void
+ConfigureMetric( TMetric * )
+{
+} // end ConfigureMetric()
+
+
+void
+ConfigureMetric( KappaStatisticMetricType * metric )
+{
+  /** The images have no foreground label, so threshold them. */
+  metric->SetUseForegroundValue( false );
+} // end ConfigureMetric()
+
+
+void
+ConfigureMetric( RigidityPenaltyType * metric )
+{
+  /** Without rigidity images, all rigidity coefficients are one. */
+  metric->SetUseFixedRigidityImage( false );
+  metric->SetUseMovingRigidityImage( false );
+} // end ConfigureMetric()
+
+
+/**
+ * ******************* AddMetricBenchmark ***********************
+ *
+ * Times GetValueAndDerivative() for a B-spline transform and a random
+ * sampler, configured as in a typical elastix registration.
+ */
+
+template< class TMetric >
+void
+AddMetricBenchmark( HarnessType * harness, const std::string & name, const unsigned int size,
+  const unsigned int gridSpacing, const unsigned long numberOfSamples )
+{
+  harness->AddBenchmark( "GetValueAndDerivative/" + name,
+    { { "size", size }, { "spacing", gridSpacing }, { "samples", numberOfSamples } },
+    [ size, gridSpacing, numberOfSamples ]()
+  {
+    ImageType::Pointer fixedImage  = CreateImage( size, 0.0 );
+    ImageType::Pointer movingImage = CreateImage( size, 1.5 );
+
+    RecursiveBSplineTransformType::Pointer bsplineTransform
+      = CreateBSplineTransform< RecursiveBSplineTransformType >( size, gridSpacing );
+    CombinationTransformType::Pointer transform = CombinationTransformType::New();
+    transform->SetCurrentTransform( bsplineTransform );
+
+    BSplineInterpolatorType::Pointer interpolator = BSplineInterpolatorType::New();
+    interpolator->SetSplineOrder( 1 );
+
+    RandomSamplerType::Pointer sampler = RandomSamplerType::New();
+    sampler->SetNumberOfSamples( numberOfSamples );
+
+    typename TMetric::Pointer metric = TMetric::New();
+    metric->SetFixedImage( fixedImage );
+    metric->SetMovingImage( movingImage );
+    metric->SetFixedImageRegion( fixedImage->GetBufferedRegion() );
+    metric->SetTransform( transform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetFixedImageLimiter(
+      itk::HardLimiterFunction< typename TMetric::RealType, Dimension >::New() );
+    metric->SetMovingImageLimiter(
+      itk::ExponentialLimiterFunction< typename TMetric::RealType, Dimension >::New() );
+    metric->SetUseMultiThread( true );
+    metric->SetNumberOfWorkUnits( itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads() );
+    ConfigureMetric( metric.GetPointer() );
+    metric->Initialize();
+
+    const ParametersType parameters = transform->GetParameters();
+    std::shared_ptr< DerivativeType > derivative( new DerivativeType( parameters.GetSize() ) );
+    return FunctionType( [ metric, parameters, derivative ]()
+    {
+      typename TMetric::MeasureType value = 0.0;
+      metric->GetValueAndDerivative( parameters, value, *derivative );
+      itkAssertOrThrowMacro( std::isfinite( value ), "Invalid metric value" );
+    } );
+  }, numberOfSamples );
+
+} // end AddMetricBenchmark()
+
+
+/**
+ * ******************* AddOptimizerBenchmarks ***********************
+ *
+ * The parameter updates of the optimizers all go through the shared vector
+ * kernels, so these are timed for the number of B-spline parameters.
+ */
+
+void
+AddOptimizerBenchmarks( HarnessType * harness, const unsigned int size, const unsigned int gridSpacing )
+{
+  const unsigned int gridPoints         = ( size + gridSpacing - 1 ) / gridSpacing + SplineOrder;
+  const unsigned int numberOfParameters = Dimension * gridPoints * gridPoints * gridPoints;
+  const ParameterListType parameters = { { "size", size }, { "spacing", gridSpacing } };
+
+  harness->AddBenchmark( "AdvanceOneStep", parameters, [ numberOfParameters ]()
+  {
+    std::shared_ptr< ParametersType > position( new ParametersType( numberOfParameters ) );
+    std::shared_ptr< DerivativeType > gradient( new DerivativeType( numberOfParameters ) );
+    position->Fill( 1.0 );
+    gradient->Fill( 1e-6 );
+    ThreaderType::Pointer threader = ThreaderType::New();
+    return FunctionType( [ position, gradient, threader ]()
+    {
+      itk::OptimizerVectorKernels::ScaledAdd( *position, -0.5, *gradient, *position,
+        threader, threader->GetNumberOfWorkUnits() );
+    } );
+  }, numberOfParameters );
+
+  harness->AddBenchmark( "GradientInnerProduct", parameters, [ numberOfParameters ]()
+  {
+    std::shared_ptr< DerivativeType > gradient( new DerivativeType( numberOfParameters ) );
+    gradient->Fill( 1e-3 );
+    ThreaderType::Pointer threader = ThreaderType::New();
+    return FunctionType( [ gradient, threader ]()
+    {
+      const double norm = itk::OptimizerVectorKernels::SquaredNorm( *gradient,
+        threader, threader->GetNumberOfWorkUnits() );
+      itkAssertOrThrowMacro( norm > 0.0, "Invalid gradient norm" );
+    } );
+  }, numberOfParameters );
+
+} // end AddOptimizerBenchmarks()
+
+
+/**
+ * ******************* AddPyramidBenchmark ***********************
+ */
+
+void
+AddPyramidBenchmark( HarnessType * harness, const unsigned int size )
+{
+  const double numberOfVoxels = std::pow( static_cast< double >( size ), static_cast< double >( Dimension ) );
+
+  harness->AddBenchmark( "Pyramid", { { "size", size }, { "levels", 4 } }, [ size ]()
+  {
+    typedef itk::GenericMultiResolutionPyramidImageFilter< ImageType, ImageType > PyramidType;
+    PyramidType::Pointer pyramid = PyramidType::New();
+    pyramid->SetInput( CreateImage( size, 0.0 ) );
+    pyramid->SetNumberOfLevels( 4 );
+    return FunctionType( [ pyramid ]()
+    {
+      pyramid->Modified();
+      pyramid->Update();
+    } );
+  }, numberOfVoxels );
+
+} // end AddPyramidBenchmark()
+
+
+/**
+ * ******************* AddResampleBenchmark ***********************
+ */
+
+void
+AddResampleBenchmark( HarnessType * harness, const unsigned int size, const unsigned int gridSpacing )
+{
+  const double numberOfVoxels = std::pow( static_cast< double >( size ), static_cast< double >( Dimension ) );
+
+  harness->AddBenchmark( "Resample/BSpline", { { "size", size }, { "spacing", gridSpacing }, { "order", 3 } },
+    [ size, gridSpacing ]()
+  {
+    typedef itk::ResampleImageFilter< ImageType, ImageType, CoordinateRepresentationType > ResamplerType;
+    ImageType::Pointer image = CreateImage( size, 0.0 );
+
+    BSplineInterpolatorType::Pointer interpolator = BSplineInterpolatorType::New();
+    interpolator->SetSplineOrder( 3 );
+
+    ResamplerType::Pointer resampler = ResamplerType::New();
+    resampler->SetInput( image );
+    resampler->SetTransform( CreateBSplineTransform< RecursiveBSplineTransformType >( size, gridSpacing ) );
+    resampler->SetInterpolator( interpolator );
+    resampler->SetOutputParametersFromImage( image );
+    return FunctionType( [ resampler ]()
+    {
+      resampler->Modified();
+      resampler->Update();
+    } );
+  }, numberOfVoxels );
+
+} // end AddResampleBenchmark()
+
+
+} // end namespace
+
+//-------------------------------------------------------------------------------------
+
+int
+main( int argc, char * argv[] )
+{
+  /** Create a command line argument parser. */
+  itk::CommandLineArgumentParser::Pointer parser = itk::CommandLineArgumentParser::New();
+  parser->SetCommandLineArguments( argc, argv );
+  parser->SetProgramHelpText(
+    "Usage:\n"
+    "itkRegistrationBenchmark\n"
+    "Times the sampled pairwise image metrics and the transform penalties.\n"
+    "The groupwise, point set, KNN, gradient difference and pattern intensity\n"
+    "metrics are not benchmarked.\n"
+    "  [-out]         the JSON output file\n"
+    "  [-filter]      only run benchmarks whose name contains this string\n"
+    "  [-size]        the image sizes, default 32 64\n"
+    "  [-spacing]     the B-spline grid spacings in voxels, default 16 8\n"
+    "  [-threads]     the thread counts, default 1 and the maximum\n"
+    "  [-samples]     the number of samples of the metrics, default 5000\n"
+    "                 (the rigidity penalty is evaluated on the B-spline grid)\n"
+    "  [-mintime]     the minimum time of a repetition in seconds, default 0.1\n"
+    "  [-repetitions] the number of repetitions, default 5\n" );
+
+  const itk::CommandLineArgumentParser::ReturnValue validateArguments = parser->CheckForRequiredArguments();
+  if( validateArguments == itk::CommandLineArgumentParser::FAILED )
+  {
+    return EXIT_FAILURE;
+  }
+  else if( validateArguments == itk::CommandLineArgumentParser::HELPREQUESTED )
+  {
+    return EXIT_SUCCESS;
+  }
+
+  std::string outputFileName = "";
+  parser->GetCommandLineArgument( "-out", outputFileName );
+  std::string filter = "";
+  parser->GetCommandLineArgument( "-filter", filter );
+  std::vector< unsigned int > sizes = { 32, 64 };
+  parser->GetCommandLineArgument( "-size", sizes );
+  std::vector< unsigned int > gridSpacings = { 16, 8 };
+  parser->GetCommandLineArgument( "-spacing", gridSpacings );
+  std::vector< unsigned int > threads = { 1 };
+  const unsigned int maximumNumberOfThreads = itk::MultiThreaderBase::GetGlobalDefaultNumberOfThreads();
+  if( maximumNumberOfThreads > 1 )
+  {
+    threads.push_back( maximumNumberOfThreads );
+  }
+  parser->GetCommandLineArgument( "-threads", threads );
+  unsigned long numberOfSamples = 5000;
+  parser->GetCommandLineArgument( "-samples", numberOfSamples );
+  double minimumTime = 0.1;
+  parser->GetCommandLineArgument( "-mintime", minimumTime );
+  unsigned int repetitions = 5;
+  parser->GetCommandLineArgument( "-repetitions", repetitions );
+
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  /** Register the benchmarks. */
+  HarnessType::Pointer harness = HarnessType::New();
+  harness->SetFilter( filter );
+  harness->SetMinimumTime( minimumTime );
+  harness->SetNumberOfRepetitions( repetitions );
+  harness->SetThreadList( HarnessType::ThreadListType( threads.begin(), threads.end() ) );
+
+  for( std::size_t s = 0; s < sizes.size(); ++s )
+  {
+    const unsigned int size = sizes[ s ];
+    for( std::size_t g = 0; g < gridSpacings.size(); ++g )
+    {
+      const unsigned int gridSpacing = gridSpacings[ g ];
+      AddTransformBenchmarks< BSplineTransformType >( harness, "BSpline", size, gridSpacing );
+      AddTransformBenchmarks< RecursiveBSplineTransformType >( harness, "RecursiveBSpline", size, gridSpacing );
+      AddCombinationTransformBenchmarks( harness, size, gridSpacing );
+      AddMetricBenchmark< MeanSquaresMetricType >( harness, "AdvancedMeanSquares", size, gridSpacing, numberOfSamples );
+      AddMetricBenchmark< NormalizedCorrelationMetricType >( harness, "AdvancedNormalizedCorrelation",
+        size, gridSpacing, numberOfSamples );
+      AddMetricBenchmark< MutualInformationMetricType >( harness, "AdvancedMattesMutualInformation",
+        size, gridSpacing, numberOfSamples );
+      AddMetricBenchmark< NormalizedMutualInformationMetricType >( harness, "NormalizedMutualInformation",
+        size, gridSpacing, numberOfSamples );
+      AddMetricBenchmark< KappaStatisticMetricType >( harness, "AdvancedKappaStatistic",
+        size, gridSpacing, numberOfSamples );
+      AddMetricBenchmark< TissueVolumeDifferenceMetricType >( harness, "SumSquaredTissueVolumeDifference",
+        size, gridSpacing, numberOfSamples );
+      AddMetricBenchmark< BendingEnergyPenaltyType >( harness, "TransformBendingEnergyPenalty",
+        size, gridSpacing, numberOfSamples );
+      AddMetricBenchmark< DisplacementMagnitudePenaltyType >( harness, "DisplacementMagnitudePenalty",
+        size, gridSpacing, numberOfSamples );
+      AddMetricBenchmark< RigidityPenaltyType >( harness, "TransformRigidityPenalty",
+        size, gridSpacing, numberOfSamples );
+      AddOptimizerBenchmarks( harness, size, gridSpacing );
+      AddResampleBenchmark( harness, size, gridSpacing );
+    }
+    AddInterpolatorBenchmarks( harness, size );
+    AddSamplerBenchmarks( harness, size, numberOfSamples );
+    AddMaskBenchmarks( harness, size );
+    AddPyramidBenchmark( harness, size );
+  }
+
+  /** Run the benchmarks and write the results. */
+  const unsigned int numberOfFailures = harness->Run();
+  if( !outputFileName.empty() && !harness->WriteJSON( outputFileName, argv[ 0 ] ) )
+  {
+    return EXIT_FAILURE;
+  }
+
+  if( numberOfFailures > 0 )
+  {
+    std::cerr << "ERROR: " << numberOfFailures << " benchmarks failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+
+} // end main
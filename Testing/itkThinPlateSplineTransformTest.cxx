@@ -19,9 +19,12 @@
 #include "itkTransformixInputPointFileReader.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 
+#include <algorithm>
+#include <cmath>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
+#include <vector>
 
 //-------------------------------------------------------------------------------------
 
@@ -147,6 +150,127 @@ main( int argc, char * argv[] )
   std::cerr << "GetJacobian() computation took: "
             << clock() - startClock << " ms." << std::endl;
 
+  /** Test the iterative solver against the direct (QR) solver, on a few
+   * hundred random landmarks with random displacements.
+   */
+  const unsigned long    numberOfRandomLandmarks = 300;
+  PointsContainerPointer randomSourcePoints      = PointsContainerType::New();
+  PointsContainerPointer randomTargetPoints      = PointsContainerType::New();
+  for( unsigned long j = 0; j < numberOfRandomLandmarks; j++ )
+  {
+    PointType sourcePoint, targetPoint;
+    for( unsigned int dim = 0; dim < Dimension; dim++ )
+    {
+      sourcePoint[ dim ] = mersenneTwister->GetUniformVariate( 0.0, 100.0 );
+      targetPoint[ dim ] = sourcePoint[ dim ] + mersenneTwister->GetNormalVariate( 1.0, 5.0 );
+    }
+    randomSourcePoints->push_back( sourcePoint );
+    randomTargetPoints->push_back( targetPoint );
+  }
+  PointSetType::Pointer randomSourceLandmarks = PointSetType::New();
+  PointSetType::Pointer randomTargetLandmarks = PointSetType::New();
+  randomSourceLandmarks->SetPoints( randomSourcePoints );
+  randomTargetLandmarks->SetPoints( randomTargetPoints );
+
+  TransformType::Pointer directKernelTransform    = TransformType::New();
+  TransformType::Pointer iterativeKernelTransform = TransformType::New();
+  directKernelTransform->SetStiffness( 0.0 );
+  directKernelTransform->SetMatrixInversionMethod( "QR" );
+  directKernelTransform->SetSourceLandmarks( randomSourceLandmarks );
+  directKernelTransform->SetTargetLandmarks( randomTargetLandmarks );
+  iterativeKernelTransform->SetStiffness( 0.0 );
+  iterativeKernelTransform->SetMatrixInversionMethod( "Iterative" );
+  iterativeKernelTransform->SetSourceLandmarks( randomSourceLandmarks );
+  startClock = clock();
+  iterativeKernelTransform->SetTargetLandmarks( randomTargetLandmarks );
+  std::cerr << "Setting target landmarks (iterative, " << numberOfRandomLandmarks
+            << " landmarks) took " << clock() - startClock << " ms, "
+            << iterativeKernelTransform->GetIterativeSolverNumberOfIterations()
+            << " iterations." << std::endl;
+
+  /** Compare the coefficients, relative to the largest one. */
+  const TransformType::DMatrixType & directD    = directKernelTransform->GetDMatrix();
+  const TransformType::DMatrixType & iterativeD = iterativeKernelTransform->GetDMatrix();
+  const double maxCoefficient           = directD.absolute_value_max();
+  double       maxCoefficientDifference = ( directD - iterativeD ).absolute_value_max();
+  for( unsigned int i = 0; i < Dimension; i++ )
+  {
+    for( unsigned int k = 0; k < Dimension; k++ )
+    {
+      maxCoefficientDifference = std::max( maxCoefficientDifference, std::abs(
+        directKernelTransform->GetAMatrix()( i, k ) - iterativeKernelTransform->GetAMatrix()( i, k ) ) );
+    }
+    maxCoefficientDifference = std::max( maxCoefficientDifference, std::abs(
+      directKernelTransform->GetBVector()( i ) - iterativeKernelTransform->GetBVector()( i ) ) );
+  }
+  std::cerr << "Maximum coefficient difference between iterative and QR solution: "
+            << maxCoefficientDifference << " (largest coefficient "
+            << maxCoefficient << ")." << std::endl;
+  if( maxCoefficientDifference > 1e-6 * maxCoefficient )
+  {
+    std::cerr << "ERROR: the iterative coefficients differ from the QR coefficients." << std::endl;
+    return 1;
+  }
+
+  /** Compare the transformed points, at the landmarks and at random points. */
+  std::vector< InputPointType > inputPoints;
+  for( unsigned long j = 0; j < numberOfRandomLandmarks; j++ )
+  {
+    inputPoints.push_back( ( *randomSourcePoints )[ j ] );
+    InputPointType randomPoint;
+    for( unsigned int dim = 0; dim < Dimension; dim++ )
+    {
+      randomPoint[ dim ] = mersenneTwister->GetUniformVariate( -10.0, 110.0 );
+    }
+    inputPoints.push_back( randomPoint );
+  }
+  std::vector< TransformType::OutputPointType > outputPoints;
+  iterativeKernelTransform->TransformPoints( inputPoints, outputPoints );
+  double maxPointDifference = 0.0;
+  for( unsigned int i = 0; i < inputPoints.size(); ++i )
+  {
+    const TransformType::OutputPointType opp = directKernelTransform->TransformPoint( inputPoints[ i ] );
+    maxPointDifference = std::max( maxPointDifference, opp.EuclideanDistanceTo( outputPoints[ i ] ) );
+  }
+  std::cerr << "Maximum point difference between iterative and QR solution: "
+            << maxPointDifference << std::endl;
+  if( maxPointDifference > 1e-5 )
+  {
+    std::cerr << "ERROR: the iterative solution differs from the QR solution." << std::endl;
+    return 1;
+  }
+
+  /** Switch between the iterative and the direct solvers on one transform.
+   * Each solver must start from its own state, and give the same points.
+   */
+  TransformType::Pointer switchingKernelTransform = TransformType::New();
+  switchingKernelTransform->SetStiffness( 0.0 );
+  switchingKernelTransform->SetMatrixInversionMethod( "QR" );
+  switchingKernelTransform->SetSourceLandmarks( randomSourceLandmarks );
+  switchingKernelTransform->SetTargetLandmarks( randomTargetLandmarks );
+  const TransformType::ParametersType switchingParameters = switchingKernelTransform->GetParameters();
+  const char * matrixInversionMethods[] = { "Iterative", "SVD", "Iterative", "QR" };
+  for( unsigned int m = 0; m < 4; ++m )
+  {
+    switchingKernelTransform->SetMatrixInversionMethod( matrixInversionMethods[ m ] );
+    switchingKernelTransform->SetParameters( switchingParameters );
+    switchingKernelTransform->TransformPoints( inputPoints, outputPoints );
+    maxPointDifference = 0.0;
+    for( unsigned int i = 0; i < inputPoints.size(); ++i )
+    {
+      const TransformType::OutputPointType opp = directKernelTransform->TransformPoint( inputPoints[ i ] );
+      maxPointDifference = std::max( maxPointDifference, opp.EuclideanDistanceTo( outputPoints[ i ] ) );
+    }
+    std::cerr << "Maximum point difference after switching to " << matrixInversionMethods[ m ]
+              << ": " << maxPointDifference << std::endl;
+    if( maxPointDifference > 1e-5 )
+    {
+      std::cerr << "ERROR: the solution after switching to " << matrixInversionMethods[ m ]
+                << " differs from the QR solution." << std::endl;
+      return 1;
+    }
+  }
+
   /** Additional checks. */
   if( !kernelTransform->GetHasNonZeroSpatialHessian() )
   {
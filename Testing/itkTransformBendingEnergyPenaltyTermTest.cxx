@@ -0,0 +1,194 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Compare the analytic bending energy of the TransformBendingEnergyPenaltyTerm
+ with the sampled bending energy.
+
+ The samples are the centers of a dense grid of subcells, covering the valid
+ region of a B-spline grid with random coefficients. The sampled mean bending
+ energy and its derivative should then be close to the analytic c^T A c and
+ 2 A c, in 2D and 3D. The number of pixels counted by the analytic bending
+ energy should be the number of cells of the valid region.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "BendingEnergyPenalty/itkTransformBendingEnergyPenaltyTerm.h"
+
+#include "itkAdvancedBSplineDeformableTransform.h"
+#include "itkAdvancedCombinationTransform.h"
+#include "itkImageFullSampler.h"
+#include "itkLinearInterpolateImageFunction.h"
+
+#include "itkImage.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+#include <cmath>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestBendingEnergy( const unsigned int subcellsPerCell )
+{
+  typedef itk::Image< float, Dimension >                           ImageType;
+  typedef itk::TransformBendingEnergyPenaltyTerm< ImageType, double > MetricType;
+  typedef itk::AdvancedBSplineDeformableTransform< double, Dimension, 3 > BSplineTransformType;
+  typedef itk::AdvancedCombinationTransform< double, Dimension >   CombinationTransformType;
+  typedef itk::ImageFullSampler< ImageType >                       SamplerType;
+  typedef itk::LinearInterpolateImageFunction< ImageType, double > InterpolatorType;
+  typedef typename MetricType::ParametersType                      ParametersType;
+  typedef typename MetricType::MeasureType                         MeasureType;
+  typedef typename MetricType::DerivativeType                      DerivativeType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator   RandomGeneratorType;
+
+  /** A B-spline grid with a different size and spacing in each dimension. */
+  typename BSplineTransformType::OriginType      gridOrigin;
+  typename BSplineTransformType::SpacingType     gridSpacing;
+  typename BSplineTransformType::RegionType::SizeType gridSize;
+  typename BSplineTransformType::DirectionType   gridDirection;
+  gridDirection.SetIdentity();
+  itk::SizeValueType numberOfValidCells = 1;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    gridOrigin[ i ]     = -10.0 + 3.0 * i;
+    gridSpacing[ i ]    = 5.0 + 2.0 * i;
+    gridSize[ i ]       = 7 + i;
+    numberOfValidCells *= gridSize[ i ] - 3;
+  }
+  typename BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridRegion( typename BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( gridDirection );
+  typename CombinationTransformType::Pointer transform = CombinationTransformType::New();
+  transform->SetCurrentTransform( bsplineTransform );
+
+  /** Random coefficients. */
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 343434 + Dimension );
+  ParametersType parameters( transform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = random->GetUniformVariate( -2.0, 2.0 );
+  }
+  transform->SetParameters( parameters );
+
+  /** An image with a pixel at the center of each subcell of the valid region
+   * of the B-spline grid, which is [1, n-2) in grid index coordinates.
+   */
+  typename ImageType::SizeType    imageSize;
+  typename ImageType::PointType   imageOrigin;
+  typename ImageType::SpacingType imageSpacing;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    imageSpacing[ i ] = gridSpacing[ i ] / subcellsPerCell;
+    imageOrigin[ i ]  = gridOrigin[ i ] + gridSpacing[ i ] + 0.5 * imageSpacing[ i ];
+    imageSize[ i ]    = ( gridSize[ i ] - 3 ) * subcellsPerCell;
+  }
+  typename ImageType::Pointer image = ImageType::New();
+  image->SetRegions( typename ImageType::RegionType( imageSize ) );
+  image->SetOrigin( imageOrigin );
+  image->SetSpacing( imageSpacing );
+  image->Allocate();
+  image->FillBuffer( 0.0f );
+
+  /** The sampled and the analytic bending energy. */
+  MeasureType    values[ 2 ];
+  DerivativeType derivatives[ 2 ];
+  itk::SizeValueType numberOfPixelsCounted[ 2 ];
+  for( unsigned int analytic = 0; analytic < 2; ++analytic )
+  {
+    typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+    typename SamplerType::Pointer      sampler      = SamplerType::New();
+    typename MetricType::Pointer       metric       = MetricType::New();
+    metric->SetFixedImage( image );
+    metric->SetMovingImage( image );
+    metric->SetFixedImageRegion( image->GetBufferedRegion() );
+    metric->SetTransform( transform );
+    metric->SetInterpolator( interpolator );
+    metric->SetImageSampler( sampler );
+    metric->SetUseAnalyticBendingEnergy( analytic == 1 );
+    metric->Initialize();
+
+    values[ analytic ] = 0.0;
+    metric->GetValueAndDerivative( parameters, values[ analytic ], derivatives[ analytic ] );
+    numberOfPixelsCounted[ analytic ] = metric->GetNumberOfPixelsCounted();
+
+    /** GetValue() should give the same value. */
+    const MeasureType value = metric->GetValue( parameters );
+    if( std::abs( value - values[ analytic ] ) > 1e-10 * std::abs( values[ analytic ] ) )
+    {
+      std::cerr << "ERROR: GetValue() differs from GetValueAndDerivative()." << std::endl;
+      return false;
+    }
+  }
+
+  const double valueError = std::abs( values[ 1 ] - values[ 0 ] ) / std::abs( values[ 0 ] );
+  const double derivativeError = ( derivatives[ 1 ] - derivatives[ 0 ] ).magnitude()
+    / derivatives[ 0 ].magnitude();
+
+  std::cout << std::setprecision( 12 ) << Dimension << "D, " << subcellsPerCell
+            << " samples per cell and dimension: sampled " << values[ 0 ] << ", analytic "
+            << values[ 1 ] << ", relative error " << valueError
+            << ", derivative relative error " << derivativeError
+            << ", pixels counted " << numberOfPixelsCounted[ 1 ] << std::endl;
+
+  /** The centers of the subcells are a midpoint rule for the integral over the
+   * valid region, which is accurate to about 1 / (24 subcellsPerCell^2).
+   */
+  if( !( valueError < 1e-2 ) || !( derivativeError < 1e-2 ) )
+  {
+    std::cerr << "ERROR: the analytic bending energy differs from the sampled one." << std::endl;
+    return false;
+  }
+  if( numberOfPixelsCounted[ 1 ] != numberOfValidCells )
+  {
+    std::cerr << "ERROR: the analytic bending energy counted " << numberOfPixelsCounted[ 1 ]
+              << " pixels, instead of the " << numberOfValidCells << " cells of the valid region." << std::endl;
+    return false;
+  }
+
+  return true;
+
+} // end TestBendingEnergy()
+
+
+int
+main( int argc, char ** argv )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  // 2D tests
+  bool success = TestBendingEnergy< 2 >( 12 );
+  if( !success ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  success = TestBendingEnergy< 3 >( 6 );
+  if( !success ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+} // end main
@@ -0,0 +1,573 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Test the value and the derivative of the TransformRigidityPenaltyTerm.
+
+ - The derivative is compared with central finite differences of the value,
+   on a B-spline grid with random coefficients and a random rigidity
+   coefficient image, with all conditions used and weighted differently. The
+   results with several threads should equal the single-threaded ones.
+ - A rigid displacement should give a zero penalty and derivative.
+ - An affine displacement should satisfy the linearity condition, while the
+   orthonormality and properness conditions should equal those of its matrix.
+ - For a single nonzero coefficient the three conditions are computed by hand.
+
+ Outside the grid the coefficients are clamped to the border, so the
+ derivative is only exact if the rigidity coefficients vanish on the border
+ of the grid. The first three tests therefore use a rigidity coefficient
+ image that is zero on the border.
+ */
+
+// elxout is used by the metrics, so the xout library has to be set up
+#include "elxMacro.h"
+#include "xoutmain.h"
+
+#include "RigidityPenalty/itkTransformRigidityPenaltyTerm.h"
+
+#include "itkImage.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "vnl/vnl_determinant.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+//-------------------------------------------------------------------------------------
+
+/** Relative difference between a result and its reference. */
+double
+RelativeDifference( const double value, const double reference )
+{
+  return std::abs( value - reference ) / std::max( std::abs( reference ), 1e-12 );
+}
+
+//-------------------------------------------------------------------------------------
+
+/** Create a B-spline transform with a different grid size and spacing in
+ * each dimension.
+ */
+template< class TBSplineTransform >
+typename TBSplineTransform::Pointer
+CreateBSplineTransform( void )
+{
+  const unsigned int Dimension = TBSplineTransform::SpaceDimension;
+
+  typename TBSplineTransform::OriginType              gridOrigin;
+  typename TBSplineTransform::SpacingType             gridSpacing;
+  typename TBSplineTransform::RegionType::SizeType    gridSize;
+  typename TBSplineTransform::DirectionType           gridDirection;
+  gridDirection.SetIdentity();
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    gridOrigin[ i ]  = -6.0 - i;
+    gridSpacing[ i ] = 4.0 + 1.5 * i;
+    gridSize[ i ]    = 7 + i;
+  }
+  typename TBSplineTransform::Pointer bsplineTransform = TBSplineTransform::New();
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridRegion( typename TBSplineTransform::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( gridDirection );
+
+  return bsplineTransform;
+
+} // end CreateBSplineTransform()
+
+//-------------------------------------------------------------------------------------
+
+/** Create a fixed rigidity image on the B-spline grid, so that it equals the
+ * rigidity coefficient image of the metric. It is zero on the border of the
+ * grid, and inside it is random, or one if no random generator is given.
+ */
+template< class TRigidityImage, class TBSplineTransform >
+typename TRigidityImage::Pointer
+CreateRigidityImage( const TBSplineTransform * bsplineTransform,
+  itk::Statistics::MersenneTwisterRandomVariateGenerator * random )
+{
+  const typename TBSplineTransform::RegionType region = bsplineTransform->GetGridRegion();
+
+  typename TRigidityImage::Pointer rigidityImage = TRigidityImage::New();
+  rigidityImage->SetRegions( region );
+  rigidityImage->SetOrigin( bsplineTransform->GetGridOrigin() );
+  rigidityImage->SetSpacing( bsplineTransform->GetGridSpacing() );
+  rigidityImage->SetDirection( bsplineTransform->GetGridDirection() );
+  rigidityImage->Allocate();
+
+  itk::ImageRegionIteratorWithIndex< TRigidityImage > it( rigidityImage, region );
+  for( it.GoToBegin(); !it.IsAtEnd(); ++it )
+  {
+    bool isOnBorder = false;
+    for( unsigned int i = 0; i < TRigidityImage::ImageDimension; ++i )
+    {
+      const itk::IndexValueType index = it.GetIndex()[ i ] - region.GetIndex()[ i ];
+      isOnBorder |= index == 0 || index + 1 == static_cast< itk::IndexValueType >( region.GetSize()[ i ] );
+    }
+    if( isOnBorder )
+    {
+      it.Set( 0.0 );
+    }
+    else
+    {
+      it.Set( random ? random->GetUniformVariate( 0.2, 1.0 ) : 1.0 );
+    }
+  }
+
+  return rigidityImage;
+
+} // end CreateRigidityImage()
+
+//-------------------------------------------------------------------------------------
+
+/** Create and initialize the metric. Without a rigidity image, the
+ * rigidity coefficients are one everywhere.
+ */
+template< class TMetric >
+typename TMetric::Pointer
+CreateMetric(
+  typename TMetric::BSplineTransformType * bsplineTransform,
+  typename TMetric::RigidityImageType * rigidityImage,
+  const unsigned int numberOfWorkUnits )
+{
+  typedef typename TMetric::FixedImageType                         ImageType;
+  typedef itk::LinearInterpolateImageFunction< ImageType, double > InterpolatorType;
+
+  /** Some image, which the metric needs for its initialization. */
+  typename ImageType::SizeType imageSize;
+  imageSize.Fill( 16 );
+  typename ImageType::Pointer image = ImageType::New();
+  image->SetRegions( typename ImageType::RegionType( imageSize ) );
+  image->Allocate();
+  image->FillBuffer( 0 );
+
+  typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  typename TMetric::Pointer          metric       = TMetric::New();
+  metric->SetFixedImage( image );
+  metric->SetMovingImage( image );
+  metric->SetFixedImageRegion( image->GetBufferedRegion() );
+  metric->SetInterpolator( interpolator );
+  metric->SetTransform( bsplineTransform );
+  metric->SetUseMultiThread( numberOfWorkUnits > 1 );
+  metric->SetNumberOfWorkUnits( numberOfWorkUnits );
+  if( rigidityImage )
+  {
+    metric->SetFixedRigidityImage( rigidityImage );
+  }
+  metric->SetUseFixedRigidityImage( rigidityImage != nullptr );
+  metric->SetUseMovingRigidityImage( false );
+  metric->SetDilateRigidityImages( false );
+  metric->SetLinearityConditionWeight( 0.7 );
+  metric->SetOrthonormalityConditionWeight( 1.3 );
+  metric->SetPropernessConditionWeight( 2.1 );
+  metric->Initialize();
+
+  return metric;
+
+} // end CreateMetric()
+
+//-------------------------------------------------------------------------------------
+
+/** Set the coefficients to the affine displacement u(x) = A ( x - c ) + t,
+ * with c the centre of the grid.
+ */
+template< class TBSplineTransform, class TMatrix, class TVector >
+typename TBSplineTransform::ParametersType
+ComputeAffineParameters( const TBSplineTransform * bsplineTransform,
+  const TMatrix & A, const TVector & t )
+{
+  const unsigned int Dimension = TBSplineTransform::SpaceDimension;
+  const typename TBSplineTransform::RegionType::SizeType gridSize = bsplineTransform->GetGridRegion().GetSize();
+  const typename TBSplineTransform::OriginType           origin   = bsplineTransform->GetGridOrigin();
+  const typename TBSplineTransform::SpacingType          spacing  = bsplineTransform->GetGridSpacing();
+
+  itk::SizeValueType numberOfGridPoints = 1;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    numberOfGridPoints *= gridSize[ i ];
+  }
+
+  /** The parameters are ordered per dimension, and per dimension as the
+   * grid points, with x running fastest.
+   */
+  typename TBSplineTransform::ParametersType parameters( Dimension * numberOfGridPoints );
+  for( itk::SizeValueType p = 0; p < numberOfGridPoints; ++p )
+  {
+    double             x[ Dimension ];
+    itk::SizeValueType rest = p;
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      const double index  = static_cast< double >( rest % gridSize[ i ] );
+      const double centre = 0.5 * ( gridSize[ i ] - 1 );
+      x[ i ] = ( index - centre ) * spacing[ i ];
+      rest  /= gridSize[ i ];
+    }
+    for( unsigned int i = 0; i < Dimension; ++i )
+    {
+      double u = t[ i ];
+      for( unsigned int j = 0; j < Dimension; ++j )
+      {
+        u += A[ i ][ j ] * x[ j ];
+      }
+      parameters[ i * numberOfGridPoints + p ] = u;
+    }
+  }
+
+  return parameters;
+
+} // end ComputeAffineParameters()
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestDerivative( void )
+{
+  typedef itk::Image< short, Dimension >                          ImageType;
+  typedef itk::TransformRigidityPenaltyTerm< ImageType, double >  MetricType;
+  typedef typename MetricType::BSplineTransformType               BSplineTransformType;
+  typedef typename MetricType::RigidityImageType                  RigidityImageType;
+  typedef typename MetricType::ParametersType                     ParametersType;
+  typedef typename MetricType::MeasureType                        MeasureType;
+  typedef typename MetricType::DerivativeType                     DerivativeType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator  RandomGeneratorType;
+
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 121212 + Dimension );
+
+  typename BSplineTransformType::Pointer bsplineTransform
+    = CreateBSplineTransform< BSplineTransformType >();
+  typename RigidityImageType::Pointer rigidityImage
+    = CreateRigidityImage< RigidityImageType >( bsplineTransform.GetPointer(), random.GetPointer() );
+
+  /** Random coefficients, large enough for the nonlinear terms to matter. */
+  ParametersType parameters( bsplineTransform->GetNumberOfParameters() );
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    parameters[ i ] = random->GetUniformVariate( -1.0, 1.0 );
+  }
+  bsplineTransform->SetParameters( parameters );
+
+  typename MetricType::Pointer metric = CreateMetric< MetricType >(
+    bsplineTransform.GetPointer(), rigidityImage.GetPointer(), 1 );
+
+  MeasureType    value = 0.0;
+  DerivativeType derivative;
+  metric->GetValueAndDerivative( parameters, value, derivative );
+  const MeasureType valueOnly = metric->GetValue( parameters );
+
+  /** The derivative with central finite differences. */
+  const double   delta = 1e-5;
+  DerivativeType finiteDifferenceDerivative( parameters.GetSize() );
+  ParametersType perturbedParameters = parameters;
+  for( unsigned int i = 0; i < parameters.GetSize(); ++i )
+  {
+    perturbedParameters[ i ] = parameters[ i ] + delta;
+    const MeasureType valuePlus = metric->GetValue( perturbedParameters );
+    perturbedParameters[ i ] = parameters[ i ] - delta;
+    const MeasureType valueMinus = metric->GetValue( perturbedParameters );
+    perturbedParameters[ i ] = parameters[ i ];
+    finiteDifferenceDerivative[ i ] = ( valuePlus - valueMinus ) / ( 2.0 * delta );
+  }
+
+  const double valueOnlyError  = RelativeDifference( valueOnly, value );
+  const double derivativeError = ( derivative - finiteDifferenceDerivative ).magnitude()
+    / finiteDifferenceDerivative.magnitude();
+
+  std::cout << std::setprecision( 12 ) << Dimension << "D: value " << value
+            << ", relative errors: GetValue " << valueOnlyError
+            << ", derivative w.r.t. finite differences " << derivativeError << std::endl;
+
+  if( !( value > 0.0 ) || !( valueOnlyError < 1e-10 ) || !( derivativeError < 1e-6 ) )
+  {
+    std::cerr << "ERROR: the derivative differs from the finite differences." << std::endl;
+    return false;
+  }
+
+  /** The results with several threads. */
+  typename MetricType::Pointer multiThreadedMetric = CreateMetric< MetricType >(
+    bsplineTransform.GetPointer(), rigidityImage.GetPointer(), 4 );
+
+  MeasureType    multiThreadedValue = 0.0;
+  DerivativeType multiThreadedDerivative;
+  multiThreadedMetric->GetValueAndDerivative( parameters, multiThreadedValue, multiThreadedDerivative );
+  metric->GetValueAndDerivative( parameters, value, derivative );
+
+  const double threadValueError      = RelativeDifference( multiThreadedValue, value );
+  const double threadDerivativeError = ( multiThreadedDerivative - derivative ).magnitude()
+    / derivative.magnitude();
+  const double threadConditionError = std::max( std::max(
+    RelativeDifference( multiThreadedMetric->GetLinearityConditionValue(), metric->GetLinearityConditionValue() ),
+    RelativeDifference( multiThreadedMetric->GetOrthonormalityConditionValue(), metric->GetOrthonormalityConditionValue() ) ),
+    RelativeDifference( multiThreadedMetric->GetPropernessConditionValue(), metric->GetPropernessConditionValue() ) );
+
+  std::cout << Dimension << "D, 4 work units: relative errors: value " << threadValueError
+            << ", derivative " << threadDerivativeError << ", conditions " << threadConditionError << std::endl;
+
+  if( !( threadValueError < 1e-10 ) || !( threadDerivativeError < 1e-10 ) || !( threadConditionError < 1e-10 ) )
+  {
+    std::cerr << "ERROR: the multi-threaded results differ from the single-threaded ones." << std::endl;
+    return false;
+  }
+
+  return true;
+
+} // end TestDerivative()
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestRigidAndAffine( void )
+{
+  typedef itk::Image< short, Dimension >                          ImageType;
+  typedef itk::TransformRigidityPenaltyTerm< ImageType, double >  MetricType;
+  typedef typename MetricType::BSplineTransformType               BSplineTransformType;
+  typedef typename MetricType::RigidityImageType                  RigidityImageType;
+  typedef typename MetricType::ParametersType                     ParametersType;
+  typedef typename MetricType::MeasureType                        MeasureType;
+  typedef typename MetricType::DerivativeType                     DerivativeType;
+  typedef itk::Matrix< double, Dimension, Dimension >             MatrixType;
+  typedef itk::Vector< double, Dimension >                        VectorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator  RandomGeneratorType;
+
+  RandomGeneratorType::Pointer random = RandomGeneratorType::New();
+  random->Initialize( 343434 + Dimension );
+
+  typename BSplineTransformType::Pointer bsplineTransform
+    = CreateBSplineTransform< BSplineTransformType >();
+  typename RigidityImageType::Pointer rigidityImage
+    = CreateRigidityImage< RigidityImageType >( bsplineTransform.GetPointer(), nullptr );
+  typename MetricType::Pointer metric = CreateMetric< MetricType >(
+    bsplineTransform.GetPointer(), rigidityImage.GetPointer(), 1 );
+
+  VectorType translation;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    translation[ i ] = random->GetUniformVariate( -3.0, 3.0 );
+  }
+
+  /** A rigid displacement u(x) = ( R - I ) ( x - c ) + t, with R a product of
+   * rotations in the planes of consecutive axes.
+   */
+  MatrixType rotation;
+  rotation.SetIdentity();
+  for( unsigned int i = 0; i + 1 < Dimension; ++i )
+  {
+    const double angle = 0.3 - 0.5 * i;
+    MatrixType   givens;
+    givens.SetIdentity();
+    givens[ i ][ i ]         = std::cos( angle );
+    givens[ i ][ i + 1 ]     = -std::sin( angle );
+    givens[ i + 1 ][ i ]     = std::sin( angle );
+    givens[ i + 1 ][ i + 1 ] = std::cos( angle );
+    rotation = rotation * givens;
+  }
+  MatrixType identity;
+  identity.SetIdentity();
+  const MatrixType rigidMatrix = rotation - identity;
+
+  MeasureType    value = 0.0;
+  DerivativeType derivative;
+  metric->GetValueAndDerivative(
+    ComputeAffineParameters( bsplineTransform.GetPointer(), rigidMatrix, translation ), value, derivative );
+
+  std::cout << std::setprecision( 12 ) << Dimension << "D, rigid: value " << value
+            << ", derivative magnitude " << derivative.magnitude() << std::endl;
+
+  if( !( std::abs( value ) < 1e-20 ) || !( derivative.magnitude() < 1e-10 ) )
+  {
+    std::cerr << "ERROR: a rigid displacement is penalized." << std::endl;
+    return false;
+  }
+
+  /** An affine displacement u(x) = A ( x - c ) + t. Its Jacobian J = I + A
+   * gives the orthonormality condition sum_{f <= g} ( J^T J - I )_{fg}^2 and
+   * the properness condition ( det J - 1 )^2.
+   */
+  MatrixType affineMatrix;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    for( unsigned int j = 0; j < Dimension; ++j )
+    {
+      affineMatrix[ i ][ j ] = random->GetUniformVariate( -0.2, 0.2 );
+    }
+  }
+  const MatrixType jacobian        = identity + affineMatrix;
+  const MatrixType jacobianProduct = MatrixType( jacobian.GetTranspose() ) * jacobian - identity;
+  double           expectedOrthonormality = 0.0;
+  for( unsigned int f = 0; f < Dimension; ++f )
+  {
+    for( unsigned int g = f; g < Dimension; ++g )
+    {
+      expectedOrthonormality += jacobianProduct[ f ][ g ] * jacobianProduct[ f ][ g ];
+    }
+  }
+  const double expectedProperness = vnl_math::sqr( vnl_determinant( jacobian.GetVnlMatrix().as_matrix() ) - 1.0 );
+
+  /** Only use the linearity condition, so that the derivative should vanish. */
+  metric->SetUseOrthonormalityCondition( false );
+  metric->SetUsePropernessCondition( false );
+  metric->GetValueAndDerivative(
+    ComputeAffineParameters( bsplineTransform.GetPointer(), affineMatrix, translation ), value, derivative );
+
+  const double orthonormalityError
+    = RelativeDifference( metric->GetOrthonormalityConditionValue(), expectedOrthonormality );
+  const double propernessError
+    = RelativeDifference( metric->GetPropernessConditionValue(), expectedProperness );
+
+  std::cout << Dimension << "D, affine: linearity condition " << metric->GetLinearityConditionValue()
+            << ", derivative magnitude " << derivative.magnitude()
+            << ", relative errors: orthonormality condition " << orthonormalityError
+            << ", properness condition " << propernessError << std::endl;
+
+  if( !( std::abs( metric->GetLinearityConditionValue() ) < 1e-20 ) || !( std::abs( value ) < 1e-20 )
+    || !( derivative.magnitude() < 1e-10 ) )
+  {
+    std::cerr << "ERROR: an affine displacement violates the linearity condition." << std::endl;
+    return false;
+  }
+  if( !( orthonormalityError < 1e-10 ) || !( propernessError < 1e-10 ) )
+  {
+    std::cerr << "ERROR: the orthonormality or properness condition of an affine displacement "
+              << "differs from the one of its matrix." << std::endl;
+    return false;
+  }
+
+  return true;
+
+} // end TestRigidAndAffine()
+
+//-------------------------------------------------------------------------------------
+
+/** The 2D orthonormality condition if only u_x varies, with a = du_x/dx and
+ * b = du_x/dy.
+ */
+double
+OrthonormalityCondition2D( const double a, const double b )
+{
+  return vnl_math::sqr( 2.0 * a + a * a ) + b * b * b * b + vnl_math::sqr( ( 1.0 + a ) * b );
+}
+
+//-------------------------------------------------------------------------------------
+
+/** On a 5x5 grid with spacing ( s0, s1 ), all rigidity coefficients one, and
+ * only the x-coefficient d of the centre nonzero, the derivatives only differ
+ * from zero in the 3x3 neighbourhood of the centre. With the 1D kernels
+ * [ -1 0 1 ] / ( 2 s ) for the first derivative, [ 1 -2 1 ] / ( 2 s^2 ) for
+ * the second derivative and [ 1 4 1 ] / 6 for smoothing, du_x/dx is
+ * -+d/(3 s0) at (+-1,0) and -+d/(12 s0) at the corners, and du_x/dy is
+ * -+d/(3 s1) at (0,+-1) and -+d/(12 s1) at the corners, relative to the centre.
+ * Summing over the 9 grid points and dividing by the 25 coefficients:
+ *   linearity:      ( 3/4 d^2/s0^4 + 3/4 d^2/s1^4 + 1/4 d^2/(s0^2 s1^2) ) / 25,
+ *   properness:     sum ( du_x/dx )^2 / 25 = d^2 / ( 4 s0^2 ) / 25,
+ *   orthonormality: sum OC( du_x/dx, du_x/dy ) / 25, with
+ *                   OC( a, b ) = ( 2a + a^2 )^2 + b^4 + ( ( 1 + a ) b )^2.
+ * The weights are those of CreateMetric().
+ */
+bool
+TestHandComputedValue( void )
+{
+  typedef itk::Image< short, 2 >                                  ImageType;
+  typedef itk::TransformRigidityPenaltyTerm< ImageType, double >  MetricType;
+  typedef MetricType::BSplineTransformType                        BSplineTransformType;
+  typedef MetricType::ParametersType                              ParametersType;
+  typedef MetricType::MeasureType                                 MeasureType;
+
+  const double s0 = 2.0;
+  const double s1 = 3.0;
+  const double d  = 0.6;
+
+  BSplineTransformType::OriginType           gridOrigin;
+  BSplineTransformType::SpacingType          gridSpacing;
+  BSplineTransformType::RegionType::SizeType gridSize;
+  BSplineTransformType::DirectionType        gridDirection;
+  gridOrigin.Fill( 0.0 );
+  gridSpacing[ 0 ] = s0;
+  gridSpacing[ 1 ] = s1;
+  gridSize.Fill( 5 );
+  gridDirection.SetIdentity();
+  BSplineTransformType::Pointer bsplineTransform = BSplineTransformType::New();
+  bsplineTransform->SetGridOrigin( gridOrigin );
+  bsplineTransform->SetGridSpacing( gridSpacing );
+  bsplineTransform->SetGridRegion( BSplineTransformType::RegionType( gridSize ) );
+  bsplineTransform->SetGridDirection( gridDirection );
+
+  ParametersType parameters( bsplineTransform->GetNumberOfParameters() );
+  parameters.Fill( 0.0 );
+  parameters[ 2 * 5 + 2 ] = d;
+
+  MetricType::Pointer metric = CreateMetric< MetricType >( bsplineTransform.GetPointer(), nullptr, 1 );
+  const MeasureType   value  = metric->GetValue( parameters );
+
+  const double a1 = d / ( 3.0 * s0 ), a2 = d / ( 12.0 * s0 );
+  const double b1 = d / ( 3.0 * s1 ), b2 = d / ( 12.0 * s1 );
+  const double expectedLinearity = ( 0.75 * d * d / ( s0 * s0 * s0 * s0 )
+    + 0.75 * d * d / ( s1 * s1 * s1 * s1 ) + 0.25 * d * d / ( s0 * s0 * s1 * s1 ) ) / 25.0;
+  const double expectedProperness     = d * d / ( 4.0 * s0 * s0 ) / 25.0;
+  const double expectedOrthonormality = (
+    OrthonormalityCondition2D( a1, 0.0 ) + OrthonormalityCondition2D( -a1, 0.0 )
+    + 2.0 * OrthonormalityCondition2D( 0.0, b1 )
+    + 2.0 * OrthonormalityCondition2D( a2, b2 ) + 2.0 * OrthonormalityCondition2D( -a2, b2 ) ) / 25.0;
+  const double expectedValue = 0.7 * expectedLinearity + 1.3 * expectedOrthonormality
+    + 2.1 * expectedProperness;
+
+  const double valueError          = RelativeDifference( value, expectedValue );
+  const double linearityError      = RelativeDifference( metric->GetLinearityConditionValue(), expectedLinearity );
+  const double orthonormalityError
+    = RelativeDifference( metric->GetOrthonormalityConditionValue(), expectedOrthonormality );
+  const double propernessError     = RelativeDifference( metric->GetPropernessConditionValue(), expectedProperness );
+
+  std::cout << "2D, single coefficient: value " << value << " (expected " << expectedValue
+            << "), relative errors: value " << valueError << ", linearity " << linearityError
+            << ", orthonormality " << orthonormalityError << ", properness " << propernessError << std::endl;
+
+  if( !( valueError < 1e-12 ) || !( linearityError < 1e-12 )
+    || !( orthonormalityError < 1e-12 ) || !( propernessError < 1e-12 ) )
+  {
+    std::cerr << "ERROR: the value differs from the hand-computed one." << std::endl;
+    return false;
+  }
+
+  return true;
+
+} // end TestHandComputedValue()
+
+
+int
+main( int argc, char ** argv )
+{
+  /** Set up xout, without any output. */
+  xl::xoutsimple_type g_xout;
+  xl::xoutsimple_type g_StandardXout;
+  xl::set_xout( &g_xout );
+  g_xout.AddTargetCell( "standard", &g_StandardXout );
+
+  // 2D tests
+  if( !TestDerivative< 2 >() ) { return EXIT_FAILURE; }
+  if( !TestRigidAndAffine< 2 >() ) { return EXIT_FAILURE; }
+  if( !TestHandComputedValue() ) { return EXIT_FAILURE; }
+
+  // 3D tests
+  if( !TestDerivative< 3 >() ) { return EXIT_FAILURE; }
+  if( !TestRigidAndAffine< 3 >() ) { return EXIT_FAILURE; }
+
+  return EXIT_SUCCESS;
+} // end main
@@ -0,0 +1,201 @@
+/*=========================================================================
+ *
+ *  Copyright UMC Utrecht and contributors
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+/** \file
+ \brief Test the dyadic refinement of the UpsampleBSplineParametersFilter.
+
+ The B-spline defined by the refined parameters should be equal to the one
+ defined by the original parameters. The result is also compared with the
+ resampling based upsampling, which is only approximately equal.
+ */
+
+#include "itkUpsampleBSplineParametersFilter.h"
+
+#include "itkImage.h"
+#include "itkBSplineResampleImageFunction.h"
+#include "itkOptimizerParameters.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+#include <algorithm>
+#include <cmath>
+
+//-------------------------------------------------------------------------------------
+
+// Test function templated over the dimension
+template< unsigned int Dimension >
+bool
+TestUpsampleBSplineParameters( const unsigned int splineOrder )
+{
+  typedef itk::OptimizerParameters< double >       ParametersType;
+  typedef itk::Image< double, Dimension >          ImageType;
+  typedef typename ImageType::SizeType             SizeType;
+  typedef typename ImageType::RegionType           RegionType;
+  typedef typename ImageType::SpacingType          SpacingType;
+  typedef typename ImageType::PointType            PointType;
+  typedef typename ImageType::DirectionType        DirectionType;
+  typedef itk::UpsampleBSplineParametersFilter<
+    ParametersType, ImageType >                    UpsampleFilterType;
+  typedef itk::BSplineResampleImageFunction<
+    ImageType, double >                            SplineFunctionType;
+  typedef itk::ContinuousIndex< double, Dimension > ContinuousIndexType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomNumberGeneratorType;
+
+  RandomNumberGeneratorType::Pointer randomNum = RandomNumberGeneratorType::GetInstance();
+  randomNum->Initialize( 565656 );
+
+  /** The current grid. The required grid has half the spacing, and starts
+   * half a current grid spacing before the current grid.
+   */
+  SizeType    currentSize, requiredSize;
+  SpacingType currentSpacing, requiredSpacing;
+  PointType   currentOrigin, requiredOrigin;
+  for( unsigned int i = 0; i < Dimension; ++i )
+  {
+    currentSize[ i ]     = 20 + 3 * i;
+    requiredSize[ i ]    = 2 * currentSize[ i ] + 1;
+    currentSpacing[ i ]  = 8.0 + i;
+    requiredSpacing[ i ] = currentSpacing[ i ] / 2.0;
+    currentOrigin[ i ]   = 1.0 + 2.0 * i;
+    requiredOrigin[ i ]  = currentOrigin[ i ] - requiredSpacing[ i ];
+  }
+  DirectionType direction;
+  direction.SetIdentity();
+  const RegionType currentRegion( currentSize );
+  const RegionType requiredRegion( requiredSize );
+
+  /** Random input parameters. */
+  ParametersType parameters( currentRegion.GetNumberOfPixels() * Dimension );
+  for( unsigned int p = 0; p < parameters.GetSize(); ++p )
+  {
+    parameters[ p ] = randomNum->GetUniformVariate( -10.0, 10.0 );
+  }
+
+  /** Upsample with the refinement stencil and by resampling. */
+  ParametersType refined, resampled;
+  typename UpsampleFilterType::Pointer upsampler = UpsampleFilterType::New();
+  upsampler->SetBSplineOrder( splineOrder );
+  upsampler->SetCurrentGridOrigin( currentOrigin );
+  upsampler->SetCurrentGridSpacing( currentSpacing );
+  upsampler->SetCurrentGridDirection( direction );
+  upsampler->SetCurrentGridRegion( currentRegion );
+  upsampler->SetRequiredGridOrigin( requiredOrigin );
+  upsampler->SetRequiredGridSpacing( requiredSpacing );
+  upsampler->SetRequiredGridDirection( direction );
+  upsampler->SetRequiredGridRegion( requiredRegion );
+
+  itk::TimeProbe refineTimer;
+  refineTimer.Start();
+  upsampler->UpsampleParameters( parameters, refined );
+  refineTimer.Stop();
+
+  upsampler->SetUseDyadicRefinement( false );
+  itk::TimeProbe resampleTimer;
+  resampleTimer.Start();
+  upsampler->UpsampleParameters( parameters, resampled );
+  resampleTimer.Stop();
+
+  /** Evaluate the B-splines of the original and the new parameters at
+   * random points, away from the border of the current grid.
+   */
+  typename ImageType::Pointer currentGrid  = ImageType::New();
+  typename ImageType::Pointer requiredGrid = ImageType::New();
+  typename ImageType::Pointer resampledGrid = ImageType::New();
+  currentGrid->SetRegions( currentRegion );
+  currentGrid->SetOrigin( currentOrigin );
+  currentGrid->SetSpacing( currentSpacing );
+  requiredGrid->SetRegions( requiredRegion );
+  requiredGrid->SetOrigin( requiredOrigin );
+  requiredGrid->SetSpacing( requiredSpacing );
+  resampledGrid->SetRegions( requiredRegion );
+  resampledGrid->SetOrigin( requiredOrigin );
+  resampledGrid->SetSpacing( requiredSpacing );
+
+  double maxRefinedDifference   = 0.0;
+  double maxResampledDifference = 0.0;
+  for( unsigned int d = 0; d < Dimension; ++d )
+  {
+    currentGrid->GetPixelContainer()->SetImportPointer(
+      parameters.data_block() + d * currentRegion.GetNumberOfPixels(),
+      currentRegion.GetNumberOfPixels() );
+    requiredGrid->GetPixelContainer()->SetImportPointer(
+      refined.data_block() + d * requiredRegion.GetNumberOfPixels(),
+      requiredRegion.GetNumberOfPixels() );
+    resampledGrid->GetPixelContainer()->SetImportPointer(
+      resampled.data_block() + d * requiredRegion.GetNumberOfPixels(),
+      requiredRegion.GetNumberOfPixels() );
+
+    typename SplineFunctionType::Pointer currentSpline   = SplineFunctionType::New();
+    typename SplineFunctionType::Pointer requiredSpline  = SplineFunctionType::New();
+    typename SplineFunctionType::Pointer resampledSpline = SplineFunctionType::New();
+    currentSpline->SetSplineOrder( splineOrder );
+    requiredSpline->SetSplineOrder( splineOrder );
+    resampledSpline->SetSplineOrder( splineOrder );
+    currentSpline->SetInputImage( currentGrid );
+    requiredSpline->SetInputImage( requiredGrid );
+    resampledSpline->SetInputImage( resampledGrid );
+
+    for( unsigned int n = 0; n < 1000; ++n )
+    {
+      ContinuousIndexType cindex;
+      for( unsigned int i = 0; i < Dimension; ++i )
+      {
+        cindex[ i ] = randomNum->GetUniformVariate( 2.0, currentSize[ i ] - 3.0 );
+      }
+      PointType point;
+      currentGrid->TransformContinuousIndexToPhysicalPoint( cindex, point );
+
+      const double value = currentSpline->Evaluate( point );
+      maxRefinedDifference = std::max( maxRefinedDifference,
+        std::abs( value - requiredSpline->Evaluate( point ) ) );
+      maxResampledDifference = std::max( maxResampledDifference,
+        std::abs( value - resampledSpline->Evaluate( point ) ) );
+    }
+  }
+
+  std::cout << Dimension << "D, order " << splineOrder << ": "
+            << "max difference " << maxRefinedDifference << " (refinement) vs "
+            << maxResampledDifference << " (resampling), time "
+            << refineTimer.GetMean() << " s vs "
+            << resampleTimer.GetMean() << " s." << std::endl;
+  if( maxRefinedDifference > 1e-8 )
+  {
+    std::cerr << "ERROR: the refined B-spline differs from the original B-spline." << std::endl;
+    return false;
+  }
+
+  return true;
+
+} // end TestUpsampleBSplineParameters()
+
+
+int
+main( int argc, char ** argv )
+{
+  for( unsigned int splineOrder = 1; splineOrder <= 3; splineOrder += 2 )
+  {
+    // 2D tests
+    bool success = TestUpsampleBSplineParameters< 2 >( splineOrder );
+    if( !success ) { return EXIT_FAILURE; }
+
+    // 3D tests
+    success = TestUpsampleBSplineParameters< 3 >( splineOrder );
+    if( !success ) { return EXIT_FAILURE; }
+  }
+
+  return EXIT_SUCCESS;
+} // end main